@@ -1,19 +1,83 @@
 #include "ActionGenerators.h"
 #include "Actions.h"
 #include "IActionManager.h"
+#include "IPlayer.h"
 #include "Log.h"
+#include "PlayerStatus.h"
+
+#include <algorithm>
 
 using namespace tf2_bot_detector;
 using namespace std::chrono_literals;
+using namespace std::string_literals;
+
+AdaptivePeriodicActionGenerator::AdaptivePeriodicActionGenerator(IWorldState& world) :
+	AutoWorldEventListener(world),
+	m_LastActivityTime(clock_t::now()) // We don't know anything yet
+{
+}
+
+duration_t AdaptivePeriodicActionGenerator::GetInterval() const
+{
+	const auto curTime = clock_t::now();
+	if (curTime < m_FastPollingUntil || (curTime - m_LastActivityTime) < FAST_POLLING_DURATION)
+		return GetFastInterval();
+	if ((curTime - m_LastActivityTime) >= STABLE_DELAY)
+		return GetStableInterval();
 
-duration_t StatusUpdateActionGenerator::GetInterval() const
+	return GetNormalInterval();
+}
+
+void AdaptivePeriodicActionGenerator::RequestFastPolling(time_point_t until)
+{
+	m_FastPollingUntil = std::max(m_FastPollingUntil, until);
+}
+
+void AdaptivePeriodicActionGenerator::OnPlayerStatusUpdate(IWorldState& world, const IPlayer& player)
+{
+	// Someone is still joining
+	if (player.GetConnectionState() != PlayerStatusState::Active)
+		OnActivity();
+}
+
+void AdaptivePeriodicActionGenerator::OnLocalPlayerInitialized(IWorldState& world, bool initialized)
+{
+	OnActivity();
+}
+
+void AdaptivePeriodicActionGenerator::OnPlayerDroppedFromServer(IWorldState& world, IPlayer& player, const std::string_view& reason)
+{
+	OnActivity();
+}
+
+void AdaptivePeriodicActionGenerator::OnLobbyChanged(IWorldState& world)
+{
+	OnActivity();
+}
+
+void AdaptivePeriodicActionGenerator::OnActivity()
+{
+	m_LastActivityTime = clock_t::now();
+}
+
+duration_t StatusUpdateActionGenerator::GetFastInterval() const
+{
+	return 1500ms;
+}
+
+duration_t StatusUpdateActionGenerator::GetNormalInterval() const
 {
 	return 3s;
 }
 
+duration_t StatusUpdateActionGenerator::GetStableInterval() const
+{
+	return 6s;
+}
+
 bool StatusUpdateActionGenerator::ExecuteImpl(IActionManager& manager)
 {
-	// 3 second interval, we want:
+	// Every interval, we want:
 	//   1. status
 	//   2. ping
 	//   3. status short
@@ -40,6 +104,11 @@ bool StatusUpdateActionGenerator::ExecuteImpl(IActionManager& manager)
 	return true;
 }
 
+ConfigActionGenerator::ConfigActionGenerator(std::function<std::string()> getConLogFileName) :
+	m_GetConLogFileName(std::move(getConLogFileName))
+{
+}
+
 duration_t ConfigActionGenerator::GetInterval() const
 {
 	return 10s;
@@ -47,7 +116,11 @@ duration_t ConfigActionGenerator::GetInterval() const
 
 bool ConfigActionGenerator::ExecuteImpl(IActionManager& manager)
 {
-	if (!manager.QueueAction<GenericCommandAction>("con_logfile", "console.log"))
+	std::string conLogFile = m_GetConLogFileName ? m_GetConLogFileName() : "console.log"s;
+	if (conLogFile.empty())
+		conLogFile = "\"\"";
+
+	if (!manager.QueueAction<GenericCommandAction>("con_logfile", conLogFile))
 		return false;
 	if (!manager.QueueAction<GenericCommandAction>("con_timestamp", "1"))
 		return false;
@@ -1,11 +1,16 @@
 #pragma once
 
 #include "Clock.h"
+#include "WorldEventListener.h"
+
+#include <functional>
+#include <string>
 
 namespace tf2_bot_detector
 {
 	class IAction;
 	class IActionManager;
+	class IWorldState;
 
 	class IActionGenerator
 	{
@@ -23,6 +28,9 @@ namespace tf2_bot_detector
 		virtual duration_t GetInterval() const = 0;
 		virtual duration_t GetInitialDelay() const { return {}; }
 
+		// Something is about to happen that we want to find out about quickly
+		virtual void RequestFastPolling(time_point_t until) {}
+
 		bool Execute(IActionManager& manager) override final;
 
 	protected:
@@ -32,12 +40,49 @@ namespace tf2_bot_detector
 		time_point_t m_LastRunTime{};
 	};
 
-	class StatusUpdateActionGenerator final : public IPeriodicActionGenerator
+	// Polls quickly around connecting, map changes, lobby changes and players joining or leaving, and
+	// backs off once the server has been stable for a while.
+	class AdaptivePeriodicActionGenerator : public IPeriodicActionGenerator, AutoWorldEventListener
 	{
 	public:
-		duration_t GetInterval() const override;
+		AdaptivePeriodicActionGenerator(IWorldState& world);
+
+		duration_t GetInterval() const override final;
+		void RequestFastPolling(time_point_t until) override;
+
+		// How long to keep polling quickly after something changed
+		static constexpr duration_t FAST_POLLING_DURATION = std::chrono::seconds(15);
+
+		// How long nothing has to change before we back off
+		static constexpr duration_t STABLE_DELAY = std::chrono::seconds(60);
 
 	protected:
+		virtual duration_t GetFastInterval() const = 0;
+		virtual duration_t GetNormalInterval() const = 0;
+		virtual duration_t GetStableInterval() const = 0;
+
+	private:
+		void OnPlayerStatusUpdate(IWorldState& world, const IPlayer& player) override;
+		void OnLocalPlayerInitialized(IWorldState& world, bool initialized) override;
+		void OnPlayerDroppedFromServer(IWorldState& world, IPlayer& player, const std::string_view& reason) override;
+		void OnLobbyChanged(IWorldState& world) override;
+
+		void OnActivity();
+
+		time_point_t m_LastActivityTime{};
+		time_point_t m_FastPollingUntil{};
+	};
+
+	class StatusUpdateActionGenerator final : public AdaptivePeriodicActionGenerator
+	{
+	public:
+		using AdaptivePeriodicActionGenerator::AdaptivePeriodicActionGenerator;
+
+	protected:
+		duration_t GetFastInterval() const override;
+		duration_t GetNormalInterval() const override;
+		duration_t GetStableInterval() const override;
+
 		bool ExecuteImpl(IActionManager& manager) override;
 
 	private:
@@ -48,18 +93,29 @@ namespace tf2_bot_detector
 	class ConfigActionGenerator final : public IPeriodicActionGenerator
 	{
 	public:
+		// getConLogFileName is what con_logfile is kept set to, see ConsoleLogParser::GetConLogFileName().
+		// An empty string turns console logging off. console.log is used if getConLogFileName is empty.
+		explicit ConfigActionGenerator(std::function<std::string()> getConLogFileName = nullptr);
+
 		duration_t GetInterval() const override;
 
 	protected:
 		bool ExecuteImpl(IActionManager& manager) override;
+
+	private:
+		std::function<std::string()> m_GetConLogFileName;
 	};
 
-	class LobbyDebugActionGenerator final : public IPeriodicActionGenerator
+	class LobbyDebugActionGenerator final : public AdaptivePeriodicActionGenerator
 	{
 	public:
-		duration_t GetInterval() const override { return std::chrono::seconds(1); }
+		using AdaptivePeriodicActionGenerator::AdaptivePeriodicActionGenerator;
 
 	protected:
+		duration_t GetFastInterval() const override { return std::chrono::seconds(1); }
+		duration_t GetNormalInterval() const override { return std::chrono::seconds(2); }
+		duration_t GetStableInterval() const override { return std::chrono::seconds(4); }
+
 		bool ExecuteImpl(IActionManager& manager) override;
 	};
 }
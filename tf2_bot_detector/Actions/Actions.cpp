@@ -4,6 +4,7 @@
 #include <mh/text/stringops.hpp>
 #include <nlohmann/json.hpp>
 
+#include <functional>
 #include <iomanip>
 #include <ostream>
 
@@ -44,6 +45,12 @@ GenericCommandAction::GenericCommandAction(std::string cmd, std::string args) :
 {
 }
 
+size_t GenericCommandAction::GetTargetHash() const
+{
+	const std::hash<std::string> hasher;
+	return hasher(m_Command) * 31 + hasher(m_Args);
+}
+
 void GenericCommandAction::WriteCommands(ICommandWriter& writer) const
 {
 	writer.Write(m_Command, m_Args);
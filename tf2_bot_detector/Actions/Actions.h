@@ -24,6 +24,15 @@ namespace tf2_bot_detector
 		COUNT,
 	};
 
+	enum class ActionPriority
+	{
+		Periodic,   // Status updates, config and lobby polling
+		Normal,
+		Moderation, // Votekicks and cheater warnings
+
+		COUNT,
+	};
+
 	class IAction : public ICommandSource
 	{
 	public:
@@ -32,6 +41,15 @@ namespace tf2_bot_detector
 		virtual duration_t GetMinInterval() const { return {}; }
 		virtual ActionType GetType() const = 0;
 		virtual size_t GetMaxQueuedCount() const { return size_t(-1); }
+
+		// Sent as soon as possible, instead of on the action manager's next regular update
+		virtual bool IsLatencySensitive() const { return false; }
+
+		virtual ActionPriority GetPriority() const { return ActionPriority::Normal; }
+
+		// Queueing an action while another one of the same type and target hash is still waiting to
+		// be sent does nothing
+		virtual size_t GetTargetHash() const { return 0; }
 	};
 
 	class GenericCommandAction : public IAction
@@ -40,6 +58,8 @@ namespace tf2_bot_detector
 		explicit GenericCommandAction(std::string cmd, std::string args = std::string());
 
 		ActionType GetType() const override { return ActionType::GenericCommand; }
+		ActionPriority GetPriority() const override { return ActionPriority::Periodic; }
+		size_t GetTargetHash() const override;
 		void WriteCommands(ICommandWriter& writer) const;
 
 	private:
@@ -73,6 +93,8 @@ namespace tf2_bot_detector
 		duration_t GetMinInterval() const override;
 		ActionType GetType() const override { return ActionType::Kick; }
 		size_t GetMaxQueuedCount() const override { return 1; }
+		bool IsLatencySensitive() const override { return true; }
+		ActionPriority GetPriority() const override { return ActionPriority::Moderation; }
 
 	private:
 		static std::string MakeArgs(uint16_t userID, KickReason reason);
@@ -93,6 +115,8 @@ namespace tf2_bot_detector
 		duration_t GetMinInterval() const override;
 		ActionType GetType() const override { return ActionType::ChatMessage; }
 		size_t GetMaxQueuedCount() const override { return 2; }
+		bool IsLatencySensitive() const override { return true; }
+		ActionPriority GetPriority() const override { return ActionPriority::Moderation; }
 
 	private:
 		static std::string_view GetCommand(ChatMessageType type);
@@ -111,6 +135,14 @@ namespace tf2_bot_detector
 #endif
 }
 
+MH_ENUM_REFLECT_BEGIN(tf2_bot_detector::ActionType)
+	MH_ENUM_REFLECT_VALUE(GenericCommand)
+	MH_ENUM_REFLECT_VALUE(Kick)
+	MH_ENUM_REFLECT_VALUE(ChatMessage)
+	MH_ENUM_REFLECT_VALUE(LobbyUpdate)
+	MH_ENUM_REFLECT_VALUE(StatusUpdate)
+MH_ENUM_REFLECT_END()
+
 MH_ENUM_REFLECT_BEGIN(tf2_bot_detector::KickReason)
 	MH_ENUM_REFLECT_VALUE(Cheating)
 	MH_ENUM_REFLECT_VALUE(Idle)
@@ -3,11 +3,13 @@
 #include "ICommandSource.h"
 #include "Log.h"
 #include "Config/Settings.h"
+#include "Util/TextUtils.h"
 
 #include <mh/text/codecvt.hpp>
 #include <mh/text/insertion_conversion.hpp>
 #include <mh/text/string_insertion.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 
@@ -19,7 +21,10 @@ using namespace tf2_bot_detector;
 
 struct HijackActionManager::RunningCommand
 {
-	RunningCommand(HANDLE procHandle, std::string command) : m_ProcHandle(procHandle), m_Command(command) {}
+	RunningCommand(HANDLE procHandle, std::string command, std::optional<size_t> cfgSlot) :
+		m_ProcHandle(procHandle), m_Command(command), m_CfgSlot(cfgSlot)
+	{
+	}
 	RunningCommand(const RunningCommand&) = delete;
 	RunningCommand& operator=(const RunningCommand&) = delete;
 	~RunningCommand()
@@ -46,6 +51,7 @@ struct HijackActionManager::RunningCommand
 
 	HANDLE m_ProcHandle;
 	std::string m_Command;
+	std::optional<size_t> m_CfgSlot;
 
 private:
 	time_point_t m_StartTime = clock_t::now();
@@ -76,6 +82,9 @@ struct HijackActionManager::Writer final : ICommandWriter
 		m_Commands.push_back({ std::move(cmd), std::move(args) });
 	}
 
+	// Is this a "simple" command, aka nothing to confuse the engine/OS CLI arg parser?
+	bool NeedsTempCfg() const { return m_ComplexCommands || m_CommandArgCount >= 200; }
+
 	std::vector<std::pair<std::string, std::string>> m_Commands;
 	bool m_ComplexCommands = false;
 	size_t m_CommandArgCount = 0;
@@ -98,10 +107,21 @@ void HijackActionManager::ProcessRunningCommands()
 		}
 
 		if (shouldRemove)
+		{
+			if (it->m_CfgSlot)
+				m_TempCfgSlots[*it->m_CfgSlot].m_RunningCommandCount--;
+
 			it = m_RunningCommands.erase(it);
+		}
 		else
+		{
 			++it;
+		}
 	}
+
+	const auto minuteAgo = clock_t::now() - 1min;
+	while (!m_ProcessSpawnTimes.empty() && m_ProcessSpawnTimes.front() < minuteAgo)
+		m_ProcessSpawnTimes.pop_front();
 }
 
 namespace tfbd_paths
@@ -144,14 +164,38 @@ HijackActionManager::~HijackActionManager()
 
 bool HijackActionManager::RunCommand(std::string cmd, std::string args)
 {
-	Writer writer;
-	writer.Write(std::move(cmd), std::move(args));
-	return SendHijackCommands(writer);
+	if (!FindWindowA("Valve001", nullptr))
+	{
+		DebugLogWarning("Attempted to send command \""s << cmd << "\" to game, but game is not running");
+		return false;
+	}
+
+	if (!m_PendingCommands)
+	{
+		m_PendingCommands = std::make_unique<Writer>();
+		m_PendingCommandsTime = clock_t::now();
+	}
+
+	m_PendingCommands->Write(std::move(cmd), std::move(args));
+	return true;
 }
 
 void HijackActionManager::Update()
 {
 	ProcessRunningCommands();
+
+	if (m_PendingCommands && (clock_t::now() - m_PendingCommandsTime) >= COALESCE_WINDOW)
+		FlushPendingCommands();
+}
+
+void HijackActionManager::FlushPendingCommands()
+{
+	// Every temp cfg might still be exec'd by an earlier launch, overwriting one could run the wrong commands
+	if (m_PendingCommands->NeedsTempCfg() && !HasFreeTempCfgSlot())
+		return;
+
+	const auto writer = std::move(m_PendingCommands);
+	SendHijackCommands(*writer);
 }
 
 bool HijackActionManager::ProcessSimpleCommands(const Writer& writer)
@@ -189,85 +233,87 @@ bool HijackActionManager::ProcessSimpleCommands(const Writer& writer)
 	return SendHijackCommand(cmdLine);
 }
 
-bool HijackActionManager::ProcessComplexCommands(const Writer& writer)
+bool HijackActionManager::HasFreeTempCfgSlot() const
 {
-	// More complicated, exec commands from a cfg file
-	assert(writer.m_ComplexCommands);
+	return std::any_of(m_TempCfgSlots.begin(), m_TempCfgSlots.end(),
+		[](const TempCfgSlot& slot) { return slot.m_RunningCommandCount == 0; });
+}
 
-	std::string cfgFileContents;
-	for (const auto& cmd : writer.m_Commands)
-		cfgFileContents << cmd.first << ' ' << cmd.second << '\n';
+std::optional<size_t> HijackActionManager::FindOrWriteTempCfg(const std::string& contents)
+{
+	const auto curTime = clock_t::now();
+	const auto hash = std::hash<std::string>{}(contents);
+
+	// Reuse a file that already has these contents
+	for (size_t i = 0; i < m_TempCfgSlots.size(); i++)
+	{
+		auto& slot = m_TempCfgSlots[i];
+		if (slot.m_ContentHash == hash && slot.m_Contents == contents)
+		{
+			slot.m_LastUsed = curTime;
+			return i;
+		}
+	}
+
+	// Otherwise overwrite the least recently used one that nothing is exec'ing anymore
+	std::optional<size_t> oldest;
+	for (size_t i = 0; i < m_TempCfgSlots.size(); i++)
+	{
+		const auto& slot = m_TempCfgSlots[i];
+		if (slot.m_RunningCommandCount == 0 && (!oldest || slot.m_LastUsed < m_TempCfgSlots[*oldest].m_LastUsed))
+			oldest = i;
+	}
+
+	if (!oldest)
+		return std::nullopt;
 
 	const auto globalPath = absolute_cfg_temp();
 	std::filesystem::create_directories(globalPath);
 
-	const auto hash = std::hash<std::string>{}(cfgFileContents);
-	std::string cfgFilename;
+	auto& slot = m_TempCfgSlots[*oldest];
 	{
-		auto found = m_TempCfgFiles.equal_range(hash);
-		for (auto it = found.first; it != found.second; ++it)
+		std::ofstream file(globalPath / (""s << *oldest << ".cfg"), std::ios_base::trunc);
+		file << contents;
+		if (!file.good())
 		{
-			// Make sure file contents are identical
-			std::string localCfgFilename = ""s << it->second << ".cfg";
-			std::filesystem::path path = globalPath / localCfgFilename;
-
-			std::ifstream file(path);
-			size_t comparePos = 0;
-			while (true)
-			{
-				char buf[4096];
-				file.read(buf, std::size(buf));
-				if (file.bad())
-					break;
-
-				const auto bufCount = static_cast<size_t>(file.gcount());
-				if (bufCount == 0)
-					break;
-
-				if (cfgFileContents.compare(comparePos, bufCount, buf, bufCount))
-				{
-					// Not equal
-					break;
-				}
-
-				comparePos += bufCount;
-			}
-
-			if (comparePos == cfgFileContents.size())
-			{
-				cfgFilename = std::move(localCfgFilename);
-				break;
-			}
+			LogError("Failed to write temp cfg file "s << *oldest << ".cfg");
+			slot = {}; // Whatever is on disk now, it isn't what we thought it was
+			return std::nullopt;
 		}
 	}
 
-	if (cfgFilename.empty())
-	{
-		// Create a new temp cfg file
-		cfgFilename = ""s << ++m_LastUpdateIndex << ".cfg";
-		//Log("Creating new temp cfg file "s << std::quoted(cfgFilename));
+	slot.m_ContentHash = hash;
+	slot.m_Contents = contents;
+	slot.m_LastUsed = curTime;
+	return oldest;
+}
 
-		std::ofstream file(globalPath / cfgFilename, std::ios_base::trunc);
-		assert(file.good());
-		file << cfgFileContents;
-		assert(file.good());
+bool HijackActionManager::ProcessComplexCommands(const Writer& writer)
+{
+	// More complicated, exec commands from a cfg file
+	assert(writer.NeedsTempCfg());
 
-		m_TempCfgFiles.emplace(std::hash<std::string>{}(cfgFileContents), m_LastUpdateIndex);
-	}
+	std::string cfgFileContents;
+	for (const auto& cmd : writer.m_Commands)
+		cfgFileContents << cmd.first << ' ' << cmd.second << '\n';
+
+	const auto slot = FindOrWriteTempCfg(cfgFileContents);
+	if (!slot)
+		return false;
 
-	return SendHijackCommand("+exec "s << (tfbd_paths::local::cfg_temp() / cfgFilename).generic_string());
+	const std::string cfgFilename = ""s << *slot << ".cfg";
+	return SendHijackCommand("+exec "s << (tfbd_paths::local::cfg_temp() / cfgFilename).generic_string(), slot);
 }
 
 bool HijackActionManager::SendHijackCommands(const Writer& writer)
 {
-	// Is this a "simple" command, aka nothing to confuse the engine/OS CLI arg parser?
-	if (!writer.m_ComplexCommands && writer.m_CommandArgCount < 200)
+	if (!writer.NeedsTempCfg())
 		return ProcessSimpleCommands(writer);
 	else
 		return ProcessComplexCommands(writer);
 }
 
-bool HijackActionManager::SendHijackCommand(std::string cmd)
+bool HijackActionManager::SendHijackCommand(std::string cmd, std::optional<size_t> cfgSlot)
 {
 	if (cmd.empty())
 		return true;
@@ -281,7 +327,12 @@ bool HijackActionManager::SendHijackCommand(std::string cmd)
 	const std::filesystem::path hl2Dir = m_Settings->GetTFDir() / "..";
 	const std::filesystem::path hl2ExePath = hl2Dir / "hl2.exe";
 
-	std::wstring cmdLine = mh::format(L"{} -game tf -hijack {}", hl2ExePath, mh::change_encoding<wchar_t>(cmd));
+	// Built in place, this runs for every command we send. CreateProcessW wants it writable.
+	SmallString<wchar_t, 1024> cmdLine;
+	cmdLine.append(L"\"");
+	cmdLine.append(hl2ExePath.native());
+	cmdLine.append(L"\" -game tf -hijack ");
+	AppendWC(cmdLine, cmd);
 
 	STARTUPINFOW si{};
 	si.cb = sizeof(si);
@@ -310,10 +361,14 @@ bool HijackActionManager::SendHijackCommand(std::string cmd)
 		return false;
 	}
 
+	m_ProcessSpawnTimes.push_back(clock_t::now());
 	if (m_Settings->m_Unsaved.m_DebugShowCommands)
-		DebugLog("Game command: {}", std::quoted(cmd));
+		DebugLog("Game command: {} ({} hl2.exe launches in the last minute)", std::quoted(cmd), m_ProcessSpawnTimes.size());
+
+	if (cfgSlot)
+		m_TempCfgSlots[*cfgSlot].m_RunningCommandCount++;
 
-	m_RunningCommands.emplace_back(pi.hProcess, std::move(cmd));
+	m_RunningCommands.emplace_back(pi.hProcess, std::move(cmd), cfgSlot);
 
 	if (!CloseHandle(pi.hThread))
 		LogError(MH_SOURCE_LOCATION_CURRENT(), "Failed to close process thread");
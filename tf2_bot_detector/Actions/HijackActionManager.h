@@ -1,9 +1,14 @@
 #pragma once
 #ifdef _WIN32
 
+#include "Clock.h"
+
+#include <array>
+#include <deque>
 #include <list>
 #include <memory>
-#include <unordered_map>
+#include <optional>
+#include <string>
 
 namespace tf2_bot_detector
 {
@@ -16,33 +21,54 @@ namespace tf2_bot_detector
 		HijackActionManager(const Settings& settings);
 		~HijackActionManager();
 
-		// Returns false if the action was not queued
+		// Returns false if the action was not queued. Commands queued within COALESCE_WINDOW of
+		// each other are sent together, with a single hl2.exe launch.
 		bool RunCommand(std::string cmd, std::string args = {});
 
 		void Update();
 
+		// hl2.exe -hijack launches over the last minute
+		size_t GetProcessSpawnsPerMinute() const { return m_ProcessSpawnTimes.size(); }
+
 	private:
 		const Settings* m_Settings = nullptr;
 
 		struct Writer;
 
+		static constexpr duration_t COALESCE_WINDOW = std::chrono::milliseconds(100);
+		std::unique_ptr<Writer> m_PendingCommands;
+		time_point_t m_PendingCommandsTime{};
+		void FlushPendingCommands();
+
 		auto absolute_root() const;
 		auto absolute_cfg() const;
 		auto absolute_cfg_temp() const;
 
-		// Map of temp cfg file content hashes to cfg file name so we don't
-		// create a ton of duplicate files.
-		std::unordered_multimap<size_t, uint32_t> m_TempCfgFiles;
-		uint32_t m_LastUpdateIndex = 0;
+		// A fixed set of temp cfg files, reused by content so we neither rewrite identical files
+		// nor leave a new one behind for every complex command.
+		struct TempCfgSlot
+		{
+			size_t m_ContentHash = 0;
+			std::string m_Contents;        // What's on disk, so reuse doesn't have to read it back
+			time_point_t m_LastUsed{};
+			size_t m_RunningCommandCount = 0; // hl2.exe launches that may still be exec'ing this file
+		};
+		static constexpr size_t TEMP_CFG_SLOT_COUNT = 8;
+		std::array<TempCfgSlot, TEMP_CFG_SLOT_COUNT> m_TempCfgSlots;
+		bool HasFreeTempCfgSlot() const;
+		std::optional<size_t> FindOrWriteTempCfg(const std::string& contents);
+
 		bool ProcessSimpleCommands(const Writer& writer);
 		bool ProcessComplexCommands(const Writer& writer);
 
 		bool SendHijackCommands(const Writer& writer);
-		bool SendHijackCommand(std::string cmd);
+		bool SendHijackCommand(std::string cmd, std::optional<size_t> cfgSlot = std::nullopt);
 
 		struct RunningCommand;
 		std::list<RunningCommand> m_RunningCommands;
 		void ProcessRunningCommands();
+
+		std::deque<time_point_t> m_ProcessSpawnTimes; // Only the last minute's worth
 	};
 }
 #endif
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "Clock.h"
+
+#include <functional>
 #include <memory>
 
 namespace tf2_bot_detector
@@ -14,8 +17,12 @@ namespace tf2_bot_detector
 
 		virtual void Update() = 0;
 
+		// Called once the game has responded to every command the action wrote. succeeded is false if
+		// any of them failed, or if nothing was actually sent.
+		using AckFunc = std::function<void(time_point_t sentTime, bool succeeded)>;
+
 		// Returns false if the action was not queued
-		virtual bool QueueAction(std::unique_ptr<IAction>&& action) = 0;
+		virtual bool QueueAction(std::unique_ptr<IAction>&& action, AckFunc onAck = {}) = 0;
 
 		template<typename TAction, typename... TArgs>
 		bool QueueAction(TArgs&&... args)
@@ -25,6 +32,9 @@ namespace tf2_bot_detector
 
 		virtual void AddPeriodicActionGenerator(std::unique_ptr<IPeriodicActionGenerator>&& action) = 0;
 
+		// Asks the periodic action generators to poll the game as fast as they can until then
+		virtual void RequestFastPolling(time_point_t until) = 0;
+
 		template<typename TAction, typename... TArgs>
 		void AddPeriodicActionGenerator(TArgs&&... args)
 		{
@@ -2,26 +2,34 @@
 #include "Actions/ActionGenerators.h"
 #include "Config/Settings.h"
 #include "ConsoleLog/ConsoleLines.h"
+#include "ConsoleLog/NetworkStatus.h"
 #include "Actions.h"
+#include "EventLog.h"
 #include "Log.h"
+#include "SessionArchive.h"
 #include "WorldEventListener.h"
 #include "WorldState.h"
+#include "Util/ConsoleCommandTokenizer.h"
+#include "Util/Profiler.h"
+#include "Util/StaticStringSet.h"
 
 #include <mh/text/insertion_conversion.hpp>
 #include <mh/text/string_insertion.hpp>
 #include <srcon/async_client.h>
 
+#include <array>
+#include <bit>
 #include <filesystem>
 #include <iomanip>
-#include <queue>
-#include <regex>
-#include <unordered_set>
+#include <list>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <utility>
 
 #undef min
 #undef max
 
-static const std::regex s_SingleCommandRegex(R"regex(((?:\w+)(?:\ +\w+)?)(?:\n)?)regex", std::regex::optimize);
-
 using namespace tf2_bot_detector;
 using namespace std::chrono_literals;
 using namespace std::string_literals;
@@ -32,12 +40,12 @@ namespace
 	class RCONActionManager final : public IRCONActionManager, BaseWorldEventListener
 	{
 	public:
-		RCONActionManager(const Settings& settings, IWorldState& world);
+		RCONActionManager(const Settings& settings, IWorldState& world, CommandSender sender = {});
 		~RCONActionManager();
 
 		void Update();
 
-		bool QueueAction(std::unique_ptr<IAction>&& action);
+		bool QueueAction(std::unique_ptr<IAction>&& action, AckFunc onAck = {}) override;
 
 		template<typename TAction, typename... TArgs>
 		bool QueueAction(TArgs&&... args)
@@ -46,6 +54,10 @@ namespace
 		}
 
 		void AddPeriodicActionGenerator(std::unique_ptr<IPeriodicActionGenerator>&& action);
+		void RequestFastPolling(time_point_t until) override;
+
+		Stats GetStats() const override;
+		bool IsResponding() const override;
 
 		template<typename TAction, typename... TArgs>
 		void AddPeriodicActionGenerator(TArgs&&... args)
@@ -56,28 +68,103 @@ namespace
 	private:
 		void OnLocalPlayerInitialized(IWorldState& world, bool initialized) override;
 
+		// Shared by all of the commands written by one action
+		struct PendingAck
+		{
+			AckFunc m_Func;
+			time_point_t m_SentTime{};
+			size_t m_RemainingCommands = 0;
+			bool m_Succeeded = true;
+		};
+
+		struct QueuedAction
+		{
+			std::unique_ptr<IAction> m_Action;
+			AckFunc m_OnAck;
+		};
+		using queued_action_list = std::list<QueuedAction>;
+
+		// Only one action per type and target is queued at a time
+		struct QueuedActionKey
+		{
+			ActionType m_Type;
+			size_t m_TargetHash;
+
+			bool operator==(const QueuedActionKey&) const = default;
+		};
+		struct QueuedActionKeyHash
+		{
+			size_t operator()(const QueuedActionKey& key) const { return key.m_TargetHash * 31 + size_t(key.m_Type); }
+		};
+		static QueuedActionKey GetQueuedActionKey(const IAction& action);
+		queued_action_list::iterator EraseQueuedAction(queued_action_list& list, queued_action_list::iterator it);
+
 		struct RunningCommand
 		{
+			uint32_t m_RequestID = 0;
+			ActionType m_Type{};
+			bool m_TimedOut = false;
 			time_point_t m_StartTime{};
 			std::string m_Command;
 			std::shared_future<std::string> m_Future;
+			std::shared_ptr<PendingAck> m_Ack;
+			std::span<const IConsoleLine::TryParseFunc> m_ResponseParsers;
 		};
-		std::queue<RunningCommand> m_RunningCommands;
+		// Several commands can be in flight at once, up to Settings::TF2Interface::GetRCONMaxInFlightCommands().
+		// The client matches each response to its request, so they're handled in whatever order they finish.
+		std::vector<RunningCommand> m_RunningCommands;
+		uint32_t m_LastRequestID = 0;
 		void ProcessRunningCommands();
 		void ProcessQueuedCommands();
 
+		// The console line types a command's response is made of, tried before any others
+		static std::span<const IConsoleLine::TryParseFunc> GetResponseParsers(const std::string_view& cmd);
+
 		struct Writer;
 
+		// Latency sensitive actions go out as soon as they're queued, everything else waits for the next tick
 		static constexpr duration_t UPDATE_INTERVAL = std::chrono::milliseconds(250);
 
+		// Commands aren't abandoned after this, only counted as timed out
+		static constexpr duration_t COMMAND_TIMEOUT = std::chrono::seconds(5);
+
+		struct CommandTypeCounters
+		{
+			static constexpr size_t LATENCY_BUCKET_COUNT = 16; // Bucket n holds latencies in [2^n, 2^(n+1)) ms
+
+			void AddResult(std::chrono::milliseconds latency, bool succeeded);
+			std::chrono::milliseconds GetLatencyPercentile(float percentile) const;
+
+			uint32_t m_Commands = 0;
+			uint32_t m_Failed = 0;
+			uint32_t m_OverLatencyTarget = 0;
+			std::chrono::milliseconds m_LatencyMax{};
+			std::array<uint32_t, LATENCY_BUCKET_COUNT> m_LatencyHistogram{};
+		};
+		std::array<CommandTypeCounters, size_t(ActionType::COUNT)> m_CommandTypeCounters;
+		uint32_t m_TimedOutCount = 0;
+		uint32_t m_BrokenPromiseCount = 0;
+		uint32_t m_ErrorCount = 0;
+		uint32_t m_ReconnectCount = 0;
+		size_t m_MaxQueuedCount = 0;
+		bool m_LastCommandFailed = false;
+		time_point_t m_LastSucceededTime{};
+
 		IWorldState& m_WorldState;
 		const Settings& m_Settings;
+		CommandSender m_Sender;
+		std::shared_future<std::string> SendCommand(const std::string& cmd) const;
+		bool CanSendCommands() const { return m_Sender || m_Settings.m_Unsaved.m_RCONClient; }
+
 		time_point_t m_LastUpdateTime{};
-		std::vector<std::unique_ptr<IAction>> m_Actions;
+		std::array<queued_action_list, size_t(ActionPriority::COUNT)> m_Actions; // Sent highest priority first
+		std::unordered_map<QueuedActionKey, queued_action_list::iterator, QueuedActionKeyHash> m_QueuedActionKeys;
+		std::array<size_t, size_t(ActionType::COUNT)> m_QueuedActionCounts{};
 		std::vector<std::unique_ptr<IPeriodicActionGenerator>> m_PeriodicActionGenerators;
 		std::map<ActionType, time_point_t> m_LastTriggerTime;
 
-		bool ShouldDiscardCommand(const std::string_view& cmd) const;
+		// cmdLine is the full command line, so arguments can't smuggle in extra statements
+		bool ShouldDiscardCommand(const std::string_view& cmdLine) const;
 		bool m_IsDiscardingServerCommands = true;
 	};
 }
@@ -99,8 +186,13 @@ std::unique_ptr<IRCONActionManager> IRCONActionManager::Create(const Settings& s
 	return std::make_unique<RCONActionManager>(settings, world);
 }
 
-RCONActionManager::RCONActionManager(const Settings& settings, IWorldState& world) :
-	m_Settings(settings), m_WorldState(world)
+std::unique_ptr<IRCONActionManager> IRCONActionManager::Create(const Settings& settings, IWorldState& world, CommandSender sender)
+{
+	return std::make_unique<RCONActionManager>(settings, world, std::move(sender));
+}
+
+RCONActionManager::RCONActionManager(const Settings& settings, IWorldState& world, CommandSender sender) :
+	m_Settings(settings), m_WorldState(world), m_Sender(std::move(sender))
 {
 	world.AddWorldEventListener(this);
 
@@ -111,32 +203,146 @@ RCONActionManager::~RCONActionManager()
 {
 }
 
-bool RCONActionManager::QueueAction(std::unique_ptr<IAction>&& action)
+auto RCONActionManager::GetQueuedActionKey(const IAction& action) -> QueuedActionKey
+{
+	return { action.GetType(), action.GetTargetHash() };
+}
+
+bool RCONActionManager::QueueAction(std::unique_ptr<IAction>&& action, AckFunc onAck)
 {
-	if (const auto maxQueuedCount = action->GetMaxQueuedCount();
-		maxQueuedCount <= m_Actions.size())
+	const auto key = GetQueuedActionKey(*action);
+	if (auto found = m_QueuedActionKeys.find(key); found != m_QueuedActionKeys.end())
 	{
-		const ActionType curActionType = action->GetType();
-		size_t count = 0;
-		for (const auto& queued : m_Actions)
+		// The same thing is already waiting to go out, whoever queued this gets to hear about that one
+		if (onAck)
 		{
-			if (queued->GetType() == curActionType)
+			auto& queuedAck = found->second->m_OnAck;
+			if (queuedAck)
 			{
-				if (++count >= maxQueuedCount)
-					return false;
+				queuedAck = [first = std::move(queuedAck), second = std::move(onAck)](time_point_t sentTime, bool succeeded)
+				{
+					first(sentTime, succeeded);
+					second(sentTime, succeeded);
+				};
+			}
+			else
+			{
+				queuedAck = std::move(onAck);
 			}
 		}
+
+		return true;
 	}
 
-	m_Actions.push_back(std::move(action));
+	auto& queuedCount = m_QueuedActionCounts[size_t(key.m_Type)];
+	if (queuedCount >= action->GetMaxQueuedCount())
+		return false;
+
+	auto& list = m_Actions[size_t(action->GetPriority())];
+	list.push_back({ std::move(action), std::move(onAck) });
+	m_QueuedActionKeys.emplace(key, std::prev(list.end()));
+	queuedCount++;
+	m_MaxQueuedCount = std::max(m_MaxQueuedCount, m_QueuedActionKeys.size());
+
 	return true;
 }
 
+auto RCONActionManager::EraseQueuedAction(queued_action_list& list, queued_action_list::iterator it) -> queued_action_list::iterator
+{
+	const auto key = GetQueuedActionKey(*it->m_Action);
+	m_QueuedActionKeys.erase(key);
+	m_QueuedActionCounts[size_t(key.m_Type)]--;
+	return list.erase(it);
+}
+
 void RCONActionManager::AddPeriodicActionGenerator(std::unique_ptr<IPeriodicActionGenerator>&& action)
 {
 	m_PeriodicActionGenerators.push_back(std::move(action));
 }
 
+void RCONActionManager::RequestFastPolling(time_point_t until)
+{
+	for (const auto& generator : m_PeriodicActionGenerators)
+		generator->RequestFastPolling(until);
+}
+
+void RCONActionManager::CommandTypeCounters::AddResult(std::chrono::milliseconds latency, bool succeeded)
+{
+	m_Commands++;
+	if (!succeeded)
+	{
+		m_Failed++;
+		return;
+	}
+
+	if (latency > LATENCY_TARGET)
+		m_OverLatencyTarget++;
+
+	m_LatencyMax = std::max(m_LatencyMax, latency);
+
+	const auto ms = uint64_t(std::max<std::chrono::milliseconds::rep>(latency.count(), 0));
+	m_LatencyHistogram[std::min<size_t>(ms ? std::bit_width(ms) - 1 : 0, LATENCY_BUCKET_COUNT - 1)]++;
+}
+
+std::chrono::milliseconds RCONActionManager::CommandTypeCounters::GetLatencyPercentile(float percentile) const
+{
+	uint32_t total = 0;
+	for (uint32_t count : m_LatencyHistogram)
+		total += count;
+
+	const auto target = uint32_t(total * percentile);
+	uint32_t seen = 0;
+	for (size_t i = 0; i < m_LatencyHistogram.size(); i++)
+	{
+		seen += m_LatencyHistogram[i];
+		if (seen > target)
+			return std::chrono::milliseconds(uint64_t(1) << (i + 1));
+	}
+
+	return {};
+}
+
+bool RCONActionManager::IsResponding() const
+{
+	return !m_LastCommandFailed && m_LastSucceededTime != time_point_t{} &&
+		(FrameClock::Now() - m_LastSucceededTime) < RESPONDING_TIMEOUT;
+}
+
+auto RCONActionManager::GetStats() const -> Stats
+{
+	Stats stats
+	{
+		.m_TimedOut = m_TimedOutCount,
+		.m_BrokenPromises = m_BrokenPromiseCount,
+		.m_Errors = m_ErrorCount,
+		.m_Reconnects = m_ReconnectCount,
+		.m_InFlight = m_RunningCommands.size(),
+		.m_Queued = m_QueuedActionKeys.size(),
+		.m_MaxQueued = m_MaxQueuedCount,
+	};
+
+	for (size_t i = 0; i < m_CommandTypeCounters.size(); i++)
+	{
+		const auto& counters = m_CommandTypeCounters[i];
+		if (counters.m_Commands == 0)
+			continue;
+
+		stats.m_CommandTypes.push_back(CommandTypeStats
+			{
+				.m_Type = ActionType(i),
+				.m_Commands = counters.m_Commands,
+				.m_Failed = counters.m_Failed,
+				.m_OverLatencyTarget = counters.m_OverLatencyTarget,
+				.m_LatencyMax = counters.m_LatencyMax,
+				.m_LatencyP50 = counters.GetLatencyPercentile(0.5f),
+				.m_LatencyP95 = counters.GetLatencyPercentile(0.95f),
+				.m_LatencyP99 = counters.GetLatencyPercentile(0.99f),
+			});
+	}
+
+	return stats;
+}
+
 void RCONActionManager::OnLocalPlayerInitialized(IWorldState& world, bool initialized)
 {
 	m_IsDiscardingServerCommands = !initialized;
@@ -152,20 +358,32 @@ void RCONActionManager::ProcessRunningCommands()
 		return DebugLogWarning(""s << funcName << "(): " << msg);
 	};
 
-	while (!m_RunningCommands.empty())
+	const auto curTime = FrameClock::Now();
+	for (auto it = m_RunningCommands.begin(); it != m_RunningCommands.end(); )
 	{
-		auto& cmd = m_RunningCommands.front();
+		auto& cmd = *it;
 		if (cmd.m_Future.wait_for(0s) == std::future_status::timeout)
-			break;
+		{
+			if (!cmd.m_TimedOut && (curTime - cmd.m_StartTime) > COMMAND_TIMEOUT)
+			{
+				cmd.m_TimedOut = true;
+				m_TimedOutCount++;
+			}
+
+			++it;
+			continue;
+		}
 
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(curTime - cmd.m_StartTime);
+		bool succeeded = false;
 		try
 		{
 			auto resultStr = cmd.m_Future.get();
+			ISessionArchive::Record(SessionArchiveRecordType::RCONResponse, cmd.m_Command, resultStr);
 
 			if (m_Settings.m_Unsaved.m_DebugShowCommands)
 			{
-				const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(tf2_bot_detector::clock_t::now() - cmd.m_StartTime);
-				std::string msg = "Game command processed in "s << elapsed.count() << "ms : " << std::quoted(cmd.m_Command);
+				std::string msg = "Game command #"s << cmd.m_RequestID << " processed in " << elapsed.count() << "ms : " << std::quoted(cmd.m_Command);
 
 				if (!resultStr.empty())
 					msg << ", response " << resultStr.size() << " bytes";
@@ -174,90 +392,204 @@ void RCONActionManager::ProcessRunningCommands()
 			}
 
 			if (!resultStr.empty())
-				m_WorldState.AddConsoleOutputChunk(resultStr);
+				m_WorldState.AddCommandResponse(resultStr, cmd.m_ResponseParsers);
+
+			succeeded = true;
 		}
 		catch (const std::future_error& e)
 		{
 			if (e.code() == std::future_errc::broken_promise)
+			{
+				m_BrokenPromiseCount++;
 				DebugLogWarning(std::string(__FUNCTION__) << "(): " << e.code().message() << ": " << e.what() << ": " << std::quoted(cmd.m_Command));
+			}
 			else
+			{
+				m_ErrorCount++;
 				PrintErrorMsg(e.code().message() << ": " << e.what() << ": " << std::quoted(cmd.m_Command));
+			}
 		}
 		catch (const std::exception& e)
 		{
+			m_ErrorCount++;
 			PrintErrorMsg(""s << e.what() << ": " << std::quoted(cmd.m_Command));
 		}
 
-		m_RunningCommands.pop();
+		m_CommandTypeCounters[size_t(cmd.m_Type)].AddResult(elapsed, succeeded);
+		if (succeeded && m_LastCommandFailed)
+			m_ReconnectCount++;
+		if (succeeded)
+			m_LastSucceededTime = curTime;
+
+		m_LastCommandFailed = !succeeded;
+
+		if (auto& ack = cmd.m_Ack)
+		{
+			ack->m_Succeeded &= succeeded;
+			if (--ack->m_RemainingCommands == 0)
+				ack->m_Func(ack->m_SentTime, ack->m_Succeeded);
+		}
+
+		it = m_RunningCommands.erase(it);
 	}
 }
 
-bool RCONActionManager::ShouldDiscardCommand(const std::string_view& cmd) const
+std::span<const IConsoleLine::TryParseFunc> RCONActionManager::GetResponseParsers(const std::string_view& cmd)
 {
-	if (!m_IsDiscardingServerCommands || !m_Settings.m_ConfigCompatibilityMode)
-		return false;
+	static constexpr IConsoleLine::TryParseFunc s_StatusParsers[] =
+	{
+		&ServerStatusPlayerLine::TryParse,
+		&ServerStatusPlayerIPLine::TryParse,
+		&ServerStatusShortPlayerLine::TryParse,
+		&ServerStatusPlayerCountLine::TryParse,
+		&ServerStatusMapLine::TryParse,
+		&EdictUsageLine::TryParse,
+	};
+	static constexpr IConsoleLine::TryParseFunc s_LobbyDebugParsers[] =
+	{
+		&LobbyMemberLine::TryParse,
+		&LobbyHeaderLine::TryParse,
+		&LobbyStatusFailedLine::TryParse,
+	};
+	static constexpr IConsoleLine::TryParseFunc s_PartyDebugParsers[] =
+	{
+		&PartyHeaderLine::TryParse,
+		&LobbyMemberLine::TryParse,
+	};
+	static constexpr IConsoleLine::TryParseFunc s_NetStatusParsers[] =
+	{
+		&NetStatusConfigLine::TryParse,
+		&NetLatencyLine::TryParse,
+		&NetLossLine::TryParse,
+		&NetPacketsTotalLine::TryParse,
+		&NetPacketsPerClientLine::TryParse,
+		&NetDataTotalLine::TryParse,
+		&NetDataPerClientLine::TryParse,
+	};
+	static constexpr IConsoleLine::TryParseFunc s_PingParsers[] =
+	{
+		&PingLine::TryParse,
+	};
 
-	static const std::unordered_set<std::string_view> s_KnownClientCommands =
+	static const std::unordered_map<std::string_view, std::span<const IConsoleLine::TryParseFunc>> s_ResponseParsers =
 	{
-		"tf_lobby_debug",
-		"tf_party_debug",
-		"net_status",
-		"con_logfile",
-		"con_timestamp",
-		"tf_mm_debug_level",
-		"net_showmsg",
+		{ "status", s_StatusParsers },
+		{ "tf_lobby_debug", s_LobbyDebugParsers },
+		{ "tf_party_debug", s_PartyDebugParsers },
+		{ "net_status", s_NetStatusParsers },
+		{ "ping", s_PingParsers },
 	};
 
-	if (s_KnownClientCommands.contains(cmd))
+	if (auto found = s_ResponseParsers.find(cmd); found != s_ResponseParsers.end())
+		return found->second;
+
+	return {};
+}
+
+bool RCONActionManager::ShouldDiscardCommand(const std::string_view& cmdLine) const
+{
+	if (!m_IsDiscardingServerCommands || !m_Settings.m_ConfigCompatibilityMode)
 		return false;
 
-	DebugLog("Discarding potential server command "s << std::quoted(cmd));
-	return true;
+	static constexpr StaticStringSet s_KnownClientCommands(
+		{
+			"tf_lobby_debug",
+			"tf_party_debug",
+			"net_status",
+			"con_logfile",
+			"con_timestamp",
+			"tf_mm_debug_level",
+			"net_showmsg",
+		});
+
+	ConsoleCommandTokenizer tokenizer(cmdLine);
+	while (auto cmd = tokenizer.NextCommand())
+	{
+		if (!s_KnownClientCommands.contains(*cmd))
+		{
+			DebugLog("Discarding potential server command "s << std::quoted(cmdLine));
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::shared_future<std::string> RCONActionManager::SendCommand(const std::string& cmd) const
+{
+	if (m_Sender)
+		return m_Sender(cmd);
+
+	return m_Settings.m_Unsaved.m_RCONClient->send_command_async(cmd, false);
 }
 
 void RCONActionManager::ProcessQueuedCommands()
 {
-	if (!m_Settings.m_Unsaved.m_RCONClient)
+	if (!CanSendCommands())
 		return;
 
-	const auto curTime = tfbd_clock_t::now();
-	if (curTime < (m_LastUpdateTime + UPDATE_INTERVAL))
-		return;
+	const auto curTime = FrameClock::Now();
+	const bool isTick = curTime >= (m_LastUpdateTime + UPDATE_INTERVAL);
+	if (isTick)
+	{
+		// Update periodic actions
+		for (const auto& generator : m_PeriodicActionGenerators)
+			generator->Execute(*this);
 
-	// Update periodic actions
-	for (const auto& generator : m_PeriodicActionGenerators)
-		generator->Execute(*this);
+		m_LastUpdateTime = curTime;
+	}
 
-	if (!m_Actions.empty())
+	if (!m_QueuedActionKeys.empty())
 	{
 		bool actionTypes[(int)ActionType::COUNT]{};
+		std::vector<AckFunc> unsentAcks;
 
 		struct Writer final : ICommandWriter
 		{
 			void Write(std::string cmd, std::string args) override
 			{
-				if (m_Manager->ShouldDiscardCommand(cmd))
-					return;
+				const auto responseParsers = GetResponseParsers(cmd);
 
 				if (!args.empty())
+				{
+					cmd.reserve(cmd.size() + 1 + args.size());
 					cmd << ' ' << args;
+				}
 
-				m_Manager->m_RunningCommands.push(
+				if (m_Manager->ShouldDiscardCommand(cmd))
+					return;
+
+				IEventLog::Record(EventLogRecordType::RCONCommand, cmd);
+
+				m_Manager->m_RunningCommands.push_back(
 					{
+						.m_RequestID = ++m_Manager->m_LastRequestID,
+						.m_Type = m_Type,
 						.m_StartTime = tfbd_clock_t::now(),
 						.m_Command = cmd,
-						.m_Future = m_Manager->m_Settings.m_Unsaved.m_RCONClient->send_command_async(cmd, false),
+						.m_Future = m_Manager->SendCommand(cmd),
+						.m_Ack = m_Ack,
+						.m_ResponseParsers = responseParsers,
 					});
+
+				if (m_Ack)
+					m_Ack->m_RemainingCommands++;
 			}
 
 			RCONActionManager* m_Manager = nullptr;
+			ActionType m_Type{};
+			std::shared_ptr<PendingAck> m_Ack;
 
 		} writer;
 
 		writer.m_Manager = this;
 
-		const auto ProcessAction = [&](const IAction* action)
+		const auto ProcessAction = [&](QueuedAction& queued)
 		{
+			const IAction* action = queued.m_Action.get();
+			if (!isTick && !action->IsLatencySensitive())
+				return false;
+
 			const ActionType type = action->GetType();
 			{
 				auto& previousMsg = actionTypes[(int)type];
@@ -269,27 +601,45 @@ void RCONActionManager::ProcessQueuedCommands()
 				previousMsg = true;
 			}
 
+			if (queued.m_OnAck)
+				writer.m_Ack = std::make_shared<PendingAck>(PendingAck{ std::move(queued.m_OnAck), curTime });
+
+			writer.m_Type = type;
 			action->WriteCommands(writer);
 			m_LastTriggerTime[type] = curTime;
+
+			if (auto ack = std::exchange(writer.m_Ack, nullptr); ack && ack->m_RemainingCommands == 0)
+				unsentAcks.push_back(std::move(ack->m_Func)); // Every command was discarded
+
 			return true;
 		};
 
-		// Process actions
-		for (auto it = m_Actions.begin(); it != m_Actions.end(); )
+		// Process actions, highest priority first so moderation actions always get the in-flight slots
+		// before periodic ones do
+		const size_t maxInFlight = m_Settings.m_TF2Interface.GetRCONMaxInFlightCommands();
+		for (size_t priority = m_Actions.size(); priority-- > 0 && m_RunningCommands.size() < maxInFlight; )
 		{
-			const IAction* action = it->get();
-			if (ProcessAction(it->get()))
-				it = m_Actions.erase(it);
-			else
-				++it;
+			auto& list = m_Actions[priority];
+			for (auto it = list.begin(); it != list.end() && m_RunningCommands.size() < maxInFlight; )
+			{
+				if (ProcessAction(*it))
+					it = EraseQueuedAction(list, it);
+				else
+					++it;
+			}
 		}
-	}
 
-	m_LastUpdateTime = curTime;
+		// Not called from inside the loop, in case they queue more actions
+		for (const AckFunc& ack : unsentAcks)
+			ack(curTime, false);
+	}
 }
 
 void RCONActionManager::Update()
 {
-	ProcessQueuedCommands();
+	TF2BD_PROFILE_SCOPE("RCONActionManager::Update");
+
+	// Finished commands make room for new ones
 	ProcessRunningCommands();
+	ProcessQueuedCommands();
 }
@@ -2,8 +2,16 @@
 
 #include "IActionManager.h"
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
 namespace tf2_bot_detector
 {
+	enum class ActionType;
 	class Settings;
 	class IWorldState;
 
@@ -11,5 +19,45 @@ namespace tf2_bot_detector
 	{
 	public:
 		static std::unique_ptr<IRCONActionManager> Create(const Settings& settings, IWorldState& world);
+
+		// Sends a command and returns its response, in place of Settings::Unsaved::m_RCONClient. For
+		// replays, which answer from a recording instead of a game.
+		using CommandSender = std::function<std::shared_future<std::string>(const std::string& cmd)>;
+		static std::unique_ptr<IRCONActionManager> Create(const Settings& settings, IWorldState& world, CommandSender sender);
+
+		// Votekicks and chat warnings should reach the game within this long of being sent
+		static constexpr std::chrono::milliseconds LATENCY_TARGET{ 250 };
+
+		struct CommandTypeStats
+		{
+			ActionType m_Type;
+			uint32_t m_Commands;           // Answered or failed
+			uint32_t m_Failed;
+			uint32_t m_OverLatencyTarget;
+			std::chrono::milliseconds m_LatencyMax;
+
+			// Upper bounds of the power of two bucket each percentile landed in
+			std::chrono::milliseconds m_LatencyP50;
+			std::chrono::milliseconds m_LatencyP95;
+			std::chrono::milliseconds m_LatencyP99;
+		};
+
+		struct Stats
+		{
+			std::vector<CommandTypeStats> m_CommandTypes; // Only the types that have sent anything
+			uint32_t m_TimedOut;        // Still unanswered after a while, whether or not they finished later
+			uint32_t m_BrokenPromises;  // Dropped by the client, usually because the connection went away
+			uint32_t m_Errors;          // Everything else that failed
+			uint32_t m_Reconnects;      // Commands going through again after a failure
+			size_t m_InFlight;
+			size_t m_Queued;
+			size_t m_MaxQueued;
+		};
+
+		virtual Stats GetStats() const = 0;
+
+		// Whether the game is answering commands: the last one got a response, and recently
+		static constexpr std::chrono::seconds RESPONDING_TIMEOUT{ 15 };
+		virtual bool IsResponding() const = 0;
 	};
 }
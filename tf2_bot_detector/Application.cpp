@@ -1,6 +1,7 @@
 #include "Application.h"
 #include "DB/TempDB.h"
 #include "UI/MainWindow.h"
+#include "Util/StartupTimeline.h"
 
 #include <mh/error/ensure.hpp>
 
@@ -10,17 +11,30 @@ using namespace tf2_bot_detector;
 
 static TF2BDApplication* s_Application;
 
-TF2BDApplication::TF2BDApplication()
+TF2BDApplication::TF2BDApplication(Mode mode)
 {
 	assert(!s_Application);
 	s_Application = this;
 
-	m_TempDB = DB::ITempDB::Create();
+	{
+		TF2BD_STARTUP_PHASE("ITempDB::Create");
+		m_TempDB = DB::ITempDB::Create();
+	}
+
+	if (mode == Mode::Headless)
+		return;
 
 	DebugLog("Initializing MainWindow...");
+	TF2BD_STARTUP_PHASE("MainWindow::MainWindow");
 	AddManagedWindow(std::make_unique<tf2_bot_detector::MainWindow>(*this));
 }
 
+TF2BDApplication::TF2BDApplication(const UIBenchmarkOptions& benchmark) :
+	TF2BDApplication(Mode::Headless)
+{
+	AddManagedWindow(std::make_unique<tf2_bot_detector::MainWindow>(*this, &benchmark));
+}
+
 TF2BDApplication::~TF2BDApplication() = default;
 
 TF2BDApplication& TF2BDApplication::GetApplication()
@@ -7,6 +7,7 @@
 namespace tf2_bot_detector
 {
 	class MainWindow;
+	struct UIBenchmarkOptions;
 
 	namespace DB
 	{
@@ -16,7 +17,16 @@ namespace tf2_bot_detector
 	class TF2BDApplication final : public ImGuiDesktop::Application
 	{
 	public:
-		TF2BDApplication();
+		enum class Mode
+		{
+			MainWindow,
+			Headless,  // No windows, HeadlessMonitor drives everything
+		};
+
+		explicit TF2BDApplication(Mode mode = Mode::MainWindow);
+
+		// The main window draws a synthetic server and closes itself when it's done, see UIBenchmark
+		explicit TF2BDApplication(const UIBenchmarkOptions& benchmark);
 		~TF2BDApplication();
 
 		static TF2BDApplication& GetApplication();
@@ -4,33 +4,108 @@
 #include "Log.h"
 #include "TextureManager.h"
 
+#include <mh/text/fmtstr.hpp>
 #include <mh/text/string_insertion.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <filesystem>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 using namespace std::string_literals;
 using namespace tf2_bot_detector;
 
 namespace
 {
+	enum class Icon : uint8_t
+	{
+		Heart,
+		VACShield,
+		GameBan,
+
+		COUNT,
+	};
+
+	// Looked for as images/<name>_<size>.png. Sizes that aren't there are made by halving the
+	// next one up, down to the smallest one here.
+	constexpr std::array<const char*, size_t(Icon::COUNT)> ICON_NAMES = { "heart", "vac_icon", "game_ban_icon" };
+	constexpr std::array<uint16_t, 4> ICON_SIZES = { 8, 16, 32, 64 };
+
+	constexpr uint32_t ICON_PACK_MAGIC = 0x4b505454; // "TTPK"
+	constexpr uint32_t ICON_PACK_VERSION = 1;
+
+	// Transparent border around each image in the sheet, so filtering never picks up its neighbours
+	constexpr uint16_t ICON_PADDING = 1;
+	constexpr uint16_t ICON_SHEET_WIDTH = 256;
+
+	// One size of an icon in the sheet
+	struct PackedIconEntry
+	{
+		uint8_t m_Icon;
+		uint8_t m_Padding{};
+		uint16_t m_Size;
+		uint16_t m_X;
+		uint16_t m_Y;
+	};
+	static_assert(sizeof(PackedIconEntry) == 8);
+
+	// A piece of the shared sheet
+	class PackedIcon final : public ITexture
+	{
+	public:
+		PackedIcon(std::shared_ptr<ITexture> sheet, const PackedIconEntry& entry) :
+			m_Sheet(std::move(sheet)), m_Size(entry.m_Size)
+		{
+			const float width = m_Sheet->GetWidth();
+			const float height = m_Sheet->GetHeight();
+			m_UVs.m_U0 = entry.m_X / width;
+			m_UVs.m_V0 = entry.m_Y / height;
+			m_UVs.m_U1 = (entry.m_X + entry.m_Size) / width;
+			m_UVs.m_V1 = (entry.m_Y + entry.m_Size) / height;
+		}
+
+		handle_type GetHandle() const override { return m_Sheet->GetHandle(); }
+		const TextureSettings& GetSettings() const override { return m_Sheet->GetSettings(); }
+		uint16_t GetWidth() const override { return m_Size; }
+		uint16_t GetHeight() const override { return m_Size; }
+		TextureUVs GetUVs() const override { return m_UVs; }
+
+	private:
+		std::shared_ptr<ITexture> m_Sheet;
+		uint16_t m_Size;
+		TextureUVs m_UVs;
+	};
+
 	class BaseTextures final : public IBaseTextures
 	{
 	public:
 		BaseTextures(ITextureManager& textureManager);
 
-		const ITexture* GetHeart_16() const override { return m_Heart_16.get(); }
-		const ITexture* GetVACShield_16() const override { return m_VACShield_16.get(); }
-		const ITexture* GetGameBanIcon_16() const override { return m_GameBanIcon_16.get(); }
+		const ITexture* GetHeart(float pixelSize) const override { return GetIcon(Icon::Heart, pixelSize); }
+		const ITexture* GetVACShield(float pixelSize) const override { return GetIcon(Icon::VACShield, pixelSize); }
+		const ITexture* GetGameBanIcon(float pixelSize) const override { return GetIcon(Icon::GameBan, pixelSize); }
 
 	private:
-		ITextureManager& m_TextureManager;
+		const ITexture* GetIcon(Icon icon, float pixelSize) const;
+
+		// Pixels of the whole sheet, RGBA
+		struct IconSheet
+		{
+			std::vector<PackedIconEntry> m_Entries;
+			Bitmap m_Bitmap;
+		};
 
-		std::shared_ptr<ITexture> m_Heart_16;
-		std::shared_ptr<ITexture> m_VACShield_16;
-		std::shared_ptr<ITexture> m_GameBanIcon_16;
+		static std::vector<std::filesystem::path> FindSourceImages();
+		static uint64_t GetSourceStamp(const std::vector<std::filesystem::path>& sources);
+		static bool TryLoadPack(const std::filesystem::path& packPath, uint64_t sourceStamp, IconSheet& sheet);
+		static void SavePack(const std::filesystem::path& packPath, uint64_t sourceStamp, const IconSheet& sheet);
+		static IconSheet BuildSheet();
 
-		std::shared_ptr<ITexture> TryLoadTexture(std::filesystem::path file) const;
+		// Smallest first
+		std::array<std::vector<std::shared_ptr<PackedIcon>>, size_t(Icon::COUNT)> m_Icons;
 	};
 }
 
@@ -39,27 +114,306 @@ std::unique_ptr<IBaseTextures> IBaseTextures::Create(ITextureManager& textureMan
 	return std::make_unique<BaseTextures>(textureManager);
 }
 
-BaseTextures::BaseTextures(ITextureManager& textureManager) :
-	m_TextureManager(textureManager),
-
-	m_Heart_16(TryLoadTexture("images/heart_16.png")),
-	m_VACShield_16(TryLoadTexture("images/vac_icon_16.png")),
-	m_GameBanIcon_16(TryLoadTexture("images/game_ban_icon_16.png"))
+static std::filesystem::path GetIconPackPath()
 {
+	return IFilesystem::Get().ResolvePath("temp/icon_cache/base_icons.bin", PathUsage::WriteLocal);
 }
 
-std::shared_ptr<ITexture> BaseTextures::TryLoadTexture(std::filesystem::path file) const
+static std::filesystem::path GetSourceImagePath(Icon icon, uint16_t size)
 {
-	file = IFilesystem::Get().ResolvePath(file, PathUsage::Read);
+	return mh::fmtstr<128>("images/{}_{}.png", ICON_NAMES[size_t(icon)], size).view();
+}
 
+BaseTextures::BaseTextures(ITextureManager& textureManager)
+{
 	try
 	{
-		return m_TextureManager.CreateTexture(Bitmap(file));
+		IconSheet sheet;
+
+		// Skip decoding the pngs (and finding room for them) unless they've changed since last time
+		const auto packPath = GetIconPackPath();
+		const auto sourceStamp = GetSourceStamp(FindSourceImages());
+		bool loadedPack = false;
+		try
+		{
+			loadedPack = TryLoadPack(packPath, sourceStamp, sheet);
+		}
+		catch (...)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(), "Ignoring icon pack {}", packPath);
+		}
+
+		if (!loadedPack)
+		{
+			sheet = BuildSheet();
+
+			try
+			{
+				SavePack(packPath, sourceStamp, sheet);
+			}
+			catch (...)
+			{
+				// Only costs us a slower startup next time
+				LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to save icon pack {}", packPath);
+			}
+		}
+
+		if (sheet.m_Entries.empty())
+			return;
+
+		const auto sheetTexture = textureManager.CreateTexture(sheet.m_Bitmap);
+		for (const auto& entry : sheet.m_Entries)
+			m_Icons[entry.m_Icon].push_back(std::make_shared<PackedIcon>(sheetTexture, entry));
+
+		for (auto& sizes : m_Icons)
+		{
+			std::sort(sizes.begin(), sizes.end(),
+				[](const std::shared_ptr<PackedIcon>& a, const std::shared_ptr<PackedIcon>& b) { return a->GetWidth() < b->GetWidth(); });
+		}
 	}
 	catch (const std::exception& e)
 	{
-		LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to load {}", file);
+		LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to load base textures");
+	}
+}
+
+const ITexture* BaseTextures::GetIcon(Icon icon, float pixelSize) const
+{
+	const auto& sizes = m_Icons[size_t(icon)];
+	for (const auto& size : sizes)
+	{
+		if (size->GetWidth() >= pixelSize)
+			return size.get();
+	}
+
+	return sizes.empty() ? nullptr : sizes.back().get();
+}
+
+std::vector<std::filesystem::path> BaseTextures::FindSourceImages()
+{
+	std::vector<std::filesystem::path> retVal;
+	for (size_t icon = 0; icon < size_t(Icon::COUNT); icon++)
+	{
+		for (uint16_t size : ICON_SIZES)
+		{
+			if (auto path = IFilesystem::Get().ResolvePath(GetSourceImagePath(Icon(icon), size), PathUsage::Read); !path.empty())
+				retVal.push_back(std::move(path));
+		}
+	}
+
+	return retVal;
+}
+
+uint64_t BaseTextures::GetSourceStamp(const std::vector<std::filesystem::path>& sources)
+{
+	// 64-bit FNV-1a of where each source is and when it was last written
+	uint64_t hash = 0xcbf29ce484222325;
+	const auto Hash = [&](const void* data, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= static_cast<const uint8_t*>(data)[i];
+			hash *= 0x100000001b3;
+		}
+	};
+
+	for (const auto& source : sources)
+	{
+		const auto pathStr = source.string();
+		Hash(pathStr.data(), pathStr.size());
+
+		std::error_code ec;
+		const auto writeTime = std::filesystem::last_write_time(source, ec).time_since_epoch().count();
+		const auto fileSize = std::filesystem::file_size(source, ec);
+		Hash(&writeTime, sizeof(writeTime));
+		Hash(&fileSize, sizeof(fileSize));
+	}
+
+	return hash;
+}
+
+bool BaseTextures::TryLoadPack(const std::filesystem::path& packPath, uint64_t sourceStamp, IconSheet& sheet)
+{
+	if (!std::filesystem::exists(packPath))
+		return false;
+
+	const MappedFile file = IFilesystem::Get().MapFile(packPath);
+	std::string_view data = file;
+	const auto Read = [&](void* dest, size_t size)
+	{
+		if (size > data.size())
+			throw std::runtime_error("Unexpected end of icon pack");
+
+		std::memcpy(dest, data.data(), size);
+		data.remove_prefix(size);
+	};
+
+	uint32_t magic, version, entryCount, width, height;
+	uint64_t stamp;
+	Read(&magic, sizeof(magic));
+	Read(&version, sizeof(version));
+	if (magic != ICON_PACK_MAGIC || version != ICON_PACK_VERSION)
+		return false;
+
+	Read(&stamp, sizeof(stamp));
+	if (stamp != sourceStamp)
+		return false;
+
+	Read(&entryCount, sizeof(entryCount));
+	Read(&width, sizeof(width));
+	Read(&height, sizeof(height));
+
+	sheet.m_Entries.resize(entryCount);
+	Read(sheet.m_Entries.data(), sheet.m_Entries.size() * sizeof(PackedIconEntry));
+	for (const auto& entry : sheet.m_Entries)
+	{
+		if (entry.m_Icon >= size_t(Icon::COUNT) || (entry.m_X + entry.m_Size) > width || (entry.m_Y + entry.m_Size) > height)
+			throw std::runtime_error("Invalid icon pack entry");
+	}
+
+	sheet.m_Bitmap = Bitmap(width, height, 4);
+	Read(sheet.m_Bitmap.GetData(), sheet.m_Bitmap.GetDataSize());
+	return true;
+}
+
+void BaseTextures::SavePack(const std::filesystem::path& packPath, uint64_t sourceStamp, const IconSheet& sheet)
+{
+	std::string data;
+	const auto Write = [&](const void* src, size_t size) { data.append(static_cast<const char*>(src), size); };
+
+	const uint32_t entryCount = uint32_t(sheet.m_Entries.size());
+	const uint32_t width = sheet.m_Bitmap.GetWidth();
+	const uint32_t height = sheet.m_Bitmap.GetHeight();
+	Write(&ICON_PACK_MAGIC, sizeof(ICON_PACK_MAGIC));
+	Write(&ICON_PACK_VERSION, sizeof(ICON_PACK_VERSION));
+	Write(&sourceStamp, sizeof(sourceStamp));
+	Write(&entryCount, sizeof(entryCount));
+	Write(&width, sizeof(width));
+	Write(&height, sizeof(height));
+	Write(sheet.m_Entries.data(), sheet.m_Entries.size() * sizeof(PackedIconEntry));
+	Write(sheet.m_Bitmap.GetData(), sheet.m_Bitmap.GetDataSize());
+
+	IFilesystem::Get().WriteFile(packPath, data, PathUsage::WriteLocal);
+}
+
+// Half the size, averaging each 2x2 block weighted by alpha so transparent pixels don't darken the edges
+static Bitmap Downsample(const Bitmap& source)
+{
+	const uint32_t size = source.GetWidth() / 2;
+	Bitmap retVal(size, size, 4);
+
+	const auto* src = static_cast<const uint8_t*>(source.GetData());
+	auto* dst = static_cast<uint8_t*>(retVal.GetData());
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			uint32_t rgb[3]{};
+			uint32_t alpha = 0;
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				const uint8_t* pixel = src + ((size_t(y * 2 + i / 2) * source.GetWidth()) + (x * 2 + i % 2)) * 4;
+				for (uint32_t c = 0; c < 3; c++)
+					rgb[c] += uint32_t(pixel[c]) * pixel[3];
+
+				alpha += pixel[3];
+			}
+
+			uint8_t* out = dst + (size_t(y) * size + x) * 4;
+			for (uint32_t c = 0; c < 3; c++)
+				out[c] = alpha ? uint8_t((rgb[c] + alpha / 2) / alpha) : 0;
+
+			out[3] = uint8_t((alpha + 2) / 4);
+		}
+	}
+
+	return retVal;
+}
+
+auto BaseTextures::BuildSheet() -> IconSheet
+{
+	std::vector<PackedIconEntry> entries;
+	std::vector<Bitmap> bitmaps;
+
+	for (size_t icon = 0; icon < size_t(Icon::COUNT); icon++)
+	{
+		// Biggest first, so the missing sizes can be made from the ones above them
+		const Bitmap* larger = nullptr;
+		for (auto size = ICON_SIZES.rbegin(); size != ICON_SIZES.rend(); ++size)
+		{
+			Bitmap bitmap;
+			if (auto path = IFilesystem::Get().ResolvePath(GetSourceImagePath(Icon(icon), *size), PathUsage::Read); !path.empty())
+			{
+				try
+				{
+					bitmap = Bitmap(path, 4);
+					if (bitmap.GetWidth() != *size || bitmap.GetHeight() != *size)
+					{
+						LogError("{} is {}x{}, expected {}x{}", path, bitmap.GetWidth(), bitmap.GetHeight(), *size, *size);
+						bitmap = {};
+					}
+				}
+				catch (const std::exception& e)
+				{
+					LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to load {}", path);
+				}
+			}
+
+			if (bitmap.empty() && larger)
+				bitmap = Downsample(*larger);
+
+			if (bitmap.empty())
+				continue;
+
+			entries.push_back({ .m_Icon = uint8_t(icon), .m_Size = *size });
+			larger = &bitmaps.emplace_back(std::move(bitmap));
+		}
+	}
+
+	IconSheet sheet;
+	if (entries.empty())
+		return sheet;
+
+	// Rows of the same size, biggest rows first
+	std::vector<size_t> order(entries.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return entries[a].m_Size > entries[b].m_Size; });
+
+	uint16_t x = 0, y = 0, rowHeight = 0;
+	for (size_t i : order)
+	{
+		auto& entry = entries[i];
+		const uint16_t cellSize = entry.m_Size + ICON_PADDING * 2;
+		if (x + cellSize > ICON_SHEET_WIDTH)
+		{
+			x = 0;
+			y += rowHeight;
+			rowHeight = 0;
+		}
+
+		entry.m_X = x + ICON_PADDING;
+		entry.m_Y = y + ICON_PADDING;
+		x += cellSize;
+		rowHeight = std::max(rowHeight, cellSize);
+	}
+
+	sheet.m_Bitmap = Bitmap(ICON_SHEET_WIDTH, y + rowHeight, 4);
+	std::memset(sheet.m_Bitmap.GetData(), 0, sheet.m_Bitmap.GetDataSize());
+
+	auto* dst = static_cast<uint8_t*>(sheet.m_Bitmap.GetData());
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const auto& entry = entries[i];
+		const auto* src = static_cast<const uint8_t*>(bitmaps[i].GetData());
+		for (uint16_t row = 0; row < entry.m_Size; row++)
+		{
+			std::memcpy(dst + (size_t(entry.m_Y + row) * ICON_SHEET_WIDTH + entry.m_X) * 4,
+				src + size_t(row) * entry.m_Size * 4, size_t(entry.m_Size) * 4);
+		}
 	}
 
-	return nullptr;
+	sheet.m_Entries = std::move(entries);
+	return sheet;
 }
@@ -14,8 +14,10 @@ namespace tf2_bot_detector
 
 		static std::unique_ptr<IBaseTextures> Create(ITextureManager& textureManager);
 
-		virtual const ITexture* GetHeart_16() const = 0;
-		virtual const ITexture* GetVACShield_16() const = 0;
-		virtual const ITexture* GetGameBanIcon_16() const = 0;
+		// The closest size there is to being drawn pixelSize pixels across, without going under it if
+		// anything is that big. Scale 16 by the UI scale for the size they used to always be.
+		virtual const ITexture* GetHeart(float pixelSize) const = 0;
+		virtual const ITexture* GetVACShield(float pixelSize) const = 0;
+		virtual const ITexture* GetGameBanIcon(float pixelSize) const = 0;
 	};
 }
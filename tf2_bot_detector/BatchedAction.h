@@ -2,13 +2,30 @@
 
 #include "Clock.h"
 #include "Log.h"
+#include "Util/MPSCQueue.h"
 
+#include <algorithm>
 #include <mutex>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace tf2_bot_detector
 {
-	template<typename TState, typename TItem, typename TResponse>
+	enum class BatchPriority
+	{
+		Prefetch, // Data we expect to need soon, but nobody is waiting on yet
+		Refresh,  // Retries and re-fetches of data we already had
+		New,      // Someone is waiting on this (newly connected players)
+	};
+
+	// Coalesces queued items into batched requests. A batch goes out as soon as MAX_BATCH_SIZE
+	// items are waiting, or COALESCE_WINDOW after the first one was queued. Up to
+	// MAX_CONCURRENT_BATCHES can be in flight, no more often than once per MIN_SEND_INTERVAL.
+	//
+	// Queue() never waits on Update(): items go into a lock-free queue that Update() drains, and
+	// responses are applied without holding the lock the other calls take.
+	template<typename TState, typename TItem, typename TResponse, size_t TMaxBatchSize = 100>
 	class BatchedAction
 	{
 	public:
@@ -17,56 +34,90 @@ namespace tf2_bot_detector
 		using response_type = TResponse;
 		using response_future_type = mh::task<response_type>;
 
+		static constexpr size_t MAX_BATCH_SIZE = TMaxBatchSize;
+		static constexpr size_t MAX_CONCURRENT_BATCHES = 3;
+		static constexpr duration_t COALESCE_WINDOW = std::chrono::milliseconds(250);
+		static constexpr duration_t MIN_SEND_INTERVAL = std::chrono::milliseconds(250);
+		static constexpr duration_t RETRY_DELAY = std::chrono::seconds(5);
+		static constexpr size_t MAX_PENDING_ITEMS = 256; // Queue() only takes the lock if more than this haven't been drained yet
+
 		BatchedAction() = default;
 		BatchedAction(const TState& state) : m_State(state) {}
 		BatchedAction(TState&& state) : m_State(std::move(state)) {}
 
-		bool IsQueued(const TItem& item) const
+		bool IsQueued(const TItem& item)
 		{
 			std::lock_guard lock(m_Mutex);
-			return m_Queued.contains(item);
+			DrainPending();
+			return m_Queued.contains(item) || IsInFlight(item);
 		}
 
-		void Queue(TItem&& item)
+		// Safe to call from any thread, including from inside SendRequest and OnDataReady
+		void Queue(TItem item, BatchPriority priority = BatchPriority::New)
 		{
+			PendingItem pending{ std::move(item), priority, clock_t::now() + COALESCE_WINDOW };
+			if (m_Pending.try_push(pending))
+				return;
+
+			// Nobody has drained it in a while, so Update() isn't holding things up anyway
 			std::lock_guard lock(m_Mutex);
-			m_Queued.insert(std::move(item));
+			DrainPending();
+			if (!IsInFlight(pending.m_Item))
+				QueueImpl(std::move(pending.m_Item), pending.m_Priority, pending.m_ReadyTime);
 		}
-		void Queue(const TItem& item)
+
+		// Raises an item that is still waiting to be sent at exactly the from priority, leaving
+		// anything else (including items that aren't queued at all) alone
+		void Promote(const TItem& item, BatchPriority from, BatchPriority to)
 		{
 			std::lock_guard lock(m_Mutex);
-			m_Queued.insert(item);
+			DrainPending();
+			if (auto found = m_Queued.find(item); found != m_Queued.end() && found->second.m_Priority == from)
+				found->second.m_Priority = to;
 		}
 
-		void Update()
+		// Drops an item that's still waiting to be sent. Returns false if it wasn't queued, or is
+		// already in flight.
+		bool Remove(const TItem& item)
 		{
-			std::invoke([&]
-				{
-					if (m_Queued.empty())
-						return;
+			std::lock_guard lock(m_Mutex);
+			DrainPending();
+			return m_Queued.erase(item) > 0;
+		}
 
-					if (m_ResponseFuture.valid())
-						return;
+		void Update()
+		{
+			const auto curTime = FrameClock::Now();
 
-					const auto curTime = clock_t::now();
-					if (curTime < (m_LastUpdate + MIN_INTERVAL))
-						return;
+			std::vector<InFlightBatch> finished;
+			{
+				std::lock_guard lock(m_Mutex);
+				DrainPending();
 
-					m_LastUpdate = curTime;
+				for (auto it = m_InFlight.begin(); it != m_InFlight.end(); )
+				{
+					if (!it->m_ResponseFuture.is_ready())
+					{
+						++it;
+						continue;
+					}
 
-					m_ResponseFuture = SendRequest(m_State, m_Queued);
-				});
+					// Still counts as in flight until it's been applied
+					m_Applying.insert(it->m_Items.begin(), it->m_Items.end());
+					finished.push_back(std::move(*it));
+					it = m_InFlight.erase(it);
+				}
+			}
 
-			if (m_ResponseFuture.is_ready())
+			for (InFlightBatch& batch : finished)
 			{
-				std::lock_guard lock(m_Mutex);
 				try
 				{
-					const auto& response = m_ResponseFuture.get();
+					const auto& response = batch.m_ResponseFuture.get();
 
 					try
 					{
-						OnDataReady(m_State, response, m_Queued);
+						OnDataReady(m_State, response, batch.m_Items);
 					}
 					catch (const std::exception& e)
 					{
@@ -77,21 +128,141 @@ namespace tf2_bot_detector
 				{
 					LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to get batched action future");
 				}
+			}
 
-				m_ResponseFuture = {};
+			std::lock_guard lock(m_Mutex);
+			m_Applying.clear();
+
+			// Anything OnDataReady didn't take out of the batch gets another try later
+			for (const InFlightBatch& batch : finished)
+			{
+				for (const TItem& item : batch.m_Items)
+					QueueImpl(item, BatchPriority::Refresh, curTime + RETRY_DELAY);
+			}
+
+			while (m_InFlight.size() < MAX_CONCURRENT_BATCHES && curTime >= (m_LastSendTime + MIN_SEND_INTERVAL))
+			{
+				if (m_Queued.empty())
+					break;
+				if (m_Queued.size() < MAX_BATCH_SIZE && curTime < m_NextReadyTime)
+					break;
+
+				queue_collection_type batch = TakeBatch();
+				m_LastSendTime = curTime;
+
+				response_future_type future = SendRequest(m_State, batch);
+				if (!future.valid())
+				{
+					// Nothing to send it with right now
+					for (const TItem& item : batch)
+						QueueImpl(item, BatchPriority::Refresh, curTime + RETRY_DELAY);
+
+					break;
+				}
+
+				m_InFlight.push_back({ std::move(batch), std::move(future) });
 			}
 		}
 
 	protected:
-		virtual response_future_type SendRequest(state_type& state, queue_collection_type& collection) = 0;
+		// collection holds at most MAX_BATCH_SIZE items
+		virtual response_future_type SendRequest(state_type& state, const queue_collection_type& collection) = 0;
+
+		// Erase everything that was handled from collection, whatever is left is queued again
 		virtual void OnDataReady(state_type& state, const response_type& response, queue_collection_type& collection) = 0;
 
 	private:
-		static constexpr duration_t MIN_INTERVAL = std::chrono::seconds(5);
+		struct QueuedItem
+		{
+			BatchPriority m_Priority;
+			time_point_t m_ReadyTime;
+		};
+
+		struct InFlightBatch
+		{
+			queue_collection_type m_Items;
+			response_future_type m_ResponseFuture;
+		};
+
+		struct PendingItem
+		{
+			TItem m_Item{};
+			BatchPriority m_Priority{};
+			time_point_t m_ReadyTime{};
+		};
+
+		bool IsInFlight(const TItem& item) const
+		{
+			return m_Applying.contains(item) || std::any_of(m_InFlight.begin(), m_InFlight.end(),
+				[&](const InFlightBatch& batch) { return batch.m_Items.contains(item); });
+		}
+
+		// Only with m_Mutex held, which is what keeps there being a single consumer. Anything queued
+		// while it was in flight was already taken care of by that batch.
+		void DrainPending()
+		{
+			while (auto pending = m_Pending.try_pop())
+			{
+				if (!IsInFlight(pending->m_Item))
+					QueueImpl(std::move(pending->m_Item), pending->m_Priority, pending->m_ReadyTime);
+			}
+		}
+
+		void QueueImpl(TItem item, BatchPriority priority, time_point_t readyTime)
+		{
+			auto [it, inserted] = m_Queued.try_emplace(std::move(item), QueuedItem{ priority, readyTime });
+			if (!inserted)
+			{
+				it->second.m_Priority = std::max(it->second.m_Priority, priority);
+				it->second.m_ReadyTime = std::min(it->second.m_ReadyTime, readyTime);
+			}
+
+			m_NextReadyTime = std::min(m_NextReadyTime, it->second.m_ReadyTime);
+		}
+
+		// Takes the most important items out of the queue. Items that aren't due yet still ride along
+		// if there's room, since we're making the request anyway.
+		queue_collection_type TakeBatch()
+		{
+			using queued_iterator = typename decltype(m_Queued)::iterator;
+			std::vector<queued_iterator> candidates;
+			candidates.reserve(m_Queued.size());
+			for (auto it = m_Queued.begin(); it != m_Queued.end(); ++it)
+				candidates.push_back(it);
+
+			const auto batchSize = std::min(candidates.size(), MAX_BATCH_SIZE);
+			std::partial_sort(candidates.begin(), candidates.begin() + batchSize, candidates.end(),
+				[](const queued_iterator& lhs, const queued_iterator& rhs)
+				{
+					if (lhs->second.m_Priority != rhs->second.m_Priority)
+						return lhs->second.m_Priority > rhs->second.m_Priority;
+
+					return lhs->second.m_ReadyTime < rhs->second.m_ReadyTime;
+				});
+
+			queue_collection_type batch;
+			for (size_t i = 0; i < batchSize; i++)
+			{
+				batch.insert(candidates[i]->first);
+				m_Queued.erase(candidates[i]);
+			}
+
+			m_NextReadyTime = time_point_t::max();
+			for (const auto& [item, queued] : m_Queued)
+				m_NextReadyTime = std::min(m_NextReadyTime, queued.m_ReadyTime);
+
+			return batch;
+		}
+
 		state_type m_State{};
-		std::recursive_mutex m_Mutex;
-		queue_collection_type m_Queued;
-		response_future_type m_ResponseFuture;
-		time_point_t m_LastUpdate{};
+		mutable std::recursive_mutex m_Mutex;
+
+		MPSCQueue<PendingItem, MAX_PENDING_ITEMS> m_Pending; // Drained into m_Queued by whoever holds m_Mutex next
+		std::unordered_map<TItem, QueuedItem> m_Queued;
+		time_point_t m_NextReadyTime = time_point_t::max();
+
+		std::vector<InFlightBatch> m_InFlight;
+		queue_collection_type m_Applying; // Items of finished batches, while OnDataReady runs
+		time_point_t m_LastSendTime{};
 	};
 }
@@ -2,6 +2,21 @@
 
 #include <mh/text/string_insertion.hpp>
 
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TF2BD_BITMAP_SSE2 1
+#include <emmintrin.h>
+#else
+#define TF2BD_BITMAP_SSE2 0
+#endif
+
 #define STBI_FAILURE_USERMSG 1
 #define STB_IMAGE_IMPLEMENTATION 1
 #include <stb_image.h>
@@ -9,6 +24,183 @@
 using namespace tf2_bot_detector;
 using namespace std::string_literals;
 
+namespace
+{
+#if TF2BD_BITMAP_SSE2
+	__m128i LoadU32(const uint8_t* data)
+	{
+		int value;
+		std::memcpy(&value, data, sizeof(value));
+		return _mm_cvtsi32_si128(value);
+	}
+
+	void StoreU32(uint8_t* data, __m128i value)
+	{
+		const int result = _mm_cvtsi128_si32(value);
+		std::memcpy(data, &result, sizeof(result));
+	}
+#endif
+
+	// Which source pixels every destination pixel along one axis covers, [m_First, m_Last)
+	struct BoxSpan
+	{
+		uint32_t m_First;
+		uint32_t m_Last;
+	};
+	std::vector<BoxSpan> GetBoxSpans(uint32_t srcSize, uint32_t dstSize)
+	{
+		std::vector<BoxSpan> spans(dstSize);
+		for (uint32_t i = 0; i < dstSize; i++)
+		{
+			spans[i].m_First = uint32_t(uint64_t(i) * srcSize / dstSize);
+			spans[i].m_Last = uint32_t(uint64_t(i + 1) * srcSize / dstSize);
+		}
+
+		return spans;
+	}
+
+	void BoxDownscale(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight,
+		uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, uint8_t channels)
+	{
+		const auto columns = GetBoxSpans(srcWidth, dstWidth);
+		const auto rows = GetBoxSpans(srcHeight, dstHeight);
+
+		std::vector<uint32_t> sums(size_t(dstWidth) * channels);
+		for (uint32_t y = 0; y < dstHeight; y++)
+		{
+			std::fill(sums.begin(), sums.end(), 0);
+
+			for (uint32_t sy = rows[y].m_First; sy < rows[y].m_Last; sy++)
+			{
+				const uint8_t* row = src + size_t(sy) * srcWidth * channels;
+				for (uint32_t x = 0; x < dstWidth; x++)
+				{
+					uint32_t* sum = sums.data() + size_t(x) * channels;
+					const uint8_t* in = row + size_t(columns[x].m_First) * channels;
+					const uint8_t* end = row + size_t(columns[x].m_Last) * channels;
+
+#if TF2BD_BITMAP_SSE2
+					if (channels == 4)
+					{
+						const __m128i zero = _mm_setzero_si128();
+						__m128i acc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sum));
+						for (; in < end; in += 4)
+							acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(_mm_unpacklo_epi8(LoadU32(in), zero), zero));
+
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(sum), acc);
+						continue;
+					}
+#endif
+
+					for (; in < end; in += channels)
+					{
+						for (uint8_t c = 0; c < channels; c++)
+							sum[c] += in[c];
+					}
+				}
+			}
+
+			uint8_t* out = dst + size_t(y) * dstWidth * channels;
+			const uint32_t rowCount = rows[y].m_Last - rows[y].m_First;
+			for (uint32_t x = 0; x < dstWidth; x++)
+			{
+				const uint32_t count = rowCount * (columns[x].m_Last - columns[x].m_First);
+				for (uint8_t c = 0; c < channels; c++)
+				{
+					const uint32_t sum = sums[size_t(x) * channels + c];
+					*out++ = uint8_t((sum + count / 2) / count);
+				}
+			}
+		}
+	}
+
+	// The two source pixels a destination pixel falls between along one axis, and how much of the
+	// second one it gets, out of 256. Pixel centers line up, so the image doesn't shift.
+	struct BilinearTap
+	{
+		uint32_t m_First;
+		uint32_t m_Second;
+		uint16_t m_Weight;
+	};
+	std::vector<BilinearTap> GetBilinearTaps(uint32_t srcSize, uint32_t dstSize)
+	{
+		std::vector<BilinearTap> taps(dstSize);
+		for (uint32_t i = 0; i < dstSize; i++)
+		{
+			const float pos = std::clamp((i + 0.5f) * srcSize / dstSize - 0.5f, 0.0f, float(srcSize - 1));
+			const auto first = uint32_t(pos);
+			taps[i] = { first, std::min(first + 1, srcSize - 1), uint16_t((pos - first) * 256 + 0.5f) };
+		}
+
+		return taps;
+	}
+
+	// Both paths round the same way after each axis, so they give the same result
+	void BilinearResize(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight,
+		uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, uint8_t channels)
+	{
+		const auto columns = GetBilinearTaps(srcWidth, dstWidth);
+		const auto rows = GetBilinearTaps(srcHeight, dstHeight);
+		const size_t srcStride = size_t(srcWidth) * channels;
+
+		for (uint32_t y = 0; y < dstHeight; y++)
+		{
+			const uint8_t* top = src + rows[y].m_First * srcStride;
+			const uint8_t* bottom = src + rows[y].m_Second * srcStride;
+			const uint16_t wy = rows[y].m_Weight;
+			uint8_t* out = dst + size_t(y) * dstWidth * channels;
+
+#if TF2BD_BITMAP_SSE2
+			if (channels == 4)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i rounding = _mm_set1_epi16(128);
+				const __m128i topWeight = _mm_set1_epi16(short(256 - wy));
+				const __m128i bottomWeight = _mm_set1_epi16(short(wy));
+
+				// Sums of two products out of 256 never go past 255 * 256, so they fit unsigned in 16 bits
+				const auto Horizontal = [&](const uint8_t* row, const BilinearTap& tap, const __m128i& weights)
+				{
+					const __m128i pixels = _mm_unpacklo_epi8(_mm_unpacklo_epi32(
+						LoadU32(row + size_t(tap.m_First) * 4), LoadU32(row + size_t(tap.m_Second) * 4)), zero);
+					const __m128i products = _mm_mullo_epi16(pixels, weights);
+					const __m128i sum = _mm_add_epi16(products, _mm_srli_si128(products, 8));
+					return _mm_srli_epi16(_mm_add_epi16(sum, rounding), 8);
+				};
+
+				for (uint32_t x = 0; x < dstWidth; x++, out += 4)
+				{
+					const auto wx = short(columns[x].m_Weight);
+					const auto invWx = short(256 - wx);
+					const __m128i weights = _mm_set_epi16(wx, wx, wx, wx, invWx, invWx, invWx, invWx);
+
+					const __m128i blended = _mm_add_epi16(
+						_mm_mullo_epi16(Horizontal(top, columns[x], weights), topWeight),
+						_mm_mullo_epi16(Horizontal(bottom, columns[x], weights), bottomWeight));
+					const __m128i result = _mm_srli_epi16(_mm_add_epi16(blended, rounding), 8);
+					StoreU32(out, _mm_packus_epi16(result, zero));
+				}
+
+				continue;
+			}
+#endif
+
+			for (uint32_t x = 0; x < dstWidth; x++)
+			{
+				const uint16_t wx = columns[x].m_Weight;
+				const size_t first = size_t(columns[x].m_First) * channels;
+				const size_t second = size_t(columns[x].m_Second) * channels;
+				for (uint8_t c = 0; c < channels; c++)
+				{
+					const uint32_t topValue = (top[first + c] * (256u - wx) + top[second + c] * wx + 128) >> 8;
+					const uint32_t bottomValue = (bottom[first + c] * (256u - wx) + bottom[second + c] * wx + 128) >> 8;
+					*out++ = uint8_t((topValue * (256u - wy) + bottomValue * wy + 128) >> 8);
+				}
+			}
+		}
+	}
+}
+
 void Bitmap::Deleter::operator()(void* ptr) const
 {
 	stbi_image_free(ptr);
@@ -24,6 +216,17 @@ Bitmap::Bitmap(const std::filesystem::path& path, uint8_t desiredChannels)
 	LoadFile(path, desiredChannels);
 }
 
+Bitmap::Bitmap(uint32_t width, uint32_t height, uint8_t channels) :
+	// stb_image allocates with (and Deleter frees with) the C runtime's malloc/free
+	m_Image(reinterpret_cast<std::byte*>(std::malloc(size_t(width) * height * channels))),
+	m_Width(width),
+	m_Height(height),
+	m_Channels(channels)
+{
+	if (!m_Image)
+		throw std::bad_alloc();
+}
+
 void Bitmap::LoadFile(const std::filesystem::path& path)
 {
 	return LoadFile(path, 0);
@@ -37,8 +240,138 @@ void Bitmap::LoadFile(const std::filesystem::path& path, uint8_t desiredChannels
 
 	m_Width = width;
 	m_Height = height;
-	m_Channels = channels;
+	m_Channels = desiredChannels ? desiredChannels : channels;
 
 	if (!m_Image)
 		throw std::runtime_error("Failed to load image from "s << path << ": " << stbi_failure_reason());
 }
+
+void Bitmap::LoadMemory(const void* data, size_t size, uint8_t desiredChannels)
+{
+	int width, height, channels;
+	m_Image.reset(reinterpret_cast<std::byte*>(stbi_load_from_memory(
+		reinterpret_cast<const stbi_uc*>(data), int(size), &width, &height, &channels, desiredChannels)));
+
+	if (!m_Image)
+		throw std::runtime_error("Failed to decode image from memory: "s << stbi_failure_reason());
+
+	m_Width = width;
+	m_Height = height;
+	m_Channels = desiredChannels ? desiredChannels : channels;
+}
+
+void Bitmap::ConvertPixels(const void* srcData, uint8_t srcChannels, void* dstData, uint8_t dstChannels, size_t pixelCount)
+{
+	assert(srcChannels >= 1 && srcChannels <= 4);
+	assert(dstChannels >= 1 && dstChannels <= 4);
+
+	const auto* src = static_cast<const uint8_t*>(srcData);
+	auto* dst = static_cast<uint8_t*>(dstData);
+
+	if (srcChannels == dstChannels)
+	{
+		std::memcpy(dst, src, pixelCount * srcChannels);
+		return;
+	}
+
+	size_t i = 0;
+
+#if TF2BD_BITMAP_SSE2
+	const __m128i opaque = _mm_set1_epi32(int(0xFF000000));
+	if (srcChannels == 3 && dstChannels == 4)
+	{
+		// No byte shuffles in SSE2, so every pixel is loaded as 4 bytes (with the first one of the
+		// next pixel) and the extra byte is replaced with the alpha. Stops before the last pixel,
+		// whose load would go past the end.
+		for (; (i + 4) < pixelCount; i += 4)
+		{
+			const uint8_t* in = src + i * 3;
+			const __m128i pixels = _mm_unpacklo_epi64(
+				_mm_unpacklo_epi32(LoadU32(in), LoadU32(in + 3)),
+				_mm_unpacklo_epi32(LoadU32(in + 6), LoadU32(in + 9)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(pixels, opaque));
+		}
+	}
+	else if (srcChannels == 1 && dstChannels == 4)
+	{
+		for (; (i + 16) <= pixelCount; i += 16)
+		{
+			const __m128i gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			const __m128i lo = _mm_unpacklo_epi8(gray, gray);
+			const __m128i hi = _mm_unpackhi_epi8(gray, gray);
+
+			auto* out = reinterpret_cast<__m128i*>(dst + i * 4);
+			_mm_storeu_si128(out + 0, _mm_or_si128(_mm_unpacklo_epi16(lo, lo), opaque));
+			_mm_storeu_si128(out + 1, _mm_or_si128(_mm_unpackhi_epi16(lo, lo), opaque));
+			_mm_storeu_si128(out + 2, _mm_or_si128(_mm_unpacklo_epi16(hi, hi), opaque));
+			_mm_storeu_si128(out + 3, _mm_or_si128(_mm_unpackhi_epi16(hi, hi), opaque));
+		}
+	}
+#endif
+
+	const bool srcGray = srcChannels <= 2;
+	const bool srcAlpha = srcChannels == 2 || srcChannels == 4;
+	for (; i < pixelCount; i++)
+	{
+		const uint8_t* in = src + i * srcChannels;
+		uint8_t* out = dst + i * dstChannels;
+
+		const uint8_t r = in[0];
+		const uint8_t g = srcGray ? in[0] : in[1];
+		const uint8_t b = srcGray ? in[0] : in[2];
+		const uint8_t a = srcAlpha ? in[srcChannels - 1] : 255;
+
+		switch (dstChannels)
+		{
+		case 1:
+			out[0] = r;
+			break;
+		case 2:
+			out[0] = r;
+			out[1] = a;
+			break;
+		case 3:
+			out[0] = r;
+			out[1] = g;
+			out[2] = b;
+			break;
+		case 4:
+			out[0] = r;
+			out[1] = g;
+			out[2] = b;
+			out[3] = a;
+			break;
+		}
+	}
+}
+
+Bitmap Bitmap::ConvertChannels(uint8_t channels) const
+{
+	if (empty())
+		return {};
+
+	Bitmap retVal(m_Width, m_Height, channels);
+	ConvertPixels(GetData(), m_Channels, retVal.GetData(), channels, size_t(m_Width) * m_Height);
+	return retVal;
+}
+
+Bitmap Bitmap::Resize(uint32_t width, uint32_t height) const
+{
+	if (width == 0 || height == 0)
+		throw std::invalid_argument("Can't resize a bitmap to nothing");
+	if (empty())
+		return {};
+
+	Bitmap retVal(width, height, m_Channels);
+
+	const auto* src = static_cast<const uint8_t*>(GetData());
+	auto* dst = static_cast<uint8_t*>(retVal.GetData());
+	if (width == m_Width && height == m_Height)
+		std::memcpy(dst, src, GetDataSize());
+	else if ((width * 2) <= m_Width && (height * 2) <= m_Height)
+		BoxDownscale(src, m_Width, m_Height, dst, width, height, m_Channels);
+	else
+		BilinearResize(src, m_Width, m_Height, dst, width, height, m_Channels);
+
+	return retVal;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <filesystem>
 
@@ -12,16 +13,34 @@ namespace tf2_bot_detector
 		Bitmap(const std::filesystem::path& path);
 		Bitmap(const std::filesystem::path& path, uint8_t desiredChannels);
 
+		// Uninitialized pixels, to be filled in through GetData()
+		Bitmap(uint32_t width, uint32_t height, uint8_t channels);
+
 		void LoadFile(const std::filesystem::path& path);
 		void LoadFile(const std::filesystem::path& path, uint8_t desiredChannels);
 
+		// Decodes an image file that has already been read into memory
+		void LoadMemory(const void* data, size_t size, uint8_t desiredChannels = 0);
+
+		void* GetData() { return m_Image.get(); }
 		const void* GetData() const { return m_Image.get(); }
+		size_t GetDataSize() const { return size_t(m_Width) * m_Height * m_Channels; }
 		uint32_t GetHeight() const { return m_Height; }
 		uint32_t GetWidth() const { return m_Width; }
 		uint8_t GetChannelCount() const { return m_Channels; }
 
 		bool empty() const { return !m_Image; }
 
+		// The same pixels with a different number of channels. Adding alpha makes them opaque,
+		// 1 or 2 channels from RGB keep just the red channel. Returns a copy if nothing changes.
+		Bitmap ConvertChannels(uint8_t channels) const;
+		static void ConvertPixels(const void* src, uint8_t srcChannels, void* dst, uint8_t dstChannels, size_t pixelCount);
+
+		// Averages every pixel under each new one (box filter) when shrinking to half the size or
+		// less, bilinear otherwise. Alpha isn't premultiplied, so it's only good for opaque images
+		// or ones without hard transparent edges.
+		Bitmap Resize(uint32_t width, uint32_t height) const;
+
 	private:
 		struct Deleter final
 		{
@@ -2,8 +2,42 @@
 
 #include <mh/chrono/chrono_helpers.hpp>
 
+#include <atomic>
+
 using namespace tf2_bot_detector;
 
+static std::atomic<time_point_t::rep> s_FrameTime = 0;
+static std::atomic<std::chrono::steady_clock::rep> s_FrameSteadyTime = 0;
+
+void FrameClock::BeginFrame()
+{
+	s_FrameTime.store(tfbd_clock_t::now().time_since_epoch().count(), std::memory_order_relaxed);
+	s_FrameSteadyTime.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+void FrameClock::BeginFrame(time_point_t now, std::chrono::steady_clock::time_point steadyNow)
+{
+	s_FrameTime.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+	s_FrameSteadyTime.store(steadyNow.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+time_point_t FrameClock::Now()
+{
+	if (const auto rep = s_FrameTime.load(std::memory_order_relaxed))
+		return time_point_t(duration_t(rep));
+
+	return tfbd_clock_t::now();
+}
+
+std::chrono::steady_clock::time_point FrameClock::SteadyNow()
+{
+	using steady_clock = std::chrono::steady_clock;
+	if (const auto rep = s_FrameSteadyTime.load(std::memory_order_relaxed))
+		return steady_clock::time_point(steady_clock::duration(rep));
+
+	return steady_clock::now();
+}
+
 tm tf2_bot_detector::ToTM(const time_point_t& ts)
 {
 	return mh::chrono::to_tm(ts, mh::chrono::time_zone::local);
@@ -52,6 +52,23 @@ namespace tf2_bot_detector
 			return ret_t(floored + roundDuration);
 	}
 
+	// The time at the start of the current frame, so everything that runs as part of a frame on the
+	// main thread agrees on what time it is without asking the OS each time. Safe to read from any
+	// thread, but only the main thread calls BeginFrame(). Use tfbd_clock_t::now() for timing work
+	// within a frame, or anything that can happen between frames.
+	class FrameClock final
+	{
+	public:
+		static void BeginFrame();
+
+		// For replays, where it's whatever time it was in the recording instead
+		static void BeginFrame(time_point_t now, std::chrono::steady_clock::time_point steadyNow);
+
+		// tfbd_clock_t::now() until the first BeginFrame()
+		static time_point_t Now();
+		static std::chrono::steady_clock::time_point SteadyNow();
+	};
+
 	tm ToTM(const time_point_t& ts);
 	tm GetLocalTM();
 	time_point_t GetLocalTimePoint();
@@ -7,11 +7,15 @@ using namespace std::chrono_literals;
 using namespace tf2_bot_detector;
 
 void CompensatedTS::SetRecorded(time_point_t recorded)
+{
+	SetRecorded(recorded, clock_t::now());
+}
+
+void CompensatedTS::SetRecorded(time_point_t recorded, time_point_t now)
 {
 	assert(recorded.time_since_epoch() > 0s);
 	m_Recorded = recorded;
 
-	const auto now = clock_t::now();
 	if (m_Snapshot && (now - *m_Snapshot) >= 1s)
 		m_Snapshot.reset();
 
@@ -15,6 +15,7 @@ namespace tf2_bot_detector
 		void InvalidateRecorded() { m_Recorded.reset(); }
 		bool IsRecordedValid() const { return m_Recorded.has_value(); }
 		void SetRecorded(time_point_t recorded);
+		void SetRecorded(time_point_t recorded, time_point_t now); // Lets callers share one clock_t::now() across many lines
 
 		void Snapshot();
 		bool IsSnapshotValid() const { return m_Snapshot.has_value(); }
@@ -10,7 +10,10 @@
 #include <mh/source_location.hpp>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <iterator>
+#include <vector>
 
 using namespace tf2_bot_detector;
 
@@ -30,6 +33,20 @@ namespace
 
 	private:
 		[[nodiscard]] bool CheckSteamIDValid(const SteamID& id, MH_SOURCE_LOCATION_AUTO(location)) const;
+
+		struct KnownAge
+		{
+			uint32_t m_AccountID;
+			time_point_t m_CreationTime;
+		};
+
+		// Every creation time we know of, sorted by account ID, so estimates don't touch the temp db.
+		// Loaded the first time it's needed, then kept up to date by OnDataReady.
+		const std::vector<KnownAge>& GetKnownAges() const;
+		void InsertKnownAge(uint32_t accountID, time_point_t creationTime);
+		mutable std::vector<KnownAge> m_KnownAges;
+		mutable bool m_KnownAgesLoaded = false;
+		mh::thread_sentinel m_Sentinel;
 	};
 
 	static const std::filesystem::path ACCOUNT_AGES_FILENAME = "cfg/account_ages.json";
@@ -51,11 +68,68 @@ bool AccountAges::CheckSteamIDValid(const SteamID& id, const mh::source_location
 	return true;
 }
 
+const std::vector<AccountAges::KnownAge>& AccountAges::GetKnownAges() const
+{
+	m_Sentinel.check();
+
+	if (!m_KnownAgesLoaded)
+	{
+		m_KnownAgesLoaded = true;
+
+		std::vector<DB::AccountAgeInfo> infos;
+		try
+		{
+			TF2BDApplication::GetApplication().GetTempDB().GetAccountAgeInfos(infos);
+		}
+		catch (...)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to load known account ages");
+		}
+
+		// Anything already added by OnDataReady is newer than what's in the db
+		std::vector<KnownAge> knownAges;
+		knownAges.reserve(infos.size() + m_KnownAges.size());
+		for (const auto& info : infos)
+			knownAges.push_back({ info.m_SteamID.GetAccountID(), info.m_CreationTime });
+		knownAges.insert(knownAges.end(), m_KnownAges.begin(), m_KnownAges.end());
+
+		// Stable, so the last of any duplicates is still the newest
+		std::stable_sort(knownAges.begin(), knownAges.end(),
+			[](const KnownAge& lhs, const KnownAge& rhs) { return lhs.m_AccountID < rhs.m_AccountID; });
+
+		const auto newBegin = std::unique(knownAges.rbegin(), knownAges.rend(),
+			[](const KnownAge& lhs, const KnownAge& rhs) { return lhs.m_AccountID == rhs.m_AccountID; });
+		knownAges.erase(knownAges.begin(), newBegin.base());
+
+		m_KnownAges = std::move(knownAges);
+		DebugLog("Loaded {} known account ages", m_KnownAges.size());
+	}
+
+	return m_KnownAges;
+}
+
+void AccountAges::InsertKnownAge(uint32_t accountID, time_point_t creationTime)
+{
+	auto it = std::lower_bound(m_KnownAges.begin(), m_KnownAges.end(), accountID,
+		[](const KnownAge& age, uint32_t value) { return age.m_AccountID < value; });
+
+	if (it != m_KnownAges.end() && it->m_AccountID == accountID)
+		it->m_CreationTime = creationTime;
+	else
+		m_KnownAges.insert(it, { accountID, creationTime });
+}
+
 void AccountAges::OnDataReady(const SteamID& id, time_point_t creationTime)
 {
 	if (!CheckSteamIDValid(id))
 		return;
 
+	m_Sentinel.check();
+	if (m_KnownAgesLoaded)
+		InsertKnownAge(id.GetAccountID(), creationTime);
+	else
+		m_KnownAges.push_back({ id.GetAccountID(), creationTime }); // Merged in by GetKnownAges
+
 	DB::ITempDB& tempDB = TF2BDApplication::GetApplication().GetTempDB();
 	DB::AccountAgeInfo info{};
 	info.m_SteamID = id;
@@ -68,20 +142,27 @@ std::optional<time_point_t> AccountAges::EstimateAccountCreationTime(const Steam
 	if (!CheckSteamIDValid(id))
 		return std::nullopt;
 
-	std::optional<DB::AccountAgeInfo> lower, upper;
-	TF2BDApplication::GetApplication().GetTempDB().GetNearestAccountAgeInfos(id, lower, upper);
+	const auto& knownAges = GetKnownAges();
+	const uint32_t accountID = id.GetAccountID();
+
+	// First known account at or above this one
+	const auto upper = std::lower_bound(knownAges.begin(), knownAges.end(), accountID,
+		[](const KnownAge& age, uint32_t value) { return age.m_AccountID < value; });
 
-	if (!lower.has_value())
+	if (upper != knownAges.end() && upper->m_AccountID == accountID)
+		return upper->m_CreationTime;
+	if (upper == knownAges.begin())
 		return std::nullopt;   // super new, we don't have any data for this
-	if (!upper.has_value())
-		return lower.value().m_CreationTime;  // Nothing to interpolate to, pick the lower value
+
+	const auto lower = std::prev(upper);
+	if (upper == knownAges.end())
+		return lower->m_CreationTime;  // Nothing to interpolate to, pick the lower value
 
 	if (lower->m_CreationTime == upper->m_CreationTime)
 		return lower->m_CreationTime;  // they're the same picture
 
 	// Interpolate the time between the nearest lower and upper steam ID
-	const auto interpValue = mh::remap(id.GetAccountID(),
-		lower->m_SteamID.GetAccountID(), upper->m_SteamID.GetAccountID(),
+	const auto interpValue = mh::remap(accountID, lower->m_AccountID, upper->m_AccountID,
 		lower->m_CreationTime.time_since_epoch().count(), upper->m_CreationTime.time_since_epoch().count());
 
 	assert(interpValue >= 0);
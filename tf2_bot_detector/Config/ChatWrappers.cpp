@@ -3,6 +3,7 @@
 #include "ChatWrappers.h"
 #include "Util/JSONUtils.h"
 #include "Util/TextUtils.h"
+#include "Filesystem.h"
 #include "Log.h"
 
 #include <vdf_parser.hpp>
@@ -11,11 +12,14 @@
 #include <mh/text/string_insertion.hpp>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <array>
 #include <charconv>
 #include <compare>
 #include <concepts>
 #include <execution>
+#include <map>
+#include <mutex>
 #include <random>
 #include <regex>
 #include <set>
@@ -115,6 +119,45 @@ namespace tf2_bot_detector
 	};
 }
 
+namespace
+{
+	struct ChatFormatEntry
+	{
+		ChatCategory m_Category;
+		bool m_IsEnglish;
+		std::string m_Value;
+	};
+
+	using ChatFormatEntries = std::vector<ChatFormatEntry>;
+
+	// The chat format strings we pulled out of each localization file last time, so after a TF2
+	// update we only have to re-parse the (multi-megabyte) files that actually changed
+	class ChatFormatCacheFile final
+	{
+	public:
+		ChatFormatCacheFile();
+
+		std::optional<ChatFormatEntries> Find(const std::filesystem::path& path, uint64_t size, uint64_t hash);
+		void Set(const std::filesystem::path& path, uint64_t size, uint64_t hash, ChatFormatEntries entries);
+
+		// Drops any files that weren't looked up since this was loaded
+		void Save() const;
+
+	private:
+		struct File
+		{
+			uint64_t m_Size = 0;
+			uint64_t m_Hash = 0;
+			ChatFormatEntries m_Entries;
+			bool m_Used = false;
+		};
+
+		std::filesystem::path m_FileName;
+		mutable std::mutex m_Mutex;
+		std::map<std::string, File, std::less<>> m_Files;
+	};
+}
+
 static ChatWrappers::wrapper_t GenerateInvisibleCharSequence(std::mt19937& random, size_t wrapChars)
 {
 	std::uniform_int_distribution<size_t> dist(0, std::size(INVISIBLE_CHARS) - 1);
@@ -179,6 +222,58 @@ ChatWrappers::ChatWrappers(const ChatFmtStrLengths& wrapChars)
 	}
 }
 
+ChatWrappersMatcher::ChatWrappersMatcher(const ChatWrappers& wrappers) :
+	m_Wrappers(wrappers)
+{
+	m_PrefixLength = size_t(-1);
+	for (const auto& type : m_Wrappers.m_Types)
+		m_PrefixLength = std::min(m_PrefixLength, type.m_Full.m_Start.m_Narrow.size());
+
+	if (m_PrefixLength == 0)
+		return; // Every line matches something, FindCategory() falls back to testing each category
+
+	// Categories are added in order, so the first one that matches still wins if one wrapper is a prefix of another
+	for (size_t i = 0; i < m_Wrappers.m_Types.size(); i++)
+	{
+		const std::string_view start = m_Wrappers.m_Types[i].m_Full.m_Start.m_Narrow;
+		m_FirstBytes[uint8_t(start.front())] = true;
+		m_Prefixes[std::string(start.substr(0, m_PrefixLength))].push_back(ChatCategory(i));
+	}
+}
+
+std::optional<ChatCategory> ChatWrappersMatcher::FindCategory(const std::string_view& line) const
+{
+	const auto StartsWith = [&](ChatCategory category)
+	{
+		return line.starts_with(m_Wrappers.m_Types[size_t(category)].m_Full.m_Start.m_Narrow);
+	};
+
+	if (m_PrefixLength == 0)
+	{
+		for (size_t i = 0; i < m_Wrappers.m_Types.size(); i++)
+		{
+			if (StartsWith(ChatCategory(i)))
+				return ChatCategory(i);
+		}
+
+		return std::nullopt;
+	}
+
+	if (line.size() < m_PrefixLength || !m_FirstBytes[uint8_t(line.front())])
+		return std::nullopt;
+
+	if (auto found = m_Prefixes.find(line.substr(0, m_PrefixLength)); found != m_Prefixes.end())
+	{
+		for (ChatCategory category : found->second)
+		{
+			if (StartsWith(category))
+				return category;
+		}
+	}
+
+	return std::nullopt;
+}
+
 template<typename TFunc>
 static void RegexSmartReplace(std::string& str, const std::regex& regex, TFunc&& func)
 {
@@ -256,10 +351,12 @@ static bool GetChatCategory(const std::string* src, std::string_view* name, Chat
 	return true;
 }
 
-static void GetChatMsgFormats(const std::string_view& debugInfo, const std::string_view& translations, ChatFormatStrings& strings)
+static ChatFormatEntries GetChatMsgFormats(const std::string_view& debugInfo, const std::string_view& translations)
 {
 	assert(!translations.empty());
 
+	ChatFormatEntries entries;
+
 	const char* begin = translations.data();
 	const char* end = begin + translations.size();
 	std::error_code ec;
@@ -267,7 +364,7 @@ static void GetChatMsgFormats(const std::string_view& debugInfo, const std::stri
 	if (ec)
 	{
 		LogError("Failed to parse translations from "s << std::quoted(debugInfo) << ": " << ec);
-		return;
+		return entries;
 	}
 
 	if (auto tokens = parsed.childs["Tokens"])
@@ -287,9 +384,17 @@ static void GetChatMsgFormats(const std::string_view& debugInfo, const std::stri
 					std::quoted(debugInfo), std::quoted(attrib.first), mh::enum_fmt(cat));
 			}
 
-			(isEnglish ? strings.m_English : strings.m_Localized)[(int)cat] = attrib.second;
+			entries.push_back({ cat, isEnglish, attrib.second });
 		}
 	}
+
+	return entries;
+}
+
+static void ApplyChatMsgFormats(const ChatFormatEntries& entries, ChatFormatStrings& strings)
+{
+	for (const auto& entry : entries)
+		(entry.m_IsEnglish ? strings.m_English : strings.m_Localized)[(int)entry.m_Category] = entry.m_Value;
 }
 
 static void ApplyChatWrappers(const std::string_view& debugInfo, ChatCategory cat,
@@ -374,14 +479,126 @@ static std::filesystem::path FindExistingChatTranslationFile(
 	return {};
 }
 
-static ChatFormatStrings FindExistingTranslations(const std::filesystem::path& tfdir, const std::string_view& language)
+ChatFormatCacheFile::ChatFormatCacheFile() :
+	m_FileName(IFilesystem::Get().GetLocalAppDataDir() / "chat_format_cache.json")
 {
-	ChatFormatStrings retVal;
+	try
+	{
+		if (!std::filesystem::exists(m_FileName))
+			return;
 
-	for (const auto& filename : GetLocalizationFiles(tfdir, language))
-		GetChatMsgFormats(filename.string(), ToMB(ReadWideFile(filename)), retVal);
+		const auto json = nlohmann::json::parse(IFilesystem::Get().ReadFile(m_FileName));
+		for (const auto& [path, fileJson] : json.items())
+		{
+			File file;
+			fileJson.at("size").get_to(file.m_Size);
+			fileJson.at("hash").get_to(file.m_Hash);
 
-	return retVal;
+			for (const auto& entryJson : fileJson.at("entries"))
+			{
+				auto& entry = file.m_Entries.emplace_back();
+				entryJson.at("type").get_to(entry.m_Category);
+				entryJson.at("english").get_to(entry.m_IsEnglish);
+				entryJson.at("value").get_to(entry.m_Value);
+			}
+
+			m_Files.emplace(path, std::move(file));
+		}
+	}
+	catch (...)
+	{
+		// Worst case we just parse everything again
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to load {}, starting with an empty chat format cache", m_FileName);
+		m_Files.clear();
+	}
+}
+
+std::optional<ChatFormatEntries> ChatFormatCacheFile::Find(const std::filesystem::path& path, uint64_t size, uint64_t hash)
+{
+	std::lock_guard lock(m_Mutex);
+	if (auto found = m_Files.find(path.string()); found != m_Files.end())
+	{
+		found->second.m_Used = true;
+		if (found->second.m_Size == size && found->second.m_Hash == hash)
+			return found->second.m_Entries;
+	}
+
+	return std::nullopt;
+}
+
+void ChatFormatCacheFile::Set(const std::filesystem::path& path, uint64_t size, uint64_t hash, ChatFormatEntries entries)
+{
+	std::lock_guard lock(m_Mutex);
+	m_Files.insert_or_assign(path.string(), File{ size, hash, std::move(entries), true });
+}
+
+void ChatFormatCacheFile::Save() const try
+{
+	std::lock_guard lock(m_Mutex);
+
+	nlohmann::json json = nlohmann::json::object();
+	for (const auto& [path, file] : m_Files)
+	{
+		if (!file.m_Used)
+			continue;
+
+		auto& fileJson = json[path];
+		fileJson["size"] = file.m_Size;
+		fileJson["hash"] = file.m_Hash;
+
+		auto& entriesJson = fileJson["entries"] = nlohmann::json::array();
+		for (const auto& entry : file.m_Entries)
+		{
+			entriesJson.push_back(
+				{
+					{ "type", entry.m_Category },
+					{ "english", entry.m_IsEnglish },
+					{ "value", entry.m_Value },
+				});
+		}
+	}
+
+	IFilesystem::Get().WriteFile(m_FileName, json.dump(1, '\t') << '\n', PathUsage::WriteLocal);
+}
+catch (...)
+{
+	LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to save {}", m_FileName);
+}
+
+// 64-bit FNV-1a, only used to tell whether a localization file changed since we last cached it
+static uint64_t HashFileContents(const std::string_view& contents)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	for (char c : contents)
+	{
+		hash ^= uint8_t(c);
+		hash *= 0x100000001b3;
+	}
+
+	return hash;
+}
+
+static ChatFormatEntries ReadChatMsgFormats(ChatFormatCacheFile& cache, const std::filesystem::path& filename)
+{
+	const auto fileData = IFilesystem::Get().MapFile(filename);
+	const auto hash = HashFileContents(fileData);
+	if (auto cached = cache.Find(filename, fileData.size(), hash))
+		return std::move(*cached);
+
+	ChatFormatEntries entries;
+
+	// UTF-16LE, skipping the BOM
+	if (fileData.size() > sizeof(char16_t))
+	{
+		const std::u16string_view wideData(reinterpret_cast<const char16_t*>(fileData.data() + sizeof(char16_t)),
+			(fileData.size() - sizeof(char16_t)) / sizeof(char16_t));
+
+		if (!wideData.empty())
+			entries = GetChatMsgFormats(filename.string(), ToMB(wideData));
+	}
+
+	cache.Set(filename, fileData.size(), hash, entries);
+	return entries;
 }
 
 static constexpr std::string_view GetChatCategoryKey(ChatCategory cat, bool isEnglish)
@@ -659,11 +876,27 @@ ChatWrappers tf2_bot_detector::RandomizeChatWrappers(const std::filesystem::path
 	const auto outputDir = tfdir / "custom" / TF2BD_CHAT_WRAPPERS_DIR / "resource";
 	std::filesystem::create_directories(outputDir);
 
-	progress.m_MaxValue = unsigned(std::size(LANGUAGES) * 5);
+	// Every localization file for every language, in the order they override each other
+	struct LocalizationFile
+	{
+		size_t m_LanguageIndex;
+		std::filesystem::path m_Path;
+		ChatFormatEntries m_Entries;
+	};
+	std::vector<LocalizationFile> localizationFiles;
+	for (size_t i = 0; i < std::size(LANGUAGES); i++)
+	{
+		for (const auto& path : GetLocalizationFiles(tfdir, LANGUAGES[i]))
+			localizationFiles.push_back({ i, path });
+	}
+
+	progress.m_MaxValue = unsigned(localizationFiles.size() + std::size(LANGUAGES) * 3);
 	progressSource.set(progress);
 
+	std::mutex progressMutex;
 	const auto IncrementProgress = [&]
 	{
+		std::lock_guard lock(progressMutex);
 		++progress.m_Value;
 		progressSource.set(progress);
 	};
@@ -672,34 +905,43 @@ ChatWrappers tf2_bot_detector::RandomizeChatWrappers(const std::filesystem::path
 	ChatFmtStrLengths translationLengths;
 
 	{
-		std::mutex lengthsMutex;
+		ChatFormatCacheFile cache;
 
-		// Get all the existing translations
-		std::for_each(std::execution::par_unseq, std::begin(LANGUAGES), std::end(LANGUAGES),
-			[&](const std::string_view& lang)
+		// Parse the files individually rather than per language, a handful of them (tf_english.txt
+		// in particular) are much larger than the rest
+		std::for_each(std::execution::par_unseq, localizationFiles.begin(), localizationFiles.end(),
+			[&](LocalizationFile& file)
 			{
-				const size_t index = &lang - std::begin(LANGUAGES);
-				const auto& localTrans = translations[index] = FindExistingTranslations(tfdir, lang);
-
-				ChatFmtStrLengths localLengths;
-
-				for (size_t categoryIndex = 0; categoryIndex < size_t(ChatCategory::COUNT); categoryIndex++)
+				try
 				{
-					auto& len = localLengths.m_Types[categoryIndex];
-
-					if (auto& trans = localTrans.m_English[categoryIndex]; !trans.empty())
-						len = len.Max(ChatFmtStrLengths::Type(trans));
-					if (auto& trans = localTrans.m_Localized[categoryIndex]; !trans.empty())
-						len = len.Max(ChatFmtStrLengths::Type(trans));
+					file.m_Entries = ReadChatMsgFormats(cache, file.m_Path);
 				}
-
+				catch (...)
 				{
-					std::lock_guard lock(lengthsMutex);
-					translationLengths = translationLengths.Max(localLengths);
+					LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to read chat format strings from {}", file.m_Path);
 				}
 
 				IncrementProgress();
 			});
+
+		cache.Save();
+	}
+
+	// Get all the existing translations, later files overriding earlier ones
+	for (const auto& file : localizationFiles)
+		ApplyChatMsgFormats(file.m_Entries, translations[file.m_LanguageIndex]);
+
+	for (const auto& localTrans : translations)
+	{
+		for (size_t categoryIndex = 0; categoryIndex < size_t(ChatCategory::COUNT); categoryIndex++)
+		{
+			auto& len = translationLengths.m_Types[categoryIndex];
+
+			if (auto& trans = localTrans.m_English[categoryIndex]; !trans.empty())
+				len = len.Max(ChatFmtStrLengths::Type(trans));
+			if (auto& trans = localTrans.m_Localized[categoryIndex]; !trans.empty())
+				len = len.Max(ChatFmtStrLengths::Type(trans));
+		}
 	}
 
 	ChatWrappers wrappers(translationLengths);
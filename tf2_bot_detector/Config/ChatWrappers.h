@@ -9,9 +9,13 @@
 #include <cassert>
 #include <compare>
 #include <filesystem>
+#include <optional>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace tf2_bot_detector
 {
@@ -86,6 +90,8 @@ namespace tf2_bot_detector
 
 		struct WrapperPair
 		{
+			bool operator==(const WrapperPair&) const = default;
+
 			wrapper_t m_Start;
 			wrapper_t m_End;
 		};
@@ -93,6 +99,8 @@ namespace tf2_bot_detector
 
 		struct Type
 		{
+			bool operator==(const Type&) const = default;
+
 			wrapper_pair_t m_Full;
 			wrapper_pair_t m_Name;
 			wrapper_pair_t m_Message;
@@ -100,9 +108,36 @@ namespace tf2_bot_detector
 			ChatFmtStrLengths::Type GetLengths() const;
 		};
 
+		bool operator==(const ChatWrappers&) const = default;
+
 		std::array<Type, (size_t)ChatCategory::COUNT> m_Types;
 	};
 
+	// Classifies console lines by the chat wrappers they start with, using a single lookup
+	// on the first few bytes instead of testing every category in turn.
+	class ChatWrappersMatcher final
+	{
+	public:
+		explicit ChatWrappersMatcher(const ChatWrappers& wrappers);
+
+		const ChatWrappers& GetWrappers() const { return m_Wrappers; }
+
+		// Returns the category whose full start wrapper the line begins with, if any.
+		std::optional<ChatCategory> FindCategory(const std::string_view& line) const;
+
+	private:
+		struct StringHash
+		{
+			using is_transparent = void;
+			size_t operator()(const std::string_view& str) const { return std::hash<std::string_view>{}(str); }
+		};
+
+		ChatWrappers m_Wrappers;
+		size_t m_PrefixLength = 0; // Length of the shortest full start wrapper
+		std::array<bool, 256> m_FirstBytes{};
+		std::unordered_map<std::string, std::vector<ChatCategory>, StringHash, std::equal_to<>> m_Prefixes;
+	};
+
 	void to_json(nlohmann::json& j, const ChatWrappers::WrapperPair& d);
 	void from_json(const nlohmann::json& j, ChatWrappers::WrapperPair& d);
 
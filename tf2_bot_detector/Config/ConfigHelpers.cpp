@@ -1,9 +1,13 @@
 #include "ConfigHelpers.h"
+#include "Networking/HTTPCache.h"
 #include "Networking/HTTPClient.h"
 #include "Networking/HTTPHelpers.h"
+#include "Networking/MirrorSelector.h"
 #include "Platform/Platform.h"
 #include "Util/JSONUtils.h"
 #include "Util/RegexUtils.h"
+#include "Util/StartupTimeline.h"
+#include "Util/TaskScheduler.h"
 #include "Filesystem.h"
 #include "Log.h"
 #include "Version.h"
@@ -11,10 +15,15 @@
 
 #include <mh/text/formatters/error_code.hpp>
 #include <mh/text/case_insensitive_string.hpp>
+#include <mh/text/fmtstr.hpp>
 #include <mh/text/string_insertion.hpp>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include <regex>
+#include <thread>
 
 using namespace std::string_literals;
 using namespace std::string_view_literals;
@@ -54,9 +63,135 @@ auto tf2_bot_detector::GetConfigFilePaths(const std::string_view& basename) -> C
 	return retVal;
 }
 
-static void SaveJSONToFile(const std::filesystem::path& filename, const nlohmann::json& json)
+// Returns exactly what was written
+static std::string SaveJSONToFile(const std::filesystem::path& filename, const nlohmann::json& json)
 {
-	IFilesystem::Get().WriteFile(filename, json.dump(1, '\t', true, nlohmann::detail::error_handler_t::ignore) << '\n', PathUsage::WriteRoaming);
+	std::string text = json.dump(1, '\t', true, nlohmann::detail::error_handler_t::ignore) << '\n';
+
+	// Write next to it and swap it in, so a crash halfway through never leaves a truncated file
+	auto& fs = IFilesystem::Get();
+	const auto path = fs.ResolvePath(filename, PathUsage::WriteRoaming);
+	auto tempPath = path;
+	tempPath += ".tmp";
+	fs.WriteFile(tempPath, text, PathUsage::WriteRoaming);
+	std::filesystem::rename(tempPath, path);
+
+	return text;
+}
+
+// 64-bit FNV-1a, only used to tell whether a file changed since we last cached it
+static uint64_t HashFileContents(const std::string_view& contents)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	for (char c : contents)
+	{
+		hash ^= uint8_t(c);
+		hash *= 0x100000001b3;
+	}
+
+	return hash;
+}
+
+ConfigFileTimes tf2_bot_detector::GetConfigFileTimes(const ConfigFilePaths& paths)
+{
+	const auto GetTime = [](const std::filesystem::path& path) -> std::filesystem::file_time_type
+	{
+		if (path.empty())
+			return {};
+
+		// Missing files are changes too
+		std::error_code ec;
+		const auto time = std::filesystem::last_write_time(IFilesystem::Get().ResolvePath(path, PathUsage::Read), ec);
+		return ec ? std::filesystem::file_time_type{} : time;
+	};
+
+	ConfigFileTimes retVal;
+	retVal.m_User = GetTime(paths.m_User);
+	retVal.m_Official = GetTime(paths.m_Official);
+
+	for (const auto& path : paths.m_Others)
+		retVal.m_Others.emplace(path, GetTime(path));
+
+	return retVal;
+}
+
+namespace
+{
+	// Hashes of what SaveFile() last wrote to each file. Anything still matching on the next launch
+	// was validated and normalized when we wrote it, and doesn't have to be again. Forgotten whenever
+	// the version changes, since that is when validation and normalization change.
+	class SavedFileHashes final
+	{
+	public:
+		static SavedFileHashes& Get()
+		{
+			static SavedFileHashes s_Instance;
+			return s_Instance;
+		}
+
+		bool Contains(const std::filesystem::path& filename, uint64_t contentHash)
+		{
+			std::lock_guard lock(m_Mutex);
+			EnsureLoaded();
+
+			const auto found = m_Hashes.find(filename.string());
+			return found != m_Hashes.end() && found->second == contentHash;
+		}
+
+		void Set(const std::filesystem::path& filename, uint64_t contentHash)
+		{
+			std::lock_guard lock(m_Mutex);
+			EnsureLoaded();
+
+			if (auto& hash = m_Hashes[filename.string()]; hash != contentHash)
+			{
+				hash = contentHash;
+				Save();
+			}
+		}
+
+	private:
+		static constexpr char FILENAME[] = "temp/config_cache/saved_hashes.json";
+
+		void EnsureLoaded() try
+		{
+			if (m_Loaded)
+				return;
+
+			m_Loaded = true;
+
+			const auto path = IFilesystem::Get().ResolvePath(FILENAME, PathUsage::WriteLocal);
+			if (!std::filesystem::exists(path))
+				return;
+
+			const auto json = nlohmann::json::parse(IFilesystem::Get().ReadFile(path));
+			if (json.at("version").get<std::string_view>() == mh::format("{}", VERSION))
+				json.at("hashes").get_to(m_Hashes);
+		}
+		catch (...)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to load {}", FILENAME);
+		}
+
+		void Save() const try
+		{
+			const nlohmann::json json =
+			{
+				{ "version", mh::format("{}", VERSION) },
+				{ "hashes", m_Hashes },
+			};
+
+			IFilesystem::Get().WriteFile(FILENAME, json.dump(), PathUsage::WriteLocal);
+		}
+		catch (...)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to save {}", FILENAME);
+		}
+
+		std::mutex m_Mutex;
+		bool m_Loaded = false;
+		std::map<std::string, uint64_t> m_Hashes;
+	};
 }
 
 static ConfigSchemaInfo LoadAndValidateSchema(const ConfigFileBase& config, const nlohmann::json& json)
@@ -70,33 +205,37 @@ static ConfigSchemaInfo LoadAndValidateSchema(const ConfigFileBase& config, cons
 	return schema;
 }
 
-static mh::task<bool> TryAutoUpdate(std::filesystem::path filename, const nlohmann::json& existingJson,
-	SharedConfigFileBase& config, const HTTPClient& client)
+// Empty if url couldn't be reached or sent something unusable, so the next mirror should be
+// tried. Otherwise, whether config was updated.
+static mh::task<std::optional<bool>> TryAutoUpdateFrom(const std::filesystem::path& filename, std::string url,
+	const std::vector<std::string>& allURLs, SharedConfigFileBase& config, const HTTPClient& client)
 {
-	auto fileInfoJson = existingJson.find("file_info");
-	if (fileInfoJson == existingJson.end())
-	{
-		DebugLog("Skipping auto-update of {}: file_info object missing", filename);
-		co_return false;
-	}
-
-	const ConfigFileInfo info(*fileInfoJson);
-	if (info.m_UpdateURL.empty())
-	{
-		DebugLog("Skipping auto-update of {}: update_url was empty", filename);
-		co_return false;
-	}
+	const auto cachedValidators = HTTPCache::FindValidators(url);
 
+	HTTPConditionalResponse response;
 	nlohmann::json newJson;
 	try
 	{
-		newJson = nlohmann::json::parse(co_await client.GetStringAsync(info.m_UpdateURL));
+		const auto startTime = tfbd_clock_t::now();
+		response = co_await client.GetStringConditionalAsync(url, config.GetAutoUpdateRequestTag(),
+			cachedValidators.value_or(HTTPCacheValidators{}));
+		MirrorSelector::RecordSuccess(url, std::chrono::duration_cast<std::chrono::milliseconds>(tfbd_clock_t::now() - startTime));
+
+		if (response.m_NotModified)
+		{
+			// What we have on disk is still current, skip the download and the second parse
+			DebugLog("Skipping auto-update of {}: not modified since the last download from {}", filename, url);
+			co_return false;
+		}
+
+		newJson = nlohmann::json::parse(response.m_Body);
 	}
 	catch (...)
 	{
 		LogException(MH_SOURCE_LOCATION_CURRENT(),
-			"Failed to auto-update {}: failed to parse new json from {}", filename, info.m_UpdateURL);
-		co_return false;
+			"Failed to auto-update {}: failed to parse new json from {}", filename, url);
+		MirrorSelector::RecordFailure(url);
+		co_return std::nullopt;
 	}
 
 	try
@@ -106,8 +245,9 @@ static mh::task<bool> TryAutoUpdate(std::filesystem::path filename, const nlohma
 	catch (...)
 	{
 		LogException(MH_SOURCE_LOCATION_CURRENT(),
-			"Failed to auto-update {} from {}: new json failed schema validation", filename, info.m_UpdateURL);
-		co_return false;
+			"Failed to auto-update {} from {}: new json failed schema validation", filename, url);
+		MirrorSelector::RecordFailure(url);
+		co_return std::nullopt;
 	}
 
 	ConfigFileInfo fileInfo;
@@ -119,8 +259,9 @@ static mh::task<bool> TryAutoUpdate(std::filesystem::path filename, const nlohma
 	catch (...)
 	{
 		LogException(MH_SOURCE_LOCATION_CURRENT(),
-			"Failed to auto-update {} from {}: failed to parse file info from new json", filename, info.m_UpdateURL);
-		co_return false;
+			"Failed to auto-update {} from {}: failed to parse file info from new json", filename, url);
+		MirrorSelector::RecordFailure(url);
+		co_return std::nullopt;
 	}
 
 	if (fileInfo.m_Title.empty())
@@ -133,23 +274,55 @@ static mh::task<bool> TryAutoUpdate(std::filesystem::path filename, const nlohma
 	catch (...)
 	{
 		LogException(MH_SOURCE_LOCATION_CURRENT(),
-			"Failed to auto-update {}: failed to deserialize response from {}", filename, info.m_UpdateURL);
-		co_return false;
+			"Failed to auto-update {}: failed to deserialize response from {}", filename, url);
+		MirrorSelector::RecordFailure(url);
+		co_return std::nullopt;
 	}
 
 	if (config.SaveFile(filename))
 	{
 		LogError(MH_SOURCE_LOCATION_CURRENT(), "Successfully downloaded and deserialized new version of {} from {}, but couldn't write it back to disk.",
-			filename, info.m_UpdateURL);
+			filename, url);
+		HTTPCache::RemoveValidators(url);
 	}
 	else
 	{
-		DebugLog(MH_SOURCE_LOCATION_CURRENT(), "Wrote auto-updated config file from {} to {}", info.m_UpdateURL, filename);
+		DebugLog(MH_SOURCE_LOCATION_CURRENT(), "Wrote auto-updated config file from {} to {}", url, filename);
+		HTTPCache::SetValidators(url, std::move(response.m_Validators));
+
+		// What's on disk came from url now, so the other mirrors' validators are no longer for it
+		for (const auto& other : allURLs)
+		{
+			if (other != url)
+				HTTPCache::RemoveValidators(other);
+		}
 	}
 
 	co_return true;
 }
 
+static mh::task<bool> TryAutoUpdate(std::filesystem::path filename, ConfigFileInfo info,
+	SharedConfigFileBase& config, const HTTPClient& client)
+{
+	if (info.m_UpdateURL.empty())
+	{
+		DebugLog("Skipping auto-update of {}: update_url was empty", filename);
+		co_return false;
+	}
+
+	std::vector<std::string> urls = std::move(info.m_MirrorURLs);
+	urls.insert(urls.begin(), info.m_UpdateURL);
+	urls = MirrorSelector::Rank(std::move(urls));
+
+	for (const auto& url : urls)
+	{
+		if (const auto updated = co_await TryAutoUpdateFrom(filename, url, urls, config, client))
+			co_return *updated;
+	}
+
+	co_return false;
+}
+
 void tf2_bot_detector::to_json(nlohmann::json& j, const ConfigSchemaInfo& d)
 {
 	j = mh::format("{}", d);
@@ -177,6 +350,8 @@ void tf2_bot_detector::to_json(nlohmann::json& j, const ConfigFileInfo& d)
 		j["description"] = d.m_Description;
 	if (!d.m_UpdateURL.empty())
 		j["update_url"] = d.m_UpdateURL;
+	if (!d.m_MirrorURLs.empty())
+		j["mirror_urls"] = d.m_MirrorURLs;
 }
 
 void tf2_bot_detector::from_json(const nlohmann::json& j, ConfigFileInfo& d)
@@ -188,10 +363,11 @@ void tf2_bot_detector::from_json(const nlohmann::json& j, ConfigFileInfo& d)
 
 	try_get_to_defaulted(j, d.m_Description, "description");
 	try_get_to_defaulted(j, d.m_UpdateURL, "update_url");
+	try_get_to_defaulted(j, d.m_MirrorURLs, "mirror_urls");
 }
 
 mh::task<std::error_condition> tf2_bot_detector::detail::LoadConfigFileAsync(ConfigFileBase& file, std::filesystem::path filename,
-	bool allowAutoUpdate, const Settings& settings)
+	bool allowAutoUpdate, const Settings& settings, bool background)
 {
 	std::shared_ptr<const HTTPClient> client;
 	if (dynamic_cast<SharedConfigFileBase*>(&file) && allowAutoUpdate)
@@ -201,6 +377,11 @@ mh::task<std::error_condition> tf2_bot_detector::detail::LoadConfigFileAsync(Con
 			Log("Disallowing auto-update of {} because internet connectivity is disabled or unset in settings", filename);
 	}
 
+	// Settings aren't safe to touch from other threads, so only leave once we have the client.
+	// Mostly waiting on downloads and parsing json.
+	if (background)
+		co_await TaskScheduler::Get().co_schedule(TaskLane::IO);
+
 	co_return co_await file.LoadFileAsync(filename, client);
 }
 
@@ -251,6 +432,10 @@ mh::task<std::error_condition> ConfigFileBase::LoadFileAsync(const std::filesyst
 	if (loadResult && loadResult != std::errc::no_such_file_or_directory)
 		SaveConfigFileBackup(filename);
 
+	// Nothing to normalize
+	if (!loadResult && m_UnchangedSinceSave)
+		co_return loadResult;
+
 	if (auto saveResult = SaveFile(filename))
 	{
 		if (loadResult)
@@ -282,16 +467,24 @@ mh::task<std::error_condition> ConfigFileBase::LoadFileInternalAsync(std::filesy
 		co_return ConfigErrorType::ReadFileFailed;
 	}
 
+	const StartupTimeline::ScopedPhase startupPhase(
+		StartupTimeline::IsComplete() ? std::string_view{} : mh::fmtstr<64>("Load {}", filename.filename()).view());
+
 	const auto startTime = clock_t::now();
+	m_UnchangedSinceSave = false;
+	bool loadedFromCache = false;
+	bool deserialized = false;
+	bool schemaValidated = false;
 
 	nlohmann::json json;
 	{
 		Log("Loading {}...", filename);
 
-		std::string file;
+		// Parsed straight out of the mapping, multi-MB playerlists would otherwise be copied once first
+		MappedFile file;
 		try
 		{
-			file = IFilesystem::Get().ReadFile(filename);
+			file = IFilesystem::Get().MapFile(filename);
 		}
 		catch (...)
 		{
@@ -299,9 +492,74 @@ mh::task<std::error_condition> ConfigFileBase::LoadFileInternalAsync(std::filesy
 			co_return ConfigErrorType::ReadFileFailed;
 		}
 
+		const auto contentHash = HashFileContents(file);
+		m_UnchangedSinceSave = SavedFileHashes::Get().Contains(filename, contentHash);
+
+		// Files for something else entirely don't need to be parsed to be turned away
+		if (!m_UnchangedSinceSave)
+		{
+			if (auto schema = try_find_root_string(file.GetData(), "$schema"))
+			{
+				try
+				{
+					ValidateSchema(ConfigSchemaInfo(*schema));
+					schemaValidated = true;
+				}
+				catch (...)
+				{
+					LogException(MH_SOURCE_LOCATION_CURRENT(),
+						"Failed to load {}, existing json failed schema validation", filename);
+					co_return ConfigErrorType::SchemaValidationFailed;
+				}
+			}
+		}
+
 		try
 		{
-			json = nlohmann::json::parse(file);
+			loadedFromCache = TryLoadCache(GetCachePath(filename), contentHash);
+		}
+		catch (...)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(), "Ignoring cache for {}", filename);
+		}
+
+		// Nobody's written ours for this copy yet, but it might be the one the release shipped with
+		if (!loadedFromCache)
+		{
+			try
+			{
+				if (auto prebuiltPath = GetPrebuiltCachePath(filename); !prebuiltPath.empty())
+					loadedFromCache = TryLoadCache(prebuiltPath, contentHash);
+			}
+			catch (...)
+			{
+				LogException(MH_SOURCE_LOCATION_CURRENT(), "Ignoring prebuilt cache for {}", filename);
+			}
+		}
+
+		// Caches are only written for what SaveFile() wrote
+		m_UnchangedSinceSave |= loadedFromCache;
+		deserialized = loadedFromCache;
+		if (!deserialized)
+		{
+			try
+			{
+				deserialized = TryDeserializeStreaming(file, json);
+			}
+			catch (...)
+			{
+				// The DOM path reports whatever was wrong with it properly, and still tries an auto-update first
+				LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to stream {}, parsing the whole file instead", filename);
+			}
+		}
+
+		try
+		{
+			if (!deserialized)
+				json = nlohmann::json::parse(file.GetData());
+
+			// What we deserialize from it stays within a small factor of the text
+			m_TrackedMemory.SetBytes(file.size());
 		}
 		catch (...)
 		{
@@ -310,15 +568,18 @@ mh::task<std::error_condition> ConfigFileBase::LoadFileInternalAsync(std::filesy
 		}
 	}
 
-	try
-	{
-		LoadAndValidateSchema(*this, json);
-	}
-	catch (...)
+	if (!m_UnchangedSinceSave && !schemaValidated)
 	{
-		LogException(MH_SOURCE_LOCATION_CURRENT(),
-			"Failed to load {}, existing json failed schema validation", filename);
-		co_return ConfigErrorType::SchemaValidationFailed;
+		try
+		{
+			LoadAndValidateSchema(*this, json);
+		}
+		catch (...)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(),
+				"Failed to load {}, existing json failed schema validation", filename);
+			co_return ConfigErrorType::SchemaValidationFailed;
+		}
 	}
 
 	m_FileName = filename.string();
@@ -328,7 +589,9 @@ mh::task<std::error_condition> ConfigFileBase::LoadFileInternalAsync(std::filesy
 	{
 		try
 		{
-			if (try_get_to_defaulted(json, shared->m_FileInfo, "file_info"))
+			if (loadedFromCache)
+				fileInfoParsed = shared->m_FileInfo.has_value();
+			else if (try_get_to_defaulted(json, shared->m_FileInfo, "file_info"))
 				fileInfoParsed = true;
 		}
 		catch (...)
@@ -342,7 +605,7 @@ mh::task<std::error_condition> ConfigFileBase::LoadFileInternalAsync(std::filesy
 	{
 		if (auto shared = dynamic_cast<SharedConfigFileBase*>(this))
 		{
-			if (fileInfoParsed && co_await TryAutoUpdate(filename, json, *shared, *client))
+			if (fileInfoParsed && co_await TryAutoUpdate(filename, *shared->m_FileInfo, *shared, *client))
 				co_return ConfigErrorType::Success;
 		}
 	}
@@ -351,12 +614,23 @@ mh::task<std::error_condition> ConfigFileBase::LoadFileInternalAsync(std::filesy
 		DebugLog("Skipping auto-update for {} because allowAutoupdate = false.", filename);
 	}
 
+	if (deserialized)
+	{
+		DebugLog("Loaded {} ({}) in {} seconds", filename, loadedFromCache ? "cache" : "streamed",
+			to_seconds(clock_t::now() - startTime));
+		co_return ConfigErrorType::Success;
+	}
+
 	try
 	{
 		Deserialize(json);
 	}
 	catch (...)
 	{
+		// Make sure the next auto-update downloads a fresh copy instead of getting a 304 for this one
+		if (auto shared = dynamic_cast<SharedConfigFileBase*>(this); shared && shared->m_FileInfo)
+			HTTPCache::RemoveValidators(shared->m_FileInfo->m_UpdateURL);
+
 		LogException(MH_SOURCE_LOCATION_CURRENT(),
 			"Failed to load {}, existing file failed to deserialize, and auto-update did not occur", filename);
 		co_return ConfigErrorType::DeserializeFailed;
@@ -369,7 +643,65 @@ mh::task<std::error_condition> ConfigFileBase::LoadFileInternalAsync(std::filesy
 std::error_condition tf2_bot_detector::ConfigFileBase::SaveFile(const std::filesystem::path& filename) const
 {
 	nlohmann::json json;
+	if (auto result = SerializeForSave(filename, json))
+		return result;
+
+	uint64_t contentHash;
+	if (auto result = WriteSavedJSON(filename, json, &contentHash))
+		return result;
+
+	try
+	{
+		SaveCache(GetCachePath(filename), contentHash);
+	}
+	catch (...)
+	{
+		// Only costs us a slower load next time
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to write cache for {}", filename);
+	}
+
+	return ConfigErrorType::Success;
+}
+
+std::error_condition ConfigFileBase::WritePrebuiltCache(const std::filesystem::path& filename,
+	const std::filesystem::path& cachePath)
+{
+	// Without a client there's nothing to auto-update, so this never actually suspends
+	auto loadTask = LoadFileInternalAsync(filename, nullptr);
+	loadTask.wait();
+	if (auto result = loadTask.get())
+		return result;
+
+	try
+	{
+		SaveCache(cachePath, HashFileContents(IFilesystem::Get().MapFile(filename)));
+	}
+	catch (...)
+	{
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to write {}", cachePath);
+		return ConfigErrorType::WriteFileFailed;
+	}
+
+	return ConfigErrorType::Success;
+}
+
+std::filesystem::path ConfigFileBase::GetCachePath(const std::filesystem::path& filename)
+{
+	return IFilesystem::Get().ResolvePath(
+		std::filesystem::path("temp/config_cache") / (filename.filename().string() + ".bin"), PathUsage::WriteLocal);
+}
+
+std::filesystem::path ConfigFileBase::GetPrebuiltCachePath(const std::filesystem::path& filename)
+{
+	auto path = IFilesystem::Get().ResolvePath(std::filesystem::path(filename) += ".bin", PathUsage::Read);
+	if (!path.empty() && !std::filesystem::exists(path))
+		path.clear(); // ResolvePath() passes absolute paths through as they are
 
+	return path;
+}
+
+std::error_condition ConfigFileBase::SerializeForSave(const std::filesystem::path& filename, nlohmann::json& json) const
+{
 	// If we already have a schema loaded, put it in the $schema property
 	try
 	{
@@ -403,9 +735,16 @@ std::error_condition tf2_bot_detector::ConfigFileBase::SaveFile(const std::files
 		return ConfigErrorType::SerializedSchemaValidationFailed;
 	}
 
+	return ConfigErrorType::Success;
+}
+
+std::error_condition ConfigFileBase::WriteSavedJSON(const std::filesystem::path& filename, const nlohmann::json& json,
+	uint64_t* contentHash)
+{
+	std::string text;
 	try
 	{
-		SaveJSONToFile(filename, json);
+		text = SaveJSONToFile(filename, json);
 	}
 	catch (...)
 	{
@@ -413,6 +752,11 @@ std::error_condition tf2_bot_detector::ConfigFileBase::SaveFile(const std::files
 		return ConfigErrorType::WriteFileFailed;
 	}
 
+	const auto hash = HashFileContents(text);
+	SavedFileHashes::Get().Set(filename, hash);
+	if (contentHash)
+		*contentHash = hash;
+
 	return ConfigErrorType::Success;
 }
 
@@ -474,6 +818,11 @@ ConfigFileInfo SharedConfigFileBase::GetFileInfo() const
 	return retVal;
 }
 
+HTTPRequestTag SharedConfigFileBase::GetAutoUpdateRequestTag() const
+{
+	return HTTPRequestTag::ConfigAutoUpdate;
+}
+
 const std::error_category& tf2_bot_detector::ConfigErrorCategory()
 {
 	struct ConfigErrorCategory_t final : std::error_category
@@ -1,5 +1,7 @@
 #pragma once
+#include "Clock.h"
 #include "Log.h"
+#include "Util/MemoryTracker.h"
 
 #include <mh/coroutine/task.hpp>
 #include <mh/coroutine/thread.hpp>
@@ -9,6 +11,7 @@
 
 #include <cassert>
 #include <filesystem>
+#include <map>
 #include <optional>
 #include <vector>
 
@@ -16,6 +19,7 @@ namespace tf2_bot_detector
 {
 	class IHTTPClient;
 	class Settings;
+	enum class HTTPRequestTag;
 
 	enum class ConfigFileType
 	{
@@ -50,6 +54,17 @@ namespace tf2_bot_detector
 	};
 	ConfigFilePaths GetConfigFilePaths(const std::string_view& basename);
 
+	// Last write times of everything in a ConfigFilePaths, so we can tell when something else edits them
+	struct ConfigFileTimes
+	{
+		std::filesystem::file_time_type m_User{};
+		std::filesystem::file_time_type m_Official{};
+		std::map<std::filesystem::path, std::filesystem::file_time_type> m_Others;
+
+		bool operator==(const ConfigFileTimes&) const = default;
+	};
+	ConfigFileTimes GetConfigFileTimes(const ConfigFilePaths& paths);
+
 	struct ConfigSchemaInfo
 	{
 		explicit ConfigSchemaInfo(std::nullptr_t) {}
@@ -78,6 +93,7 @@ namespace tf2_bot_detector
 		std::string m_Title;
 		std::string m_Description;
 		std::string m_UpdateURL;
+		std::vector<std::string> m_MirrorURLs;  // Copies of whatever is at m_UpdateURL, see MirrorSelector
 	};
 
 	void to_json(nlohmann::json& j, const ConfigFileInfo& d);
@@ -91,6 +107,11 @@ namespace tf2_bot_detector
 		mh::task<std::error_condition> LoadFileAsync(const std::filesystem::path& filename, std::shared_ptr<const IHTTPClient> client = nullptr);
 		std::error_condition SaveFile(const std::filesystem::path& filename) const;
 
+		// Loads filename (never auto-updated) and writes the cache SaveCache() would have for it to
+		// cachePath. For the build, so files shipped with a release can be loaded without parsing
+		// them on first launch. Shipped as the json's name + ".bin", next to it.
+		std::error_condition WritePrebuiltCache(const std::filesystem::path& filename, const std::filesystem::path& cachePath);
+
 		virtual void ValidateSchema(const ConfigSchemaInfo& schema) const = 0 {}
 		virtual void Deserialize(const nlohmann::json& json) = 0 {}
 		virtual void Serialize(nlohmann::json& json) const = 0;
@@ -101,8 +122,32 @@ namespace tf2_bot_detector
 	protected:
 		virtual void PostLoad(bool deserialized) {}
 
+		// SaveFile(), split into the part that reads this and the part that doesn't, so the second
+		// can happen on another thread. WriteSavedJSON() doesn't write a cache.
+		std::error_condition SerializeForSave(const std::filesystem::path& filename, nlohmann::json& json) const;
+		static std::error_condition WriteSavedJSON(const std::filesystem::path& filename, const nlohmann::json& json,
+			uint64_t* contentHash = nullptr);
+
+		// Optional binary copy of the file, for files that are slow to parse. contentHash identifies
+		// the exact bytes of the file. TryLoadCache() returns true if it restored everything
+		// Deserialize() would have from a cache SaveCache() wrote for the same contents.
+		virtual bool TryLoadCache(const std::filesystem::path& cachePath, uint64_t contentHash) { return false; }
+		virtual void SaveCache(const std::filesystem::path& cachePath, uint64_t contentHash) const {}
+
+		// For big files, deserializes straight from the text instead of building a DOM of all of it
+		// first. header gets everything that wasn't deserialized, including $schema and file_info.
+		// Only changes anything when it returns true. Deserialize() is skipped in that case.
+		virtual bool TryDeserializeStreaming(const std::string_view& text, nlohmann::json& header) { return false; }
+
 	private:
 		mh::task<std::error_condition> LoadFileInternalAsync(std::filesystem::path filename, std::shared_ptr<const IHTTPClient> client);
+
+		// Ours, in the local temp folder, or the one shipped next to filename (empty if there isn't one)
+		static std::filesystem::path GetCachePath(const std::filesystem::path& filename);
+		static std::filesystem::path GetPrebuiltCachePath(const std::filesystem::path& filename);
+
+		TrackedMemory m_TrackedMemory{ MemoryCategory::ConfigJSON };
+		bool m_UnchangedSinceSave = false; // Exactly what SaveFile() last wrote, already validated
 	};
 
 	class SharedConfigFileBase : public ConfigFileBase
@@ -114,7 +159,10 @@ namespace tf2_bot_detector
 		const std::string& GetName() const;
 		ConfigFileInfo GetFileInfo() const;
 
-	private:
+		// What downloading a newer copy from file_info's update_url is counted as
+		virtual HTTPRequestTag GetAutoUpdateRequestTag() const;
+
+	protected:
 		friend class ConfigFileBase;
 
 		std::optional<ConfigFileInfo> m_FileInfo;
@@ -122,14 +170,16 @@ namespace tf2_bot_detector
 
 	namespace detail
 	{
-		mh::task<std::error_condition> LoadConfigFileAsync(ConfigFileBase& file, std::filesystem::path filename, bool allowAutoUpdate, const Settings& settings);
+		mh::task<std::error_condition> LoadConfigFileAsync(ConfigFileBase& file, std::filesystem::path filename, bool allowAutoUpdate,
+			const Settings& settings, bool background);
 	}
 
+	// If background is true, the file is loaded on a thread pool shared by all config files
 	template<typename T, typename = std::enable_if_t<std::is_base_of_v<ConfigFileBase, T>>>
-	mh::task<T> LoadConfigFileAsync(std::filesystem::path filename, bool allowAutoUpdate, const Settings& settings)
+	mh::task<T> LoadConfigFileAsync(std::filesystem::path filename, bool allowAutoUpdate, const Settings& settings, bool background = false)
 	{
 		T file;
-		co_await detail::LoadConfigFileAsync(file, filename, allowAutoUpdate, settings);
+		co_await detail::LoadConfigFileAsync(file, filename, allowAutoUpdate, settings, background);
 		co_return file;
 	}
 
@@ -150,34 +200,105 @@ namespace tf2_bot_detector
 			using namespace std::string_literals;
 
 			const auto paths = GetConfigFilePaths(GetBaseFileName());
+			MarkFilesSaved();
 
-			if (!IsOfficial() && !paths.m_User.empty())
-				m_UserList = LoadConfigFileAsync<T>(paths.m_User, false, *m_Settings).get();
-
+			// Everything but the user list loads in the background, so start those first
 			if (!paths.m_Official.empty())
-				m_OfficialList = LoadConfigFileAsync<T>(paths.m_Official, !IsOfficial(), *m_Settings);
+				m_OfficialList = LoadConfigFileAsync<T>(paths.m_Official, !IsOfficial(), *m_Settings, true);
 			else
 				m_OfficialList = mh::make_ready_task<T>();
 
 			m_ThirdPartyLists = LoadThirdPartyListsAsync(paths);
+
+			if (!IsOfficial() && !paths.m_User.empty())
+				m_UserList = LoadConfigFileAsync<T>(paths.m_User, false, *m_Settings).get();
 		}
 
 		void SaveFiles() const
 		{
+			for (const auto& [filename, file] : GetFilesToSave())
+				file->SaveFile(filename);
+
+			MarkFilesSaved();
+		}
+
+		// Our own writes aren't edits, don't reload because of them
+		void MarkFilesSaved() const { m_FileTimes.reset(); }
+
+		// Reloads only the files that were changed on disk by something else. Call regularly, the
+		// files are checked every FILE_CHECK_INTERVAL. Returns true if anything was reloaded, which
+		// replaces the reloaded list objects.
+		bool ReloadChangedFiles()
+		{
+			const auto now = tfbd_clock_t::now();
+			if (now < m_NextFileCheckTime)
+				return false;
+
+			m_NextFileCheckTime = now + FILE_CHECK_INTERVAL;
+
+			// Loading resaves the files, so wait until that's done before looking at them
+			if (!m_OfficialList.is_ready() || !m_ThirdPartyLists.is_ready())
+			{
+				MarkFilesSaved();
+				return false;
+			}
+
+			const auto paths = GetConfigFilePaths(GetBaseFileName());
+			auto times = GetConfigFileTimes(paths);
+			if (!m_FileTimes || *m_FileTimes == times)
+			{
+				m_FileTimes = std::move(times);
+				return false;
+			}
+
+			if (times.m_User != m_FileTimes->m_User && !IsOfficial() && !paths.m_User.empty())
+			{
+				Log("{} was changed, reloading it", paths.m_User);
+				m_UserList = LoadConfigFileAsync<T>(paths.m_User, false, *m_Settings).get();
+			}
+
+			if (times.m_Official != m_FileTimes->m_Official)
+			{
+				Log("{} was changed, reloading it", paths.m_Official);
+				if (!paths.m_Official.empty())
+					m_OfficialList = LoadConfigFileAsync<T>(paths.m_Official, !IsOfficial(), *m_Settings, true);
+				else
+					m_OfficialList = mh::make_ready_task<T>();
+			}
+
+			if (times.m_Others != m_FileTimes->m_Others)
+			{
+				// The combined collection doesn't remember which file each entry came from. Unchanged files
+				// are quick to load again, since they come out of their caches.
+				Log("Third party {} files were changed, reloading them", GetBaseFileName());
+				m_ThirdPartyLists = LoadThirdPartyListsAsync(paths);
+			}
+
+			MarkFilesSaved();
+			return true;
+		}
+
+		// What SaveFiles() writes, and where
+		std::vector<std::pair<std::filesystem::path, const T*>> GetFilesToSave() const
+		{
+			std::vector<std::pair<std::filesystem::path, const T*>> retVal;
+
 			const T* defaultMutableList = GetDefaultMutableList();
 			const T* localList = GetLocalList();
 			if (localList)
-				localList->SaveFile(mh::format("cfg/{}.json", GetBaseFileName()));
+				retVal.emplace_back(mh::format("cfg/{}.json", GetBaseFileName()), localList);
 
 			if (defaultMutableList && defaultMutableList != localList)
 			{
-				const std::filesystem::path filename = mh::format("cfg/{}.official.json", GetBaseFileName());
+				std::filesystem::path filename = mh::format("cfg/{}.official.json", GetBaseFileName());
 
 				if (!IsOfficial())
 					throw std::runtime_error(mh::format("Attempted to save non-official data to {}", filename));
 
-				defaultMutableList->SaveFile(filename);
+				retVal.emplace_back(std::move(filename), defaultMutableList);
 			}
+
+			return retVal;
 		}
 
 		bool IsOfficial() const { return m_Settings->GetLocalSteamID().IsPazer(); }
@@ -235,20 +356,30 @@ namespace tf2_bot_detector
 		mh::task<collection_type> m_ThirdPartyLists;
 
 	private:
+		static constexpr duration_t FILE_CHECK_INTERVAL = std::chrono::seconds(5);
+		time_point_t m_NextFileCheckTime{};
+		mutable std::optional<ConfigFileTimes> m_FileTimes; // Unset until the files settle after our own writes
+
 		mh::task<collection_type> LoadThirdPartyListsAsync(ConfigFilePaths paths)
 		{
-			collection_type collection;
-
+			// Each one can mean an auto-update download, so load them all at once
+			std::vector<mh::task<T>> files;
+			files.reserve(paths.m_Others.size());
 			for (const auto& file : paths.m_Others)
+				files.push_back(LoadConfigFileAsync<T>(file, true, *m_Settings, true));
+
+			// ...but still combine them in order
+			collection_type collection;
+			for (size_t i = 0; i < files.size(); i++)
 			{
 				try
 				{
-					auto parsedFile = co_await LoadConfigFileAsync<T>(file, true, *m_Settings);
+					auto parsedFile = co_await files[i];
 					CombineEntries(collection, parsedFile);
 				}
 				catch (...)
 				{
-					LogException(MH_SOURCE_LOCATION_CURRENT(), "Exception when loading {}", file);
+					LogException(MH_SOURCE_LOCATION_CURRENT(), "Exception when loading {}", paths.m_Others[i]);
 				}
 			}
 
@@ -1,7 +1,9 @@
 #include "PlayerListJSON.h"
 #include "Networking/HTTPHelpers.h"
+#include "Util/JSONSaxReader.h"
 #include "Util/JSONUtils.h"
 #include "ConfigHelpers.h"
+#include "Filesystem.h"
 #include "Log.h"
 #include "Settings.h"
 
@@ -9,10 +11,14 @@
 #include <mh/text/string_insertion.hpp>
 #include <nlohmann/json.hpp>
 
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <regex>
+#include <span>
 #include <string>
+#include <unordered_map>
 
 using namespace tf2_bot_detector;
 using namespace std::string_literals;
@@ -20,6 +26,11 @@ using namespace std::string_view_literals;
 
 static std::filesystem::path s_PlayerListPath("cfg/playerlist.json");
 
+static std::filesystem::path GetJournalPath(const char* filename)
+{
+	return IFilesystem::Get().ResolvePath(filename, PathUsage::WriteRoaming);
+}
+
 namespace tf2_bot_detector
 {
 	void to_json(nlohmann::json& j, const PlayerAttribute& d)
@@ -53,10 +64,14 @@ namespace tf2_bot_detector
 	void to_json(nlohmann::json& j, const PlayerListData::LastSeen& d)
 	{
 		if (!d.m_PlayerName.empty())
-			j["player_name"] = d.m_PlayerName;
+			j["player_name"] = d.m_PlayerName.str();
 
 		j["time"] = std::chrono::duration_cast<std::chrono::seconds>(d.m_Time.time_since_epoch()).count();
 	}
+	void to_json(nlohmann::json& j, const PlayerListData::Proof& d)
+	{
+		j = d.Parse();
+	}
 	void to_json(nlohmann::json& j, const PlayerListData& d)
 	{
 		j = nlohmann::json
@@ -104,7 +119,7 @@ namespace tf2_bot_detector
 		using seconds = std::chrono::seconds;
 
 		d.m_Time = clock::time_point(seconds(j.at("time").get<seconds::rep>()));
-		d.m_PlayerName = j.value("player_name", "");
+		d.m_PlayerName = InternedString(j.value("player_name", ""));
 	}
 	void from_json(const nlohmann::json& j, PlayerListData& d) try
 	{
@@ -119,7 +134,13 @@ namespace tf2_bot_detector
 		if (auto lastSeen = j.find("last_seen"); lastSeen != j.end())
 			lastSeen->get_to(d.m_LastSeen.emplace());
 
-		try_get_to_defaulted(j, d.m_Proof, "proof");
+		d.m_Proof.clear();
+		if (auto proof = j.find("proof"); proof != j.end())
+		{
+			d.m_Proof.reserve(proof->size());
+			for (const auto& entry : *proof)
+				d.m_Proof.emplace_back(entry);
+		}
 	}
 	catch (...)
 	{
@@ -149,6 +170,21 @@ PlayerListJSON::PlayerListJSON(const Settings& settings) :
 	LoadFiles();
 }
 
+PlayerListJSON::~PlayerListJSON()
+{
+	try
+	{
+		if (m_FirstUnsavedChange)
+			SaveFiles();
+		else
+			WaitForSave();
+	}
+	catch (...)
+	{
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to save playerlists on shutdown");
+	}
+}
+
 void PlayerListJSON::PlayerListFile::ValidateSchema(const ConfigSchemaInfo& schema) const
 {
 	if (schema.m_Type != "playerlist")
@@ -162,6 +198,7 @@ void PlayerListJSON::PlayerListFile::Deserialize(const nlohmann::json& json)
 	SharedConfigFileBase::Deserialize(json);
 
 	PlayerMap_t& map = m_Players;
+	map.clear();
 	for (const auto& player : json.at("players"))
 	{
 		const SteamID steamID = player.at("steamid");
@@ -190,6 +227,330 @@ void PlayerListJSON::PlayerListFile::Serialize(nlohmann::json& json) const
 	}
 }
 
+namespace
+{
+	// Builds each player straight into a PlayerListData, with only that one player's json in memory
+	// at a time. Everything outside of "players" goes into the header json.
+	class PlayerListReader final : public JSONSaxReader
+	{
+	public:
+		PlayerListReader(const ConfigFileBase& file, std::map<SteamID, PlayerListData>& players, nlohmann::json& header) :
+			m_File(file), m_Players(players), m_Header(header)
+		{
+		}
+
+		bool m_HasSchema = false;
+		bool m_HasPlayers = false;
+
+	protected:
+		bool OnStartContainer(const std::string_view& key, bool isArray) override
+		{
+			nlohmann::json container = isArray ? nlohmann::json::array() : nlohmann::json::object();
+
+			if (!m_Building.empty())
+				m_Building.push_back(&AddValue(key, std::move(container)));
+			else if (IsPath({ "players" }))
+			{
+				m_HasPlayers = isArray;
+				return isArray;
+			}
+			else if (IsPath({ "players", "" }))
+				m_Building.push_back(&(m_Player = std::move(container)));
+			else if (IsPath({ key }))
+				m_Building.push_back(&(m_Header[std::string(key)] = std::move(container)));
+
+			// Otherwise it's the root
+			return true;
+		}
+
+		bool OnEndContainer(const std::string_view& key, bool isArray) override
+		{
+			if (m_Building.empty())
+				return true;
+
+			m_Building.pop_back();
+			if (m_Building.empty() && IsPath({ "players", "" }))
+			{
+				const SteamID steamID = m_Player.at("steamid");
+				PlayerListData parsed(steamID);
+				m_Player.get_to(parsed);
+				m_Players.emplace(steamID, std::move(parsed));
+			}
+
+			return true;
+		}
+
+		bool OnScalar(const std::string_view& key, const scalar_type& value) override
+		{
+			nlohmann::json json = std::visit([](const auto& v) -> nlohmann::json { return v; }, value);
+
+			if (!m_Building.empty())
+			{
+				AddValue(key, std::move(json));
+			}
+			else if (IsPath({}))
+			{
+				if (key == "$schema"sv)
+				{
+					m_File.ValidateSchema(ConfigSchemaInfo(json.get<std::string_view>()));
+					m_HasSchema = true;
+				}
+
+				m_Header[std::string(key)] = std::move(json);
+			}
+			else
+			{
+				// Every player has to be an object
+				return false;
+			}
+
+			return true;
+		}
+
+	private:
+		nlohmann::json& AddValue(const std::string_view& key, nlohmann::json&& value)
+		{
+			nlohmann::json& parent = *m_Building.back();
+			if (!parent.is_array())
+				return parent[std::string(key)] = std::move(value);
+
+			parent.push_back(std::move(value));
+			return parent.back();
+		}
+
+		const ConfigFileBase& m_File;
+		std::map<SteamID, PlayerListData>& m_Players;
+		nlohmann::json& m_Header;
+
+		nlohmann::json m_Player;
+		std::vector<nlohmann::json*> m_Building; // Containers of m_Player or m_Header being built, innermost last
+	};
+
+	// Binary copy of a playerlist, so the big community lists don't go through the json parser on
+	// every launch. Only ever used for the exact file contents it was written for.
+	constexpr uint32_t PLAYERLIST_CACHE_MAGIC = 0x4C504254; // "TBPL"
+	constexpr uint32_t PLAYERLIST_CACHE_VERSION = 1;
+
+	// Sorted by SteamID. Strings (names, proof json) live in a table before the players.
+	struct CachedPlayer
+	{
+		uint64_t m_SteamID;
+		int64_t m_LastSeenTime;   // Seconds, same precision as the json
+		uint32_t m_LastSeenName;
+		uint32_t m_FirstProof;
+		uint32_t m_ProofCount;
+		uint8_t m_Attributes;
+		uint8_t m_HasLastSeen;
+		uint8_t m_Padding[2]{};
+	};
+	static_assert(sizeof(CachedPlayer) == 32);
+	static_assert(PlayerAttributesList::size() <= 8);
+
+	class CacheWriter
+	{
+	public:
+		template<typename T> void Write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			m_Data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+		}
+		void WriteString(const std::string_view& str)
+		{
+			Write(uint32_t(str.size()));
+			m_Data.append(str);
+		}
+
+		std::string m_Data;
+	};
+
+	class CacheReader
+	{
+	public:
+		explicit CacheReader(const std::string_view& data) : m_Data(data) {}
+
+		template<typename T> T Read()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			T value;
+			std::memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+			return value;
+		}
+		std::string_view ReadString() { return Take(Read<uint32_t>()); }
+
+		bool empty() const { return m_Data.empty(); }
+
+	private:
+		std::string_view Take(size_t bytes)
+		{
+			if (bytes > m_Data.size())
+				throw std::runtime_error("Unexpected end of playerlist cache");
+
+			const auto retVal = m_Data.substr(0, bytes);
+			m_Data.remove_prefix(bytes);
+			return retVal;
+		}
+
+		std::string_view m_Data;
+	};
+
+	uint8_t PackAttributes(const PlayerAttributesList& attributes)
+	{
+		uint8_t retVal = 0;
+		for (size_t i = 0; i < attributes.size(); i++)
+		{
+			if (attributes.HasAttribute(PlayerAttribute(i)))
+				retVal |= uint8_t(1 << i);
+		}
+
+		return retVal;
+	}
+}
+
+bool PlayerListJSON::PlayerListFile::TryDeserializeStreaming(const std::string_view& text, nlohmann::json& header)
+{
+	PlayerMap_t players;
+	nlohmann::json parsedHeader = nlohmann::json::object();
+
+	PlayerListReader reader(*this, players, parsedHeader);
+	if (!reader.Parse(text) || !reader.m_HasSchema || !reader.m_HasPlayers)
+		return false;
+
+	// Same as Deserialize()
+	SharedConfigFileBase::Deserialize(parsedHeader);
+	m_Players = std::move(players);
+	header = std::move(parsedHeader);
+	return true;
+}
+
+bool PlayerListJSON::PlayerListFile::TryLoadCache(const std::filesystem::path& cachePath, uint64_t contentHash)
+{
+	if (!std::filesystem::exists(cachePath))
+		return false;
+
+	const MappedFile data = IFilesystem::Get().MapFile(cachePath);
+	CacheReader reader(data);
+
+	if (reader.Read<uint32_t>() != PLAYERLIST_CACHE_MAGIC || reader.Read<uint32_t>() != PLAYERLIST_CACHE_VERSION)
+		return false;
+	if (reader.Read<uint64_t>() != contentHash)
+		return false;
+
+	std::optional<ConfigFileInfo> fileInfo;
+	if (reader.Read<uint8_t>())
+	{
+		auto& info = fileInfo.emplace();
+		info.m_Authors.resize(reader.Read<uint32_t>());
+		for (auto& author : info.m_Authors)
+			author = reader.ReadString();
+
+		info.m_Title = reader.ReadString();
+		info.m_Description = reader.ReadString();
+		info.m_UpdateURL = reader.ReadString();
+	}
+
+	std::vector<std::string_view> strings(reader.Read<uint32_t>());
+	for (auto& str : strings)
+		str = reader.ReadString();
+
+	const auto GetString = [&](uint32_t index)
+	{
+		if (index >= strings.size())
+			throw std::runtime_error("Invalid playerlist cache string index");
+
+		return strings[index];
+	};
+
+	PlayerMap_t players;
+	const auto playerCount = reader.Read<uint64_t>();
+	for (uint64_t i = 0; i < playerCount; i++)
+	{
+		const auto cached = reader.Read<CachedPlayer>();
+
+		PlayerListData player{ SteamID(cached.m_SteamID) };
+		player.m_SavedAttributes = PlayerAttributesList(PlayerAttributesList::bits_t(cached.m_Attributes));
+
+		if (cached.m_HasLastSeen)
+		{
+			auto& lastSeen = player.m_LastSeen.emplace();
+			lastSeen.m_Time = std::chrono::system_clock::time_point(std::chrono::seconds(cached.m_LastSeenTime));
+			lastSeen.m_PlayerName = InternedString(GetString(cached.m_LastSeenName));
+		}
+
+		// Stored as the same text Proof keeps, so there's nothing to parse
+		player.m_Proof.reserve(cached.m_ProofCount);
+		for (uint32_t p = 0; p < cached.m_ProofCount; p++)
+			player.m_Proof.push_back(PlayerListData::Proof::FromText(std::string(GetString(cached.m_FirstProof + p))));
+
+		// Written in order, so every insert goes at the end
+		players.emplace_hint(players.end(), player.GetSteamID(), std::move(player));
+	}
+
+	if (!reader.empty())
+		throw std::runtime_error("Unexpected data at the end of playerlist cache");
+
+	m_FileInfo = std::move(fileInfo);
+	m_Players = std::move(players);
+	return true;
+}
+
+void PlayerListJSON::PlayerListFile::SaveCache(const std::filesystem::path& cachePath, uint64_t contentHash) const
+{
+	CacheWriter writer;
+	writer.Write(PLAYERLIST_CACHE_MAGIC);
+	writer.Write(PLAYERLIST_CACHE_VERSION);
+	writer.Write(contentHash);
+
+	writer.Write(uint8_t(m_FileInfo.has_value()));
+	if (m_FileInfo)
+	{
+		writer.Write(uint32_t(m_FileInfo->m_Authors.size()));
+		for (const auto& author : m_FileInfo->m_Authors)
+			writer.WriteString(author);
+
+		writer.WriteString(m_FileInfo->m_Title);
+		writer.WriteString(m_FileInfo->m_Description);
+		writer.WriteString(m_FileInfo->m_UpdateURL);
+	}
+
+	// Has to match what Deserialize() would get back out of the file Serialize() wrote
+	std::vector<std::string> strings;
+	std::vector<CachedPlayer> players;
+	for (const auto& [steamID, data] : m_Players)
+	{
+		if (data.m_SavedAttributes.empty())
+			continue;
+
+		CachedPlayer& cached = players.emplace_back();
+		cached.m_SteamID = steamID.ID64;
+		cached.m_Attributes = PackAttributes(data.m_SavedAttributes);
+		cached.m_HasLastSeen = data.m_LastSeen.has_value();
+		cached.m_LastSeenTime = 0;
+		cached.m_LastSeenName = 0;
+
+		if (data.m_LastSeen)
+		{
+			cached.m_LastSeenTime = std::chrono::duration_cast<std::chrono::seconds>(data.m_LastSeen->m_Time.time_since_epoch()).count();
+			cached.m_LastSeenName = uint32_t(strings.size());
+			strings.push_back(data.m_LastSeen->m_PlayerName.str());
+		}
+
+		cached.m_FirstProof = uint32_t(strings.size());
+		cached.m_ProofCount = uint32_t(data.m_Proof.size());
+		for (const auto& proof : data.m_Proof)
+			strings.push_back(proof.GetText());
+	}
+
+	writer.Write(uint32_t(strings.size()));
+	for (const auto& str : strings)
+		writer.WriteString(str);
+
+	writer.Write(uint64_t(players.size()));
+	for (const auto& cached : players)
+		writer.Write(cached);
+
+	IFilesystem::Get().WriteFile(cachePath, writer.m_Data, PathUsage::WriteLocal);
+}
+
 PlayerListData& PlayerListJSON::PlayerListFile::GetOrAddPlayer(const SteamID& id)
 {
 	if (auto found = m_Players.find(id); found != m_Players.end())
@@ -198,9 +559,218 @@ PlayerListData& PlayerListJSON::PlayerListFile::GetOrAddPlayer(const SteamID& id
 		return m_Players.emplace(id, PlayerListData(id)).first->second;
 }
 
+static PlayerAttributesList SelectAttributes(const PlayerListData& data, AttributePersistence persistence)
+{
+	switch (persistence)
+	{
+	default:
+		LogError("Unknown persistence {}", mh::enum_fmt(persistence));
+		[[fallthrough]];
+	case AttributePersistence::Any:
+		return data.GetAttributes();
+	case AttributePersistence::Saved:
+		return data.m_SavedAttributes;
+	case AttributePersistence::Transient:
+		return data.m_TransientAttributes;
+	}
+}
+
+class PlayerListJSON::PlayerIndex final
+{
+public:
+	// Either m_Data, or m_List and m_Record for read only lists
+	struct Entry
+	{
+		const ConfigFileName* m_FileName;
+		const PlayerListData* m_Data = nullptr;
+		const CompactPlayerList* m_List = nullptr;
+		const CompactPlayerList::Record* m_Record = nullptr;
+
+		PlayerAttributesList GetAttributes(AttributePersistence persistence) const
+		{
+			if (m_Data)
+				return SelectAttributes(*m_Data, persistence);
+
+			// Read only lists don't have transient attributes
+			if (persistence == AttributePersistence::Transient)
+				return {};
+
+			return CompactPlayerList::GetAttributes(*m_Record);
+		}
+	};
+
+	PlayerIndex(const PlayerListJSON& playerList, bool hasOfficialList, bool hasThirdPartyLists) :
+		m_HasOfficialList(hasOfficialList), m_HasThirdPartyLists(hasThirdPartyLists)
+	{
+		playerList.ForEachFile(
+			[&](const ConfigFileName& fileName, const PlayerMap_t& players)
+			{
+				for (const auto& [id, data] : players)
+					m_Players[id].push_back({ &fileName, &data });
+			},
+			[&](const ConfigFileName& fileName, const CompactPlayerList& players)
+			{
+				for (const auto& record : players.GetRecords())
+					m_Players[SteamID(record.m_SteamID)].push_back({ &fileName, nullptr, &players, &record });
+			});
+	}
+
+	std::span<const Entry> Find(const SteamID& id) const
+	{
+		if (auto found = m_Players.find(id); found != m_Players.end())
+			return found->second;
+
+		return {};
+	}
+
+	// Only needed when entries are added. The maps never move them, and changes to the data are
+	// seen through the pointers.
+	void Refresh(const PlayerListJSON& playerList, const SteamID& id)
+	{
+		std::vector<Entry> entries;
+		playerList.ForEachFile(
+			[&](const ConfigFileName& fileName, const PlayerMap_t& players)
+			{
+				if (auto found = players.find(id); found != players.end())
+					entries.push_back({ &fileName, &found->second });
+			},
+			[&](const ConfigFileName& fileName, const CompactPlayerList& players)
+			{
+				if (auto found = players.Find(id))
+					entries.push_back({ &fileName, nullptr, &players, found });
+			});
+
+		if (entries.empty())
+			m_Players.erase(id);
+		else
+			m_Players[id] = std::move(entries);
+	}
+
+	bool m_HasOfficialList;
+	bool m_HasThirdPartyLists;
+
+private:
+	std::unordered_map<SteamID, std::vector<Entry>> m_Players;
+};
+
+auto PlayerListJSON::GetPlayerIndex() const -> std::shared_ptr<const PlayerIndex>
+{
+	// The official and third party lists finish loading asynchronously
+	const bool hasOfficialList = m_CFGGroup.m_OfficialList.try_get() != nullptr;
+	const bool hasThirdPartyLists = m_CFGGroup.m_ThirdPartyLists.try_get() != nullptr;
+
+	if (!m_PlayerIndex ||
+		m_PlayerIndex->m_HasOfficialList != hasOfficialList ||
+		m_PlayerIndex->m_HasThirdPartyLists != hasThirdPartyLists)
+	{
+		m_PlayerIndex = std::make_shared<PlayerIndex>(*this, hasOfficialList, hasThirdPartyLists);
+		m_PlayerIndexVersion++;
+	}
+
+	return m_PlayerIndex;
+}
+
+uint64_t PlayerListJSON::GetFilesVersion() const
+{
+	// The index is thrown away and rebuilt whenever any file is (re)loaded
+	GetPlayerIndex();
+	return m_PlayerIndexVersion;
+}
+
+std::error_condition PlayerListJSON::WritePrebuiltCache(const std::filesystem::path& filename,
+	const std::filesystem::path& cachePath)
+{
+	PlayerListFile file;
+	return file.WritePrebuiltCache(filename, cachePath);
+}
+
+void PlayerListJSON::ForEachFile(const std::function<void(const ConfigFileName& fileName, const PlayerMap_t& players)>& mutableFunc,
+	const std::function<void(const ConfigFileName& fileName, const CompactPlayerList& players)>& readOnlyFunc) const
+{
+	if (m_CFGGroup.m_UserList.has_value())
+		mutableFunc(m_CFGGroup.m_UserList->GetName(), m_CFGGroup.m_UserList->m_Players);
+
+	if (auto list = m_CFGGroup.m_ThirdPartyLists.try_get())
+	{
+		for (auto& file : *list)
+			readOnlyFunc(file.first, file.second);
+	}
+
+	if (auto list = m_CFGGroup.m_OfficialList.try_get())
+		mutableFunc(list->GetName(), list->m_Players);
+}
+
+PlayerListJSON::CompactPlayerList::CompactPlayerList(const PlayerMap_t& players)
+{
+	// Already sorted by SteamID
+	m_Records.reserve(players.size());
+	for (const auto& [id, data] : players)
+	{
+		Record& record = m_Records.emplace_back();
+		record.m_SteamID = id.ID64;
+		record.m_Attributes = PackAttributes(data.m_SavedAttributes);
+		record.m_LastSeenTime = 0;
+		record.m_NameOffset = 0;
+		record.m_NameLength = 0;
+
+		if (data.m_LastSeen)
+		{
+			record.m_LastSeenTime = uint32_t(std::chrono::duration_cast<std::chrono::seconds>(
+				data.m_LastSeen->m_Time.time_since_epoch()).count());
+
+			const auto name = data.m_LastSeen->m_PlayerName.view().substr(0, UINT16_MAX);
+			record.m_NameOffset = uint32_t(m_Names.size());
+			record.m_NameLength = uint16_t(name.size());
+			m_Names.append(name);
+		}
+	}
+
+	m_Names.shrink_to_fit();
+	m_TrackedMemory.SetBytes(m_Records.capacity() * sizeof(Record) + m_Names.capacity());
+}
+
+auto PlayerListJSON::CompactPlayerList::Find(const SteamID& id) const -> const Record*
+{
+	auto found = std::lower_bound(m_Records.begin(), m_Records.end(), id.ID64,
+		[](const Record& record, uint64_t id64) { return record.m_SteamID < id64; });
+
+	if (found == m_Records.end() || found->m_SteamID != id.ID64)
+		return nullptr;
+
+	return &*found;
+}
+
+PlayerAttributesList PlayerListJSON::CompactPlayerList::GetAttributes(const Record& record)
+{
+	return PlayerAttributesList(PlayerAttributesList::bits_t(record.m_Attributes));
+}
+
+PlayerListData PlayerListJSON::CompactPlayerList::GetData(const Record& record) const
+{
+	PlayerListData retVal{ SteamID(record.m_SteamID) };
+	retVal.m_SavedAttributes = GetAttributes(record);
+
+	if (record.m_LastSeenTime)
+	{
+		auto& lastSeen = retVal.m_LastSeen.emplace();
+		lastSeen.m_Time = std::chrono::system_clock::time_point(std::chrono::seconds(record.m_LastSeenTime));
+		lastSeen.m_PlayerName = InternedString(std::string_view(m_Names).substr(record.m_NameOffset, record.m_NameLength));
+	}
+
+	return retVal;
+}
+
 bool PlayerListJSON::LoadFiles()
 {
+	// Don't lose anything that was still waiting to be saved
+	if (m_FirstUnsavedChange)
+		SaveFiles();
+	else
+		WaitForSave();
+
+	m_PlayerIndex.reset();
 	m_CFGGroup.LoadFiles();
+	ReplayJournal();
 
 	if (m_CFGGroup.IsOfficial())
 	{
@@ -212,82 +782,271 @@ bool PlayerListJSON::LoadFiles()
 		}
 
 		if (action != ModifyPlayerAction::NoChanges)
-			m_CFGGroup.SaveFiles();
+			QueueSave(false);
+
+		// OnPlayerDataChanged() may have added players to the local list
+		m_PlayerIndex.reset();
 	}
 
 	return true;
 }
 
-void PlayerListJSON::SaveFiles() const
+void PlayerListJSON::Update()
 {
-	m_CFGGroup.SaveFiles();
+	// One at a time, anything changed since it started goes in the next one
+	if (m_SaveTask.valid() && !m_SaveTask.is_ready())
+		return;
+
+	if (!m_FirstUnsavedChange)
+	{
+		// Only with all of our own changes on disk, so none of them are lost
+		if (m_CFGGroup.ReloadChangedFiles())
+			m_PlayerIndex.reset();
+
+		return;
+	}
+
+	const auto now = tfbd_clock_t::now();
+	if (m_HasUnjournaledChanges)
+	{
+		if ((now - m_LastUnsavedChange) < SAVE_DELAY && (now - *m_FirstUnsavedChange) < MAX_SAVE_DELAY)
+			return;
+	}
+	else if ((now - *m_FirstUnsavedChange) < COMPACT_INTERVAL && m_JournalRecords < COMPACT_JOURNAL_RECORDS)
+	{
+		return; // Already safe on disk
+	}
+
+	// Copy them here, since they keep changing while the copies are written out
+	std::vector<std::pair<std::filesystem::path, PlayerListFile>> files;
+	for (const auto& [filename, file] : m_CFGGroup.GetFilesToSave())
+		files.emplace_back(filename, *file);
+
+	m_FirstUnsavedChange.reset();
+	m_HasUnjournaledChanges = false;
+	RotateJournal();
+	m_CFGGroup.MarkFilesSaved();
+	m_SaveTask = SaveFilesAsync(std::move(files));
 }
 
-auto PlayerListJSON::FindPlayerData(const SteamID& id) const ->
-	mh::generator<std::pair<const ConfigFileName&, const PlayerListData&>>
+void PlayerListJSON::SaveFiles()
 {
-	if (m_CFGGroup.m_UserList.has_value())
+	WaitForSave();
+	m_FirstUnsavedChange.reset();
+	m_HasUnjournaledChanges = false;
+	RotateJournal();
+
+	// SaveFile() logs anything that went wrong
+	bool succeeded = true;
+	for (const auto& [filename, file] : m_CFGGroup.GetFilesToSave())
+	{
+		if (file->SaveFile(filename))
+			succeeded = false;
+	}
+
+	m_CFGGroup.MarkFilesSaved();
+
+	if (succeeded)
 	{
-		if (auto found = m_CFGGroup.m_UserList->m_Players.find(id);
-			found != m_CFGGroup.m_UserList->m_Players.end())
+		std::error_code ec;
+		std::filesystem::remove(GetJournalPath(JOURNAL_OLD_FILENAME), ec);
+	}
+}
+
+void PlayerListJSON::QueueSave(bool journaled)
+{
+	const auto now = tfbd_clock_t::now();
+	if (!m_FirstUnsavedChange)
+		m_FirstUnsavedChange = now;
+
+	m_LastUnsavedChange = now;
+	if (!journaled)
+		m_HasUnjournaledChanges = true;
+}
+
+bool PlayerListJSON::AppendToJournal(const PlayerListData& data, bool official)
+{
+	try
+	{
+		if (!m_Journal.is_open())
 		{
-			co_yield { m_CFGGroup.m_UserList->GetName(), found->second };
+			const auto path = GetJournalPath(JOURNAL_FILENAME);
+
+			// If we crashed partway through a line last time, don't add on to the end of it
+			std::error_code ec;
+			const bool needsNewline = std::filesystem::file_size(path, ec) > 0 && !ec;
+
+			m_Journal.open(path, std::ios::binary | std::ios::app);
+			if (!m_Journal)
+				throw std::runtime_error(mh::format("Failed to open {}", path));
+
+			if (needsNewline)
+				m_Journal << '\n';
 		}
+
+		nlohmann::json j{ { "player", data } };
+		if (official)
+			j["official"] = true;
+
+		m_Journal << j.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore) << '\n';
+		m_Journal.flush();
+		if (!m_Journal)
+			throw std::runtime_error(mh::format("Failed to write to {}", JOURNAL_FILENAME));
+
+		m_JournalRecords++;
+		return true;
 	}
-	if (auto list = m_CFGGroup.m_ThirdPartyLists.try_get())
+	catch (...)
 	{
-		for (auto& file : *list)
+		LogException("Failed to append to the playerlist journal, saving the whole playerlist instead");
+		m_Journal.close();
+		return false;
+	}
+}
+
+void PlayerListJSON::ReplayJournal()
+{
+	size_t replayed = 0;
+
+	// Oldest first, so the last change to each player wins
+	for (const char* filename : { JOURNAL_OLD_FILENAME, JOURNAL_FILENAME })
+	{
+		std::ifstream file(GetJournalPath(filename), std::ios::binary);
+		std::string line;
+		while (std::getline(file, line))
 		{
-			if (auto found = file.second.find(id); found != file.second.end())
-				co_yield { file.first, found->second };
+			if (line.empty())
+				continue;
+
+			try
+			{
+				const auto record = nlohmann::json::parse(line);
+
+				// Only written while IsOfficial()
+				const bool official = record.value("official", false);
+				if (official && !m_CFGGroup.IsOfficial())
+					continue;
+
+				const auto& player = record.at("player");
+				const SteamID steamID = player.at("steamid");
+				auto& list = official ? m_CFGGroup.GetDefaultMutableList() : m_CFGGroup.GetLocalList();
+				player.get_to(list.GetOrAddPlayer(steamID));
+				replayed++;
+			}
+			catch (...)
+			{
+				// Probably the last line, cut off by a crash
+				LogException("Skipping a malformed line in {}", filename);
+			}
 		}
 	}
-	if (auto list = m_CFGGroup.m_OfficialList.try_get())
+
+	if (replayed > 0)
+	{
+		Log("Replayed {} playerlist changes that hadn't been compacted yet", replayed);
+		m_JournalRecords = replayed;
+		QueueSave(true);
+	}
+}
+
+void PlayerListJSON::RotateJournal()
+{
+	m_Journal.close();
+	m_JournalRecords = 0;
+
+	const auto path = GetJournalPath(JOURNAL_FILENAME);
+	const auto oldPath = GetJournalPath(JOURNAL_OLD_FILENAME);
+
+	std::error_code ec;
+	if (const auto size = std::filesystem::file_size(path, ec); ec || size == 0)
+		return;
+
+	if (!std::filesystem::exists(oldPath, ec))
 	{
-		if (auto found = list->m_Players.find(id); found != list->m_Players.end())
+		std::filesystem::rename(path, oldPath, ec);
+	}
+	else
+	{
+		// The last compaction didn't make it to disk, so everything in there is still needed too
 		{
-			co_yield { list->GetName(), found->second };
+			std::ifstream current(path, std::ios::binary);
+			std::ofstream old(oldPath, std::ios::binary | std::ios::app);
+			old << '\n' << current.rdbuf();
+			if (!old)
+				ec = std::make_error_code(std::errc::io_error);
 		}
+
+		if (!ec)
+			std::filesystem::remove(path, ec);
 	}
+
+	// The journal just keeps growing, and everything in it gets replayed again next time
+	if (ec)
+		LogError("Failed to move {} to {}: {}", path, oldPath, ec);
 }
 
-auto PlayerListJSON::FindPlayerAttributes(const SteamID& id, AttributePersistence persistence) const ->
-	mh::generator<std::pair<const ConfigFileName&, PlayerAttributesList>>
+void PlayerListJSON::WaitForSave()
+{
+	if (m_SaveTask.valid())
+		m_SaveTask.wait();
+}
+
+mh::task<> PlayerListJSON::SaveFilesAsync(std::vector<std::pair<std::filesystem::path, PlayerListFile>> files)
 {
-	for (auto& [fileName, found] : FindPlayerData(id))
+	co_await m_SaveThread.co_add_task();
+
+	// SaveFile() logs anything that went wrong
+	bool succeeded = true;
+	for (const auto& [filename, file] : files)
 	{
-		PlayerAttributesList attr;
+		if (file.SaveFile(filename))
+			succeeded = false;
+	}
+
+	// Everything that was in it is in the lists now
+	if (succeeded)
+	{
+		std::error_code ec;
+		std::filesystem::remove(GetJournalPath(JOURNAL_OLD_FILENAME), ec);
+	}
+}
 
-		switch (persistence)
+auto PlayerListJSON::FindPlayerData(const SteamID& id) const ->
+	mh::generator<std::pair<const ConfigFileName&, const PlayerListData&>>
+{
+	const auto index = GetPlayerIndex();
+	for (const auto& entry : index->Find(id))
+	{
+		if (entry.m_Data)
 		{
-		default:
-			LogError("Unknown persistence {}", mh::enum_fmt(persistence));
-			[[fallthrough]];
-		case AttributePersistence::Any:
-			attr = found.GetAttributes();
-			break;
-		case AttributePersistence::Saved:
-			attr = found.m_SavedAttributes;
-			break;
-		case AttributePersistence::Transient:
-			attr = found.m_TransientAttributes;
-			break;
+			co_yield { *entry.m_FileName, *entry.m_Data };
+		}
+		else
+		{
+			const PlayerListData data = entry.m_List->GetData(*entry.m_Record);
+			co_yield { *entry.m_FileName, data };
 		}
-
-		co_yield { fileName, attr };
 	}
 }
 
+auto PlayerListJSON::FindPlayerAttributes(const SteamID& id, AttributePersistence persistence) const ->
+	mh::generator<std::pair<const ConfigFileName&, PlayerAttributesList>>
+{
+	const auto index = GetPlayerIndex();
+	for (const auto& entry : index->Find(id))
+		co_yield { *entry.m_FileName, entry.GetAttributes(persistence) };
+}
+
 PlayerMarks PlayerListJSON::GetPlayerAttributes(const SteamID& id) const
 {
 	if (id == m_Settings->GetLocalSteamID())
 		return {};
 
 	PlayerMarks marks;
-	for (const auto& [file, found] : FindPlayerAttributes(id))
+	for (const auto& entry : GetPlayerIndex()->Find(id))
 	{
-		if (found)
-			marks.m_Marks.push_back({ found, file });
+		if (auto found = entry.GetAttributes(AttributePersistence::Any))
+			marks.m_Marks.push_back({ found, *entry.m_FileName });
 	}
 
 	return marks;
@@ -299,11 +1058,10 @@ PlayerMarks PlayerListJSON::HasPlayerAttributes(const SteamID& id, const PlayerA
 		return {};
 
 	PlayerMarks marks;
-	for (const auto& [file, found] : FindPlayerAttributes(id, persistence))
+	for (const auto& entry : GetPlayerIndex()->Find(id))
 	{
-		auto attr = found & attributes;
-		if (attr)
-			marks.m_Marks.push_back({ attr, file });
+		if (auto attr = entry.GetAttributes(persistence) & attributes)
+			marks.m_Marks.push_back({ attr, *entry.m_FileName });
 	}
 
 	return marks;
@@ -331,13 +1089,24 @@ ModifyPlayerResult PlayerListJSON::ModifyPlayer(const SteamID& id,
 		defaultMutableData.m_SavedAttributes |= localPlayer.m_SavedAttributes;
 	}
 
+	if (m_PlayerIndex)
+		m_PlayerIndex->Refresh(*this, id);
+
 	const auto action = func(defaultMutableData);
 	if (action == ModifyPlayerAction::Modified)
 	{
 		OnPlayerDataChanged(defaultMutableData);
 		defaultMutableDataRef = defaultMutableData;
-		SaveFiles();
-		return ModifyPlayerResult::FileSaved;
+
+		bool journaled = AppendToJournal(defaultMutableDataRef, m_CFGGroup.IsOfficial());
+		if (m_CFGGroup.IsOfficial())
+		{
+			// OnPlayerDataChanged() may have moved attributes over to the local list
+			journaled = AppendToJournal(m_CFGGroup.GetLocalList().GetOrAddPlayer(id), false) && journaled;
+		}
+
+		QueueSave(journaled);
+		return ModifyPlayerResult::SaveQueued;
 	}
 	else if (action == ModifyPlayerAction::NoChanges)
 	{
@@ -382,6 +1151,23 @@ PlayerListData::~PlayerListData()
 {
 }
 
+PlayerListData::Proof::Proof(const nlohmann::json& json) :
+	m_Text(json.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore))
+{
+}
+
+auto PlayerListData::Proof::FromText(std::string text) -> Proof
+{
+	Proof retVal;
+	retVal.m_Text = std::move(text);
+	return retVal;
+}
+
+nlohmann::json PlayerListData::Proof::Parse() const
+{
+	return nlohmann::json::parse(m_Text);
+}
+
 bool PlayerListData::operator==(const PlayerListData& other) const
 #if _MSC_VER >= 1927
 = default;
@@ -435,7 +1221,7 @@ bool PlayerAttributesList::SetAttribute(PlayerAttribute attribute, bool set)
 
 void PlayerListJSON::ConfigFileGroup::CombineEntries(BaseClass::collection_type& map, const PlayerListFile& file) const
 {
-	map.push_back({ file.GetName(), file.m_Players });
+	map.emplace_back(file.GetName(), CompactPlayerList(file.m_Players));
 }
 
 bool PlayerMarks::Has(const PlayerAttributesList& attr) const
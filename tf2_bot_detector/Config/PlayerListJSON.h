@@ -1,16 +1,23 @@
 #pragma once
 
+#include "Clock.h"
 #include "ConfigHelpers.h"
 #include "ModeratorLogic.h"
 #include "SteamID.h"
+#include "Util/InternedString.h"
 
+#include <mh/concurrency/thread_pool.hpp>
 #include <mh/coroutine/generator.hpp>
+#include <mh/coroutine/task.hpp>
 #include <nlohmann/json_fwd.hpp>
 
 #include <bitset>
 #include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <functional>
 #include <map>
+#include <memory>
 #include <optional>
 
 namespace tf2_bot_detector
@@ -87,7 +94,7 @@ namespace tf2_bot_detector
 		struct LastSeen
 		{
 			std::chrono::system_clock::time_point m_Time;
-			std::string m_PlayerName;
+			InternedString m_PlayerName;
 
 			static std::optional<LastSeen> Latest(
 				const std::optional<LastSeen>& lhs, const std::optional<LastSeen>& rhs);
@@ -100,7 +107,24 @@ namespace tf2_bot_detector
 		};
 		std::optional<LastSeen> m_LastSeen;
 
-		std::vector<nlohmann::json> m_Proof;
+		// Only ever looked at when someone goes digging, so it's kept as (compact) json text rather
+		// than a json DOM for every entry of every list. Parse() it when it's actually needed.
+		class Proof final
+		{
+		public:
+			explicit Proof(const nlohmann::json& json);
+			static Proof FromText(std::string text);
+
+			nlohmann::json Parse() const;
+			const std::string& GetText() const { return m_Text; }
+
+			bool operator==(const Proof&) const = default;
+
+		private:
+			Proof() = default;
+			std::string m_Text;
+		};
+		std::vector<Proof> m_Proof;
 
 		bool operator==(const PlayerListData&) const;
 
@@ -112,7 +136,7 @@ namespace tf2_bot_detector
 	enum class ModifyPlayerResult
 	{
 		NoChanges,
-		FileSaved,
+		SaveQueued,
 	};
 
 	enum class ModifyPlayerAction
@@ -141,6 +165,8 @@ namespace tf2_bot_detector
 
 			PlayerAttributesList m_Attributes;
 			ConfigFileName m_FileName;
+
+			bool operator==(const Mark&) const = default;
 		};
 
 		bool Has(const PlayerAttributesList& attr) const;
@@ -154,15 +180,23 @@ namespace tf2_bot_detector
 		auto begin() const { return m_Marks.begin(); }
 		auto end() const { return m_Marks.end(); }
 		std::vector<Mark> m_Marks;
+
+		bool operator==(const PlayerMarks&) const = default;
 	};
 
 	class PlayerListJSON final
 	{
 	public:
 		PlayerListJSON(const Settings& settings);
+		~PlayerListJSON();
 
 		bool LoadFiles();
-		void SaveFiles() const;
+
+		// Changes made through ModifyPlayer() are appended to a journal right away, and only compacted
+		// into the lists themselves (in the background) every so often. SaveFiles() compacts right away,
+		// after waiting for any background save.
+		void Update();
+		void SaveFiles();
 
 		mh::generator<std::pair<const ConfigFileName&, const PlayerListData&>>
 			FindPlayerData(const SteamID& id) const;
@@ -177,6 +211,14 @@ namespace tf2_bot_detector
 
 		size_t GetPlayerCount() const { return m_CFGGroup.size(); }
 
+		// Changes whenever files are loaded or reloaded, which can change the attributes of any
+		// player. Changes made through ModifyPlayer() don't count.
+		uint64_t GetFilesVersion() const;
+
+		// --prebuild-config-cache <playerlist> <output>: run by the build for the official list
+		static std::error_condition WritePrebuiltCache(const std::filesystem::path& filename,
+			const std::filesystem::path& cachePath);
+
 	private:
 		const Settings* m_Settings = nullptr;
 
@@ -184,6 +226,44 @@ namespace tf2_bot_detector
 
 		using PlayerMap_t = std::map<SteamID, PlayerListData>;
 
+		// Third party lists are never modified or saved once they are combined, so they are kept as
+		// a sorted array of small fixed-size records instead of a map of full PlayerListData.
+		class CompactPlayerList final
+		{
+		public:
+			struct Record
+			{
+				uint64_t m_SteamID;
+				uint32_t m_LastSeenTime;  // Seconds since the epoch, 0 if never seen
+				uint32_t m_NameOffset;    // Into m_Names
+				uint16_t m_NameLength;
+				uint16_t m_Attributes;
+			};
+
+			CompactPlayerList() = default;
+			explicit CompactPlayerList(const PlayerMap_t& players);
+
+			const Record* Find(const SteamID& id) const;
+			PlayerListData GetData(const Record& record) const;
+			static PlayerAttributesList GetAttributes(const Record& record);
+
+			const std::vector<Record>& GetRecords() const { return m_Records; }
+			size_t size() const { return m_Records.size(); }
+
+		private:
+			std::vector<Record> m_Records;
+			std::string m_Names;
+			TrackedMemory m_TrackedMemory{ MemoryCategory::ConfigJSON };
+		};
+
+		// Every file's entries for a player in one lookup, in the same order as FindPlayerData()
+		class PlayerIndex;
+		mutable std::shared_ptr<PlayerIndex> m_PlayerIndex;
+		mutable uint64_t m_PlayerIndexVersion = 0;
+		std::shared_ptr<const PlayerIndex> GetPlayerIndex() const;
+		void ForEachFile(const std::function<void(const ConfigFileName& fileName, const PlayerMap_t& players)>& mutableFunc,
+			const std::function<void(const ConfigFileName& fileName, const CompactPlayerList& players)>& readOnlyFunc) const;
+
 		struct PlayerListFile final : public SharedConfigFileBase
 		{
 			void ValidateSchema(const ConfigSchemaInfo& schema) const override;
@@ -195,11 +275,41 @@ namespace tf2_bot_detector
 			PlayerListData& GetOrAddPlayer(const SteamID& id);
 
 			PlayerMap_t m_Players;
+
+		protected:
+			bool TryLoadCache(const std::filesystem::path& cachePath, uint64_t contentHash) override;
+			void SaveCache(const std::filesystem::path& cachePath, uint64_t contentHash) const override;
+			bool TryDeserializeStreaming(const std::string_view& text, nlohmann::json& header) override;
 		};
 
 		static constexpr int PLAYERLIST_SCHEMA_VERSION = 3;
 
-		struct ConfigFileGroup final : ConfigFileGroupBase<PlayerListFile, std::vector<std::pair<ConfigFileName, PlayerMap_t>>>
+		// For changes that aren't in the journal
+		static constexpr duration_t SAVE_DELAY = std::chrono::seconds(2);
+		static constexpr duration_t MAX_SAVE_DELAY = std::chrono::seconds(15);
+		void QueueSave(bool journaled);
+		void WaitForSave();
+		mh::task<> SaveFilesAsync(std::vector<std::pair<std::filesystem::path, PlayerListFile>> files);
+		std::optional<time_point_t> m_FirstUnsavedChange;
+		time_point_t m_LastUnsavedChange{};
+		bool m_HasUnjournaledChanges = false;
+
+		// One line of json per change, with the player's whole entry as it is afterwards. Replayed on
+		// top of the lists when they're loaded. When the lists are compacted, the journal is moved to
+		// JOURNAL_OLD_FILENAME first, and that is only deleted once the lists were all written out.
+		static constexpr char JOURNAL_FILENAME[] = "cfg/playerlist.journal";
+		static constexpr char JOURNAL_OLD_FILENAME[] = "cfg/playerlist.journal.old";
+		static constexpr duration_t COMPACT_INTERVAL = std::chrono::minutes(5);
+		static constexpr size_t COMPACT_JOURNAL_RECORDS = 1000;
+		bool AppendToJournal(const PlayerListData& data, bool official);
+		void ReplayJournal();
+		void RotateJournal();
+		std::ofstream m_Journal;
+		size_t m_JournalRecords = 0;  // Since the last compaction
+		mh::task<> m_SaveTask;
+		mh::thread_pool m_SaveThread{ 1 };
+
+		struct ConfigFileGroup final : ConfigFileGroupBase<PlayerListFile, std::vector<std::pair<ConfigFileName, CompactPlayerList>>>
 		{
 			using BaseClass = ConfigFileGroupBase;
 
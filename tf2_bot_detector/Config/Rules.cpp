@@ -1,21 +1,28 @@
 #include "Rules.h"
 #include "Networking/SteamAPI.h"
+#include "Util/AhoCorasick.h"
 #include "Util/JSONUtils.h"
+#include "Util/SimHash.h"
+#include "Util/TextFolding.h"
 #include "IPlayer.h"
 #include "Log.h"
 #include "PlayerListJSON.h"
 #include "Settings.h"
 
-#include <mh/text/case_insensitive_string.hpp>
 #include <mh/text/string_insertion.hpp>
 #include <mh/text/stringops.hpp>
 #include <mh/utility.hpp>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <iomanip>
+#include <iterator>
 #include <regex>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 
 using namespace std::string_literals;
 using namespace std::string_view_literals;
@@ -85,6 +92,11 @@ namespace tf2_bot_detector
 			j["personaname_text_match"] = *d.m_PersonanameTextMatch;
 			count++;
 		}
+		if (d.m_ChatMsgSimilarMatch)
+		{
+			j["chatmsg_similar_match"] = *d.m_ChatMsgSimilarMatch;
+			count++;
+		}
 
 		if (count > 1)
 			j["mode"] = d.m_Mode;
@@ -150,6 +162,27 @@ namespace tf2_bot_detector
 	void from_json(const nlohmann::json& j, AvatarMatch& d)
 	{
 		d.m_AvatarHash = mh::tolower(j.at("avatar_hash").get<std::string_view>());
+		d.ParseDigest();
+	}
+
+	void to_json(nlohmann::json& j, const ChatMsgSimilarMatch& d)
+	{
+		j =
+		{
+			{ "messages", d.m_Messages },
+		};
+
+		if (d.m_MaxDistance != ChatMsgSimilarMatch::DEFAULT_MAX_DISTANCE)
+			j["max_distance"] = d.m_MaxDistance;
+		if (d.m_RepeatCount != 0)
+			j["repeat_count"] = d.m_RepeatCount;
+	}
+	void from_json(const nlohmann::json& j, ChatMsgSimilarMatch& d)
+	{
+		try_get_to_defaulted(j, d.m_Messages, "messages");
+		try_get_to_defaulted(j, d.m_MaxDistance, "max_distance", ChatMsgSimilarMatch::DEFAULT_MAX_DISTANCE);
+		try_get_to_defaulted(j, d.m_RepeatCount, "repeat_count", 0u);
+		d.ComputeFingerprints();
 	}
 
 	void from_json(const nlohmann::json& j, TextMatch& d)
@@ -157,6 +190,7 @@ namespace tf2_bot_detector
 		d.m_Mode = j.at("mode");
 		d.m_Patterns = j.at("patterns").get<std::vector<std::string>>();
 		try_get_to_defaulted(j, d.m_CaseSensitive, "case_sensitive", false);
+		d.CompileRegexes();
 	}
 
 	void from_json(const nlohmann::json& j, ModerationRule::Triggers& d)
@@ -170,6 +204,8 @@ namespace tf2_bot_detector
 			d.m_UsernameTextMatch.emplace(TextMatch(*found));
 		if (auto found = j.find("personaname_text_match"); found != j.end())
 			d.m_PersonanameTextMatch.emplace(TextMatch(*found));
+		if (auto found = j.find("chatmsg_similar_match"); found != j.end())
+			d.m_ChatMsgSimilarMatch.emplace(ChatMsgSimilarMatch(*found));
 		if (auto found = j.find("avatar_match"); found != j.end())
 		{
 			if (found->is_array())
@@ -209,6 +245,7 @@ ModerationRules::ModerationRules(const Settings& settings) :
 
 bool ModerationRules::LoadFiles()
 {
+	m_RuleIndex.reset();
 	m_CFGGroup.LoadFiles();
 	return true;
 }
@@ -219,6 +256,12 @@ bool ModerationRules::SaveFile() const
 	return true;
 }
 
+void ModerationRules::Update()
+{
+	if (m_CFGGroup.ReloadChangedFiles())
+		m_RuleIndex.reset();
+}
+
 mh::generator<const ModerationRule&> tf2_bot_detector::ModerationRules::GetRules() const
 {
 	if (auto list = m_CFGGroup.m_OfficialList.try_get())
@@ -240,6 +283,547 @@ mh::generator<const ModerationRule&> tf2_bot_detector::ModerationRules::GetRules
 	}
 }
 
+namespace
+{
+	constexpr bool IsWordChar(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+	}
+
+	// All of the text triggers of every rule for one of the text fields (username, personaname, or chat message)
+	class TextTriggerIndex final
+	{
+	public:
+		void Add(size_t ruleIndex, const TextMatch& textMatch)
+		{
+			if (textMatch.m_Mode == TextMatchMode::Regex)
+			{
+				m_Unindexed.push_back({ ruleIndex, &textMatch });
+				return;
+			}
+
+			Automaton& automaton = textMatch.m_CaseSensitive ? m_CaseSensitive : m_Folded;
+			for (const auto& originalPattern : textMatch.m_Patterns)
+			{
+				const std::string pattern = textMatch.m_CaseSensitive ? originalPattern : FoldText(originalPattern);
+				if (pattern.empty())
+				{
+					// Every string starts with, ends with, and contains an empty string. No \w+ word is empty.
+					if (textMatch.m_Mode == TextMatchMode::Equal)
+						m_EmptyTextMatches.push_back(ruleIndex);
+					else if (textMatch.m_Mode != TextMatchMode::Word)
+						m_AlwaysMatches.push_back(ruleIndex);
+
+					continue;
+				}
+
+				// Can never be equal to a \w+ word
+				if (textMatch.m_Mode == TextMatchMode::Word && !std::all_of(pattern.begin(), pattern.end(), IsWordChar))
+					continue;
+
+				automaton.m_Matcher.AddPattern(pattern);
+				automaton.m_Patterns.push_back({ ruleIndex, textMatch.m_Mode });
+			}
+		}
+
+		void Build()
+		{
+			m_CaseSensitive.m_Matcher.Build();
+			m_Folded.m_Matcher.Build();
+		}
+
+		// Sets results[ruleIndex] for every rule whose trigger matches text. foldedText is FoldText(text).
+		void Evaluate(const std::string_view& text, const std::string_view& foldedText, std::vector<bool>& results) const
+		{
+			for (size_t ruleIndex : m_AlwaysMatches)
+				results[ruleIndex] = true;
+
+			if (text.empty())
+			{
+				for (size_t ruleIndex : m_EmptyTextMatches)
+					results[ruleIndex] = true;
+			}
+
+			m_CaseSensitive.Evaluate(text, results);
+			m_Folded.Evaluate(foldedText, results);
+
+			for (const auto& [ruleIndex, textMatch] : m_Unindexed)
+			{
+				if (!results[ruleIndex] && textMatch->Match(text))
+					results[ruleIndex] = true;
+			}
+		}
+
+	private:
+		struct PatternInfo
+		{
+			size_t m_RuleIndex;
+			TextMatchMode m_Mode;
+		};
+
+		struct Automaton
+		{
+			explicit Automaton(bool caseSensitive) : m_Matcher(caseSensitive) {}
+
+			void Evaluate(const std::string_view& text, std::vector<bool>& results) const
+			{
+				m_Matcher.ForEachMatch(text, [&](size_t patternIndex, size_t begin, size_t end)
+					{
+						const PatternInfo& info = m_Patterns[patternIndex];
+						if (results[info.m_RuleIndex])
+							return;
+
+						bool match = false;
+						switch (info.m_Mode)
+						{
+						case TextMatchMode::Equal:
+							match = (begin == 0) && (end == text.size());
+							break;
+						case TextMatchMode::Contains:
+							match = true;
+							break;
+						case TextMatchMode::StartsWith:
+							match = (begin == 0);
+							break;
+						case TextMatchMode::EndsWith:
+							match = (end == text.size());
+							break;
+						case TextMatchMode::Word:
+							match = (begin == 0 || !IsWordChar(text[begin - 1])) &&
+								(end == text.size() || !IsWordChar(text[end]));
+							break;
+						case TextMatchMode::Regex:
+							break; // Never indexed
+						}
+
+						if (match)
+							results[info.m_RuleIndex] = true;
+					});
+			}
+
+			AhoCorasick m_Matcher;
+			std::vector<PatternInfo> m_Patterns;
+		};
+
+		// Case insensitive patterns are matched against FoldText() of the text, so lookalike
+		// characters don't get around them. The patterns are stored folded as well.
+		Automaton m_CaseSensitive{ true };
+		Automaton m_Folded{ true };
+		std::vector<size_t> m_AlwaysMatches;
+		std::vector<size_t> m_EmptyTextMatches;
+		std::vector<std::pair<size_t, const TextMatch*>> m_Unindexed;
+	};
+
+	struct AvatarDigestHash
+	{
+		size_t operator()(const SteamAPI::AvatarHash& digest) const
+		{
+			// Already uniformly distributed
+			size_t result;
+			std::memcpy(&result, digest.data(), sizeof(result));
+			return result;
+		}
+	};
+
+	// All of the avatar triggers of every rule
+	class AvatarTriggerIndex final
+	{
+	public:
+		// Hashes that didn't parse can't match any avatar, so they're left out
+		void Add(size_t ruleIndex, const AvatarMatch& avatarMatch)
+		{
+			if (const auto& digest = avatarMatch.GetDigest())
+				m_Digests[*digest].push_back(ruleIndex);
+		}
+
+		// Sets results[ruleIndex] for every rule with an avatar trigger for avatarHash
+		void Evaluate(const SteamAPI::AvatarHash& avatarHash, std::vector<bool>& results) const
+		{
+			if (auto found = m_Digests.find(avatarHash); found != m_Digests.end())
+			{
+				for (size_t ruleIndex : found->second)
+					results[ruleIndex] = true;
+			}
+		}
+
+	private:
+		std::unordered_map<SteamAPI::AvatarHash, std::vector<size_t>, AvatarDigestHash> m_Digests;
+	};
+
+	// All of the chat message similarity triggers of every rule. The known spam fingerprints are
+	// kept in one flat array, so a message is checked against all of them in a single pass.
+	class ChatMsgSimilarTriggerIndex final
+	{
+	public:
+		void Add(size_t ruleIndex, const ChatMsgSimilarMatch& match)
+		{
+			for (uint64_t fingerprint : match.GetFingerprints())
+				m_Known.push_back({ fingerprint, match.m_MaxDistance, ruleIndex });
+
+			if (match.m_RepeatCount > 0)
+				m_Repeats.push_back({ ruleIndex, &match });
+		}
+
+		// Sets results[ruleIndex] for every rule whose trigger matches the message with fingerprint
+		void Evaluate(uint64_t fingerprint, std::span<const uint64_t> recentFingerprints, std::vector<bool>& results) const
+		{
+			for (const KnownFingerprint& known : m_Known)
+			{
+				if (GetSimHashDistance(known.m_Fingerprint, fingerprint) <= known.m_MaxDistance)
+					results[known.m_RuleIndex] = true;
+			}
+
+			for (const auto& [ruleIndex, match] : m_Repeats)
+			{
+				if (!results[ruleIndex] && match->MatchRepeats(fingerprint, recentFingerprints))
+					results[ruleIndex] = true;
+			}
+		}
+
+	private:
+		struct KnownFingerprint
+		{
+			uint64_t m_Fingerprint;
+			unsigned m_MaxDistance;
+			size_t m_RuleIndex;
+		};
+
+		std::vector<KnownFingerprint> m_Known;
+		std::vector<std::pair<size_t, const ChatMsgSimilarMatch*>> m_Repeats;
+	};
+}
+
+struct CompiledRules::TriggerIndices
+{
+	TextTriggerIndex m_Username;
+	TextTriggerIndex m_Personaname;
+	TextTriggerIndex m_ChatMsg;
+	AvatarTriggerIndex m_Avatar;
+	ChatMsgSimilarTriggerIndex m_ChatMsgSimilar;
+};
+
+CompiledRules::CompiledRules(std::vector<ModerationRule> rules) :
+	m_Indices(std::make_unique<TriggerIndices>()),
+	m_Rules(std::move(rules))
+{
+	m_Program.reserve(m_Rules.size());
+
+	for (size_t ruleIndex = 0; ruleIndex < m_Rules.size(); ruleIndex++)
+	{
+		const ModerationRule::Triggers& triggers = m_Rules[ruleIndex].m_Triggers;
+		CompiledRule& compiled = m_Program.emplace_back();
+		compiled.m_Triggers = 0;
+		compiled.m_MatchAll = (triggers.m_Mode == TriggerMatchMode::MatchAll);
+
+		if (triggers.m_UsernameTextMatch)
+		{
+			m_Indices->m_Username.Add(ruleIndex, *triggers.m_UsernameTextMatch);
+			compiled.m_Triggers |= TRIGGER_USERNAME;
+		}
+		if (triggers.m_PersonanameTextMatch)
+		{
+			m_Indices->m_Personaname.Add(ruleIndex, *triggers.m_PersonanameTextMatch);
+			compiled.m_Triggers |= TRIGGER_PERSONANAME;
+		}
+		if (triggers.m_ChatMsgTextMatch)
+		{
+			m_Indices->m_ChatMsg.Add(ruleIndex, *triggers.m_ChatMsgTextMatch);
+			compiled.m_Triggers |= TRIGGER_CHATMSG;
+		}
+		if (!triggers.m_AvatarMatches.empty())
+		{
+			for (const AvatarMatch& avatarMatch : triggers.m_AvatarMatches)
+				m_Indices->m_Avatar.Add(ruleIndex, avatarMatch);
+
+			compiled.m_Triggers |= TRIGGER_AVATAR;
+		}
+		if (triggers.m_ChatMsgSimilarMatch)
+		{
+			m_Indices->m_ChatMsgSimilar.Add(ruleIndex, *triggers.m_ChatMsgSimilarMatch);
+			compiled.m_Triggers |= TRIGGER_CHATMSG_SIMILAR;
+		}
+
+		if (!compiled.m_MatchAll && triggers.m_Mode != TriggerMatchMode::MatchAny)
+		{
+			LogError(MH_SOURCE_LOCATION_CURRENT(), "Unexpected mode {} for rule {}",
+				mh::enum_fmt(triggers.m_Mode), std::quoted(m_Rules[ruleIndex].m_Description));
+			compiled.m_Triggers = 0; // Never matches
+		}
+
+		// MatchAny rules with something besides chat triggers show up in both
+		m_AllRules.push_back(ruleIndex);
+		if (compiled.m_Triggers & CHAT_TRIGGERS)
+			m_ChatRules.push_back(ruleIndex);
+		if (compiled.m_MatchAll ? (compiled.m_Triggers != 0 && !(compiled.m_Triggers & CHAT_TRIGGERS)) :
+			(compiled.m_Triggers & ~CHAT_TRIGGERS) != 0)
+		{
+			m_StatusRules.push_back(ruleIndex);
+		}
+
+		if (compiled.m_Triggers & (TRIGGER_PERSONANAME | TRIGGER_AVATAR))
+			m_NeedsSummary = true;
+		if (compiled.m_Triggers & TRIGGER_CHATMSG_SIMILAR)
+			m_HasChatMsgSimilarTriggers = true;
+	}
+
+	m_Indices->m_Username.Build();
+	m_Indices->m_Personaname.Build();
+	m_Indices->m_ChatMsg.Build();
+}
+
+CompiledRules::CompiledRules(CompiledRules&&) noexcept = default;
+CompiledRules& CompiledRules::operator=(CompiledRules&&) noexcept = default;
+CompiledRules::~CompiledRules() = default;
+
+auto CompiledRules::GetPlayerInputs(const IPlayer& player) const -> PlayerInputs
+{
+	PlayerInputs inputs;
+	inputs.m_Name = player.GetNameUnsafe();
+	inputs.m_FoldedName = FoldText(inputs.m_Name);
+
+	// Only look at the summary if something cares about it
+	if (m_NeedsSummary)
+	{
+		if (const auto& summary = player.GetPlayerSummary())
+		{
+			inputs.m_HasSummary = true;
+			inputs.m_Personaname = summary->m_Nickname;
+			inputs.m_FoldedPersonaname = FoldText(inputs.m_Personaname);
+			inputs.m_AvatarHash = summary->m_AvatarHash;
+		}
+	}
+
+	return inputs;
+}
+
+void CompiledRules::EvaluatePlayer(const IPlayer& player, PlayerResults& results) const
+{
+	EvaluatePlayer(GetPlayerInputs(player), results);
+}
+
+void CompiledRules::EvaluatePlayer(const PlayerInputs& inputs, PlayerResults& results) const
+{
+	results.m_Username.assign(size(), false);
+	results.m_Personaname.assign(size(), false);
+	results.m_Avatar.assign(size(), false);
+
+	if (!inputs.m_Name.empty())
+		m_Indices->m_Username.Evaluate(inputs.m_Name, inputs.m_FoldedName, results.m_Username);
+
+	if (inputs.m_HasSummary)
+	{
+		m_Indices->m_Personaname.Evaluate(inputs.m_Personaname, inputs.m_FoldedPersonaname, results.m_Personaname);
+		m_Indices->m_Avatar.Evaluate(inputs.m_AvatarHash, results.m_Avatar);
+	}
+}
+
+void CompiledRules::EvaluateChatMsg(const std::string_view& chatMsg, std::span<const uint64_t> recentChatFingerprints,
+	std::vector<bool>& chatMsgResults, std::vector<bool>& chatMsgSimilarResults) const
+{
+	chatMsgResults.assign(size(), false);
+	chatMsgSimilarResults.assign(size(), false);
+	if (chatMsg.empty() || m_ChatRules.empty())
+		return;
+
+	m_Indices->m_ChatMsg.Evaluate(chatMsg, FoldText(chatMsg), chatMsgResults);
+
+	if (m_HasChatMsgSimilarTriggers)
+		m_Indices->m_ChatMsgSimilar.Evaluate(ComputeSimHash(chatMsg), recentChatFingerprints, chatMsgSimilarResults);
+}
+
+void CompiledRules::MatchRules(const std::vector<size_t>& ruleIndices, const PlayerResults& playerResults,
+	const std::vector<bool>& chatMsgResults, const std::vector<bool>& chatMsgSimilarResults,
+	std::vector<size_t>& matches) const
+{
+	for (size_t i : ruleIndices)
+	{
+		const CompiledRule& rule = m_Program[i];
+
+		uint8_t matched = 0;
+		if (playerResults.m_Username[i])
+			matched |= TRIGGER_USERNAME;
+		if (playerResults.m_Personaname[i])
+			matched |= TRIGGER_PERSONANAME;
+		if (chatMsgResults[i])
+			matched |= TRIGGER_CHATMSG;
+		if (playerResults.m_Avatar[i])
+			matched |= TRIGGER_AVATAR;
+		if (chatMsgSimilarResults[i])
+			matched |= TRIGGER_CHATMSG_SIMILAR;
+
+		// Every trigger that isn't set is ignored, and a rule without any triggers never matches
+		matched &= rule.m_Triggers;
+		if (rule.m_MatchAll ? (rule.m_Triggers != 0 && matched == rule.m_Triggers) : (matched != 0))
+			matches.push_back(i);
+	}
+}
+
+void CompiledRules::FindMatches(const PlayerResults& playerResults, const std::string_view& chatMsg,
+	std::vector<size_t>& matches, std::span<const uint64_t> recentChatFingerprints) const
+{
+	std::vector<bool> chatMsgResults;
+	std::vector<bool> chatMsgSimilarResults;
+	EvaluateChatMsg(chatMsg, recentChatFingerprints, chatMsgResults, chatMsgSimilarResults);
+
+	// Without a chat message, the chat-only rules can't match
+	MatchRules(chatMsg.empty() ? m_StatusRules : m_AllRules, playerResults, chatMsgResults, chatMsgSimilarResults, matches);
+}
+
+void CompiledRules::FindChatMatches(const PlayerResults& playerResults, const std::string_view& chatMsg,
+	std::vector<size_t>& matches, std::span<const uint64_t> recentChatFingerprints) const
+{
+	if (chatMsg.empty() || m_ChatRules.empty())
+		return;
+
+	std::vector<bool> chatMsgResults;
+	std::vector<bool> chatMsgSimilarResults;
+	EvaluateChatMsg(chatMsg, recentChatFingerprints, chatMsgResults, chatMsgSimilarResults);
+	MatchRules(m_ChatRules, playerResults, chatMsgResults, chatMsgSimilarResults, matches);
+}
+
+void CompiledRules::FindMatches(const IPlayer& player, const std::string_view& chatMsg, std::vector<size_t>& matches,
+	std::span<const uint64_t> recentChatFingerprints) const
+{
+	PlayerResults playerResults;
+	EvaluatePlayer(player, playerResults);
+	FindMatches(playerResults, chatMsg, matches, recentChatFingerprints);
+}
+
+class ModerationRules::RuleIndex final
+{
+public:
+	RuleIndex(const ModerationRules& rules, bool hasOfficialList, bool hasThirdPartyLists, uint64_t generation) :
+		m_HasOfficialList(hasOfficialList), m_HasThirdPartyLists(hasThirdPartyLists), m_Generation(generation),
+		m_Rules(CopyRules(rules))
+	{
+	}
+
+	bool m_HasOfficialList;
+	bool m_HasThirdPartyLists;
+	uint64_t m_Generation;
+	CompiledRules m_Rules;
+
+private:
+	// Copied so that reloading the files can't pull them out from under anyone still using the index
+	static std::vector<ModerationRule> CopyRules(const ModerationRules& rules)
+	{
+		std::vector<ModerationRule> retVal;
+		retVal.reserve(rules.GetRuleCount());
+		for (const ModerationRule& rule : rules.GetRules())
+			retVal.push_back(rule);
+
+		return retVal;
+	}
+};
+
+auto ModerationRules::GetRuleIndex() -> std::shared_ptr<const RuleIndex>
+{
+	// The official and third party lists finish loading asynchronously
+	const bool hasOfficialList = m_CFGGroup.m_OfficialList.try_get() != nullptr;
+	const bool hasThirdPartyLists = m_CFGGroup.m_ThirdPartyLists.try_get() != nullptr;
+
+	if (!m_RuleIndex ||
+		m_RuleIndex->m_HasOfficialList != hasOfficialList ||
+		m_RuleIndex->m_HasThirdPartyLists != hasThirdPartyLists ||
+		m_RuleIndex->m_Rules.size() != GetRuleCount())
+	{
+		m_RuleIndex = std::make_shared<RuleIndex>(*this, hasOfficialList, hasThirdPartyLists, ++m_RuleIndexGeneration);
+	}
+
+	return m_RuleIndex;
+}
+
+auto ModerationRules::GetPlayerMatchCache(const RuleIndex& index, const IPlayer& player) -> const PlayerMatchCache&
+{
+	const auto name = player.GetNameUnsafe();
+	const auto& summary = player.GetPlayerSummary();
+
+	const std::hash<std::string_view> hasher{};
+	const size_t nameHash = hasher(name);
+	const size_t personanameHash = summary ? hasher(summary->m_Nickname) : 0;
+	const size_t avatarHash = summary ? hasher(std::string_view(
+		reinterpret_cast<const char*>(summary->m_AvatarHash.data()), summary->m_AvatarHash.size())) : 0;
+
+	// Players from servers we left a long time ago would otherwise pile up forever
+	if (m_PlayerMatchCache.size() >= MAX_PLAYER_MATCH_CACHE_SIZE && !m_PlayerMatchCache.contains(player.GetSteamID()))
+		m_PlayerMatchCache.clear();
+
+	PlayerMatchCache& cache = m_PlayerMatchCache[player.GetSteamID()];
+	if (cache.m_IndexGeneration == index.m_Generation &&
+		cache.m_NameHash == nameHash &&
+		cache.m_HasSummary == bool(summary) &&
+		cache.m_PersonanameHash == personanameHash &&
+		cache.m_AvatarHash == avatarHash)
+	{
+		return cache;
+	}
+
+	cache.m_IndexGeneration = index.m_Generation;
+	cache.m_NameHash = nameHash;
+	cache.m_HasSummary = bool(summary);
+	cache.m_PersonanameHash = personanameHash;
+	cache.m_AvatarHash = avatarHash;
+
+	index.m_Rules.EvaluatePlayer(player, cache.m_Results);
+	cache.m_MatchedRules.clear();
+	index.m_Rules.FindMatches(cache.m_Results, {}, cache.m_MatchedRules);
+
+	return cache;
+}
+
+std::shared_ptr<const CompiledRules> ModerationRules::GetCompiledRules()
+{
+	auto index = GetRuleIndex();
+	return std::shared_ptr<const CompiledRules>(index, &index->m_Rules);
+}
+
+mh::generator<const ModerationRule&> ModerationRules::GetMatchingRules(const IPlayer& player, std::string_view chatMsg)
+{
+	const auto index = GetRuleIndex();
+	const PlayerMatchCache& cache = GetPlayerMatchCache(*index, player);
+
+	// Only the chat message triggers are new for every message, so only the rules with one are
+	// evaluated again. The matches are copied out of the cache, since it can change while we're suspended.
+	std::vector<size_t> matchedRules;
+	std::vector<size_t> chatMatchedRules;
+	if (chatMsg.empty())
+	{
+		matchedRules = cache.m_MatchedRules;
+	}
+	else if (!index->m_Rules.HasChatMsgSimilarTriggers())
+	{
+		index->m_Rules.FindChatMatches(cache.m_Results, chatMsg, chatMatchedRules);
+	}
+	else
+	{
+		if (m_RecentChatFingerprints.size() >= MAX_PLAYER_MATCH_CACHE_SIZE &&
+			!m_RecentChatFingerprints.contains(player.GetSteamID()))
+		{
+			m_RecentChatFingerprints.clear();
+		}
+
+		RecentChatFingerprints& recent = m_RecentChatFingerprints[player.GetSteamID()];
+		std::array<uint64_t, RecentChatFingerprints::CAPACITY> recentArray;
+		for (size_t i = 0; i < recent.size(); i++)
+			recentArray[i] = recent[i];
+
+		index->m_Rules.FindChatMatches(cache.m_Results, chatMsg, chatMatchedRules,
+			std::span(recentArray.data(), recent.size()));
+		recent.push_back(ComputeSimHash(chatMsg));
+	}
+
+	// Both are in rule order, and MatchAny rules with a chat trigger can be in both
+	if (!chatMsg.empty())
+	{
+		matchedRules.reserve(cache.m_MatchedRules.size() + chatMatchedRules.size());
+		std::set_union(cache.m_MatchedRules.begin(), cache.m_MatchedRules.end(),
+			chatMatchedRules.begin(), chatMatchedRules.end(), std::back_inserter(matchedRules));
+	}
+
+	for (size_t i : matchedRules)
+		co_yield index->m_Rules.GetRule(i);
+}
+
 void ModerationRules::RuleFile::ValidateSchema(const ConfigSchemaInfo& schema) const
 {
 	if (schema.m_Type != "rules")
@@ -272,67 +856,55 @@ void ModerationRules::ConfigFileGroup::CombineEntries(RuleList_t& list, const Ru
 
 bool TextMatch::Match(const std::string_view& text) const try
 {
+	// Case insensitive matches compare FoldText() copies, the same as CompiledRules does
+	const std::string foldedText = m_CaseSensitive ? std::string{} : FoldText(text);
+	const std::string_view matchText = m_CaseSensitive ? text : std::string_view(foldedText);
+
+	std::string foldedPattern;
+	const auto GetPattern = [&](const std::string& pattern) -> std::string_view
+	{
+		if (m_CaseSensitive)
+			return pattern;
+
+		foldedPattern = FoldText(pattern);
+		return foldedPattern;
+	};
+
 	switch (m_Mode)
 	{
 	case TextMatchMode::Equal:
 	{
-		return std::any_of(m_Patterns.begin(), m_Patterns.end(), [&](const std::string_view& pattern)
+		return std::any_of(m_Patterns.begin(), m_Patterns.end(), [&](const std::string& pattern)
 			{
-				if (m_CaseSensitive)
-					return text == pattern;
-				else
-					return mh::case_insensitive_compare(text, pattern);
+				return matchText == GetPattern(pattern);
 			});
 	}
 	case TextMatchMode::Contains:
 	{
-		return std::any_of(m_Patterns.begin(), m_Patterns.end(), [&](const std::string_view& pattern)
+		return std::any_of(m_Patterns.begin(), m_Patterns.end(), [&](const std::string& pattern)
 			{
-				if (m_CaseSensitive)
-					return text.find(pattern) != text.npos;
-				else
-					return mh::case_insensitive_view(text).find(mh::case_insensitive_view(pattern)) != text.npos;
+				return matchText.find(GetPattern(pattern)) != matchText.npos;
 			});
-		break;
 	}
 	case TextMatchMode::StartsWith:
 	{
-		return std::any_of(m_Patterns.begin(), m_Patterns.end(), [&](const std::string_view& pattern)
+		return std::any_of(m_Patterns.begin(), m_Patterns.end(), [&](const std::string& pattern)
 			{
-				if (m_CaseSensitive)
-					return text.starts_with(pattern);
-				else
-					return mh::case_insensitive_view(text).starts_with(mh::case_insensitive_view(pattern));
+				return matchText.starts_with(GetPattern(pattern));
 			});
 	}
 	case TextMatchMode::EndsWith:
 	{
-		return std::any_of(m_Patterns.begin(), m_Patterns.end(), [&](const std::string_view& pattern)
+		return std::any_of(m_Patterns.begin(), m_Patterns.end(), [&](const std::string& pattern)
 			{
-				if (m_CaseSensitive)
-					return text.ends_with(pattern);
-				else
-					return mh::case_insensitive_view(text).ends_with(mh::case_insensitive_view(pattern));
+				return matchText.ends_with(GetPattern(pattern));
 			});
 	}
 	case TextMatchMode::Regex:
 	{
-		return std::any_of(m_Patterns.begin(), m_Patterns.end(), [&](const std::string_view& pattern)
+		return std::any_of(m_Regexes.begin(), m_Regexes.end(), [&](const std::regex& r)
 			{
-				try
-				{
-					std::regex_constants::syntax_option_type options{};
-					if (!m_CaseSensitive)
-						options = std::regex_constants::icase;
-
-					std::regex r(pattern.begin(), pattern.end(), options);
-					return std::regex_match(text.begin(), text.end(), r);
-				}
-				catch (const std::regex_error&)
-				{
-					LogException("Regex error when trying to match {} against pattern {}", std::quoted(text), std::quoted(pattern));
-					return false;
-				}
+				return std::regex_match(text.begin(), text.end(), r);
 			});
 	}
 	case TextMatchMode::Word:
@@ -340,16 +912,13 @@ bool TextMatch::Match(const std::string_view& text) const try
 		static const std::regex s_WordRegex(R"regex((\w+))regex", std::regex::optimize);
 
 		const auto end = std::regex_iterator<std::string_view::const_iterator>{};
-		for (auto it = std::regex_iterator<std::string_view::const_iterator>(text.begin(), text.end(), s_WordRegex);
+		for (auto it = std::regex_iterator<std::string_view::const_iterator>(matchText.begin(), matchText.end(), s_WordRegex);
 			it != end; ++it)
 		{
 			const std::string_view itStr(&*it->operator[](0).first, it->operator[](0).length());
-			const auto anyMatches = std::any_of(m_Patterns.begin(), m_Patterns.end(), [&](const std::string_view& pattern)
+			const auto anyMatches = std::any_of(m_Patterns.begin(), m_Patterns.end(), [&](const std::string& pattern)
 				{
-					if (m_CaseSensitive)
-						return itStr == pattern;
-					else
-						return mh::case_insensitive_compare(itStr, pattern);
+					return itStr == GetPattern(pattern);
 				});
 
 			if (anyMatches)
@@ -368,6 +937,31 @@ catch (...)
 	throw;
 }
 
+void TextMatch::CompileRegexes()
+{
+	m_Regexes.clear();
+	if (m_Mode != TextMatchMode::Regex)
+		return;
+
+	std::regex_constants::syntax_option_type options = std::regex::optimize;
+	if (!m_CaseSensitive)
+		options |= std::regex_constants::icase;
+
+	m_Regexes.reserve(m_Patterns.size());
+	for (const auto& pattern : m_Patterns)
+	{
+		try
+		{
+			m_Regexes.emplace_back(pattern, options);
+		}
+		catch (const std::regex_error&)
+		{
+			// Reported once here, the pattern is simply skipped when matching
+			LogException("Ignoring invalid regex pattern {}", std::quoted(pattern));
+		}
+	}
+}
+
 bool ModerationRule::Match(const IPlayer& player) const
 {
 	return Match(player, std::string_view{});
@@ -533,18 +1127,25 @@ static constexpr void RunTests()
 	static_assert(!MatchRules(TriggerMatchMode::MatchAny, unset, unset, unset));
 }
 
-bool ModerationRule::Match(const IPlayer& player, const std::string_view& chatMsg) const
+// textMatchFunc(const TextMatch&, const std::string_view& text, bool ModerationRule::TextMatchResults::* result) -> bool
+// avatarMatchFunc(const SteamAPI::AvatarHash& avatarHash) -> bool
+// similarMatchFunc(const ChatMsgSimilarMatch&) -> bool
+template<typename TTextMatchFunc, typename TAvatarMatchFunc, typename TSimilarMatchFunc>
+static bool MatchRule(const ModerationRule::Triggers& triggers, const IPlayer& player, const std::string_view& chatMsg,
+	TTextMatchFunc&& textMatchFunc, TAvatarMatchFunc&& avatarMatchFunc, TSimilarMatchFunc&& similarMatchFunc)
 {
+	using Results = ModerationRule::TextMatchResults;
+
 	const auto usernameMatch = [&]()
 	{
-		if (!m_Triggers.m_UsernameTextMatch)
+		if (!triggers.m_UsernameTextMatch)
 			return MatchResult::Unset;
 
 		const auto name = player.GetNameUnsafe();
 		if (name.empty())
 			return MatchResult::NoMatch;
 
-		if (!m_Triggers.m_UsernameTextMatch->Match(name))
+		if (!textMatchFunc(*triggers.m_UsernameTextMatch, name, &Results::m_Username))
 			return MatchResult::NoMatch;
 
 		return MatchResult::Match;
@@ -552,14 +1153,14 @@ bool ModerationRule::Match(const IPlayer& player, const std::string_view& chatMs
 
 	const auto personanameMatch = [&]()
 	{
-		if (!m_Triggers.m_PersonanameTextMatch)
+		if (!triggers.m_PersonanameTextMatch)
 			return MatchResult::Unset;
 
 		const auto& summary = player.GetPlayerSummary();
 		if (!summary)
 			return MatchResult::NoMatch;
 
-		if (!m_Triggers.m_PersonanameTextMatch->Match(summary->m_Nickname))
+		if (!textMatchFunc(*triggers.m_PersonanameTextMatch, summary->m_Nickname, &Results::m_Personaname))
 			return MatchResult::NoMatch;
 
 		return MatchResult::Match;
@@ -567,13 +1168,13 @@ bool ModerationRule::Match(const IPlayer& player, const std::string_view& chatMs
 
 	const auto chatMsgMatch = [&]()
 	{
-		if (!m_Triggers.m_ChatMsgTextMatch)
+		if (!triggers.m_ChatMsgTextMatch)
 			return MatchResult::Unset;
 
 		if (chatMsg.empty())
 			return MatchResult::NoMatch;
 
-		if (!m_Triggers.m_ChatMsgTextMatch->Match(chatMsg))
+		if (!textMatchFunc(*triggers.m_ChatMsgTextMatch, chatMsg, &Results::m_ChatMsg))
 			return MatchResult::NoMatch;
 
 		return MatchResult::Match;
@@ -581,27 +1182,108 @@ bool ModerationRule::Match(const IPlayer& player, const std::string_view& chatMs
 
 	const auto avatarMatch = [&]()
 	{
-		if (m_Triggers.m_AvatarMatches.empty())
+		if (triggers.m_AvatarMatches.empty())
 			return MatchResult::Unset;
 
 		const auto& summary = player.GetPlayerSummary();
 		if (!summary)
 			return MatchResult::NoMatch;
 
-		for (const auto& m : m_Triggers.m_AvatarMatches)
-		{
-			if (m.Match(summary->m_AvatarHash))
-				return MatchResult::Match;
-		}
+		return avatarMatchFunc(summary->m_AvatarHash) ? MatchResult::Match : MatchResult::NoMatch;
+	};
+
+	const auto chatMsgSimilarMatch = [&]()
+	{
+		if (!triggers.m_ChatMsgSimilarMatch)
+			return MatchResult::Unset;
+
+		if (chatMsg.empty())
+			return MatchResult::NoMatch;
 
-		return MatchResult::NoMatch;
+		return similarMatchFunc(*triggers.m_ChatMsgSimilarMatch) ? MatchResult::Match : MatchResult::NoMatch;
 	};
 
+	return MatchRules(triggers.m_Mode, usernameMatch, chatMsgMatch, avatarMatch, personanameMatch, chatMsgSimilarMatch);
+}
+
+bool ModerationRule::Match(const IPlayer& player, const std::string_view& chatMsg) const
+{
+	return MatchRule(m_Triggers, player, chatMsg, [](const TextMatch& textMatch, const std::string_view& text, auto)
+		{
+			return textMatch.Match(text);
+		},
+		[&](const SteamAPI::AvatarHash& avatarHash)
+		{
+			return std::any_of(m_Triggers.m_AvatarMatches.begin(), m_Triggers.m_AvatarMatches.end(),
+				[&](const AvatarMatch& m) { return m.Match(avatarHash); });
+		},
+		[&](const ChatMsgSimilarMatch& similarMatch)
+		{
+			// No history of their earlier messages here, only known spam
+			return similarMatch.Match(ComputeSimHash(chatMsg));
+		});
+}
+
+bool ModerationRule::Match(const IPlayer& player, const std::string_view& chatMsg,
+	const TextMatchResults& textMatchResults) const
+{
+	return MatchRule(m_Triggers, player, chatMsg, [&](const TextMatch&, const std::string_view&, bool TextMatchResults::* result)
+		{
+			return textMatchResults.*result;
+		},
+		[&](const SteamAPI::AvatarHash&)
+		{
+			return textMatchResults.m_Avatar;
+		},
+		[&](const ChatMsgSimilarMatch&)
+		{
+			return textMatchResults.m_ChatMsgSimilar;
+		});
+}
+
+bool AvatarMatch::Match(const SteamAPI::AvatarHash& avatarHash) const
+{
+	return m_Digest && *m_Digest == avatarHash;
+}
 
-	return MatchRules(m_Triggers.m_Mode, usernameMatch, chatMsgMatch, avatarMatch, personanameMatch);
+void AvatarMatch::ParseDigest()
+{
+	m_Digest = SteamAPI::ParseAvatarHash(m_AvatarHash);
+
+	// Reported once here, the trigger simply never matches
+	if (!m_Digest)
+		LogWarning("Ignoring invalid avatar_hash {}, expected 40 hex characters", std::quoted(m_AvatarHash));
+}
+
+void ChatMsgSimilarMatch::ComputeFingerprints()
+{
+	m_Fingerprints.clear();
+	for (const auto& message : m_Messages)
+		m_Fingerprints.push_back(ComputeSimHash(message));
 }
 
-bool AvatarMatch::Match(const std::string_view& avatarHash) const
+bool ChatMsgSimilarMatch::Match(uint64_t fingerprint, std::span<const uint64_t> recentFingerprints) const
 {
-	return m_AvatarHash == avatarHash;
+	for (uint64_t known : m_Fingerprints)
+	{
+		if (GetSimHashDistance(known, fingerprint) <= m_MaxDistance)
+			return true;
+	}
+
+	return MatchRepeats(fingerprint, recentFingerprints);
+}
+
+bool ChatMsgSimilarMatch::MatchRepeats(uint64_t fingerprint, std::span<const uint64_t> recentFingerprints) const
+{
+	if (m_RepeatCount == 0)
+		return false;
+
+	unsigned count = 1; // This message
+	for (uint64_t recent : recentFingerprints)
+	{
+		if (GetSimHashDistance(recent, fingerprint) <= m_MaxDistance)
+			count++;
+	}
+
+	return count >= m_RepeatCount;
 }
\ No newline at end of file
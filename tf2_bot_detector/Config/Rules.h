@@ -1,12 +1,19 @@
 #pragma once
 #include "ConfigHelpers.h"
+#include "Util/RingBuffer.h"
+#include "SteamID.h"
 
 #include <mh/coroutine/generator.hpp>
 #include <mh/reflection/enum.hpp>
 #include <nlohmann/json_fwd.hpp>
 
+#include <array>
 #include <filesystem>
+#include <memory>
 #include <optional>
+#include <regex>
+#include <span>
+#include <unordered_map>
 #include <vector>
 
 namespace tf2_bot_detector
@@ -44,18 +51,65 @@ namespace tf2_bot_detector
 		bool m_CaseSensitive = false;
 
 		bool Match(const std::string_view& text) const;
+
+		// Compiles m_Patterns for TextMatchMode::Regex. This happens automatically when loading from json,
+		// but must be called again after changing m_Mode, m_Patterns, or m_CaseSensitive by hand.
+		void CompileRegexes();
+
+	private:
+		std::vector<std::regex> m_Regexes;
 	};
 
 	struct AvatarMatch
 	{
 		std::string m_AvatarHash;
 
-		bool Match(const std::string_view& avatarHash) const;
+		// Against a SteamAPI::AvatarHash, without Networking/SteamAPI.h to pull in here
+		bool Match(const std::array<uint8_t, 20>& avatarHash) const;
+
+		// Decodes m_AvatarHash. This happens automatically when loading from json, but must be called
+		// again after changing m_AvatarHash by hand. Empty if it isn't 40 hex characters, so it can't
+		// match anything.
+		void ParseDigest();
+		const std::optional<std::array<uint8_t, 20>>& GetDigest() const { return m_Digest; }
+
+	private:
+		std::optional<std::array<uint8_t, 20>> m_Digest;
 	};
 
 	void to_json(nlohmann::json& j, const AvatarMatch& d);
 	void from_json(const nlohmann::json& j, AvatarMatch& d);
 
+	// Chat messages that are near-duplicates of known spam, or of the player's own recent messages,
+	// going by ComputeSimHash()
+	struct ChatMsgSimilarMatch
+	{
+		static constexpr unsigned DEFAULT_MAX_DISTANCE = 8;
+		static constexpr size_t RECENT_MESSAGE_COUNT = 8;
+
+		std::vector<std::string> m_Messages;
+		unsigned m_MaxDistance = DEFAULT_MAX_DISTANCE; // How many bits of the fingerprints may differ
+
+		// If non-zero, also matches once this message and at least m_RepeatCount - 1 of the
+		// player's last RECENT_MESSAGE_COUNT messages are near-duplicates
+		unsigned m_RepeatCount = 0;
+
+		// Must be called after modifying m_Messages
+		void ComputeFingerprints();
+
+		// recentFingerprints are the player's earlier messages
+		bool Match(uint64_t fingerprint, std::span<const uint64_t> recentFingerprints = {}) const;
+		bool MatchRepeats(uint64_t fingerprint, std::span<const uint64_t> recentFingerprints) const;
+
+		const std::vector<uint64_t>& GetFingerprints() const { return m_Fingerprints; }
+
+	private:
+		std::vector<uint64_t> m_Fingerprints;
+	};
+
+	void to_json(nlohmann::json& j, const ChatMsgSimilarMatch& d);
+	void from_json(const nlohmann::json& j, ChatMsgSimilarMatch& d);
+
 	struct ModerationRule
 	{
 		std::string m_Description;
@@ -63,6 +117,17 @@ namespace tf2_bot_detector
 		bool Match(const IPlayer& player) const;
 		bool Match(const IPlayer& player, const std::string_view& chatMsg) const;
 
+		// Whether each text (and avatar) trigger matched, for when they have already been evaluated elsewhere
+		struct TextMatchResults
+		{
+			bool m_Username = false;
+			bool m_Personaname = false;
+			bool m_ChatMsg = false;
+			bool m_Avatar = false;
+			bool m_ChatMsgSimilar = false;
+		};
+		bool Match(const IPlayer& player, const std::string_view& chatMsg, const TextMatchResults& textMatchResults) const;
+
 		struct Triggers
 		{
 			TriggerMatchMode m_Mode = TriggerMatchMode::MatchAll;
@@ -71,6 +136,7 @@ namespace tf2_bot_detector
 			std::optional<TextMatch> m_PersonanameTextMatch;
 			std::optional<TextMatch> m_ChatMsgTextMatch;
 			std::vector<AvatarMatch> m_AvatarMatches;
+			std::optional<ChatMsgSimilarMatch> m_ChatMsgSimilarMatch;
 		} m_Triggers;
 
 
@@ -82,6 +148,91 @@ namespace tf2_bot_detector
 		} m_Actions;
 	};
 
+	// A list of rules compiled together. Each kind of trigger is evaluated once for all of the rules,
+	// then the results are combined per rule according to its TriggerMatchMode. Keeps its own copy
+	// of the rules, so it can be used from any thread while the files are reloaded.
+	class CompiledRules final
+	{
+	public:
+		explicit CompiledRules(std::vector<ModerationRule> rules);
+		CompiledRules(CompiledRules&&) noexcept;
+		CompiledRules& operator=(CompiledRules&&) noexcept;
+		~CompiledRules();
+
+		size_t size() const { return m_Rules.size(); }
+		const ModerationRule& GetRule(size_t index) const { return m_Rules[index]; }
+
+		// Everything about a player that the rules look at, so they can be evaluated without the player
+		struct PlayerInputs
+		{
+			std::string m_Name;
+			std::string m_FoldedName; // FoldText(m_Name), for the case insensitive triggers
+			bool m_HasSummary = false;
+			std::string m_Personaname;
+			std::string m_FoldedPersonaname;
+			std::array<uint8_t, 20> m_AvatarHash{}; // SteamAPI::AvatarHash
+		};
+		PlayerInputs GetPlayerInputs(const IPlayer& player) const;
+
+		// Results of every trigger that doesn't depend on a chat message
+		struct PlayerResults
+		{
+			std::vector<bool> m_Username;
+			std::vector<bool> m_Personaname;
+			std::vector<bool> m_Avatar;
+		};
+		void EvaluatePlayer(const IPlayer& player, PlayerResults& results) const;
+		void EvaluatePlayer(const PlayerInputs& inputs, PlayerResults& results) const;
+
+		// Appends the index of every matching rule, in order, to matches. recentChatFingerprints are
+		// the player's earlier chat messages, for ChatMsgSimilarMatch::m_RepeatCount.
+		void FindMatches(const PlayerResults& playerResults, const std::string_view& chatMsg, std::vector<size_t>& matches,
+			std::span<const uint64_t> recentChatFingerprints = {}) const;
+		void FindMatches(const IPlayer& player, const std::string_view& chatMsg, std::vector<size_t>& matches,
+			std::span<const uint64_t> recentChatFingerprints = {}) const;
+
+		// Like FindMatches(), but only looks at rules with a chat message trigger. Together with the
+		// matches for an empty chat message, that's everything FindMatches() would return for chatMsg.
+		void FindChatMatches(const PlayerResults& playerResults, const std::string_view& chatMsg,
+			std::vector<size_t>& matches, std::span<const uint64_t> recentChatFingerprints = {}) const;
+
+		bool HasChatMsgSimilarTriggers() const { return m_HasChatMsgSimilarTriggers; }
+
+	private:
+		// Which triggers a rule has, and which of them matched
+		enum TriggerBits : uint8_t
+		{
+			TRIGGER_USERNAME = 1 << 0,
+			TRIGGER_PERSONANAME = 1 << 1,
+			TRIGGER_CHATMSG = 1 << 2,
+			TRIGGER_AVATAR = 1 << 3,
+			TRIGGER_CHATMSG_SIMILAR = 1 << 4,
+		};
+
+		struct CompiledRule
+		{
+			uint8_t m_Triggers;
+			bool m_MatchAll;
+		};
+		static constexpr uint8_t CHAT_TRIGGERS = TRIGGER_CHATMSG | TRIGGER_CHATMSG_SIMILAR;
+
+		void MatchRules(const std::vector<size_t>& ruleIndices, const PlayerResults& playerResults,
+			const std::vector<bool>& chatMsgResults, const std::vector<bool>& chatMsgSimilarResults,
+			std::vector<size_t>& matches) const;
+		void EvaluateChatMsg(const std::string_view& chatMsg, std::span<const uint64_t> recentChatFingerprints,
+			std::vector<bool>& chatMsgResults, std::vector<bool>& chatMsgSimilarResults) const;
+
+		struct TriggerIndices;
+		std::unique_ptr<TriggerIndices> m_Indices;
+		std::vector<CompiledRule> m_Program;
+		std::vector<size_t> m_AllRules;
+		std::vector<size_t> m_StatusRules; // Rules that can match without a chat message
+		std::vector<size_t> m_ChatRules;   // Rules with a chat message trigger
+		std::vector<ModerationRule> m_Rules;
+		bool m_NeedsSummary = false;
+		bool m_HasChatMsgSimilarTriggers = false;
+	};
+
 	class ModerationRules
 	{
 	public:
@@ -90,10 +241,46 @@ namespace tf2_bot_detector
 		bool LoadFiles();
 		bool SaveFile() const;
 
+		// Picks up rule files that were edited while we're running
+		void Update();
+
 		mh::generator<const ModerationRule&> GetRules() const;
 		size_t GetRuleCount() const { return m_CFGGroup.size(); }
 
+		// Equivalent to filtering GetRules() with ModerationRule::Match(), except that all rules are
+		// evaluated together through CompiledRules. Results that don't depend on the chat message are
+		// remembered per player until their name, persona name, avatar or the rules change.
+		mh::generator<const ModerationRule&> GetMatchingRules(const IPlayer& player, std::string_view chatMsg = {});
+
+		// Replaced with a new instance whenever the rules change
+		std::shared_ptr<const CompiledRules> GetCompiledRules();
+
 	private:
+		class RuleIndex;
+		std::shared_ptr<const RuleIndex> m_RuleIndex;
+		std::shared_ptr<const RuleIndex> GetRuleIndex();
+		uint64_t m_RuleIndexGeneration = 0;
+
+		// Everything matching a player without a chat message depends on, and what came out of it
+		struct PlayerMatchCache
+		{
+			uint64_t m_IndexGeneration = 0;
+			size_t m_NameHash = 0;
+			size_t m_PersonanameHash = 0;
+			size_t m_AvatarHash = 0;
+			bool m_HasSummary = false;
+
+			CompiledRules::PlayerResults m_Results;
+			std::vector<size_t> m_MatchedRules;
+		};
+		static constexpr size_t MAX_PLAYER_MATCH_CACHE_SIZE = 4096;
+		std::unordered_map<SteamID, PlayerMatchCache> m_PlayerMatchCache;
+		const PlayerMatchCache& GetPlayerMatchCache(const RuleIndex& index, const IPlayer& player);
+
+		// Fingerprints of everyone's last few chat messages, only kept while a rule needs them
+		using RecentChatFingerprints = RingBuffer<uint64_t, ChatMsgSimilarMatch::RECENT_MESSAGE_COUNT>;
+		std::unordered_map<SteamID, RecentChatFingerprints> m_RecentChatFingerprints;
+
 		using RuleList_t = std::vector<ModerationRule>;
 		struct RuleFile final : SharedConfigFileBase
 		{
@@ -3,6 +3,7 @@
 #include "Networking/NetworkHelpers.h"
 #include "Util/JSONUtils.h"
 #include "Util/PathUtils.h"
+#include "Util/TaskScheduler.h"
 #include "Filesystem.h"
 #include "IPlayer.h"
 #include "Log.h"
@@ -16,6 +17,7 @@
 #include <nlohmann/json.hpp>
 #include <srcon/async_client.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
@@ -116,6 +118,9 @@ namespace tf2_bot_detector
 		{
 			{ "rcon_packets", d.m_RCONPackets },
 			{ "discord_rich_presence", d.m_DiscordRichPresence },
+			{ "compress_console_logs", d.m_CompressConsoleLogs },
+			{ "debug_messages", d.m_DebugMessages },
+			{ "event_log", d.m_EventLog },
 		};
 	}
 	void from_json(const nlohmann::json& j, Settings::Logging& d)
@@ -124,6 +129,9 @@ namespace tf2_bot_detector
 
 		try_get_to_defaulted(j, d.m_RCONPackets, "rcon_packets", DEFAULTS.m_RCONPackets);
 		try_get_to_defaulted(j, d.m_DiscordRichPresence, "discord_rich_presence", DEFAULTS.m_DiscordRichPresence);
+		try_get_to_defaulted(j, d.m_CompressConsoleLogs, "compress_console_logs", DEFAULTS.m_CompressConsoleLogs);
+		try_get_to_defaulted(j, d.m_DebugMessages, "debug_messages", DEFAULTS.m_DebugMessages);
+		try_get_to_defaulted(j, d.m_EventLog, "event_log", DEFAULTS.m_EventLog);
 	}
 
 	void to_json(nlohmann::json& j, const Settings::UIState::MainWindow& d)
@@ -208,7 +216,7 @@ bool ISteamAPISettings::IsSteamAPIAvailable() const
 	case SteamAPIMode::Proxy:
 		return true;
 	case SteamAPIMode::Direct:
-		return !GetSteamAPIKey().empty();
+		return !GetSteamAPIKeys().empty();
 	}
 
 	LogError("Unknown SteamAPIMode {}", +std::underlying_type_t<SteamAPIMode>(GetSteamAPIMode()));
@@ -227,6 +235,40 @@ void GeneralSettings::SetSteamAPIKey(std::string key)
 	m_SteamAPIKey = std::move(key);
 }
 
+std::vector<std::string> ISteamAPISettings::GetSteamAPIKeys() const
+{
+	std::vector<std::string> retVal;
+	if (auto key = GetSteamAPIKey(); !key.empty())
+		retVal.push_back(std::move(key));
+
+	return retVal;
+}
+
+std::vector<std::string> GeneralSettings::GetSteamAPIKeys() const
+{
+	std::vector<std::string> retVal = ISteamAPISettings::GetSteamAPIKeys();
+	if (m_SteamAPIMode != SteamAPIMode::Direct)
+		return retVal;
+
+	for (const auto& key : m_AdditionalSteamAPIKeys)
+	{
+		if (std::find(retVal.begin(), retVal.end(), key) == retVal.end())
+			retVal.push_back(key);
+	}
+
+	return retVal;
+}
+
+void GeneralSettings::SetAdditionalSteamAPIKeys(std::vector<std::string> keys)
+{
+	std::erase_if(keys, [](const std::string& key) { return key.size() != 32; });
+
+	for (const auto& key : keys)
+		ILogManager::GetInstance().AddSecret(key, mh::format("<STEAM_API_KEY:{}>", key.size()));
+
+	m_AdditionalSteamAPIKeys = std::move(keys);
+}
+
 void tf2_bot_detector::to_json(nlohmann::json& j, const Font& d)
 {
 	switch (d)
@@ -316,6 +358,7 @@ void tf2_bot_detector::to_json(nlohmann::json& j, const Settings::TF2Interface&
 	{
 		{ "rcon_port_min", d.m_RCONPortMin },
 		{ "rcon_port_max", d.m_RCONPortMax },
+		{ "rcon_max_in_flight_commands", d.m_RCONMaxInFlightCommands },
 	};
 }
 
@@ -324,8 +367,12 @@ void tf2_bot_detector::from_json(const nlohmann::json& j, Settings::TF2Interface
 	try_get_to_defaulted(j, d, &Settings::TF2Interface::m_RCONPortMin, "rcon_port_min");
 	try_get_to_defaulted(j, d, &Settings::TF2Interface::m_RCONPortMax, "rcon_port_max");
 
+	try_get_to_defaulted(j, d, &Settings::TF2Interface::m_RCONMaxInFlightCommands, "rcon_max_in_flight_commands");
+
 	if (d.m_RCONPortMin > d.m_RCONPortMax)
 		std::swap(d.m_RCONPortMin, d.m_RCONPortMax);
+
+	d.m_RCONMaxInFlightCommands = std::max<uint32_t>(d.m_RCONMaxInFlightCommands, 1);
 }
 
 Settings::Settings() try
@@ -338,11 +385,17 @@ catch (...)
 	throw;
 }
 
-Settings::~Settings() = default;
+Settings::~Settings()
+{
+	if (m_DeferredSaveTime)
+		SaveFile();
+	else if (m_DeferredSaveTask.valid())
+		m_DeferredSaveTask.wait();
+}
 
 void Settings::LoadFile() try
 {
-	ConfigFileBase::LoadFileAsync("cfg/settings.json").get();
+	ConfigFileBase::LoadFileAsync(SETTINGS_FILENAME).get();
 }
 catch (...)
 {
@@ -352,7 +405,13 @@ catch (...)
 
 bool Settings::SaveFile() const try
 {
-	return !ConfigFileBase::SaveFile("cfg/settings.json");
+	// Everything a deferred save would have written goes out now, and an older one still being
+	// written can't land on top of it
+	m_DeferredSaveTime.reset();
+	if (m_DeferredSaveTask.valid())
+		m_DeferredSaveTask.wait();
+
+	return !ConfigFileBase::SaveFile(SETTINGS_FILENAME);
 }
 catch (...)
 {
@@ -360,12 +419,45 @@ catch (...)
 	return false;
 }
 
+void Settings::UpdateDeferredSave() try
+{
+	if (!m_DeferredSaveTime || std::chrono::steady_clock::now() < *m_DeferredSaveTime)
+		return;
+
+	// One write at a time, so they land in order
+	if (m_DeferredSaveTask.valid() && !m_DeferredSaveTask.is_ready())
+		return;
+
+	m_DeferredSaveTime.reset();
+
+	nlohmann::json json;
+	if (SerializeForSave(SETTINGS_FILENAME, json))
+		return;
+
+	m_DeferredSaveTask = [](nlohmann::json json) -> mh::task<>
+	{
+		co_await TaskScheduler::Get().co_schedule(TaskLane::IO);
+		WriteSavedJSON(SETTINGS_FILENAME, json); // Logs anything that went wrong
+
+	}(std::move(json));
+}
+catch (...)
+{
+	LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to save settings");
+}
+
 Settings::Unsaved::~Unsaved()
 {
 }
 
 std::shared_ptr<const HTTPClient> tf2_bot_detector::Settings::GetHTTPClient() const
 {
+	if (m_HTTPClientOverride)
+		return m_HTTPClientOverride;
+
+	if (m_HTTPClientSource)
+		return m_HTTPClientSource->GetHTTPClient();
+
 	if (!m_AllowInternetUsage.value_or(false))
 		return nullptr;
 
@@ -410,12 +502,26 @@ void Settings::Deserialize(const nlohmann::json& json)
 		try_get_to_defaulted(*found, m_AutoVotekickDelay, "auto_votekick_delay", DEFAULTS.m_AutoVotekickDelay);
 		try_get_to_defaulted(*found, m_AutoMark, "auto_mark", DEFAULTS.m_AutoMark);
 		try_get_to_defaulted(*found, m_LazyLoadAPIData, "lazy_load_api_data", DEFAULTS.m_LazyLoadAPIData);
+		try_get_to_defaulted(*found, m_PlayerArchiveSize, "player_archive_size", DEFAULTS.m_PlayerArchiveSize);
+		try_get_to_defaulted(*found, m_TempDBMaxSizeMB, "temp_db_max_size_mb", DEFAULTS.m_TempDBMaxSizeMB);
+		try_get_to_defaulted(*found, m_AvatarTextureBudgetMB, "avatar_texture_budget_mb", DEFAULTS.m_AvatarTextureBudgetMB);
+		try_get_to_defaulted(*found, m_BackgroundConsoleLogParsing, "background_console_log_parsing", DEFAULTS.m_BackgroundConsoleLogParsing);
+		try_get_to_defaulted(*found, m_RCONOnlyConsoleInput, "rcon_only_console_input", DEFAULTS.m_RCONOnlyConsoleInput);
+		try_get_to_defaulted(*found, m_RenderOnDemand, "render_on_demand", DEFAULTS.m_RenderOnDemand);
+		try_get_to_defaulted(*found, m_LowPriorityBackgroundThreads, "low_priority_background_threads", DEFAULTS.m_LowPriorityBackgroundThreads);
+		try_get_to_defaulted(*found, m_BackgroundThreadAffinity, "background_thread_affinity", DEFAULTS.m_BackgroundThreadAffinity);
+		try_get_to_defaulted(*found, m_LowerUIPriorityWhileTF2Focused, "lower_ui_priority_while_tf2_focused", DEFAULTS.m_LowerUIPriorityWhileTF2Focused);
+		try_get_to_defaulted(*found, m_ExportSharedWorldState, "export_shared_world_state", DEFAULTS.m_ExportSharedWorldState);
 		try_get_to_defaulted(*found, m_ConfigCompatibilityMode, "config_compatibility_mode", DEFAULTS.m_ConfigCompatibilityMode);
 
 		{
 			std::string apiKey;
 			try_get_to_defaulted(*found, apiKey, "steam_api_key");
 			SetSteamAPIKey(std::move(apiKey));
+
+			std::vector<std::string> additionalKeys;
+			try_get_to_defaulted(*found, additionalKeys, "additional_steam_api_keys");
+			SetAdditionalSteamAPIKeys(std::move(additionalKeys));
 		}
 
 		try_get_to_defaulted(*found, m_SteamAPIMode, "steam_api_mode",
@@ -425,6 +531,11 @@ void Settings::Deserialize(const nlohmann::json& json)
 			m_SteamDirOverride = foundDir->get<std::string_view>();
 		if (auto foundDir = found->find("tf_game_dir_override"); foundDir != found->end())
 			m_TFDirOverride = foundDir->get<std::string_view>();
+		if (auto foundPath = found->find("temp_db_snapshot_path"); foundPath != found->end())
+			m_TempDBSnapshotPath = foundPath->get<std::string_view>();
+		try_get_to_defaulted(*found, m_TempDBRemoteCacheURL, "temp_db_remote_cache_url");
+		if (auto foundPath = found->find("metrics_file_path"); foundPath != found->end())
+			m_MetricsFilePath = foundPath->get<std::string_view>();
 	}
 
 	try_get_to_defaulted(json, m_Discord, "discord");
@@ -455,6 +566,7 @@ void Settings::Serialize(nlohmann::json& json) const
 				{ "auto_temp_mute", m_AutoTempMute },
 				{ "program_update_check_mode", m_ReleaseChannel },
 				{ "steam_api_key", GetSteamAPIKeyDirect() },
+				{ "additional_steam_api_keys", GetAdditionalSteamAPIKeys() },
 				{ "steam_api_mode", m_SteamAPIMode },
 				{ "auto_launch_tf2", m_AutoLaunchTF2 },
 				{ "auto_chat_warnings", m_AutoChatWarnings },
@@ -463,6 +575,16 @@ void Settings::Serialize(nlohmann::json& json) const
 				{ "auto_votekick_delay", m_AutoVotekickDelay },
 				{ "auto_mark", m_AutoMark },
 				{ "lazy_load_api_data", m_LazyLoadAPIData },
+				{ "player_archive_size", m_PlayerArchiveSize },
+				{ "temp_db_max_size_mb", m_TempDBMaxSizeMB },
+				{ "avatar_texture_budget_mb", m_AvatarTextureBudgetMB },
+				{ "background_console_log_parsing", m_BackgroundConsoleLogParsing },
+				{ "rcon_only_console_input", m_RCONOnlyConsoleInput },
+				{ "render_on_demand", m_RenderOnDemand },
+				{ "low_priority_background_threads", m_LowPriorityBackgroundThreads },
+				{ "background_thread_affinity", m_BackgroundThreadAffinity },
+				{ "lower_ui_priority_while_tf2_focused", m_LowerUIPriorityWhileTF2Focused },
+				{ "export_shared_world_state", m_ExportSharedWorldState },
 				{ "config_compatibility_mode", m_ConfigCompatibilityMode },
 			}
 		},
@@ -477,6 +599,12 @@ void Settings::Serialize(nlohmann::json& json) const
 		json["general"]["steam_dir_override"] = m_SteamDirOverride.string();
 	if (!m_TFDirOverride.empty())
 		json["general"]["tf_game_dir_override"] = m_TFDirOverride.string();
+	if (!m_TempDBSnapshotPath.empty())
+		json["general"]["temp_db_snapshot_path"] = m_TempDBSnapshotPath.string();
+	if (!m_TempDBRemoteCacheURL.empty())
+		json["general"]["temp_db_remote_cache_url"] = m_TempDBRemoteCacheURL;
+	if (!m_MetricsFilePath.empty())
+		json["general"]["metrics_file_path"] = m_MetricsFilePath.string();
 	if (m_LocalSteamIDOverride.IsValid())
 		json["general"]["local_steamid_override"] = m_LocalSteamIDOverride;
 	if (m_AllowInternetUsage)
@@ -7,6 +7,7 @@
 
 #include <nlohmann/json_fwd.hpp>
 
+#include <chrono>
 #include <filesystem>
 #include <optional>
 #include <vector>
@@ -71,6 +72,9 @@ namespace tf2_bot_detector
 		virtual std::string GetSteamAPIKey() const = 0;
 		virtual void SetSteamAPIKey(std::string key) = 0;
 		virtual SteamAPIMode GetSteamAPIMode() const = 0;
+
+		// Every key Direct mode requests can be spread over (see SteamAPI::KeyPool), the main one first
+		virtual std::vector<std::string> GetSteamAPIKeys() const;
 	};
 
 	struct GeneralSettings : public ISteamAPISettings
@@ -87,6 +91,46 @@ namespace tf2_bot_detector
 
 		bool m_LazyLoadAPIData = true;
 
+		// How many players that have left the server to keep in memory in case they come back
+		uint32_t m_PlayerArchiveSize = 256;
+
+		// The temp db's least recently updated cache entries are dropped once it's bigger than this
+		uint32_t m_TempDBMaxSizeMB = 128;
+
+		// Least recently drawn avatar textures are thrown away (and reloaded when needed) past this
+		uint32_t m_AvatarTextureBudgetMB = 32;
+
+		// Another install's exported cache, read from for anything we don't have cached ourselves
+		std::filesystem::path m_TempDBSnapshotPath;
+
+		// A key-value service shared with other installs, layered behind the temp db. See DB::IRemoteCache.
+		std::string m_TempDBRemoteCacheURL;
+
+		// Counters and latencies are written here every few seconds for Prometheus, nowhere if empty
+		std::filesystem::path m_MetricsFilePath;
+
+		// Read and parse console.log on its own thread instead of during the frame
+		bool m_BackgroundConsoleLogParsing = false;
+
+		// Stop reading console.log while rcon is answering, and rely on command responses (status,
+		// tf_lobby_debug) instead. console.log is picked back up whenever rcon stops responding.
+		bool m_RCONOnlyConsoleInput = false;
+
+		// Only redraw when there's new console output, a request finished, a timer ticked or the user did something
+		bool m_RenderOnDemand = false;
+
+		// Background threads run below normal priority, power throttled where Windows supports it
+		bool m_LowPriorityBackgroundThreads = true;
+
+		// Logical cores the background threads may run on, bit 0 is the first one. 0 for any of them.
+		uint64_t m_BackgroundThreadAffinity = 0;
+
+		// Drop the UI thread below normal priority while TF2 is the foreground window
+		bool m_LowerUIPriorityWhileTF2Focused = true;
+
+		// Publish the players and their marks in shared memory for overlays, see SharedWorldStateLayout.h
+		bool m_ExportSharedWorldState = false;
+
 		bool m_ConfigCompatibilityMode = true;
 
 		std::optional<ReleaseChannel> m_ReleaseChannel;
@@ -95,6 +139,11 @@ namespace tf2_bot_detector
 
 		std::string GetSteamAPIKey() const override;
 		void SetSteamAPIKey(std::string key) override;
+		std::vector<std::string> GetSteamAPIKeys() const override;
+
+		// On top of the main one, for more requests per day than a single key is allowed
+		const std::vector<std::string>& GetAdditionalSteamAPIKeys() const { return m_AdditionalSteamAPIKeys; }
+		void SetAdditionalSteamAPIKeys(std::vector<std::string> keys);
 
 		SteamAPIMode m_SteamAPIMode = SteamAPIMode::Proxy;
 		SteamAPIMode GetSteamAPIMode() const override { return m_SteamAPIMode; }
@@ -104,6 +153,7 @@ namespace tf2_bot_detector
 
 	private:
 		std::string m_SteamAPIKey;
+		std::vector<std::string> m_AdditionalSteamAPIKeys;
 	};
 
 	class Settings final : public AutoDetectedSettings, public GeneralSettings, ConfigFileBase
@@ -115,6 +165,14 @@ namespace tf2_bot_detector
 		void LoadFile();
 		bool SaveFile() const;
 
+		// For UI that changes settings continuously, like color pickers and sliders. Saves once it's
+		// been DEFERRED_SAVE_DELAY since the last call, serializing on the thread that calls
+		// UpdateDeferredSave() and writing on a background thread. SaveFile() and the destructor save
+		// anything still pending.
+		void SaveFileDeferred() { m_DeferredSaveTime = std::chrono::steady_clock::now() + DEFERRED_SAVE_DELAY; }
+		void UpdateDeferredSave();
+		static constexpr std::chrono::milliseconds DEFERRED_SAVE_DELAY{ 750 };
+
 		// Settings that are not saved in the config file because we want them to
 		// reset to these defaults when the tool is reopened
 		struct Unsaved
@@ -122,6 +180,9 @@ namespace tf2_bot_detector
 			~Unsaved();
 
 			bool m_DebugShowCommands = false;
+			bool m_DebugShowProfiler = false;
+			bool m_DebugTrackMemory = false;
+			bool m_DebugShowDecisionTrace = false;
 
 			uint32_t m_ChatMsgWrappersToken{};
 			std::optional<ChatWrappers> m_ChatMsgWrappers;
@@ -132,12 +193,23 @@ namespace tf2_bot_detector
 		std::optional<bool> m_AllowInternetUsage;
 		std::shared_ptr<const IHTTPClient> GetHTTPClient() const;
 
+		// GetHTTPClient() returns source's client (and the rate limiting that comes with it) from now on.
+		// source must outlive this.
+		void ShareHTTPClient(const Settings& source) { m_HTTPClientSource = &source; }
+
+		// GetHTTPClient() returns client from now on, even if internet usage isn't allowed. For
+		// replays, which answer requests from a recording.
+		void SetHTTPClient(std::shared_ptr<IHTTPClient> client) { m_HTTPClientOverride = std::move(client); }
+
 		std::vector<GotoProfileSite> m_GotoProfileSites;
 
 		struct Logging
 		{
 			bool m_RCONPackets = false;
 			bool m_DiscordRichPresence = false;
+			bool m_CompressConsoleLogs = false;
+			bool m_DebugMessages = true;
+			bool m_EventLog = false;
 
 		} m_Logging;
 
@@ -187,11 +259,15 @@ namespace tf2_bot_detector
 		struct TF2Interface
 		{
 			uint16_t GetRandomRCONPort() const;
+			uint32_t GetRCONMaxInFlightCommands() const { return m_RCONMaxInFlightCommands; }
 
 		private:
 			uint16_t m_RCONPortMin = 40000;
 			uint16_t m_RCONPortMax = 60000;
 
+			// How many rcon commands can be waiting on a response at once
+			uint32_t m_RCONMaxInFlightCommands = 4;
+
 			friend void to_json(nlohmann::json& j, const TF2Interface& d);
 			friend void from_json(const nlohmann::json& j, TF2Interface& d);
 
@@ -204,6 +280,7 @@ namespace tf2_bot_detector
 
 	private:
 		static constexpr int SETTINGS_SCHEMA_VERSION = 3;
+		static constexpr char SETTINGS_FILENAME[] = "cfg/settings.json";
 
 		void ValidateSchema(const ConfigSchemaInfo& schema) const override;
 		void Deserialize(const nlohmann::json& json) override;
@@ -213,6 +290,11 @@ namespace tf2_bot_detector
 		void AddDefaultGotoProfileSites();
 
 		mutable std::shared_ptr<IHTTPClient> m_HTTPClient;
+		const Settings* m_HTTPClientSource = nullptr;
+		std::shared_ptr<IHTTPClient> m_HTTPClientOverride;
+
+		mutable std::optional<std::chrono::steady_clock::time_point> m_DeferredSaveTime;
+		mutable mh::task<> m_DeferredSaveTask;
 	};
 }
 
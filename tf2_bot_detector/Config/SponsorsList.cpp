@@ -1,4 +1,5 @@
 #include "SponsorsList.h"
+#include "Networking/HTTPClient.h"
 #include "Util/JSONUtils.h"
 
 #include <mh/text/string_insertion.hpp>
@@ -10,7 +11,6 @@ using namespace tf2_bot_detector;
 SponsorsList::SponsorsList(const Settings& settings) :
 	m_Settings(&settings)
 {
-	LoadFile();
 }
 
 void SponsorsList::LoadFile()
@@ -20,6 +20,9 @@ void SponsorsList::LoadFile()
 
 auto SponsorsList::GetSponsors() const -> std::vector<Sponsor>
 {
+	if (!m_Sponsors.valid())
+		return {};
+
 	auto result = m_Sponsors.try_get();
 	return result ? result->m_Sponsors : std::vector<Sponsor>{};
 }
@@ -52,6 +55,11 @@ void SponsorsList::SponsorsListFile::ValidateSchema(const ConfigSchemaInfo& sche
 		throw std::runtime_error("Sponsors schema must be version "s << SPONSORS_SCHEMA_VERSION << ", but was " << schema.m_Version);
 }
 
+HTTPRequestTag SponsorsList::SponsorsListFile::GetAutoUpdateRequestTag() const
+{
+	return HTTPRequestTag::Sponsors;
+}
+
 void tf2_bot_detector::to_json(nlohmann::json& j, const SponsorsList::Sponsor& d)
 {
 	j =
@@ -12,6 +12,7 @@ namespace tf2_bot_detector
 	class SponsorsList final
 	{
 	public:
+		// Nothing is loaded until LoadFile() is called
 		SponsorsList(const Settings& settings);
 
 		void LoadFile();
@@ -36,6 +37,7 @@ namespace tf2_bot_detector
 			void Deserialize(const nlohmann::json& json) override;
 			void Serialize(nlohmann::json& json) const override;
 			void ValidateSchema(const ConfigSchemaInfo& schema) const override;
+			HTTPRequestTag GetAutoUpdateRequestTag() const override;
 
 			static constexpr int SPONSORS_SCHEMA_VERSION = 3;
 
@@ -0,0 +1,148 @@
+#include "ChatHistory.h"
+#include "ConsoleLines.h"
+#include "Util/TextFolding.h"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace tf2_bot_detector;
+
+namespace
+{
+	enum EntryFlags : uint8_t
+	{
+		ENTRY_TEAM = 1 << 0,
+		ENTRY_DEAD = 1 << 1,
+	};
+
+	uint32_t MakeTrigram(const std::string_view& text, size_t pos)
+	{
+		return (uint32_t(uint8_t(text[pos])) << 16) | (uint32_t(uint8_t(text[pos + 1])) << 8) | uint8_t(text[pos + 2]);
+	}
+
+	std::string_view GetRange(const std::string& text, const std::vector<uint32_t>& offsets, size_t index)
+	{
+		return std::string_view(text).substr(offsets[index], offsets[index + 1] - offsets[index]);
+	}
+}
+
+void ChatHistory::Add(const ChatConsoleLine& line)
+{
+	Add(line.GetTimestamp(), line.GetPlayerSteamID(), line.GetPlayerName(), line.GetMessage(),
+		line.IsTeam(), line.IsDead());
+}
+
+void ChatHistory::Add(time_point_t timestamp, SteamID steamID, const InternedString& name, const std::string_view& text,
+	bool isTeam, bool isDead)
+{
+	const auto index = uint32_t(size());
+
+	m_Timestamps.push_back(timestamp);
+	m_SteamIDs.push_back(steamID);
+	m_Names.push_back(name);
+	m_Flags.push_back((isTeam ? ENTRY_TEAM : 0) | (isDead ? ENTRY_DEAD : 0));
+
+	m_Text.append(text);
+	m_TextOffsets.push_back(uint32_t(m_Text.size()));
+
+	const size_t searchBegin = m_SearchText.size();
+	m_SearchText.append(FoldText(name));
+	m_SearchText.push_back('\n');
+	m_SearchText.append(FoldText(text));
+	m_SearchTextOffsets.push_back(uint32_t(m_SearchText.size()));
+
+	const std::string_view searchText = std::string_view(m_SearchText).substr(searchBegin);
+	for (size_t i = 0; (i + TRIGRAM_SIZE) <= searchText.size(); i++)
+	{
+		// Messages are only ever appended, so the lists stay sorted
+		auto& indices = m_TrigramIndex[MakeTrigram(searchText, i)];
+		if (indices.empty() || indices.back() != index)
+			indices.push_back(index);
+	}
+}
+
+auto ChatHistory::GetEntry(size_t index) const -> Entry
+{
+	return Entry
+	{
+		.m_Timestamp = m_Timestamps[index],
+		.m_SteamID = m_SteamIDs[index],
+		.m_Name = m_Names[index],
+		.m_Text = GetRange(m_Text, m_TextOffsets, index),
+		.m_IsTeam = (m_Flags[index] & ENTRY_TEAM) != 0,
+		.m_IsDead = (m_Flags[index] & ENTRY_DEAD) != 0,
+	};
+}
+
+void ChatHistory::Clear()
+{
+	*this = ChatHistory();
+}
+
+std::string_view ChatHistory::GetSearchText(size_t index) const
+{
+	return GetRange(m_SearchText, m_SearchTextOffsets, index);
+}
+
+std::vector<uint32_t> ChatHistory::Search(const std::string_view& query, size_t maxResults) const
+{
+	std::vector<uint32_t> results;
+
+	const std::string foldedQuery = FoldText(query);
+	if (foldedQuery.empty() || maxResults == 0)
+		return results;
+
+	const auto TryAdd = [&](uint32_t index)
+	{
+		if (GetSearchText(index).find(foldedQuery) != std::string_view::npos)
+			results.push_back(index);
+
+		return results.size() < maxResults;
+	};
+
+	// Too short for the index, but then again a scan for a couple of characters is quick
+	if (foldedQuery.size() < TRIGRAM_SIZE)
+	{
+		for (size_t i = size(); i-- > 0; )
+		{
+			if (!TryAdd(uint32_t(i)))
+				break;
+		}
+
+		return results;
+	}
+
+	std::vector<const std::vector<uint32_t>*> indexLists;
+	for (size_t i = 0; (i + TRIGRAM_SIZE) <= foldedQuery.size(); i++)
+	{
+		const auto found = m_TrigramIndex.find(MakeTrigram(foldedQuery, i));
+		if (found == m_TrigramIndex.end())
+			return results; // Nothing has this trigram, so nothing can contain the query
+
+		indexLists.push_back(&found->second);
+	}
+
+	// Intersect the shortest lists first, so the candidates shrink as fast as possible
+	std::sort(indexLists.begin(), indexLists.end(),
+		[](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) { return a->size() < b->size(); });
+	indexLists.erase(std::unique(indexLists.begin(), indexLists.end()), indexLists.end());
+
+	std::vector<uint32_t> candidates = *indexLists.front();
+	std::vector<uint32_t> intersection;
+	for (size_t i = 1; i < indexLists.size() && !candidates.empty(); i++)
+	{
+		intersection.clear();
+		std::set_intersection(candidates.begin(), candidates.end(), indexLists[i]->begin(), indexLists[i]->end(),
+			std::back_inserter(intersection));
+		candidates.swap(intersection);
+	}
+
+	// Having every trigram doesn't mean they're in the right order
+	for (auto it = candidates.rbegin(); it != candidates.rend(); ++it)
+	{
+		if (!TryAdd(*it))
+			break;
+	}
+
+	return results;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Clock.h"
+#include "SteamID.h"
+#include "Util/InternedString.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	class ChatConsoleLine;
+
+	// Every chat message of the session, searchable. The chat log only keeps the last few hundred
+	// lines around for printing, this keeps all of them in a handful of flat arrays instead of one
+	// allocation per message. Only ever grows until Clear().
+	class ChatHistory final
+	{
+	public:
+		struct Entry
+		{
+			time_point_t m_Timestamp;
+			SteamID m_SteamID;
+			InternedString m_Name;
+			std::string_view m_Text; // Only valid until the next Add()
+			bool m_IsTeam;
+			bool m_IsDead;
+		};
+
+		void Add(const ChatConsoleLine& line);
+		void Add(time_point_t timestamp, SteamID steamID, const InternedString& name, const std::string_view& text,
+			bool isTeam, bool isDead);
+
+		size_t size() const { return m_Timestamps.size(); }
+		Entry GetEntry(size_t index) const;
+		void Clear();
+
+		// Indices of the messages whose sender name or text contains query, newest first. Compared after
+		// FoldText(), so it's case insensitive and lookalike characters match what they're standing in
+		// for. Queries of TRIGRAM_SIZE or more characters only look at the messages containing every
+		// trigram of the query, rather than all of them.
+		std::vector<uint32_t> Search(const std::string_view& query, size_t maxResults = SIZE_MAX) const;
+
+		static constexpr size_t TRIGRAM_SIZE = 3;
+
+	private:
+		std::string_view GetSearchText(size_t index) const;
+
+		std::vector<time_point_t> m_Timestamps;
+		std::vector<SteamID> m_SteamIDs;
+		std::vector<InternedString> m_Names;
+		std::vector<uint8_t> m_Flags;
+
+		// Message i is [m_TextOffsets[i], m_TextOffsets[i + 1]) of m_Text
+		std::string m_Text;
+		std::vector<uint32_t> m_TextOffsets{ 0 };
+
+		// FoldText() of the name, a '\n', then FoldText() of the message. Same layout as m_Text.
+		std::string m_SearchText;
+		std::vector<uint32_t> m_SearchTextOffsets{ 0 };
+
+		// Every trigram of the search texts -> the (ascending) indices of the messages containing it
+		std::unordered_map<uint32_t, std::vector<uint32_t>> m_TrigramIndex;
+	};
+}
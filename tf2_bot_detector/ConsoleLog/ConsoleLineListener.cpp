@@ -3,37 +3,39 @@
 
 using namespace tf2_bot_detector;
 
-AutoConsoleLineListener::AutoConsoleLineListener(IWorldState& world) :
-	m_World(&world)
+AutoConsoleLineListener::AutoConsoleLineListener(IWorldState& world, ConsoleLineTypeMask lineTypes) :
+	m_World(&world), m_LineTypes(lineTypes)
 {
-	m_World->AddConsoleLineListener(this);
+	m_World->AddConsoleLineListener(this, m_LineTypes);
 }
 
 AutoConsoleLineListener::AutoConsoleLineListener(const AutoConsoleLineListener& other) :
-	m_World(other.m_World)
+	m_World(other.m_World), m_LineTypes(other.m_LineTypes)
 {
-	m_World->AddConsoleLineListener(this);
+	m_World->AddConsoleLineListener(this, m_LineTypes);
 }
 
 AutoConsoleLineListener& AutoConsoleLineListener::operator=(const AutoConsoleLineListener& other)
 {
 	m_World->RemoveConsoleLineListener(this);
 	m_World = other.m_World;
-	m_World->AddConsoleLineListener(this);
+	m_LineTypes = other.m_LineTypes;
+	m_World->AddConsoleLineListener(this, m_LineTypes);
 	return *this;
 }
 
 AutoConsoleLineListener::AutoConsoleLineListener(AutoConsoleLineListener&& other) :
-	m_World(other.m_World)
+	m_World(other.m_World), m_LineTypes(other.m_LineTypes)
 {
-	m_World->AddConsoleLineListener(this);
+	m_World->AddConsoleLineListener(this, m_LineTypes);
 }
 
 AutoConsoleLineListener& AutoConsoleLineListener::operator=(AutoConsoleLineListener&& other)
 {
 	m_World->RemoveConsoleLineListener(this);
 	m_World = other.m_World;
-	m_World->AddConsoleLineListener(this);
+	m_LineTypes = other.m_LineTypes;
+	m_World->AddConsoleLineListener(this, m_LineTypes);
 	return *this;
 }
 
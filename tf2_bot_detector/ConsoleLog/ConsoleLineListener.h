@@ -1,12 +1,12 @@
 #pragma once
 
 #include "Clock.h"
+#include "IConsoleLine.h"
 
 #include <string_view>
 
 namespace tf2_bot_detector
 {
-	class IConsoleLine;
 	class IWorldState;
 
 	class IConsoleLineListener
@@ -38,7 +38,8 @@ namespace tf2_bot_detector
 	class AutoConsoleLineListener : public BaseConsoleLineListener
 	{
 	public:
-		AutoConsoleLineListener(IWorldState& world);
+		// Only lines of the given types are passed to OnConsoleLineParsed()
+		AutoConsoleLineListener(IWorldState& world, ConsoleLineTypeMask lineTypes = ConsoleLineTypeMask::All());
 		AutoConsoleLineListener(const AutoConsoleLineListener& other);
 		AutoConsoleLineListener& operator=(const AutoConsoleLineListener& other);
 		AutoConsoleLineListener(AutoConsoleLineListener&& other);
@@ -47,5 +48,6 @@ namespace tf2_bot_detector
 
 	private:
 		IWorldState* m_World = nullptr;
+		ConsoleLineTypeMask m_LineTypes;
 	};
 }
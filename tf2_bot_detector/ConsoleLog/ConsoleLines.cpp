@@ -1,4 +1,5 @@
 #include "ConsoleLines.h"
+#include "NetworkStatus.h"
 #include "Application.h"
 #include "Config/Settings.h"
 #include "GameData/MatchmakingQueue.h"
@@ -9,16 +10,21 @@
 #include "Log.h"
 #include "WorldState.h"
 
-#include <mh/algorithm/multi_compare.hpp>
 #include <mh/text/charconv_helper.hpp>
 #include <mh/text/fmtstr.hpp>
 #include <mh/text/format.hpp>
 #include <mh/text/string_insertion.hpp>
 #include <imgui_desktop/ScopeGuards.h>
 
-#include <regex>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 #undef GetMessage
 
@@ -27,29 +33,45 @@ using namespace std::chrono_literals;
 using namespace std::string_literals;
 using namespace std::string_view_literals;
 
-GenericConsoleLine::GenericConsoleLine(time_point_t timestamp, std::string text) :
+GenericConsoleLine::GenericConsoleLine(time_point_t timestamp, SharedStringView text) :
 	BaseClass(timestamp), m_Text(std::move(text))
 {
-	m_Text.shrink_to_fit();
 }
 
 std::shared_ptr<IConsoleLine> GenericConsoleLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	return std::make_shared<GenericConsoleLine>(args.m_Timestamp, std::string(args.m_Text));
+	return MakeConsoleLine<GenericConsoleLine>(args.m_Timestamp, SharedStringView::Create(args.m_TextBuffer, args.m_Text));
+}
+
+void GenericConsoleLine::ReleaseTextBuffer()
+{
+	m_Text.Materialize();
 }
 
 void GenericConsoleLine::Print(const PrintArgs& args) const
 {
-	ImGui::TextFmt(m_Text);
+	ImGui::TextFmt(m_Text.view());
 }
 
-ChatConsoleLine::ChatConsoleLine(time_point_t timestamp, std::string playerName, std::string message,
+ChatConsoleLine::ChatConsoleLine(time_point_t timestamp, InternedString playerName, SharedStringView message,
 	bool isDead, bool isTeam, bool isSelf, TeamShareResult teamShareResult, SteamID id) :
 	ConsoleLineBase(timestamp), m_PlayerName(std::move(playerName)), m_Message(std::move(message)),
 	m_IsDead(isDead), m_IsTeam(isTeam), m_IsSelf(isSelf), m_TeamShareResult(teamShareResult), m_PlayerSteamID(id)
 {
-	m_PlayerName.shrink_to_fit();
-	m_Message.shrink_to_fit();
+}
+
+void ChatConsoleLine::ReleaseTextBuffer()
+{
+	m_Message.Materialize();
+	m_PrintRuns.clear();
+}
+
+void ChatConsoleLine::SetSender(SteamID id, bool isSelf, TeamShareResult teamShare)
+{
+	m_PlayerSteamID = id;
+	m_IsSelf = isSelf;
+	m_TeamShareResult = teamShare;
+	m_PrintRuns.clear();
 }
 
 std::shared_ptr<IConsoleLine> ChatConsoleLine::TryParse(const ConsoleLineTryParseArgs& args)
@@ -74,7 +96,7 @@ std::shared_ptr<ChatConsoleLine> ChatConsoleLine::TryParse(const std::string_vie
 
 	if (svmatch result; std::regex_match(text.begin(), text.end(), result, flexible ? s_RegexFlexible : s_Regex))
 	{
-		return std::make_shared<ChatConsoleLine>(timestamp, result[3].str(), result[4].str(),
+		return MakeConsoleLine<ChatConsoleLine>(timestamp, result[3].str(), result[4].str(),
 			result[1].matched, result[2].matched);
 	}
 
@@ -82,19 +104,30 @@ std::shared_ptr<ChatConsoleLine> ChatConsoleLine::TryParse(const std::string_vie
 }
 #endif
 
-template<typename TTextFunc, typename TSameLineFunc>
-static void ProcessChatMessage(const ChatConsoleLine& msgLine, const Settings::Theme& theme,
-	TTextFunc&& textFunc, TSameLineFunc&& sameLineFunc)
+static std::array<float, 4> GetChatNameColor(const ChatConsoleLine& msgLine, const Settings::Theme& theme)
 {
 	auto& colorSettings = theme.m_Colors;
-	std::array<float, 4> colors{ 0.8f, 0.8f, 1.0f, 1.0f };
 
 	if (msgLine.IsSelf())
-		colors = colorSettings.m_ChatLogYouFG;
+		return colorSettings.m_ChatLogYouFG;
 	else if (msgLine.GetTeamShareResult() == TeamShareResult::SameTeams)
-		colors = colorSettings.m_ChatLogFriendlyTeamFG;
+		return colorSettings.m_ChatLogFriendlyTeamFG;
 	else if (msgLine.GetTeamShareResult() == TeamShareResult::OppositeTeams)
-		colors = colorSettings.m_ChatLogEnemyTeamFG;
+		return colorSettings.m_ChatLogEnemyTeamFG;
+
+	return { 0.8f, 0.8f, 1.0f, 1.0f };
+}
+
+static void BuildChatPrintRuns(const ChatConsoleLine& msgLine, const std::array<float, 4>& colors,
+	std::vector<ChatConsoleLine::PrintRun>& runs)
+{
+	runs.clear();
+
+	const auto textFunc = [&](const ImVec4& color, const std::string_view& text)
+	{
+		runs.push_back({ .m_Color = { color.x, color.y, color.z, color.w }, .m_Text = text });
+	};
+	const auto sameLineFunc = [&] { runs.back().m_SameLine = true; };
 
 	const auto PrintLHS = [&](float alphaScale = 1.0f)
 	{
@@ -119,7 +152,7 @@ static void ProcessChatMessage(const ChatConsoleLine& msgLine, const Settings::T
 
 	PrintLHS();
 
-	const auto& msg = msgLine.GetMessage();
+	const auto msg = msgLine.GetMessage();
 	const ImVec4 msgColor(0.8f, 0.8f, 0.8f, 1.0f);
 	if (msg.find('\n') == msg.npos)
 	{
@@ -148,8 +181,7 @@ static void ProcessChatMessage(const ChatConsoleLine& msgLine, const Settings::T
 			if (newlineEnd > nonNewlineEnd)
 			{
 				sameLineFunc();
-				textFunc(ImVec4(1, 0.5f, 0.5f, 1.0f),
-					mh::fmtstr<64>("(\\n x {})", (newlineEnd - nonNewlineEnd)).c_str());
+				runs.push_back({ .m_Color = { 1, 0.5f, 0.5f, 1.0f }, .m_CollapsedNewlines = uint32_t(newlineEnd - nonNewlineEnd) });
 			}
 
 			i = newlineEnd;
@@ -158,12 +190,44 @@ static void ProcessChatMessage(const ChatConsoleLine& msgLine, const Settings::T
 	}
 }
 
+template<typename TTextFunc, typename TSameLineFunc>
+static void PrintChatRuns(const std::vector<ChatConsoleLine::PrintRun>& runs, TTextFunc&& textFunc, TSameLineFunc&& sameLineFunc)
+{
+	for (const auto& run : runs)
+	{
+		const ImVec4 color(run.m_Color[0], run.m_Color[1], run.m_Color[2], run.m_Color[3]);
+		if (run.m_CollapsedNewlines > 0)
+			textFunc(color, mh::fmtstr<64>("(\\n x {})", run.m_CollapsedNewlines).c_str());
+		else
+			textFunc(color, run.m_Text);
+
+		if (run.m_SameLine)
+			sameLineFunc();
+	}
+}
+
+template<typename TTextFunc, typename TSameLineFunc>
+static void ProcessChatMessage(const ChatConsoleLine& msgLine, const Settings::Theme& theme,
+	TTextFunc&& textFunc, TSameLineFunc&& sameLineFunc)
+{
+	std::vector<ChatConsoleLine::PrintRun> runs;
+	BuildChatPrintRuns(msgLine, GetChatNameColor(msgLine, theme), runs);
+	PrintChatRuns(runs, textFunc, sameLineFunc);
+}
+
 void ChatConsoleLine::Print(const PrintArgs& args) const
 {
 	ImGuiDesktop::ScopeGuards::ID id(this);
 
+	if (const auto nameColor = GetChatNameColor(*this, args.m_Settings.m_Theme);
+		m_PrintRuns.empty() || nameColor != m_PrintRunsNameColor)
+	{
+		BuildChatPrintRuns(*this, nameColor, m_PrintRuns);
+		m_PrintRunsNameColor = nameColor;
+	}
+
 	ImGui::BeginGroup();
-	ProcessChatMessage(*this, args.m_Settings.m_Theme,
+	PrintChatRuns(m_PrintRuns,
 		[](const ImVec4& color, const std::string_view& msg) { ImGui::TextFmt(color, msg); },
 		[] { ImGui::SameLine(); });
 	ImGui::EndGroup();
@@ -176,7 +240,7 @@ void ChatConsoleLine::Print(const PrintArgs& args) const
 		{
 			std::string fullText;
 
-			ProcessChatMessage(*this, args.m_Settings.m_Theme,
+			PrintChatRuns(m_PrintRuns,
 				[&](const ImVec4&, const std::string_view& msg)
 				{
 					if (!fullText.empty())
@@ -203,17 +267,21 @@ LobbyHeaderLine::LobbyHeaderLine(time_point_t timestamp, unsigned memberCount, u
 
 std::shared_ptr<IConsoleLine> LobbyHeaderLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(CTFLobbyShared: ID:([0-9a-f]*)\s+(\d+) member\(s\), (\d+) pending)regex", std::regex::optimize);
+	using namespace static_regex;
+
+	// CTFLobbyShared: ID:([0-9a-f]*)\s+(\d+) member\(s\), (\d+) pending
+	static constexpr auto s_Regex = regex(seq(lit("CTFLobbyShared: ID:"), cap<1>(star(hex_lower)), plus(space),
+		cap<2>(plus(digit)), lit(" member(s), "), cap<3>(plus(digit)), lit(" pending")));
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		unsigned memberCount, pendingCount;
-		if (!mh::from_chars(std::string_view(&*result[2].first, result[2].length()), memberCount))
+		if (!mh::from_chars(to_string_view(result[2]), memberCount))
 			throw std::runtime_error("Failed to parse lobby member count");
-		if (!mh::from_chars(std::string_view(&*result[3].first, result[3].length()), pendingCount))
+		if (!mh::from_chars(to_string_view(result[3]), pendingCount))
 			throw std::runtime_error("Failed to parse lobby pending member count");
 
-		return std::make_shared<LobbyHeaderLine>(args.m_Timestamp, memberCount, pendingCount);
+		return MakeConsoleLine<LobbyHeaderLine>(args.m_Timestamp, memberCount, pendingCount);
 	}
 
 	return nullptr;
@@ -232,19 +300,24 @@ LobbyMemberLine::LobbyMemberLine(time_point_t timestamp, const LobbyMember& lobb
 
 std::shared_ptr<IConsoleLine> LobbyMemberLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(\s+(?:(?:Member)|(Pending))\[(\d+)\] (\[.*\])\s+team = (\w+)\s+type = (\w+))regex", std::regex::optimize);
+	using namespace static_regex;
+
+	// \s+(?:(?:Member)|(Pending))\[(\d+)\] (\[.*\])\s+team = (\w+)\s+type = (\w+)
+	static constexpr auto s_Regex = regex(seq(plus(space), alt(lit("Member"), cap<1>(lit("Pending"))),
+		lit("["), cap<2>(plus(digit)), lit("] "), cap<3>(seq(lit("["), star(dot), lit("]"))),
+		plus(space), lit("team = "), cap<4>(plus(word)), plus(space), lit("type = "), cap<5>(plus(word))));
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		LobbyMember member{};
 		member.m_Pending = result[1].matched;
 
-		if (!mh::from_chars(std::string_view(&*result[2].first, result[2].length()), member.m_Index))
+		if (!mh::from_chars(to_string_view(result[2]), member.m_Index))
 			throw std::runtime_error("Failed to parse lobby member regex");
 
-		member.m_SteamID = SteamID(std::string_view(&*result[3].first, result[3].length()));
+		member.m_SteamID = SteamID(to_string_view(result[3]));
 
-		std::string_view teamStr(&*result[4].first, result[4].length());
+		const std::string_view teamStr = to_string_view(result[4]);
 
 		if (teamStr == "TF_GC_TEAM_DEFENDERS"sv)
 			member.m_Team = LobbyMemberTeam::Defenders;
@@ -253,7 +326,7 @@ std::shared_ptr<IConsoleLine> LobbyMemberLine::TryParse(const ConsoleLineTryPars
 		else
 			throw std::runtime_error("Unknown lobby member team");
 
-		std::string_view typeStr(&*result[5].first, result[5].length());
+		const std::string_view typeStr = to_string_view(result[5]);
 		if (typeStr == "MATCH_PLAYER"sv)
 			member.m_Type = LobbyMemberType::Player;
 		else if (typeStr == "INVALID_PLAYER"sv)
@@ -261,7 +334,7 @@ std::shared_ptr<IConsoleLine> LobbyMemberLine::TryParse(const ConsoleLineTryPars
 		else
 			throw std::runtime_error("Unknown lobby member type");
 
-		return std::make_shared<LobbyMemberLine>(args.m_Timestamp, member);
+		return MakeConsoleLine<LobbyMemberLine>(args.m_Timestamp, member);
 	}
 
 	return nullptr;
@@ -289,55 +362,304 @@ IConsoleLine::IConsoleLine(time_point_t timestamp) :
 {
 }
 
-auto IConsoleLine::GetTypeData() -> std::list<ConsoleLineTypeData>&
+namespace
 {
-	static std::list<ConsoleLineTypeData> s_List;
-	return s_List;
-}
+	template<typename... TTypes>
+	struct ConsoleLineTypeList
+	{
+		static constexpr size_t COUNT = sizeof...(TTypes);
+	};
 
-std::shared_ptr<IConsoleLine> IConsoleLine::ParseConsoleLine(const std::string_view& text, time_point_t timestamp, IWorldState& world)
-{
-	auto& list = GetTypeData();
+	// Everything ParseConsoleLine() tries. Where several types share a prefix of the same length,
+	// they're tried in the order they're listed here, and so are the types without any prefixes.
+	using AutoParsedLineTypes = ConsoleLineTypeList<
+		LobbyStatusFailedLine,
+		PartyHeaderLine,
+		LobbyHeaderLine,
+		LobbyMemberLine,
+		LobbyChangedLine,
+		DifferingLobbyReceivedLine,
+		ServerStatusPlayerLine,
+		ServerStatusPlayerIPLine,
+		ServerStatusShortPlayerLine,
+		ServerStatusPlayerCountLine,
+		ServerStatusMapLine,
+		EdictUsageLine,
+		ClientReachedServerSpawnLine,
+		KillNotificationLine,
+		CvarlistConvarLine,
+		VoiceReceiveLine,
+		PingLine,
+		SVCUserMessageLine,
+		ConfigExecLine,
+		TeamsSwitchedLine,
+		ConnectingLine,
+		HostNewGameLine,
+		GameQuitLine,
+		QueueStateChangeLine,
+		InQueueLine,
+		ServerJoinLine,
+		ServerDroppedPlayerLine,
+		MatchmakingBannedTimeLine,
+
+		SplitPacketLine,
+		NetStatusConfigLine,
+		NetChannelLatencyLossLine,
+		NetChannelPacketsLine,
+		NetChannelChokeLine,
+		NetChannelFlowLine,
+		NetChannelTotalLine,
+		NetLatencyLine,
+		NetLossLine,
+		NetPacketsTotalLine,
+		NetPacketsPerClientLine,
+		NetDataTotalLine,
+		NetDataPerClientLine
+	>;
+
+	template<typename T>
+	constexpr std::span<const std::string_view> GetParsePrefixes()
+	{
+		if constexpr (requires { T::PARSE_PREFIXES; })
+			return T::PARSE_PREFIXES;
+		else
+			return {};
+	}
+
+	// The types WorldState needs to keep track of who's in the game and in the lobby, and of kills,
+	// votes and config execs, so they're still parsed when ConsoleLogParser is too far behind to
+	// parse everything. Same relative order as AutoParsedLineTypes.
+	using EssentialLineTypes = ConsoleLineTypeList<
+		LobbyStatusFailedLine,
+		LobbyHeaderLine,
+		LobbyMemberLine,
+		LobbyChangedLine,
+		ServerStatusPlayerLine,
+		ServerStatusShortPlayerLine,
+		ClientReachedServerSpawnLine,
+		KillNotificationLine,
+		SVCUserMessageLine,
+		ConfigExecLine,
+		ConnectingLine,
+		HostNewGameLine,
+		ServerDroppedPlayerLine
+	>;
+
+	struct PrefixedType
+	{
+		std::string_view m_Prefix;
+		IConsoleLine::TryParseFunc m_TryParseFunc = nullptr;
+		size_t m_TypeIndex = 0;
+	};
 
-	if ((s_TotalParseCount % 1024) == 0)
+	template<typename TList> struct ConsoleLineTypeTable;
+	template<typename... TTypes>
+	struct ConsoleLineTypeTable<ConsoleLineTypeList<TTypes...>> final
 	{
-		// Periodically re-sort the line types for best performance
-		list.sort([](ConsoleLineTypeData& lhs, ConsoleLineTypeData& rhs)
+		static_assert((TTypes::AUTO_PARSE && ...), "Types with AutoParse = false are never parsed automatically");
+
+		static constexpr size_t PREFIX_COUNT = (size_t(0) + ... + GetParsePrefixes<TTypes>().size());
+		static constexpr size_t UNPREFIXED_COUNT = (size_t(0) + ... + size_t(GetParsePrefixes<TTypes>().empty()));
+
+		// Every prefix of every type, sorted by first character, then longest prefix first
+		static constexpr auto PREFIXED_TYPES = []
+		{
+			std::array<PrefixedType, PREFIX_COUNT> retVal{};
+			size_t count = 0;
+			size_t typeIndex = 0;
+
+			const auto AddType = [&]<typename T>()
 			{
-				if (rhs.m_AutoParse != lhs.m_AutoParse)
-					return rhs.m_AutoParse < lhs.m_AutoParse;
+				for (const std::string_view& prefix : GetParsePrefixes<T>())
+				{
+					if (prefix.empty())
+						throw "Empty parse prefixes match everything, leave PARSE_PREFIXES out instead";
 
-				// Intentionally reversed, we want descending order
-				return rhs.m_AutoParseSuccessCount < lhs.m_AutoParseSuccessCount;
-			});
-	}
+					retVal[count++] = PrefixedType{ prefix, &T::TryParse, typeIndex };
+				}
+
+				typeIndex++;
+			};
+			(AddType.template operator()<TTypes>(), ...);
+
+			std::sort(retVal.begin(), retVal.end(), [](const PrefixedType& lhs, const PrefixedType& rhs)
+				{
+					if (lhs.m_Prefix.front() != rhs.m_Prefix.front())
+						return uint8_t(lhs.m_Prefix.front()) < uint8_t(rhs.m_Prefix.front());
+					if (lhs.m_Prefix.size() != rhs.m_Prefix.size())
+						return lhs.m_Prefix.size() > rhs.m_Prefix.size();
+
+					return lhs.m_TypeIndex < rhs.m_TypeIndex;
+				});
+
+			return retVal;
+		}();
+
+		// The candidates for lines starting with c are PREFIXED_TYPES[PREFIX_BUCKETS[c]] up to PREFIXED_TYPES[PREFIX_BUCKETS[c + 1]]
+		static constexpr auto PREFIX_BUCKETS = []
+		{
+			std::array<size_t, 257> retVal{};
+			for (const PrefixedType& type : PREFIXED_TYPES)
+				retVal[size_t(uint8_t(type.m_Prefix.front())) + 1]++;
+
+			for (size_t i = 1; i < retVal.size(); i++)
+				retVal[i] += retVal[i - 1];
 
-	s_TotalParseCount++;
+			return retVal;
+		}();
 
-	const ConsoleLineTryParseArgs args{ text, timestamp, world };
-	for (auto& data : list)
+		// The types without prefixes, in list order
+		static constexpr auto UNPREFIXED_TYPES = []
+		{
+			std::array<IConsoleLine::TryParseFunc, UNPREFIXED_COUNT> retVal{};
+			size_t count = 0;
+
+			const auto AddType = [&]<typename T>()
+			{
+				if (GetParsePrefixes<T>().empty())
+					retVal[count++] = &T::TryParse;
+			};
+			(AddType.template operator()<TTypes>(), ...);
+
+			return retVal;
+		}();
+
+		static std::shared_ptr<IConsoleLine> TryParsePrefixed(const ConsoleLineTryParseArgs& args)
+		{
+			if (args.m_Text.empty())
+				return nullptr;
+
+			const size_t bucket = uint8_t(args.m_Text.front());
+			for (size_t i = PREFIX_BUCKETS[bucket]; i < PREFIX_BUCKETS[bucket + 1]; i++)
+			{
+				const PrefixedType& candidate = PREFIXED_TYPES[i];
+				if (!args.m_Text.starts_with(candidate.m_Prefix))
+					continue;
+
+				if (auto parsed = candidate.m_TryParseFunc(args))
+					return parsed;
+			}
+
+			return nullptr;
+		}
+
+		// Same order as UNPREFIXED_TYPES, but called directly
+		static std::shared_ptr<IConsoleLine> TryParseUnprefixed(const ConsoleLineTryParseArgs& args)
+		{
+			std::shared_ptr<IConsoleLine> parsed;
+			const auto TryParse = [&]<typename T>()
+			{
+				if constexpr (GetParsePrefixes<T>().empty())
+					return !!(parsed = T::TryParse(args));
+				else
+					return false;
+			};
+
+			(TryParse.template operator()<TTypes>() || ...);
+			return parsed;
+		}
+	};
+
+	using AutoParsedLineTable = ConsoleLineTypeTable<AutoParsedLineTypes>;
+	using EssentialLineTable = ConsoleLineTypeTable<EssentialLineTypes>;
+
+	// State for IConsoleLine::SetAdaptiveParseOrder(true)
+	struct AdaptiveParseOrder
 	{
-		if (!data.m_AutoParse)
-			continue;
+		static AdaptiveParseOrder& Get()
+		{
+			static AdaptiveParseOrder s_Order;
+			return s_Order;
+		}
+
+		std::shared_ptr<IConsoleLine> TryParseUnprefixed(const ConsoleLineTryParseArgs& args)
+		{
+			if ((m_ParseCount.fetch_add(1, std::memory_order_relaxed) % 1024) == 0)
+			{
+				// Periodically re-sort the fallback line types for best performance
+				std::unique_lock lock(m_OrderMutex);
+				std::stable_sort(m_Order.begin(), m_Order.end(), [&](size_t lhs, size_t rhs)
+					{
+						// Intentionally reversed, we want descending order
+						return m_SuccessCounts[rhs].load(std::memory_order_relaxed) <
+							m_SuccessCounts[lhs].load(std::memory_order_relaxed);
+					});
+			}
+
+			std::shared_lock lock(m_OrderMutex);
+			for (size_t index : m_Order)
+			{
+				if (auto parsed = AutoParsedLineTable::UNPREFIXED_TYPES[index](args))
+				{
+					m_SuccessCounts[index].fetch_add(1, std::memory_order_relaxed);
+					return parsed;
+				}
+			}
+
+			return nullptr;
+		}
+
+		std::atomic_bool m_Enabled = false;
+
+	private:
+		AdaptiveParseOrder()
+		{
+			for (size_t i = 0; i < m_Order.size(); i++)
+				m_Order[i] = i;
+		}
+
+		static constexpr size_t UNPREFIXED_COUNT = AutoParsedLineTable::UNPREFIXED_COUNT;
 
-		auto parsed = data.m_TryParseFunc(args);
-		if (!parsed)
-			continue;
+		std::atomic<size_t> m_ParseCount = 0;
+		std::array<std::atomic<size_t>, UNPREFIXED_COUNT> m_SuccessCounts{};
 
-		data.m_AutoParseSuccessCount++;
+		// Lines can be parsed on several threads at once, so the periodic re-sort takes this exclusively
+		std::array<size_t, UNPREFIXED_COUNT> m_Order{};
+		std::shared_mutex m_OrderMutex;
+	};
+}
+
+std::shared_ptr<IConsoleLine> IConsoleLine::ParseConsoleLine(const std::string_view& text, time_point_t timestamp, IWorldState& world,
+	const std::shared_ptr<const std::string>* textBuffer)
+{
+	const ConsoleLineTryParseArgs args{ text, timestamp, world, textBuffer };
+
+	if (auto parsed = AutoParsedLineTable::TryParsePrefixed(args))
 		return parsed;
-	}
 
-	//if (auto chatLine = ChatConsoleLine::TryParse(text, timestamp))
-	//	return chatLine;
+	if (auto& adaptive = AdaptiveParseOrder::Get(); adaptive.m_Enabled.load(std::memory_order_relaxed))
+		return adaptive.TryParseUnprefixed(args);
 
-	return nullptr;
-	//return std::make_shared<GenericConsoleLine>(timestamp, std::string(text));
+	return AutoParsedLineTable::TryParseUnprefixed(args);
+}
+
+std::shared_ptr<IConsoleLine> IConsoleLine::ParseEssentialConsoleLine(const std::string_view& text, time_point_t timestamp,
+	IWorldState& world, const std::shared_ptr<const std::string>* textBuffer)
+{
+	const ConsoleLineTryParseArgs args{ text, timestamp, world, textBuffer };
+
+	if (auto parsed = EssentialLineTable::TryParsePrefixed(args))
+		return parsed;
+
+	return EssentialLineTable::TryParseUnprefixed(args);
+}
+
+void IConsoleLine::SetAdaptiveParseOrder(bool enabled)
+{
+	AdaptiveParseOrder::Get().m_Enabled = enabled;
 }
 
-void IConsoleLine::AddTypeData(ConsoleLineTypeData data)
+bool IConsoleLine::IsAdaptiveParseOrder()
 {
-	GetTypeData().push_back(std::move(data));
+	return AdaptiveParseOrder::Get().m_Enabled;
+}
+
+size_t IConsoleLine::HashText(std::string_view text)
+{
+	while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+		text.remove_suffix(1);
+
+	return std::hash<std::string_view>{}(text);
 }
 
 ServerStatusPlayerLine::ServerStatusPlayerLine(time_point_t timestamp, PlayerStatus playerStatus) :
@@ -347,15 +669,22 @@ ServerStatusPlayerLine::ServerStatusPlayerLine(time_point_t timestamp, PlayerSta
 
 std::shared_ptr<IConsoleLine> ServerStatusPlayerLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(#\s+(\d+)\s+"((?:.|[\r\n])+)"\s+(\[.*\])\s+(?:(\d+):)?(\d+):(\d+)\s+(\d+)\s+(\d+)\s+(\w+)(?:\s+(\S+))?)regex", std::regex::optimize);
+	using namespace static_regex;
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	// #\s+(\d+)\s+"((?:.|[\r\n])+)"\s+(\[.*\])\s+(?:(\d+):)?(\d+):(\d+)\s+(\d+)\s+(\d+)\s+(\w+)(?:\s+(\S+))?
+	static constexpr auto s_Regex = regex(seq(lit("#"), plus(space), cap<1>(plus(digit)), plus(space),
+		lit("\""), cap<2>(plus(any_char)), lit("\""), plus(space), cap<3>(seq(lit("["), star(dot), lit("]"))), plus(space),
+		opt(seq(cap<4>(plus(digit)), lit(":"))), cap<5>(plus(digit)), lit(":"), cap<6>(plus(digit)), plus(space),
+		cap<7>(plus(digit)), plus(space), cap<8>(plus(digit)), plus(space), cap<9>(plus(word)),
+		opt(seq(plus(space), cap<10>(plus(non_space))))));
+
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		PlayerStatus status{};
 
 		from_chars_throw(result[1], status.m_UserID);
-		status.m_Name = result[2].str();
-		status.m_SteamID = SteamID(std::string_view(&*result[3].first, result[3].length()));
+		status.m_Name = InternedString(to_string_view(result[2]));
+		status.m_SteamID = SteamID(to_string_view(result[3]));
 
 		// Connected time
 		{
@@ -377,7 +706,7 @@ std::shared_ptr<IConsoleLine> ServerStatusPlayerLine::TryParse(const ConsoleLine
 
 		// State
 		{
-			const auto state = std::string_view(&*result[9].first, result[9].length());
+			const auto state = to_string_view(result[9]);
 			if (state == "active"sv)
 				status.m_State = PlayerStatusState::Active;
 			else if (state == "spawning"sv)
@@ -392,7 +721,7 @@ std::shared_ptr<IConsoleLine> ServerStatusPlayerLine::TryParse(const ConsoleLine
 
 		status.m_Address = result[10].str();
 
-		return std::make_shared<ServerStatusPlayerLine>(args.m_Timestamp, std::move(status));
+		return MakeConsoleLine<ServerStatusPlayerLine>(args.m_Timestamp, std::move(status));
 	}
 
 	return nullptr;
@@ -412,7 +741,7 @@ void ServerStatusPlayerLine::Print(const PrintArgs& args) const
 std::shared_ptr<IConsoleLine> ClientReachedServerSpawnLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
 	if (args.m_Text == "Client reached server_spawn."sv)
-		return std::make_shared<ClientReachedServerSpawnLine>(args.m_Timestamp);
+		return MakeConsoleLine<ClientReachedServerSpawnLine>(args.m_Timestamp);
 
 	return nullptr;
 }
@@ -422,8 +751,8 @@ void ClientReachedServerSpawnLine::Print(const PrintArgs& args) const
 	ImGui::TextFmt("Client reached server_spawn.");
 }
 
-KillNotificationLine::KillNotificationLine(time_point_t timestamp, std::string attackerName,
-	std::string victimName, std::string weaponName, bool wasCrit) :
+KillNotificationLine::KillNotificationLine(time_point_t timestamp, InternedString attackerName,
+	InternedString victimName, std::string weaponName, bool wasCrit) :
 	BaseClass(timestamp), m_AttackerName(std::move(attackerName)), m_VictimName(std::move(victimName)),
 	m_WeaponName(std::move(weaponName)), m_WasCrit(wasCrit)
 {
@@ -431,12 +760,16 @@ KillNotificationLine::KillNotificationLine(time_point_t timestamp, std::string a
 
 std::shared_ptr<IConsoleLine> KillNotificationLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex((.*) killed (.*) with (.*)\.( \(crit\))?)regex", std::regex::optimize);
+	using namespace static_regex;
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	// (.*) killed (.*) with (.*)\.( \(crit\))?
+	static constexpr auto s_Regex = regex(seq(cap<1>(star(dot)), lit(" killed "), cap<2>(star(dot)), lit(" with "), cap<3>(star(dot)),
+		lit("."), opt(cap<4>(lit(" (crit)")))));
+
+	if (auto result = s_Regex.match(args.m_Text))
 	{
-		return std::make_shared<KillNotificationLine>(args.m_Timestamp, result[1].str(),
-			result[2].str(), result[3].str(), result[4].matched);
+		return MakeConsoleLine<KillNotificationLine>(args.m_Timestamp, InternedString(to_string_view(result[1])),
+			InternedString(to_string_view(result[2])), result[3].str(), result[4].matched);
 	}
 
 	return nullptr;
@@ -456,11 +789,11 @@ LobbyChangedLine::LobbyChangedLine(time_point_t timestamp, LobbyChangeType type)
 std::shared_ptr<IConsoleLine> LobbyChangedLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
 	if (args.m_Text == "Lobby created"sv)
-		return std::make_shared<LobbyChangedLine>(args.m_Timestamp, LobbyChangeType::Created);
+		return MakeConsoleLine<LobbyChangedLine>(args.m_Timestamp, LobbyChangeType::Created);
 	else if (args.m_Text == "Lobby updated"sv)
-		return std::make_shared<LobbyChangedLine>(args.m_Timestamp, LobbyChangeType::Updated);
+		return MakeConsoleLine<LobbyChangedLine>(args.m_Timestamp, LobbyChangeType::Updated);
 	else if (args.m_Text == "Lobby destroyed"sv)
-		return std::make_shared<LobbyChangedLine>(args.m_Timestamp, LobbyChangeType::Destroyed);
+		return MakeConsoleLine<LobbyChangedLine>(args.m_Timestamp, LobbyChangeType::Destroyed);
 
 	return nullptr;
 }
@@ -485,12 +818,17 @@ CvarlistConvarLine::CvarlistConvarLine(time_point_t timestamp, std::string name,
 
 std::shared_ptr<IConsoleLine> CvarlistConvarLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex((\S+)\s+:\s+([-\d.]+)\s+:\s+(.+)?\s+:[\t ]+(.+)?)regex", std::regex::optimize);
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	using namespace static_regex;
+
+	// (\S+)\s+:\s+([-\d.]+)\s+:\s+(.+)?\s+:[\t ]+(.+)?
+	static constexpr auto s_Regex = regex(seq(cap<1>(plus(non_space)), plus(space), lit(":"), plus(space),
+		cap<2>(plus(chars("-0123456789."))), plus(space), lit(":"), plus(space),
+		opt(cap<3>(plus(dot))), plus(space), lit(":"), plus(chars("\t ")), opt(cap<4>(plus(dot)))));
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		float value;
 		from_chars_throw(result[2], value);
-		return std::make_shared<CvarlistConvarLine>(args.m_Timestamp, result[1].str(), value, result[3].str(), result[4].str());
+		return MakeConsoleLine<CvarlistConvarLine>(args.m_Timestamp, result[1].str(), value, result[3].str(), result[4].str());
 	}
 
 	return nullptr;
@@ -509,9 +847,12 @@ ServerStatusShortPlayerLine::ServerStatusShortPlayerLine(time_point_t timestamp,
 
 std::shared_ptr<IConsoleLine> ServerStatusShortPlayerLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(#(\d+) - (.+))regex", std::regex::optimize);
+	using namespace static_regex;
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	// #(\d+) - (.+)
+	static constexpr auto s_Regex = regex(seq(lit("#"), cap<1>(plus(digit)), lit(" - "), cap<2>(plus(dot))));
+
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		PlayerStatusShort status{};
 
@@ -519,7 +860,7 @@ std::shared_ptr<IConsoleLine> ServerStatusShortPlayerLine::TryParse(const Consol
 		assert(status.m_ClientIndex >= 1);
 		status.m_Name = result[2].str();
 
-		return std::make_shared<ServerStatusShortPlayerLine>(args.m_Timestamp, std::move(status));
+		return MakeConsoleLine<ServerStatusShortPlayerLine>(args.m_Timestamp, std::move(status));
 	}
 
 	return nullptr;
@@ -538,9 +879,13 @@ VoiceReceiveLine::VoiceReceiveLine(time_point_t timestamp, uint8_t channel,
 
 std::shared_ptr<IConsoleLine> VoiceReceiveLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(Voice - chan (\d+), ent (\d+), bufsize: (\d+))regex", std::regex::optimize);
+	using namespace static_regex;
+
+	// Voice - chan (\d+), ent (\d+), bufsize: (\d+)
+	static constexpr auto s_Regex = regex(seq(lit("Voice - chan "), cap<1>(plus(digit)), lit(", ent "), cap<2>(plus(digit)),
+		lit(", bufsize: "), cap<3>(plus(digit))));
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		uint8_t channel;
 		from_chars_throw(result[1], channel);
@@ -551,7 +896,7 @@ std::shared_ptr<IConsoleLine> VoiceReceiveLine::TryParse(const ConsoleLineTryPar
 		uint16_t bufSize;
 		from_chars_throw(result[3], bufSize);
 
-		return std::make_shared<VoiceReceiveLine>(args.m_Timestamp, channel, entindex, bufSize);
+		return MakeConsoleLine<VoiceReceiveLine>(args.m_Timestamp, channel, entindex, bufSize);
 	}
 
 	return nullptr;
@@ -570,15 +915,19 @@ ServerStatusPlayerCountLine::ServerStatusPlayerCountLine(time_point_t timestamp,
 
 std::shared_ptr<IConsoleLine> ServerStatusPlayerCountLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(players : (\d+) humans, (\d+) bots \((\d+) max\))regex", std::regex::optimize);
+	using namespace static_regex;
+
+	// players : (\d+) humans, (\d+) bots \((\d+) max\)
+	static constexpr auto s_Regex = regex(seq(lit("players : "), cap<1>(plus(digit)), lit(" humans, "), cap<2>(plus(digit)),
+		lit(" bots ("), cap<3>(plus(digit)), lit(" max)")));
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		uint8_t playerCount, botCount, maxPlayers;
 		from_chars_throw(result[1], playerCount);
 		from_chars_throw(result[2], botCount);
 		from_chars_throw(result[3], maxPlayers);
-		return std::make_shared<ServerStatusPlayerCountLine>(args.m_Timestamp, playerCount, botCount, maxPlayers);
+		return MakeConsoleLine<ServerStatusPlayerCountLine>(args.m_Timestamp, playerCount, botCount, maxPlayers);
 	}
 
 	return nullptr;
@@ -596,14 +945,17 @@ EdictUsageLine::EdictUsageLine(time_point_t timestamp, uint16_t usedEdicts, uint
 
 std::shared_ptr<IConsoleLine> EdictUsageLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(edicts  : (\d+) used of (\d+) max)regex", std::regex::optimize);
+	using namespace static_regex;
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	// edicts  : (\d+) used of (\d+) max
+	static constexpr auto s_Regex = regex(seq(lit("edicts  : "), cap<1>(plus(digit)), lit(" used of "), cap<2>(plus(digit)), lit(" max")));
+
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		uint16_t usedEdicts, totalEdicts;
 		from_chars_throw(result[1], usedEdicts);
 		from_chars_throw(result[2], totalEdicts);
-		return std::make_shared<EdictUsageLine>(args.m_Timestamp, usedEdicts, totalEdicts);
+		return MakeConsoleLine<EdictUsageLine>(args.m_Timestamp, usedEdicts, totalEdicts);
 	}
 
 	return nullptr;
@@ -621,13 +973,16 @@ PingLine::PingLine(time_point_t timestamp, uint16_t ping, std::string playerName
 
 std::shared_ptr<IConsoleLine> PingLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex( *(\d+) ms : (.{1,32}))regex", std::regex::optimize);
+	using namespace static_regex;
+
+	//  *(\d+) ms : (.{1,32})
+	static constexpr auto s_Regex = regex(seq(star(chars(" ")), cap<1>(plus(digit)), lit(" ms : "), cap<2>(repeat(dot, 1, 32))));
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		uint16_t ping;
 		from_chars_throw(result[1], ping);
-		return std::make_shared<PingLine>(args.m_Timestamp, ping, result[2].str());
+		return MakeConsoleLine<PingLine>(args.m_Timestamp, ping, result[2].str());
 	}
 
 	return nullptr;
@@ -645,16 +1000,22 @@ SVCUserMessageLine::SVCUserMessageLine(time_point_t timestamp, std::string addre
 
 std::shared_ptr<IConsoleLine> SVCUserMessageLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(Msg from ((?:\d+\.\d+\.\d+\.\d+:\d+)|loopback): svc_UserMessage: type (\d+), bytes (\d+))regex", std::regex::optimize);
+	using namespace static_regex;
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	// Msg from ((?:\d+\.\d+\.\d+\.\d+:\d+)|loopback): svc_UserMessage: type (\d+), bytes (\d+)
+	static constexpr auto s_Regex = regex(seq(lit("Msg from "),
+		cap<1>(alt(seq(plus(digit), lit("."), plus(digit), lit("."), plus(digit), lit("."), plus(digit), lit(":"), plus(digit)),
+			lit("loopback"))),
+		lit(": svc_UserMessage: type "), cap<2>(plus(digit)), lit(", bytes "), cap<3>(plus(digit))));
+
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		uint16_t type, bytes;
 		from_chars_throw(result[2], type);
 
 		from_chars_throw(result[3], bytes);
 
-		return std::make_shared<SVCUserMessageLine>(args.m_Timestamp, result[1].str(), UserMessageType(type), bytes);
+		return MakeConsoleLine<SVCUserMessageLine>(args.m_Timestamp, result[1].str(), UserMessageType(type), bytes);
 	}
 
 	return nullptr;
@@ -663,12 +1024,7 @@ std::shared_ptr<IConsoleLine> SVCUserMessageLine::TryParse(const ConsoleLineTryP
 bool SVCUserMessageLine::IsSpecial(UserMessageType type)
 {
 #ifdef _DEBUG
-	return mh::any_eq(type,
-		UserMessageType::CallVoteFailed,
-		UserMessageType::VoteFailed,
-		UserMessageType::VotePass,
-		UserMessageType::VoteSetup,
-		UserMessageType::VoteStart);
+	return GetUserMessageTypeInfo(type).m_IsVote;
 #else
 	return false;
 #endif
@@ -690,7 +1046,7 @@ void SVCUserMessageLine::Print(const PrintArgs& args) const
 std::shared_ptr<IConsoleLine> LobbyStatusFailedLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
 	if (args.m_Text == "Failed to find lobby shared object"sv)
-		return std::make_shared<LobbyStatusFailedLine>(args.m_Timestamp);
+		return MakeConsoleLine<LobbyStatusFailedLine>(args.m_Timestamp);
 
 	return nullptr;
 }
@@ -710,12 +1066,15 @@ std::shared_ptr<IConsoleLine> ConfigExecLine::TryParse(const ConsoleLineTryParse
 	// Success
 	constexpr auto prefix = "execing "sv;
 	if (args.m_Text.starts_with(prefix))
-		return std::make_shared<ConfigExecLine>(args.m_Timestamp, std::string(args.m_Text.substr(prefix.size())), true);
+		return MakeConsoleLine<ConfigExecLine>(args.m_Timestamp, std::string(args.m_Text.substr(prefix.size())), true);
 
 	// Failure
-	static const std::regex s_Regex(R"regex('(.*)' not present; not executing\.)regex", std::regex::optimize);
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
-		return std::make_shared<ConfigExecLine>(args.m_Timestamp, result[1].str(), false);
+	using namespace static_regex;
+
+	// '(.*)' not present; not executing\.
+	static constexpr auto s_Regex = regex(seq(lit("'"), cap<1>(star(dot)), lit("' not present; not executing.")));
+	if (auto result = s_Regex.match(args.m_Text))
+		return MakeConsoleLine<ConfigExecLine>(args.m_Timestamp, result[1].str(), false);
 
 	return nullptr;
 }
@@ -736,16 +1095,22 @@ ServerStatusMapLine::ServerStatusMapLine(time_point_t timestamp, std::string map
 
 std::shared_ptr<IConsoleLine> ServerStatusMapLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(map     : (.*) at: ((?:-|\d)+) x, ((?:-|\d)+) y, ((?:-|\d)+) z)regex", std::regex::optimize);
+	using namespace static_regex;
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	// map     : (.*) at: ((?:-|\d)+) x, ((?:-|\d)+) y, ((?:-|\d)+) z
+	static constexpr auto s_Regex = regex(seq(lit("map     : "), cap<1>(star(dot)), lit(" at: "),
+		cap<2>(plus(chars("-0123456789"))), lit(" x, "),
+		cap<3>(plus(chars("-0123456789"))), lit(" y, "),
+		cap<4>(plus(chars("-0123456789"))), lit(" z")));
+
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		std::array<float, 3> pos{};
 		from_chars_throw(result[2], pos[0]);
 		from_chars_throw(result[3], pos[1]);
 		from_chars_throw(result[4], pos[2]);
 
-		return std::make_shared<ServerStatusMapLine>(args.m_Timestamp, result[1].str(), pos);
+		return MakeConsoleLine<ServerStatusMapLine>(args.m_Timestamp, result[1].str(), pos);
 	}
 
 	return nullptr;
@@ -760,7 +1125,7 @@ void ServerStatusMapLine::Print(const PrintArgs& args) const
 std::shared_ptr<IConsoleLine> TeamsSwitchedLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
 	if (args.m_Text == "Teams have been switched."sv)
-		return std::make_unique<TeamsSwitchedLine>(args.m_Timestamp);
+		return MakeConsoleLine<TeamsSwitchedLine>(args.m_Timestamp);
 
 	return nullptr;
 }
@@ -787,15 +1152,22 @@ ConnectingLine::ConnectingLine(time_point_t timestamp, std::string address, bool
 std::shared_ptr<IConsoleLine> ConnectingLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
 	{
-		static const std::regex s_ConnectingRegex(R"regex(Connecting to( matchmaking server)? (.*?)(\.\.\.)?)regex", std::regex::optimize);
-		if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_ConnectingRegex))
-			return std::make_shared<ConnectingLine>(args.m_Timestamp, result[2].str(), result[1].matched, false);
+		using namespace static_regex;
+
+		// Connecting to( matchmaking server)? (.*?)(\.\.\.)?
+		static constexpr auto s_ConnectingRegex = regex(seq(lit("Connecting to"), opt(cap<1>(lit(" matchmaking server"))), lit(" "),
+			cap<2>(lazy_star(dot)), opt(cap<3>(lit("...")))));
+		if (auto result = s_ConnectingRegex.match(args.m_Text))
+			return MakeConsoleLine<ConnectingLine>(args.m_Timestamp, result[2].str(), result[1].matched, false);
 	}
 
 	{
-		static const std::regex s_RetryingRegex(R"regex(Retrying (.*)\.\.\.)regex", std::regex::optimize);
-		if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_RetryingRegex))
-			return std::make_shared<ConnectingLine>(args.m_Timestamp, result[1].str(), false, true);
+		using namespace static_regex;
+
+		// Retrying (.*)\.\.\.
+		static constexpr auto s_RetryingRegex = regex(seq(lit("Retrying "), cap<1>(star(dot)), lit("...")));
+		if (auto result = s_RetryingRegex.match(args.m_Text))
+			return MakeConsoleLine<ConnectingLine>(args.m_Timestamp, result[1].str(), false, true);
 	}
 
 	return nullptr;
@@ -814,7 +1186,7 @@ void ConnectingLine::Print(const PrintArgs& args) const
 std::shared_ptr<IConsoleLine> HostNewGameLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
 	if (args.m_Text == "---- Host_NewGame ----"sv)
-		return std::make_shared<HostNewGameLine>(args.m_Timestamp);
+		return MakeConsoleLine<HostNewGameLine>(args.m_Timestamp);
 
 	return nullptr;
 }
@@ -831,8 +1203,12 @@ PartyHeaderLine::PartyHeaderLine(time_point_t timestamp, TFParty party) :
 
 std::shared_ptr<IConsoleLine> PartyHeaderLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(TFParty:\s+ID:([0-9a-f]+)\s+(\d+) member\(s\)\s+LeaderID: (\[.*\]))regex", std::regex::optimize);
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	using namespace static_regex;
+
+	// TFParty:\s+ID:([0-9a-f]+)\s+(\d+) member\(s\)\s+LeaderID: (\[.*\])
+	static constexpr auto s_Regex = regex(seq(lit("TFParty:"), plus(space), lit("ID:"), cap<1>(plus(hex_lower)), plus(space),
+		cap<2>(plus(digit)), lit(" member(s)"), plus(space), lit("LeaderID: "), cap<3>(seq(lit("["), star(dot), lit("]")))));
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		TFParty party{};
 
@@ -846,7 +1222,7 @@ std::shared_ptr<IConsoleLine> PartyHeaderLine::TryParse(const ConsoleLineTryPars
 
 		party.m_LeaderID = SteamID(result[3].str());
 
-		return std::make_shared<PartyHeaderLine>(args.m_Timestamp, std::move(party));
+		return MakeConsoleLine<PartyHeaderLine>(args.m_Timestamp, std::move(party));
 	}
 
 	return nullptr;
@@ -861,7 +1237,7 @@ void PartyHeaderLine::Print(const PrintArgs& args) const
 std::shared_ptr<IConsoleLine> GameQuitLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
 	if (args.m_Text == "CTFGCClientSystem::ShutdownGC"sv)
-		return std::make_shared<GameQuitLine>(args.m_Timestamp);
+		return MakeConsoleLine<GameQuitLine>(args.m_Timestamp);
 
 	return nullptr;
 }
@@ -905,7 +1281,7 @@ std::shared_ptr<IConsoleLine> QueueStateChangeLine::TryParse(const ConsoleLineTr
 	for (const auto& match : QUEUE_STATE_CHANGE_TYPES)
 	{
 		if (args.m_Text == match.m_String)
-			return std::make_shared<QueueStateChangeLine>(args.m_Timestamp, match.m_QueueType, match.m_StateChange);
+			return MakeConsoleLine<QueueStateChangeLine>(args.m_Timestamp, match.m_QueueType, match.m_StateChange);
 	}
 
 	return nullptr;
@@ -931,11 +1307,14 @@ InQueueLine::InQueueLine(time_point_t timestamp, TFMatchGroup queueType, time_po
 
 std::shared_ptr<IConsoleLine> InQueueLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(
-		R"regex(    MatchGroup: (\d+)\s+Started matchmaking:\s+(.*)\s+\(\d+ seconds ago, now is (.*)\))regex",
-		std::regex::optimize);
+	using namespace static_regex;
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	//     MatchGroup: (\d+)\s+Started matchmaking:\s+(.*)\s+\(\d+ seconds ago, now is (.*)\)
+	static constexpr auto s_Regex = regex(seq(lit("    MatchGroup: "), cap<1>(plus(digit)), plus(space),
+		lit("Started matchmaking:"), plus(space), cap<2>(star(dot)), plus(space),
+		lit("("), plus(digit), lit(" seconds ago, now is "), cap<3>(star(dot)), lit(")")));
+
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		TFMatchGroup matchGroup = TFMatchGroup::Invalid;
 		{
@@ -961,7 +1340,7 @@ std::shared_ptr<IConsoleLine> InQueueLine::TryParse(const ConsoleLineTryParseArg
 			}
 		}
 
-		return std::make_shared<InQueueLine>(args.m_Timestamp, matchGroup, startTime);
+		return MakeConsoleLine<InQueueLine>(args.m_Timestamp, matchGroup, startTime);
 	}
 
 	return nullptr;
@@ -992,11 +1371,14 @@ ServerJoinLine::ServerJoinLine(time_point_t timestamp, std::string hostName, std
 
 std::shared_ptr<IConsoleLine> ServerJoinLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(
-		R"regex(\n(.*)\nMap: (.*)\nPlayers: (\d+) \/ (\d+)\nBuild: (\d+)\nServer Number: (\d+)\s+)regex",
-		std::regex::optimize);
+	using namespace static_regex;
+
+	// \n(.*)\nMap: (.*)\nPlayers: (\d+) \/ (\d+)\nBuild: (\d+)\nServer Number: (\d+)\s+
+	static constexpr auto s_Regex = regex(seq(lit("\n"), cap<1>(star(dot)), lit("\nMap: "), cap<2>(star(dot)),
+		lit("\nPlayers: "), cap<3>(plus(digit)), lit(" / "), cap<4>(plus(digit)),
+		lit("\nBuild: "), cap<5>(plus(digit)), lit("\nServer Number: "), cap<6>(plus(digit)), plus(space)));
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		uint32_t buildNumber, serverNumber;
 		from_chars_throw(result[5], buildNumber);
@@ -1006,7 +1388,7 @@ std::shared_ptr<IConsoleLine> ServerJoinLine::TryParse(const ConsoleLineTryParse
 		from_chars_throw(result[3], playerCount);
 		from_chars_throw(result[4], playerMaxCount);
 
-		return std::make_shared<ServerJoinLine>(args.m_Timestamp, result[1].str(), result[2].str(),
+		return MakeConsoleLine<ServerJoinLine>(args.m_Timestamp, result[1].str(), result[2].str(),
 			playerCount, playerMaxCount, buildNumber, serverNumber);
 	}
 
@@ -1026,11 +1408,14 @@ ServerDroppedPlayerLine::ServerDroppedPlayerLine(time_point_t timestamp, std::st
 
 std::shared_ptr<IConsoleLine> ServerDroppedPlayerLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(Dropped (.*) from server \((.*)\))regex", std::regex::optimize);
+	using namespace static_regex;
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	// Dropped (.*) from server \((.*)\)
+	static constexpr auto s_Regex = regex(seq(lit("Dropped "), cap<1>(star(dot)), lit(" from server ("), cap<2>(star(dot)), lit(")")));
+
+	if (auto result = s_Regex.match(args.m_Text))
 	{
-		return std::make_shared<ServerDroppedPlayerLine>(args.m_Timestamp, result[1].str(), result[2].str());
+		return MakeConsoleLine<ServerDroppedPlayerLine>(args.m_Timestamp, result[1].str(), result[2].str());
 	}
 
 	return nullptr;
@@ -1048,10 +1433,13 @@ ServerStatusPlayerIPLine::ServerStatusPlayerIPLine(time_point_t timestamp, std::
 
 std::shared_ptr<IConsoleLine> ServerStatusPlayerIPLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(udp\/ip  : (.*)  \(public ip: (.*)\))regex", std::regex::optimize);
+	using namespace static_regex;
+
+	// udp\/ip  : (.*)  \(public ip: (.*)\)
+	static constexpr auto s_Regex = regex(seq(lit("udp/ip  : "), cap<1>(star(dot)), lit("  (public ip: "), cap<2>(star(dot)), lit(")")));
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
-		return std::make_shared<ServerStatusPlayerIPLine>(args.m_Timestamp, result[1].str(), result[2].str());
+	if (auto result = s_Regex.match(args.m_Text))
+		return MakeConsoleLine<ServerStatusPlayerIPLine>(args.m_Timestamp, result[1].str(), result[2].str());
 
 	return nullptr;
 }
@@ -1070,11 +1458,18 @@ DifferingLobbyReceivedLine::DifferingLobbyReceivedLine(time_point_t timestamp, c
 
 std::shared_ptr<IConsoleLine> DifferingLobbyReceivedLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(
-		R"regex(Differing lobby received\. Lobby: (.*)\/Match(\d+)\/Lobby(\d+) CurrentlyAssigned: (.*)\/Match(\d+)\/Lobby(\d+) ConnectedToMatchServer: (\d+) HasLobby: (\d+) AssignedMatchEnded: (\d+))regex",
-		std::regex::optimize);
+	using namespace static_regex;
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	// Differing lobby received\. Lobby: (.*)\/Match(\d+)\/Lobby(\d+) CurrentlyAssigned: (.*)\/Match(\d+)\/Lobby(\d+) ConnectedToMatchServer: (\d+) HasLobby: (\d+) AssignedMatchEnded: (\d+)
+	static constexpr auto s_Regex = regex(seq(lit("Differing lobby received. Lobby: "),
+		cap<1>(star(dot)), lit("/Match"), cap<2>(plus(digit)), lit("/Lobby"), cap<3>(plus(digit)),
+		lit(" CurrentlyAssigned: "),
+		cap<4>(star(dot)), lit("/Match"), cap<5>(plus(digit)), lit("/Lobby"), cap<6>(plus(digit)),
+		lit(" ConnectedToMatchServer: "), cap<7>(plus(digit)),
+		lit(" HasLobby: "), cap<8>(plus(digit)),
+		lit(" AssignedMatchEnded: "), cap<9>(plus(digit))));
+
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		Lobby newLobby;
 		newLobby.m_LobbyID = SteamID(result[1].str());
@@ -1091,7 +1486,7 @@ std::shared_ptr<IConsoleLine> DifferingLobbyReceivedLine::TryParse(const Console
 		from_chars_throw(result[8], hasLobby);
 		from_chars_throw(result[9], assignedMatchEnded);
 
-		return std::make_shared<DifferingLobbyReceivedLine>(args.m_Timestamp, newLobby, currentLobby,
+		return MakeConsoleLine<DifferingLobbyReceivedLine>(args.m_Timestamp, newLobby, currentLobby,
 			connectedToMatchServer, hasLobby, assignedMatchEnded);
 	}
 
@@ -1122,7 +1517,7 @@ TEST_CASE("ProcessChatMessage - Newlines", "[tf2bd]")
 {
 	const auto TestProcessChatMessage = [](std::string message)
 	{
-		ChatConsoleLine line(tfbd_clock_t::now(), "<playername>", std::move(message), false, false, false, TeamShareResult::SameTeams, SteamID{});
+		ChatConsoleLine line(tfbd_clock_t::now(), InternedString("<playername>"), std::move(message), false, false, false, TeamShareResult::SameTeams, SteamID{});
 
 		Settings::Theme dummyTheme;
 
@@ -1156,16 +1551,19 @@ MatchmakingBannedTimeLine::MatchmakingBannedTimeLine(time_point_t timestamp, Lad
 
 std::shared_ptr<IConsoleLine> MatchmakingBannedTimeLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex((?:(casual)|(?:ranked))_banned_time: (\d+))regex", std::regex::optimize);
+	using namespace static_regex;
+
+	// (?:(casual)|(?:ranked))_banned_time: (\d+)
+	static constexpr auto s_Regex = regex(seq(alt(cap<1>(lit("casual")), lit("ranked")), lit("_banned_time: "), cap<2>(plus(digit))));
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		const LadderType ladderType = result[1].matched ? LadderType::Casual : LadderType::Competitive;
 
 		uint64_t bannedTime;
 		from_chars_throw(result[2], bannedTime);
 
-		return std::make_shared<MatchmakingBannedTimeLine>(args.m_Timestamp, ladderType, bannedTime);
+		return MakeConsoleLine<MatchmakingBannedTimeLine>(args.m_Timestamp, ladderType, bannedTime);
 	}
 
 	return nullptr;
@@ -5,12 +5,16 @@
 #include "LobbyMember.h"
 #include "PlayerStatus.h"
 #include "IConsoleLine.h"
+#include "Util/InternedString.h"
+#include "Util/SharedStringView.h"
 
 #include <mh/reflection/enum.hpp>
 
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <string_view>
+#include <vector>
 
 namespace tf2_bot_detector
 {
@@ -25,15 +29,16 @@ namespace tf2_bot_detector
 		using BaseClass = ConsoleLineBase;
 
 	public:
-		GenericConsoleLine(time_point_t timestamp, std::string text);
+		GenericConsoleLine(time_point_t timestamp, SharedStringView text);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::Generic; }
 		bool ShouldPrint() const override { return false; }
 		void Print(const PrintArgs& args) const override;
+		void ReleaseTextBuffer() override;
 
 	private:
-		std::string m_Text;
+		SharedStringView m_Text;
 	};
 
 	class ChatConsoleLine final : public ConsoleLineBase<ChatConsoleLine, false>
@@ -41,31 +46,49 @@ namespace tf2_bot_detector
 		using BaseClass = ConsoleLineBase;
 
 	public:
-		ChatConsoleLine(time_point_t timestamp, std::string playerName, std::string message, bool isDead,
+		ChatConsoleLine(time_point_t timestamp, InternedString playerName, SharedStringView message, bool isDead,
 			bool isTeam, bool isSelf, TeamShareResult teamShare, SteamID id);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
 		//static std::shared_ptr<ChatConsoleLine> TryParseFlexible(const std::string_view& text, time_point_t timestamp);
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::Chat; }
 		void Print(const PrintArgs& args) const override;
+		void ReleaseTextBuffer() override;
 
-		const std::string& GetPlayerName() const { return m_PlayerName; }
-		const std::string& GetMessage() const { return m_Message; }
+		const InternedString& GetPlayerName() const { return m_PlayerName; }
+		SteamID GetPlayerSteamID() const { return m_PlayerSteamID; }
+		std::string_view GetMessage() const { return m_Message; }
 		bool IsDead() const { return m_IsDead; }
 		bool IsTeam() const { return m_IsTeam; }
 		bool IsSelf() const { return m_IsSelf; }
 		TeamShareResult GetTeamShareResult() const { return m_TeamShareResult; }
 
+		void SetSender(SteamID id, bool isSelf, TeamShareResult teamShare);
+
+		// One piece of text that Print() draws
+		struct PrintRun
+		{
+			std::array<float, 4> m_Color;
+			std::string_view m_Text;           // Into the message or player name, or a literal
+			uint32_t m_CollapsedNewlines = 0;  // Drawn as "(\n x N)" instead of m_Text if nonzero
+			bool m_SameLine = false;           // The next run continues on the same line
+		};
+
 	private:
 		//static std::shared_ptr<ChatConsoleLine> TryParse(const std::string_view& text, time_point_t timestamp, bool flexible);
 
-		std::string m_PlayerName;
-		std::string m_Message;
+		InternedString m_PlayerName;
+		SharedStringView m_Message;
 		SteamID m_PlayerSteamID;
 		TeamShareResult m_TeamShareResult;
 		bool m_IsDead : 1;
 		bool m_IsTeam : 1;
 		bool m_IsSelf : 1;
+
+		// Worked out on the first Print(), and again if the theme color of the name has changed since.
+		// Thrown away whenever the message moves or the sender changes.
+		mutable std::vector<PrintRun> m_PrintRuns;
+		mutable std::array<float, 4> m_PrintRunsNameColor{};
 	};
 
 	class LobbyStatusFailedLine final : public ConsoleLineBase<LobbyStatusFailedLine>
@@ -75,6 +98,7 @@ namespace tf2_bot_detector
 	public:
 		using ConsoleLineBase::ConsoleLineBase;
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "Failed to find lobby shared object" };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::LobbyStatusFailed; }
 		bool ShouldPrint() const override { return false; }
@@ -88,6 +112,7 @@ namespace tf2_bot_detector
 	public:
 		PartyHeaderLine(time_point_t timestamp, TFParty party);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "TFParty:" };
 
 		const TFParty& GetParty() const { return m_Party; }
 
@@ -106,6 +131,7 @@ namespace tf2_bot_detector
 	public:
 		LobbyHeaderLine(time_point_t timestamp, unsigned memberCount, unsigned pendingCount);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "CTFLobbyShared: " };
 
 		auto GetMemberCount() const { return m_MemberCount; }
 		auto GetPendingCount() const { return m_PendingCount; }
@@ -126,6 +152,7 @@ namespace tf2_bot_detector
 	public:
 		LobbyMemberLine(time_point_t timestamp, const LobbyMember& lobbyMember);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { " ", "\t" };
 
 		const LobbyMember& GetLobbyMember() const { return m_LobbyMember; }
 
@@ -151,6 +178,7 @@ namespace tf2_bot_detector
 	public:
 		LobbyChangedLine(time_point_t timestamp, LobbyChangeType type);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "Lobby " };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::LobbyChanged; }
 		LobbyChangeType GetChangeType() const { return m_ChangeType; }
@@ -176,6 +204,7 @@ namespace tf2_bot_detector
 		DifferingLobbyReceivedLine(time_point_t timestamp, const Lobby& newLobby, const Lobby& currentLobby,
 			bool connectedToMatchServer, bool hasLobby, bool assignedMatchEnded);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "Differing lobby received. " };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::DifferingLobbyReceived; }
 		bool ShouldPrint() const override { return false; }
@@ -202,6 +231,7 @@ namespace tf2_bot_detector
 	public:
 		ServerStatusPlayerLine(time_point_t timestamp, PlayerStatus playerStatus);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "#" };
 
 		const PlayerStatus& GetPlayerStatus() const { return m_PlayerStatus; }
 
@@ -220,6 +250,7 @@ namespace tf2_bot_detector
 	public:
 		ServerStatusPlayerIPLine(time_point_t timestamp, std::string localIP, std::string publicIP);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "udp/ip  : " };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::PlayerStatusIP; }
 		bool ShouldPrint() const override { return false; }
@@ -240,6 +271,7 @@ namespace tf2_bot_detector
 	public:
 		ServerStatusShortPlayerLine(time_point_t timestamp, PlayerStatusShort playerStatus);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "#" };
 
 		const PlayerStatusShort& GetPlayerStatus() const { return m_PlayerStatus; }
 
@@ -259,6 +291,7 @@ namespace tf2_bot_detector
 		ServerStatusPlayerCountLine(time_point_t timestamp, uint8_t playerCount,
 			uint8_t botCount, uint8_t maxPlayers);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "players : " };
 
 		uint8_t GetPlayerCount() const { return m_PlayerCount; }
 		uint8_t GetBotCount() const { return m_BotCount; }
@@ -281,6 +314,7 @@ namespace tf2_bot_detector
 	public:
 		ServerStatusMapLine(time_point_t timestamp, std::string mapName, const std::array<float, 3>& position);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "map     : " };
 
 		const std::string& GetMapName() const { return m_MapName; }
 		const std::array<float, 3>& GetPosition() const { return m_Position; }
@@ -301,6 +335,7 @@ namespace tf2_bot_detector
 	public:
 		EdictUsageLine(time_point_t timestamp, uint16_t usedEdicts, uint16_t totalEdicts);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "edicts  : " };
 
 		uint16_t GetUsedEdicts() const { return m_UsedEdicts; }
 		uint16_t GetTotalEdicts() const { return m_TotalEdicts; }
@@ -321,6 +356,7 @@ namespace tf2_bot_detector
 	public:
 		using ConsoleLineBase::ConsoleLineBase;
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "Client reached server_spawn." };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::ClientReachedServerSpawn; }
 		bool ShouldPrint() const override { return false; }
@@ -332,12 +368,12 @@ namespace tf2_bot_detector
 		using BaseClass = ConsoleLineBase;
 
 	public:
-		KillNotificationLine(time_point_t timestamp, std::string attackerName,
-			std::string victimName, std::string weaponName, bool wasCrit);
+		KillNotificationLine(time_point_t timestamp, InternedString attackerName,
+			InternedString victimName, std::string weaponName, bool wasCrit);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
 
-		const std::string& GetVictimName() const { return m_VictimName; }
-		const std::string& GetAttackerName() const { return m_AttackerName; }
+		const InternedString& GetVictimName() const { return m_VictimName; }
+		const InternedString& GetAttackerName() const { return m_AttackerName; }
 		const std::string& GetWeaponName() const { return m_WeaponName; }
 		bool WasCrit() const { return m_WasCrit; }
 
@@ -346,8 +382,8 @@ namespace tf2_bot_detector
 		void Print(const PrintArgs& args) const override;
 
 	private:
-		std::string m_AttackerName;
-		std::string m_VictimName;
+		InternedString m_AttackerName;
+		InternedString m_VictimName;
 		std::string m_WeaponName;
 		bool m_WasCrit;
 	};
@@ -383,6 +419,7 @@ namespace tf2_bot_detector
 	public:
 		VoiceReceiveLine(time_point_t timestamp, uint8_t channel, uint8_t entindex, uint16_t bufSize);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "Voice - chan " };
 
 		uint8_t GetEntIndex() const { return m_Entindex; }
 
@@ -403,6 +440,7 @@ namespace tf2_bot_detector
 	public:
 		PingLine(time_point_t timestamp, uint16_t ping, std::string playerName);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { " ", "0", "1", "2", "3", "4", "5", "6", "7", "8", "9" };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::Ping; }
 		bool ShouldPrint() const override { return false; }
@@ -423,6 +461,7 @@ namespace tf2_bot_detector
 	public:
 		SVCUserMessageLine(time_point_t timestamp, std::string address, UserMessageType type, uint16_t bytes);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "Msg from " };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::SVC_UserMessage; }
 		bool ShouldPrint() const override;
@@ -447,6 +486,7 @@ namespace tf2_bot_detector
 	public:
 		ConfigExecLine(time_point_t timestamp, std::string configFileName, bool success);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "execing ", "'" };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::ConfigExec; }
 		bool ShouldPrint() const override { return false; }
@@ -467,6 +507,7 @@ namespace tf2_bot_detector
 	public:
 		TeamsSwitchedLine(time_point_t timestamp) : BaseClass(timestamp) {}
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "Teams have been switched." };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::TeamsSwitched; }
 		bool ShouldPrint() const override;
@@ -487,6 +528,7 @@ namespace tf2_bot_detector
 	public:
 		ConnectingLine(time_point_t timestamp, std::string address, bool isMatchmaking, bool isRetrying);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "Connecting to", "Retrying " };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::Connecting; }
 		bool ShouldPrint() const override { return false; }
@@ -507,6 +549,7 @@ namespace tf2_bot_detector
 	public:
 		HostNewGameLine(time_point_t timestamp) : BaseClass(timestamp) {}
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "---- Host_NewGame ----" };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::HostNewGame; }
 		bool ShouldPrint() const override { return false; }
@@ -520,6 +563,7 @@ namespace tf2_bot_detector
 	public:
 		GameQuitLine(time_point_t timestamp) : BaseClass(timestamp) {}
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "CTFGCClientSystem::ShutdownGC" };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::GameQuit; }
 		bool ShouldPrint() const override { return false; }
@@ -533,6 +577,7 @@ namespace tf2_bot_detector
 	public:
 		QueueStateChangeLine(time_point_t timestamp, TFMatchGroup queueType, TFQueueStateChange stateChange);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "[PartyClient] " };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::QueueStateChange; }
 		bool ShouldPrint() const override { return false; }
@@ -553,6 +598,7 @@ namespace tf2_bot_detector
 	public:
 		InQueueLine(time_point_t timestamp, TFMatchGroup queueType, time_point_t queueStartTime);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "    MatchGroup: " };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::InQueue; }
 		bool ShouldPrint() const override { return false; }
@@ -574,6 +620,7 @@ namespace tf2_bot_detector
 		ServerJoinLine(time_point_t timestamp, std::string hostName, std::string mapName,
 			uint8_t playerCount, uint8_t playerMaxCount, uint32_t buildNumber, uint32_t serverNumber);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "\n" };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::ServerJoin; }
 		bool ShouldPrint() const override { return false; }
@@ -602,6 +649,7 @@ namespace tf2_bot_detector
 	public:
 		ServerDroppedPlayerLine(time_point_t timestamp, std::string playerName, std::string reason);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "Dropped " };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::ServerDroppedPlayer; }
 		bool ShouldPrint() const override { return false; }
@@ -628,6 +676,7 @@ namespace tf2_bot_detector
 
 		MatchmakingBannedTimeLine(time_point_t timestamp, LadderType ladderType, uint64_t bannedTime);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "casual_banned_time: ", "ranked_banned_time: " };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::MatchmakingBannedTime; }
 		bool ShouldPrint() const override { return false; }
@@ -1,94 +1,431 @@
 #include "ConsoleLogParser.h"
+#include "ConsoleLogTimestamp.h"
 #include "Config/ChatWrappers.h"
 #include "ConsoleLog/ConsoleLineListener.h"
 #include "ConsoleLines.h"
 #include "Log.h"
-#include "Util/RegexUtils.h"
 #include "Config/Settings.h"
 #include "WorldState.h"
 #include "Platform/Platform.h"
+#include "Util/Profiler.h"
+#include "SessionArchive.h"
 
 #include <mh/text/format.hpp>
 #include <mh/text/formatters/error_code.hpp>
 #include <mh/future.hpp>
+#include <nlohmann/json.hpp>
 
-#include <regex>
+#include <algorithm>
+#include <cassert>
 
 using namespace std::chrono_literals;
 using namespace std::string_literals;
 using namespace tf2_bot_detector;
 
+namespace
+{
+	// About a second and a half of reading at full speed
+	constexpr uint64_t OVERLOAD_BACKLOG_BYTES = 8 * 1024 * 1024;
+
+	// Lower than the threshold to start shedding, so we don't flip back and forth on the edge
+	constexpr uint64_t OVERLOAD_RECOVERED_BACKLOG_BYTES = 512 * 1024;
+
+	// Once we've read this much of the current log file, TF2 is switched over to the other one
+	constexpr uint64_t ROTATE_LOG_FILE_BYTES = 16 * 1024 * 1024;
+
+	void TruncateFile(const std::filesystem::path& path)
+	{
+		std::error_code ec;
+		const auto filesize = std::filesystem::file_size(path, ec);
+		if (ec)
+		{
+			if (ec != std::errc::no_such_file_or_directory)
+				LogWarning("Failed to get size of {}: {}", path, ec);
+		}
+		else if (filesize == 0)
+			return;
+		else if (std::filesystem::resize_file(path, 0, ec); ec)
+			Log("Unable to truncate {}, current size is {}", path, filesize);
+		else
+			Log("Truncated {}", path);
+	}
+}
+
 void ConsoleLogParser::TrySnapshot(bool& snapshotUpdated)
 {
 	if ((!snapshotUpdated || !m_CurrentTimestamp.IsSnapshotValid()) && m_CurrentTimestamp.IsRecordedValid())
 	{
 		m_CurrentTimestamp.Snapshot();
 		snapshotUpdated = true;
-		m_WorldState->UpdateTimestamp(*this);
+		OnTimestampSnapshot();
 	}
 }
 
 ConsoleLogParser::ConsoleLogParser(IWorldState& world, const Settings& settings, std::filesystem::path conLogFile) :
-	m_Settings(&settings), m_WorldState(&world), m_FileName(std::move(conLogFile))
+	m_Settings(&settings), m_WorldState(&world), m_FileName(std::move(conLogFile)),
+	m_LastCaughtUpTime(clock_t::now())
+{
+	// console.log -> console_alt.log, right next to it
+	m_AltFileName = m_FileName;
+	m_AltFileName.replace_filename(m_FileName.stem().string() + "_alt" + m_FileName.extension().string());
+
+	m_ConLogFileNames[0] = m_FileName.filename().string();
+	m_ConLogFileNames[1] = m_AltFileName.filename().string();
+}
+
+ConsoleLogParser::~ConsoleLogParser()
 {
+	// Our listeners may already be partially destroyed
+	StopWorker(false);
 }
 
 void ConsoleLogParser::Update()
+{
+	TF2BD_PROFILE_SCOPE("ConsoleLogParser::Update");
+
+	if (m_Settings->m_BackgroundConsoleLogParsing != m_IsWorkerActive)
+	{
+		if (m_IsWorkerActive)
+			StopWorker(true);
+		else
+			StartWorker();
+	}
+
+	if (m_IsWorkerActive)
+	{
+		DispatchQueuedEvents();
+	}
+	else
+	{
+		bool caughtUp;
+		ReadAndParse(caughtUp);
+	}
+}
+
+void ConsoleLogParser::TryOpenFile()
 {
 	const auto now = clock_t::now();
-	if (!m_File && (now - m_LastFileLoadAttempt) > 1s)
+	if (m_File || (now - m_LastFileLoadAttempt) <= 1s)
+		return;
+
+	m_LastFileLoadAttempt = now;
+
+	const auto& fileName = GetActiveFileName();
+	if (m_TruncateOnOpen)
 	{
-		m_LastFileLoadAttempt = now;
+		// Nothing from before we started is wanted, including anything left over in the other file
+		TruncateFile(fileName);
+		TruncateFile(GetFileName(1 - m_ActiveFile));
+	}
 
-		// Try to truncate
+	std::error_code ec;
+	{
+		FILE* temp = _wfsopen(fileName.c_str(), L"r", _SH_DENYNO);
+		if (!temp)
 		{
-			std::error_code ec;
-			const auto filesize = std::filesystem::file_size(m_FileName, ec);
-			if (ec)
-				LogWarning("Failed to get size of {}: {}", m_FileName, ec);
-			else if (std::filesystem::resize_file(m_FileName, 0, ec); ec)
-				Log("Unable to truncate {}, current size is {}", m_FileName, filesize);
-			else
-				Log("Truncated console log file");
+			auto e = errno;
+			ec = std::error_code(e, std::generic_category());
 		}
+		m_File.reset(temp);
+	}
 
-		std::error_code ec;
-		{
-			FILE* temp = _wfsopen(m_FileName.c_str(), L"r", _SH_DENYNO);
-			if (!temp)
-			{
-				auto e = errno;
-				ec = std::error_code(e, std::generic_category());
-			}
-			m_File.reset(temp);
-		}
+	if (!m_File)
+	{
+		DebugLog("Failed to open {}: {}", fileName, ec);
+	}
+	else
+	{
+		Log("Successfully opened {}", fileName);
+
+		// We always read in large blocks into m_ReadBuf, so the CRT's own buffer would just be an extra copy
+		setvbuf(m_File.get(), nullptr, _IONBF, 0);
+		m_TruncateOnOpen = false;
+		m_FilePos = 0;
+		m_FileSize = 0;
+		m_LastFileSizeUpdate = {};
+	}
+}
 
-		if (!m_File)
-			DebugLog("Failed to open {}: {}", m_FileName, ec);
-		else
-			Log("Successfully opened {}", m_FileName);
+void ConsoleLogParser::UpdateRotation(bool caughtUp)
+{
+	const uint8_t otherFile = 1 - m_ActiveFile;
+	if (m_RequestedFile == m_ActiveFile)
+	{
+		if (!caughtUp || m_FilePos < ROTATE_LOG_FILE_BYTES)
+			return;
+
+		// TF2 isn't writing to it, and we finished reading it before switching away from it last time
+		TruncateFile(GetFileName(otherFile));
+
+		Log("Read {} MB of {}, switching con_logfile to {}", m_FilePos / (1024 * 1024),
+			m_ConLogFileNames[m_ActiveFile], m_ConLogFileNames[otherFile]);
+		m_RequestedFile = otherFile;
+		m_RotationTargetHasData = false;
+		m_LastRotationCheck = {};
+		return;
+	}
+
+	// TF2 stops writing to the old file before it starts on the new one. So once the new one has
+	// something in it, the next time we catch up on the old one there's nothing left to miss.
+	if (m_RotationTargetHasData)
+	{
+		if (!caughtUp)
+			return;
+
+		m_File.reset();
+		TruncateFile(GetActiveFileName());
+		m_ActiveFile = otherFile;
+		m_LastFileLoadAttempt = {};
+		TryOpenFile();
+		return;
 	}
 
+	// Until TF2 gets the con_logfile command, we just keep reading the old file
+	if (const auto now = clock_t::now(); (now - m_LastRotationCheck) > 1s)
+	{
+		m_LastRotationCheck = now;
+
+		std::error_code ec;
+		if (const auto fileSize = std::filesystem::file_size(GetFileName(otherFile), ec); !ec && fileSize > 0)
+			m_RotationTargetHasData = true;
+	}
+}
+
+void ConsoleLogParser::CloseFile()
+{
+	if (!m_File)
+		return;
+
+	Log("Closing {}, console input is coming from rcon instead", GetActiveFileName());
+	m_File.reset();
+
+	// Whatever TF2 writes from here on will be stale by the time we look at it again
+	m_TruncateOnOpen = true;
+	m_FileLineBuf = std::make_shared<std::string>();
+	m_FileLineBufBegin = 0;
+
+	m_ActiveFile = 0;
+	m_RequestedFile = 0;
+	m_RotationTargetHasData = false;
+	UpdateParseProgress(true);
+}
+
+void ConsoleLogParser::ReadAndParse(bool& caughtUp)
+{
+	caughtUp = true;
+
 	bool snapshotUpdated = false;
+	if (!m_FileInputEnabled)
+	{
+		CloseFile();
+
+		// No console timestamps to go by, but the world clock still has to move
+		m_CurrentTimestamp.SetRecorded(tfbd_clock_t::now());
+		TrySnapshot(snapshotUpdated);
+		return;
+	}
+
+	TryOpenFile();
 
 	bool linesProcessed = false;
 	bool consoleLinesUpdated = false;
 	if (m_File)
 	{
-		Parse(linesProcessed, snapshotUpdated, consoleLinesUpdated);
+		caughtUp = false;
+		Parse(linesProcessed, snapshotUpdated, consoleLinesUpdated, caughtUp);
+		UpdateParseProgress(caughtUp);
+		UpdateRotation(caughtUp);
+	}
+
+	TrySnapshot(snapshotUpdated);
+
+	if (linesProcessed)
+		OnChunkParsed(consoleLinesUpdated);
+}
+
+void ConsoleLogParser::StartWorker()
+{
+	assert(!m_IsWorkerActive);
+	if (!m_Events)
+		m_Events = std::make_unique<decltype(m_Events)::element_type>();
+
+	m_IsWorkerActive = true;
+	m_StopWorker = false;
+	m_WorkerExited = false;
+	m_Worker = std::thread(&ConsoleLogParser::WorkerThreadFunc, this);
+}
+
+void ConsoleLogParser::StopWorker(bool dispatchRemaining)
+{
+	if (!m_IsWorkerActive)
+		return;
 
-		// Parse progress
+	m_StopWorker = true;
+
+	// The worker never drops events, so keep the queue moving until it has finished
+	ParserEvent event;
+	while (!m_WorkerExited)
+	{
+		while (m_Events->try_pop(event))
 		{
-			const auto pos = ftell(m_File.get());
-			const auto length = std::filesystem::file_size(m_FileName);
-			m_ParseProgress = float(double(pos) / length);
+			if (dispatchRemaining)
+				DispatchEvent(event);
 		}
+
+		std::this_thread::yield();
 	}
 
-	TrySnapshot(snapshotUpdated);
+	m_Worker.join();
+	m_IsWorkerActive = false;
 
-	if (linesProcessed)
-		m_WorldState->GetConsoleLineListenerBroadcaster().OnConsoleLogChunkParsed(*m_WorldState, consoleLinesUpdated);
+	while (m_Events->try_pop(event))
+	{
+		if (dispatchRemaining)
+			DispatchEvent(event);
+	}
+}
+
+void ConsoleLogParser::WorkerThreadFunc()
+{
+	while (!m_StopWorker)
+	{
+		try
+		{
+			bool caughtUp;
+			ReadAndParse(caughtUp);
+
+			if (caughtUp)
+				std::this_thread::sleep_for(10ms);
+		}
+		catch (...)
+		{
+			LogException("Exception while parsing console log in the background");
+			std::this_thread::sleep_for(1s);
+		}
+	}
+
+	m_WorkerExited = true;
+}
+
+void ConsoleLogParser::DispatchQueuedEvents()
+{
+	using clock = std::chrono::steady_clock;
+	const auto startTime = clock::now();
+
+	// Same budget as Parse(), so a big burst of lines is spread across a few frames
+	ParserEvent event;
+	while ((clock::now() - startTime) < 50ms && m_Events->try_pop(event))
+		DispatchEvent(event);
+}
+
+void ConsoleLogParser::QueueEvent(ParserEvent&& event)
+{
+	while (!m_Events->try_push(std::move(event)))
+		std::this_thread::sleep_for(1ms); // Wait for the main thread to catch up
+}
+
+void ConsoleLogParser::DispatchEvent(ParserEvent& event)
+{
+	auto& broadcaster = m_WorldState->GetConsoleLineListenerBroadcaster();
+
+	switch (event.m_Type)
+	{
+	case ParserEvent::Type::Timestamp:
+		m_PublishedTimestamp = event.m_Timestamp;
+		m_WorldState->UpdateTimestamp(*this);
+		break;
+
+	case ParserEvent::Type::LineParsed:
+	{
+		// Who sent a chat message depends on the world state at this point in the log, so
+		// it can't be looked up until every earlier line has gone through the listeners.
+		if (event.m_Line->GetType() == ConsoleLineType::Chat)
+		{
+			auto& chatLine = static_cast<ChatConsoleLine&>(*event.m_Line);
+			if (auto player = m_WorldState->FindSteamIDForName(chatLine.GetPlayerName()))
+			{
+				chatLine.SetSender(*player, player == m_Settings->GetLocalSteamID(),
+					m_WorldState->GetTeamShareResult(*player));
+			}
+		}
+
+		// Already broadcast when the RCON response came in
+		if (m_WorldState->IsDuplicateCommandResponseLine(*event.m_Line, event.m_TextHash))
+			break;
+
+		broadcaster.OnConsoleLineParsed(*m_WorldState, *event.m_Line);
+		break;
+	}
+
+	case ParserEvent::Type::LineUnparsed:
+		broadcaster.OnConsoleLineUnparsed(*m_WorldState, event.m_Text);
+		break;
+
+	case ParserEvent::Type::ChunkParsed:
+		broadcaster.OnConsoleLogChunkParsed(*m_WorldState, event.m_ConsoleLinesUpdated);
+		break;
+
+	case ParserEvent::Type::None:
+		LogError(MH_SOURCE_LOCATION_CURRENT(), "Empty parser event");
+		break;
+	}
+}
+
+void ConsoleLogParser::OnTimestampSnapshot()
+{
+	ParserEvent event{ .m_Type = ParserEvent::Type::Timestamp, .m_Timestamp = m_CurrentTimestamp };
+	if (m_IsWorkerActive)
+		QueueEvent(std::move(event));
+	else
+		DispatchEvent(event);
+}
+
+void ConsoleLogParser::OnLineParsed(std::shared_ptr<IConsoleLine> line, size_t textHash)
+{
+	m_LinesParsed[size_t(line->GetType())].fetch_add(1, std::memory_order_relaxed);
+
+	ParserEvent event{ .m_Type = ParserEvent::Type::LineParsed, .m_Line = std::move(line), .m_TextHash = textHash };
+	if (m_IsWorkerActive)
+		QueueEvent(std::move(event));
+	else
+		DispatchEvent(event);
+}
+
+void ConsoleLogParser::OnLineUnparsed(const std::string_view& text)
+{
+	m_LinesUnparsed.fetch_add(1, std::memory_order_relaxed);
+
+	if (m_IsWorkerActive)
+	{
+		QueueEvent({ .m_Type = ParserEvent::Type::LineUnparsed, .m_Text = std::string(text) });
+	}
+	else
+	{
+		// Skip copying the text
+		m_WorldState->GetConsoleLineListenerBroadcaster().OnConsoleLineUnparsed(*m_WorldState, text);
+	}
+}
+
+void ConsoleLogParser::OnChunkParsed(bool consoleLinesUpdated)
+{
+	ParserEvent event{ .m_Type = ParserEvent::Type::ChunkParsed, .m_ConsoleLinesUpdated = consoleLinesUpdated };
+	if (m_IsWorkerActive)
+		QueueEvent(std::move(event));
+	else
+		DispatchEvent(event);
+}
+
+auto ConsoleLogParser::GetStats() const -> Stats
+{
+	Stats stats;
+	for (size_t i = 0; i < stats.m_LinesParsed.size(); i++)
+		stats.m_LinesParsed[i] = m_LinesParsed[i].load(std::memory_order_relaxed);
+
+	stats.m_LinesUnparsed = m_LinesUnparsed.load(std::memory_order_relaxed);
+	stats.m_LinesShed = m_LinesShed.load(std::memory_order_relaxed);
+	stats.m_BytesRead = m_BytesRead.load(std::memory_order_relaxed);
+	stats.m_ParseTime = std::chrono::microseconds(m_ParseTimeUS.load(std::memory_order_relaxed));
+	return stats;
 }
 
 void ConsoleLogParser::CustomDeleters::operator()(FILE* f) const
@@ -96,24 +433,86 @@ void ConsoleLogParser::CustomDeleters::operator()(FILE* f) const
 	fclose(f);
 }
 
-void ConsoleLogParser::Parse(bool& linesProcessed, bool& snapshotUpdated, bool& consoleLinesUpdated)
+void ConsoleLogParser::UpdateParseProgress(bool caughtUp)
+{
+	if (caughtUp)
+	{
+		m_ParseProgress = 1;
+		UpdateBacklog(true, 0);
+		return;
+	}
+
+	// Only hit the filesystem occasionally, we only need this for a progress bar
+	if (const auto now = clock_t::now(); m_FilePos > m_FileSize || (now - m_LastFileSizeUpdate) > 1s)
+	{
+		m_LastFileSizeUpdate = now;
+
+		std::error_code ec;
+		if (const auto fileSize = std::filesystem::file_size(GetActiveFileName(), ec); !ec)
+			m_FileSize = fileSize;
+	}
+
+	m_ParseProgress = m_FileSize > 0 ? float(std::min(double(m_FilePos) / m_FileSize, 1.0)) : 1.0f;
+	UpdateBacklog(false, m_FileSize > m_FilePos ? m_FileSize - m_FilePos : 0);
+}
+
+void ConsoleLogParser::UpdateBacklog(bool caughtUp, uint64_t backlogBytes)
+{
+	m_BacklogBytes = backlogBytes;
+	if (caughtUp)
+		m_LastCaughtUpTime = clock_t::now();
+
+	if (!m_Overloaded && backlogBytes >= OVERLOAD_BACKLOG_BYTES)
+	{
+		LogWarning("Console log parsing is {} KB behind, only parsing status, lobby and chat until it catches up",
+			backlogBytes / 1024);
+		m_Overloaded = true;
+	}
+	else if (m_Overloaded && backlogBytes <= OVERLOAD_RECOVERED_BACKLOG_BYTES)
+	{
+		Log("Console log parsing caught up, parsing everything again");
+		m_Overloaded = false;
+	}
+}
+
+duration_t ConsoleLogParser::GetLag() const
+{
+	if (!m_BacklogBytes)
+		return {};
+
+	return std::max(clock_t::now() - m_LastCaughtUpTime.load(), duration_t::zero());
+}
+
+void ConsoleLogParser::Parse(bool& linesProcessed, bool& snapshotUpdated, bool& consoleLinesUpdated, bool& caughtUp)
 {
-	char buf[4096];
+	constexpr size_t READ_BUF_SIZE = 256 * 1024;
+	if (!m_ReadBuf)
+		m_ReadBuf = std::make_unique<char[]>(READ_BUF_SIZE);
+
+	char* const buf = m_ReadBuf.get();
 	size_t readCount;
 	using clock = std::chrono::steady_clock;
 	const auto startTime = clock::now();
 	do
 	{
-		readCount = fread(buf, sizeof(buf[0]), std::size(buf), m_File.get());
+		readCount = fread(buf, sizeof(buf[0]), READ_BUF_SIZE, m_File.get());
 		if (readCount > 0)
 		{
-			m_FileLineBuf.append(buf, readCount);
-			ILogManager::GetInstance().LogConsoleOutput(std::string_view(buf, readCount));
-
-			auto parseEnd = m_FileLineBuf.cbegin();
-			ParseChunk(parseEnd, linesProcessed, snapshotUpdated, consoleLinesUpdated);
-
-			m_FileLineBuf.erase(m_FileLineBuf.begin(), parseEnd);
+			m_FilePos += readCount;
+			m_BytesRead.fetch_add(readCount, std::memory_order_relaxed);
+			if (m_MirrorToLogFile)
+				ILogManager::GetInstance().LogConsoleOutput(std::string_view(buf, readCount));
+			if (ISessionArchive::IsRecording())
+				ISessionArchive::Record(SessionArchiveRecordType::ConsoleOutput, m_FileName.string(), std::string_view(buf, readCount));
+
+			const auto parseStartTime = clock::now();
+			ParseText(std::string_view(buf, readCount), linesProcessed, snapshotUpdated, consoleLinesUpdated);
+			m_ParseTimeUS.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+				clock::now() - parseStartTime).count(), std::memory_order_relaxed);
+		}
+		else
+		{
+			caughtUp = true; // We've reached the end of what TF2 has written so far
 		}
 
 		if (auto elapsed = clock::now() - startTime; elapsed >= 50ms)
@@ -122,89 +521,153 @@ void ConsoleLogParser::Parse(bool& linesProcessed, bool& snapshotUpdated, bool&
 	} while (readCount > 0);
 }
 
-bool ConsoleLogParser::ParseChatMessage(const std::string_view& lineStr, striter& parseEnd, std::shared_ptr<IConsoleLine>& parsed)
+void ConsoleLogParser::ParseText(const std::string_view& text)
 {
-	for (int i = 0; i < (int)ChatCategory::COUNT; i++)
+	bool snapshotUpdated = false;
+	bool linesProcessed = false;
+	bool consoleLinesUpdated = false;
+	ParseText(text, linesProcessed, snapshotUpdated, consoleLinesUpdated);
+
+	TrySnapshot(snapshotUpdated);
+
+	if (linesProcessed)
+		OnChunkParsed(consoleLinesUpdated);
+}
+
+void ConsoleLogParser::ParseText(const std::string_view& text, bool& linesProcessed, bool& snapshotUpdated, bool& consoleLinesUpdated)
+{
+	CompactFileLineBuf(text.size());
+	m_FileLineBuf->append(text);
+
+	auto parseEnd = m_FileLineBuf->cbegin() + m_FileLineBufBegin;
+	ParseChunk(parseEnd, linesProcessed, snapshotUpdated, consoleLinesUpdated);
+	m_FileLineBufBegin = parseEnd - m_FileLineBuf->cbegin();
+}
+
+void ConsoleLogParser::CompactFileLineBuf(size_t incomingSize)
+{
+	auto& buf = *m_FileLineBuf;
+	const size_t unparsedSize = buf.size() - m_FileLineBufBegin;
+
+	if (m_FileLineBuf.use_count() > 1)
 	{
-		const auto category = ChatCategory(i);
+		// Lines that are still alive are pointing into this buffer, move the unparsed tail to a new one
+		auto newBuf = std::make_shared<std::string>();
+		newBuf->reserve(unparsedSize + incomingSize);
+		newBuf->assign(buf, m_FileLineBufBegin);
+		m_FileLineBuf = std::move(newBuf);
+		m_FileLineBufBegin = 0;
+		return;
+	}
 
-		auto& type = m_Settings->m_Unsaved.m_ChatMsgWrappers.value().m_Types[i];
-		if (lineStr.starts_with(type.m_Full.m_Start.m_Narrow))
-		{
-			auto searchBuf = std::string_view(m_FileLineBuf).substr(
-				&*lineStr.begin() - m_FileLineBuf.data() + type.m_Full.m_Start.m_Narrow.size());
+	// Nobody else can start referencing it, so we can safely reuse it. Pairs with the
+	// release in the last line's destructor, in case that happened on another thread.
+	std::atomic_thread_fence(std::memory_order_acquire);
 
-			if (auto found = searchBuf.find(type.m_Full.m_End.m_Narrow); found != lineStr.npos)
-			{
-				if (found > 512)
-				{
-					LogError("Searched more than 512 characters ({}) for the end of the chat msg string, something is terribly wrong!", found);
-				}
+	// Only shift the unparsed tail down once it is no bigger than what we'd be reclaiming,
+	// or if we'd otherwise have to grow the buffer. Keeps catching up on a large log linear.
+	if (m_FileLineBufBegin > 0 &&
+		(m_FileLineBufBegin >= unparsedSize || buf.size() + incomingSize > buf.capacity()))
+	{
+		buf.erase(0, m_FileLineBufBegin);
+		m_FileLineBufBegin = 0;
+	}
+}
 
-				searchBuf = searchBuf.substr(0, found);
+bool ConsoleLogParser::ParseChatMessage(const std::string_view& lineStr, const std::shared_ptr<const std::string>& lineBuf,
+	striter& parseEnd, std::shared_ptr<IConsoleLine>& parsed)
+{
+	const auto foundCategory = m_ChatWrappersMatcher->FindCategory(lineStr);
+	if (!foundCategory)
+		return true;
 
-				auto nameBegin = searchBuf.find(type.m_Name.m_Start.m_Narrow);
-				auto nameEnd = searchBuf.find(type.m_Name.m_End.m_Narrow);
-				auto msgBegin = searchBuf.find(type.m_Message.m_Start.m_Narrow);
-				auto msgEnd = searchBuf.find(type.m_Message.m_End.m_Narrow);
+	const auto category = *foundCategory;
+	auto& type = m_ChatWrappersMatcher->GetWrappers().m_Types[size_t(category)];
 
-				if (nameBegin != searchBuf.npos && nameEnd != searchBuf.npos && msgBegin != searchBuf.npos && msgEnd != searchBuf.npos)
-				{
-					const auto name = searchBuf.substr(
-						nameBegin + type.m_Name.m_Start.m_Narrow.size(),
-						nameEnd - nameBegin - type.m_Name.m_Start.m_Narrow.size());
-
-					const auto msg = searchBuf.substr(
-						msgBegin + type.m_Message.m_Start.m_Narrow.size(),
-						msgEnd - msgBegin - type.m_Message.m_Start.m_Narrow.size());
-
-					TeamShareResult teamShareResult = TeamShareResult::Neither;
-					SteamID id;
-					bool isSelf = false;
-					if (auto player = m_WorldState->FindSteamIDForName(name))
-					{
-						teamShareResult = m_WorldState->GetTeamShareResult(*player);
-						isSelf = (player == m_Settings->GetLocalSteamID());
-						id = *player;
-					}
-
-					parsed = std::make_unique<ChatConsoleLine>(m_WorldState->GetCurrentTime(),
-						std::string(name), std::string(msg), IsDead(category), IsTeam(category), isSelf, teamShareResult, id);
-				}
-				else
-				{
-					if (nameBegin == searchBuf.npos)
-						LogError("Failed to find name begin sequence in chat message of type {}", mh::enum_fmt(category));
-					if (nameEnd == searchBuf.npos)
-						LogError("Failed to find name end sequence in chat message of type {}", mh::enum_fmt(category));
-					if (msgBegin == searchBuf.npos)
-						LogError("Failed to find message begin sequence in chat message of type {}", mh::enum_fmt(category));
-					if (msgEnd == searchBuf.npos)
-						LogError("Failed to find message end sequence in chat message of type {}", mh::enum_fmt(category));
-				}
+	auto searchBuf = std::string_view(*lineBuf).substr(
+		&*lineStr.begin() - lineBuf->data() + type.m_Full.m_Start.m_Narrow.size());
 
-				parseEnd += type.m_Full.m_Start.m_Narrow.size() + found + type.m_Full.m_End.m_Narrow.size();
-				return true;
-			}
-			else
-			{
-				LogError("Failed to locate chat message wrapper end");
-				return false; // Not enough characters in m_FileLineBuf. Try again later.
-			}
-		}
+	const auto found = searchBuf.find(type.m_Full.m_End.m_Narrow);
+	if (found == searchBuf.npos)
+	{
+		LogError("Failed to locate chat message wrapper end");
+		return false; // Not enough characters in m_FileLineBuf. Try again later.
 	}
 
+	if (found > 512)
+	{
+		LogError("Searched more than 512 characters ({}) for the end of the chat msg string, something is terribly wrong!", found);
+	}
+
+	searchBuf = searchBuf.substr(0, found);
+
+	// Each wrapper follows the previous one, so find them all in a single forward pass
+	const auto FindNext = [&](size_t pos, const std::string& wrapper)
+	{
+		return pos == searchBuf.npos ? searchBuf.npos : searchBuf.find(wrapper, pos);
+	};
+	const auto Advance = [](size_t pos, const std::string& wrapper)
+	{
+		return pos == std::string_view::npos ? pos : pos + wrapper.size();
+	};
+
+	const auto nameBegin = FindNext(0, type.m_Name.m_Start);
+	const auto nameEnd = FindNext(Advance(nameBegin, type.m_Name.m_Start), type.m_Name.m_End);
+	const auto msgBegin = FindNext(Advance(nameEnd, type.m_Name.m_End), type.m_Message.m_Start);
+	const auto msgEnd = FindNext(Advance(msgBegin, type.m_Message.m_Start), type.m_Message.m_End);
+
+	if (msgEnd != searchBuf.npos)
+	{
+		const auto name = searchBuf.substr(
+			nameBegin + type.m_Name.m_Start.m_Narrow.size(),
+			nameEnd - nameBegin - type.m_Name.m_Start.m_Narrow.size());
+
+		const auto msg = searchBuf.substr(
+			msgBegin + type.m_Message.m_Start.m_Narrow.size(),
+			msgEnd - msgBegin - type.m_Message.m_Start.m_Narrow.size());
+
+		// The sender is filled in by DispatchEvent()
+		parsed = MakeConsoleLine<ChatConsoleLine>(m_CurrentTimestamp.GetSnapshot(),
+			InternedString(name), SharedStringView(lineBuf, msg), IsDead(category), IsTeam(category),
+			false, TeamShareResult::Neither, SteamID{});
+	}
+	else
+	{
+		if (nameBegin == searchBuf.npos)
+			LogError("Failed to find name begin sequence in chat message of type {}", mh::enum_fmt(category));
+		else if (nameEnd == searchBuf.npos)
+			LogError("Failed to find name end sequence in chat message of type {}", mh::enum_fmt(category));
+		else if (msgBegin == searchBuf.npos)
+			LogError("Failed to find message begin sequence in chat message of type {}", mh::enum_fmt(category));
+		else
+			LogError("Failed to find message end sequence in chat message of type {}", mh::enum_fmt(category));
+	}
+
+	parseEnd += type.m_Full.m_Start.m_Narrow.size() + found + type.m_Full.m_End.m_Narrow.size();
 	return true;
 }
 
 void ConsoleLogParser::ParseChunk(striter& parseEnd, bool& linesProcessed, bool& snapshotUpdated, bool& consoleLinesUpdated)
 {
-	static const std::regex s_TimestampRegex(R"regex(\n(\d\d)\/(\d\d)\/(\d\d\d\d) - (\d\d):(\d\d):(\d\d):[ \n])regex", std::regex::optimize);
+	// Rebuild the chat wrapper lookup if the wrappers were regenerated
+	if (const auto& wrappers = m_Settings->m_Unsaved.m_ChatMsgWrappers.value();
+		!m_ChatWrappersMatcher || m_ChatWrappersMatcher->GetWrappers() != wrappers)
+	{
+		m_ChatWrappersMatcher.emplace(wrappers);
 
-	std::smatch match;
-	while (std::regex_search(parseEnd, m_FileLineBuf.cend(), match, s_TimestampRegex))
+		// The wrappers are random, a replay can't parse chat without them
+		if (ISessionArchive::IsRecording())
+			ISessionArchive::Record(SessionArchiveRecordType::ChatWrappers, {}, nlohmann::json(wrappers).dump());
+	}
+
+	const std::shared_ptr<const std::string> sharedLineBuf = m_FileLineBuf;
+	const auto chunkTime = clock_t::now(); // A chunk only takes a few ms to parse
+	const std::string_view fileLineBuf(*sharedLineBuf);
+	const bool overloaded = m_Overloaded;
+
+	while (auto timestamp = FindConsoleLogTimestamp(fileLineBuf, parseEnd - sharedLineBuf->cbegin()))
 	{
-		auto regexBegin = parseEnd;
+		auto nextParseEnd = parseEnd;
 
 		ParseLineResult result = ParseLineResult::Unparsed;
 		bool skipTimestampParse = false;
@@ -219,23 +682,28 @@ void ConsoleLogParser::ParseChunk(striter& parseEnd, bool& linesProcessed, bool&
 
 			std::shared_ptr<IConsoleLine> parsed;
 
-			const auto prefix = match.prefix();
-			//const auto suffix = match.suffix();
-			const std::string_view lineStr(&*prefix.first, prefix.length());
+			const size_t lineBegin = parseEnd - sharedLineBuf->cbegin();
+			const std::string_view lineStr = fileLineBuf.substr(lineBegin, timestamp->m_Begin - lineBegin);
+
+			// Counted, but never turned into an IConsoleLine
+			const bool counted = m_HighFrequencyLines.TryCount(lineStr, m_CurrentTimestamp.GetSnapshot());
 
-			if (ParseChatMessage(lineStr, regexBegin, parsed))
+			if (!counted)
 			{
+				if (!ParseChatMessage(lineStr, sharedLineBuf, nextParseEnd, parsed))
+					return; // Try again later (not enough chars in buffer)
+
 				if (parsed)
 					result = ParseLineResult::Modified;
 			}
-			else
-			{
-				return; // Try again later (not enough chars in buffer)
-			}
 
-			if (!parsed && result == ParseLineResult::Unparsed)
+			if (!counted && !parsed && result == ParseLineResult::Unparsed)
 			{
-				parsed = IConsoleLine::ParseConsoleLine(lineStr, m_CurrentTimestamp.GetSnapshot(), *m_WorldState);
+				if (overloaded)
+					parsed = IConsoleLine::ParseEssentialConsoleLine(lineStr, m_CurrentTimestamp.GetSnapshot(), *m_WorldState, &sharedLineBuf);
+				else
+					parsed = IConsoleLine::ParseConsoleLine(lineStr, m_CurrentTimestamp.GetSnapshot(), *m_WorldState, &sharedLineBuf);
+
 				if (parsed && parsed->GetType() == ConsoleLineType::Chat)
 					LogError("Line was parsed as a chat message via old code path, this should never happen!");
 
@@ -246,39 +714,31 @@ void ConsoleLogParser::ParseChunk(striter& parseEnd, bool& linesProcessed, bool&
 			{
 				if (result == ParseLineResult::Success || result == ParseLineResult::Modified)
 				{
-					m_WorldState->GetConsoleLineListenerBroadcaster().OnConsoleLineParsed(*m_WorldState, *parsed);
+					OnLineParsed(std::move(parsed), IConsoleLine::HashText(lineStr));
 					consoleLinesUpdated = true;
 				}
 			}
-			else
+			else if (!counted && overloaded)
+			{
+				// Might have been something we'd normally parse, but nobody needs it badly enough to wait for it
+				m_LinesShed.fetch_add(1, std::memory_order_relaxed);
+			}
+			else if (!counted)
 			{
-				m_WorldState->GetConsoleLineListenerBroadcaster().OnConsoleLineUnparsed(*m_WorldState, lineStr);
+				OnLineUnparsed(lineStr);
 			}
 		}
 
 		if (result != ParseLineResult::Modified)
 		{
-			std::tm time{};
-			time.tm_isdst = -1;
-			from_chars_throw(match[1], time.tm_mon);
-			time.tm_mon -= 1;
-
-			from_chars_throw(match[2], time.tm_mday);
-			from_chars_throw(match[3], time.tm_year);
-			time.tm_year -= 1900;
-
-			from_chars_throw(match[4], time.tm_hour);
-			from_chars_throw(match[5], time.tm_min);
-			from_chars_throw(match[6], time.tm_sec);
-
-			m_CurrentTimestamp.SetRecorded(clock_t::from_time_t(std::mktime(&time)));
-			regexBegin = match[0].second;
+			m_CurrentTimestamp.SetRecorded(m_TimestampDecoder.Decode(*timestamp), chunkTime);
+			nextParseEnd = sharedLineBuf->cbegin() + timestamp->m_End;
 		}
 		else
 		{
 			m_CurrentTimestamp.InvalidateRecorded();
 		}
 
-		parseEnd = regexBegin;
+		parseEnd = nextParseEnd;
 	}
 }
@@ -1,9 +1,21 @@
 #pragma once
 
 #include "CompensatedTS.h"
+#include "Config/ChatWrappers.h"
+#include "ConsoleLogTimestamp.h"
+#include "HighFrequencyLines.h"
+#include "IConsoleLine.h"
+#include "Util/SPSCQueue.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <string>
+#include <thread>
 #include <unordered_set>
 
 namespace tf2_bot_detector
@@ -17,12 +29,60 @@ namespace tf2_bot_detector
 	{
 	public:
 		ConsoleLogParser(IWorldState& world, const Settings& settings, std::filesystem::path conLogFile);
+		~ConsoleLogParser();
 
 		void Update();
 
+		// Parses text as if it had just been read from console.log, on the calling thread.
+		// Used to replay recorded logs, must not be called while background parsing is enabled.
+		void ParseText(const std::string_view& text);
+
 		float GetParseProgress() const { return m_ParseProgress; }
 
-		const CompensatedTS& GetCurrentTimestamp() const { return m_CurrentTimestamp; }
+		// How much of console.log hasn't been read yet, as of the last time its size was checked
+		uint64_t GetBacklogBytes() const { return m_BacklogBytes; }
+		// How long it's been since everything TF2 had written was parsed, zero if there's no backlog
+		duration_t GetLag() const;
+
+		// Set while the backlog is too big to keep up with. Only the lines the world state depends on
+		// (status, lobby and chat) are parsed, everything else is dropped before it reaches the listeners.
+		bool IsOverloaded() const { return m_Overloaded; }
+
+		// Whether everything read from console.log is also written to the console log file in our
+		// logs folder. Only one parser per process should do this, or the output gets interleaved.
+		// Read by the worker thread, so set it before the first Update().
+		void SetMirrorToLogFile(bool enabled) { m_MirrorToLogFile = enabled; }
+
+		// What TF2's con_logfile should be set to, relative to the tf directory. Once enough of the
+		// current file has been read, this switches to the other of console.log and console_alt.log.
+		// The old one is kept until everything TF2 wrote to it has been read, then truncated, so neither
+		// grows without bound over a long session. Empty while file input is disabled, since nothing
+		// should be written at all. Safe to call from any thread.
+		std::string GetConLogFileName() const { return m_FileInputEnabled ? m_ConLogFileNames[m_RequestedFile] : std::string(); }
+
+		// While disabled, console.log is closed and nothing is read from it, for when the world state is
+		// kept up to date by rcon command responses instead. The world clock follows the system clock
+		// in the meantime, since there are no console timestamps to go by. When it's enabled again,
+		// console.log is truncated and read from the start. Safe to call from any thread.
+		void SetFileInputEnabled(bool enabled) { m_FileInputEnabled = enabled; }
+		bool IsFileInputEnabled() const { return m_FileInputEnabled; }
+
+		// The timestamp of the most recent line that has been handed to the console line listeners
+		const CompensatedTS& GetCurrentTimestamp() const { return m_PublishedTimestamp; }
+
+		// Voice, split packet and user message totals, since those lines mostly skip the listeners
+		const HighFrequencyLineCounters& GetHighFrequencyLines() const { return m_HighFrequencyLines; }
+
+		// Totals since this was created, for the metrics file
+		struct Stats
+		{
+			std::array<uint64_t, size_t(ConsoleLineType::COUNT)> m_LinesParsed{};
+			uint64_t m_LinesUnparsed = 0;
+			uint64_t m_LinesShed = 0;  // Dropped without being fully parsed, while overloaded
+			uint64_t m_BytesRead = 0;
+			std::chrono::microseconds m_ParseTime{};  // Turning text into lines, not running the listeners
+		};
+		Stats GetStats() const;
 
 	private:
 		const Settings* m_Settings = nullptr;
@@ -30,6 +90,53 @@ namespace tf2_bot_detector
 
 		void TrySnapshot(bool& snapshotUpdated);
 		CompensatedTS m_CurrentTimestamp;
+		CompensatedTS m_PublishedTimestamp;
+		ConsoleLogTimestampDecoder m_TimestampDecoder;
+
+		// Everything that has to reach the main thread, in the order it happened
+		struct ParserEvent
+		{
+			enum class Type : uint8_t
+			{
+				None,
+				Timestamp,     // m_Timestamp
+				LineParsed,    // m_Line, m_TextHash
+				LineUnparsed,  // m_Text
+				ChunkParsed,   // m_ConsoleLinesUpdated
+			} m_Type = Type::None;
+
+			bool m_ConsoleLinesUpdated = false;
+			CompensatedTS m_Timestamp;
+			std::shared_ptr<IConsoleLine> m_Line;
+			size_t m_TextHash = 0;
+			std::string m_Text;
+		};
+
+		// If the worker thread is running, these queue the event for the main thread,
+		// otherwise they run the listeners immediately.
+		void OnTimestampSnapshot();
+		void OnLineParsed(std::shared_ptr<IConsoleLine> line, size_t textHash);
+		void OnLineUnparsed(const std::string_view& text);
+		void OnChunkParsed(bool consoleLinesUpdated);
+		void QueueEvent(ParserEvent&& event);
+		void DispatchEvent(ParserEvent& event);
+
+		// Reading and parsing happen here: on the main thread normally, or on m_Worker if
+		// Settings::m_BackgroundConsoleLogParsing is enabled.
+		void ReadAndParse(bool& caughtUp);
+		void TryOpenFile();
+		void CloseFile();
+		void UpdateRotation(bool caughtUp);
+
+		void StartWorker();
+		void StopWorker(bool dispatchRemaining);
+		void WorkerThreadFunc();
+		void DispatchQueuedEvents();
+		bool m_IsWorkerActive = false;  // Only changed while m_Worker is not running
+		std::atomic_bool m_StopWorker = false;
+		std::atomic_bool m_WorkerExited = false;
+		std::thread m_Worker;
+		std::unique_ptr<SPSCQueue<ParserEvent, 4096>> m_Events;
 
 		enum class ParseLineResult
 		{
@@ -40,18 +147,54 @@ namespace tf2_bot_detector
 		};
 
 		using striter = std::string::const_iterator;
-		void Parse(bool& linesProcessed, bool& snapshotUpdated, bool& consoleLinesUpdated);
+		void Parse(bool& linesProcessed, bool& snapshotUpdated, bool& consoleLinesUpdated, bool& caughtUp);
+		void UpdateParseProgress(bool caughtUp);
+		void UpdateBacklog(bool caughtUp, uint64_t backlogBytes);
+		void ParseText(const std::string_view& text, bool& linesProcessed, bool& snapshotUpdated, bool& consoleLinesUpdated);
+		void CompactFileLineBuf(size_t incomingSize);
 		void ParseChunk(striter& parseEnd, bool& linesProcessed, bool& snapshotUpdated, bool& consoleLinesUpdated);
-		bool ParseChatMessage(const std::string_view& lineStr, striter& parseEnd, std::shared_ptr<IConsoleLine>& parsed);
+		bool ParseChatMessage(const std::string_view& lineStr, const std::shared_ptr<const std::string>& lineBuf,
+			striter& parseEnd, std::shared_ptr<IConsoleLine>& parsed);
 
 		struct CustomDeleters
 		{
 			void operator()(FILE*) const;
 		};
 		std::filesystem::path m_FileName;
+		std::filesystem::path m_AltFileName;
+		std::array<std::string, 2> m_ConLogFileNames;  // Just the file names of the two above
+		const std::filesystem::path& GetFileName(uint8_t index) const { return index == 0 ? m_FileName : m_AltFileName; }
+		const std::filesystem::path& GetActiveFileName() const { return GetFileName(m_ActiveFile); }
 		std::unique_ptr<FILE, CustomDeleters> m_File;
 		time_point_t m_LastFileLoadAttempt{};
-		std::string m_FileLineBuf;
-		float m_ParseProgress = 0;
+		bool m_TruncateOnOpen = true;  // Only the first time, after that it still has lines we haven't read
+
+		uint8_t m_ActiveFile = 0;                  // The one m_File is reading
+		std::atomic<uint8_t> m_RequestedFile = 0;  // The one TF2 should be writing to
+		bool m_RotationTargetHasData = false;      // TF2 has started writing to m_RequestedFile
+		time_point_t m_LastRotationCheck{};
+		std::shared_ptr<std::string> m_FileLineBuf = std::make_shared<std::string>(); // Parsed lines may reference this
+		size_t m_FileLineBufBegin = 0; // Everything before this in m_FileLineBuf has already been parsed
+		std::optional<ChatWrappersMatcher> m_ChatWrappersMatcher;
+		HighFrequencyLineCounters m_HighFrequencyLines;
+		std::unique_ptr<char[]> m_ReadBuf;
+
+		bool m_MirrorToLogFile = true;
+		std::atomic_bool m_FileInputEnabled = true;
+
+		// Written by whichever thread is parsing
+		std::array<std::atomic<uint64_t>, size_t(ConsoleLineType::COUNT)> m_LinesParsed{};
+		std::atomic<uint64_t> m_LinesUnparsed = 0;
+		std::atomic<uint64_t> m_LinesShed = 0;
+		std::atomic<uint64_t> m_BytesRead = 0;
+		std::atomic<uint64_t> m_ParseTimeUS = 0;
+
+		uint64_t m_FilePos = 0;   // Bytes read since m_File was opened
+		uint64_t m_FileSize = 0;  // Last known size of m_FileName
+		time_point_t m_LastFileSizeUpdate{};
+		std::atomic<float> m_ParseProgress = 0;
+		std::atomic<uint64_t> m_BacklogBytes = 0;
+		std::atomic<time_point_t> m_LastCaughtUpTime{};
+		std::atomic_bool m_Overloaded = false;
 	};
 }
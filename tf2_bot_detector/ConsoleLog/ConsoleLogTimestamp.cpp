@@ -0,0 +1,198 @@
+#include "ConsoleLogTimestamp.h"
+
+#include <bit>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define TF2BD_CONLOG_TIMESTAMP_AVX2 1
+#include <immintrin.h>
+#else
+#define TF2BD_CONLOG_TIMESTAMP_AVX2 0
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TF2BD_CONLOG_TIMESTAMP_SSE2 1
+#include <emmintrin.h>
+#else
+#define TF2BD_CONLOG_TIMESTAMP_SSE2 0
+#endif
+
+using namespace tf2_bot_detector;
+
+namespace
+{
+	constexpr bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	constexpr uint8_t DecodeDigits2(const char* p)
+	{
+		return uint8_t((p[0] - '0') * 10 + (p[1] - '0'));
+	}
+
+	// Layout: "\nMM/DD/YYYY - HH:MM:SS: "
+	//          0 1  4  7    12 14 17 20 23
+	bool TryDecodeTimestamp(const char* p, size_t offset, ConsoleLogTimestamp& result)
+	{
+		if (p[0] != '\n' ||
+			p[3] != '/' ||
+			p[6] != '/' ||
+			p[11] != ' ' || p[12] != '-' || p[13] != ' ' ||
+			p[16] != ':' ||
+			p[19] != ':' ||
+			p[22] != ':' ||
+			(p[23] != ' ' && p[23] != '\n'))
+		{
+			return false;
+		}
+
+		static constexpr uint8_t DIGIT_OFFSETS[] = { 1, 2, 4, 5, 7, 8, 9, 10, 14, 15, 17, 18, 20, 21 };
+		for (uint8_t digitOffset : DIGIT_OFFSETS)
+		{
+			if (!IsDigit(p[digitOffset]))
+				return false;
+		}
+
+		result.m_Begin = offset;
+		result.m_End = offset + ConsoleLogTimestamp::LENGTH;
+		result.m_Month = DecodeDigits2(p + 1);
+		result.m_Day = DecodeDigits2(p + 4);
+		result.m_Year = uint16_t(DecodeDigits2(p + 7) * 100 + DecodeDigits2(p + 9));
+		result.m_Hour = DecodeDigits2(p + 14);
+		result.m_Minute = DecodeDigits2(p + 17);
+		result.m_Second = DecodeDigits2(p + 20);
+		return true;
+	}
+
+#if TF2BD_CONLOG_TIMESTAMP_AVX2 || TF2BD_CONLOG_TIMESTAMP_SSE2
+	// Checks every candidate position flagged in mask (bit n => a '\n' at base + n followed by a '/' at base + n + 3)
+	bool TryDecodeCandidates(const char* data, size_t base, uint32_t mask, ConsoleLogTimestamp& result)
+	{
+		while (mask)
+		{
+			const size_t pos = base + std::countr_zero(mask);
+			if (TryDecodeTimestamp(data + pos, pos, result))
+				return true;
+
+			mask &= mask - 1;
+		}
+
+		return false;
+	}
+#endif
+}
+
+std::optional<ConsoleLogTimestamp> tf2_bot_detector::FindConsoleLogTimestamp(const std::string_view& text, size_t offset)
+{
+	if (text.size() < ConsoleLogTimestamp::LENGTH)
+		return std::nullopt;
+
+	// The last position that still has enough characters after it for a complete timestamp
+	const size_t lastCandidate = text.size() - ConsoleLogTimestamp::LENGTH;
+	const char* const data = text.data();
+
+	ConsoleLogTimestamp result;
+	size_t i = offset;
+
+	// The vectorized loops look for a '\n' that is followed by a '/' 3 characters later. Only those
+	// (rare) candidates get the full check.
+#if TF2BD_CONLOG_TIMESTAMP_AVX2
+	{
+		const __m256i newline = _mm256_set1_epi8('\n');
+		const __m256i slash = _mm256_set1_epi8('/');
+		for (; (i + 32) <= (lastCandidate + 1); i += 32)
+		{
+			const __m256i newlines = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), newline);
+			const __m256i slashes = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 3)), slash);
+			const auto mask = uint32_t(_mm256_movemask_epi8(_mm256_and_si256(newlines, slashes)));
+
+			if (mask && TryDecodeCandidates(data, i, mask, result))
+				return result;
+		}
+	}
+#endif
+
+#if TF2BD_CONLOG_TIMESTAMP_SSE2
+	{
+		const __m128i newline = _mm_set1_epi8('\n');
+		const __m128i slash = _mm_set1_epi8('/');
+		for (; (i + 16) <= (lastCandidate + 1); i += 16)
+		{
+			const __m128i newlines = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), newline);
+			const __m128i slashes = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 3)), slash);
+			const auto mask = uint32_t(_mm_movemask_epi8(_mm_and_si128(newlines, slashes)));
+
+			if (mask && TryDecodeCandidates(data, i, mask, result))
+				return result;
+		}
+	}
+#endif
+
+	// Scalar tail (or the whole thing, on platforms without SSE2)
+	while (i <= lastCandidate)
+	{
+		const auto found = static_cast<const char*>(std::memchr(data + i, '\n', lastCandidate + 1 - i));
+		if (!found)
+			break;
+
+		const size_t pos = size_t(found - data);
+		if (TryDecodeTimestamp(found, pos, result))
+			return result;
+
+		i = pos + 1;
+	}
+
+	return std::nullopt;
+}
+
+static time_t MakeLocalTime(uint16_t year, uint8_t month, int day, uint8_t hour)
+{
+	std::tm time{};
+	time.tm_isdst = -1;
+	time.tm_year = year - 1900;
+	time.tm_mon = month - 1;
+	time.tm_mday = day; // mktime() normalizes day + 1 past the end of the month
+	time.tm_hour = hour;
+	return std::mktime(&time);
+}
+
+time_point_t ConsoleLogTimestampDecoder::Decode(const ConsoleLogTimestamp& timestamp)
+{
+	const uint32_t dayKey =
+		(uint32_t(timestamp.m_Year) << 16) |
+		(uint32_t(timestamp.m_Month) << 8) |
+		uint32_t(timestamp.m_Day);
+
+	if (dayKey != m_CachedDayKey)
+	{
+		// If the day is exactly 24 hours long, there is no DST transition in it and every
+		// timestamp is a constant offset from midnight.
+		m_CachedDayStart = MakeLocalTime(timestamp.m_Year, timestamp.m_Month, timestamp.m_Day, 0);
+		const time_t nextDayStart = MakeLocalTime(timestamp.m_Year, timestamp.m_Month, timestamp.m_Day + 1, 0);
+		m_IsCachedDayUniform = (nextDayStart - m_CachedDayStart) == 24 * 60 * 60;
+		m_CachedDayKey = dayKey;
+		m_CachedHour = uint8_t(-1);
+	}
+
+	time_t hourStart;
+	if (m_IsCachedDayUniform)
+	{
+		hourStart = m_CachedDayStart + time_t(timestamp.m_Hour) * 60 * 60;
+	}
+	else
+	{
+		// DST transitions happen on hour boundaries, so the rest of the hour is a constant offset
+		if (timestamp.m_Hour != m_CachedHour)
+		{
+			m_CachedHourStart = MakeLocalTime(timestamp.m_Year, timestamp.m_Month, timestamp.m_Day, timestamp.m_Hour);
+			m_CachedHour = timestamp.m_Hour;
+		}
+
+		hourStart = m_CachedHourStart;
+	}
+
+	return clock_t::from_time_t(hourStart) +
+		std::chrono::minutes(timestamp.m_Minute) +
+		std::chrono::seconds(timestamp.m_Second);
+}
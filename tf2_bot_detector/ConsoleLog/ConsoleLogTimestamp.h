@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Clock.h"
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	// A "\nMM/DD/YYYY - HH:MM:SS:" line prefix located in console.log output.
+	struct ConsoleLogTimestamp
+	{
+		static constexpr size_t LENGTH = 24; // Including the leading '\n' and the trailing ' ' or '\n'
+
+		size_t m_Begin{}; // Offset of the leading '\n'
+		size_t m_End{};   // Offset one past the trailing ' ' or '\n'
+
+		uint16_t m_Year{};
+		uint8_t m_Month{};  // 1-12
+		uint8_t m_Day{};    // 1-31
+		uint8_t m_Hour{};
+		uint8_t m_Minute{};
+		uint8_t m_Second{};
+	};
+
+	// Returns the first timestamp in text that begins at or after offset. Equivalent to searching for
+	// \n(\d\d)\/(\d\d)\/(\d\d\d\d) - (\d\d):(\d\d):(\d\d):[ \n] without the cost of std::regex.
+	std::optional<ConsoleLogTimestamp> FindConsoleLogTimestamp(const std::string_view& text, size_t offset = 0);
+
+	// Converts timestamps (local time) to time_point_ts. mktime() is only called when the
+	// date changes (or the hour, on days with a DST transition), rather than for every line.
+	class ConsoleLogTimestampDecoder final
+	{
+	public:
+		time_point_t Decode(const ConsoleLogTimestamp& timestamp);
+
+	private:
+		uint32_t m_CachedDayKey = uint32_t(-1);
+		time_t m_CachedDayStart{};
+		bool m_IsCachedDayUniform = false;
+
+		uint8_t m_CachedHour = uint8_t(-1);
+		time_t m_CachedHourStart{};
+	};
+}
@@ -0,0 +1,182 @@
+#include "HighFrequencyLines.h"
+
+#include <charconv>
+
+using namespace std::string_view_literals;
+using namespace tf2_bot_detector;
+
+void HighFrequencyLineCounter::Add(time_point_t timestamp, uint32_t bytes)
+{
+	m_Count.fetch_add(1, std::memory_order_relaxed);
+	m_Bytes.fetch_add(bytes, std::memory_order_relaxed);
+	m_LastSeen.store(timestamp.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+void HighFrequencyLineCounter::Reset()
+{
+	m_Count.store(0, std::memory_order_relaxed);
+	m_Bytes.store(0, std::memory_order_relaxed);
+	m_LastSeen.store(0, std::memory_order_relaxed);
+}
+
+static bool ConsumePrefix(std::string_view& text, const std::string_view& prefix)
+{
+	if (!text.starts_with(prefix))
+		return false;
+
+	text.remove_prefix(prefix.size());
+	return true;
+}
+
+static void ConsumeSpaces(std::string_view& text)
+{
+	while (!text.empty() && text.front() == ' ')
+		text.remove_prefix(1);
+}
+
+template<typename T>
+static bool ConsumeUInt(std::string_view& text, T& value)
+{
+	const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (result.ec != std::errc{})
+		return false;
+
+	text.remove_prefix(result.ptr - text.data());
+	return true;
+}
+
+bool HighFrequencyLineCounters::TryCount(const std::string_view& text, time_point_t timestamp)
+{
+	if (text.empty())
+		return false;
+
+	// Cheap enough to stay out of the way of every other line
+	switch (text.front())
+	{
+	case 'V': return TryCountVoice(text, timestamp);
+	case '<': return TryCountSplitPacket(text, timestamp);
+	case 'M': return TryCountUserMessage(text, timestamp);
+	default:  return false;
+	}
+}
+
+bool HighFrequencyLineCounters::TryCountVoice(std::string_view text, time_point_t timestamp)
+{
+	// Voice - chan (\d+), ent (\d+), bufsize: (\d+)
+	uint32_t channel, entindex, bufSize;
+	if (!ConsumePrefix(text, "Voice - chan "sv) || !ConsumeUInt(text, channel) ||
+		!ConsumePrefix(text, ", ent "sv) || !ConsumeUInt(text, entindex) ||
+		!ConsumePrefix(text, ", bufsize: "sv) || !ConsumeUInt(text, bufSize))
+	{
+		return false;
+	}
+
+	if (entindex >= MAX_ENTITIES)
+		return false;
+
+	m_Voice[entindex].Add(timestamp, bufSize);
+	return true;
+}
+
+bool HighFrequencyLineCounters::TryCountSplitPacket(std::string_view text, time_point_t timestamp)
+{
+	// <-- \[(.{3})\] Split packet +(\d+)\/ +(\d+) seq +(\d+) size +(\d+) mtu +(\d+) from ...
+	if (!ConsumePrefix(text, "<-- ["sv) || text.size() < 3)
+		return false;
+
+	SocketType socketType;
+	{
+		const auto socket = text.substr(0, 3);
+		if (socket == "cl "sv)
+			socketType = SocketType::Client;
+		else if (socket == "sv "sv)
+			socketType = SocketType::Server;
+		else if (socket == "htv"sv)
+			socketType = SocketType::HLTV;
+		else if (socket == "mat"sv)
+			socketType = SocketType::Matchmaking;
+		else if (socket == "lnk"sv)
+			socketType = SocketType::SystemLink;
+		else if (socket == "lan"sv)
+			socketType = SocketType::LAN;
+		else
+			return false;
+
+		text.remove_prefix(3);
+	}
+
+	uint32_t index, count, sequence, size;
+	if (!ConsumePrefix(text, "] Split packet"sv))
+		return false;
+
+	ConsumeSpaces(text);
+	if (!ConsumeUInt(text, index) || !ConsumePrefix(text, "/"sv))
+		return false;
+
+	ConsumeSpaces(text);
+	if (!ConsumeUInt(text, count) || !ConsumePrefix(text, " seq"sv))
+		return false;
+
+	ConsumeSpaces(text);
+	if (!ConsumeUInt(text, sequence) || !ConsumePrefix(text, " size"sv))
+		return false;
+
+	ConsumeSpaces(text);
+	if (!ConsumeUInt(text, size))
+		return false;
+
+	m_SplitPackets[size_t(socketType)].Add(timestamp, size);
+	return true;
+}
+
+bool HighFrequencyLineCounters::TryCountUserMessage(std::string_view text, time_point_t timestamp)
+{
+	// Msg from (address): svc_UserMessage: type (\d+), bytes (\d+)
+	constexpr auto SEPARATOR = ": svc_UserMessage: type "sv;
+	if (!ConsumePrefix(text, "Msg from "sv))
+		return false;
+
+	const auto separator = text.find(SEPARATOR);
+	if (separator == text.npos)
+		return false;
+
+	const auto address = text.substr(0, separator);
+	text.remove_prefix(separator + SEPARATOR.size());
+
+	uint32_t type, bytes;
+	if (!ConsumeUInt(text, type) || !ConsumePrefix(text, ", bytes "sv) || !ConsumeUInt(text, bytes))
+		return false;
+
+	if (type >= USER_MESSAGE_TYPE_TABLE_SIZE)
+		return false;
+
+	m_UserMessages[type].Add(timestamp, bytes);
+
+	if (USER_MESSAGE_TYPE_INFO[type].IsHandled())
+		return false;
+
+	// DiscordState picks up the server address from these
+	if (address != m_LastUserMessageAddress || timestamp != m_LastUserMessagePassedTime)
+	{
+		m_LastUserMessageAddress = address;
+		m_LastUserMessagePassedTime = timestamp;
+		return false;
+	}
+
+	return true;
+}
+
+const HighFrequencyLineCounter& HighFrequencyLineCounters::GetUserMessages(UserMessageType type) const
+{
+	return m_UserMessages.at(size_t(type));
+}
+
+void HighFrequencyLineCounters::Reset()
+{
+	for (auto& counter : m_Voice)
+		counter.Reset();
+	for (auto& counter : m_SplitPackets)
+		counter.Reset();
+	for (auto& counter : m_UserMessages)
+		counter.Reset();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Clock.h"
+#include "ConsoleLog/NetworkStatus.h"
+#include "GameData/UserMessageType.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	struct HighFrequencyLineCounter
+	{
+		uint32_t GetCount() const { return m_Count.load(std::memory_order_relaxed); }
+		uint64_t GetBytes() const { return m_Bytes.load(std::memory_order_relaxed); }
+		time_point_t GetLastSeen() const { return time_point_t(duration_t(m_LastSeen.load(std::memory_order_relaxed))); }
+
+		void Add(time_point_t timestamp, uint32_t bytes);
+		void Reset();
+
+	private:
+		std::atomic<uint32_t> m_Count = 0;
+		std::atomic<uint64_t> m_Bytes = 0;
+		std::atomic<duration_t::rep> m_LastSeen = 0;
+	};
+
+	// With net debugging enabled, voice, split packet and user message lines show up hundreds of times
+	// per second. Instead of turning each one into an IConsoleLine, these are parsed by hand and added
+	// to per-entity/per-type counters. Written by whichever thread is parsing, safe to read from
+	// anywhere.
+	class HighFrequencyLineCounters final
+	{
+	public:
+		static constexpr size_t MAX_ENTITIES = 256;
+
+		// Returns true if the line was one of ours and has been counted, in which case it shouldn't go
+		// through the normal parsing path. User messages of types in USER_MESSAGE_TYPE_INFO that are
+		// handled, and the first one per address and console timestamp, are counted but still return
+		// false.
+		bool TryCount(const std::string_view& text, time_point_t timestamp);
+
+		const HighFrequencyLineCounter& GetVoice(uint8_t entindex) const { return m_Voice[entindex]; }
+		const HighFrequencyLineCounter& GetSplitPackets(SocketType type) const { return m_SplitPackets.at(size_t(type)); }
+		const HighFrequencyLineCounter& GetUserMessages(UserMessageType type) const;
+
+		void Reset();
+
+	private:
+		bool TryCountVoice(std::string_view text, time_point_t timestamp);
+		bool TryCountSplitPacket(std::string_view text, time_point_t timestamp);
+		bool TryCountUserMessage(std::string_view text, time_point_t timestamp);
+
+		std::array<HighFrequencyLineCounter, MAX_ENTITIES> m_Voice;
+		std::array<HighFrequencyLineCounter, size_t(SocketType::COUNT)> m_SplitPackets;
+		std::array<HighFrequencyLineCounter, USER_MESSAGE_TYPE_TABLE_SIZE> m_UserMessages;
+
+		// Only touched by the parsing thread
+		std::string m_LastUserMessageAddress;
+		time_point_t m_LastUserMessagePassedTime{};
+	};
+}
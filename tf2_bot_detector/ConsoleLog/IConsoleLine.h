@@ -1,9 +1,16 @@
 #pragma once
 
 #include "Clock.h"
+#include "Util/PoolAllocator.h"
 
-#include <list>
+#include <mh/reflection/enum.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
 #include <memory>
+#include <span>
+#include <string>
 #include <string_view>
 
 namespace tf2_bot_detector
@@ -61,6 +68,38 @@ namespace tf2_bot_detector
 		NetChannelChoke,
 		NetChannelFlow,
 		NetChannelTotal,
+
+		COUNT,
+	};
+
+	// A set of ConsoleLineTypes, used by listeners to only subscribe to the lines they handle.
+	class ConsoleLineTypeMask final
+	{
+	public:
+		static_assert(size_t(ConsoleLineType::COUNT) <= 64);
+
+		constexpr ConsoleLineTypeMask() = default;
+		constexpr ConsoleLineTypeMask(std::initializer_list<ConsoleLineType> types)
+		{
+			for (ConsoleLineType type : types)
+				m_Bits |= GetBit(type);
+		}
+
+		static constexpr ConsoleLineTypeMask All()
+		{
+			ConsoleLineTypeMask retVal;
+			retVal.m_Bits = (uint64_t(1) << (size_t(ConsoleLineType::COUNT) - 1) << 1) - 1;
+			return retVal;
+		}
+		static constexpr ConsoleLineTypeMask None() { return {}; }
+
+		constexpr bool Contains(ConsoleLineType type) const { return (m_Bits & GetBit(type)) != 0; }
+		constexpr void Add(ConsoleLineType type) { m_Bits |= GetBit(type); }
+
+	private:
+		static constexpr uint64_t GetBit(ConsoleLineType type) { return uint64_t(1) << size_t(type); }
+
+		uint64_t m_Bits = 0;
 	};
 
 	enum class ConsoleLineOrdering
@@ -75,6 +114,9 @@ namespace tf2_bot_detector
 		std::string_view m_Text;
 		time_point_t m_Timestamp;
 		IWorldState& m_World;
+
+		// The buffer m_Text points into, if it is shared. Lines may keep it alive instead of copying their text.
+		const std::shared_ptr<const std::string>* m_TextBuffer = nullptr;
 	};
 
 	class IConsoleLine : public std::enable_shared_from_this<IConsoleLine>
@@ -94,51 +136,103 @@ namespace tf2_bot_detector
 		};
 		virtual void Print(const PrintArgs& args) const = 0;
 
-		static std::shared_ptr<IConsoleLine> ParseConsoleLine(const std::string_view& text, time_point_t timestamp, IWorldState& world);
+		static std::shared_ptr<IConsoleLine> ParseConsoleLine(const std::string_view& text, time_point_t timestamp, IWorldState& world,
+			const std::shared_ptr<const std::string>* textBuffer = nullptr);
 
-		time_point_t GetTimestamp() const { return m_Timestamp; }
+		// Like ParseConsoleLine(), but only tries the few types the world state can't keep track of
+		// players, the lobby, kills, votes and config execs without. Everything else comes back as nullptr.
+		static std::shared_ptr<IConsoleLine> ParseEssentialConsoleLine(const std::string_view& text, time_point_t timestamp,
+			IWorldState& world, const std::shared_ptr<const std::string>* textBuffer = nullptr);
 
-	protected:
+		// The static TryParse() of a console line type. Command responses are run through the
+		// ones they're expected to contain before falling back to ParseConsoleLine().
 		using TryParseFunc = std::shared_ptr<IConsoleLine>(*)(const ConsoleLineTryParseArgs& args);
-		struct ConsoleLineTypeData
-		{
-			TryParseFunc m_TryParseFunc = nullptr;
-			const std::type_info* m_TypeInfo = nullptr;
 
-			size_t m_AutoParseSuccessCount = 0;
-			bool m_AutoParse = true;
-		};
+		// Ignores the trailing newline console.log lines still have, so the same line hashes
+		// identically whether it came from console.log or an RCON response.
+		static size_t HashText(std::string_view text);
+
+		// Called before a line is kept around long-term, so it stops pinning the buffer it was parsed from.
+		virtual void ReleaseTextBuffer() {}
 
-		//static const ConsoleLineTypeData* GetTypeData() { return s_TypeData; }
-		static void AddTypeData(ConsoleLineTypeData data);
+		time_point_t GetTimestamp() const { return m_Timestamp; }
+
+		// ParseConsoleLine() tries the types without a PARSE_PREFIXES in the order they're listed in
+		// ConsoleLines.cpp. Enabled, it counts how often each of them matches instead, and every so
+		// often re-sorts them most successful first. Off by default.
+		static void SetAdaptiveParseOrder(bool enabled);
+		static bool IsAdaptiveParseOrder();
 
 	private:
 		time_point_t m_Timestamp;
-
-		static std::list<ConsoleLineTypeData>& GetTypeData();
-		inline static ConsoleLineTypeData* s_TypeData = nullptr;
-		inline static size_t s_TotalParseCount = 0;
 	};
 
+	// Console lines are created and thrown away constantly, so they all come from a shared pool.
+	template<typename T, typename... TArgs>
+	inline std::shared_ptr<T> MakeConsoleLine(TArgs&&... args)
+	{
+		return std::allocate_shared<T>(PoolAllocator<T>{}, std::forward<TArgs>(args)...);
+	}
+
+	// Console line types may declare
+	//   static constexpr std::string_view PARSE_PREFIXES[] = { ... };
+	// so ParseConsoleLine() can skip their TryParse for lines that can't possibly match.
+	// ParseConsoleLine() only knows about the types listed in AutoParsedLineTypes, in ConsoleLines.cpp.
+	// Types with AutoParse = false are only ever parsed by something else deciding to.
 	template<typename TSelf, bool AutoParse = true>
 	class ConsoleLineBase : public IConsoleLine
 	{
 	public:
 		ConsoleLineBase(time_point_t timestamp) : IConsoleLine(timestamp) {}
 
-	private:
-		struct AutoRegister
-		{
-			AutoRegister()
-			{
-				AddTypeData(ConsoleLineTypeData
-					{
-						.m_TryParseFunc = &TSelf::TryParse,
-						.m_TypeInfo = &typeid(TSelf),
-						.m_AutoParse = AutoParse
-					});
-			}
-
-		} inline static s_AutoRegister;
+		static constexpr bool AUTO_PARSE = AutoParse;
 	};
 }
+
+MH_ENUM_REFLECT_BEGIN(tf2_bot_detector::ConsoleLineType)
+	MH_ENUM_REFLECT_VALUE(Generic)
+	MH_ENUM_REFLECT_VALUE(Chat)
+	MH_ENUM_REFLECT_VALUE(Ping)
+	MH_ENUM_REFLECT_VALUE(LobbyStatusFailed)
+	MH_ENUM_REFLECT_VALUE(LobbyChanged)
+	MH_ENUM_REFLECT_VALUE(DifferingLobbyReceived)
+	MH_ENUM_REFLECT_VALUE(LobbyHeader)
+	MH_ENUM_REFLECT_VALUE(LobbyMember)
+	MH_ENUM_REFLECT_VALUE(PartyHeader)
+	MH_ENUM_REFLECT_VALUE(PlayerStatus)
+	MH_ENUM_REFLECT_VALUE(PlayerStatusIP)
+	MH_ENUM_REFLECT_VALUE(PlayerStatusShort)
+	MH_ENUM_REFLECT_VALUE(PlayerStatusCount)
+	MH_ENUM_REFLECT_VALUE(PlayerStatusMapPosition)
+	MH_ENUM_REFLECT_VALUE(ClientReachedServerSpawn)
+	MH_ENUM_REFLECT_VALUE(KillNotification)
+	MH_ENUM_REFLECT_VALUE(CvarlistConvar)
+	MH_ENUM_REFLECT_VALUE(VoiceReceive)
+	MH_ENUM_REFLECT_VALUE(EdictUsage)
+	MH_ENUM_REFLECT_VALUE(SplitPacket)
+	MH_ENUM_REFLECT_VALUE(SVC_UserMessage)
+	MH_ENUM_REFLECT_VALUE(ConfigExec)
+	MH_ENUM_REFLECT_VALUE(TeamsSwitched)
+	MH_ENUM_REFLECT_VALUE(Connecting)
+	MH_ENUM_REFLECT_VALUE(HostNewGame)
+	MH_ENUM_REFLECT_VALUE(GameQuit)
+	MH_ENUM_REFLECT_VALUE(QueueStateChange)
+	MH_ENUM_REFLECT_VALUE(InQueue)
+	MH_ENUM_REFLECT_VALUE(ServerJoin)
+	MH_ENUM_REFLECT_VALUE(ServerDroppedPlayer)
+	MH_ENUM_REFLECT_VALUE(MatchmakingBannedTime)
+	MH_ENUM_REFLECT_VALUE(NetStatusConfig)
+	MH_ENUM_REFLECT_VALUE(NetLatency)
+	MH_ENUM_REFLECT_VALUE(NetLoss)
+	MH_ENUM_REFLECT_VALUE(NetPacketsTotal)
+	MH_ENUM_REFLECT_VALUE(NetPacketsPerClient)
+	MH_ENUM_REFLECT_VALUE(NetDataTotal)
+	MH_ENUM_REFLECT_VALUE(NetDataPerClient)
+	MH_ENUM_REFLECT_VALUE(NetChannelOnline)
+	MH_ENUM_REFLECT_VALUE(NetChannelReliable)
+	MH_ENUM_REFLECT_VALUE(NetChannelLatencyLoss)
+	MH_ENUM_REFLECT_VALUE(NetChannelPackets)
+	MH_ENUM_REFLECT_VALUE(NetChannelChoke)
+	MH_ENUM_REFLECT_VALUE(NetChannelFlow)
+	MH_ENUM_REFLECT_VALUE(NetChannelTotal)
+MH_ENUM_REFLECT_END()
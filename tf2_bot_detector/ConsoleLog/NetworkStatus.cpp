@@ -9,9 +9,6 @@ using namespace tf2_bot_detector;
 using namespace std::string_literals;
 using namespace std::string_view_literals;
 
-// net_status
-static std::regex s_DataPerClientOut(R"regex(           per client out (\d+\.\d), in (\d+\.\d) kB\/s)regex", std::regex::optimize);
-
 SplitPacketLine::SplitPacketLine(time_point_t timestamp, SplitPacket packet) :
 	BaseClass(timestamp), m_Packet(std::move(packet))
 {
@@ -19,9 +16,18 @@ SplitPacketLine::SplitPacketLine(time_point_t timestamp, SplitPacket packet) :
 
 std::shared_ptr<IConsoleLine> SplitPacketLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static std::regex s_Regex(R"regex(<-- \[(.{3})\] Split packet +(\d+)\/ +(\d+) seq +(\d+) size +(\d+) mtu +(\d+) from ([0-9.:a-fA-F]+:\d+))regex", std::regex::optimize);
-
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	using namespace static_regex;
+
+	// <-- \[(.{3})\] Split packet +(\d+)\/ +(\d+) seq +(\d+) size +(\d+) mtu +(\d+) from ([0-9.:a-fA-F]+:\d+)
+	static constexpr auto s_Regex = regex(seq(lit("<-- ["), cap<1>(repeat(dot, 3, 3)),
+		lit("] Split packet"), plus(chars(" ")), cap<2>(plus(digit)),
+		lit("/"), plus(chars(" ")), cap<3>(plus(digit)),
+		lit(" seq"), plus(chars(" ")), cap<4>(plus(digit)),
+		lit(" size"), plus(chars(" ")), cap<5>(plus(digit)),
+		lit(" mtu"), plus(chars(" ")), cap<6>(plus(digit)),
+		lit(" from "), cap<7>(seq(plus(chars("0123456789.:abcdefABCDEF")), lit(":"), plus(digit)))));
+
+	if (auto result = s_Regex.match(args.m_Text))
 	{
 		SplitPacket packet;
 
@@ -54,7 +60,7 @@ std::shared_ptr<IConsoleLine> SplitPacketLine::TryParse(const ConsoleLineTryPars
 		from_chars_throw(result[6], packet.m_MTU);
 		packet.m_Address = result[7].str();
 
-		return std::make_shared<SplitPacketLine>(args.m_Timestamp, std::move(packet));
+		return MakeConsoleLine<SplitPacketLine>(args.m_Timestamp, std::move(packet));
 	}
 
 	return nullptr;
@@ -95,11 +101,15 @@ NetStatusConfigLine::NetStatusConfigLine(time_point_t timestamp,
 
 std::shared_ptr<IConsoleLine> NetStatusConfigLine::TryParse(const ConsoleLineTryParseArgs& args)
 {
-	static const std::regex s_Regex(R"regex(- Config: (.*), (.*), (\d+) connections)regex", std::regex::optimize);
+	using namespace static_regex;
 
-	if (svmatch result; std::regex_match(args.m_Text.begin(), args.m_Text.end(), result, s_Regex))
+	// - Config: (.*), (.*), (\d+) connections
+	static constexpr auto s_Regex = regex(seq(lit("- Config: "), cap<1>(star(dot)), lit(", "), cap<2>(star(dot)),
+		lit(", "), cap<3>(plus(digit)), lit(" connections")));
+
+	if (auto result = s_Regex.match(args.m_Text))
 	{
-		const std::string_view playerModeStr(&*result[1].first, result[1].length());
+		const std::string_view playerModeStr = to_string_view(result[1]);
 		PlayerMode playerMode;
 		if (playerModeStr == "Multiplayer"sv)
 			playerMode = PlayerMode::Multiplayer;
@@ -111,7 +121,7 @@ std::shared_ptr<IConsoleLine> NetStatusConfigLine::TryParse(const ConsoleLineTry
 			return nullptr;
 		}
 
-		const std::string_view serverModeStr(&*result[2].first, result[2].length());
+		const std::string_view serverModeStr = to_string_view(result[2]);
 		ServerMode serverMode;
 		if (serverModeStr == "dedicated"sv)
 			serverMode = ServerMode::Dedicated;
@@ -126,7 +136,7 @@ std::shared_ptr<IConsoleLine> NetStatusConfigLine::TryParse(const ConsoleLineTry
 		unsigned connectionCount;
 		from_chars_throw(result[3], connectionCount);
 
-		return std::make_shared<NetStatusConfigLine>(args.m_Timestamp, playerMode, serverMode, connectionCount);
+		return MakeConsoleLine<NetStatusConfigLine>(args.m_Timestamp, playerMode, serverMode, connectionCount);
 	}
 
 	return nullptr;
@@ -140,19 +150,11 @@ void NetStatusConfigLine::Print(const PrintArgs& args) const
 		m_ConnectionCount);
 }
 
-bool NetChannelDualFloatLineBase::TryParse(const std::string_view& text,
-	const std::string_view& pattern, float& f0, float& f1)
+void NetChannelDualFloatLineBase::ParseFloats(const std::string_view& str0, const std::string_view& str1,
+	float& f0, float& f1)
 {
-	const std::regex s_Regex(pattern.data(), pattern.data() + pattern.size());
-
-	if (svmatch result; std::regex_match(text.begin(), text.end(), result, s_Regex))
-	{
-		from_chars_throw(result[1], f0);
-		from_chars_throw(result[2], f1);
-		return true;
-	}
-
-	return false;
+	from_chars_throw(str0, f0);
+	from_chars_throw(str1, f1);
 }
 
 void NetChannelDualFloatLineBase::Print(const IConsoleLine::PrintArgs& args, const std::string_view& fmtStr) const
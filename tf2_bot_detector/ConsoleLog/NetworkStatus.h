@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ConsoleLog/IConsoleLine.h"
+#include "Util/StaticRegex.h"
 
 #include <string>
 #include <string_view>
@@ -47,6 +48,7 @@ namespace tf2_bot_detector
 		SplitPacketLine(time_point_t timestamp, SplitPacket packet);
 
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "<-- [" };
 
 		const SplitPacket& GetSplitPacket() const { return m_Packet; }
 
@@ -77,6 +79,7 @@ namespace tf2_bot_detector
 
 		NetStatusConfigLine(time_point_t timestamp, PlayerMode playerMode, ServerMode serverMode, unsigned connectionCount);
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args);
+		static constexpr std::string_view PARSE_PREFIXES[] = { "- Config: " };
 
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetStatusConfig; }
 		bool ShouldPrint() const override { return false; }
@@ -98,7 +101,35 @@ namespace tf2_bot_detector
 		constexpr NetChannelDualFloatLineBase(float f0, float f1) : m_Float0(f0), m_Float1(f1) {}
 
 	protected:
-		static bool TryParse(const std::string_view& text, const std::string_view& pattern, float& f0, float& f1);
+		// \d+\.\d+
+		static constexpr auto DECIMAL = static_regex::seq(static_regex::plus(static_regex::digit),
+			static_regex::lit("."), static_regex::plus(static_regex::digit));
+		// \d+\.\d
+		static constexpr auto DECIMAL_1 = static_regex::seq(static_regex::plus(static_regex::digit),
+			static_regex::lit("."), static_regex::one(static_regex::digit));
+
+		// <prefix>(float)<separator>(float)<suffix>
+		template<typename TFloat>
+		static constexpr auto MakeRegex(const std::string_view& prefix, const TFloat& floatPattern,
+			const std::string_view& separator, const std::string_view& suffix = {})
+		{
+			using namespace static_regex;
+			return regex(seq(lit(prefix), cap<1>(floatPattern), lit(separator), cap<2>(floatPattern), lit(suffix)));
+		}
+
+		template<typename TRegex>
+		static bool TryParse(const std::string_view& text, const TRegex& regex, float& f0, float& f1)
+		{
+			if (auto result = regex.match(text))
+			{
+				ParseFloats(result[1].view(), result[2].view(), f0, f1);
+				return true;
+			}
+
+			return false;
+		}
+
+		static void ParseFloats(const std::string_view& str0, const std::string_view& str1, float& f0, float& f1);
 		void Print(const IConsoleLine::PrintArgs& args, const std::string_view& fmtStr) const;
 
 		float GetFloat0() const { return m_Float0; }
@@ -117,8 +148,8 @@ namespace tf2_bot_detector
 	public:
 		static std::shared_ptr<IConsoleLine> TryParse(const ConsoleLineTryParseArgs& args)
 		{
-			if (float f0, f1; NetChannelDualFloatLineBase::TryParse(args.m_Text, TSelf::REGEX_PATTERN, f0, f1))
-				return std::make_shared<TSelf>(args.m_Timestamp, f0, f1);
+			if (float f0, f1; NetChannelDualFloatLineBase::TryParse(args.m_Text, TSelf::REGEX, f0, f1))
+				return MakeConsoleLine<TSelf>(args.m_Timestamp, f0, f1);
 
 			return nullptr;
 		}
@@ -152,7 +183,8 @@ namespace tf2_bot_detector
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetChannelLatencyLoss; }
 
 		static constexpr std::string_view PRINT_FORMAT_STRING =  "- latency: {.1f}, loss {.2f}";
-		static constexpr std::string_view REGEX_PATTERN = R"regex(- latency: (\d+\.\d+), loss (\d+\.\d+))regex";
+		static constexpr auto REGEX = MakeRegex("- latency: ", DECIMAL, ", loss ");
+		static constexpr std::string_view PARSE_PREFIXES[] = { "- latency: " };
 	};
 
 	class NetChannelPacketsLine final : public NetChannelDualFloatLine<NetChannelPacketsLine>
@@ -171,7 +203,8 @@ namespace tf2_bot_detector
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetChannelPackets; }
 
 		static constexpr std::string_view PRINT_FORMAT_STRING =  "- packets: in {.1f}/s, out {.1f}/s";
-		static constexpr std::string_view REGEX_PATTERN = R"regex(- packets: in (\d+\.\d+)\/s, out (\d+\.\d+)\/s)regex";
+		static constexpr auto REGEX = MakeRegex("- packets: in ", DECIMAL, "/s, out ", "/s");
+		static constexpr std::string_view PARSE_PREFIXES[] = { "- packets: in " };
 	};
 
 	class NetChannelChokeLine final : public NetChannelDualFloatLine<NetChannelChokeLine>
@@ -188,7 +221,8 @@ namespace tf2_bot_detector
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetChannelChoke; }
 
 		static constexpr std::string_view PRINT_FORMAT_STRING =  "- choke: in {.2f}, out {.2f}";
-		static constexpr std::string_view REGEX_PATTERN = R"regex(- choke: in (\d+\.\d+), out (\d+\.\d+))regex";
+		static constexpr auto REGEX = MakeRegex("- choke: in ", DECIMAL, ", out ");
+		static constexpr std::string_view PARSE_PREFIXES[] = { "- choke: in " };
 	};
 
 	class NetChannelFlowLine final : public NetChannelDualFloatLine<NetChannelFlowLine>
@@ -207,7 +241,8 @@ namespace tf2_bot_detector
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetChannelFlow; }
 
 		static constexpr std::string_view PRINT_FORMAT_STRING =  "- flow: in {.1f}, out {.1f} KB/s";
-		static constexpr std::string_view REGEX_PATTERN = R"regex(- flow: in (\d+\.\d+), out (\d+\.\d+) kB\/s)regex";
+		static constexpr auto REGEX = MakeRegex("- flow: in ", DECIMAL, ", out ", " kB/s");
+		static constexpr std::string_view PARSE_PREFIXES[] = { "- flow: in " };
 	};
 
 	class NetChannelTotalLine final : public NetChannelDualFloatLine<NetChannelTotalLine>
@@ -226,7 +261,8 @@ namespace tf2_bot_detector
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetChannelTotal; }
 
 		static constexpr std::string_view PRINT_FORMAT_STRING =  "- total: in {.1f}, out {.1f} MB";
-		static constexpr std::string_view REGEX_PATTERN = R"regex(- total: in (\d+\.\d+), out (\d+\.\d+) MB)regex";
+		static constexpr auto REGEX = MakeRegex("- total: in ", DECIMAL, ", out ", " MB");
+		static constexpr std::string_view PARSE_PREFIXES[] = { "- total: in " };
 	};
 
 	class NetLatencyLine final : public NetChannelDualFloatLine<NetLatencyLine>
@@ -245,7 +281,8 @@ namespace tf2_bot_detector
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetLatency; }
 
 		static constexpr std::string_view PRINT_FORMAT_STRING =  "- Latency: avg out {.2f}s, in {.2f}s";
-		static constexpr std::string_view REGEX_PATTERN = R"regex(- Latency: avg out (\d+\.\d+)s, in (\d+\.\d+)s)regex";
+		static constexpr auto REGEX = MakeRegex("- Latency: avg out ", DECIMAL, "s, in ", "s");
+		static constexpr std::string_view PARSE_PREFIXES[] = { "- Latency: avg out " };
 	};
 
 	class NetLossLine final : public NetChannelDualFloatLine<NetLossLine>
@@ -264,7 +301,8 @@ namespace tf2_bot_detector
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetLoss; }
 
 		static constexpr std::string_view PRINT_FORMAT_STRING =  "- Loss:    avg out {.1f}, in {.1f}";
-		static constexpr std::string_view REGEX_PATTERN = R"regex(- Loss:    avg out (\d+\.\d+), in (\d+\.\d+))regex";
+		static constexpr auto REGEX = MakeRegex("- Loss:    avg out ", DECIMAL, ", in ");
+		static constexpr std::string_view PARSE_PREFIXES[] = { "- Loss:    avg out " };
 	};
 
 	class NetPacketsTotalLine final : public NetChannelDualFloatLine<NetPacketsTotalLine>
@@ -283,7 +321,8 @@ namespace tf2_bot_detector
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetPacketsTotal; }
 
 		static constexpr std::string_view PRINT_FORMAT_STRING =  "- Packets: net total out  {.1f}/s, in {.1f}/s";
-		static constexpr std::string_view REGEX_PATTERN = R"regex(- Packets: net total out  (\d+\.\d)\/s, in (\d+\.\d)\/s)regex";
+		static constexpr auto REGEX = MakeRegex("- Packets: net total out  ", DECIMAL_1, "/s, in ", "/s");
+		static constexpr std::string_view PARSE_PREFIXES[] = { "- Packets: net total out  " };
 	};
 
 	class NetPacketsPerClientLine final : public NetChannelDualFloatLine<NetPacketsPerClientLine>
@@ -302,7 +341,8 @@ namespace tf2_bot_detector
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetPacketsPerClient; }
 
 		static constexpr std::string_view PRINT_FORMAT_STRING =  "           per client out {.1f}/s, in {.1f}/s";
-		static constexpr std::string_view REGEX_PATTERN = R"regex(           per client out (\d+\.\d)\/s, in (\d+\.\d)\/s)regex";
+		static constexpr auto REGEX = MakeRegex("           per client out ", DECIMAL_1, "/s, in ", "/s");
+		static constexpr std::string_view PARSE_PREFIXES[] = { "           per client out " };
 	};
 
 	class NetDataTotalLine final : public NetChannelDualFloatLine<NetDataTotalLine>
@@ -321,7 +361,8 @@ namespace tf2_bot_detector
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetDataTotal; }
 
 		static constexpr std::string_view PRINT_FORMAT_STRING =  "- Data:    net total out  {.1f}, in {.1f} kB/s";
-		static constexpr std::string_view REGEX_PATTERN = R"regex(- Data:    net total out  (\d+\.\d), in (\d+\.\d) kB\/s)regex";
+		static constexpr auto REGEX = MakeRegex("- Data:    net total out  ", DECIMAL_1, ", in ", " kB/s");
+		static constexpr std::string_view PARSE_PREFIXES[] = { "- Data:    net total out  " };
 	};
 
 	class NetDataPerClientLine final : public NetChannelDualFloatLine<NetDataPerClientLine>
@@ -340,6 +381,7 @@ namespace tf2_bot_detector
 		ConsoleLineType GetType() const override { return ConsoleLineType::NetDataPerClient; }
 
 		static constexpr std::string_view PRINT_FORMAT_STRING =  "           per client out {.1f}, in {.1f} kB/s";
-		static constexpr std::string_view REGEX_PATTERN = R"regex(           per client out (\d+\.\d), in (\d+\.\d) kB\/s)regex";
+		static constexpr auto REGEX = MakeRegex("           per client out ", DECIMAL_1, ", in ", " kB/s");
+		static constexpr std::string_view PARSE_PREFIXES[] = { "           per client out " };
 	};
 }
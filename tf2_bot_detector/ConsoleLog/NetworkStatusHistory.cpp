@@ -0,0 +1,76 @@
+#include "NetworkStatusHistory.h"
+#include "NetworkStatus.h"
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+static constexpr std::array<duration_t, NetworkStatusHistory::Series::TIER_COUNT> TIER_WIDTHS{ 0s, 10s, 1min };
+
+NetworkStatusHistory::NetworkStatusHistory(IWorldState& world) :
+	AutoConsoleLineListener(world,
+		{
+			ConsoleLineType::NetChannelLatencyLoss,
+			ConsoleLineType::NetChannelChoke,
+			ConsoleLineType::NetChannelPackets,
+			ConsoleLineType::NetChannelFlow,
+		}),
+	m_Series{
+		Series(TIER_WIDTHS), Series(TIER_WIDTHS),
+		Series(TIER_WIDTHS), Series(TIER_WIDTHS),
+		Series(TIER_WIDTHS), Series(TIER_WIDTHS),
+		Series(TIER_WIDTHS), Series(TIER_WIDTHS),
+	}
+{
+	static_assert(size_t(NetworkMetric::COUNT) == 8, "Update m_Series initializer");
+}
+
+void NetworkStatusHistory::Clear()
+{
+	for (auto& series : m_Series)
+		series.Clear();
+}
+
+void NetworkStatusHistory::Add(NetworkMetric metric, time_point_t timestamp, float value)
+{
+	m_Series.at(size_t(metric)).Add(timestamp, value);
+}
+
+void NetworkStatusHistory::OnConsoleLineParsed(IWorldState& world, IConsoleLine& line)
+{
+	const auto timestamp = line.GetTimestamp();
+
+	switch (line.GetType())
+	{
+	case ConsoleLineType::NetChannelLatencyLoss:
+	{
+		auto& latencyLine = static_cast<const NetChannelLatencyLossLine&>(line);
+		Add(NetworkMetric::Latency, timestamp, latencyLine.GetLatency());
+		Add(NetworkMetric::Loss, timestamp, latencyLine.GetLoss());
+		break;
+	}
+	case ConsoleLineType::NetChannelChoke:
+	{
+		auto& chokeLine = static_cast<const NetChannelChokeLine&>(line);
+		Add(NetworkMetric::ChokeIn, timestamp, chokeLine.GetInPercentChoke());
+		Add(NetworkMetric::ChokeOut, timestamp, chokeLine.GetOutPercentChoke());
+		break;
+	}
+	case ConsoleLineType::NetChannelPackets:
+	{
+		auto& packetsLine = static_cast<const NetChannelPacketsLine&>(line);
+		Add(NetworkMetric::PacketsIn, timestamp, packetsLine.GetInPacketsPerSecond());
+		Add(NetworkMetric::PacketsOut, timestamp, packetsLine.GetOutPacketsPerSecond());
+		break;
+	}
+	case ConsoleLineType::NetChannelFlow:
+	{
+		auto& flowLine = static_cast<const NetChannelFlowLine&>(line);
+		Add(NetworkMetric::FlowIn, timestamp, flowLine.GetInKBps());
+		Add(NetworkMetric::FlowOut, timestamp, flowLine.GetOutKBps());
+		break;
+	}
+
+	default:
+		break;
+	}
+}
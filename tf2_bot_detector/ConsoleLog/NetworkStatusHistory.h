@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ConsoleLog/ConsoleLineListener.h"
+#include "Util/TimeSeries.h"
+
+#include <array>
+
+namespace tf2_bot_detector
+{
+	enum class NetworkMetric : uint8_t
+	{
+		// Same units as net_channels prints them
+		Latency,
+		Loss,
+		ChokeIn,
+		ChokeOut,
+		PacketsIn,
+		PacketsOut,
+		FlowIn,
+		FlowOut,
+
+		COUNT,
+	};
+
+	// Keeps the values from the net_channel lines around after the lines themselves are gone, for
+	// network quality graphs. Memory use is fixed no matter how long we've been running.
+	class NetworkStatusHistory final : AutoConsoleLineListener
+	{
+	public:
+		// Every sample, then 10 second and 1 minute buckets. At the usual rate of net_status
+		// updates that's roughly 20 minutes, 40 minutes and 4 hours.
+		using Series = TimeSeries<256, 3>;
+
+		NetworkStatusHistory(IWorldState& world);
+
+		const Series& GetSeries(NetworkMetric metric) const { return m_Series.at(size_t(metric)); }
+		void Clear();
+
+	private:
+		void OnConsoleLineParsed(IWorldState& world, IConsoleLine& line) override;
+		void Add(NetworkMetric metric, time_point_t timestamp, float value);
+
+		std::array<Series, size_t(NetworkMetric::COUNT)> m_Series;
+	};
+}
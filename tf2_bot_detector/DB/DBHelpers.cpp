@@ -5,6 +5,7 @@
 #include <mh/error/ensure.hpp>
 #include <mh/text/fmtstr.hpp>
 #include <SQLiteCpp/SQLiteCpp.h>
+#include <sqlite3.h>
 
 using namespace tf2_bot_detector;
 using namespace tf2_bot_detector::DB;
@@ -86,8 +87,8 @@ void tf2_bot_detector::DB::CreateTable(SQLite::Database& db, const TableDefiniti
 	return CreateTable(db, table.GetTableName(), cols.data(), cols.data() + cols.size(), flags);
 }
 
-void tf2_bot_detector::DB::InsertInto(SQLite::Database& db, const std::string_view& tableName, std::initializer_list<ColumnData> columns,
-	InsertIntoConstraintResolver resolver) try
+static std::string GenerateInsertIntoQuery(const std::string_view& tableName, std::initializer_list<ColumnData> columns,
+	InsertIntoConstraintResolver resolver)
 {
 	std::string query = "INSERT OR ";
 
@@ -134,29 +135,35 @@ void tf2_bot_detector::DB::InsertInto(SQLite::Database& db, const std::string_vi
 	}
 
 	query.append(")");
+	return query;
+}
 
-	SQLite::Statement statement(db, query);
-
+static void BindColumnData(SQLite::Statement& statement, std::initializer_list<ColumnData> columns)
+{
+	int i = 1;
+	for (const ColumnData& column : columns)
 	{
-		int i = 1;
-		for (const ColumnData& column : columns)
-		{
-			std::visit([&](const auto& val)
-				{
-					using type = std::decay_t<decltype(val)>;
-					if constexpr (std::is_same_v<type, BlobData>)
-						statement.bind(i, val.m_Data, static_cast<int>(val.m_Size));
-					else if constexpr (std::is_same_v<type, std::monostate>)
-						statement.bind(i);
-					else
-						statement.bind(i, val);
-
-				}, column.m_Data);
-
-			i++;
-		}
+		std::visit([&](const auto& val)
+			{
+				using type = std::decay_t<decltype(val)>;
+				if constexpr (std::is_same_v<type, BlobData>)
+					statement.bind(i, val.m_Data, static_cast<int>(val.m_Size));
+				else if constexpr (std::is_same_v<type, std::monostate>)
+					statement.bind(i);
+				else
+					statement.bind(i, val);
+
+			}, column.m_Data);
+
+		i++;
 	}
+}
 
+void tf2_bot_detector::DB::InsertInto(SQLite::Database& db, const std::string_view& tableName, std::initializer_list<ColumnData> columns,
+	InsertIntoConstraintResolver resolver) try
+{
+	SQLite::Statement statement(db, GenerateInsertIntoQuery(tableName, columns, resolver));
+	BindColumnData(statement, columns);
 	statement.exec();
 }
 catch (...)
@@ -170,6 +177,24 @@ void tf2_bot_detector::DB::ReplaceInto(SQLite::Database& db, const std::string_v
 	return InsertInto(db, tableName, columns, InsertIntoConstraintResolver::Replace);
 }
 
+void tf2_bot_detector::DB::InsertInto(StatementCache& cache, const std::string_view& tableName, std::initializer_list<ColumnData> columns,
+	InsertIntoConstraintResolver resolver) try
+{
+	auto statement = cache.Get(GenerateInsertIntoQuery(tableName, columns, resolver));
+	BindColumnData(statement.get(), columns);
+	statement.exec();
+}
+catch (...)
+{
+	LogException();
+	throw;
+}
+
+void tf2_bot_detector::DB::ReplaceInto(StatementCache& cache, const std::string_view& tableName, std::initializer_list<ColumnData> columns)
+{
+	return InsertInto(cache, tableName, columns, InsertIntoConstraintResolver::Replace);
+}
+
 ColumnData::ColumnData(const ColumnDefinition& column, uint32_t intData) :
 	ColumnData(column, int64_t(intData))
 {
@@ -311,8 +336,8 @@ std::unique_ptr<IOperationExpression> ColumnExpression::Clone() const
 	return std::make_unique<ColumnExpression>(*this);
 }
 
-SelectStatementBuilder::SelectStatementBuilder(const std::string_view& tableName) :
-	m_TableName(tableName)
+SelectStatementBuilder::SelectStatementBuilder(const std::string_view& tableName, const std::string_view& schemaName) :
+	m_TableName(tableName), m_SchemaName(schemaName)
 {
 }
 
@@ -323,6 +348,15 @@ SelectStatementBuilder& SelectStatementBuilder::Where(BinaryOperation&& binOp)
 	return *this;
 }
 
+SelectStatementBuilder& SelectStatementBuilder::WhereIn(const ColumnDefinition& column, std::vector<int64_t> values)
+{
+	assert(!m_WhereInColumn);
+	assert(!values.empty());
+	m_WhereInColumn = &column;
+	m_WhereInValues = std::move(values);
+	return *this;
+}
+
 namespace
 {
 	struct StringStatementGenerator final : public IStatementGenerator
@@ -353,11 +387,15 @@ namespace
 	};
 }
 
-Statement2 SelectStatementBuilder::Run(const SQLite::Database& db) const
+std::string SelectStatementBuilder::GenerateQuery(param_list_t& parameters) const
 {
 	std::string queryStr;
 
-	queryStr.append("SELECT * FROM \"").append(m_TableName).append("\"");
+	queryStr.append("SELECT * FROM ");
+	if (!m_SchemaName.empty())
+		queryStr.append("\"").append(m_SchemaName).append("\".");
+
+	queryStr.append("\"").append(m_TableName).append("\"");
 
 	StringStatementGenerator gen(queryStr);
 	if (m_WhereCondition)
@@ -366,25 +404,115 @@ Statement2 SelectStatementBuilder::Run(const SQLite::Database& db) const
 		m_WhereCondition->GenerateStatement(gen);
 	}
 
-	// The const_cast is "ok" because its just a select statement... right?
-	Statement2 retVal(SQLite::Statement(const_cast<SQLite::Database&>(db), queryStr));
-
-	for (size_t i = 0; i < gen.m_Parameters.size(); i++)
+	if (m_WhereInColumn)
 	{
-		const mh::fmtstr<32> argName("?{}", (i + 1));
+		queryStr.append(m_WhereCondition ? " AND " : " WHERE ");
+		gen.TextQuoted(m_WhereInColumn->m_Name);
+		gen.Text(" IN (");
+		for (size_t i = 0; i < m_WhereInValues.size(); i++)
+		{
+			if (i > 0)
+				gen.Text(", ");
+
+			gen.Param(m_WhereInValues[i]);
+		}
+		gen.Text(")");
+	}
 
+	parameters = std::move(gen.m_Parameters);
+	return queryStr;
+}
+
+void SelectStatementBuilder::BindParameters(SQLite::Statement& statement, const param_list_t& parameters)
+{
+	for (size_t i = 0; i < parameters.size(); i++)
+	{
 		std::visit([&](auto&& arg)
 			{
 				using type_t = std::decay_t<decltype(arg)>;
 				if constexpr (std::is_same_v<type_t, BlobData>)
-					retVal.bind(int(i + 1), arg.m_Data, (int)arg.m_Size);
+					statement.bind(int(i + 1), arg.m_Data, (int)arg.m_Size);
 				else if constexpr (std::is_same_v<type_t, std::string>)
-					retVal.bind(int(i + 1), arg.c_str());
+					statement.bind(int(i + 1), arg.c_str());
 				else
-					retVal.bind(int(i + 1), arg);
+					statement.bind(int(i + 1), arg);
 
-			}, gen.m_Parameters[i]);
+			}, parameters[i]);
 	}
+}
 
+Statement2 SelectStatementBuilder::Run(const SQLite::Database& db) const
+{
+	param_list_t parameters;
+	const std::string queryStr = GenerateQuery(parameters);
+
+	// The const_cast is "ok" because its just a select statement... right?
+	Statement2 retVal(SQLite::Statement(const_cast<SQLite::Database&>(db), queryStr));
+	BindParameters(retVal, parameters);
 	return retVal;
 }
+
+CachedStatement SelectStatementBuilder::Run(StatementCache& cache) const
+{
+	param_list_t parameters;
+	auto statement = cache.Get(GenerateQuery(parameters));
+	BindParameters(statement.get(), parameters);
+	return statement;
+}
+
+StatementCache::StatementCache(SQLite::Database& db) :
+	m_Database(db)
+{
+}
+
+CachedStatement StatementCache::Get(std::string query)
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		if (auto found = m_FreeStatements.find(query); found != m_FreeStatements.end() && !found->second.empty())
+		{
+			auto statement = std::move(found->second.back());
+			found->second.pop_back();
+			return CachedStatement(*this, std::move(query), std::move(statement));
+		}
+	}
+
+	auto statement = std::make_unique<Statement2>(SQLite::Statement(m_Database, query));
+	return CachedStatement(*this, std::move(query), std::move(statement));
+}
+
+void StatementCache::Return(std::string query, std::unique_ptr<Statement2> statement)
+{
+	std::lock_guard lock(m_Mutex);
+	m_FreeStatements[std::move(query)].push_back(std::move(statement));
+}
+
+CachedStatement::CachedStatement(StatementCache& cache, std::string query, std::unique_ptr<Statement2> statement) :
+	m_Cache(&cache), m_Query(std::move(query)), m_Statement(std::move(statement))
+{
+}
+
+CachedStatement::CachedStatement(CachedStatement&& other) noexcept :
+	m_Cache(other.m_Cache), m_Query(std::move(other.m_Query)), m_Statement(std::move(other.m_Statement))
+{
+}
+
+CachedStatement::~CachedStatement()
+{
+	if (!m_Statement)
+		return;
+
+	try
+	{
+		// A statement whose last step failed is not reused
+		if (m_Statement->tryReset() != SQLITE_OK)
+			return;
+
+		m_Statement->clearBindings();
+		m_Cache->Return(std::move(m_Query), std::move(m_Statement));
+	}
+	catch (...)
+	{
+		LogException();
+	}
+}
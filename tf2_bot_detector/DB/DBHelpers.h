@@ -11,9 +11,12 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string_view>
 #include <optional>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace SQLite
 {
@@ -262,18 +265,79 @@ namespace tf2_bot_detector::DB
 		Column2 getColumn(const ColumnDefinition& definition);
 	};
 
+	class StatementCache;
+
+	// A prepared statement borrowed from a StatementCache. It is reset, has its bindings cleared
+	// and goes back to the cache when this is destroyed.
+	class CachedStatement final
+	{
+	public:
+		CachedStatement(CachedStatement&& other) noexcept;
+		CachedStatement& operator=(CachedStatement&&) = delete;
+		~CachedStatement();
+
+		Statement2& get() { return *m_Statement; }
+		Statement2* operator->() { return m_Statement.get(); }
+
+		bool executeStep() { return m_Statement->executeStep(); }
+		int exec() { return m_Statement->exec(); }
+		Column2 getColumn(const ColumnDefinition& definition) { return m_Statement->getColumn(definition); }
+
+	private:
+		friend class StatementCache;
+		CachedStatement(StatementCache& cache, std::string query, std::unique_ptr<Statement2> statement);
+
+		StatementCache* m_Cache;
+		std::string m_Query;
+		std::unique_ptr<Statement2> m_Statement;
+	};
+
+	// Prepared statements for a single connection, keyed on their SQL text, so running the same
+	// query again skips parsing and planning it. Must be destroyed before the connection.
+	class StatementCache final
+	{
+	public:
+		explicit StatementCache(SQLite::Database& db);
+
+		// Each caller gets its own statement, several threads can have the same query running at once
+		CachedStatement Get(std::string query);
+
+		SQLite::Database& GetDatabase() const { return m_Database; }
+
+	private:
+		friend class CachedStatement;
+		void Return(std::string query, std::unique_ptr<Statement2> statement);
+
+		SQLite::Database& m_Database;
+		std::mutex m_Mutex;
+		std::unordered_map<std::string, std::vector<std::unique_ptr<Statement2>>> m_FreeStatements;
+	};
+
 	class SelectStatementBuilder
 	{
 	public:
-		explicit SelectStatementBuilder(const std::string_view& tableName);
+		// schemaName picks an ATTACHed database to read from, empty for the main one
+		explicit SelectStatementBuilder(const std::string_view& tableName, const std::string_view& schemaName = {});
 
 		SelectStatementBuilder& Where(BinaryOperation&& binOp);
 
+		// ANDed with the Where() condition, if there is one. Each value is its own parameter, so
+		// the generated query (and the statement cached for it) depends on how many there are.
+		SelectStatementBuilder& WhereIn(const ColumnDefinition& column, std::vector<int64_t> values);
+
 		Statement2 Run(const SQLite::Database& db) const;
+		CachedStatement Run(StatementCache& cache) const;
 
 	private:
+		using param_list_t = std::vector<std::variant<int64_t, double, std::string, BlobData>>;
+		std::string GenerateQuery(param_list_t& parameters) const;
+		static void BindParameters(SQLite::Statement& statement, const param_list_t& parameters);
+
 		std::string m_TableName;
+		std::string m_SchemaName;
 		std::optional<BinaryOperation> m_WhereCondition;
+		const ColumnDefinition* m_WhereInColumn = nullptr;
+		std::vector<int64_t> m_WhereInValues;
 	};
 
 	struct ColumnData
@@ -314,4 +378,8 @@ namespace tf2_bot_detector::DB
 	void InsertInto(SQLite::Database& db, const std::string_view& tableName, std::initializer_list<ColumnData> columns,
 		InsertIntoConstraintResolver resolver = InsertIntoConstraintResolver::Abort);
 	void ReplaceInto(SQLite::Database& db, const std::string_view& tableName, std::initializer_list<ColumnData> columns);
+
+	void InsertInto(StatementCache& cache, const std::string_view& tableName, std::initializer_list<ColumnData> columns,
+		InsertIntoConstraintResolver resolver = InsertIntoConstraintResolver::Abort);
+	void ReplaceInto(StatementCache& cache, const std::string_view& tableName, std::initializer_list<ColumnData> columns);
 }
@@ -0,0 +1,275 @@
+#include "RemoteCache.h"
+#include "TempDB.h"
+#include "Networking/HTTPClient.h"
+#include "Networking/HTTPHelpers.h"
+#include "Log.h"
+
+#include <mh/text/format.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+using namespace tf2_bot_detector;
+using namespace tf2_bot_detector::DB;
+
+namespace
+{
+	int64_t ToUnixSeconds(time_point_t time)
+	{
+		return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+	}
+	time_point_t FromUnixSeconds(int64_t seconds)
+	{
+		return time_point_t(std::chrono::seconds(seconds));
+	}
+
+	// The json for each supported info type. The SteamID is the key, so it's not repeated in here.
+	constexpr std::string_view GetTable(const AccountAgeInfo*) { return "account_ages"; }
+	void ToJSON(nlohmann::json& j, const AccountAgeInfo& info)
+	{
+		j = { { "creation_time", ToUnixSeconds(info.m_CreationTime) } };
+	}
+	void FromJSON(const nlohmann::json& j, AccountAgeInfo& info)
+	{
+		info.m_CreationTime = FromUnixSeconds(j.at("creation_time").get<int64_t>());
+	}
+
+	constexpr std::string_view GetTable(const LogsTFCacheInfo*) { return "logs_tf"; }
+	void ToJSON(nlohmann::json& j, const LogsTFCacheInfo& info)
+	{
+		j = { { "updated", ToUnixSeconds(info.m_LastCacheUpdateTime) }, { "logs", info.m_LogsCount } };
+	}
+	void FromJSON(const nlohmann::json& j, LogsTFCacheInfo& info)
+	{
+		info.m_LastCacheUpdateTime = FromUnixSeconds(j.at("updated").get<int64_t>());
+		info.m_LogsCount = j.at("logs").get<uint32_t>();
+	}
+
+	constexpr std::string_view GetTable(const AccountInventorySizeInfo*) { return "inventory_sizes"; }
+	void ToJSON(nlohmann::json& j, const AccountInventorySizeInfo& info)
+	{
+		j = { { "updated", ToUnixSeconds(info.m_LastCacheUpdateTime) }, { "items", info.m_Items }, { "slots", info.m_Slots } };
+	}
+	void FromJSON(const nlohmann::json& j, AccountInventorySizeInfo& info)
+	{
+		info.m_LastCacheUpdateTime = FromUnixSeconds(j.at("updated").get<int64_t>());
+		info.m_Items = j.at("items").get<uint32_t>();
+		info.m_Slots = j.at("slots").get<uint32_t>();
+	}
+
+	template<typename TInfo>
+	std::optional<time_point_t> GetUpdateTime(const TInfo& info)
+	{
+		if constexpr (std::is_base_of_v<detail::BaseCacheInfo_Expiration, TInfo>)
+			return info.m_LastCacheUpdateTime;
+		else
+			return std::nullopt;
+	}
+
+	class RemoteCache final : public IRemoteCache, public std::enable_shared_from_this<RemoteCache>
+	{
+	public:
+		RemoteCache(std::shared_ptr<const IHTTPClient> client, std::string baseURL);
+
+		Stats GetStats() const override;
+		const std::string& GetBaseURL() const override { return m_BaseURL; }
+
+	protected:
+		mh::task<std::optional<std::string>> GetStringAsync(std::string table, SteamID id) const override;
+		void PutString(std::string table, SteamID id, std::string value, std::optional<duration_t> ttl) override;
+
+		bool IsNewerThanRemote(std::string_view table, SteamID id, std::optional<time_point_t> updateTime) const override;
+		void SetRemoteUpdateTime(std::string_view table, SteamID id, std::optional<time_point_t> updateTime) const override;
+
+	private:
+		static std::string GetEntryKey(const std::string_view& table, const SteamID& id);
+		static mh::task<> SendPutAsync(std::weak_ptr<RemoteCache> weakSelf, std::shared_ptr<const IHTTPClient> client,
+			std::string url, std::string value);
+
+		std::shared_ptr<const IHTTPClient> m_Client;
+		std::string m_BaseURL;
+		std::string m_EntryBaseURL;   // m_BaseURL without any trailing slashes
+
+		mutable std::mutex m_Mutex;
+		mutable std::unordered_map<std::string, std::optional<time_point_t>> m_RemoteUpdateTimes;
+		std::vector<mh::task<>> m_PutTasks;
+
+		mutable std::atomic_uint32_t m_Lookups = 0;
+		mutable std::atomic_uint32_t m_Hits = 0;
+		std::atomic_uint32_t m_Puts = 0;
+		mutable std::atomic_uint32_t m_Failures = 0;
+	};
+
+	RemoteCache::RemoteCache(std::shared_ptr<const IHTTPClient> client, std::string baseURL) :
+		m_Client(std::move(client)),
+		m_BaseURL(std::move(baseURL)),
+		m_EntryBaseURL(m_BaseURL)
+	{
+		while (m_EntryBaseURL.ends_with('/'))
+			m_EntryBaseURL.pop_back();
+	}
+
+	std::string RemoteCache::GetEntryKey(const std::string_view& table, const SteamID& id)
+	{
+		return mh::format("{}/{}", table, id.ID64);
+	}
+
+	auto RemoteCache::GetStats() const -> Stats
+	{
+		return Stats
+		{
+			.m_Lookups = m_Lookups,
+			.m_Hits = m_Hits,
+			.m_Puts = m_Puts,
+			.m_Failures = m_Failures,
+		};
+	}
+
+	mh::task<std::optional<std::string>> RemoteCache::GetStringAsync(std::string table, SteamID id) const
+	{
+		auto self = shared_from_this(); // Make sure we don't vanish
+
+		m_Lookups++;
+		try
+		{
+			std::string value = co_await m_Client->GetStringAsync(mh::format("{}/{}", m_EntryBaseURL, GetEntryKey(table, id)),
+				HTTPRequestTag::RemoteCache);
+			m_Hits++;
+			co_return std::move(value);
+		}
+		catch (const http_error& e)
+		{
+			if (e.code() != HTTPResponseCode::NotFound)
+				m_Failures++;
+		}
+		catch (...)
+		{
+			m_Failures++;
+			DebugLogException("Failed to look up {} in the remote cache", GetEntryKey(table, id));
+		}
+
+		co_return std::nullopt;
+	}
+
+	void RemoteCache::PutString(std::string table, SteamID id, std::string value, std::optional<duration_t> ttl)
+	{
+		std::string url = mh::format("{}/{}", m_EntryBaseURL, GetEntryKey(table, id));
+		if (ttl)
+			url += mh::format("?ttl={}", std::chrono::duration_cast<std::chrono::seconds>(*ttl).count());
+
+		std::lock_guard lock(m_Mutex);
+		std::erase_if(m_PutTasks, [](const mh::task<>& task) { return task.is_ready(); });
+		m_PutTasks.push_back(SendPutAsync(weak_from_this(), m_Client, std::move(url), std::move(value)));
+	}
+
+	mh::task<> RemoteCache::SendPutAsync(std::weak_ptr<RemoteCache> weakSelf, std::shared_ptr<const IHTTPClient> client,
+		std::string url, std::string value)
+	{
+		// These live in m_PutTasks, so holding on to the cache in here would keep it around forever
+		// once it's been replaced. Only the stats need it.
+		if (auto self = weakSelf.lock())
+			self->m_Puts++;
+
+		try
+		{
+			co_await client->PutStringAsync(url, HTTPRequestTag::RemoteCache, std::move(value), "application/json");
+		}
+		catch (...)
+		{
+			if (auto self = weakSelf.lock())
+				self->m_Failures++;
+
+			DebugLogException("Failed to write {} to the remote cache", url);
+		}
+	}
+
+	bool RemoteCache::IsNewerThanRemote(std::string_view table, SteamID id, std::optional<time_point_t> updateTime) const
+	{
+		std::lock_guard lock(m_Mutex);
+		auto found = m_RemoteUpdateTimes.find(GetEntryKey(table, id));
+		if (found == m_RemoteUpdateTimes.end())
+			return true;
+
+		return updateTime && (!found->second || *updateTime > *found->second);
+	}
+
+	void RemoteCache::SetRemoteUpdateTime(std::string_view table, SteamID id, std::optional<time_point_t> updateTime) const
+	{
+		std::lock_guard lock(m_Mutex);
+		m_RemoteUpdateTimes.insert_or_assign(GetEntryKey(table, id), updateTime);
+	}
+}
+
+template<typename TInfo>
+mh::task<std::vector<TInfo>> IRemoteCache::GetManyAsync(std::vector<SteamID> ids) const
+{
+	const std::string table(GetTable(static_cast<const TInfo*>(nullptr)));
+
+	// All sent at once, the http client queues them up behind the rate limit
+	std::vector<mh::task<std::optional<std::string>>> requests;
+	requests.reserve(ids.size());
+	for (const SteamID& id : ids)
+		requests.push_back(GetStringAsync(table, id));
+
+	std::vector<TInfo> infos;
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		const std::optional<std::string> value = co_await requests[i];
+		if (!value)
+			continue;
+
+		try
+		{
+			TInfo info{};
+			info.GetSteamID() = ids[i];
+			FromJSON(nlohmann::json::parse(*value), info);
+
+			SetRemoteUpdateTime(table, ids[i], GetUpdateTime(info));
+			infos.push_back(std::move(info));
+		}
+		catch (...)
+		{
+			DebugLogException("Malformed remote cache entry for {}/{}", table, ids[i]);
+		}
+	}
+
+	co_return infos;
+}
+
+template<typename TInfo>
+void IRemoteCache::Put(const TInfo& info)
+{
+	const std::string_view table = GetTable(static_cast<const TInfo*>(nullptr));
+	const auto updateTime = GetUpdateTime(info);
+	if (!IsNewerThanRemote(table, info.GetSteamID(), updateTime))
+		return;
+
+	std::optional<duration_t> ttl;
+	if constexpr (std::is_base_of_v<detail::BaseCacheInfo_Expiration, TInfo>)
+	{
+		ttl = info.GetCacheLiveTime() - (tfbd_clock_t::now() - info.m_LastCacheUpdateTime);
+		if (*ttl <= duration_t::zero())
+			return; // Already expired, nobody wants this
+	}
+
+	nlohmann::json j;
+	ToJSON(j, info);
+
+	SetRemoteUpdateTime(table, info.GetSteamID(), updateTime);
+	PutString(std::string(table), info.GetSteamID(), j.dump(), ttl);
+}
+
+template mh::task<std::vector<AccountAgeInfo>> IRemoteCache::GetManyAsync<AccountAgeInfo>(std::vector<SteamID>) const;
+template mh::task<std::vector<LogsTFCacheInfo>> IRemoteCache::GetManyAsync<LogsTFCacheInfo>(std::vector<SteamID>) const;
+template mh::task<std::vector<AccountInventorySizeInfo>> IRemoteCache::GetManyAsync<AccountInventorySizeInfo>(std::vector<SteamID>) const;
+template void IRemoteCache::Put<AccountAgeInfo>(const AccountAgeInfo&);
+template void IRemoteCache::Put<LogsTFCacheInfo>(const LogsTFCacheInfo&);
+template void IRemoteCache::Put<AccountInventorySizeInfo>(const AccountInventorySizeInfo&);
+
+std::shared_ptr<IRemoteCache> IRemoteCache::Create(std::shared_ptr<const IHTTPClient> client, std::string baseURL)
+{
+	return std::make_shared<RemoteCache>(std::move(client), std::move(baseURL));
+}
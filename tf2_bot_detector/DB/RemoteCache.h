@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Clock.h"
+#include "SteamID.h"
+
+#include <mh/coroutine/task.hpp>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	class IHTTPClient;
+}
+
+namespace tf2_bot_detector::DB
+{
+	// A key-value store shared between installs, layered behind the local temp db so a lookup one
+	// install has already done is a hit for all the others. Entries are json, keyed by table and
+	// SteamID, and expire on their own once their GetCacheLiveTime() is up. Nothing here is trusted
+	// over the local db, it's only asked for what's missing (or expired) locally.
+	class IRemoteCache
+	{
+	public:
+		virtual ~IRemoteCache() = default;
+
+		// A plain HTTP key-value service, something like webdis or a small nginx/redis frontend:
+		//   GET {baseURL}/{table}/{steamid64}                 200 with the json body, 404 if missing
+		//   PUT {baseURL}/{table}/{steamid64}?ttl={seconds}   ttl is left off for entries that never expire
+		static std::shared_ptr<IRemoteCache> Create(std::shared_ptr<const IHTTPClient> client, std::string baseURL);
+
+		// Only for AccountAgeInfo, LogsTFCacheInfo and AccountInventorySizeInfo, the ones that are the
+		// same no matter who's asking, and expensive to look up. Accounts that couldn't be found (or
+		// couldn't be reached) are left out. Resumes on whatever thread the last response came in on.
+		template<typename TInfo> mh::task<std::vector<TInfo>> GetManyAsync(std::vector<SteamID> ids) const;
+
+		// Sent in the background, failures are only logged. Skipped if the remote cache already has
+		// this entry (or a newer one), as far as we know.
+		template<typename TInfo> void Put(const TInfo& info);
+
+		struct Stats
+		{
+			uint32_t m_Lookups;
+			uint32_t m_Hits;
+			uint32_t m_Puts;
+			uint32_t m_Failures;   // Lookups and puts together, misses don't count
+		};
+		virtual Stats GetStats() const = 0;
+
+		virtual const std::string& GetBaseURL() const = 0;
+
+	protected:
+		// Empty if it's not there
+		virtual mh::task<std::optional<std::string>> GetStringAsync(std::string table, SteamID id) const = 0;
+		virtual void PutString(std::string table, SteamID id, std::string value, std::optional<duration_t> ttl) = 0;
+
+		// Whether a Put() of an entry last updated at updateTime would tell the remote cache anything
+		// new, going by what's been read from and written to it this session. nullopt is for entries
+		// that never change once they exist.
+		virtual bool IsNewerThanRemote(std::string_view table, SteamID id, std::optional<time_point_t> updateTime) const = 0;
+		virtual void SetRemoteUpdateTime(std::string_view table, SteamID id, std::optional<time_point_t> updateTime) const = 0;
+	};
+}
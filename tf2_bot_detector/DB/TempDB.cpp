@@ -4,6 +4,7 @@
 #include "DBHelpers.h"
 #include "Filesystem.h"
 #include "SteamID.h"
+#include "Util/TaskScheduler.h"
 
 #include <mh/error/ensure.hpp>
 #include <mh/concurrency/thread_sentinel.hpp>
@@ -11,33 +12,238 @@
 #include <sqlite3.h>
 #include <SQLiteCpp/SQLiteCpp.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 using namespace tf2_bot_detector;
 using namespace tf2_bot_detector::DB;
 
 namespace
 {
+	// Query counts and latencies for a single table, shown in the profiler window
+	class QueryStatsCounters final
+	{
+	public:
+		static constexpr size_t LATENCY_BUCKET_COUNT = 24; // Bucket n holds latencies in [2^n, 2^(n+1)) us
+
+		void AddRead(std::chrono::microseconds latency, size_t rows) { m_Reads++; m_RowsRead += rows; AddLatency(latency); }
+		void AddWrite(std::chrono::microseconds latency) { m_Writes++; AddLatency(latency); }
+
+		uint32_t GetWrites() const { return m_Writes; }
+		std::chrono::microseconds GetLatencyPercentile(float percentile) const;
+		ITempDB::TableStats GetStats(std::string table) const;
+
+	private:
+		void AddLatency(std::chrono::microseconds latency);
+
+		std::atomic_uint32_t m_Reads = 0;
+		std::atomic_uint32_t m_Writes = 0;
+		std::atomic_uint64_t m_RowsRead = 0;
+		std::array<std::atomic_uint32_t, LATENCY_BUCKET_COUNT> m_LatencyHistogram{};
+	};
+
+	// Records the time until it goes out of scope, as a read of m_Rows rows or as a write
+	class ScopedQueryTimer final
+	{
+	public:
+		ScopedQueryTimer(QueryStatsCounters& counters, bool isWrite) :
+			m_Counters(counters), m_IsWrite(isWrite), m_StartTime(std::chrono::steady_clock::now())
+		{
+		}
+		ScopedQueryTimer(const ScopedQueryTimer&) = delete;
+		~ScopedQueryTimer()
+		{
+			const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - m_StartTime);
+
+			if (m_IsWrite)
+				m_Counters.AddWrite(latency);
+			else
+				m_Counters.AddRead(latency, m_Rows);
+		}
+
+		size_t m_Rows = 0;
+
+	private:
+		QueryStatsCounters& m_Counters;
+		bool m_IsWrite;
+		std::chrono::steady_clock::time_point m_StartTime;
+	};
+
 	class TempDB final : public ITempDB
 	{
 	public:
 		TempDB();
+		~TempDB();
+
+		void Store(const AccountAgeInfo& info) override { QueueStore(info); }
+		bool TryGet(AccountAgeInfo& info) const override { return TryGetPendingOrStored(info); }
+		void GetAccountAgeInfos(std::vector<AccountAgeInfo>& infos) const override;
+
+		void Store(const LogsTFCacheInfo& info) override { QueueStore(info); }
+		bool TryGet(LogsTFCacheInfo& info) const override { return TryGetPendingOrStored(info); }
+		void TryGetMany(std::span<const SteamID> ids, std::vector<LogsTFCacheInfo>& infos) const override;
+
+		void Store(const AccountInventorySizeInfo& info) override { QueueStore(info); }
+		bool TryGet(AccountInventorySizeInfo& info) const override { return TryGetPendingOrStored(info); }
+		void TryGetMany(std::span<const SteamID> ids, std::vector<AccountInventorySizeInfo>& infos) const override;
+
+		void Store(const PlayerSummaryCacheInfo& info) override { QueueStore(info); }
+		bool TryGet(PlayerSummaryCacheInfo& info) const override { return TryGetPendingOrStored(info); }
+		void TryGetMany(std::span<const SteamID> ids, std::vector<PlayerSummaryCacheInfo>& infos) const override;
+
+		void Store(const PlayerBansCacheInfo& info) override { QueueStore(info); }
+		bool TryGet(PlayerBansCacheInfo& info) const override { return TryGetPendingOrStored(info); }
+		void TryGetMany(std::span<const SteamID> ids, std::vector<PlayerBansCacheInfo>& infos) const override;
 
-		void Store(const AccountAgeInfo& info) override;
-		bool TryGet(AccountAgeInfo& info) const override;
-		void GetNearestAccountAgeInfos(SteamID id, std::optional<AccountAgeInfo>& lower, std::optional<AccountAgeInfo>& upper) const override;
+		void Store(const FailedLookupCacheInfo& info) override { QueueStore(info); }
+		bool TryGet(FailedLookupCacheInfo& info) const override { return TryGetPendingOrStored(info); }
 
-		void Store(const LogsTFCacheInfo& info) override;
-		bool TryGet(LogsTFCacheInfo& info) const override;
+		void SetMaintenanceOptions(bool idle, uint64_t maxSizeBytes) override;
 
-		void Store(const AccountInventorySizeInfo& info) override;
-		bool TryGet(AccountInventorySizeInfo& info) const override;
+		Stats GetStats() const override;
+
+		void ExportSnapshot(const std::filesystem::path& path) const override;
+		void SetSnapshotPath(const std::filesystem::path& path) override;
+		void SetRemoteCache(const std::string& baseURL, std::shared_ptr<const IHTTPClient> client) override;
+
+	protected:
+		mh::task<> ResumeOnDBThread() const override;
+		void RecordCacheLookup(bool hit) const override;
+		std::shared_ptr<IRemoteCache> GetRemoteCache() const override;
 
 	private:
 		static constexpr size_t DB_VERSION = 4;
 		void Connect();
 
+		std::string m_DBPath;
 		std::optional<SQLite::Database> m_Connection;
+		mutable std::optional<StatementCache> m_StatementCache; // After m_Connection, so it's destroyed first
+
+		void WriteToDB(const AccountAgeInfo& info);
+		void WriteToDB(const LogsTFCacheInfo& info);
+		void WriteToDB(const AccountInventorySizeInfo& info);
+		void WriteToDB(const PlayerSummaryCacheInfo& info);
+		void WriteToDB(const PlayerBansCacheInfo& info);
+		void WriteToDB(const FailedLookupCacheInfo& info);
+
+		bool ReadFromDB(AccountAgeInfo& info) const;
+		bool ReadFromDB(LogsTFCacheInfo& info) const;
+		bool ReadFromDB(AccountInventorySizeInfo& info) const;
+		bool ReadFromDB(PlayerSummaryCacheInfo& info) const;
+		bool ReadFromDB(PlayerBansCacheInfo& info) const;
+		bool ReadFromDB(FailedLookupCacheInfo& info) const;
+
+		// Reads fall back to another install's exported snapshot, ATTACHed under SNAPSHOT_SCHEMA,
+		// for whatever is missing (or expired) in ours. It's only ever attached or detached by
+		// m_WriteThread, never written to.
+		static constexpr const char* MAIN_SCHEMA = "main";
+		static constexpr const char* SNAPSHOT_SCHEMA = "snapshot";
+		template<typename TInfo, typename TTable> bool ReadFromSchemas(const TTable& table, TInfo& info) const;
+		template<typename TInfo, typename TTable>
+		void ReadManyFromSchema(const TTable& table, const char* schema, std::span<const int64_t> accountIDs,
+			std::vector<TInfo>& infos) const;
+
+		void AttachSnapshot(const std::filesystem::path& path);
+		void WriteSnapshot(const std::filesystem::path& path);
+
+		// ExportSnapshot() hands these to m_WriteThread, the only thing that uses the connection
+		// outside of a read, so VACUUM INTO never lands in the middle of a write batch's transaction
+		struct SnapshotExport
+		{
+			std::filesystem::path m_Path;
+			std::promise<void> m_Done;
+		};
+		mutable std::vector<SnapshotExport> m_PendingExports; // Guarded by m_PendingMutex
+		std::filesystem::path m_SnapshotPath;           // Guarded by m_PendingMutex
+		std::filesystem::path m_AttachedSnapshotPath;   // m_WriteThread only
+		std::atomic_bool m_SnapshotAttached = false;
+
+		mutable std::mutex m_RemoteCacheMutex;
+		std::shared_ptr<IRemoteCache> m_RemoteCache;
+
+		// One entry per table, all added by the constructor, so it can be read without a lock
+		mutable std::map<std::string, QueryStatsCounters, std::less<>> m_QueryStats;
+		QueryStatsCounters& GetQueryStats(const TableDefinition& table) const
+		{
+			return m_QueryStats.find(table.GetTableName())->second;
+		}
+		QueryStatsCounters m_CommitStats;
+		mutable std::atomic_uint32_t m_PendingHitCount = 0;
+		mutable std::atomic_uint32_t m_CacheLookupCount = 0;
+		mutable std::atomic_uint32_t m_CacheHitCount = 0;
+
+		// Stores are written behind by m_WriteThread, a batch at a time in a single transaction,
+		// so filling a server with players doesn't cost a commit (and fsync) per row. Reads check
+		// what hasn't been written yet first.
+		static constexpr auto WRITE_INTERVAL = std::chrono::milliseconds(500);
+		static constexpr size_t WRITE_BATCH_SIZE = 64;
+
+		template<typename... TInfos>
+		struct PendingStoresT
+		{
+			template<typename TInfo>
+			using map_type = std::unordered_map<uint64_t, TInfo>;
+
+			template<typename TInfo> map_type<TInfo>& Get() { return std::get<map_type<TInfo>>(m_Maps); }
+			template<typename TInfo> const map_type<TInfo>& Get() const { return std::get<map_type<TInfo>>(m_Maps); }
+
+			std::tuple<map_type<TInfos>...> m_Maps;
+		};
+		using PendingStores = PendingStoresT<AccountAgeInfo, LogsTFCacheInfo, AccountInventorySizeInfo,
+			PlayerSummaryCacheInfo, PlayerBansCacheInfo, FailedLookupCacheInfo>;
+
+		static uint64_t GetPendingKey(const detail::ICacheInfo& info) { return info.GetSteamID().ID64; }
+		static uint64_t GetPendingKey(const FailedLookupCacheInfo& info)
+		{
+			return (uint64_t(info.m_LookupType) << 32) | info.GetSteamID().GetAccountID();
+		}
+
+		template<typename TInfo> void QueueStore(const TInfo& info);
+		template<typename TInfo> bool TryGetPendingOrStored(TInfo& info) const;
+		template<typename TInfo, typename TTable>
+		void TryGetManyPendingOrStored(const TTable& table, std::span<const SteamID> ids, std::vector<TInfo>& infos) const;
+
+		// Upper bound on the parameters in a single IN (...) list. Lists are padded out to a power
+		// of two, so only a handful of distinct statements end up in the statement cache.
+		static constexpr size_t MAX_IN_LIST_SIZE = 128;
+
+		void WriteThreadFunc();
+		void WritePending(PendingStores& pending);
+
+		// Expiry sweeps, the size cap, incremental vacuum and a WAL checkpoint. Run by m_WriteThread
+		// while the app says it's idle, once nothing has been stored for a while.
+		static constexpr auto MAINTENANCE_INTERVAL = std::chrono::minutes(30);
+		static constexpr auto MAINTENANCE_QUIET_TIME = std::chrono::seconds(30);
+		bool IsMaintenanceDue(time_point_t now) const;
+		void RunMaintenance();
+		uint64_t GetUsedSizeBytes();
+		std::atomic_bool m_MaintenanceAllowed = false;
+		std::atomic_uint64_t m_MaxSizeBytes = 0;
+		time_point_t m_LastStoreTime{};             // Guarded by m_PendingMutex
+		time_point_t m_LastMaintenanceTime{};       // m_WriteThread only
+
+		mutable std::mutex m_PendingMutex;
+		mutable std::condition_variable m_PendingCV;
+		PendingStores m_Pending;      // Queued since the last write
+		PendingStores m_Writing;      // Being written right now
+		size_t m_PendingCount = 0;
+		bool m_StopWriteThread = false;
+		std::thread m_WriteThread;
 	};
 
 	static std::string CreateDBPath()
@@ -86,7 +292,72 @@ namespace
 
 	} static const s_TableInventorySize;
 
-	TempDB::TempDB() try
+	struct TABLE_PLAYER_SUMMARIES final : BASETABLE_EXPIRABLE
+	{
+		TABLE_PLAYER_SUMMARIES() : BASETABLE_EXPIRABLE("TABLE_PLAYER_SUMMARIES") {}
+
+		const ColumnDefinition COL_REAL_NAME = Column("RealName", ColumnType::Text, ColumnFlags::NotNull);
+		const ColumnDefinition COL_NICKNAME = Column("Nickname", ColumnType::Text, ColumnFlags::NotNull);
+		const ColumnDefinition COL_AVATAR_HASH = Column("AvatarHash", ColumnType::Text, ColumnFlags::NotNull);
+		const ColumnDefinition COL_PROFILE_URL = Column("ProfileURL", ColumnType::Text, ColumnFlags::NotNull);
+		const ColumnDefinition COL_STATUS = Column("Status", ColumnType::Integer, ColumnFlags::NotNull);
+		const ColumnDefinition COL_VISIBILITY = Column("Visibility", ColumnType::Integer, ColumnFlags::NotNull);
+		const ColumnDefinition COL_PROFILE_CONFIGURED = Column("ProfileConfigured", ColumnType::Integer, ColumnFlags::NotNull);
+		const ColumnDefinition COL_COMMENT_PERMISSIONS = Column("CommentPermissions", ColumnType::Integer, ColumnFlags::NotNull);
+		const ColumnDefinition COL_CREATION_TIME = Column("CreationTime", ColumnType::Integer);
+		const ColumnDefinition COL_LAST_LOG_OFF = Column("LastLogOff", ColumnType::Integer);
+
+	} static const s_TablePlayerSummaries;
+
+	struct TABLE_PLAYER_BANS final : BASETABLE_EXPIRABLE
+	{
+		TABLE_PLAYER_BANS() : BASETABLE_EXPIRABLE("TABLE_PLAYER_BANS") {}
+
+		const ColumnDefinition COL_COMMUNITY_BANNED = Column("CommunityBanned", ColumnType::Integer, ColumnFlags::NotNull);
+		const ColumnDefinition COL_ECONOMY_BAN = Column("EconomyBan", ColumnType::Integer, ColumnFlags::NotNull);
+		const ColumnDefinition COL_VAC_BAN_COUNT = Column("VACBanCount", ColumnType::Integer, ColumnFlags::NotNull);
+		const ColumnDefinition COL_GAME_BAN_COUNT = Column("GameBanCount", ColumnType::Integer, ColumnFlags::NotNull);
+		const ColumnDefinition COL_TIME_SINCE_LAST_BAN = Column("TimeSinceLastBan", ColumnType::Integer, ColumnFlags::NotNull);
+
+	} static const s_TablePlayerBans;
+
+	struct TABLE_FAILED_LOOKUPS final : BASETABLE_EXPIRABLE
+	{
+		TABLE_FAILED_LOOKUPS(std::string tableName) : BASETABLE_EXPIRABLE(std::move(tableName)) {}
+
+		const ColumnDefinition COL_ERROR_CODE = Column("ErrorCode", ColumnType::Integer, ColumnFlags::NotNull);
+	};
+
+	// One table per lookup type, since tables only get a single primary key column
+	static const TABLE_FAILED_LOOKUPS s_TableFailedInventoryLookups("TABLE_FAILED_INVENTORY_LOOKUPS");
+	static const TABLE_FAILED_LOOKUPS s_TableFailedPlaytimeLookups("TABLE_FAILED_PLAYTIME_LOOKUPS");
+
+	static const TABLE_FAILED_LOOKUPS& GetFailedLookupsTable(FailedLookupType type)
+	{
+		switch (type)
+		{
+		case FailedLookupType::InventoryInfo:
+			return s_TableFailedInventoryLookups;
+		case FailedLookupType::TF2Playtime:
+			return s_TableFailedPlaytimeLookups;
+		}
+
+		throw std::invalid_argument(mh::format("Unknown FailedLookupType {}", int(type)));
+	}
+
+	static const TableDefinition* const s_AllTables[] =
+	{
+		&s_TableAccountAges,
+		&s_TableLogsTFCache,
+		&s_TableInventorySize,
+		&s_TablePlayerSummaries,
+		&s_TablePlayerBans,
+		&s_TableFailedInventoryLookups,
+		&s_TableFailedPlaytimeLookups,
+	};
+
+	TempDB::TempDB() try :
+		m_DBPath(CreateDBPath())
 	{
 		Connect();
 
@@ -103,15 +374,410 @@ namespace
 
 		m_Connection->exec("PRAGMA journal_mode = WAL;");
 
-		CreateTable(m_Connection.value(), s_TableAccountAges, CreateTableFlags::IfNotExists);
-		CreateTable(m_Connection.value(), s_TableLogsTFCache, CreateTableFlags::IfNotExists);
-		CreateTable(m_Connection.value(), s_TableInventorySize, CreateTableFlags::IfNotExists);
+		for (const TableDefinition* table : s_AllTables)
+		{
+			CreateTable(m_Connection.value(), *table, CreateTableFlags::IfNotExists);
+			m_QueryStats.try_emplace(table->GetTableName());
+		}
+
+		m_StatementCache.emplace(m_Connection.value());
+		m_WriteThread = std::thread(&TempDB::WriteThreadFunc, this);
 	}
 	catch (...)
 	{
 		LogException();
 		throw;
 	}
+
+	TempDB::~TempDB()
+	{
+		// The DB lane is a single thread, so every async read that got there before us is done
+		// by the time we get our turn
+		[](const TempDB& db) -> mh::task<> { co_await db.ResumeOnDBThread(); }(*this).wait();
+
+		{
+			std::lock_guard lock(m_PendingMutex);
+			m_StopWriteThread = true;
+		}
+
+		m_PendingCV.notify_one();
+		m_WriteThread.join();
+	}
+
+	template<typename TInfo>
+	void TempDB::QueueStore(const TInfo& info)
+	{
+		size_t pendingCount;
+		{
+			std::lock_guard lock(m_PendingMutex);
+			m_Pending.Get<TInfo>().insert_or_assign(GetPendingKey(info), info);
+			pendingCount = ++m_PendingCount;
+			m_LastStoreTime = tfbd_clock_t::now();
+		}
+
+		if (pendingCount >= WRITE_BATCH_SIZE)
+			m_PendingCV.notify_one();
+
+		if constexpr (IS_REMOTE_CACHED<TInfo>)
+		{
+			if (auto remote = GetRemoteCache())
+				remote->Put(info);
+		}
+	}
+
+	template<typename TInfo>
+	bool TempDB::TryGetPendingOrStored(TInfo& info) const
+	{
+		{
+			std::lock_guard lock(m_PendingMutex);
+			const auto key = GetPendingKey(info);
+			for (const PendingStores* pending : { &m_Pending, &m_Writing })
+			{
+				const auto& map = pending->Get<TInfo>();
+				if (auto found = map.find(key); found != map.end())
+				{
+					info = found->second;
+					m_PendingHitCount++;
+					return true;
+				}
+			}
+		}
+
+		return ReadFromDB(info);
+	}
+
+	void TempDB::WriteThreadFunc()
+	{
+		std::unique_lock lock(m_PendingMutex);
+		while (true)
+		{
+			m_PendingCV.wait_for(lock, WRITE_INTERVAL,
+				[&] { return m_StopWriteThread || m_PendingCount >= WRITE_BATCH_SIZE || !m_PendingExports.empty(); });
+
+			if (m_PendingCount > 0)
+			{
+				m_Writing = std::move(m_Pending);
+				m_Pending = {};
+				m_PendingCount = 0;
+
+				lock.unlock();
+				WritePending(m_Writing);
+				lock.lock();
+
+				m_Writing = {};
+			}
+
+			// After the write above, so everything stored before the export was asked for is in it
+			if (!m_PendingExports.empty())
+			{
+				auto exports = std::exchange(m_PendingExports, {});
+
+				lock.unlock();
+				for (SnapshotExport& snapshotExport : exports)
+				{
+					try
+					{
+						WriteSnapshot(snapshotExport.m_Path);
+						snapshotExport.m_Done.set_value();
+					}
+					catch (...)
+					{
+						snapshotExport.m_Done.set_exception(std::current_exception());
+					}
+				}
+				lock.lock();
+			}
+
+			if (m_StopWriteThread)
+				break;
+
+			if (m_SnapshotPath != m_AttachedSnapshotPath)
+			{
+				const auto snapshotPath = m_SnapshotPath;
+
+				lock.unlock();
+				AttachSnapshot(snapshotPath);
+				lock.lock();
+			}
+
+			if (const auto now = tfbd_clock_t::now(); IsMaintenanceDue(now))
+			{
+				m_LastMaintenanceTime = now;
+
+				lock.unlock();
+				RunMaintenance();
+				lock.lock();
+			}
+		}
+	}
+
+	// m_PendingMutex is held
+	bool TempDB::IsMaintenanceDue(time_point_t now) const
+	{
+		return m_MaintenanceAllowed &&
+			m_PendingCount == 0 &&
+			(now - m_LastStoreTime) >= MAINTENANCE_QUIET_TIME &&
+			(now - m_LastMaintenanceTime) >= MAINTENANCE_INTERVAL;
+	}
+
+	mh::task<> TempDB::ResumeOnDBThread() const
+	{
+		co_await TaskScheduler::Get().co_schedule(TaskLane::DB);
+	}
+
+	void TempDB::SetMaintenanceOptions(bool idle, uint64_t maxSizeBytes)
+	{
+		m_MaintenanceAllowed = idle;
+		m_MaxSizeBytes = maxSizeBytes;
+	}
+
+	void TempDB::SetSnapshotPath(const std::filesystem::path& path)
+	{
+		std::lock_guard lock(m_PendingMutex);
+		m_SnapshotPath = path;
+	}
+
+	void TempDB::SetRemoteCache(const std::string& baseURL, std::shared_ptr<const IHTTPClient> client)
+	{
+		std::lock_guard lock(m_RemoteCacheMutex);
+		if (baseURL.empty() || !client)
+		{
+			m_RemoteCache.reset();
+			return;
+		}
+
+		if (m_RemoteCache && m_RemoteCache->GetBaseURL() == baseURL)
+			return;
+
+		DebugLog("Using remote cache {}", baseURL);
+		m_RemoteCache = IRemoteCache::Create(std::move(client), baseURL);
+	}
+
+	std::shared_ptr<IRemoteCache> TempDB::GetRemoteCache() const
+	{
+		std::lock_guard lock(m_RemoteCacheMutex);
+		return m_RemoteCache;
+	}
+
+	void TempDB::ExportSnapshot(const std::filesystem::path& path) const
+	{
+		std::future<void> done;
+		{
+			std::lock_guard lock(m_PendingMutex);
+			if (m_StopWriteThread)
+				throw std::runtime_error("The temp db is shutting down");
+
+			done = m_PendingExports.emplace_back(SnapshotExport{ path }).m_Done.get_future();
+		}
+
+		m_PendingCV.notify_one();
+		done.get();
+	}
+
+	// Only called by m_WriteThread
+	void TempDB::WriteSnapshot(const std::filesystem::path& path)
+	{
+		// VACUUM INTO refuses to overwrite anything, and this way a failed export doesn't leave a
+		// half written snapshot behind
+		auto tempPath = path;
+		tempPath += ".tmp";
+		std::filesystem::remove(tempPath);
+
+		{
+			SQLite::Statement vacuum(m_Connection.value(), "VACUUM main INTO ?1");
+			vacuum.bind(1, tempPath.string());
+			vacuum.exec();
+		}
+
+		std::filesystem::rename(tempPath, path);
+		Log("Exported temp db snapshot to {} ({} KiB)", path, std::filesystem::file_size(path) / 1024);
+	}
+
+	// Read only, and immutable so sqlite doesn't bother locking it (or looking for a WAL), which
+	// also means it can live somewhere we can't write to, like a network share
+	static std::string CreateReadOnlyURI(const std::filesystem::path& path)
+	{
+		const auto pathStr = std::filesystem::absolute(path).generic_u8string();
+
+		std::string uri = "file:";
+		if (!pathStr.starts_with(u8'/'))
+			uri += "///"; // Windows drive letters
+
+		for (const char8_t c : pathStr)
+		{
+			if ((c >= u8'a' && c <= u8'z') || (c >= u8'A' && c <= u8'Z') || (c >= u8'0' && c <= u8'9') ||
+				c == u8'/' || c == u8':' || c == u8'-' || c == u8'_' || c == u8'.' || c == u8'~')
+			{
+				uri += char(c);
+			}
+			else
+			{
+				mh::format_to(std::back_inserter(uri), "%{:02X}", unsigned(uint8_t(c)));
+			}
+		}
+
+		uri += "?mode=ro&immutable=1";
+		return uri;
+	}
+
+	// Only called by m_WriteThread
+	void TempDB::AttachSnapshot(const std::filesystem::path& path) try
+	{
+		if (m_SnapshotAttached.exchange(false))
+		{
+			try
+			{
+				m_Connection->exec(mh::format(R"SQL(DETACH DATABASE "{}")SQL", SNAPSHOT_SCHEMA));
+			}
+			catch (...)
+			{
+				// Probably a read in progress, try again next time around
+				m_SnapshotAttached = true;
+				throw;
+			}
+
+			Log("Detached temp db snapshot");
+		}
+
+		m_AttachedSnapshotPath = path;
+
+		if (path.empty())
+			return;
+
+		if (!std::filesystem::exists(path))
+		{
+			LogWarning("Temp db snapshot {} doesn't exist", path);
+			return;
+		}
+
+		{
+			SQLite::Statement attach(m_Connection.value(), mh::format(R"SQL(ATTACH DATABASE ?1 AS "{}")SQL", SNAPSHOT_SCHEMA));
+			attach.bind(1, CreateReadOnlyURI(path));
+			attach.exec();
+		}
+
+		// Tables from other versions don't line up with ours
+		if (const auto version = m_Connection->execAndGet(mh::format("PRAGMA {}.user_version", SNAPSHOT_SCHEMA)).getInt();
+			version != DB_VERSION)
+		{
+			LogWarning("Temp db snapshot {} is version {}, expected {}. Ignoring it.", path, version, DB_VERSION);
+			m_Connection->exec(mh::format(R"SQL(DETACH DATABASE "{}")SQL", SNAPSHOT_SCHEMA));
+			return;
+		}
+
+		m_SnapshotAttached = true;
+		Log("Attached temp db snapshot {}", path);
+	}
+	catch (...)
+	{
+		LogException("Failed to attach temp db snapshot {}", path);
+	}
+
+	void TempDB::RecordCacheLookup(bool hit) const
+	{
+		m_CacheLookupCount++;
+		if (hit)
+			m_CacheHitCount++;
+	}
+
+	static uint64_t GetFileSizeOrZero(const std::filesystem::path& path)
+	{
+		std::error_code ec;
+		const auto size = std::filesystem::file_size(path, ec);
+		return ec ? 0 : uint64_t(size);
+	}
+
+	ITempDB::Stats TempDB::GetStats() const
+	{
+		Stats stats{};
+
+		for (const auto& [table, counters] : m_QueryStats)
+			stats.m_Tables.push_back(counters.GetStats(table));
+
+		stats.m_Commits = m_CommitStats.GetWrites();
+		stats.m_CommitLatencyP99 = m_CommitStats.GetLatencyPercentile(0.99f);
+		stats.m_PendingHits = m_PendingHitCount;
+		stats.m_CacheLookups = m_CacheLookupCount;
+		stats.m_CacheHits = m_CacheHitCount;
+		stats.m_DBFileSize = GetFileSizeOrZero(m_DBPath);
+		stats.m_WALFileSize = GetFileSizeOrZero(m_DBPath + "-wal");
+
+		if (auto remote = GetRemoteCache())
+			stats.m_RemoteCache = remote->GetStats();
+
+		return stats;
+	}
+
+	void QueryStatsCounters::AddLatency(std::chrono::microseconds latency)
+	{
+		const auto us = uint64_t(std::max<int64_t>(latency.count(), 0));
+		m_LatencyHistogram[std::min<size_t>(us ? std::bit_width(us) - 1 : 0, LATENCY_BUCKET_COUNT - 1)]++;
+	}
+
+	std::chrono::microseconds QueryStatsCounters::GetLatencyPercentile(float percentile) const
+	{
+		std::array<uint32_t, LATENCY_BUCKET_COUNT> histogram;
+		uint32_t total = 0;
+		for (size_t i = 0; i < histogram.size(); i++)
+			total += (histogram[i] = m_LatencyHistogram[i].load(std::memory_order_relaxed));
+
+		const auto target = uint32_t(total * percentile);
+		uint32_t seen = 0;
+		for (size_t i = 0; i < histogram.size(); i++)
+		{
+			seen += histogram[i];
+			if (seen > target)
+				return std::chrono::microseconds(uint64_t(1) << (i + 1));
+		}
+
+		return {};
+	}
+
+	ITempDB::TableStats QueryStatsCounters::GetStats(std::string table) const
+	{
+		return ITempDB::TableStats
+		{
+			.m_Table = std::move(table),
+			.m_Reads = m_Reads,
+			.m_Writes = m_Writes,
+			.m_RowsRead = m_RowsRead,
+			.m_LatencyP50 = GetLatencyPercentile(0.5f),
+			.m_LatencyP99 = GetLatencyPercentile(0.99f),
+		};
+	}
+
+	// m_PendingMutex is not held, m_Writing is only replaced by this thread
+	void TempDB::WritePending(PendingStores& pending) try
+	{
+		SQLite::Transaction transaction(m_Connection.value());
+
+		std::apply([&](const auto&... maps)
+			{
+				const auto WriteAll = [&](const auto& map)
+				{
+					for (const auto& [key, info] : map)
+					{
+						try
+						{
+							WriteToDB(info);
+						}
+						catch (...)
+						{
+							// Already logged, don't lose the rest of the batch over it
+						}
+					}
+				};
+
+				(WriteAll(maps), ...);
+			}, pending.m_Maps);
+
+		ScopedQueryTimer timer(m_CommitStats, true);
+		transaction.commit();
+	}
+	catch (...)
+	{
+		LogException("Failed to write pending temp db stores");
+	}
 }
 
 namespace tf2_bot_detector::DB
@@ -142,13 +808,47 @@ namespace tf2_bot_detector::DB
 			return SteamID(column.getUInt(), SteamAccountType::Individual);
 		}
 	};
+
+	template<>
+	struct ColumnDataSerializer<duration_t>
+	{
+		static int64_t Serialize(duration_t duration)
+		{
+			return std::chrono::duration_cast<std::chrono::seconds>(duration).count();
+		}
+		static duration_t Deserialize(const SQLite::Column& column)
+		{
+			return std::chrono::seconds(column.getInt64());
+		}
+	};
+}
+
+namespace
+{
+	ColumnData OptionalColumnData(const ColumnDefinition& column, const std::optional<time_point_t>& time)
+	{
+		if (time)
+			return ColumnData(column, *time);
+		else
+			return ColumnData(column, nullptr);
+	}
+
+	std::optional<time_point_t> GetOptionalTime(CachedStatement& query, const ColumnDefinition& column)
+	{
+		auto value = query.getColumn(column);
+		if (value.isNull())
+			return std::nullopt;
+
+		return time_point_t(value);
+	}
 }
 
 namespace
 {
-	void TempDB::Store(const AccountAgeInfo& info) try
+	void TempDB::WriteToDB(const AccountAgeInfo& info) try
 	{
-		ReplaceInto(m_Connection.value(), s_TableAccountAges.GetTableName(),
+		ScopedQueryTimer timer(GetQueryStats(s_TableAccountAges), true);
+		ReplaceInto(*m_StatementCache, s_TableAccountAges.GetTableName(),
 			{
 				{ s_TableAccountAges.COL_ACCOUNT_ID, info.m_SteamID },
 				{ s_TableAccountAges.COL_CREATION_TIME, info.m_CreationTime },
@@ -160,78 +860,55 @@ namespace
 		throw;
 	}
 
-	bool TempDB::TryGet(AccountAgeInfo& info) const try
+	void ReadRow(CachedStatement& query, AccountAgeInfo& info)
 	{
-		auto& db = const_cast<SQLite::Database&>(m_Connection.value());
-
-		auto query = SelectStatementBuilder(s_TableAccountAges.GetTableName())
-			.Where(s_TableAccountAges.COL_ACCOUNT_ID == info.m_SteamID)
-			.Run(db);
-
-		if (query.executeStep())
-		{
-			info.m_CreationTime = query.getColumn(s_TableAccountAges.COL_CREATION_TIME);
-			return true;
-		}
-
-		return false;
-	}
-	catch (...)
-	{
-		LogException();
-		throw;
+		info.m_CreationTime = query.getColumn(s_TableAccountAges.COL_CREATION_TIME);
 	}
 
-	void TempDB::GetNearestAccountAgeInfos(SteamID id, std::optional<AccountAgeInfo>& lower, std::optional<AccountAgeInfo>& upper) const
+	void TempDB::GetAccountAgeInfos(std::vector<AccountAgeInfo>& infos) const try
 	{
-		auto queryStr = mh::format(R"SQL(
-SELECT max({col_AccountID}) AS {col_AccountID}, {col_CreationTime} FROM {tbl_AccountAges} WHERE {col_AccountID} <= $steamID
-UNION ALL
-SELECT min({col_AccountID}) AS {col_AccountID}, {col_CreationTime} FROM {tbl_AccountAges} WHERE {col_AccountID} >= $steamID)SQL",
-
-			mh::fmtarg("col_AccountID", s_TableAccountAges.COL_ACCOUNT_ID.m_Name),
-			mh::fmtarg("col_CreationTime", s_TableAccountAges.COL_CREATION_TIME.m_Name),
-			mh::fmtarg("tbl_AccountAges", s_TableAccountAges.GetTableName()));
-
-		Statement2 query(SQLite::Statement(const_cast<SQLite::Database&>(m_Connection.value()), queryStr));
-		query.bind("$steamID", id.GetAccountID());
-
-		const auto DeserializeAccountInfo = [&]()
+		// The snapshot goes first, so local rows for the same account come after it
+		for (const char* schema : { SNAPSHOT_SCHEMA, MAIN_SCHEMA })
 		{
-			AccountAgeInfo info;
-			info.m_SteamID = query.getColumn(s_TableAccountAges.COL_ACCOUNT_ID);
-			info.m_CreationTime = query.getColumn(s_TableAccountAges.COL_CREATION_TIME);
-			return info;
-		};
+			if (schema == SNAPSHOT_SCHEMA && !m_SnapshotAttached)
+				continue;
 
-		while (query.executeStep())
-		{
-			assert(!lower.has_value() || !upper.has_value());
+			ScopedQueryTimer timer(GetQueryStats(s_TableAccountAges), false);
+			auto query = SelectStatementBuilder(s_TableAccountAges.GetTableName(), schema)
+				.Run(*m_StatementCache);
 
-			auto info = DeserializeAccountInfo();
-			if (info.m_SteamID == id)
+			while (query.executeStep())
 			{
-				lower = info;
-				upper = info;
-				return;
+				AccountAgeInfo& info = infos.emplace_back();
+				info.m_SteamID = query.getColumn(s_TableAccountAges.COL_ACCOUNT_ID);
+				ReadRow(query, info);
+				timer.m_Rows++;
 			}
+		}
 
-			if (info.m_SteamID.GetAccountID() < id.GetAccountID())
-				lower = info;
-			else
-				upper = info;
+		std::lock_guard lock(m_PendingMutex);
+		for (const PendingStores* pending : { &m_Writing, &m_Pending })
+		{
+			for (const auto& [key, info] : pending->Get<AccountAgeInfo>())
+				infos.push_back(info);
 		}
 	}
+	catch (...)
+	{
+		LogException();
+		throw;
+	}
 
 	void TempDB::Connect()
 	{
 		assert(!m_Connection.has_value());
-		m_Connection.emplace(CreateDBPath(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_FULLMUTEX);
+		m_Connection.emplace(m_DBPath, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_FULLMUTEX | SQLite::OPEN_URI);
 	}
 
-	void TempDB::Store(const LogsTFCacheInfo& info) try
+	void TempDB::WriteToDB(const LogsTFCacheInfo& info) try
 	{
-		ReplaceInto(m_Connection.value(), s_TableLogsTFCache.GetTableName(),
+		ScopedQueryTimer timer(GetQueryStats(s_TableLogsTFCache), true);
+		ReplaceInto(*m_StatementCache, s_TableLogsTFCache.GetTableName(),
 			{
 				{ s_TableLogsTFCache.COL_ACCOUNT_ID, info.GetSteamID() },
 				{ s_TableLogsTFCache.COL_LAST_UPDATE_TIME, info.m_LastCacheUpdateTime },
@@ -244,25 +921,16 @@ SELECT min({col_AccountID}) AS {col_AccountID}, {col_CreationTime} FROM {tbl_Acc
 		throw;
 	}
 
-	bool TempDB::TryGet(LogsTFCacheInfo& info) const
+	void ReadRow(CachedStatement& query, LogsTFCacheInfo& info)
 	{
-		auto query = SelectStatementBuilder(s_TableLogsTFCache.GetTableName())
-			.Where(s_TableLogsTFCache.COL_ACCOUNT_ID == info.m_ID)
-			.Run(m_Connection.value());
-
-		if (query.executeStep())
-		{
-			info.m_LastCacheUpdateTime = query.getColumn(s_TableLogsTFCache.COL_LAST_UPDATE_TIME);
-			info.m_LogsCount = query.getColumn(s_TableLogsTFCache.COL_LOG_COUNT);
-			return true;
-		}
-
-		return false;
+		info.m_LastCacheUpdateTime = query.getColumn(s_TableLogsTFCache.COL_LAST_UPDATE_TIME);
+		info.m_LogsCount = query.getColumn(s_TableLogsTFCache.COL_LOG_COUNT);
 	}
 
-	void TempDB::Store(const AccountInventorySizeInfo& info) try
+	void TempDB::WriteToDB(const AccountInventorySizeInfo& info) try
 	{
-		ReplaceInto(m_Connection.value(), s_TableInventorySize.GetTableName(),
+		ScopedQueryTimer timer(GetQueryStats(s_TableInventorySize), true);
+		ReplaceInto(*m_StatementCache, s_TableInventorySize.GetTableName(),
 			{
 				{ s_TableInventorySize.COL_ACCOUNT_ID, info.GetSteamID() },
 				{ s_TableInventorySize.COL_LAST_UPDATE_TIME, info.m_LastCacheUpdateTime },
@@ -276,21 +944,384 @@ SELECT min({col_AccountID}) AS {col_AccountID}, {col_CreationTime} FROM {tbl_Acc
 		throw;
 	}
 
-	bool TempDB::TryGet(AccountInventorySizeInfo& info) const
+	void ReadRow(CachedStatement& query, AccountInventorySizeInfo& info)
+	{
+		info.m_LastCacheUpdateTime = query.getColumn(s_TableInventorySize.COL_LAST_UPDATE_TIME);
+		info.m_Items = query.getColumn(s_TableInventorySize.COL_ITEM_COUNT);
+		info.m_Slots = query.getColumn(s_TableInventorySize.COL_SLOT_COUNT);
+	}
+
+	void TempDB::WriteToDB(const PlayerSummaryCacheInfo& info) try
+	{
+		ScopedQueryTimer timer(GetQueryStats(s_TablePlayerSummaries), true);
+		ReplaceInto(*m_StatementCache, s_TablePlayerSummaries.GetTableName(),
+			{
+				{ s_TablePlayerSummaries.COL_ACCOUNT_ID, info.GetSteamID() },
+				{ s_TablePlayerSummaries.COL_LAST_UPDATE_TIME, info.m_LastCacheUpdateTime },
+				{ s_TablePlayerSummaries.COL_REAL_NAME, info.m_RealName.c_str() },
+				{ s_TablePlayerSummaries.COL_NICKNAME, info.m_Nickname.c_str() },
+				{ s_TablePlayerSummaries.COL_AVATAR_HASH, SteamAPI::FormatAvatarHash(info.m_AvatarHash).c_str() },
+				{ s_TablePlayerSummaries.COL_PROFILE_URL, info.GetProfileURL().c_str() },
+				{ s_TablePlayerSummaries.COL_STATUS, int32_t(info.m_Status) },
+				{ s_TablePlayerSummaries.COL_VISIBILITY, int32_t(info.m_Visibility) },
+				{ s_TablePlayerSummaries.COL_PROFILE_CONFIGURED, int32_t(info.m_ProfileConfigured) },
+				{ s_TablePlayerSummaries.COL_COMMENT_PERMISSIONS, int32_t(info.m_CommentPermissions) },
+				OptionalColumnData(s_TablePlayerSummaries.COL_CREATION_TIME, info.m_CreationTime),
+				OptionalColumnData(s_TablePlayerSummaries.COL_LAST_LOG_OFF, info.m_LastLogOff),
+			});
+	}
+	catch (...)
+	{
+		LogException();
+		throw;
+	}
+
+	void ReadRow(CachedStatement& query, PlayerSummaryCacheInfo& info)
+	{
+		info.m_LastCacheUpdateTime = query.getColumn(s_TablePlayerSummaries.COL_LAST_UPDATE_TIME);
+		info.m_RealName = query.getColumn(s_TablePlayerSummaries.COL_REAL_NAME).getString();
+		info.m_Nickname = InternedString(query.getColumn(s_TablePlayerSummaries.COL_NICKNAME).getText());
+		info.m_AvatarHash = SteamAPI::ParseAvatarHash(
+			query.getColumn(s_TablePlayerSummaries.COL_AVATAR_HASH).getText()).value_or(SteamAPI::AvatarHash{});
+		info.SetProfileURL(query.getColumn(s_TablePlayerSummaries.COL_PROFILE_URL).getText());
+		info.m_Status = SteamAPI::PersonaState(query.getColumn(s_TablePlayerSummaries.COL_STATUS).getInt());
+		info.m_Visibility = SteamAPI::CommunityVisibilityState(query.getColumn(s_TablePlayerSummaries.COL_VISIBILITY).getInt());
+		info.m_ProfileConfigured = query.getColumn(s_TablePlayerSummaries.COL_PROFILE_CONFIGURED).getInt() != 0;
+		info.m_CommentPermissions = query.getColumn(s_TablePlayerSummaries.COL_COMMENT_PERMISSIONS).getInt() != 0;
+		info.m_CreationTime = GetOptionalTime(query, s_TablePlayerSummaries.COL_CREATION_TIME);
+		info.m_LastLogOff = GetOptionalTime(query, s_TablePlayerSummaries.COL_LAST_LOG_OFF);
+	}
+
+	void TempDB::WriteToDB(const PlayerBansCacheInfo& info) try
+	{
+		ScopedQueryTimer timer(GetQueryStats(s_TablePlayerBans), true);
+		ReplaceInto(*m_StatementCache, s_TablePlayerBans.GetTableName(),
+			{
+				{ s_TablePlayerBans.COL_ACCOUNT_ID, info.GetSteamID() },
+				{ s_TablePlayerBans.COL_LAST_UPDATE_TIME, info.m_LastCacheUpdateTime },
+				{ s_TablePlayerBans.COL_COMMUNITY_BANNED, int32_t(info.m_CommunityBanned) },
+				{ s_TablePlayerBans.COL_ECONOMY_BAN, int32_t(info.m_EconomyBan) },
+				{ s_TablePlayerBans.COL_VAC_BAN_COUNT, info.m_VACBanCount },
+				{ s_TablePlayerBans.COL_GAME_BAN_COUNT, info.m_GameBanCount },
+				{ s_TablePlayerBans.COL_TIME_SINCE_LAST_BAN, info.m_TimeSinceLastBan },
+			});
+	}
+	catch (...)
+	{
+		LogException();
+		throw;
+	}
+
+	void ReadRow(CachedStatement& query, PlayerBansCacheInfo& info)
+	{
+		info.m_LastCacheUpdateTime = query.getColumn(s_TablePlayerBans.COL_LAST_UPDATE_TIME);
+		info.m_CommunityBanned = query.getColumn(s_TablePlayerBans.COL_COMMUNITY_BANNED).getInt() != 0;
+		info.m_EconomyBan = SteamAPI::PlayerEconomyBan(query.getColumn(s_TablePlayerBans.COL_ECONOMY_BAN).getInt());
+		info.m_VACBanCount = query.getColumn(s_TablePlayerBans.COL_VAC_BAN_COUNT).getUInt();
+		info.m_GameBanCount = query.getColumn(s_TablePlayerBans.COL_GAME_BAN_COUNT).getUInt();
+		info.m_TimeSinceLastBan = query.getColumn(s_TablePlayerBans.COL_TIME_SINCE_LAST_BAN);
+
+		if (info.HasAnyBans())
+			info.m_TimeSinceLastBan += std::max<duration_t>(tfbd_clock_t::now() - info.m_LastCacheUpdateTime, {});
+	}
+
+	void TempDB::WriteToDB(const FailedLookupCacheInfo& info) try
+	{
+		const auto& table = GetFailedLookupsTable(info.m_LookupType);
+		ScopedQueryTimer timer(GetQueryStats(table), true);
+		ReplaceInto(*m_StatementCache, table.GetTableName(),
+			{
+				{ table.COL_ACCOUNT_ID, info.GetSteamID() },
+				{ table.COL_LAST_UPDATE_TIME, info.m_LastCacheUpdateTime },
+				{ table.COL_ERROR_CODE, int32_t(info.m_ErrorCode) },
+			});
+	}
+	catch (...)
+	{
+		LogException();
+		throw;
+	}
+
+	// Both failed lookup tables have the same columns
+	void ReadRow(CachedStatement& query, FailedLookupCacheInfo& info)
 	{
-		auto query = SelectStatementBuilder(s_TableInventorySize.GetTableName())
-			.Where(s_TableInventorySize.COL_ACCOUNT_ID == info.GetSteamID())
-			.Run(m_Connection.value());
+		info.m_LastCacheUpdateTime = query.getColumn(s_TableFailedInventoryLookups.COL_LAST_UPDATE_TIME);
+		info.m_ErrorCode = SteamAPI::ErrorCode(query.getColumn(s_TableFailedInventoryLookups.COL_ERROR_CODE).getInt());
+	}
 
-		if (query.executeStep())
+	template<typename TInfo>
+	static bool IsNewer(const TInfo& lhs, const TInfo& rhs)
+	{
+		if constexpr (std::is_base_of_v<detail::BaseCacheInfo_Expiration, TInfo>)
+			return lhs.m_LastCacheUpdateTime > rhs.m_LastCacheUpdateTime;
+		else
+			return false;
+	}
+
+	template<typename TInfo, typename TTable>
+	bool TempDB::ReadFromSchemas(const TTable& table, TInfo& info) const
+	{
+		bool found = false;
+		for (const char* schema : { MAIN_SCHEMA, SNAPSHOT_SCHEMA })
 		{
-			info.m_LastCacheUpdateTime = query.getColumn(s_TableInventorySize.COL_LAST_UPDATE_TIME);
-			info.m_Items = query.getColumn(s_TableInventorySize.COL_ITEM_COUNT);
-			info.m_Slots = query.getColumn(s_TableInventorySize.COL_SLOT_COUNT);
-			return true;
+			if (found && !ITempDB::IsExpired(info))
+				break;
+			if (schema == SNAPSHOT_SCHEMA && !m_SnapshotAttached)
+				break;
+
+			ScopedQueryTimer timer(GetQueryStats(table), false);
+			auto query = SelectStatementBuilder(table.GetTableName(), schema)
+				.Where(table.COL_ACCOUNT_ID == info.GetSteamID())
+				.Run(*m_StatementCache);
+
+			if (!query.executeStep())
+				continue;
+
+			timer.m_Rows = 1;
+
+			TInfo stored = info;
+			ReadRow(query, stored);
+			if (!found || IsNewer(stored, info))
+				info = std::move(stored);
+
+			found = true;
 		}
 
-		return false;
+		return found;
+	}
+
+	bool TempDB::ReadFromDB(AccountAgeInfo& info) const { return ReadFromSchemas(s_TableAccountAges, info); }
+	bool TempDB::ReadFromDB(LogsTFCacheInfo& info) const { return ReadFromSchemas(s_TableLogsTFCache, info); }
+	bool TempDB::ReadFromDB(AccountInventorySizeInfo& info) const { return ReadFromSchemas(s_TableInventorySize, info); }
+	bool TempDB::ReadFromDB(PlayerSummaryCacheInfo& info) const { return ReadFromSchemas(s_TablePlayerSummaries, info); }
+	bool TempDB::ReadFromDB(PlayerBansCacheInfo& info) const { return ReadFromSchemas(s_TablePlayerBans, info); }
+	bool TempDB::ReadFromDB(FailedLookupCacheInfo& info) const
+	{
+		return ReadFromSchemas(GetFailedLookupsTable(info.m_LookupType), info);
+	}
+
+	template<typename TInfo, typename TTable>
+	void TempDB::ReadManyFromSchema(const TTable& table, const char* schema, std::span<const int64_t> accountIDs,
+		std::vector<TInfo>& infos) const
+	{
+		for (size_t offset = 0; offset < accountIDs.size(); offset += MAX_IN_LIST_SIZE)
+		{
+			const size_t count = std::min(accountIDs.size() - offset, MAX_IN_LIST_SIZE);
+			std::vector<int64_t> values(accountIDs.begin() + offset, accountIDs.begin() + offset + count);
+			const int64_t last = values.back();
+			values.resize(std::bit_ceil(count), last); // Duplicates don't change the result
+
+			ScopedQueryTimer timer(GetQueryStats(table), false);
+			auto query = SelectStatementBuilder(table.GetTableName(), schema)
+				.WhereIn(table.COL_ACCOUNT_ID, std::move(values))
+				.Run(*m_StatementCache);
+
+			while (query.executeStep())
+			{
+				TInfo& info = infos.emplace_back();
+				info.GetSteamID() = query.getColumn(table.COL_ACCOUNT_ID);
+				ReadRow(query, info);
+				timer.m_Rows++;
+			}
+		}
+	}
+
+	template<typename TInfo, typename TTable>
+	void TempDB::TryGetManyPendingOrStored(const TTable& table, std::span<const SteamID> ids, std::vector<TInfo>& infos) const
+	{
+		std::vector<int64_t> remaining;
+		{
+			std::lock_guard lock(m_PendingMutex);
+			for (const SteamID& id : ids)
+			{
+				if (id.Type != SteamAccountType::Individual)
+					continue;
+
+				const auto FindPending = [&]
+				{
+					for (const PendingStores* pending : { &m_Pending, &m_Writing })
+					{
+						const auto& map = pending->Get<TInfo>();
+						if (auto found = map.find(id.ID64); found != map.end())
+						{
+							infos.push_back(found->second);
+							m_PendingHitCount++;
+							return true;
+						}
+					}
+
+					return false;
+				};
+
+				if (!FindPending())
+					remaining.push_back(id.GetAccountID());
+			}
+		}
+
+		std::sort(remaining.begin(), remaining.end());
+		remaining.erase(std::unique(remaining.begin(), remaining.end()), remaining.end());
+
+		const size_t firstStored = infos.size();
+		ReadManyFromSchema(table, MAIN_SCHEMA, remaining, infos);
+
+		if (!m_SnapshotAttached)
+			return;
+
+		// Anything that isn't stored locally, or has expired locally, might still be in the snapshot
+		std::unordered_map<int64_t, size_t> storedIndices;
+		for (size_t i = firstStored; i < infos.size(); i++)
+			storedIndices.emplace(infos[i].GetSteamID().GetAccountID(), i);
+
+		std::vector<int64_t> fallback;
+		for (int64_t accountID : remaining)
+		{
+			if (auto found = storedIndices.find(accountID); found == storedIndices.end() || IsExpired(infos[found->second]))
+				fallback.push_back(accountID);
+		}
+
+		if (fallback.empty())
+			return;
+
+		std::vector<TInfo> snapshotInfos;
+		ReadManyFromSchema(table, SNAPSHOT_SCHEMA, fallback, snapshotInfos);
+		for (TInfo& info : snapshotInfos)
+		{
+			if (auto found = storedIndices.find(info.GetSteamID().GetAccountID()); found == storedIndices.end())
+				infos.push_back(std::move(info));
+			else if (IsNewer(info, infos[found->second]))
+				infos[found->second] = std::move(info);
+		}
+	}
+
+	void TempDB::TryGetMany(std::span<const SteamID> ids, std::vector<LogsTFCacheInfo>& infos) const
+	{
+		TryGetManyPendingOrStored(s_TableLogsTFCache, ids, infos);
+	}
+	void TempDB::TryGetMany(std::span<const SteamID> ids, std::vector<AccountInventorySizeInfo>& infos) const
+	{
+		TryGetManyPendingOrStored(s_TableInventorySize, ids, infos);
+	}
+	void TempDB::TryGetMany(std::span<const SteamID> ids, std::vector<PlayerSummaryCacheInfo>& infos) const
+	{
+		TryGetManyPendingOrStored(s_TablePlayerSummaries, ids, infos);
+	}
+	void TempDB::TryGetMany(std::span<const SteamID> ids, std::vector<PlayerBansCacheInfo>& infos) const
+	{
+		TryGetManyPendingOrStored(s_TablePlayerBans, ids, infos);
+	}
+}
+
+namespace
+{
+	// Rows are deleted MAINTENANCE_DELETE_CHUNK at a time, so reads on the main thread get a turn
+	// on the connection in between
+	static constexpr int MAINTENANCE_DELETE_CHUNK = 1000;
+
+	// Expired summaries and bans are still shown while they're being refreshed, so they're kept a
+	// while longer than the rest
+	static constexpr duration_t STALE_ROW_GRACE_TIME = day_t(30);
+
+	struct ExpirableTable
+	{
+		const BASETABLE_EXPIRABLE& m_Table;
+		duration_t m_MaxAge;
+	};
+
+	static std::vector<ExpirableTable> GetExpirableTables()
+	{
+		return
+		{
+			{ s_TableLogsTFCache, LogsTFCacheInfo{}.GetCacheLiveTime() },
+			{ s_TableInventorySize, AccountInventorySizeInfo{}.GetCacheLiveTime() },
+			{ s_TablePlayerSummaries, PlayerSummaryCacheInfo{}.GetCacheLiveTime() + STALE_ROW_GRACE_TIME },
+			{ s_TablePlayerBans, PlayerBansCacheInfo{}.GetCacheLiveTime() + STALE_ROW_GRACE_TIME },
+			{ s_TableFailedInventoryLookups, FailedLookupCacheInfo{}.GetCacheLiveTime() },
+			{ s_TableFailedPlaytimeLookups, FailedLookupCacheInfo{}.GetCacheLiveTime() },
+		};
+	}
+
+	static int DeleteInChunks(StatementCache& cache, const std::string& queryStr, int64_t param)
+	{
+		int total = 0;
+		while (true)
+		{
+			auto query = cache.Get(queryStr);
+			query->bind(1, param);
+
+			const int deleted = query.exec();
+			total += deleted;
+			if (deleted < MAINTENANCE_DELETE_CHUNK)
+				return total;
+		}
+	}
+
+	uint64_t TempDB::GetUsedSizeBytes()
+	{
+		const int64_t pageCount = m_Connection->execAndGet("PRAGMA page_count").getInt64();
+		const int64_t freePages = m_Connection->execAndGet("PRAGMA freelist_count").getInt64();
+		const int64_t pageSize = m_Connection->execAndGet("PRAGMA page_size").getInt64();
+		return uint64_t(std::max<int64_t>(pageCount - freePages, 0) * pageSize);
+	}
+
+	void TempDB::RunMaintenance() try
+	{
+		const auto startTime = tfbd_clock_t::now();
+
+		// Databases created before incremental vacuum was turned on need one full vacuum to switch over
+		if (m_Connection->execAndGet("PRAGMA auto_vacuum").getInt() != 2)
+		{
+			Log("Enabling incremental vacuum for {}", CreateDBPath());
+			m_Connection->exec("PRAGMA auto_vacuum = INCREMENTAL");
+			m_Connection->exec("VACUUM");
+		}
+
+		const auto expirableTables = GetExpirableTables();
+
+		int expiredRows = 0;
+		for (const ExpirableTable& table : expirableTables)
+		{
+			const auto queryStr = mh::format(
+				R"SQL(DELETE FROM "{0}" WHERE rowid IN (SELECT rowid FROM "{0}" WHERE "{1}" < ?1 LIMIT {2}))SQL",
+				table.m_Table.GetTableName(), table.m_Table.COL_LAST_UPDATE_TIME.m_Name, MAINTENANCE_DELETE_CHUNK);
+
+			expiredRows += DeleteInChunks(*m_StatementCache, queryStr,
+				ColumnDataSerializer<time_point_t>::Serialize(tfbd_clock_t::now() - table.m_MaxAge));
+		}
+
+		// Still too big, drop the least recently updated quarter of each table until it isn't.
+		// Account ages are left alone, they never expire and are tiny anyway.
+		int trimmedRows = 0;
+		if (const uint64_t maxSize = m_MaxSizeBytes; maxSize > 0)
+		{
+			for (int pass = 0; pass < 8 && GetUsedSizeBytes() > maxSize; pass++)
+			{
+				for (const ExpirableTable& table : expirableTables)
+				{
+					const auto rowCount = m_Connection->execAndGet(
+						mh::format(R"SQL(SELECT count(*) FROM "{}")SQL", table.m_Table.GetTableName())).getInt64();
+					if (rowCount <= 0)
+						continue;
+
+					const auto queryStr = mh::format(
+						R"SQL(DELETE FROM "{0}" WHERE rowid IN (SELECT rowid FROM "{0}" ORDER BY "{1}" LIMIT {2}))SQL",
+						table.m_Table.GetTableName(), table.m_Table.COL_LAST_UPDATE_TIME.m_Name,
+						std::min<int64_t>((rowCount + 3) / 4, MAINTENANCE_DELETE_CHUNK));
+
+					trimmedRows += m_StatementCache->Get(queryStr).exec();
+				}
+			}
+		}
+
+		m_Connection->exec("PRAGMA incremental_vacuum");
+		m_Connection->exec("PRAGMA wal_checkpoint(TRUNCATE)");
+
+		DebugLog("[{}ms] Temp db maintenance: deleted {} expired rows, trimmed {} rows for the size cap, {} KiB used",
+			std::chrono::duration_cast<std::chrono::milliseconds>(tfbd_clock_t::now() - startTime).count(),
+			expiredRows, trimmedRows, GetUsedSizeBytes() / 1024);
+	}
+	catch (...)
+	{
+		LogException("Temp db maintenance failed");
 	}
 }
 
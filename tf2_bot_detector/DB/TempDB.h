@@ -3,13 +3,22 @@
 #include "Networking/LogsTFAPI.h"
 #include "Networking/SteamAPI.h"
 #include "Clock.h"
+#include "RemoteCache.h"
 #include "SteamID.h"
 
 #include <mh/coroutine/task.hpp>
 #include <mh/memory/stack_info.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <memory>
 #include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 namespace tf2_bot_detector::DB
 {
@@ -64,6 +73,47 @@ namespace tf2_bot_detector::DB
 		duration_t GetCacheLiveTime() const override final { return day_t(7); }
 	};
 
+	struct PlayerSummaryCacheInfo final : detail::BaseCacheInfo_Expiration, SteamAPI::PlayerSummary
+	{
+		PlayerSummaryCacheInfo() = default;
+		using SteamAPI::PlayerSummary::PlayerSummary;
+		using SteamAPI::PlayerSummary::operator=;
+
+		using ICacheInfo::GetSteamID;
+		const SteamID& GetSteamID() const override { return m_SteamID; }
+
+		duration_t GetCacheLiveTime() const override final { return day_t(1); }
+	};
+
+	struct PlayerBansCacheInfo final : detail::BaseCacheInfo_Expiration, SteamAPI::PlayerBans
+	{
+		PlayerBansCacheInfo() = default;
+		using SteamAPI::PlayerBans::PlayerBans;
+		using SteamAPI::PlayerBans::operator=;
+
+		using ICacheInfo::GetSteamID;
+		const SteamID& GetSteamID() const override { return m_SteamID; }
+
+		duration_t GetCacheLiveTime() const override final { return day_t(1); }
+	};
+
+	// Lookups that fail the same way every time for some accounts (private inventories and game
+	// lists), so the failure is remembered instead of being retried every session
+	enum class FailedLookupType
+	{
+		InventoryInfo,
+		TF2Playtime,
+	};
+
+	struct FailedLookupCacheInfo final : detail::BaseCacheInfo_SteamID, detail::BaseCacheInfo_Expiration
+	{
+		FailedLookupType m_LookupType{};
+		SteamAPI::ErrorCode m_ErrorCode{};
+
+		// Shorter than the successful lookups, since people do change their privacy settings
+		duration_t GetCacheLiveTime() const override { return std::chrono::hours(12); }
+	};
+
 	class ITempDB
 	{
 	public:
@@ -71,40 +121,206 @@ namespace tf2_bot_detector::DB
 
 		static std::unique_ptr<ITempDB> Create();
 
+		// The TryGetMany() overloads look up a whole set of accounts with a few queries instead of
+		// one each, appending whatever was found to infos (in no particular order). Expired
+		// entries are included, same as TryGet().
+
 		virtual void Store(const AccountAgeInfo& info) = 0;
 		[[nodiscard]] virtual bool TryGet(AccountAgeInfo& info) const = 0;
-		virtual void GetNearestAccountAgeInfos(SteamID id, std::optional<AccountAgeInfo>& lower, std::optional<AccountAgeInfo>& upper) const = 0;
+		// Every stored account age, in no particular order. Stores that haven't been written yet
+		// come last, so if an account shows up twice the later entry is the newer one.
+		virtual void GetAccountAgeInfos(std::vector<AccountAgeInfo>& infos) const = 0;
 
 		virtual void Store(const LogsTFCacheInfo& info) = 0;
 		[[nodiscard]] virtual bool TryGet(LogsTFCacheInfo& info) const = 0;
+		virtual void TryGetMany(std::span<const SteamID> ids, std::vector<LogsTFCacheInfo>& infos) const = 0;
 
 		virtual void Store(const AccountInventorySizeInfo& info) = 0;
 		[[nodiscard]] virtual bool TryGet(AccountInventorySizeInfo& info) const = 0;
+		virtual void TryGetMany(std::span<const SteamID> ids, std::vector<AccountInventorySizeInfo>& infos) const = 0;
 
-		template<typename TInfo, typename TUpdateFunc>
-		mh::task<> GetOrUpdateAsync(TInfo& info, TUpdateFunc&& updateFunc)
+		virtual void Store(const PlayerSummaryCacheInfo& info) = 0;
+		[[nodiscard]] virtual bool TryGet(PlayerSummaryCacheInfo& info) const = 0;
+		virtual void TryGetMany(std::span<const SteamID> ids, std::vector<PlayerSummaryCacheInfo>& infos) const = 0;
+
+		// m_TimeSinceLastBan is advanced by however long ago the entry was stored
+		virtual void Store(const PlayerBansCacheInfo& info) = 0;
+		[[nodiscard]] virtual bool TryGet(PlayerBansCacheInfo& info) const = 0;
+		virtual void TryGetMany(std::span<const SteamID> ids, std::vector<PlayerBansCacheInfo>& infos) const = 0;
+
+		// Looked up by m_SteamID and m_LookupType
+		virtual void Store(const FailedLookupCacheInfo& info) = 0;
+		[[nodiscard]] virtual bool TryGet(FailedLookupCacheInfo& info) const = 0;
+
+		// Background maintenance (expiry sweeps, size cap, vacuum) only runs while idle is set, so it
+		// never competes with match-time queries. A maxSizeBytes of 0 means no cap.
+		virtual void SetMaintenanceOptions(bool idle, uint64_t maxSizeBytes) = 0;
+
+		// Writes a compacted copy of everything stored so far to path, for warming up other installs
+		// with. Runs on the write thread after it flushes what's queued, so it never lands inside a
+		// write batch and every store made before the call is included. Blocks until it's done.
+		virtual void ExportSnapshot(const std::filesystem::path& path) const = 0;
+
+		// Mounts a file written by ExportSnapshot() as a read only fallback. Anything that isn't
+		// stored locally, or has expired locally, is looked for there before the caller goes out
+		// to the network. Takes effect on the write thread a moment later, empty to unmount.
+		virtual void SetSnapshotPath(const std::filesystem::path& path) = 0;
+
+		// Layers a cache shared with other installs behind this one, see IRemoteCache. Only the async
+		// lookups (TryGetAsync(), TryGetManyRemoteAsync() and GetOrUpdateAsync()) read through to it, for
+		// whatever is missing or expired locally, and every Store() of a supported type is written
+		// through to it in the background. Recreated only if baseURL changes, empty to go back to
+		// local only.
+		virtual void SetRemoteCache(const std::string& baseURL, std::shared_ptr<const IHTTPClient> client) = 0;
+
+		template<typename TInfo>
+		static constexpr bool IS_REMOTE_CACHED = std::is_same_v<TInfo, AccountAgeInfo> ||
+			std::is_same_v<TInfo, LogsTFCacheInfo> || std::is_same_v<TInfo, AccountInventorySizeInfo>;
+
+		struct TableStats
+		{
+			std::string m_Table;
+			uint32_t m_Reads;      // Queries that reached the DB, a TryGetMany() chunk counts once
+			uint32_t m_Writes;     // Rows written, each is its own statement
+			uint64_t m_RowsRead;
+
+			// Upper bounds of the power of two bucket each percentile landed in, reads and writes together
+			std::chrono::microseconds m_LatencyP50;
+			std::chrono::microseconds m_LatencyP99;
+		};
+
+		struct Stats
+		{
+			std::vector<TableStats> m_Tables;
+
+			// Commits of a batch of writes, not attributed to any one table
+			uint32_t m_Commits;
+			std::chrono::microseconds m_CommitLatencyP99;
+
+			uint32_t m_PendingHits;   // Reads answered by a store that hadn't been written yet
+
+			// GetOrUpdateAsync() calls, and how many of them found an entry that hadn't expired
+			uint32_t m_CacheLookups;
+			uint32_t m_CacheHits;
+
+			uint64_t m_DBFileSize;
+			uint64_t m_WALFileSize;
+
+			// All zero without a remote cache
+			IRemoteCache::Stats m_RemoteCache;
+		};
+
+		virtual Stats GetStats() const = 0;
+
+		template<typename TInfo>
+		static bool IsExpired(const TInfo& info)
+		{
+			if constexpr (std::is_base_of_v<detail::BaseCacheInfo_Expiration, TInfo>)
+				return (tfbd_clock_t::now() - info.m_LastCacheUpdateTime) > info.GetCacheLiveTime();
+			else
+				return false;
+		}
+
+		// TryGet() and TryGetMany() on the DB thread, so a slow disk never stalls the caller. The
+		// caller resumes on the DB thread as well, and should dispatch back to wherever it needs to
+		// be. There's no StoreAsync(), Store() only queues the write and never touches the disk. Not
+		// const, anything found in the remote cache is stored locally.
+		template<typename TInfo>
+		[[nodiscard]] mh::task<bool> TryGetAsync(TInfo& info)
 		{
 			assert(!mh::is_variable_on_current_stack(info));
-			assert(!mh::is_variable_on_current_stack(updateFunc));
 
-			constexpr bool HAS_EXPIRATION = std::is_base_of_v<detail::BaseCacheInfo_Expiration, TInfo>;
+			co_await ResumeOnDBThread();
+			bool found = TryGet(info);
 
-			bool wantsRefresh = true;
-			if (TryGet(info))
+			if constexpr (IS_REMOTE_CACHED<TInfo>)
 			{
-				if constexpr (HAS_EXPIRATION)
+				if (auto remote = GetRemoteCache(); remote && (!found || IsExpired(info)))
 				{
-					auto elapsed = tfbd_clock_t::now() - info.m_LastCacheUpdateTime;
-					if (elapsed <= info.GetCacheLiveTime())
-						wantsRefresh = false;
+					auto remoteInfos = co_await remote->GetManyAsync<TInfo>({ info.GetSteamID() });
+					co_await ResumeOnDBThread();
+
+					if (!remoteInfos.empty() && !IsExpired(remoteInfos.front()))
+					{
+						info = std::move(remoteInfos.front());
+						Store(info);
+						found = true;
+					}
 				}
-				else
+			}
+
+			co_return found;
+		}
+
+		// Local only, so the caller never waits on the network for what's already here. Follow up
+		// with TryGetManyRemoteAsync() for the rest.
+		template<typename TInfo>
+		[[nodiscard]] mh::task<std::vector<TInfo>> TryGetManyAsync(std::vector<SteamID> ids)
+		{
+			co_await ResumeOnDBThread();
+
+			std::vector<TInfo> infos;
+			TryGetMany(ids, infos);
+			co_return infos;
+		}
+
+		// Looks up whatever localInfos (from TryGetManyAsync()) is missing or has expired in the
+		// remote cache. Only returns what was found there, which is also stored locally. Empty if
+		// there's no remote cache, or TInfo isn't one of the types it holds.
+		template<typename TInfo>
+		[[nodiscard]] mh::task<std::vector<TInfo>> TryGetManyRemoteAsync(std::vector<SteamID> ids, std::vector<TInfo> localInfos)
+		{
+			std::vector<TInfo> infos;
+
+			if constexpr (IS_REMOTE_CACHED<TInfo>)
+			{
+				auto remote = GetRemoteCache();
+				if (!remote)
+					co_return infos;
+
+				std::erase_if(ids, [&](const SteamID& id)
+					{
+						return std::any_of(localInfos.begin(), localInfos.end(),
+							[&](const TInfo& info) { return info.GetSteamID() == id && !IsExpired(info); });
+					});
+
+				if (ids.empty())
+					co_return infos;
+
+				auto remoteInfos = co_await remote->GetManyAsync<TInfo>(std::move(ids));
+				co_await ResumeOnDBThread();
+
+				for (TInfo& remoteInfo : remoteInfos)
 				{
-					wantsRefresh = false;
+					if (IsExpired(remoteInfo))
+						continue;
+
+					Store(remoteInfo);
+					infos.push_back(std::move(remoteInfo));
 				}
 			}
 
-			if (wantsRefresh)
+			co_return infos;
+		}
+
+		[[nodiscard]] mh::task<> ExportSnapshotAsync(std::filesystem::path path) const
+		{
+			co_await ResumeOnDBThread();
+			ExportSnapshot(path);
+		}
+
+		template<typename TInfo, typename TUpdateFunc>
+		mh::task<> GetOrUpdateAsync(TInfo& info, TUpdateFunc&& updateFunc)
+		{
+			assert(!mh::is_variable_on_current_stack(info));
+			assert(!mh::is_variable_on_current_stack(updateFunc));
+
+			constexpr bool HAS_EXPIRATION = std::is_base_of_v<detail::BaseCacheInfo_Expiration, TInfo>;
+
+			const bool hit = co_await TryGetAsync(info) && !IsExpired(info);
+			RecordCacheLookup(hit);
+
+			if (!hit)
 			{
 				co_await updateFunc(info);
 
@@ -114,5 +330,11 @@ namespace tf2_bot_detector::DB
 				Store(info);
 			}
 		}
+
+	protected:
+		// Completes on the DB thread, a single thread with its own queue of reads
+		virtual mh::task<> ResumeOnDBThread() const = 0;
+		virtual void RecordCacheLookup(bool hit) const = 0;
+		virtual std::shared_ptr<IRemoteCache> GetRemoteCache() const = 0;
 	};
 }
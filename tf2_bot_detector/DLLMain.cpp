@@ -1,14 +1,32 @@
 #include "DLLMain.h"
 
 #include "Application.h"
+#include "Config/PlayerListJSON.h"
 #include "Tests/Tests.h"
+#include "HeadlessMonitor.h"
+#include "SessionArchive.h"
+#include "SessionReplay.h"
 #include "UI/MainWindow.h"
+#include "UI/UIBenchmark.h"
+#include "Util/StartupTimeline.h"
 #include "Util/TextUtils.h"
+#include "EventLog.h"
 #include "Log.h"
 #include "Filesystem.h"
 
+#include <mh/text/format.hpp>
+#include <mh/text/formatters/error_code.hpp>
 #include <mh/text/string_insertion.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <thread>
+#include <vector>
+
 #ifdef WIN32
 #include "Platform/Windows/WindowsHelpers.h"
 #include <Windows.h>
@@ -29,6 +47,111 @@ namespace tf2_bot_detector
 	{
 		DebugLog(location, "[ImGuiDesktop] {}", msg);
 	}
+
+	// --export-event-log <file> [--from <unix seconds>] [--to <unix seconds>] [--format json|csv] [--output <file>]
+	static int RunEventLogExport(int argc, const char** argv)
+	{
+		const std::filesystem::path inputPath = argv[0];
+		auto from = time_point_t::min();
+		auto to = time_point_t::max();
+		auto format = EventLogExportFormat::JSON;
+		std::filesystem::path outputPath;
+
+		for (int i = 1; (i + 1) < argc; i += 2)
+		{
+			if (!strcmp(argv[i], "--from"))
+				from = time_point_t(std::chrono::seconds(strtoll(argv[i + 1], nullptr, 10)));
+			else if (!strcmp(argv[i], "--to"))
+				to = time_point_t(std::chrono::seconds(strtoll(argv[i + 1], nullptr, 10)));
+			else if (!strcmp(argv[i], "--format") && !strcmp(argv[i + 1], "csv"))
+				format = EventLogExportFormat::CSV;
+			else if (!strcmp(argv[i], "--format") && !strcmp(argv[i + 1], "json"))
+				format = EventLogExportFormat::JSON;
+			else if (!strcmp(argv[i], "--output"))
+				outputPath = argv[i + 1];
+			else
+				LogWarning("Ignoring unknown event log export option {} {}", argv[i], argv[i + 1]);
+		}
+
+		try
+		{
+			std::ofstream outputFile;
+			if (!outputPath.empty())
+			{
+				outputFile.open(outputPath, std::ios::binary | std::ios::trunc);
+				if (!outputFile.good())
+				{
+					LogError("Failed to open {} for writing", outputPath);
+					return 1;
+				}
+			}
+
+			const auto count = ExportEventLog(inputPath, from, to, format, outputPath.empty() ? std::cout : outputFile);
+			Log("Exported {} events from {}", count, inputPath);
+			return 0;
+		}
+		catch (const std::exception& e)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to export event log {}", inputPath);
+			return 1;
+		}
+	}
+
+	static int RunHeadless(std::vector<HeadlessMonitor::SessionInfo> sessions)
+	{
+		DebugLog("Initializing TF2BDApplication (headless)...");
+		TF2BDApplication app(TF2BDApplication::Mode::Headless);
+		HeadlessMonitor monitor(std::move(sessions));
+
+		std::signal(SIGINT, [](int) { HeadlessMonitor::RequestQuit(); });
+		std::signal(SIGTERM, [](int) { HeadlessMonitor::RequestQuit(); });
+
+		DebugLog("Entering headless event loop...");
+		while (!monitor.ShouldQuit())
+		{
+			monitor.Update();
+			std::this_thread::sleep_for(HeadlessMonitor::UPDATE_INTERVAL);
+		}
+
+		return 0;
+	}
+
+	// --replay <archive> [--replay-speed <multiplier>|max]
+	static int RunReplay(const std::filesystem::path& archive, float speed)
+	{
+		// Whatever the replay writes (marks from rules, last seen times, settings, the TempDB and
+		// every other cache) goes into a folder of its own, thrown away afterwards. The user's
+		// files are left alone, and every run of the same archive starts out with empty caches.
+		const auto isolatedDir = IFilesystem::Get().GetTempDir() / "Replays" /
+			mh::format("{}", std::chrono::system_clock::now().time_since_epoch().count());
+		IFilesystem::Get().RedirectWrites(isolatedDir);
+
+		int result = 0;
+		{
+			DebugLog("Initializing TF2BDApplication (replay)...");
+			TF2BDApplication app(TF2BDApplication::Mode::Headless);
+
+			try
+			{
+				SessionReplay replay(archive, speed);
+				while (replay.Update())
+				{
+					if (speed > 0)
+						std::this_thread::sleep_for(SessionReplay::UPDATE_INTERVAL);
+				}
+			}
+			catch (const std::exception& e)
+			{
+				LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to replay {}", archive);
+				result = 1;
+			}
+		}
+
+		if (std::error_code ec; std::filesystem::remove_all(isolatedDir, ec) == static_cast<std::uintmax_t>(-1))
+			LogWarning("Failed to delete {}: {}", isolatedDir, ec);
+
+		return result;
+	}
 }
 
 TF2_BOT_DETECTOR_EXPORT int tf2_bot_detector::RunProgram(int argc, const char** argv)
@@ -69,11 +192,77 @@ TF2_BOT_DETECTOR_EXPORT int tf2_bot_detector::RunProgram(int argc, const char**
 		}
 #endif
 
-		IFilesystem::Get().Init();
-		ILogManager::GetInstance().Init();
+		{
+			TF2BD_STARTUP_PHASE("IFilesystem::Init");
+			IFilesystem::Get().Init();
+		}
+		{
+			TF2BD_STARTUP_PHASE("ILogManager::Init");
+			ILogManager::GetInstance().Init();
+		}
 
+		bool headless = false;
+		std::filesystem::path replayArchive;
+		float replaySpeed = 1;
+		std::optional<tf2_bot_detector::UIBenchmarkOptions> uiBenchmark;
+		std::vector<tf2_bot_detector::HeadlessMonitor::SessionInfo> headlessSessions;
 		for (int i = 1; i < argc; i++)
 		{
+			if (!strcmp(argv[i], "--headless"))
+				headless = true;
+			if (!strcmp(argv[i], "--session") && (i + 4) < argc)
+			{
+				// --session <tf dir> <rcon port> <rcon password> <steam id>
+				auto& session = headlessSessions.emplace_back();
+				session.m_TFDir = argv[i + 1];
+				session.m_RCONPort = uint16_t(atoi(argv[i + 2]));
+				session.m_RCONPassword = argv[i + 3];
+
+				try
+				{
+					session.m_LocalSteamID = tf2_bot_detector::SteamID(argv[i + 4]);
+				}
+				catch (const std::invalid_argument& e)
+				{
+					LogError("Invalid steam id for --session {}: {}", argv[i + 1], e.what());
+					return 1;
+				}
+
+				i += 4;
+				continue;
+			}
+			if (!strcmp(argv[i], "--export-event-log") && (i + 1) < argc)
+				return tf2_bot_detector::RunEventLogExport(argc - i - 1, argv + i + 1);
+			if (!strcmp(argv[i], "--prebuild-config-cache") && (i + 2) < argc)
+			{
+				// --prebuild-config-cache <playerlist> <output>
+				if (auto result = tf2_bot_detector::PlayerListJSON::WritePrebuiltCache(argv[i + 1], argv[i + 2]))
+				{
+					LogError("Failed to prebuild the cache for {}: {}", argv[i + 1], result);
+					return 1;
+				}
+
+				Log("Wrote the cache for {} to {}", argv[i + 1], argv[i + 2]);
+				return 0;
+			}
+			if (!strcmp(argv[i], "--startup-trace") && (i + 1) < argc)
+				StartupTimeline::SetTraceExportPath(argv[i + 1]);
+			if (!strcmp(argv[i], "--record") && (i + 1) < argc)
+				ISessionArchive::StartRecording(argv[i + 1]);
+			if (!strcmp(argv[i], "--replay") && (i + 1) < argc)
+				replayArchive = argv[i + 1];
+			if (!strcmp(argv[i], "--replay-speed") && (i + 1) < argc)
+				replaySpeed = !strcmp(argv[i + 1], "max") ? 0 : float(atof(argv[i + 1]));
+			if (!strcmp(argv[i], "--benchmark-ui") && (i + 2) < argc)
+			{
+				// --benchmark-ui <players> <frames>
+				auto& options = uiBenchmark.emplace();
+				options.m_Players = uint32_t(atoi(argv[i + 1]));
+				options.m_Frames = std::max(uint32_t(atoi(argv[i + 2])), 1u);
+				i += 2;
+				continue;
+			}
+
 #ifdef _DEBUG
 			if (!strcmp(argv[i], "--static-seed") && (i + 1) < argc)
 				tf2_bot_detector::g_StaticRandomSeed = atoi(argv[i + 1]);
@@ -95,14 +284,38 @@ TF2_BOT_DETECTOR_EXPORT int tf2_bot_detector::RunProgram(int argc, const char**
 		tf2_bot_detector::RunTests();
 #endif
 
+		if (!headlessSessions.empty() && !headless)
+			LogWarning("--session only does anything with --headless");
+
+		if (!replayArchive.empty())
+		{
+			const int result = tf2_bot_detector::RunReplay(replayArchive, replaySpeed);
+			DebugLog("Graceful shutdown");
+			return result;
+		}
+
+		if (headless)
+		{
+			const int result = tf2_bot_detector::RunHeadless(std::move(headlessSessions));
+			ISessionArchive::StopRecording();
+			DebugLog("Graceful shutdown");
+			return result;
+		}
+
 		ImGuiDesktop::SetLogFunction(&tf2_bot_detector::ImGuiDesktopLogFunc);
 
 		DebugLog("Initializing TF2BDApplication...");
-		TF2BDApplication app;
+		std::optional<TF2BDApplication> app;
+		if (uiBenchmark)
+			app.emplace(*uiBenchmark);
+		else
+			app.emplace();
 
 		DebugLog("Entering event loop...");
-		while (!app.ShouldQuit())
-			app.Update();
+		while (!app->ShouldQuit())
+			app->Update();
+
+		ISessionArchive::StopRecording();
 	}
 
 	DebugLog("Graceful shutdown");
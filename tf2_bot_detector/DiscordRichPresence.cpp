@@ -11,7 +11,9 @@
 #include "WorldEventListener.h"
 #include "WorldState.h"
 
+#include <mh/concurrency/thread_pool.hpp>
 #include <mh/concurrency/thread_sentinel.hpp>
+#include <mh/coroutine/task.hpp>
 #include <mh/text/charconv_helper.hpp>
 #include <mh/text/fmtstr.hpp>
 #include <mh/text/format.hpp>
@@ -21,8 +23,17 @@
 #include <cryptopp/sha.h>
 
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <compare>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#ifdef TF2BD_DISCORD_DELAY_LOADED
+#include <Windows.h>
+#include <delayimp.h>
+#endif
 
 #undef min
 #undef max
@@ -82,7 +93,7 @@ static constexpr const char DEFAULT_LARGE_IMAGE_KEY[] = "tf2_1x1";
 
 static constexpr LogMessageColor DISCORD_LOG_COLOR{ 117 / 255.0f, 136 / 255.0f, 215 / 255.0f };
 
-static bool s_DiscordDebugLogEnabled = true;
+static std::atomic_bool s_DiscordDebugLogEnabled = true;
 
 template<typename... TArgs>
 static auto DiscordDebugLog(const std::string_view& fmtStr, const TArgs&... args) ->
@@ -786,7 +797,6 @@ namespace
 		DiscordState(const Settings& settings, IWorldState& world);
 		~DiscordState();
 
-		void QueueUpdate() { m_WantsUpdate = true; }
 		void Update() override;
 
 		void OnConsoleLineParsed(IWorldState& world, IConsoleLine& line) override;
@@ -804,17 +814,49 @@ namespace
 		const Settings& m_Settings;
 		IWorldState& m_WorldState;
 		DRPInfo m_DRPInfo;
+
+		// Owned by the activity thread. Changes from console lines are queued up as events and
+		// applied there, right before the activity is rebuilt.
 		DiscordGameState m_GameState;
+		using GameStateEvent = std::function<void(DiscordGameState&)>;
+		std::vector<GameStateEvent> m_PendingEvents;
+		template<typename TFunc> void QueueEvent(TFunc&& func)
+		{
+			m_PendingEvents.emplace_back(std::forward<TFunc>(func));
+			m_WantsUpdate = true;
+		}
+
+		// Applies the events and rebuilds the activity, empty if it's the same as currentActivity
+		static mh::task<std::optional<discord::Activity>> BuildActivityAsync(mh::thread_pool& pool,
+			DiscordGameState& gameState, std::vector<GameStateEvent> events, discord::Activity currentActivity);
+		mh::thread_pool m_ActivityThread{ 1 };
+		mh::task<std::optional<discord::Activity>> m_ActivityTask;
 
 		bool m_WantsUpdate = false;
 		time_point_t m_LastUpdate{};
-		discord::Activity m_CurrentActivity{};
+		discord::Activity m_CurrentActivity{}; // The last one we sent to discord
 	};
 }
 
 DiscordState::DiscordState(const Settings& settings, IWorldState& world) :
 	AutoWorldEventListener(world),
-	AutoConsoleLineListener(world),
+	AutoConsoleLineListener(world,
+		{
+			ConsoleLineType::PlayerStatusMapPosition,
+			ConsoleLineType::PartyHeader,
+			ConsoleLineType::MatchmakingBannedTime,
+			ConsoleLineType::LobbyHeader,
+			ConsoleLineType::LobbyStatusFailed,
+			ConsoleLineType::QueueStateChange,
+			ConsoleLineType::InQueue,
+			ConsoleLineType::LobbyChanged,
+			ConsoleLineType::ServerJoin,
+			ConsoleLineType::HostNewGame,
+			ConsoleLineType::PlayerStatusIP,
+			ConsoleLineType::NetStatusConfig,
+			ConsoleLineType::Connecting,
+			ConsoleLineType::SVC_UserMessage,
+		}),
 	m_Settings(settings),
 	m_WorldState(world),
 	m_GameState(settings, m_DRPInfo),
@@ -825,6 +867,10 @@ DiscordState::DiscordState(const Settings& settings, IWorldState& world) :
 DiscordState::~DiscordState()
 {
 	DiscordDebugLog(MH_SOURCE_LOCATION_CURRENT());
+
+	// It's using m_GameState
+	if (m_ActivityTask.valid())
+		m_ActivityTask.wait();
 }
 
 void DiscordState::OnConsoleLineParsed(IWorldState& world, IConsoleLine& line)
@@ -835,101 +881,101 @@ void DiscordState::OnConsoleLineParsed(IWorldState& world, IConsoleLine& line)
 	{
 	case ConsoleLineType::PlayerStatusMapPosition:
 	{
-		QueueUpdate();
 		auto& statusLine = static_cast<const ServerStatusMapLine&>(line);
-		m_GameState.SetMapName(statusLine.GetMapName());
+		QueueEvent([mapName = statusLine.GetMapName()](DiscordGameState& state) { state.SetMapName(mapName); });
 		break;
 	}
 	case ConsoleLineType::PartyHeader:
 	{
-		QueueUpdate();
 		auto& partyLine = static_cast<const PartyHeaderLine&>(line);
-		m_GameState.UpdateParty(partyLine.GetParty());
+		QueueEvent([party = partyLine.GetParty()](DiscordGameState& state) { state.UpdateParty(party); });
 		break;
 	}
 	case ConsoleLineType::MatchmakingBannedTime:
 	{
-		QueueUpdate();
 		auto& banLine = static_cast<const MatchmakingBannedTimeLine&>(line);
-		m_GameState.UpdatePartyMatchmakingBanTime(banLine.GetLadderType(), banLine.GetBannedTime());
+		QueueEvent([type = banLine.GetLadderType(), time = banLine.GetBannedTime()](DiscordGameState& state)
+			{
+				state.UpdatePartyMatchmakingBanTime(type, time);
+			});
 		break;
 	}
 	case ConsoleLineType::LobbyHeader:
 	{
-		QueueUpdate();
-		m_GameState.SetInLobby(true);
+		QueueEvent([](DiscordGameState& state) { state.SetInLobby(true); });
 		break;
 	}
 	case ConsoleLineType::LobbyStatusFailed:
 	{
-		QueueUpdate();
-		m_GameState.SetInLobby(false);
+		QueueEvent([](DiscordGameState& state) { state.SetInLobby(false); });
 		break;
 	}
 	case ConsoleLineType::QueueStateChange:
 	{
-		QueueUpdate();
 		auto& queueLine = static_cast<const QueueStateChangeLine&>(line);
-		m_GameState.OnQueueStateChange(queueLine.GetQueueType(), queueLine.GetStateChange());
+		QueueEvent([type = queueLine.GetQueueType(), change = queueLine.GetStateChange()](DiscordGameState& state)
+			{
+				state.OnQueueStateChange(type, change);
+			});
 		break;
 	}
 	case ConsoleLineType::InQueue:
 	{
-		QueueUpdate();
 		auto& queueLine = static_cast<const InQueueLine&>(line);
-		m_GameState.OnQueueStatusUpdate(queueLine.GetQueueType(), queueLine.GetQueueStartTime());
+		QueueEvent([type = queueLine.GetQueueType(), startTime = queueLine.GetQueueStartTime()](DiscordGameState& state)
+			{
+				state.OnQueueStatusUpdate(type, startTime);
+			});
 		break;
 	}
 	case ConsoleLineType::LobbyChanged:
 	{
-		QueueUpdate();
 		auto& lobbyLine = static_cast<const LobbyChangedLine&>(line);
 		if (lobbyLine.GetChangeType() == LobbyChangeType::Destroyed)
-			m_GameState.SetMapName("");
+			QueueEvent([](DiscordGameState& state) { state.SetMapName(""); });
+		else
+			m_WantsUpdate = true;
 
 		break;
 	}
 	case ConsoleLineType::ServerJoin:
 	{
-		QueueUpdate();
 		auto& joinLine = static_cast<const ServerJoinLine&>(line);
-		m_GameState.SetMapName(joinLine.GetMapName());
-		// Not necessarily in a lobby at this point, but in-lobby state will be reapplied soon if we are in a lobby
-		m_GameState.SetInLobby(false);
+		QueueEvent([mapName = joinLine.GetMapName()](DiscordGameState& state)
+			{
+				state.SetMapName(mapName);
+				// Not necessarily in a lobby at this point, but in-lobby state will be reapplied soon if we are in a lobby
+				state.SetInLobby(false);
+			});
 		break;
 	}
 	case ConsoleLineType::HostNewGame:
 	{
-		QueueUpdate();
-		m_GameState.SetInLocalServer(true);
+		QueueEvent([](DiscordGameState& state) { state.SetInLocalServer(true); });
 		break;
 	}
 	case ConsoleLineType::PlayerStatusIP:
 	{
-		QueueUpdate();
 		auto& ipLine = static_cast<const ServerStatusPlayerIPLine&>(line);
-		m_GameState.OnServerIPUpdate(ipLine.GetLocalIP());
+		QueueEvent([ip = ipLine.GetLocalIP()](DiscordGameState& state) { state.OnServerIPUpdate(ip); });
 		break;
 	}
 	case ConsoleLineType::NetStatusConfig:
 	{
-		QueueUpdate();
 		auto& netLine = static_cast<const NetStatusConfigLine&>(line);
-		m_GameState.OnConnectionCountUpdate(netLine.GetConnectionCount());
+		QueueEvent([count = netLine.GetConnectionCount()](DiscordGameState& state) { state.OnConnectionCountUpdate(count); });
 		break;
 	}
 	case ConsoleLineType::Connecting:
 	{
-		QueueUpdate();
 		auto& connLine = static_cast<const ConnectingLine&>(line);
-		m_GameState.OnServerIPUpdate(connLine.GetAddress());
+		QueueEvent([address = connLine.GetAddress()](DiscordGameState& state) { state.OnServerIPUpdate(address); });
 		break;
 	}
 	case ConsoleLineType::SVC_UserMessage:
 	{
-		QueueUpdate();
 		auto& umsgLine = static_cast<SVCUserMessageLine&>(line);
-		m_GameState.OnServerIPUpdate(umsgLine.GetAddress());
+		QueueEvent([address = std::string(umsgLine.GetAddress())](DiscordGameState& state) { state.OnServerIPUpdate(address); });
 		break;
 	}
 
@@ -942,8 +988,22 @@ void DiscordState::OnLocalPlayerSpawned(IWorldState& world, TFClassType classTyp
 {
 	m_Sentinel.check();
 
-	QueueUpdate();
-	m_GameState.OnLocalPlayerSpawned(classType);
+	QueueEvent([classType](DiscordGameState& state) { state.OnLocalPlayerSpawned(classType); });
+}
+
+mh::task<std::optional<discord::Activity>> DiscordState::BuildActivityAsync(mh::thread_pool& pool,
+	DiscordGameState& gameState, std::vector<GameStateEvent> events, discord::Activity currentActivity)
+{
+	co_await pool.co_add_task();
+
+	for (const auto& event : events)
+		event(gameState);
+
+	auto nextActivity = gameState.ConstructActivity();
+	if (std::is_eq(nextActivity <=> currentActivity))
+		co_return std::nullopt;
+
+	co_return nextActivity;
 }
 
 static void DiscordLogFunc(discord::LogLevel level, const char* msg)
@@ -969,6 +1029,25 @@ static void DiscordLogFunc(discord::LogLevel level, const char* msg)
 	}
 }
 
+static bool IsGameSDKLoaded()
+{
+#ifdef TF2BD_DISCORD_DELAY_LOADED
+	// A missing dll would otherwise only turn up as an exception from the first call into it
+	static const bool s_Loaded = []
+	{
+		if (SUCCEEDED(__HrLoadAllImportsForDll("discord_game_sdk.dll")))
+			return true;
+
+		LogWarning("Failed to load discord_game_sdk.dll, Discord Rich Presence is unavailable");
+		return false;
+	}();
+
+	return s_Loaded;
+#else
+	return true;
+#endif
+}
+
 void DiscordState::Update()
 {
 	m_Sentinel.check();
@@ -977,7 +1056,7 @@ void DiscordState::Update()
 
 	// Initialize discord
 	const auto curTime = tfbd_clock_t::now();
-	if (!m_Core && (curTime - m_LastDiscordInitializeTime) > 10s)
+	if (!m_Core && (curTime - m_LastDiscordInitializeTime) > 10s && IsGameSDKLoaded())
 	{
 		m_LastDiscordInitializeTime = curTime;
 
@@ -993,50 +1072,53 @@ void DiscordState::Update()
 
 			core->SetLogHook(discord::LogLevel::Debug, &DiscordLogHookFunc);
 
+			// Nothing has been sent to this instance yet
+			m_CurrentActivity = {};
+			m_WantsUpdate = true;
+
 			if (auto result = m_Core->ActivityManager().RegisterSteam(440); result != discord::Result::Ok)
 				DebugLogWarning("Failed to register discord integration as steam appid 440: {}", mh::enum_fmt(result));
 		}
 	}
 
-	if (m_Core)
+	if (m_ActivityTask.is_ready())
 	{
-		std::invoke([&]()
-			{
-				if (!m_WantsUpdate)
-					return;
-
-				if ((curTime - m_LastUpdate) < UPDATE_INTERVAL)
-					return;
-
-				if (const auto nextActivity = m_GameState.ConstructActivity();
-					std::is_neq(nextActivity <=> m_CurrentActivity))
-				{
-					// Perform the update
-					m_Core->ActivityManager().UpdateActivity(nextActivity, [nextActivity](discord::Result result)
-						{
-							if (result == discord::Result::Ok)
-							{
-								DiscordDebugLog("Updated discord activity state: {}", nextActivity);
-							}
-							else
-							{
-								LogWarning(MH_SOURCE_LOCATION_CURRENT(),
-									"Failed to update discord activity state: {}", mh::enum_fmt(result));
-							}
-						});
-
-					m_CurrentActivity = nextActivity;
-					m_LastUpdate = curTime;
-				}
-				else
+		if (auto nextActivity = m_ActivityTask.get(); !nextActivity)
+		{
+			DiscordDebugLog(MH_SOURCE_LOCATION_CURRENT(), "Discord activity state unchanged");
+		}
+		else if (m_Core)
+		{
+			m_Core->ActivityManager().UpdateActivity(*nextActivity, [activity = *nextActivity](discord::Result result)
 				{
-					DiscordDebugLog(MH_SOURCE_LOCATION_CURRENT(), "Discord activity state unchanged");
-				}
+					if (result == discord::Result::Ok)
+					{
+						DiscordDebugLog("Updated discord activity state: {}", activity);
+					}
+					else
+					{
+						LogWarning(MH_SOURCE_LOCATION_CURRENT(),
+							"Failed to update discord activity state: {}", mh::enum_fmt(result));
+					}
+				});
+
+			m_CurrentActivity = *nextActivity;
+		}
 
-				// Update successful
-				m_WantsUpdate = false;
-			});
+		m_ActivityTask = {};
+	}
+
+	// Rebuilt at most once per rate limit window, even while discord isn't running so the events
+	// don't pile up
+	if (m_WantsUpdate && !m_ActivityTask.valid() && (curTime - m_LastUpdate) >= UPDATE_INTERVAL)
+	{
+		m_WantsUpdate = false;
+		m_LastUpdate = curTime;
+		m_ActivityTask = BuildActivityAsync(m_ActivityThread, m_GameState, std::exchange(m_PendingEvents, {}), m_CurrentActivity);
+	}
 
+	if (m_Core)
+	{
 		// Run discord callbacks
 		if (auto result = m_Core->RunCallbacks(); result != discord::Result::Ok)
 		{
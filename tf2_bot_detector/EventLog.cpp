@@ -0,0 +1,454 @@
+#include "EventLog.h"
+#include "Filesystem.h"
+#include "Log.h"
+
+#include <mh/text/fmtstr.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <thread>
+#include <variant>
+#include <vector>
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+namespace
+{
+	// size, type, field count, timestamp
+	constexpr size_t RECORD_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint16_t) + sizeof(int64_t);
+	constexpr size_t TIMESTAMP_OFFSET = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint16_t);
+
+	constexpr size_t FLUSH_SIZE = 256 * 1024;
+	constexpr duration_t FLUSH_INTERVAL = 1s;
+
+	// Slack for records that were timestamped on one thread and submitted after a later one
+	constexpr int64_t EXPORT_ORDER_TOLERANCE_US = std::chrono::microseconds(5s).count();
+
+	struct RecordSchema
+	{
+		const char* m_Name;
+		std::vector<const char*> m_Fields;
+	};
+
+	const RecordSchema& GetSchema(EventLogRecordType type)
+	{
+		static const RecordSchema s_Schemas[] =
+		{
+			{ "ConsoleLine", { "line_type" } },
+			{ "ChatMessage", { "steam_id", "name", "message" } },
+			{ "PlayerStatus", { "steam_id", "name" } },
+			{ "PlayerDropped", { "steam_id", "reason" } },
+			{ "LobbyChanged", {} },
+			{ "ModerationDecision", { "decision_type", "steam_id", "name", "rule", "marked_in" } },
+			{ "HTTPRequest", { "status_code", "duration_ms", "bytes", "url" } },
+			{ "RCONCommand", { "command" } },
+		};
+		static_assert(std::size(s_Schemas) == size_t(EventLogRecordType::COUNT));
+
+		static const RecordSchema s_Unknown{ "Unknown", {} };
+		return size_t(type) < std::size(s_Schemas) ? s_Schemas[size_t(type)] : s_Unknown;
+	}
+
+	template<typename T>
+	void Append(std::string& buf, const T& value)
+	{
+		const auto offset = buf.size();
+		buf.resize(offset + sizeof(value));
+		std::memcpy(buf.data() + offset, &value, sizeof(value));
+	}
+
+	template<typename T>
+	bool Read(std::string_view& data, T& value)
+	{
+		if (data.size() < sizeof(value))
+			return false;
+
+		std::memcpy(&value, data.data(), sizeof(value));
+		data.remove_prefix(sizeof(value));
+		return true;
+	}
+
+	int64_t ToMicroseconds(time_point_t time)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+	}
+
+	class EventLogWriter final
+	{
+	public:
+		static EventLogWriter& Get()
+		{
+			static EventLogWriter s_Writer;
+			return s_Writer;
+		}
+
+		~EventLogWriter()
+		{
+			if (m_Thread.joinable())
+			{
+				{
+					std::lock_guard lock(m_Mutex);
+					m_Stop = true;
+				}
+				m_WakeCV.notify_one();
+				m_Thread.join();
+			}
+		}
+
+		void Start();
+		void Submit(const std::string_view& record);
+
+	private:
+		void ThreadFunc();
+
+		std::mutex m_Mutex;
+		std::condition_variable m_WakeCV;
+		std::string m_Pending;
+		time_point_t m_PendingFirstTime{};
+		bool m_Stop = false;
+
+		std::optional<EventLogFile> m_File; // Only touched by m_Thread once it's started
+		std::thread m_Thread;
+	};
+
+	void EventLogWriter::Start()
+	{
+		std::lock_guard lock(m_Mutex);
+		if (m_Thread.joinable())
+			return;
+
+		const auto logDir = IFilesystem::Get().GetLogsDir() / "events";
+
+		std::error_code ec;
+		std::filesystem::create_directories(logDir, ec);
+		if (ec)
+		{
+			LogError("Failed to create {}, the event log is disabled: {}", logDir, ec);
+			return;
+		}
+
+		const auto t = ToTM(tfbd_clock_t::now());
+		const mh::fmtstr<128> fileName("{}.tfbdevents", std::put_time(&t, "%Y-%m-%d_%H-%M-%S"));
+
+		m_File.emplace(logDir / fileName.view());
+		if (!m_File->IsOpen())
+		{
+			LogError("Failed to open event log {}, the event log is disabled", m_File->GetPath());
+			m_File.reset();
+			return;
+		}
+
+		Log("Writing event log to {}", m_File->GetPath());
+		m_Thread = std::thread(&EventLogWriter::ThreadFunc, this);
+	}
+
+	void EventLogWriter::Submit(const std::string_view& record)
+	{
+		bool wake = false;
+		{
+			std::lock_guard lock(m_Mutex);
+			if (!m_Thread.joinable())
+				return;
+
+			if (m_Pending.empty())
+			{
+				int64_t timestamp;
+				std::memcpy(&timestamp, record.data() + TIMESTAMP_OFFSET, sizeof(timestamp));
+				m_PendingFirstTime = time_point_t(std::chrono::duration_cast<duration_t>(std::chrono::microseconds(timestamp)));
+			}
+
+			m_Pending.append(record);
+			wake = m_Pending.size() >= FLUSH_SIZE;
+		}
+
+		if (wake)
+			m_WakeCV.notify_one();
+	}
+
+	void EventLogWriter::ThreadFunc()
+	{
+		std::string batch;
+		while (true)
+		{
+			time_point_t firstTime;
+			bool stop;
+			{
+				std::unique_lock lock(m_Mutex);
+				m_WakeCV.wait_for(lock, FLUSH_INTERVAL, [&] { return m_Stop || m_Pending.size() >= FLUSH_SIZE; });
+
+				batch.clear();
+				batch.swap(m_Pending);
+				firstTime = m_PendingFirstTime;
+				stop = m_Stop;
+			}
+
+			if (!batch.empty())
+			{
+				m_File->Write(batch, firstTime);
+				m_File->Flush();
+			}
+
+			if (stop)
+				break;
+		}
+	}
+}
+
+EventLogFile::EventLogFile(std::filesystem::path path) :
+	m_Path(std::move(path)),
+	m_File(m_Path, std::ios::binary | std::ios::trunc),
+	m_Index(std::filesystem::path(m_Path) += ".idx", std::ios::binary | std::ios::trunc)
+{
+	m_File.write(MAGIC, sizeof(MAGIC));
+	m_Offset = sizeof(MAGIC);
+}
+
+void EventLogFile::Write(const std::string_view& records, time_point_t firstTimestamp)
+{
+	if (records.empty())
+		return;
+
+	const int64_t timestamp = ToMicroseconds(firstTimestamp);
+	m_Index.write(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
+	m_Index.write(reinterpret_cast<const char*>(&m_Offset), sizeof(m_Offset));
+
+	m_File.write(records.data(), records.size());
+	m_Offset += records.size();
+}
+
+void EventLogFile::Flush()
+{
+	m_File.flush();
+	m_Index.flush();
+}
+
+void detail::EventLog_h::BeginRecord(std::string& buf, EventLogRecordType type, uint16_t fieldCount)
+{
+	buf.clear();
+	Append(buf, uint32_t(0));
+	Append(buf, type);
+	Append(buf, fieldCount);
+	Append(buf, ToMicroseconds(tfbd_clock_t::now()));
+}
+
+void detail::EventLog_h::AddField(std::string& buf, uint64_t value)
+{
+	Append(buf, EventLogFieldKind::Integer);
+	Append(buf, value);
+}
+
+void detail::EventLog_h::AddField(std::string& buf, const std::string_view& value)
+{
+	const auto length = uint16_t(std::min<size_t>(value.size(), UINT16_MAX));
+	Append(buf, EventLogFieldKind::String);
+	Append(buf, length);
+	buf.append(value.data(), length);
+}
+
+void detail::EventLog_h::EndRecord(std::string& buf)
+{
+	const auto payloadSize = uint32_t(buf.size() - sizeof(uint32_t));
+	std::memcpy(buf.data(), &payloadSize, sizeof(payloadSize));
+}
+
+void detail::EventLog_h::SubmitRecord(const std::string_view& record)
+{
+	EventLogWriter::Get().Submit(record);
+}
+
+void IEventLog::SetEnabled(bool enabled)
+{
+	if (enabled == IsEnabled())
+		return;
+
+	if (enabled)
+		EventLogWriter::Get().Start();
+
+	detail::EventLog_h::s_Enabled = enabled;
+}
+
+namespace
+{
+	struct IndexEntry
+	{
+		int64_t m_Timestamp;
+		uint64_t m_Offset;
+	};
+
+	// Offset of the last batch that started at or before from, so nothing in range gets skipped
+	uint64_t FindStartOffset(const std::filesystem::path& path, int64_t from)
+	{
+		std::ifstream indexFile(std::filesystem::path(path) += ".idx", std::ios::binary);
+		if (!indexFile.good())
+			return sizeof(EventLogFile::MAGIC);
+
+		std::vector<IndexEntry> index;
+		IndexEntry entry;
+		while (indexFile.read(reinterpret_cast<char*>(&entry.m_Timestamp), sizeof(entry.m_Timestamp)) &&
+			indexFile.read(reinterpret_cast<char*>(&entry.m_Offset), sizeof(entry.m_Offset)))
+		{
+			index.push_back(entry);
+		}
+
+		from -= EXPORT_ORDER_TOLERANCE_US;
+		auto it = std::upper_bound(index.begin(), index.end(), from,
+			[](int64_t time, const IndexEntry& e) { return time < e.m_Timestamp; });
+
+		if (it == index.begin())
+			return sizeof(EventLogFile::MAGIC);
+
+		return std::prev(it)->m_Offset;
+	}
+
+	using field_type = std::variant<uint64_t, std::string>;
+
+	bool ReadFields(std::string_view payload, uint16_t fieldCount, std::vector<field_type>& fields)
+	{
+		fields.clear();
+		for (uint16_t i = 0; i < fieldCount; i++)
+		{
+			EventLogFieldKind kind;
+			if (!Read(payload, kind))
+				return false;
+
+			if (kind == EventLogFieldKind::Integer)
+			{
+				uint64_t value;
+				if (!Read(payload, value))
+					return false;
+
+				fields.emplace_back(value);
+			}
+			else if (kind == EventLogFieldKind::String)
+			{
+				uint16_t length;
+				if (!Read(payload, length) || payload.size() < length)
+					return false;
+
+				fields.emplace_back(std::string(payload.substr(0, length)));
+				payload.remove_prefix(length);
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	const char* GetFieldName(const RecordSchema& schema, size_t index)
+	{
+		return index < schema.m_Fields.size() ? schema.m_Fields[index] : nullptr;
+	}
+
+	void WriteCSVValue(std::ostream& output, const field_type& field)
+	{
+		if (auto value = std::get_if<uint64_t>(&field))
+		{
+			output << *value;
+			return;
+		}
+
+		output << '"';
+		for (char c : std::get<std::string>(field))
+		{
+			if (c == '"')
+				output << '"';
+			output << c;
+		}
+		output << '"';
+	}
+}
+
+size_t tf2_bot_detector::ExportEventLog(const std::filesystem::path& path, time_point_t from, time_point_t to,
+	EventLogExportFormat format, std::ostream& output)
+{
+	std::ifstream file(path, std::ios::binary);
+
+	char magic[sizeof(EventLogFile::MAGIC)]{};
+	if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, EventLogFile::MAGIC, sizeof(magic)))
+		throw std::runtime_error(mh::format("{} is not an event log", path));
+
+	const int64_t fromTime = ToMicroseconds(from);
+	const int64_t toTime = ToMicroseconds(to);
+	const int64_t stopTime = toTime > INT64_MAX - EXPORT_ORDER_TOLERANCE_US ? INT64_MAX : toTime + EXPORT_ORDER_TOLERANCE_US;
+
+	file.seekg(FindStartOffset(path, fromTime));
+
+	if (format == EventLogExportFormat::CSV)
+		output << "timestamp_us,type,fields...\n";
+
+	size_t count = 0;
+	std::string payload;
+	std::vector<field_type> fields;
+	while (true)
+	{
+		uint32_t payloadSize;
+		if (!file.read(reinterpret_cast<char*>(&payloadSize), sizeof(payloadSize)))
+			break; // End of file
+
+		payload.resize(payloadSize);
+		if (payloadSize < RECORD_HEADER_SIZE - sizeof(uint32_t) || !file.read(payload.data(), payloadSize))
+		{
+			LogWarning("Event log {} is truncated or damaged, stopped after {} records", path, count);
+			break;
+		}
+
+		std::string_view data = payload;
+		EventLogRecordType type;
+		uint16_t fieldCount;
+		int64_t timestamp;
+		Read(data, type);
+		Read(data, fieldCount);
+		Read(data, timestamp);
+
+		if (timestamp > stopTime)
+			break;
+		if (timestamp < fromTime || timestamp > toTime)
+			continue;
+
+		if (!ReadFields(data, fieldCount, fields))
+		{
+			LogWarning("Event log {} has a damaged record at {}us, skipping it", path, timestamp);
+			continue;
+		}
+
+		const RecordSchema& schema = GetSchema(type);
+		if (format == EventLogExportFormat::JSON)
+		{
+			nlohmann::json json{ { "timestamp_us", timestamp }, { "type", schema.m_Name } };
+			for (size_t i = 0; i < fields.size(); i++)
+			{
+				const char* name = GetFieldName(schema, i);
+				auto& value = json[name ? std::string(name) : mh::format("field{}", i)];
+				std::visit([&](const auto& v) { value = v; }, fields[i]);
+			}
+
+			// Player names and chat aren't always valid utf8
+			output << json.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) << '\n';
+		}
+		else
+		{
+			output << timestamp << ',' << schema.m_Name;
+			for (const auto& field : fields)
+			{
+				output << ',';
+				WriteCSVValue(output, field);
+			}
+			output << '\n';
+		}
+
+		count++;
+	}
+
+	return count;
+}
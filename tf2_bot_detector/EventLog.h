@@ -0,0 +1,125 @@
+#pragma once
+
+#include "Clock.h"
+#include "SteamID.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace tf2_bot_detector
+{
+	// Compact binary log of what happened during a session, for digging through after the fact
+	// without grepping the text logs. Off unless the event_log setting is on.
+	//
+	// File layout: 8 byte magic, then records of
+	//   uint32 payload size, uint16 EventLogRecordType, uint16 field count, int64 timestamp (us since 1970)
+	// followed by the fields, each a uint8 EventLogFieldKind then either a uint64 or a uint16 length
+	// and that many bytes. Next to it, <file>.idx holds (timestamp, offset) pairs, one for every
+	// batch of records written, so a time range can be found without reading everything before it.
+	enum class EventLogRecordType : uint16_t
+	{
+		ConsoleLine,        // line type
+		ChatMessage,        // steam id, name, message
+		PlayerStatus,       // steam id, name
+		PlayerDropped,      // steam id, reason
+		LobbyChanged,       //
+		ModerationDecision, // decision type, steam id, name, rule, marked in
+		HTTPRequest,        // status code (0 if it failed), duration (ms), response bytes, url
+		RCONCommand,        // command
+
+		COUNT,
+	};
+
+	enum class EventLogFieldKind : uint8_t
+	{
+		Integer,
+		String,
+	};
+
+	enum class EventLogExportFormat
+	{
+		JSON, // One object per line
+		CSV,
+	};
+
+	// Writes records straight to a file, with no buffering of its own beyond the ofstream's
+	class EventLogFile final
+	{
+	public:
+		static constexpr char MAGIC[8] = { 'T', 'F', 'B', 'D', 'E', 'V', 'T', '1' };
+
+		explicit EventLogFile(std::filesystem::path path);
+
+		bool IsOpen() const { return m_File.good() && m_Index.good(); }
+		const std::filesystem::path& GetPath() const { return m_Path; }
+
+		// records is a run of complete encoded records, the first of which has firstTimestamp
+		void Write(const std::string_view& records, time_point_t firstTimestamp);
+		void Flush();
+
+	private:
+		std::filesystem::path m_Path;
+		std::ofstream m_File;
+		std::ofstream m_Index;
+		uint64_t m_Offset = 0;
+	};
+
+	namespace detail::EventLog_h
+	{
+		inline std::atomic_bool s_Enabled = false;
+
+		void BeginRecord(std::string& buf, EventLogRecordType type, uint16_t fieldCount);
+		void AddField(std::string& buf, uint64_t value);
+		void AddField(std::string& buf, const std::string_view& value);
+		void EndRecord(std::string& buf);
+
+		template<typename T>
+		void AddField(std::string& buf, const T& value)
+		{
+			if constexpr (std::is_same_v<T, SteamID>)
+				AddField(buf, value.ID64);
+			else if constexpr (std::is_enum_v<T> || std::is_integral_v<T>)
+				AddField(buf, uint64_t(value));
+			else
+				AddField(buf, std::string_view(value));
+		}
+
+		void SubmitRecord(const std::string_view& record);
+	}
+
+	class IEventLog final
+	{
+	public:
+		// Starts writing to a new file in logs/events when first enabled
+		static void SetEnabled(bool enabled);
+		static bool IsEnabled() { return detail::EventLog_h::s_Enabled.load(std::memory_order_relaxed); }
+
+		// Fields are integers/enums, SteamIDs or strings, in the order listed for each EventLogRecordType.
+		// Records are buffered and written out on a background thread.
+		template<typename... TFields>
+		static void Record(EventLogRecordType type, const TFields&... fields)
+		{
+			using namespace detail::EventLog_h;
+
+			if (!IsEnabled())
+				return;
+
+			thread_local std::string s_Buffer;
+			BeginRecord(s_Buffer, type, uint16_t(sizeof...(TFields)));
+			(AddField(s_Buffer, fields), ...);
+			EndRecord(s_Buffer);
+			SubmitRecord(s_Buffer);
+		}
+	};
+
+	// Converts the records in [from, to] of an event log (not its .idx) to text. Returns the
+	// number of records written.
+	size_t ExportEventLog(const std::filesystem::path& path, time_point_t from, time_point_t to,
+		EventLogExportFormat format, std::ostream& output);
+}
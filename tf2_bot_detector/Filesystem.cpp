@@ -7,7 +7,10 @@
 #include <mh/text/string_insertion.hpp>
 #include <mh/utility.hpp>
 
+#include <atomic>
 #include <fstream>
+#include <map>
+#include <mutex>
 
 using namespace tf2_bot_detector;
 
@@ -22,6 +25,7 @@ namespace
 
 		std::filesystem::path ResolvePath(const std::filesystem::path& path, PathUsage usage) const override;
 		std::string ReadFile(std::filesystem::path path) const override;
+		MappedFile MapFile(std::filesystem::path path) const override;
 		void WriteFile(std::filesystem::path path, const void* begin, const void* end, PathUsage usage) const override;
 
 		std::filesystem::path GetLocalAppDataDir() const override;
@@ -31,6 +35,8 @@ namespace
 		mh::generator<std::filesystem::directory_entry> IterateDir(std::filesystem::path path, bool recursive,
 			std::filesystem::directory_options options) const override;
 
+		void RedirectWrites(const std::filesystem::path& dir) override;
+
 	private:
 		bool m_IsInit = false;
 		void EnsureInit(MH_SOURCE_LOCATION_AUTO(location)) const;
@@ -40,12 +46,22 @@ namespace
 		std::vector<std::filesystem::path> m_SearchPaths;
 		bool m_IsPortable;
 
+		// PathUsage::Read lookups (including the ones that found nothing), thrown out whenever
+		// something is added, removed or renamed in any of the search paths
+		std::filesystem::path FindInSearchPaths(const std::filesystem::path& path) const;
+		uint64_t GetSearchPathsChangeCount() const;
+		mutable std::atomic<uint64_t> m_OwnChangeCount = 0;
+		mutable std::mutex m_ResolvedPathsMutex;
+		mutable std::map<std::filesystem::path, std::filesystem::path> m_ResolvedPaths;
+		mutable uint64_t m_ResolvedPathsChangeCount = 0;
+
 		mh::thread_sentinel m_Sentinel;
 
 		std::filesystem::path m_ExeDir;
 		std::filesystem::path m_WorkingDir;
 		std::filesystem::path m_LocalAppDataDir;
 		std::filesystem::path m_RoamingAppDataDir;
+		std::filesystem::path m_WriteRedirectDir;
 		//std::filesystem::path m_MutableDataDir = ChooseMutableDataPath();
 	};
 }
@@ -131,6 +147,9 @@ void Filesystem::Init()
 				DebugLog(std::move(initMsg));
 			}
 
+			// Anything resolved above only looked through some of the search paths
+			++m_OwnChangeCount;
+
 			DebugLog("\tWorkingDir: {}", m_WorkingDir);
 			DebugLog("\tLocalAppDataDir: {}", GetLocalAppDataDir());
 			DebugLog("\tRoamingAppDataDir: {}", GetRoamingAppDataDir());
@@ -157,33 +176,35 @@ std::filesystem::path Filesystem::ResolvePath(const std::filesystem::path& path,
 
 	EnsureInit();
 
-	auto retVal = std::invoke([&]() -> std::filesystem::path
+	if (usage == PathUsage::Read)
 	{
-		if (usage == PathUsage::Read)
+		const auto changeCount = GetSearchPathsChangeCount();
 		{
-			std::vector<std::filesystem::path> fullSearchPaths;
-
-			for (const auto& searchPath : m_SearchPaths)
+			std::lock_guard lock(m_ResolvedPathsMutex);
+			if (changeCount != m_ResolvedPathsChangeCount)
 			{
-				auto fullPath = searchPath / path;
-				fullSearchPaths.push_back(fullPath);
-				if (std::filesystem::exists(fullPath))
-				{
-					assert(fullPath.is_absolute());
-					return fullPath;
-				}
+				m_ResolvedPaths.clear();
+				m_ResolvedPathsChangeCount = changeCount;
 			}
+			else if (auto found = m_ResolvedPaths.find(path); found != m_ResolvedPaths.end())
+			{
+				return found->second;
+			}
+		}
 
-			std::string debugMsg = mh::format("Unable to find {} in any search path. Full search paths [{} paths]:",
-				path, fullSearchPaths.size());
+		auto retVal = FindInSearchPaths(path);
+		DebugLog("ResolvePath({}, {}) -> {}", path, mh::enum_fmt(usage), retVal);
 
-			for (const std::filesystem::path& fsp : fullSearchPaths)
-				debugMsg << "\n\t" << fsp;
+		std::lock_guard lock(m_ResolvedPathsMutex);
+		if (changeCount == m_ResolvedPathsChangeCount)
+			m_ResolvedPaths.insert_or_assign(path, retVal);
 
-			DebugLogWarning(debugMsg);
-			return {};
-		}
-		else if (usage == PathUsage::WriteLocal)
+		return retVal;
+	}
+
+	auto retVal = std::invoke([&]() -> std::filesystem::path
+	{
+		if (usage == PathUsage::WriteLocal)
 		{
 			return GetLocalAppDataDir() / path;
 		}
@@ -201,6 +222,41 @@ std::filesystem::path Filesystem::ResolvePath(const std::filesystem::path& path,
 	return std::move(retVal);
 }
 
+std::filesystem::path Filesystem::FindInSearchPaths(const std::filesystem::path& path) const
+{
+	std::vector<std::filesystem::path> fullSearchPaths;
+
+	for (const auto& searchPath : m_SearchPaths)
+	{
+		auto fullPath = searchPath / path;
+		fullSearchPaths.push_back(fullPath);
+		if (std::filesystem::exists(fullPath))
+		{
+			assert(fullPath.is_absolute());
+			return fullPath;
+		}
+	}
+
+	std::string debugMsg = mh::format("Unable to find {} in any search path. Full search paths [{} paths]:",
+		path, fullSearchPaths.size());
+
+	for (const std::filesystem::path& fsp : fullSearchPaths)
+		debugMsg << "\n\t" << fsp;
+
+	DebugLogWarning(debugMsg);
+	return {};
+}
+
+uint64_t Filesystem::GetSearchPathsChangeCount() const
+{
+	// Each of these only ever goes up, so neither does the sum
+	uint64_t changeCount = m_OwnChangeCount;
+	for (const auto& searchPath : m_SearchPaths)
+		changeCount += Platform::GetDirectoryChangeCount(searchPath);
+
+	return changeCount;
+}
+
 std::string Filesystem::ReadFile(std::filesystem::path path) const try
 {
 	path = ResolvePath(path, PathUsage::Read);
@@ -228,6 +284,20 @@ catch (...)
 	throw;
 }
 
+MappedFile Filesystem::MapFile(std::filesystem::path path) const try
+{
+	path = ResolvePath(path, PathUsage::Read);
+	if (path.empty())
+		throw std::filesystem::filesystem_error("ResolvePath returned an empty path.", path, make_error_code(std::errc::no_such_file_or_directory));
+
+	return Platform::MapFileReadOnly(path);
+}
+catch (...)
+{
+	DebugLogException("Filename: {}", path);
+	throw;
+}
+
 void Filesystem::WriteFile(std::filesystem::path path, const void* begin, const void* end, PathUsage usage) const try
 {
 	path = ResolvePath(path, usage);
@@ -242,6 +312,9 @@ void Filesystem::WriteFile(std::filesystem::path path, const void* begin, const
 
 	const auto bytes = uintptr_t(end) - uintptr_t(begin);
 	file.write(reinterpret_cast<const char*>(begin), bytes);
+
+	// Don't wait for the change notification to see our own new files
+	++m_OwnChangeCount;
 }
 catch (...)
 {
@@ -253,6 +326,9 @@ std::filesystem::path Filesystem::GetLocalAppDataDir() const
 {
 	EnsureInit();
 
+	if (!m_WriteRedirectDir.empty())
+		return m_WriteRedirectDir;
+
 	return m_IsPortable ? m_WorkingDir : m_LocalAppDataDir;
 }
 
@@ -260,6 +336,9 @@ std::filesystem::path Filesystem::GetRoamingAppDataDir() const
 {
 	EnsureInit();
 
+	if (!m_WriteRedirectDir.empty())
+		return m_WriteRedirectDir;
+
 	return m_IsPortable ? m_WorkingDir : m_RoamingAppDataDir;
 }
 
@@ -267,12 +346,29 @@ std::filesystem::path Filesystem::GetTempDir() const
 {
 	EnsureInit();
 
-	if (m_IsPortable)
+	if (!m_WriteRedirectDir.empty())
+		return m_WriteRedirectDir / "temp";
+	else if (m_IsPortable)
 		return m_WorkingDir / "temp";
 	else
 		return Platform::GetRootTempDataDir() / "TF2 Bot Detector";
 }
 
+void Filesystem::RedirectWrites(const std::filesystem::path& dir)
+{
+	m_Sentinel.check();
+	EnsureInit();
+
+	m_WriteRedirectDir = std::filesystem::absolute(dir);
+	std::filesystem::create_directories(m_WriteRedirectDir);
+	std::filesystem::create_directories(GetTempDir());
+
+	m_SearchPaths.insert(m_SearchPaths.begin(), m_WriteRedirectDir);
+	++m_OwnChangeCount;
+
+	Log("Redirecting all writes to {}", m_WriteRedirectDir);
+}
+
 void Filesystem::EnsureInit(const mh::source_location& location) const
 {
 	if (!m_IsInit)
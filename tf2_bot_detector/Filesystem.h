@@ -8,6 +8,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace tf2_bot_detector
@@ -21,6 +22,29 @@ namespace tf2_bot_detector
 		Write [[deprecated]] = WriteRoaming,
 	};
 
+	// Read-only view of a whole file that's mapped into memory, instead of copied into a
+	// std::string. The view is valid for as long as any copy of this is alive.
+	class MappedFile final
+	{
+	public:
+		MappedFile() = default;
+		MappedFile(std::shared_ptr<const void> mapping, std::string_view data) :
+			m_Mapping(std::move(mapping)), m_Data(data)
+		{
+		}
+
+		std::string_view GetData() const { return m_Data; }
+		operator std::string_view() const { return m_Data; }
+
+		const char* data() const { return m_Data.data(); }
+		size_t size() const { return m_Data.size(); }
+		bool empty() const { return m_Data.empty(); }
+
+	private:
+		std::shared_ptr<const void> m_Mapping;
+		std::string_view m_Data;
+	};
+
 	class IFilesystem
 	{
 	public:
@@ -40,11 +64,18 @@ namespace tf2_bot_detector
 
 		//virtual std::fstream OpenFile(const std::filesystem::path& path) = 0;
 		virtual std::string ReadFile(std::filesystem::path path) const = 0;
+		virtual MappedFile MapFile(std::filesystem::path path) const = 0;
 		virtual void WriteFile(std::filesystem::path path, const void* begin, const void* end, PathUsage usage) const = 0;
 
 		virtual mh::generator<std::filesystem::directory_entry> IterateDir(std::filesystem::path path, bool recursive,
 			std::filesystem::directory_options options = std::filesystem::directory_options::none) const = 0;
 
+		// From now on, everything written (and the local, roaming and temp dirs) goes under dir
+		// instead. It's searched first, so reads see what was written, and fall back to the
+		// usual files for everything else. For running against the user's setup without changing
+		// any of it (--replay). Main thread only, before anything has cached a path.
+		virtual void RedirectWrites(const std::filesystem::path& dir) = 0;
+
 		void WriteFile(const std::filesystem::path& path, const std::string_view& data, PathUsage usage) const
 		{
 			return WriteFile(path, data.data(), data.data() + data.size(), usage);
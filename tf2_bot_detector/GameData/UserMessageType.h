@@ -2,6 +2,9 @@
 
 #include <mh/reflection/enum.hpp>
 
+#include <array>
+#include <cstddef>
+
 namespace tf2_bot_detector
 {
 	enum class UserMessageType
@@ -91,6 +94,36 @@ namespace tf2_bot_detector
 		HapSetConst = 81,
 		HapMeleeContact = 82,
 	};
+
+	// The type is a single byte in svc_UserMessage
+	inline constexpr size_t USER_MESSAGE_TYPE_TABLE_SIZE = 256;
+
+	struct UserMessageTypeInfo
+	{
+		bool m_IsVote = false; // IWorldState::GetVoteState()
+
+		// If nobody does anything with this type, lines for it are only counted
+		constexpr bool IsHandled() const { return m_IsVote; }
+	};
+
+	inline constexpr std::array<UserMessageTypeInfo, USER_MESSAGE_TYPE_TABLE_SIZE> USER_MESSAGE_TYPE_INFO = []()
+	{
+		std::array<UserMessageTypeInfo, USER_MESSAGE_TYPE_TABLE_SIZE> table{};
+
+		for (auto type : { UserMessageType::CallVoteFailed, UserMessageType::VoteFailed, UserMessageType::VotePass,
+			UserMessageType::VoteSetup, UserMessageType::VoteStart })
+		{
+			table[size_t(type)].m_IsVote = true;
+		}
+
+		return table;
+	}();
+
+	inline constexpr const UserMessageTypeInfo& GetUserMessageTypeInfo(UserMessageType type)
+	{
+		constexpr UserMessageTypeInfo UNKNOWN{};
+		return size_t(type) < USER_MESSAGE_TYPE_INFO.size() ? USER_MESSAGE_TYPE_INFO[size_t(type)] : UNKNOWN;
+	}
 }
 
 MH_ENUM_REFLECT_BEGIN(tf2_bot_detector::UserMessageType)
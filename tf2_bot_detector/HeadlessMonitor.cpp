@@ -0,0 +1,297 @@
+#include "HeadlessMonitor.h"
+#include "Actions/ActionGenerators.h"
+#include "DB/TempDB.h"
+#include "Platform/Platform.h"
+#include "SetupFlow/ChatWrappersGeneratorPage.h"
+#include "SetupFlow/TF2CommandLinePage.h"
+#include "Util/TaskScheduler.h"
+#include "Application.h"
+#include "EventLog.h"
+#include "GlobalDispatcher.h"
+#include "Log.h"
+
+#include <mh/concurrency/dispatcher.hpp>
+#include <mh/text/format.hpp>
+#include <srcon/async_client.h>
+
+using namespace std::chrono_literals;
+using namespace std::string_literals;
+using namespace tf2_bot_detector;
+
+static std::unique_ptr<srcon::async_client> CreateRCONClient(uint16_t port, std::string password)
+{
+	auto client = std::make_unique<srcon::async_client>();
+
+	srcon::srcon_addr addr;
+	addr.addr = "127.0.0.1";
+	addr.pass = std::move(password);
+	addr.port = port;
+	client->set_addr(std::move(addr));
+
+	return client;
+}
+
+HeadlessMonitor::HeadlessMonitor(std::vector<SessionInfo> sessions) :
+	m_SharedConfig(IModeratorLogic::SharedConfig::Create(m_Settings))
+{
+	ILogManager::GetInstance().CleanupLogFiles();
+
+	if (sessions.empty())
+	{
+		m_Sessions.push_back(std::make_unique<Session>(*this, std::nullopt, 0));
+	}
+	else
+	{
+		for (size_t i = 0; i < sessions.size(); i++)
+			m_Sessions.push_back(std::make_unique<Session>(*this, std::move(sessions[i]), i));
+	}
+
+	Log("Running headless with {} session(s), press Ctrl+C to quit", m_Sessions.size());
+}
+
+HeadlessMonitor::~HeadlessMonitor() = default;
+
+void HeadlessMonitor::Update()
+{
+	FrameClock::BeginFrame();
+
+	GetDispatcher().run_for(10ms);
+	TaskScheduler::Get().RunMainThreadTasks(MAIN_THREAD_TASK_BUDGET);
+
+	ILogManager::GetInstance().SetConsoleLogCompressed(m_Settings.m_Logging.m_CompressConsoleLogs);
+	SetDebugLogEnabled(m_Settings.m_Logging.m_DebugMessages);
+	IEventLog::SetEnabled(m_Settings.m_Logging.m_EventLog);
+	TaskScheduler::Get().SetThreadPolicy({ m_Settings.m_LowPriorityBackgroundThreads, m_Settings.m_BackgroundThreadAffinity });
+
+	bool idle = true;
+	m_MetricsSessions.clear();
+	for (auto& session : m_Sessions)
+	{
+		session->Update();
+		idle &= session->IsIdle();
+		m_MetricsSessions.push_back(session->GetMetricsSession());
+	}
+
+	m_MetricsExporter.Update(m_MetricsSessions);
+
+	// Temp db maintenance waits until none of the sessions are in a match
+	{
+		auto& tempDB = TF2BDApplication::GetApplication().GetTempDB();
+		tempDB.SetMaintenanceOptions(idle, uint64_t(m_Settings.m_TempDBMaxSizeMB) * 1024 * 1024);
+		tempDB.SetSnapshotPath(m_Settings.m_TempDBSnapshotPath);
+		tempDB.SetRemoteCache(m_Settings.m_TempDBRemoteCacheURL, m_Settings.GetHTTPClient());
+	}
+
+	if (idle && !m_WasIdle)
+		ReclaimIdleMemory();
+
+	m_WasIdle = idle;
+}
+
+void HeadlessMonitor::ReclaimIdleMemory()
+{
+	const size_t ramBefore = Processes::GetCurrentRAMUsage();
+
+	size_t players = 0;
+	for (auto& session : m_Sessions)
+		players += session->ReleaseIdleMemory();
+
+	Processes::TrimMemory();
+	const size_t ramAfter = Processes::GetCurrentRAMUsage();
+
+	Log("All sessions out of a match, released {} player(s). RAM usage {:1.1f} MB -> {:1.1f} MB",
+		players, ramBefore / 1024.0f / 1024, ramAfter / 1024.0f / 1024);
+}
+
+HeadlessMonitor::Session::Session(HeadlessMonitor& monitor, std::optional<SessionInfo> info, size_t index) :
+	m_Monitor(&monitor),
+	m_Info(std::move(info)),
+	m_Index(index),
+	m_WorldState(IWorldState::Create(m_Settings)),
+	m_ActionManager(IRCONActionManager::Create(m_Settings, *m_WorldState))
+{
+	m_Settings.ShareHTTPClient(monitor.m_Settings);
+
+	if (m_Info)
+	{
+		m_Settings.m_TFDirOverride = m_Info->m_TFDir;
+		if (m_Info->m_LocalSteamID.IsValid())
+			m_Settings.m_LocalSteamIDOverride = m_Info->m_LocalSteamID;
+
+		m_Name = m_Info->m_TFDir.string();
+		m_LogPrefix = mh::format("[{}] ", m_Name);
+	}
+
+	m_ActionManager->AddPeriodicActionGenerator<StatusUpdateActionGenerator>(*m_WorldState);
+	m_ActionManager->AddPeriodicActionGenerator<ConfigActionGenerator>(
+		[this] { return m_MainState ? m_MainState->m_Parser.GetConLogFileName() : "console.log"s; });
+	m_ActionManager->AddPeriodicActionGenerator<LobbyDebugActionGenerator>(*m_WorldState);
+}
+
+HeadlessMonitor::Session::PostSetupState::PostSetupState(Session& session) :
+	m_ModeratorLogic(IModeratorLogic::Create(*session.m_WorldState, session.m_Settings, *session.m_ActionManager,
+		session.m_Monitor->m_SharedConfig)),
+	m_SessionSnapshot(*session.m_WorldState, *m_ModeratorLogic, session.m_Settings,
+		session.m_Info ? mh::format("session_snapshot_{}.json", session.m_Index) : "session_snapshot.json"),
+	m_SharedWorldStateExporter(*session.m_WorldState, *m_ModeratorLogic, session.m_Settings,
+		session.m_Index == 0 ? SharedWorldState::REGION_NAME : mh::format("{}_{}", SharedWorldState::REGION_NAME, session.m_Index)),
+	m_Parser(*session.m_WorldState, session.m_Settings, session.m_Settings.GetTFDir() / "console.log")
+{
+	// Everyone's console output in the same file isn't readable
+	m_Parser.SetMirrorToLogFile(session.m_Index == 0);
+}
+
+void HeadlessMonitor::Session::Update()
+{
+	m_WorldState->Update();
+
+	if (m_Settings.m_Unsaved.m_RCONClient)
+		m_Settings.m_Unsaved.m_RCONClient->set_logging(m_Monitor->m_Settings.m_Logging.m_RCONPackets);
+
+	if (UpdateSetup())
+	{
+		if (!m_MainState)
+		{
+			Log("{}Setup complete, monitoring {}", m_LogPrefix, m_Settings.GetTFDir() / "console.log");
+			m_MainState.emplace(*this);
+		}
+
+		// console.log is the fallback whenever rcon can't keep us up to date on its own
+		m_MainState->m_Parser.SetFileInputEnabled(!m_Settings.m_RCONOnlyConsoleInput || !m_ActionManager->IsResponding());
+		m_MainState->m_Parser.Update();
+		m_MainState->m_ModeratorLogic->Update();
+		m_MainState->m_SessionSnapshot.Update();
+		m_MainState->m_SharedWorldStateExporter.Update();
+	}
+
+	m_ActionManager->Update();
+}
+
+bool HeadlessMonitor::Session::IsIdle() const
+{
+	return m_WorldState->GetApproxLobbyMemberCount() == 0 &&
+		(m_WorldState->GetCurrentTime() - m_WorldState->GetLastStatusUpdateTime()) > 60s;
+}
+
+MetricsExporter::Session HeadlessMonitor::Session::GetMetricsSession() const
+{
+	return
+	{
+		.m_Name = m_Name,
+		.m_Parser = m_MainState ? &m_MainState->m_Parser : nullptr,
+		.m_ActionManager = m_ActionManager.get(),
+		.m_ModLogic = m_MainState ? m_MainState->m_ModeratorLogic.get() : nullptr,
+	};
+}
+
+void HeadlessMonitor::Session::SetSetupProblem(std::string problem)
+{
+	if (problem != m_LastSetupProblem)
+	{
+		LogWarning("{}Waiting to start: {}", m_LogPrefix, problem);
+		m_LastSetupProblem = std::move(problem);
+	}
+}
+
+void HeadlessMonitor::Session::ResetSetup()
+{
+	m_MainState.reset();
+	m_Settings.m_Unsaved.m_RCONClient.reset();
+	m_CommandLineArgsTask = {};
+	m_LastSetupAttempt = {};
+}
+
+bool HeadlessMonitor::Session::UpdateSetup()
+{
+	// Whoever launches TF2 on this machine picks a new rcon password each time. Sessions from the
+	// command line already know theirs, and might not even be running on this machine.
+	if (!m_Info && !Processes::IsTF2Running())
+	{
+		if (m_Settings.m_Unsaved.m_RCONClient)
+			Log("TF2 closed, waiting for it to start again");
+
+		ResetSetup();
+		SetSetupProblem("TF2 isn't running");
+		return false;
+	}
+
+	if (m_Settings.m_Unsaved.m_ChatMsgWrappers && m_Settings.m_Unsaved.m_RCONClient)
+		return true;
+
+	if (m_CommandLineArgsTask.valid())
+	{
+		if (!m_CommandLineArgsTask.is_ready())
+			return false;
+
+		const auto args = m_CommandLineArgsTask.get();
+		m_CommandLineArgsTask = {};
+
+		if (args.size() != 1)
+		{
+			SetSetupProblem(mh::format("Expected a single instance of TF2, found {}. Use --session for each of them instead",
+				args.size()));
+			return false;
+		}
+
+		const auto cli = TF2CommandLinePage::TF2CommandLine::Parse(args.front());
+		if (!cli.IsPopulated())
+		{
+			SetSetupProblem(mh::format("TF2 wasn't launched with -usercon, +ip, +rcon_password and +hostport: {}",
+				cli.m_FullCommandLine));
+			return false;
+		}
+
+		m_Settings.m_Unsaved.m_RCONClient = CreateRCONClient(cli.m_RCONPort.value(), cli.m_RCONPassword);
+		DebugLog("Using rcon port {} from TF2's command line", cli.m_RCONPort.value());
+	}
+
+	const auto now = clock_t::now();
+	if ((now - m_LastSetupAttempt) < SETUP_RETRY_INTERVAL)
+		return false;
+
+	m_LastSetupAttempt = now;
+
+	const auto tfDir = m_Settings.GetTFDir();
+	if (tfDir.empty())
+	{
+		SetSetupProblem("Unable to find your tf directory, set it in the settings with the UI first");
+		return false;
+	}
+
+	if (!m_Settings.m_Unsaved.m_ChatMsgWrappers)
+	{
+		try
+		{
+			m_Settings.m_Unsaved.m_ChatMsgWrappers = ChatWrappersGeneratorPage::TryLoadSavedChatWrappers(tfDir);
+		}
+		catch (const std::exception& e)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to load saved chat message wrappers");
+		}
+
+		if (!m_Settings.m_Unsaved.m_ChatMsgWrappers)
+		{
+			SetSetupProblem("No saved chat message wrappers, run without --headless once to generate them");
+			return false;
+		}
+	}
+
+	if (!m_Settings.m_Unsaved.m_RCONClient)
+	{
+		if (m_Info)
+		{
+			m_Settings.m_Unsaved.m_RCONClient = CreateRCONClient(m_Info->m_RCONPort, m_Info->m_RCONPassword);
+		}
+		else if (!m_CommandLineArgsTask.valid())
+		{
+			m_CommandLineArgsTask = []() -> mh::task<std::vector<std::string>>
+			{
+				// The WMI connection setup is synchronous
+				co_await TaskScheduler::Get().co_schedule(TaskLane::IO);
+				co_return co_await Processes::GetTF2CommandLineArgsAsync();
+			}();
+		}
+	}
+
+	return false;
+}
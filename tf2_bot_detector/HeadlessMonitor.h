@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Actions/RCONActionManager.h"
+#include "Clock.h"
+#include "ConsoleLog/ConsoleLogParser.h"
+#include "Config/Settings.h"
+#include "MetricsExporter.h"
+#include "ModeratorLogic.h"
+#include "SessionSnapshot.h"
+#include "SharedWorldStateExporter.h"
+#include "SteamID.h"
+#include "WorldState.h"
+
+#include <mh/coroutine/task.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	// Runs everything but the UI (--headless): console log parsing, moderation and RCON actions,
+	// with no window, textures or fonts. There's no setup flow either, so it expects a machine
+	// that has already been set up with the UI at least once. Chat wrappers are loaded from the
+	// last time they were generated, and the RCON password and port are read from TF2's command
+	// line once it's running.
+	//
+	// It can also watch several TF2 clients at once (--session). Each one gets its own world
+	// state, console log parser and RCON connection, while the playerlists, rules, HTTP client
+	// and temp db are shared between all of them.
+	class HeadlessMonitor final
+	{
+	public:
+		// A TF2 client we were told about on the command line, instead of going looking for one
+		struct SessionInfo
+		{
+			std::filesystem::path m_TFDir;
+			uint16_t m_RCONPort{};
+			std::string m_RCONPassword;
+			SteamID m_LocalSteamID;
+		};
+
+		// With no sessions, monitors the one TF2 client found through the settings and its command line
+		HeadlessMonitor(std::vector<SessionInfo> sessions = {});
+		~HeadlessMonitor();
+
+		// There's nothing to wait on like vsync, so the event loop sleeps this long between updates
+		static constexpr duration_t UPDATE_INTERVAL = std::chrono::milliseconds(50);
+
+		void Update();
+
+		// Set from the SIGINT/SIGTERM handler
+		static void RequestQuit() { s_QuitRequested = true; }
+		bool ShouldQuit() const { return s_QuitRequested; }
+
+	private:
+		static constexpr duration_t SETUP_RETRY_INTERVAL = std::chrono::seconds(5);
+		static constexpr std::chrono::steady_clock::duration MAIN_THREAD_TASK_BUDGET = std::chrono::milliseconds(10);
+
+		static inline std::atomic_bool s_QuitRequested = false;
+
+		// Everything that belongs to a single TF2 client
+		class Session final
+		{
+		public:
+			Session(HeadlessMonitor& monitor, std::optional<SessionInfo> info, size_t index);
+
+			void Update();
+			bool IsIdle() const;
+			MetricsExporter::Session GetMetricsSession() const;
+			size_t ReleaseIdleMemory() { return m_WorldState->ReleaseIdleMemory(); }
+
+		private:
+			// Everything the setup flow would have taken care of. Returns true once we can start.
+			bool UpdateSetup();
+			void ResetSetup();
+			time_point_t m_LastSetupAttempt{};
+			std::string m_LastSetupProblem;
+			void SetSetupProblem(std::string problem);
+			mh::task<std::vector<std::string>> m_CommandLineArgsTask;
+
+			HeadlessMonitor* m_Monitor = nullptr;
+			std::optional<SessionInfo> m_Info;
+			size_t m_Index = 0;
+			std::string m_Name;       // Empty unless this was given on the command line
+			std::string m_LogPrefix;
+
+			Settings m_Settings;
+			std::shared_ptr<IWorldState> m_WorldState;
+			std::unique_ptr<IRCONActionManager> m_ActionManager;
+
+			struct PostSetupState
+			{
+				PostSetupState(Session& session);
+
+				std::unique_ptr<IModeratorLogic> m_ModeratorLogic;
+				SessionSnapshotManager m_SessionSnapshot;
+				SharedWorldStateExporter m_SharedWorldStateExporter;
+				ConsoleLogParser m_Parser;
+			};
+			std::optional<PostSetupState> m_MainState;
+		};
+
+		Settings m_Settings;
+		IModeratorLogic::SharedConfig m_SharedConfig;
+		std::vector<std::unique_ptr<Session>> m_Sessions;
+		MetricsExporter m_MetricsExporter{ m_Settings };
+		std::vector<MetricsExporter::Session> m_MetricsSessions;
+
+		bool m_WasIdle = true;  // See MainWindow::ReclaimIdleMemory()
+		void ReclaimIdleMemory();
+	};
+}
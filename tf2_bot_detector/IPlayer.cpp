@@ -2,8 +2,36 @@
 #include "WorldState.h"
 #include "Util/TextUtils.h"
 
+#include <atomic>
+#include <cassert>
+#include <exception>
+
 using namespace tf2_bot_detector;
 
+PlayerDataStorage::~PlayerDataStorage()
+{
+	for (Slot& slot : m_Slots)
+	{
+		if (slot.m_Data)
+			slot.m_Deleter(slot.m_Data);
+	}
+}
+
+size_t PlayerDataStorage::AllocateSlot()
+{
+	static std::atomic<size_t> s_NextSlot = 0;
+
+	const size_t slot = s_NextSlot++;
+	if (slot >= MAX_SLOTS)
+	{
+		// This runs during static initialization, there's nothing that could catch an exception
+		assert(!"Ran out of player data slots, increase PlayerDataStorage::MAX_SLOTS");
+		std::terminate();
+	}
+
+	return slot;
+}
+
 duration_t IPlayer::GetTimeSinceLastStatusUpdate() const
 {
 	return GetWorld().GetCurrentTime() - GetLastStatusUpdateTime();
@@ -6,11 +6,12 @@
 
 #include <mh/error/expected.hpp>
 
-#include <any>
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <ostream>
-#include <typeindex>
+#include <utility>
 
 namespace tf2_bot_detector
 {
@@ -39,6 +40,45 @@ namespace tf2_bot_detector
 		uint16_t m_LocalDeaths = 0;
 	};
 
+	// Data other modules (moderation, the UI...) attach to a player. Every type is given its own slot
+	// once at startup, so finding it again is just an array index instead of a map lookup.
+	class PlayerDataStorage final
+	{
+	public:
+		static constexpr size_t MAX_SLOTS = 8;
+
+		PlayerDataStorage() = default;
+		PlayerDataStorage(const PlayerDataStorage&) = delete;
+		PlayerDataStorage& operator=(const PlayerDataStorage&) = delete;
+		~PlayerDataStorage();
+
+		template<typename T> const T* Find() const { return static_cast<const T*>(m_Slots[SLOT<T>].m_Data); }
+		template<typename T> T* Find() { return static_cast<T*>(m_Slots[SLOT<T>].m_Data); }
+
+		template<typename T, typename... TArgs> T& GetOrCreate(TArgs&&... args)
+		{
+			Slot& slot = m_Slots[SLOT<T>];
+			if (!slot.m_Data)
+			{
+				slot.m_Data = new T(std::forward<TArgs>(args)...);
+				slot.m_Deleter = [](void* data) { delete static_cast<T*>(data); };
+			}
+
+			return *static_cast<T*>(slot.m_Data);
+		}
+
+	private:
+		static size_t AllocateSlot();
+		template<typename T> static inline const size_t SLOT = AllocateSlot();
+
+		struct Slot
+		{
+			void* m_Data = nullptr;
+			void (*m_Deleter)(void*) = nullptr;
+		};
+		std::array<Slot, MAX_SLOTS> m_Slots{};
+	};
+
 	class IPlayer : public std::enable_shared_from_this<IPlayer>
 	{
 	public:
@@ -89,32 +129,26 @@ namespace tf2_bot_detector
 
 		template<typename T> inline T* GetData()
 		{
-			return const_cast<T*>(std::as_const(*this).GetData<T>());
+			return GetDataStorage().Find<T>();
 		}
 		template<typename T, typename... TArgs> inline T& GetOrCreateData(TArgs&&... args)
 		{
-			auto& storage = GetOrCreateDataStorage(typeid(T));
-			if (!storage.has_value())
-				return storage.emplace<T>(std::forward<TArgs>(args)...);
-			else
-				return std::any_cast<T&>(storage);
+			return GetDataStorage().GetOrCreate<T>(std::forward<TArgs>(args)...);
 		}
 		template<typename T> inline const T* GetData() const
 		{
-			return std::any_cast<T>(FindDataStorage(typeid(T)));
+			return GetDataStorage().Find<T>();
 		}
-		template<typename T> inline bool SetData(T&& value)
+		template<typename T> inline void SetData(T&& value)
 		{
-			GetOrCreateDataStorage(typeid(T)) = std::move(value);
+			GetOrCreateData<std::decay_t<T>>() = std::forward<T>(value);
 		}
 
-		virtual std::any& GetOrCreateDataStorage(const std::type_index& type) = 0;
-
 	protected:
-		virtual const std::any* FindDataStorage(const std::type_index& type) const = 0;
-		virtual std::any* FindDataStorage(const std::type_index& type)
+		virtual const PlayerDataStorage& GetDataStorage() const = 0;
+		virtual PlayerDataStorage& GetDataStorage()
 		{
-			return const_cast<std::any*>(std::as_const(*this).FindDataStorage(type));
+			return const_cast<PlayerDataStorage&>(std::as_const(*this).GetDataStorage());
 		}
 	};
 }
@@ -1,5 +1,13 @@
 #include "../DLLMain.h"
 
+#ifdef TF2BD_USE_MIMALLOC
+#include <mimalloc.h>
+
+// Keeps the import of mimalloc-override.dll from being dropped. It has to be loaded before our dll
+// and its dependencies so that all of them end up allocating from mimalloc (see mimalloc-redirect).
+static const int s_MimallocVersion = mi_version();
+#endif
+
 #ifdef WIN32
 #include <Windows.h>
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine, int nCmdShow)
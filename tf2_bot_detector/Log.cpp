@@ -1,9 +1,14 @@
 #include "Log.h"
+#include "Util/AhoCorasick.h"
+#include "Util/MPSCQueue.h"
 #include "Util/PathUtils.h"
+#include "Util/RingBuffer.h"
 #include "Filesystem.h"
 
 #include <imgui.h>
 #include <mh/compiler.hpp>
+#include <mh/concurrency/thread_pool.hpp>
+#include <mh/coroutine/task.hpp>
 #include <mh/error/exception_details.hpp>
 #include <mh/text/codecvt.hpp>
 #include <mh/text/fmtstr.hpp>
@@ -11,14 +16,18 @@
 #include <mh/text/string_insertion.hpp>
 #include <mh/text/stringops.hpp>
 #include <SDL2/SDL_messagebox.h>
+#include <zlib.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
-#include <deque>
+#include <condition_variable>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <mutex>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 #ifdef _WIN32
@@ -38,14 +47,19 @@ namespace
 	class LogManager final : public ILogManager
 	{
 	public:
+		~LogManager();
+
 		void Init() override;
 
 		void Log(std::string msg, const LogMessageColor& color, LogSeverity severity,
 			LogVisibility visibility = LogVisibility::Default, time_point_t timestamp = tfbd_clock_t::now()) override;
-		void LogToStream(std::string msg, std::ostream& output, time_point_t timestamp = tfbd_clock_t::now(), bool skipScrub = false) const;
+		void LogDeferred(std::function<std::string()> formatter, const LogMessageColor& color, LogSeverity severity,
+			LogVisibility visibility = LogVisibility::Default, time_point_t timestamp = tfbd_clock_t::now()) override;
 
-		const std::filesystem::path& GetFileName() const override { return m_FileName; }
+		const std::filesystem::path& GetFileName() const override { return m_FileName; } // Current segment
 		mh::generator<const LogMessage&> GetVisibleMsgs() const override;
+		uint64_t GetFirstVisibleMsgSequence() const override;
+		std::vector<std::shared_ptr<const LogMessage>> GetVisibleMsgsSince(uint64_t firstSequence) const override;
 		void ClearVisibleMsgs() override;
 
 		std::ostream& GetLogStream();
@@ -56,6 +70,9 @@ namespace
 
 		void AddSecret(std::string value, std::string replace) override;
 
+		void Flush() override;
+		void SetConsoleLogCompressed(bool compressed) override;
+
 	private:
 		bool m_IsInit = false;
 		void EnsureInit(MH_SOURCE_LOCATION_AUTO(location)) const;
@@ -63,9 +80,42 @@ namespace
 		std::filesystem::path m_FileName;
 		std::optional<std::stringstream> m_TempLogs = std::stringstream();   // Logs before we have been initialized
 		std::optional<std::ofstream> m_File;
-		mutable std::recursive_mutex m_LogMutex;
-		std::deque<LogMessage> m_LogMessages;
-		size_t m_VisibleLogMessagesStart = 0;
+		std::string m_LogTimestamp; // Every file from this session has it in its name
+		mutable std::recursive_mutex m_LogMutex; // Log stream and secrets, only the writer thread takes it once running
+
+		// Log() just pushes records in here. Scrubbing secrets and all the I/O happens in batches on
+		// m_WriterThread, so nobody logging from the parse/HTTP paths waits on the disk or on each other.
+		struct LogRecord
+		{
+			time_point_t m_Timestamp{};
+			std::string m_Text;
+			LogMessageColor m_Color;
+			bool m_Visible = false;
+			std::function<std::string()> m_Formatter; // If set, m_Text is filled in by the writer
+		};
+		void QueueRecord(LogRecord&& record);
+		static constexpr size_t MAX_PENDING_RECORDS = 1024;
+		MPSCQueue<LogRecord, MAX_PENDING_RECORDS> m_PendingRecords;
+		std::atomic<uint64_t> m_QueuedRecordCount = 0;
+		std::atomic<uint64_t> m_WrittenRecordCount = 0;
+		std::atomic_bool m_WriterIdle = false;
+		std::atomic_bool m_StopWriter = false;
+		std::atomic_bool m_WriterRunning = false;
+		std::mutex m_WriterWakeMutex;
+		std::condition_variable m_WriterWake;
+		std::thread m_WriterThread;
+		void WakeWriter();
+		void WriterThreadFunc();
+		void WriteRecords(LogRecord* records, size_t count);
+		bool IsWriterThread() const { return std::this_thread::get_id() == m_WriterThread.get_id(); }
+
+		static constexpr size_t MAX_LOG_MESSAGES = 500;
+		// Messages are immutable once they're in here, so GetVisibleMsgs() only holds the lock long
+		// enough to grab a range of pointers, not for the whole time the UI is drawing them
+		mutable std::mutex m_LogMessagesMutex;
+		RingBuffer<std::shared_ptr<const LogMessage>, MAX_LOG_MESSAGES> m_LogMessages;
+		uint64_t m_NextLogMessageSequence = 0;
+		uint64_t m_VisibleLogMessagesStart = 0; // Sequence of the first message that hasn't been cleared
 
 		struct Secret
 		{
@@ -73,12 +123,57 @@ namespace
 			std::string m_Replacement;
 		};
 		std::vector<Secret> m_Secrets;
+		AhoCorasick m_SecretMatcher; // Pattern indices match m_Secrets
 		void ReplaceSecrets(std::string& str) const;
 
-		static constexpr size_t MAX_LOG_MESSAGES = 500;
-
+		// Console output is mirrored to logs/console in big chunks by the writer thread, instead of
+		// hitting the disk (and flushing) for every read ConsoleLogParser does
+		static constexpr size_t CONSOLE_LOG_FLUSH_SIZE = 64 * 1024;
+		static constexpr duration_t CONSOLE_LOG_FLUSH_INTERVAL = std::chrono::seconds(2);
 		mutable std::recursive_mutex m_ConsoleLogMutex;
+		std::string m_PendingConsoleOutput;
+		bool m_ConsoleLogCompressed = false;
+		void WriteConsoleOutput(bool force);
+
+		// Only touched by whoever is writing the console log
+		struct GZFileDeleter final
+		{
+			void operator()(gzFile file) const { gzclose(file); }
+		};
+		std::filesystem::path m_ConsoleLogDir;
+		std::filesystem::path m_ConsoleLogFileName;
 		std::ofstream m_ConsoleLogFile;
+		std::unique_ptr<gzFile_s, GZFileDeleter> m_ConsoleLogGZFile;
+		bool m_ConsoleLogOpenFailed = false;
+		time_point_t m_LastConsoleLogWrite{};
+		bool OpenConsoleLog(bool compressed);
+
+		// Log files are split into segments so a session that runs for days doesn't leave one
+		// enormous file behind. Finished segments (and leftovers from previous sessions) are
+		// gzipped on m_MaintenanceThread.
+		static constexpr uint64_t MAX_LOG_SEGMENT_SIZE = 16 * 1024 * 1024;
+		static constexpr duration_t MAX_LOG_SEGMENT_AGE = std::chrono::hours(24);
+		struct LogSegment
+		{
+			uint32_t m_Index = 0;
+			uint64_t m_Bytes = 0;
+			time_point_t m_StartTime = tfbd_clock_t::now();
+
+			bool IsFull() const;
+			std::string GetSuffix() const; // Goes between the timestamp and the extension
+		};
+		LogSegment m_LogSegment;
+		LogSegment m_ConsoleLogSegment;
+		void RotateLogFile();
+		void RotateConsoleLog();
+		void QueueCompressLogFile(std::filesystem::path path);
+		mh::task<> CompressLogFileAsync(std::filesystem::path path);
+		mh::task<> CleanupLogFilesAsync();
+		std::mutex m_MaintenanceTasksMutex;
+		std::vector<mh::task<>> m_MaintenanceTasks;
+
+		// Last, so it's gone (and done with everything above) before the rest of us
+		mh::thread_pool m_MaintenanceThread{ 1 };
 	};
 
 	static LogManager& GetLogState()
@@ -108,6 +203,7 @@ void LogManager::Init()
 
 		const auto t = ToTM(tfbd_clock_t::now());
 		const mh::fmtstr<128> timestampStr("{}", std::put_time(&t, "%Y-%m-%d_%H-%M-%S"));
+		m_LogTimestamp = timestampStr;
 
 		// Pick file name
 		{
@@ -155,37 +251,151 @@ void LogManager::Init()
 			}
 			else
 			{
-				auto logPath = logDir / mh::fmtstr<128>("console_{}.log", timestampStr).view();
-				m_ConsoleLogFile = std::ofstream(logPath, std::ofstream::ate | std::ofstream::binary);
-				if (!m_ConsoleLogFile.good())
-					::LogWarning("Failed to open console log file {}. Console output will not be logged.", logPath);
+				// Opened once there's something to write, so the compression setting has been loaded by then
+				m_ConsoleLogDir = std::move(logDir);
 			}
 		}
 
 		m_IsInit = true;
+		m_WriterThread = std::thread(&LogManager::WriterThreadFunc, this);
+		m_WriterRunning.store(true, std::memory_order_release);
 	}
 }
 
-void LogManager::LogToStream(std::string msg, std::ostream& output, time_point_t timestamp, bool skipScrub) const
+LogManager::~LogManager()
 {
-	std::lock_guard lock(m_LogMutex);
+	if (m_WriterRunning)
+	{
+		// Anything logged from here on (other static destructors) is written synchronously
+		m_WriterRunning = false;
+		m_StopWriter = true;
+		WakeWriter();
+		m_WriterThread.join();
+	}
 
-	if (!skipScrub)
-		ReplaceSecrets(msg);
+	WriteConsoleOutput(true);
+}
 
-	tm t = ToTM(timestamp);
-	const auto WriteToStream = [&](std::ostream& str)
+void LogManager::WakeWriter()
+{
+	// Only when it said it was going to sleep. The empty lock makes sure it's actually waiting
+	// (and will see m_WriterIdle == false) rather than about to.
+	if (m_WriterIdle.exchange(false))
 	{
-		str << '[' << std::put_time(&t, "%T") << "] " << msg << std::endl;
-	};
+		{ std::lock_guard lock(m_WriterWakeMutex); }
+		m_WriterWake.notify_one();
+	}
+}
 
-	WriteToStream(output);
-	if (&output != &std::cout)
-		WriteToStream(std::cout);
+void LogManager::WriteRecords(LogRecord* records, size_t count)
+{
+	std::lock_guard lock(m_LogMutex);
+
+	std::ostringstream text;
+	for (size_t i = 0; i < count; i++)
+	{
+		LogRecord& record = records[i];
+		if (record.m_Formatter)
+		{
+			record.m_Text = record.m_Formatter();
+			record.m_Formatter = nullptr;
+		}
+
+		ReplaceSecrets(record.m_Text);
+
+		const tm t = ToTM(record.m_Timestamp);
+		text << '[' << std::put_time(&t, "%T") << "] " << record.m_Text << '\n';
 
 #ifdef _WIN32
-	OutputDebugStringA(mh::format("Log: {}\n", msg).c_str());
+		OutputDebugStringA(mh::format("Log: {}\n", record.m_Text).c_str());
 #endif
+	}
+
+	const std::string& str = text.str();
+	GetLogStream() << str << std::flush;
+	std::cout << str << std::flush;
+
+	if (m_File)
+	{
+		m_LogSegment.m_Bytes += str.size();
+		if (m_LogSegment.IsFull())
+			RotateLogFile();
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		LogRecord& record = records[i];
+		if (!record.m_Visible)
+			continue;
+
+		const auto& color = record.m_Color;
+		auto logMsg = std::make_shared<LogMessage>(LogMessage{ record.m_Timestamp, std::move(record.m_Text), { color.r, color.g, color.b, color.a } });
+		logMsg->m_TrackedMemory.SetBytes(sizeof(*logMsg) + logMsg->m_Text.capacity());
+
+		std::lock_guard messagesLock(m_LogMessagesMutex);
+		logMsg->m_Sequence = m_NextLogMessageSequence++;
+		m_LogMessages.push_back(std::move(logMsg));
+	}
+}
+
+void LogManager::WriterThreadFunc()
+{
+	constexpr size_t MAX_BATCH_SIZE = 64;
+	std::array<LogRecord, MAX_BATCH_SIZE> batch;
+
+	while (true)
+	{
+		size_t count = 0;
+		while (count < batch.size())
+		{
+			auto record = m_PendingRecords.try_pop();
+			if (!record)
+				break;
+
+			batch[count++] = std::move(*record);
+		}
+
+		if (count > 0)
+		{
+			WriteRecords(batch.data(), count);
+			m_WrittenRecordCount.fetch_add(count, std::memory_order_release);
+			continue;
+		}
+
+		WriteConsoleOutput(m_StopWriter);
+
+		if (m_StopWriter)
+			break;
+
+		// Producers only bother waking us up if we said we were going to sleep, so check once
+		// more after saying so in case something came in just before
+		m_WriterIdle = true;
+		if (auto record = m_PendingRecords.try_pop())
+		{
+			m_WriterIdle = false;
+			WriteRecords(&*record, 1);
+			m_WrittenRecordCount.fetch_add(1, std::memory_order_release);
+			continue;
+		}
+
+		// Wakes up on its own now and then for the console log's time-based flush
+		std::unique_lock lock(m_WriterWakeMutex);
+		m_WriterWake.wait_for(lock, CONSOLE_LOG_FLUSH_INTERVAL, [&] { return !m_WriterIdle; });
+		m_WriterIdle = false;
+	}
+}
+
+void LogManager::Flush()
+{
+	if (!m_WriterRunning.load(std::memory_order_acquire) || IsWriterThread())
+		return; // Nothing queued, everything is written as it's logged
+
+	const uint64_t target = m_QueuedRecordCount.load(std::memory_order_acquire);
+	while (m_WrittenRecordCount.load(std::memory_order_acquire) < target)
+	{
+		WakeWriter();
+		std::this_thread::sleep_for(1ms);
+	}
 }
 
 void LogManager::AddSecret(std::string value, std::string replace)
@@ -205,6 +415,9 @@ void LogManager::AddSecret(std::string value, std::string replace)
 		}
 	}
 
+	m_SecretMatcher.AddPattern(value);
+	m_SecretMatcher.Build();
+
 	m_Secrets.push_back(Secret
 		{
 			.m_Value = std::move(value),
@@ -215,21 +428,59 @@ void LogManager::AddSecret(std::string value, std::string replace)
 void LogManager::ReplaceSecrets(std::string& msg) const
 {
 	std::lock_guard lock(m_LogMutex);
-	for (const auto& scrubbed : m_Secrets)
+
+	struct Match
+	{
+		size_t m_Begin;
+		size_t m_End;
+		size_t m_Secret;
+	};
+
+	// Almost no message has a secret in it, and those get through without any allocations
+	std::vector<Match> matches;
+	m_SecretMatcher.ForEachMatch(msg, [&](size_t secret, size_t begin, size_t end)
+		{
+			matches.push_back({ begin, end, secret });
+		});
+
+	if (matches.empty())
+		return;
+
+	// Leftmost, then longest wins where secrets overlap, so no part of a longer one is left behind
+	std::sort(matches.begin(), matches.end(), [](const Match& lhs, const Match& rhs)
+		{
+			if (lhs.m_Begin != rhs.m_Begin)
+				return lhs.m_Begin < rhs.m_Begin;
+
+			return lhs.m_End > rhs.m_End;
+		});
+
+	std::string scrubbed;
+	scrubbed.reserve(msg.size());
+
+	size_t copied = 0;
+	for (const Match& match : matches)
 	{
-		size_t index = msg.find(scrubbed.m_Value);
-		while (index != msg.npos)
+		if (match.m_Begin < copied)
 		{
-			msg.erase(index, scrubbed.m_Value.size());
-			msg.insert(index, scrubbed.m_Replacement);
-			index = msg.find(scrubbed.m_Value, index + scrubbed.m_Replacement.size());
+			// Overlaps one we already replaced, whatever sticks out past it is still part of a secret
+			copied = std::max(copied, match.m_End);
+			continue;
 		}
+
+		scrubbed.append(msg, copied, match.m_Begin - copied);
+		scrubbed.append(m_Secrets[match.m_Secret].m_Replacement);
+		copied = match.m_End;
 	}
+
+	scrubbed.append(msg, copied);
+	msg = std::move(scrubbed);
 }
 
 void tf2_bot_detector::LogFatalError(const mh::source_location& location, const std::string_view& msg)
 {
 	LogError(location, msg);
+	ILogManager::GetInstance().Flush();
 
 	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Fatal error",
 		mh::format(
@@ -257,6 +508,8 @@ void tf2_bot_detector::LogException(const mh::source_location& location, const s
 
 	if (severity == LogSeverity::Fatal)
 	{
+		ILogManager::GetInstance().Flush();
+
 		auto dialogText = mh::format(
 			R"({}
 
@@ -280,15 +533,22 @@ location.function_name());
 	}
 }
 
+std::string detail::log_h::FormatWithLocation(const mh::source_location& location, const std::string_view& str)
+{
+	return mh::format(MH_FMT_STRING("{}: {}"sv), location, str);
+}
+
 void detail::log_h::LogImpl(const LogMessageColor& color, LogSeverity severity, LogVisibility visibility, std::string str)
 {
-	ILogManager::GetInstance().Log(std::move(str), color, severity, visibility);
+	if (IsLogEnabled(visibility))
+		ILogManager::GetInstance().Log(std::move(str), color, severity, visibility);
 }
 
 void tf2_bot_detector::detail::log_h::LogImpl(const LogMessageColor& color, LogSeverity severity, LogVisibility visibility,
 	const mh::source_location& location, const std::string_view& str)
 {
-	LogImpl(color, severity, visibility, mh::format(MH_FMT_STRING("{}: {}"sv), location, str));
+	if (IsLogEnabled(visibility))
+		LogImpl(color, severity, visibility, FormatWithLocation(location, str));
 }
 
 void detail::log_h::LogImplBase(const LogMessageColor& color, LogSeverity severity, LogVisibility visibility,
@@ -306,44 +566,90 @@ void detail::log_h::LogImplBase(const LogMessageColor& color, LogSeverity severi
 void LogManager::Log(std::string msg, const LogMessageColor& color,
 	LogSeverity severity, LogVisibility visibility, time_point_t timestamp)
 {
-	std::lock_guard lock(m_LogMutex);
-	ReplaceSecrets(msg);
+	QueueRecord(LogRecord{ timestamp, std::move(msg), color, !(visibility == LogVisibility::Debug && !mh::is_debug) });
+}
 
-	LogToStream(msg, GetLogStream(), timestamp, true);
+void LogManager::LogDeferred(std::function<std::string()> formatter, const LogMessageColor& color,
+	LogSeverity severity, LogVisibility visibility, time_point_t timestamp)
+{
+	QueueRecord(LogRecord{ timestamp, {}, color, !(visibility == LogVisibility::Debug && !mh::is_debug), std::move(formatter) });
+}
 
-	if (!(visibility == LogVisibility::Debug && !mh::is_debug))
+void LogManager::QueueRecord(LogRecord&& record)
+{
+	// Before Init(), or logging from inside the writer itself
+	if (!m_WriterRunning.load(std::memory_order_acquire) || IsWriterThread())
 	{
-		m_LogMessages.push_back({ timestamp, std::move(msg), { color.r, color.g, color.b, color.a } });
+		WriteRecords(&record, 1);
+		return;
+	}
 
-		if (m_IsInit && m_LogMessages.size() > MAX_LOG_MESSAGES)
-		{
-			m_LogMessages.erase(m_LogMessages.begin(),
-				std::next(m_LogMessages.begin(), m_LogMessages.size() - MAX_LOG_MESSAGES));
-		}
+	while (!m_PendingRecords.try_push(record))
+	{
+		// The writer has fallen behind, give it a moment to catch up rather than dropping anything
+		WakeWriter();
+		std::this_thread::yield();
 	}
+
+	m_QueuedRecordCount.fetch_add(1, std::memory_order_release);
+	WakeWriter();
 }
 
 mh::generator<const LogMessage&> LogManager::GetVisibleMsgs() const
 {
 	EnsureInit();
 
-	std::lock_guard lock(m_LogMutex);
+	std::vector<std::shared_ptr<const LogMessage>> snapshot;
+	{
+		std::lock_guard lock(m_LogMessagesMutex);
+
+		const uint64_t firstStored = m_NextLogMessageSequence - m_LogMessages.size();
+		const uint64_t start = std::max(m_VisibleLogMessagesStart, firstStored);
+
+		snapshot.reserve(size_t(m_NextLogMessageSequence - start));
+		for (uint64_t i = start; i < m_NextLogMessageSequence; i++)
+			snapshot.push_back(m_LogMessages[size_t(i - firstStored)]);
+	}
+
+	for (const auto& msg : snapshot)
+		co_yield *msg;
+}
+
+uint64_t LogManager::GetFirstVisibleMsgSequence() const
+{
+	EnsureInit();
+
+	std::lock_guard lock(m_LogMessagesMutex);
+	return std::max(m_VisibleLogMessagesStart, m_NextLogMessageSequence - m_LogMessages.size());
+}
+
+std::vector<std::shared_ptr<const LogMessage>> LogManager::GetVisibleMsgsSince(uint64_t firstSequence) const
+{
+	EnsureInit();
+
+	std::lock_guard lock(m_LogMessagesMutex);
 
-	size_t start = m_VisibleLogMessagesStart;
-	if (m_LogMessages.size() > MAX_LOG_MESSAGES)
-		start = std::max(start, m_LogMessages.size() - MAX_LOG_MESSAGES);
+	const uint64_t firstStored = m_NextLogMessageSequence - m_LogMessages.size();
+	const uint64_t start = std::max({ firstSequence, m_VisibleLogMessagesStart, firstStored });
+
+	std::vector<std::shared_ptr<const LogMessage>> retVal;
+	if (start < m_NextLogMessageSequence)
+	{
+		retVal.reserve(size_t(m_NextLogMessageSequence - start));
+		for (uint64_t i = start; i < m_NextLogMessageSequence; i++)
+			retVal.push_back(m_LogMessages[size_t(i - firstStored)]);
+	}
 
-	for (size_t i = start; i < m_LogMessages.size(); i++)
-		co_yield m_LogMessages[i];
+	return retVal;
 }
 
 void LogManager::ClearVisibleMsgs()
 {
 	EnsureInit();
 
-	std::lock_guard lock(m_LogMutex);
 	DebugLog("Clearing visible log messages...");
-	m_VisibleLogMessagesStart = m_LogMessages.size();
+	std::lock_guard lock(m_LogMessagesMutex);
+	m_VisibleLogMessagesStart = m_NextLogMessageSequence;
 }
 
 std::ostream& LogManager::GetLogStream() try
@@ -362,28 +668,255 @@ void LogManager::LogConsoleOutput(const std::string_view& consoleOutput)
 {
 	EnsureInit();
 
+	bool wakeWriter;
+	{
+		std::lock_guard lock(m_ConsoleLogMutex);
+		m_PendingConsoleOutput.append(consoleOutput);
+		wakeWriter = m_PendingConsoleOutput.size() >= CONSOLE_LOG_FLUSH_SIZE;
+	}
+
+	if (wakeWriter)
+		WakeWriter();
+}
+
+void LogManager::SetConsoleLogCompressed(bool compressed)
+{
 	std::lock_guard lock(m_ConsoleLogMutex);
-	m_ConsoleLogFile << consoleOutput << std::flush;
+	m_ConsoleLogCompressed = compressed;
 }
 
-void LogManager::CleanupLogFiles() try
+bool LogManager::OpenConsoleLog(bool compressed)
 {
-	EnsureInit();
+	const bool isOpen = compressed ? !!m_ConsoleLogGZFile : m_ConsoleLogFile.is_open();
+	if (isOpen)
+		return true;
+	if (m_ConsoleLogOpenFailed || m_ConsoleLogDir.empty())
+		return false;
+
+	// Switching modes mid-session starts a file with the other extension, and either one is
+	// appended to if we come back to it
+	m_ConsoleLogGZFile.reset();
+	m_ConsoleLogFile.close();
+
+	auto logPath = m_ConsoleLogDir / mh::fmtstr<128>("console_{}{}.log{}", m_LogTimestamp,
+		m_ConsoleLogSegment.GetSuffix(), compressed ? ".gz" : "").view();
+	m_ConsoleLogFileName = logPath;
+
+	if (compressed)
+	{
+#ifdef _WIN32
+		m_ConsoleLogGZFile.reset(gzopen_w(logPath.c_str(), "ab"));
+#else
+		m_ConsoleLogGZFile.reset(gzopen(logPath.c_str(), "ab"));
+#endif
+	}
+	else
+	{
+		m_ConsoleLogFile = std::ofstream(logPath, std::ofstream::app | std::ofstream::binary);
+	}
 
-	constexpr auto MAX_LOG_LIFETIME = 24h * 7;
+	if (compressed ? !m_ConsoleLogGZFile : !m_ConsoleLogFile.good())
 	{
-		std::lock_guard lock(m_LogMutex);
-		DeleteOldFiles("logs", MAX_LOG_LIFETIME);
+		m_ConsoleLogOpenFailed = true;
+		::LogWarning("Failed to open console log file {}. Console output will not be logged.", logPath);
+		return false;
 	}
 
+	return true;
+}
+
+void LogManager::WriteConsoleOutput(bool force)
+{
+	const auto now = tfbd_clock_t::now();
+
+	std::string output;
+	bool compressed;
 	{
 		std::lock_guard lock(m_ConsoleLogMutex);
-		DeleteOldFiles("logs/console", MAX_LOG_LIFETIME);
+		if (m_PendingConsoleOutput.empty())
+			return;
+
+		if (!force && m_PendingConsoleOutput.size() < CONSOLE_LOG_FLUSH_SIZE &&
+			(now - m_LastConsoleLogWrite) < CONSOLE_LOG_FLUSH_INTERVAL)
+		{
+			return;
+		}
+
+		output.swap(m_PendingConsoleOutput);
+		compressed = m_ConsoleLogCompressed;
+	}
+
+	m_LastConsoleLogWrite = now;
+
+	if (!OpenConsoleLog(compressed))
+		return;
+
+	if (compressed)
+	{
+		gzwrite(m_ConsoleLogGZFile.get(), output.data(), unsigned(output.size()));
+		gzflush(m_ConsoleLogGZFile.get(), Z_SYNC_FLUSH); // Readable up to here if we crash
+	}
+	else
+	{
+		m_ConsoleLogFile.write(output.data(), output.size());
+		m_ConsoleLogFile.flush();
+	}
+
+	m_ConsoleLogSegment.m_Bytes += output.size();
+	if (m_ConsoleLogSegment.IsFull())
+		RotateConsoleLog();
+}
+
+bool LogManager::LogSegment::IsFull() const
+{
+	return m_Bytes >= MAX_LOG_SEGMENT_SIZE || (tfbd_clock_t::now() - m_StartTime) >= MAX_LOG_SEGMENT_AGE;
+}
+
+std::string LogManager::LogSegment::GetSuffix() const
+{
+	return m_Index > 0 ? mh::format("_{}", m_Index) : std::string{};
+}
+
+void LogManager::RotateLogFile()
+{
+	std::lock_guard lock(m_LogMutex);
+
+	m_File.reset();
+	QueueCompressLogFile(m_FileName);
+
+	m_LogSegment = { m_LogSegment.m_Index + 1 };
+	m_FileName.replace_filename(mh::fmtstr<128>("{}{}.log", m_LogTimestamp, m_LogSegment.GetSuffix()).view());
+	m_File = std::ofstream(m_FileName, std::ofstream::app | std::ofstream::binary);
+	if (!m_File->good())
+	{
+		// Nowhere else to put them, so back to memory until the next segment
+		m_File.reset();
+		m_TempLogs.emplace();
 	}
 }
-catch (const std::filesystem::filesystem_error& e)
+
+void LogManager::RotateConsoleLog()
 {
-	LogError(MH_SOURCE_LOCATION_CURRENT(), e.what());
+	// Already compressed ones are just closed, the next write opens the next segment
+	if (m_ConsoleLogFile.is_open())
+	{
+		m_ConsoleLogFile.close();
+		QueueCompressLogFile(m_ConsoleLogFileName);
+	}
+
+	m_ConsoleLogGZFile.reset();
+	m_ConsoleLogSegment = { m_ConsoleLogSegment.m_Index + 1 };
+}
+
+static void CompressLogFile(const std::filesystem::path& path) try
+{
+	auto gzPath = path;
+	gzPath += ".gz";
+
+	{
+		std::ifstream input(path, std::ios::binary);
+		if (!input.good())
+			return;
+
+#ifdef _WIN32
+		gzFile output = gzopen_w(gzPath.c_str(), "wb");
+#else
+		gzFile output = gzopen(gzPath.c_str(), "wb");
+#endif
+		if (!output)
+		{
+			LogWarning("Failed to open {} for writing", gzPath);
+			return;
+		}
+
+		std::array<char, 64 * 1024> buf;
+		bool failed = false;
+		while (input && !failed)
+		{
+			input.read(buf.data(), buf.size());
+			if (input.gcount() > 0)
+				failed = gzwrite(output, buf.data(), unsigned(input.gcount())) <= 0;
+		}
+
+		if (gzclose(output) != Z_OK || failed)
+		{
+			LogWarning("Failed to compress {}", path);
+			std::error_code ec;
+			std::filesystem::remove(gzPath, ec);
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::remove(path, ec);
+	if (ec)
+		LogWarning("Compressed {}, but failed to delete the original: {}", path, ec);
+}
+catch (...)
+{
+	LogException("Failed to compress {}", path);
+}
+
+void LogManager::QueueCompressLogFile(std::filesystem::path path)
+{
+	if (path.empty())
+		return;
+
+	std::lock_guard lock(m_MaintenanceTasksMutex);
+	std::erase_if(m_MaintenanceTasks, [](const mh::task<>& task) { return task.is_ready(); });
+	m_MaintenanceTasks.push_back(CompressLogFileAsync(std::move(path)));
+}
+
+mh::task<> LogManager::CompressLogFileAsync(std::filesystem::path path)
+{
+	co_await m_MaintenanceThread.co_add_task();
+	CompressLogFile(path);
+}
+
+void LogManager::CleanupLogFiles()
+{
+	EnsureInit();
+
+	std::lock_guard lock(m_MaintenanceTasksMutex);
+	m_MaintenanceTasks.push_back(CleanupLogFilesAsync());
+}
+
+mh::task<> LogManager::CleanupLogFilesAsync()
+{
+	co_await m_MaintenanceThread.co_add_task();
+
+	constexpr auto MAX_LOG_LIFETIME = 24h * 7;
+	const std::filesystem::path dirs[] = { IFilesystem::Get().GetLogsDir(), m_ConsoleLogDir };
+	for (const auto& dir : dirs)
+	{
+		if (dir.empty())
+			continue;
+
+		DeleteOldFiles(dir, MAX_LOG_LIFETIME);
+
+		try
+		{
+			// Anything left uncompressed by previous sessions. This session's segments are
+			// taken care of as they're rotated.
+			std::vector<std::filesystem::path> leftovers;
+			for (const auto& entry : std::filesystem::directory_iterator(dir))
+			{
+				const auto& path = entry.path();
+				if (entry.is_regular_file() && path.extension() == ".log" &&
+					path.filename().string().find(m_LogTimestamp) == std::string::npos)
+				{
+					leftovers.push_back(path);
+				}
+			}
+
+			for (const auto& path : leftovers)
+				CompressLogFile(path);
+		}
+		catch (const std::filesystem::filesystem_error& e)
+		{
+			LogError(MH_SOURCE_LOCATION_CURRENT(), e.what());
+		}
+	}
 }
 
 void LogManager::EnsureInit(const mh::source_location& location) const
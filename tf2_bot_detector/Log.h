@@ -1,13 +1,20 @@
 #pragma once
 
 #include "Clock.h"
+#include "Util/MemoryTracker.h"
 
 #include <mh/coroutine/generator.hpp>
 #include <mh/text/format.hpp>
 #include <mh/source_location.hpp>
 
+#include <atomic>
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 
 struct ImVec4;
 
@@ -42,6 +49,8 @@ namespace tf2_bot_detector
 		time_point_t m_Timestamp;
 		std::string m_Text;
 		LogMessageColor m_Color;
+		TrackedMemory m_TrackedMemory{ MemoryCategory::LogBuffers };
+		uint64_t m_Sequence = 0; // Goes up by one for each message, never reused
 	};
 
 	namespace LogColors
@@ -84,16 +93,32 @@ namespace tf2_bot_detector
 			LogSeverity severity, LogVisibility visibility,
 			time_point_t timestamp = clock_t::now()) = 0;
 
+		// formatter is called later, on the log writer's thread
+		virtual void LogDeferred(std::function<std::string()> formatter, const LogMessageColor& color,
+			LogSeverity severity, LogVisibility visibility,
+			time_point_t timestamp = clock_t::now()) = 0;
+
 		virtual const std::filesystem::path& GetFileName() const = 0;
 
 		virtual mh::generator<const LogMessage&> GetVisibleMsgs() const = 0;
 		virtual void ClearVisibleMsgs() = 0;
 
+		// For keeping a copy of the visible messages up to date without going over all of them again.
+		// Messages with a sequence below GetFirstVisibleMsgSequence() have been cleared or pushed out,
+		// and GetVisibleMsgsSince() only returns the ones from firstSequence on.
+		virtual uint64_t GetFirstVisibleMsgSequence() const = 0;
+		virtual std::vector<std::shared_ptr<const LogMessage>> GetVisibleMsgsSince(uint64_t firstSequence) const = 0;
+
 		virtual void LogConsoleOutput(const std::string_view& consoleOutput) = 0;
+		virtual void SetConsoleLogCompressed(bool compressed) = 0; // logs/console/*.log.gz
 
 		virtual void CleanupLogFiles() = 0;
 
 		virtual void AddSecret(std::string value, std::string replace) = 0;
+
+		// Log() only queues messages for a background thread. Blocks until everything logged
+		// before this call has been written out.
+		virtual void Flush() = 0;
 	};
 
 #pragma push_macro("NOINLINE")
@@ -106,6 +131,20 @@ namespace tf2_bot_detector
 
 	namespace detail::log_h
 	{
+		inline std::atomic_bool s_DebugLogEnabled = true;
+	}
+
+	// Debug messages are checked against this before their arguments are even formatted
+	inline void SetDebugLogEnabled(bool enabled) { detail::log_h::s_DebugLogEnabled.store(enabled, std::memory_order_relaxed); }
+	inline bool IsLogEnabled(LogVisibility visibility)
+	{
+		return visibility != LogVisibility::Debug || detail::log_h::s_DebugLogEnabled.load(std::memory_order_relaxed);
+	}
+
+	namespace detail::log_h
+	{
+		std::string FormatWithLocation(const mh::source_location& location, const std::string_view& str);
+
 		void LogImpl(const LogMessageColor& color, LogSeverity severity, LogVisibility visibility, std::string str);
 		void LogImpl(const LogMessageColor& color, LogSeverity severity, LogVisibility visibility,
 			const mh::source_location& location, const std::string_view& str);
@@ -119,26 +158,50 @@ namespace tf2_bot_detector
 			const std::string_view& fmtStr, const TArgs&... args) ->
 			decltype(mh::try_format(fmtStr, args...), void())
 		{
-			LogImplBase(color, severity, visibility, fmtStr, mh::make_format_args(args...));
+			if (IsLogEnabled(visibility))
+				LogImplBase(color, severity, visibility, fmtStr, mh::make_format_args(args...));
 		}
 		template<typename... TArgs>
 		NOINLINE inline auto LogImpl(const LogMessageColor& color, LogSeverity severity, LogVisibility visibility,
 			const mh::source_location& location, const std::string_view& fmtStr, const TArgs&... args) ->
 			decltype(mh::try_format(fmtStr, args...), void())
 		{
-			LogImplBase(color, severity, visibility, location, fmtStr, mh::make_format_args(args...));
+			if (IsLogEnabled(visibility))
+				LogImplBase(color, severity, visibility, location, fmtStr, mh::make_format_args(args...));
+		}
+
+		// Arguments that can be copied into a deferred message cheaply and without dangling
+		template<typename T>
+		inline constexpr bool is_deferrable_v = std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+			std::is_same_v<T, std::string>;
+
+		template<typename... TArgs>
+		void LogDeferred(const LogMessageColor& color, LogSeverity severity, LogVisibility visibility,
+			const mh::source_location& location, const std::string_view& fmtStr, const TArgs&... args)
+		{
+			if (!IsLogEnabled(visibility))
+				return;
+
+			ILogManager::GetInstance().LogDeferred([location, fmtStr, capturedArgs = std::make_tuple(args...)]
+				{
+					return std::apply([&](const auto&... values)
+						{
+							return FormatWithLocation(location, mh::try_format(fmtStr, values...));
+						}, capturedArgs);
+				}, color, severity, visibility);
 		}
 
 		struct src_location_wrapper
 		{
 			template<typename T, typename = std::enable_if_t<std::is_constructible_v<std::string_view, T>>>
 			constexpr src_location_wrapper(const T& value, MH_SOURCE_LOCATION_AUTO(location)) :
-				m_Value(value), m_Location(location)
+				m_Value(value), m_Location(location), m_IsLiteral(std::is_array_v<T>)
 			{
 			}
 
 			std::string_view m_Value;
 			mh::source_location m_Location;
+			bool m_IsLiteral; // Will still be around by the time a deferred message is formatted
 		};
 	}
 
@@ -152,6 +215,11 @@ namespace tf2_bot_detector
 	template<typename... TArgs> \
 	inline auto name(const LogMessageColor& color, const detail::log_h::src_location_wrapper& fmtStr, const TArgs&... args) \
 	{ \
+		if constexpr ((detail::log_h::is_deferrable_v<TArgs> && ...)) \
+		{ \
+			if (fmtStr.m_IsLiteral) \
+				return detail::log_h::LogDeferred(color, (severity), (visibility), fmtStr.m_Location, fmtStr.m_Value, args...); \
+		} \
 		name(color, fmtStr.m_Location, fmtStr.m_Value, args...); \
 	} \
 	template<typename... TArgs> \
@@ -162,7 +230,7 @@ namespace tf2_bot_detector
 	template<typename... TArgs> \
 	inline auto name(const detail::log_h::src_location_wrapper& fmtStr, const TArgs&... args) \
 	{ \
-		name(fmtStr.m_Location, fmtStr.m_Value, args...); \
+		name((defaultColor), fmtStr, args...); \
 	} \
 	void name(const LogMessageColor& color, const std::string_view& msg, MH_SOURCE_LOCATION_AUTO(location)); \
 	void name(const std::string_view& msg, MH_SOURCE_LOCATION_AUTO(location)); \
@@ -185,7 +253,8 @@ namespace tf2_bot_detector
 	attr void name(const mh::source_location& location, const std::exception_ptr& e, \
 		const std::string_view& fmtStr = {}, const TArgs&... args) \
 	{ \
-		LogException(location, e, severity, visibility, mh::try_format(fmtStr, args...)); \
+		if (IsLogEnabled(visibility)) \
+			LogException(location, e, severity, visibility, mh::try_format(fmtStr, args...)); \
 	} \
 	template<typename... TArgs> \
 	attr void name(const std::exception_ptr& e, const detail::log_h::src_location_wrapper& fmtStr = {}, const TArgs&... args) \
@@ -0,0 +1,254 @@
+#include "MetricsExporter.h"
+#include "Actions/RCONActionManager.h"
+#include "Config/Settings.h"
+#include "ConsoleLog/ConsoleLogParser.h"
+#include "DB/TempDB.h"
+#include "Networking/HTTPClient.h"
+#include "Platform/Platform.h"
+#include "Util/PrometheusText.h"
+#include "Util/TaskScheduler.h"
+#include "Application.h"
+#include "Log.h"
+#include "ModeratorLogic.h"
+
+#include <mh/text/format.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+using namespace tf2_bot_detector;
+
+using MetricType = PrometheusTextWriter::MetricType;
+
+template<typename TDuration>
+static double ToSeconds(const TDuration& duration)
+{
+	return std::chrono::duration<double>(duration).count();
+}
+
+MetricsExporter::MetricsExporter(const Settings& settings) :
+	m_Settings(&settings)
+{
+}
+
+void MetricsExporter::Update(std::span<const Session> sessions)
+{
+	const auto steadyNow = FrameClock::SteadyNow();
+	if (m_LastFrameTime != std::chrono::steady_clock::time_point{})
+	{
+		const auto frameTime = steadyNow - m_LastFrameTime;
+		m_FrameTimeTotal += frameTime;
+		m_FrameTimeMax = std::max(m_FrameTimeMax, frameTime);
+		m_FrameCount++;
+	}
+	m_LastFrameTime = steadyNow;
+
+	if (m_Settings->m_MetricsFilePath.empty())
+		return;
+
+	const auto now = FrameClock::Now();
+	if ((now - m_LastWriteTime) < WRITE_INTERVAL)
+		return;
+
+	// Slow disk, it'll be written next time around
+	if (m_WriteTask.valid() && !m_WriteTask.is_ready())
+		return;
+
+	m_LastWriteTime = now;
+
+	m_WriteTask = [](std::filesystem::path path, std::string text) -> mh::task<>
+	{
+		co_await TaskScheduler::Get().co_schedule(TaskLane::IO, TaskPriority::Low);
+
+		try
+		{
+			// Collectors might read it at any point, so never leave it half written
+			auto tempPath = path;
+			tempPath += ".tmp";
+			{
+				std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+				file << text;
+				if (!file.good())
+				{
+					LogError("Failed to write metrics to {}", tempPath);
+					co_return;
+				}
+			}
+
+			std::filesystem::rename(tempPath, path);
+		}
+		catch (const std::exception& e)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to write metrics to {}", path);
+		}
+	}(m_Settings->m_MetricsFilePath, BuildText(sessions));
+
+	m_FrameTimeTotal = {};
+	m_FrameTimeMax = {};
+	m_FrameCount = 0;
+}
+
+std::string MetricsExporter::BuildText(std::span<const Session> sessions) const
+{
+	PrometheusTextWriter writer;
+
+	// Process
+	{
+		writer.Add("tf2bd_process_ram_bytes", MetricType::Gauge, "RAM used by this process",
+			double(Processes::GetCurrentRAMUsage()));
+
+		if (m_FrameCount > 0)
+		{
+			writer.Add("tf2bd_frame_interval_seconds_avg", MetricType::Gauge, "Average time between frames since the last write",
+				ToSeconds(m_FrameTimeTotal) / m_FrameCount);
+			writer.Add("tf2bd_frame_interval_seconds_max", MetricType::Gauge, "Longest time between frames since the last write",
+				ToSeconds(m_FrameTimeMax));
+		}
+
+		for (size_t i = 0; i < size_t(TaskLane::COUNT); i++)
+		{
+			const auto lane = TaskLane(i);
+			writer.Add("tf2bd_task_queue_depth", MetricType::Gauge, "Background tasks scheduled but not started yet",
+				double(TaskScheduler::Get().GetQueueDepth(lane)), { { "lane", mh::format("{:v}", mh::enum_fmt(lane)) } });
+		}
+	}
+
+	// HTTP
+	if (const auto client = m_Settings->GetHTTPClient())
+	{
+		const auto counts = client->GetRequestCounts();
+		writer.Add("tf2bd_http_requests_total", MetricType::Counter, "HTTP requests started", counts.m_Total);
+		writer.Add("tf2bd_http_requests_failed_total", MetricType::Counter, "HTTP requests that failed", counts.m_Failed);
+		writer.Add("tf2bd_http_requests_cancelled_total", MetricType::Counter, "HTTP requests dropped before being sent", counts.m_Cancelled);
+		writer.Add("tf2bd_http_requests_in_progress", MetricType::Gauge, "HTTP requests waiting on the server", counts.m_InProgress);
+		writer.Add("tf2bd_http_requests_throttled", MetricType::Gauge, "HTTP requests waiting on a retry or the rate limit", counts.m_Throttled);
+		writer.Add("tf2bd_http_requests_rate_limited", MetricType::Gauge, "HTTP requests waiting on the per-host rate limit", counts.m_RateLimited);
+		writer.Add("tf2bd_http_negative_cache_lookups_total", MetricType::Counter, "Lookups that checked for a remembered failure first", counts.m_NegativeCacheLookups);
+		writer.Add("tf2bd_http_negative_cache_hits_total", MetricType::Counter, "Lookups skipped because of a remembered failure", counts.m_NegativeCacheHits);
+		writer.Add("tf2bd_http_transferred_bytes_total", MetricType::Counter, "Response bytes as received, before decompression", double(counts.m_BytesTransferred));
+		writer.Add("tf2bd_http_received_bytes_total", MetricType::Counter, "Response bytes after decompression", double(counts.m_BytesReceived));
+		writer.Add("tf2bd_http_compressed_responses_total", MetricType::Counter, "HTTP responses sent with a Content-Encoding", counts.m_CompressedResponses);
+
+		for (size_t i = 0; i < size_t(HTTPRequestTag::COUNT); i++)
+		{
+			const auto tag = HTTPRequestTag(i);
+			const auto stats = client->GetTagStats(tag);
+			const PrometheusTextWriter::Labels labels = { { "tag", mh::format("{:v}", mh::enum_fmt(tag)) } };
+			writer.Add("tf2bd_http_tag_requests_total", MetricType::Counter, "HTTP requests per subsystem, including retries", stats.m_Requests, labels);
+			writer.Add("tf2bd_http_tag_requests_failed_total", MetricType::Counter, "Failed HTTP requests per subsystem", stats.m_Failed, labels);
+			writer.Add("tf2bd_http_tag_sent_bytes_total", MetricType::Counter, "Request body bytes per subsystem", double(stats.m_BytesSent), labels);
+			writer.Add("tf2bd_http_tag_transferred_bytes_total", MetricType::Counter, "Response bytes per subsystem, before decompression", double(stats.m_BytesTransferred), labels);
+			writer.Add("tf2bd_http_tag_received_bytes_total", MetricType::Counter, "Response bytes per subsystem, after decompression", double(stats.m_BytesReceived), labels);
+			writer.Add("tf2bd_http_tag_rate_limit_waits_total", MetricType::Counter, "HTTP requests per subsystem that waited on the rate limit", stats.m_RateLimitWaits, labels);
+			writer.Add("tf2bd_http_tag_rate_limit_wait_seconds_total", MetricType::Counter, "Time spent waiting on the rate limit per subsystem", ToSeconds(stats.m_RateLimitWaitTotal), labels);
+		}
+
+		for (const auto& host : client->GetHostStats())
+		{
+			const PrometheusTextWriter::Labels labels = { { "host", host.m_Host } };
+			writer.Add("tf2bd_http_host_requests_total", MetricType::Counter, "HTTP requests per host, including retries", host.m_Requests, labels);
+			writer.Add("tf2bd_http_host_requests_failed_total", MetricType::Counter, "Failed HTTP requests per host", host.m_Failed, labels);
+			writer.Add("tf2bd_http_host_retries_total", MetricType::Counter, "HTTP retries per host", host.m_Retries, labels);
+			writer.Add("tf2bd_http_host_received_bytes_total", MetricType::Counter, "Response bytes per host, after decompression", double(host.m_BytesReceived), labels);
+
+			for (const auto& [quantile, latency] : { std::pair("0.5", host.m_LatencyP50), std::pair("0.95", host.m_LatencyP95), std::pair("0.99", host.m_LatencyP99) })
+			{
+				writer.Add("tf2bd_http_host_latency_seconds", MetricType::Gauge, "HTTP request latency per host, upper bound of the power of two bucket",
+					ToSeconds(latency), { { "host", host.m_Host }, { "quantile", quantile } });
+			}
+		}
+	}
+
+	// Temp db
+	{
+		const auto stats = TF2BDApplication::GetApplication().GetTempDB().GetStats();
+		writer.Add("tf2bd_tempdb_cache_lookups_total", MetricType::Counter, "Temp db cache lookups", stats.m_CacheLookups);
+		writer.Add("tf2bd_tempdb_cache_hits_total", MetricType::Counter, "Temp db cache lookups that found an entry that hadn't expired", stats.m_CacheHits);
+		writer.Add("tf2bd_tempdb_pending_hits_total", MetricType::Counter, "Temp db reads answered by a store that hadn't been written yet", stats.m_PendingHits);
+		writer.Add("tf2bd_tempdb_commits_total", MetricType::Counter, "Temp db write batches committed", stats.m_Commits);
+		writer.Add("tf2bd_tempdb_commit_latency_seconds", MetricType::Gauge, "Temp db commit latency, upper bound of the power of two bucket",
+			ToSeconds(stats.m_CommitLatencyP99), { { "quantile", "0.99" } });
+		writer.Add("tf2bd_tempdb_file_bytes", MetricType::Gauge, "Size of the temp db", double(stats.m_DBFileSize), { { "file", "db" } });
+		writer.Add("tf2bd_tempdb_file_bytes", MetricType::Gauge, "Size of the temp db", double(stats.m_WALFileSize), { { "file", "wal" } });
+		writer.Add("tf2bd_tempdb_remote_lookups_total", MetricType::Counter, "Remote cache lookups, for entries missing or expired locally", stats.m_RemoteCache.m_Lookups);
+		writer.Add("tf2bd_tempdb_remote_hits_total", MetricType::Counter, "Remote cache lookups that found an entry", stats.m_RemoteCache.m_Hits);
+		writer.Add("tf2bd_tempdb_remote_puts_total", MetricType::Counter, "Entries written through to the remote cache", stats.m_RemoteCache.m_Puts);
+		writer.Add("tf2bd_tempdb_remote_failures_total", MetricType::Counter, "Remote cache lookups and writes that failed", stats.m_RemoteCache.m_Failures);
+
+		for (const auto& table : stats.m_Tables)
+		{
+			const PrometheusTextWriter::Labels labels = { { "table", table.m_Table } };
+			writer.Add("tf2bd_tempdb_reads_total", MetricType::Counter, "Temp db queries", table.m_Reads, labels);
+			writer.Add("tf2bd_tempdb_writes_total", MetricType::Counter, "Temp db rows written", table.m_Writes, labels);
+			writer.Add("tf2bd_tempdb_rows_read_total", MetricType::Counter, "Temp db rows read", double(table.m_RowsRead), labels);
+
+			for (const auto& [quantile, latency] : { std::pair("0.5", table.m_LatencyP50), std::pair("0.99", table.m_LatencyP99) })
+			{
+				writer.Add("tf2bd_tempdb_latency_seconds", MetricType::Gauge, "Temp db read and write latency, upper bound of the power of two bucket",
+					ToSeconds(latency), { { "table", table.m_Table }, { "quantile", quantile } });
+			}
+		}
+	}
+
+	for (const Session& session : sessions)
+	{
+		if (session.m_Name.empty())
+			writer.SetCommonLabels({});
+		else
+			writer.SetCommonLabels({ { "session", std::string(session.m_Name) } });
+
+		if (session.m_Parser)
+		{
+			const auto stats = session.m_Parser->GetStats();
+			for (size_t i = 0; i < stats.m_LinesParsed.size(); i++)
+			{
+				// Most types never show up, and every series is something the collector has to keep around
+				if (!stats.m_LinesParsed[i])
+					continue;
+
+				writer.Add("tf2bd_console_lines_total", MetricType::Counter, "Console lines parsed", double(stats.m_LinesParsed[i]),
+					{ { "type", mh::format("{:v}", mh::enum_fmt(ConsoleLineType(i))) } });
+			}
+
+			writer.Add("tf2bd_console_lines_unparsed_total", MetricType::Counter, "Console lines we didn't recognize", double(stats.m_LinesUnparsed));
+			writer.Add("tf2bd_console_lines_shed_total", MetricType::Counter, "Console lines dropped while too far behind to parse everything", double(stats.m_LinesShed));
+			writer.Add("tf2bd_console_read_bytes_total", MetricType::Counter, "Bytes read from console.log", double(stats.m_BytesRead));
+			writer.Add("tf2bd_console_parse_seconds_total", MetricType::Counter, "Time spent parsing console.log, not including the listeners", ToSeconds(stats.m_ParseTime));
+		}
+
+		if (session.m_ActionManager)
+		{
+			const auto stats = session.m_ActionManager->GetStats();
+			writer.Add("tf2bd_rcon_timed_out_total", MetricType::Counter, "RCON commands still unanswered after a while", stats.m_TimedOut);
+			writer.Add("tf2bd_rcon_broken_promises_total", MetricType::Counter, "RCON commands dropped by the client", stats.m_BrokenPromises);
+			writer.Add("tf2bd_rcon_errors_total", MetricType::Counter, "RCON commands that failed for other reasons", stats.m_Errors);
+			writer.Add("tf2bd_rcon_reconnects_total", MetricType::Counter, "RCON commands sent again after a failure", stats.m_Reconnects);
+			writer.Add("tf2bd_rcon_in_flight", MetricType::Gauge, "RCON commands waiting on a response", double(stats.m_InFlight));
+			writer.Add("tf2bd_rcon_queued", MetricType::Gauge, "RCON commands waiting to be sent", double(stats.m_Queued));
+
+			for (const auto& type : stats.m_CommandTypes)
+			{
+				const auto typeName = mh::format("{:v}", mh::enum_fmt(type.m_Type));
+				const PrometheusTextWriter::Labels labels = { { "type", typeName } };
+				writer.Add("tf2bd_rcon_commands_total", MetricType::Counter, "RCON commands answered or failed", type.m_Commands, labels);
+				writer.Add("tf2bd_rcon_commands_failed_total", MetricType::Counter, "RCON commands that failed", type.m_Failed, labels);
+				writer.Add("tf2bd_rcon_commands_over_latency_target_total", MetricType::Counter, "RCON commands slower than the latency target", type.m_OverLatencyTarget, labels);
+
+				for (const auto& [quantile, latency] : { std::pair("0.5", type.m_LatencyP50), std::pair("0.95", type.m_LatencyP95), std::pair("0.99", type.m_LatencyP99) })
+				{
+					writer.Add("tf2bd_rcon_latency_seconds", MetricType::Gauge, "RCON command latency, upper bound of the power of two bucket",
+						ToSeconds(latency), { { "type", typeName }, { "quantile", quantile } });
+				}
+			}
+		}
+
+		if (session.m_ModLogic)
+		{
+			writer.Add("tf2bd_cheater_detections_total", MetricType::Counter, "Marked cheaters seen in the lobby",
+				session.m_ModLogic->GetDetectionCount());
+		}
+	}
+
+	return writer.GetText();
+}
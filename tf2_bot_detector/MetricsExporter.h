@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Clock.h"
+
+#include <mh/coroutine/task.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	class ConsoleLogParser;
+	class IModeratorLogic;
+	class IRCONActionManager;
+	class Settings;
+
+	// Every WRITE_INTERVAL, writes the counters we keep (console lines, HTTP requests, the temp db,
+	// RCON latency, frame times, memory, detections) to Settings::m_MetricsFilePath, in the format
+	// node_exporter's textfile collector reads. Does nothing while the path is empty.
+	class MetricsExporter final
+	{
+	public:
+		// Everything that's only there once we're monitoring a TF2 client. Any of these can be null.
+		struct Session
+		{
+			std::string_view m_Name;  // Added as a session label, unless it's empty
+			const ConsoleLogParser* m_Parser = nullptr;
+			const IRCONActionManager* m_ActionManager = nullptr;
+			const IModeratorLogic* m_ModLogic = nullptr;
+		};
+
+		MetricsExporter(const Settings& settings);
+
+		// Call once per frame
+		void Update(std::span<const Session> sessions);
+
+	private:
+		static constexpr duration_t WRITE_INTERVAL = std::chrono::seconds(15);
+
+		std::string BuildText(std::span<const Session> sessions) const;
+
+		const Settings* m_Settings = nullptr;
+
+		// Since the last write
+		std::chrono::steady_clock::time_point m_LastFrameTime{};
+		std::chrono::steady_clock::duration m_FrameTimeTotal{};
+		std::chrono::steady_clock::duration m_FrameTimeMax{};
+		uint32_t m_FrameCount = 0;
+
+		time_point_t m_LastWriteTime{};
+		mh::task<> m_WriteTask;
+	};
+}
@@ -8,22 +8,34 @@
 #include "ConsoleLog/IConsoleLine.h"
 #include "ConsoleLog/ConsoleLines.h"
 #include "GameData/UserMessageType.h"
+#include "EventLog.h"
 #include "IPlayer.h"
 #include "Log.h"
 #include "PlayerStatus.h"
+#include "SessionSnapshot.h"
 #include "WorldEventListener.h"
 #include "WorldState.h"
+#include "Util/Profiler.h"
+#include "Util/TaskScheduler.h"
 
 #include <mh/algorithm/algorithm_generic.hpp>
+#include <mh/coroutine/task.hpp>
 #include <mh/algorithm/multi_compare.hpp>
 #include <mh/text/case_insensitive_string.hpp>
 #include <mh/text/fmtstr.hpp>
 #include <mh/text/string_insertion.hpp>
+#include <nlohmann/json.hpp>
 
+#include <algorithm>
+#include <fstream>
 #include <iomanip>
 #include <map>
 #include <regex>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 using namespace tf2_bot_detector;
 using namespace std::chrono_literals;
@@ -35,7 +47,8 @@ namespace
 	class ModeratorLogic final : public IModeratorLogic, AutoConsoleLineListener, AutoWorldEventListener
 	{
 	public:
-		ModeratorLogic(IWorldState& world, const Settings& settings, IRCONActionManager& actionManager);
+		ModeratorLogic(IWorldState& world, const Settings& settings, IRCONActionManager& actionManager, SharedConfig config);
+		~ModeratorLogic();
 
 		void Update() override;
 
@@ -72,9 +85,16 @@ namespace
 
 		size_t GetBlacklistedPlayerCount() const override { return m_PlayerList.GetPlayerCount(); }
 		size_t GetRuleCount() const override { return m_Rules.GetRuleCount(); }
+		uint32_t GetDetectionCount() const override { return m_DetectionCount; }
 
 		void ReloadConfigFiles() override;
 
+		const ModerationDecisionTrace& GetDecisionTrace() const override { return m_DecisionTrace->m_Decisions; }
+		void ExportDecisionTrace(const std::filesystem::path& path) const override;
+
+		void SaveSnapshot(SessionSnapshot& snapshot) const override;
+		void RestoreSnapshot(const SessionSnapshot& snapshot) override;
+
 	private:
 		IWorldState* m_World = nullptr;
 		const Settings* m_Settings = nullptr;
@@ -91,6 +111,10 @@ namespace
 			std::optional<time_point_t> m_ConnectingWarningDelayEnd;
 			std::optional<time_point_t> m_WarningDelayEnd;
 
+			// When ProcessPlayerActions() first saw them as a cheater in the lobby
+			std::optional<time_point_t> m_DetectedTime;
+			time_point_t m_DetectedGameTime{};
+
 			struct
 			{
 				time_point_t m_LastTransmission{};
@@ -98,11 +122,29 @@ namespace
 			} m_Voice;
 		};
 
+		uint32_t m_DetectionCount = 0;
+
 		// Steam IDs of players that we think are running the tool.
 		std::unordered_set<SteamID> m_PlayersRunningTool;
 
+		// How recently someone needs a status update to be considered for bot leader
+		static constexpr duration_t BOT_LEADER_STATUS_TIMEOUT = std::chrono::seconds(20);
+
+		// GetBotLeader() is called a lot, but the answer only changes when the statuses of the local
+		// player or players running the tool do, when the set of players running the tool does, or
+		// once one of the candidates' statuses goes stale.
+		struct BotLeaderCache
+		{
+			bool m_IsValid = false;
+			time_point_t m_ValidUntil{};
+			SteamID m_LocalSteamID;
+			std::optional<SteamID> m_Leader;
+		};
+		mutable BotLeaderCache m_BotLeaderCache;
+
 		void OnPlayerStatusUpdate(IWorldState& world, const IPlayer& player) override;
 		void OnChatMsg(IWorldState& world, IPlayer& player, const std::string_view& msg) override;
+		void OnLobbyChanged(IWorldState& world) override;
 
 		void OnRuleMatch(const ModerationRule& rule, const IPlayer& player);
 
@@ -121,6 +163,23 @@ namespace
 		time_point_t m_NextCheaterWarningTime{};            // The soonest we can warn about connected cheaters on the other team
 		time_point_t m_LastPlayerActionsUpdate{};
 		void ProcessPlayerActions();
+
+		// Renewed every ProcessPlayerActions() for as long as the cheater is still pending
+		static constexpr duration_t CHEATER_PENDING_FAST_POLLING_DURATION = std::chrono::seconds(5);
+
+		// Lobby members, which team they're on relative to us, and whether they're marked as a cheater.
+		// Only rebuilt when the lobby, the playerlist files, or someone's attributes change.
+		struct LobbyMemberState
+		{
+			SteamID m_SteamID;
+			TeamShareResult m_TeamShareResult;
+			PlayerMarks m_CheaterMarks;
+		};
+		std::vector<LobbyMemberState> m_LobbyMemberStates;
+		bool m_LobbyMemberStatesDirty = true;
+		uint64_t m_LobbyMemberStatesFilesVersion = 0;
+		void UpdateLobbyMemberStates();
+
 		void HandleFriendlyCheaters(uint8_t friendlyPlayerCount, uint8_t connectedFriendlyPlayerCount,
 			const std::vector<Cheater>& friendlyCheaters);
 		void HandleEnemyCheaters(uint8_t enemyPlayerCount, const std::vector<Cheater>& enemyCheaters,
@@ -128,13 +187,39 @@ namespace
 		void HandleConnectedEnemyCheaters(const std::vector<Cheater>& enemyCheaters);
 		void HandleConnectingEnemyCheaters(const std::vector<Cheater>& connectingEnemyCheaters);
 
-		// Minimum interval between callvote commands (the 150 comes from the default value of sv_vote_creation_timer)
-		static constexpr duration_t MIN_VOTEKICK_INTERVAL = std::chrono::seconds(150);
+		// When callvotes are accepted is up to IWorldState::GetVoteState()
 		time_point_t m_LastVoteCallTime{}; // Last time we called a votekick on someone
-		duration_t GetTimeSinceLastCallVote() const { return tfbd_clock_t::now() - m_LastVoteCallTime; }
+		std::unordered_map<SteamID, time_point_t> m_VotekickDeferrals; // Until when we last held off on kicking each player
+
+		SharedConfig m_Config;
+		PlayerListJSON& m_PlayerList = *m_Config.m_PlayerList;
+		ModerationRules& m_Rules = *m_Config.m_Rules;
 
-		PlayerListJSON m_PlayerList;
-		ModerationRules m_Rules;
+		// Shared with the ack callbacks we hand to the action manager, which can outlive us
+		struct DecisionTraceState
+		{
+			ModerationDecisionTrace m_Decisions;
+			uint64_t m_LastID = 0;
+		};
+		std::shared_ptr<DecisionTraceState> m_DecisionTrace = std::make_shared<DecisionTraceState>();
+		ModerationDecision MakeDecision(ModerationDecisionType type, const IPlayer& player, const PlayerMarks* marks) const;
+		IActionManager::AckFunc MakeDecisionAckFunc(const std::vector<ModerationDecision>& decisions) const;
+		void RecordDecisions(std::vector<ModerationDecision> decisions);
+
+		// Whenever the rules or playerlist files change, every player is checked against them again.
+		// The players are copied and evaluated in parallel, then all of the matches are applied at once.
+		struct RuleReevaluationResult
+		{
+			std::shared_ptr<const CompiledRules> m_Rules;
+			size_t m_PlayerCount = 0;
+			std::vector<std::pair<SteamID, std::vector<size_t>>> m_Matches;
+		};
+		static mh::task<RuleReevaluationResult> ReevaluateRulesAsync(
+			std::shared_ptr<const CompiledRules> rules, std::vector<std::pair<SteamID, CompiledRules::PlayerInputs>> players);
+		void UpdateRuleReevaluation();
+		std::shared_ptr<const CompiledRules> m_ReevaluatedRules;
+		uint64_t m_ReevaluatedFilesVersion = 0;
+		mh::task<RuleReevaluationResult> m_RuleReevaluation;
 	};
 
 	template<typename CharT, typename Traits>
@@ -166,50 +251,318 @@ namespace
 std::unique_ptr<IModeratorLogic> IModeratorLogic::Create(IWorldState& world,
 	const Settings& settings, IRCONActionManager& actionManager)
 {
-	return std::make_unique<ModeratorLogic>(world, settings, actionManager);
+	return Create(world, settings, actionManager, SharedConfig::Create(settings));
+}
+
+std::unique_ptr<IModeratorLogic> IModeratorLogic::Create(IWorldState& world,
+	const Settings& settings, IRCONActionManager& actionManager, SharedConfig config)
+{
+	return std::make_unique<ModeratorLogic>(world, settings, actionManager, std::move(config));
+}
+
+auto IModeratorLogic::SharedConfig::Create(const Settings& settings) -> SharedConfig
+{
+	SharedConfig config;
+	config.m_PlayerList = std::make_shared<PlayerListJSON>(settings);
+	config.m_Rules = std::make_shared<ModerationRules>(settings);
+	return config;
 }
 
 void ModeratorLogic::Update()
 {
+	TF2BD_PROFILE_SCOPE("ModeratorLogic::Update");
+
 	ProcessPlayerActions();
+	m_PlayerList.Update();
+	m_Rules.Update();
+	UpdateRuleReevaluation();
+}
+
+mh::task<ModeratorLogic::RuleReevaluationResult> ModeratorLogic::ReevaluateRulesAsync(
+	std::shared_ptr<const CompiledRules> rules, std::vector<std::pair<SteamID, CompiledRules::PlayerInputs>> players)
+{
+	std::vector<std::vector<size_t>> matches(players.size());
+
+	// Split the players into contiguous batches, one per CPU lane thread
+	{
+		const auto EvaluateBatch = [](const CompiledRules& rules,
+			const std::vector<std::pair<SteamID, CompiledRules::PlayerInputs>>& players,
+			std::vector<std::vector<size_t>>& matches, size_t begin, size_t end) -> mh::task<>
+		{
+			co_await TaskScheduler::Get().co_schedule(TaskLane::CPU);
+
+			CompiledRules::PlayerResults results;
+			for (size_t i = begin; i < end; i++)
+			{
+				rules.EvaluatePlayer(players[i].second, results);
+				rules.FindMatches(results, {}, matches[i]);
+			}
+		};
+
+		const size_t batchCount = std::min(players.size(), TaskScheduler::Get().GetThreadCount(TaskLane::CPU));
+		const size_t batchSize = (players.size() + batchCount - 1) / batchCount;
+
+		std::vector<mh::task<>> batches;
+		for (size_t begin = 0; begin < players.size(); begin += batchSize)
+		{
+			batches.push_back(EvaluateBatch(*rules, players, matches,
+				begin, std::min(begin + batchSize, players.size())));
+		}
+
+		for (auto& batch : batches)
+			co_await batch;
+	}
+
+	RuleReevaluationResult result;
+	result.m_PlayerCount = players.size();
+	for (size_t i = 0; i < players.size(); i++)
+	{
+		if (!matches[i].empty())
+			result.m_Matches.emplace_back(players[i].first, std::move(matches[i]));
+	}
+
+	result.m_Rules = std::move(rules);
+	co_return result;
+}
+
+void ModeratorLogic::UpdateRuleReevaluation()
+{
+	if (m_RuleReevaluation.valid())
+	{
+		if (!m_RuleReevaluation.is_ready())
+			return;
+
+		try
+		{
+			const RuleReevaluationResult& result = m_RuleReevaluation.get();
+
+			size_t matchCount = 0;
+			for (const auto& [steamID, matches] : result.m_Matches)
+			{
+				// They might have left while we were busy
+				const IPlayer* player = m_World->FindPlayer(steamID);
+				if (!player)
+					continue;
+
+				for (size_t ruleIndex : matches)
+				{
+					OnRuleMatch(result.m_Rules->GetRule(ruleIndex), *player);
+					matchCount++;
+				}
+			}
+
+			DebugLog("Re-evaluated rules for {} players, {} rule matches", result.m_PlayerCount, matchCount);
+		}
+		catch (const std::exception& e)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to re-evaluate rules");
+		}
+
+		m_RuleReevaluation = {};
+	}
+
+	if (!m_Settings->m_AutoMark)
+		return;
+
+	auto rules = m_Rules.GetCompiledRules();
+	const auto filesVersion = m_PlayerList.GetFilesVersion();
+	if (rules == m_ReevaluatedRules && filesVersion == m_ReevaluatedFilesVersion)
+		return;
+
+	m_ReevaluatedRules = rules;
+	m_ReevaluatedFilesVersion = filesVersion;
+
+	// IPlayer isn't safe to use off the main thread
+	std::vector<std::pair<SteamID, CompiledRules::PlayerInputs>> players;
+	for (const IPlayer& player : std::as_const(*m_World).GetPlayerRange())
+		players.emplace_back(player.GetSteamID(), rules->GetPlayerInputs(player));
+
+	if (players.empty())
+		return;
+
+	m_RuleReevaluation = ReevaluateRulesAsync(std::move(rules), std::move(players));
 }
 
 void ModeratorLogic::OnRuleMatch(const ModerationRule& rule, const IPlayer& player)
 {
+	bool changed = false;
 	for (PlayerAttribute attribute : rule.m_Actions.m_Mark)
 	{
 		if (SetPlayerAttribute(player, attribute, AttributePersistence::Saved))
+		{
 			Log("Marked {} with {:v} due to rule match with {}", player, mh::enum_fmt(attribute), std::quoted(rule.m_Description));
+			changed = true;
+		}
 	}
 	for (PlayerAttribute attribute : rule.m_Actions.m_TransientMark)
 	{
 		if (SetPlayerAttribute(player, attribute, AttributePersistence::Transient))
+		{
 			Log("[TRANSIENT] Marked {} with {:v} due to rule match with {}", player, mh::enum_fmt(attribute), std::quoted(rule.m_Description));
+			changed = true;
+		}
 	}
 	for (PlayerAttribute attribute : rule.m_Actions.m_Unmark)
 	{
 		if (SetPlayerAttribute(player, attribute, AttributePersistence::Saved, false))
+		{
 			Log("Unmarked {} with {:v} due to rule match with {}", player, mh::enum_fmt(attribute), std::quoted(rule.m_Description));
+			changed = true;
+		}
+	}
+
+	// Matching rules get re-applied on every status update, only the ones that did something are interesting
+	if (changed)
+	{
+		auto decision = MakeDecision(ModerationDecisionType::RuleMatch, player, nullptr);
+		decision.m_Rule = rule.m_Description;
+		RecordDecisions({ std::move(decision) });
+	}
+}
+
+ModerationDecision ModeratorLogic::MakeDecision(ModerationDecisionType type, const IPlayer& player, const PlayerMarks* marks) const
+{
+	const auto now = FrameClock::Now();
+
+	ModerationDecision decision;
+	decision.m_ID = ++m_DecisionTrace->m_LastID;
+	decision.m_Type = type;
+	decision.m_SteamID = player.GetSteamID();
+	decision.m_PlayerName = player.GetNameSafe();
+	decision.m_WasBotLeader = IsBotLeader();
+	decision.m_DetectedTime = now;
+	decision.m_DetectedGameTime = m_World->GetCurrentTime();
+	decision.m_QueuedTime = now;
+
+	if (marks)
+	{
+		for (const auto& mark : marks->m_Marks)
+		{
+			if (!decision.m_MarkedIn.empty())
+				decision.m_MarkedIn += ", ";
+
+			decision.m_MarkedIn += mark.m_FileName;
+		}
+	}
+
+	if (auto data = player.GetData<PlayerExtraData>(); data && data->m_DetectedTime && type != ModerationDecisionType::RuleMatch)
+	{
+		decision.m_DetectedTime = *data->m_DetectedTime;
+		decision.m_DetectedGameTime = data->m_DetectedGameTime;
+
+		if (type == ModerationDecisionType::ChatWarning)
+			decision.m_DelayEndTime = data->m_WarningDelayEnd;
+		else if (type == ModerationDecisionType::ConnectingWarning)
+			decision.m_DelayEndTime = data->m_ConnectingWarningDelayEnd;
+	}
+
+	return decision;
+}
+
+IActionManager::AckFunc ModeratorLogic::MakeDecisionAckFunc(const std::vector<ModerationDecision>& decisions) const
+{
+	std::vector<uint64_t> ids;
+	for (const auto& decision : decisions)
+		ids.push_back(decision.m_ID);
+
+	return [trace = std::weak_ptr(m_DecisionTrace), ids = std::move(ids)](time_point_t sentTime, bool succeeded)
+	{
+		const auto state = trace.lock();
+		if (!state)
+			return;
+
+		const auto ackTime = tfbd_clock_t::now();
+		for (size_t i = 0; i < state->m_Decisions.size(); i++)
+		{
+			auto& decision = state->m_Decisions[i];
+			if (std::find(ids.begin(), ids.end(), decision.m_ID) == ids.end())
+				continue;
+
+			decision.m_SentTime = sentTime;
+			decision.m_AckTime = ackTime;
+			decision.m_AckSucceeded = succeeded;
+		}
+	};
+}
+
+void ModeratorLogic::RecordDecisions(std::vector<ModerationDecision> decisions)
+{
+	for (auto& decision : decisions)
+	{
+		IEventLog::Record(EventLogRecordType::ModerationDecision, decision.m_Type, decision.m_SteamID,
+			decision.m_PlayerName, decision.m_Rule, decision.m_MarkedIn);
+		m_DecisionTrace->m_Decisions.push_back(std::move(decision));
 	}
 }
 
+void ModeratorLogic::ExportDecisionTrace(const std::filesystem::path& path) const try
+{
+	const auto ToMilliseconds = [](const std::optional<time_point_t>& time) -> nlohmann::json
+	{
+		if (!time)
+			return nullptr;
+
+		return std::chrono::duration_cast<std::chrono::milliseconds>(time->time_since_epoch()).count();
+	};
+
+	const auto& decisions = m_DecisionTrace->m_Decisions;
+	nlohmann::json json = nlohmann::json::array();
+	for (size_t i = 0; i < decisions.size(); i++)
+	{
+		const auto& decision = decisions[i];
+		json.push_back(nlohmann::json{
+			{ "id", decision.m_ID },
+			{ "type", mh::format("{:v}", mh::enum_fmt(decision.m_Type)) },
+			{ "steamid", decision.m_SteamID },
+			{ "name", decision.m_PlayerName },
+			{ "rule", decision.m_Rule },
+			{ "marked_in", decision.m_MarkedIn },
+			{ "bot_leader", decision.m_WasBotLeader },
+			{ "detected_game_time", ToMilliseconds(decision.m_DetectedGameTime) },
+			{ "detected_time", ToMilliseconds(decision.m_DetectedTime) },
+			{ "delay_end_time", ToMilliseconds(decision.m_DelayEndTime) },
+			{ "queued_time", ToMilliseconds(decision.m_QueuedTime) },
+			{ "sent_time", ToMilliseconds(decision.m_SentTime) },
+			{ "ack_time", ToMilliseconds(decision.m_AckTime) },
+			{ "ack_succeeded", decision.m_AckSucceeded },
+		});
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file << json.dump(1, '\t');
+
+	if (file.good())
+		Log("Wrote {} moderation decisions to {}", decisions.size(), path);
+	else
+		LogError("Failed to write moderation decisions to {}", path);
+}
+catch (...)
+{
+	LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to export moderation decisions");
+}
+
 void ModeratorLogic::OnPlayerStatusUpdate(IWorldState& world, const IPlayer& player)
 {
 	const auto name = player.GetNameUnsafe();
 	const auto steamID = player.GetSteamID();
 
+	// User IDs and status freshness are what decide the bot leader
+	if (steamID == m_Settings->GetLocalSteamID() || IsUserRunningTool(steamID))
+		m_BotLeaderCache.m_IsValid = false;
+
 	if (m_Settings->m_AutoMark)
 	{
-		for (const ModerationRule& rule : m_Rules.GetRules())
-		{
-			if (!rule.Match(player))
-				continue;
-
+		for (const ModerationRule& rule : m_Rules.GetMatchingRules(player))
 			OnRuleMatch(rule, player);
-		}
 	}
 }
 
+void ModeratorLogic::OnLobbyChanged(IWorldState& world)
+{
+	m_LobbyMemberStatesDirty = true;
+	m_BotLeaderCache.m_IsValid = false;
+}
+
 static bool IsCheaterConnectedWarning(const std::string_view& msg)
 {
 	static const std::regex s_IngameWarning(
@@ -252,11 +605,8 @@ void ModeratorLogic::OnChatMsg(IWorldState& world, IPlayer& player, const std::s
 
 	if (m_Settings->m_AutoMark && !botMsgDetected)
 	{
-		for (const ModerationRule& rule : m_Rules.GetRules())
+		for (const ModerationRule& rule : m_Rules.GetMatchingRules(player, msg))
 		{
-			if (!rule.Match(player, msg))
-				continue;
-
 			OnRuleMatch(rule, player);
 			Log("Chat message rule match for {}: {}", rule.m_Description, std::quoted(msg));
 		}
@@ -349,7 +699,7 @@ void ModeratorLogic::HandleEnemyCheaters(uint8_t enemyPlayerCount,
 
 void ModeratorLogic::HandleConnectedEnemyCheaters(const std::vector<Cheater>& enemyCheaters)
 {
-	const auto now = tfbd_clock_t::now();
+	const auto now = FrameClock::Now();
 
 	// There are enough people on the other team to votekick the cheater(s)
 	std::string logMsg = mh::format("Telling the other team about {} cheater(s) named ", enemyCheaters.size());
@@ -449,10 +799,21 @@ void ModeratorLogic::HandleConnectedEnemyCheaters(const std::vector<Cheater>& en
 
 		if (now >= m_NextCheaterWarningTime)
 		{
-			if (m_Settings->m_AutoChatWarnings && m_ActionManager->QueueAction<ChatMessageAction>(chatMsg))
+			if (m_Settings->m_AutoChatWarnings)
 			{
-				Log({ 1, 0, 0, 1 }, logMsg);
-				m_NextCheaterWarningTime = now + CHEATER_WARNING_INTERVAL;
+				std::vector<ModerationDecision> decisions;
+				for (const Cheater& cheater : enemyCheaters)
+				{
+					if (!cheater->GetNameSafe().empty())
+						decisions.push_back(MakeDecision(ModerationDecisionType::ChatWarning, cheater.m_Player, &cheater.m_Marks));
+				}
+
+				if (m_ActionManager->QueueAction(std::make_unique<ChatMessageAction>(chatMsg), MakeDecisionAckFunc(decisions)))
+				{
+					Log({ 1, 0, 0, 1 }, logMsg);
+					m_NextCheaterWarningTime = now + CHEATER_WARNING_INTERVAL;
+					RecordDecisions(std::move(decisions));
+				}
 			}
 		}
 		else
@@ -467,7 +828,7 @@ void ModeratorLogic::HandleConnectingEnemyCheaters(const std::vector<Cheater>& c
 	if (!m_Settings->m_AutoChatWarnings || !m_Settings->m_AutoChatWarningsConnecting)
 		return;  // user has disabled this functionality
 
-	const auto now = tfbd_clock_t::now();
+	const auto now = FrameClock::Now();
 	if (now < m_NextConnectingCheaterWarningTime)
 	{
 		DebugLog("HandleEnemyCheaters(): Discarding connection warnings ("s
@@ -531,11 +892,17 @@ void ModeratorLogic::HandleConnectingEnemyCheaters(const std::vector<Cheater>& c
 			connectingEnemyCheaters.size());
 	}
 
+	std::vector<ModerationDecision> decisions;
+	for (const Cheater& cheater : connectingEnemyCheaters)
+		decisions.push_back(MakeDecision(ModerationDecisionType::ConnectingWarning, cheater.m_Player, &cheater.m_Marks));
+
 	Log("Telling other team about "s << connectingEnemyCheaters.size() << " cheaters currently connecting");
-	if (m_ActionManager->QueueAction<ChatMessageAction>(chatMsg))
+	if (m_ActionManager->QueueAction(std::make_unique<ChatMessageAction>(chatMsg), MakeDecisionAckFunc(decisions)))
 	{
 		for (auto& cheater : connectingEnemyCheaters)
 			cheater->GetOrCreateData<PlayerExtraData>().m_PreWarnedOtherTeam = true;
+
+		RecordDecisions(std::move(decisions));
 	}
 }
 
@@ -576,13 +943,35 @@ void ModeratorLogic::ProcessPlayerActions()
 	std::vector<Cheater> friendlyCheaters;
 	std::vector<Cheater> connectingEnemyCheaters;
 
+	UpdateLobbyMemberStates();
+
 	const bool isBotLeader = IsBotLeader();
 	bool needsEnemyWarning = false;
-	for (IPlayer& player : m_World->GetLobbyMembers())
+	bool cheaterPending = false;
+	for (const LobbyMemberState& member : m_LobbyMemberStates)
 	{
+		IPlayer* playerPtr = m_World->FindPlayer(member.m_SteamID);
+		if (!playerPtr)
+			continue;
+
+		// Connection state, active time and name change constantly, but they're cheap to look at
+		IPlayer& player = *playerPtr;
 		const bool isPlayerConnected = player.GetConnectionState() == PlayerStatusState::Active;
-		const auto isCheater = m_PlayerList.HasPlayerAttributes(player, PlayerAttribute::Cheater);
-		const auto teamShareResult = m_World->GetTeamShareResult(*myTeam, player);
+		const PlayerMarks& isCheater = member.m_CheaterMarks;
+		const auto teamShareResult = member.m_TeamShareResult;
+
+		if (isCheater)
+		{
+			if (auto& data = player.GetOrCreateData<PlayerExtraData>(); !data.m_DetectedTime)
+			{
+				data.m_DetectedTime = FrameClock::Now();
+				data.m_DetectedGameTime = now;
+				m_DetectionCount++;
+			}
+
+			if (!isPlayerConnected)
+				cheaterPending = true;
+		}
 		if (teamShareResult == TeamShareResult::SameTeams)
 		{
 			if (isPlayerConnected)
@@ -617,6 +1006,44 @@ void ModeratorLogic::ProcessPlayerActions()
 
 	HandleEnemyCheaters(totalEnemyPlayers, enemyCheaters, connectingEnemyCheaters);
 	HandleFriendlyCheaters(totalFriendlyPlayers, connectedFriendlyPlayers, friendlyCheaters);
+
+	// Still waiting on someone else to warn about these
+	const auto wallTime = FrameClock::Now();
+	for (const Cheater& cheater : enemyCheaters)
+	{
+		if (auto data = cheater->GetData<PlayerExtraData>(); data && data->m_WarningDelayEnd > wallTime)
+			cheaterPending = true;
+	}
+
+	// Keep a close eye on any cheaters that are joining or waiting on a warning
+	if (cheaterPending)
+		m_ActionManager->RequestFastPolling(wallTime + CHEATER_PENDING_FAST_POLLING_DURATION);
+}
+
+void ModeratorLogic::UpdateLobbyMemberStates()
+{
+	if (const auto filesVersion = m_PlayerList.GetFilesVersion(); filesVersion != m_LobbyMemberStatesFilesVersion)
+	{
+		m_LobbyMemberStatesFilesVersion = filesVersion;
+		m_LobbyMemberStatesDirty = true;
+	}
+
+	if (!m_LobbyMemberStatesDirty)
+		return;
+
+	m_LobbyMemberStatesDirty = false;
+	m_LobbyMemberStates.clear();
+
+	// Our own team is part of the lobby too, so this changes along with it
+	const auto myTeam = TryGetMyTeam();
+	for (const IPlayer& player : std::as_const(*m_World).GetLobbyMemberRange())
+	{
+		m_LobbyMemberStates.push_back({
+			player.GetSteamID(),
+			m_World->GetTeamShareResult(myTeam, player),
+			m_PlayerList.HasPlayerAttributes(player, PlayerAttribute::Cheater),
+		});
+	}
 }
 
 bool ModeratorLogic::SetPlayerAttribute(const IPlayer& player, PlayerAttribute attribute, AttributePersistence persistence, bool set)
@@ -647,11 +1074,14 @@ bool ModeratorLogic::SetPlayerAttribute(const IPlayer& player, PlayerAttribute a
 			data.m_LastSeen->m_Time = m_World->GetCurrentTime();
 
 			if (const auto& name = player.GetNameUnsafe(); !name.empty())
-				data.m_LastSeen->m_PlayerName = name;
+				data.m_LastSeen->m_PlayerName = InternedString(name);
 
 			return ModifyPlayerAction::Modified;
 		});
 
+	if (attributeChanged)
+		m_LobbyMemberStatesDirty = true;
+
 	return attributeChanged;
 }
 
@@ -678,6 +1108,20 @@ bool ModeratorLogic::IsBotLeader() const
 
 const IPlayer* ModeratorLogic::GetBotLeader() const
 {
+	const auto now = m_World->GetCurrentTime();
+	const SteamID localSteamID = m_Settings->GetLocalSteamID();
+
+	if (m_BotLeaderCache.m_IsValid && now <= m_BotLeaderCache.m_ValidUntil &&
+		m_BotLeaderCache.m_LocalSteamID == localSteamID)
+	{
+		return m_BotLeaderCache.m_Leader ? m_World->FindPlayer(*m_BotLeaderCache.m_Leader) : nullptr;
+	}
+
+	m_BotLeaderCache = {};
+	m_BotLeaderCache.m_IsValid = true;
+	m_BotLeaderCache.m_ValidUntil = time_point_t::max();
+	m_BotLeaderCache.m_LocalSteamID = localSteamID;
+
 	auto localPlayer = GetLocalPlayer();
 	if (!localPlayer)
 		return nullptr;
@@ -688,23 +1132,38 @@ const IPlayer* ModeratorLogic::GetBotLeader() const
 	else
 		return nullptr;
 
-	const auto now = m_World->GetCurrentTime();
-	for (const IPlayer& player : m_World->GetPlayers())
+	// Whoever running the tool has the lowest user ID is in charge
+	const IPlayer* leader = localPlayer;
+	UserID_t leaderUserID = localUserID;
+	for (const SteamID& id : m_PlayersRunningTool)
 	{
-		if (player.GetTimeSinceLastStatusUpdate() > 20s)
+		if (id == localSteamID)
 			continue;
 
-		if (player.GetSteamID() == localPlayer->GetSteamID())
+		const IPlayer* player = m_World->FindPlayer(id);
+		if (!player)
 			continue;
 
-		if (player.GetUserID() >= localUserID)
+		const auto staleTime = player->GetLastStatusUpdateTime() + BOT_LEADER_STATUS_TIMEOUT;
+		if (now > staleTime)
 			continue;
 
-		if (IsUserRunningTool(player))
-			return &player;
+		const auto userID = player->GetUserID();
+		if (!userID || *userID >= localUserID)
+			continue;
+
+		// Someone else takes over once they go stale
+		m_BotLeaderCache.m_ValidUntil = std::min(m_BotLeaderCache.m_ValidUntil, staleTime);
+
+		if (*userID < leaderUserID)
+		{
+			leader = player;
+			leaderUserID = *userID;
+		}
 	}
 
-	return localPlayer;
+	m_BotLeaderCache.m_Leader = leader->GetSteamID();
+	return leader;
 }
 
 duration_t ModeratorLogic::TimeToConnectingCheaterWarning() const
@@ -723,29 +1182,90 @@ bool ModeratorLogic::IsUserRunningTool(const SteamID& id) const
 }
 void ModeratorLogic::SetUserRunningTool(const SteamID& id, bool isRunningTool)
 {
+	m_BotLeaderCache.m_IsValid = false;
+
 	if (isRunningTool)
 		m_PlayersRunningTool.insert(id);
 	else
 		m_PlayersRunningTool.erase(id);
 }
 
+void ModeratorLogic::SaveSnapshot(SessionSnapshot& snapshot) const
+{
+	auto& saved = snapshot.m_ModeratorLogic;
+	saved.m_PlayersRunningTool.assign(m_PlayersRunningTool.begin(), m_PlayersRunningTool.end());
+	saved.m_NextConnectingCheaterWarningTime = m_NextConnectingCheaterWarningTime;
+	saved.m_NextCheaterWarningTime = m_NextCheaterWarningTime;
+	saved.m_LastVoteCallTime = m_LastVoteCallTime;
+
+	for (const IPlayer& player : m_World->GetPlayerRange())
+	{
+		auto data = player.GetData<PlayerExtraData>();
+		if (!data)
+			continue;
+
+		auto& savedPlayer = saved.m_Players.emplace_back();
+		savedPlayer.m_SteamID = player.GetSteamID();
+		savedPlayer.m_PreWarnedOtherTeam = data->m_PreWarnedOtherTeam;
+		savedPlayer.m_ConnectingWarningDelayEnd = data->m_ConnectingWarningDelayEnd;
+		savedPlayer.m_WarningDelayEnd = data->m_WarningDelayEnd;
+		savedPlayer.m_DetectedTime = data->m_DetectedTime;
+		savedPlayer.m_DetectedGameTime = data->m_DetectedGameTime;
+	}
+}
+
+void ModeratorLogic::RestoreSnapshot(const SessionSnapshot& snapshot)
+{
+	const auto& saved = snapshot.m_ModeratorLogic;
+	for (const SteamID& id : saved.m_PlayersRunningTool)
+		SetUserRunningTool(id);
+
+	// Whichever is further away, so we never warn or votekick any sooner than we would have
+	m_NextConnectingCheaterWarningTime = std::max(m_NextConnectingCheaterWarningTime, saved.m_NextConnectingCheaterWarningTime);
+	m_NextCheaterWarningTime = std::max(m_NextCheaterWarningTime, saved.m_NextCheaterWarningTime);
+	m_LastVoteCallTime = std::max(m_LastVoteCallTime, saved.m_LastVoteCallTime);
+
+	for (const auto& savedPlayer : saved.m_Players)
+	{
+		IPlayer* player = m_World->FindPlayer(savedPlayer.m_SteamID);
+		if (!player || player->GetData<PlayerExtraData>())
+			continue;
+
+		auto& data = player->GetOrCreateData<PlayerExtraData>();
+		data.m_PreWarnedOtherTeam = savedPlayer.m_PreWarnedOtherTeam;
+		data.m_ConnectingWarningDelayEnd = savedPlayer.m_ConnectingWarningDelayEnd;
+		data.m_WarningDelayEnd = savedPlayer.m_WarningDelayEnd;
+		data.m_DetectedTime = savedPlayer.m_DetectedTime;
+		data.m_DetectedGameTime = savedPlayer.m_DetectedGameTime;
+	}
+
+	m_LobbyMemberStatesDirty = true;
+}
+
 void ModeratorLogic::ReloadConfigFiles()
 {
 	m_PlayerList.LoadFiles();
 	m_Rules.LoadFiles();
 }
 
-ModeratorLogic::ModeratorLogic(IWorldState& world, const Settings& settings, IRCONActionManager& actionManager) :
-	AutoConsoleLineListener(world),
+ModeratorLogic::ModeratorLogic(IWorldState& world, const Settings& settings, IRCONActionManager& actionManager,
+	SharedConfig config) :
+	AutoConsoleLineListener(world, ConsoleLineTypeMask::None()),
 	AutoWorldEventListener(world),
 	m_World(&world),
 	m_Settings(&settings),
 	m_ActionManager(&actionManager),
-	m_PlayerList(settings),
-	m_Rules(settings)
+	m_Config(std::move(config))
 {
 }
 
+ModeratorLogic::~ModeratorLogic()
+{
+	// The batches may still be running on the CPU lane
+	if (m_RuleReevaluation.valid())
+		m_RuleReevaluation.wait();
+}
+
 PlayerMarks ModeratorLogic::GetPlayerAttributes(const SteamID& id) const
 {
 	return m_PlayerList.GetPlayerAttributes(id);
@@ -765,7 +1285,24 @@ bool ModeratorLogic::InitiateVotekick(const IPlayer& player, KickReason reason,
 		return false;
 	}
 
-	if (m_ActionManager->QueueAction<KickAction>(userID.value(), reason))
+	// The server would only turn it down
+	if (const auto nextCallTime = m_World->GetVoteState().GetNextCallTime(player.GetSteamID());
+		m_World->GetCurrentTime() < nextCallTime)
+	{
+		if (auto& deferral = m_VotekickDeferrals[player.GetSteamID()]; deferral != nextCallTime)
+		{
+			Log("Wanted to kick {}, but the server won't accept a votekick for another {}s", player,
+				std::chrono::duration_cast<std::chrono::seconds>(nextCallTime - m_World->GetCurrentTime()).count());
+			deferral = nextCallTime;
+		}
+
+		return false;
+	}
+
+	std::vector<ModerationDecision> decisions;
+	decisions.push_back(MakeDecision(ModerationDecisionType::Votekick, player, marks));
+
+	if (m_ActionManager->QueueAction(std::make_unique<KickAction>(userID.value(), reason), MakeDecisionAckFunc(decisions)))
 	{
 		std::string logMsg = mh::format("InitiateVotekick on {}: {:v}", player, mh::enum_fmt(reason));
 		if (marks)
@@ -773,7 +1310,9 @@ bool ModeratorLogic::InitiateVotekick(const IPlayer& player, KickReason reason,
 
 		Log(std::move(logMsg));
 
-		m_LastVoteCallTime = tfbd_clock_t::now();
+		m_LastVoteCallTime = FrameClock::Now();
+		m_World->RecordVoteCall(player.GetSteamID());
+		RecordDecisions(std::move(decisions));
 	}
 
 	return true;
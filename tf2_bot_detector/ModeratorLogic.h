@@ -1,10 +1,16 @@
 #pragma once
 
+#include "Clock.h"
+#include "SteamID.h"
+#include "Util/RingBuffer.h"
+
 #include <mh/reflection/enum.hpp>
 
 #include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <optional>
+#include <string>
 
 namespace tf2_bot_detector
 {
@@ -14,11 +20,13 @@ namespace tf2_bot_detector
 	enum class TeamShareResult;
 	class IPlayer;
 	struct ModerationRule;
+	class ModerationRules;
 	struct PlayerAttributesList;
+	class PlayerListJSON;
 	struct PlayerMarks;
+	struct SessionSnapshot;
 	class IRCONActionManager;
 	class Settings;
-	class SteamID;
 	class IWorldState;
 
 	struct VoteCooldown
@@ -38,6 +46,37 @@ namespace tf2_bot_detector
 		Any = Saved | Transient,
 	};
 
+	enum class ModerationDecisionType
+	{
+		RuleMatch,
+		ChatWarning,
+		ConnectingWarning,
+		Votekick,
+	};
+
+	// Something we did about a player, and when each step of it happened. Times are all wall clock,
+	// except m_DetectedGameTime, which is the console log timestamp we were at when we noticed them.
+	struct ModerationDecision
+	{
+		uint64_t m_ID = 0;
+		ModerationDecisionType m_Type{};
+		SteamID m_SteamID;
+		std::string m_PlayerName;
+		std::string m_Rule;     // Rule description, for RuleMatch
+		std::string m_MarkedIn; // Playerlist files the player is marked in
+		bool m_WasBotLeader = false;
+
+		time_point_t m_DetectedGameTime{};
+		time_point_t m_DetectedTime{};              // First time we saw the player as a cheater in the lobby
+		std::optional<time_point_t> m_DelayEndTime; // Waiting for another bot leader to handle it
+		time_point_t m_QueuedTime{};                // Handed to the action manager
+		std::optional<time_point_t> m_SentTime;     // Written to rcon
+		std::optional<time_point_t> m_AckTime;      // The game responded
+		bool m_AckSucceeded = false;
+	};
+
+	using ModerationDecisionTrace = RingBuffer<ModerationDecision, 256>;
+
 	class IModeratorLogic
 	{
 	public:
@@ -45,6 +84,18 @@ namespace tf2_bot_detector
 
 		static std::unique_ptr<IModeratorLogic> Create(IWorldState& world, const Settings& settings, IRCONActionManager& actionManager);
 
+		// The playerlists and rules. Everything monitoring a TF2 client in the same process can share
+		// one set, as long as they're all used from the main thread.
+		struct SharedConfig
+		{
+			static SharedConfig Create(const Settings& settings);
+
+			std::shared_ptr<PlayerListJSON> m_PlayerList;
+			std::shared_ptr<ModerationRules> m_Rules;
+		};
+		static std::unique_ptr<IModeratorLogic> Create(IWorldState& world, const Settings& settings,
+			IRCONActionManager& actionManager, SharedConfig config);
+
 		virtual void Update() = 0;
 
 		virtual bool InitiateVotekick(const IPlayer& player, KickReason reason, const PlayerMarks* marks = nullptr) = 0;
@@ -64,10 +115,27 @@ namespace tf2_bot_detector
 		virtual size_t GetBlacklistedPlayerCount() const = 0;
 		virtual size_t GetRuleCount() const = 0;
 
+		// Marked cheaters we've seen in the lobby since this was created, once per player per detection
+		virtual uint32_t GetDetectionCount() const = 0;
+
 		virtual void ReloadConfigFiles() = 0;
+
+		virtual const ModerationDecisionTrace& GetDecisionTrace() const = 0;
+		virtual void ExportDecisionTrace(const std::filesystem::path& path) const = 0;
+
+		// Warning timers and who is running the tool. Restore after IWorldState::RestoreSnapshot().
+		virtual void SaveSnapshot(SessionSnapshot& snapshot) const = 0;
+		virtual void RestoreSnapshot(const SessionSnapshot& snapshot) = 0;
 	};
 }
 
+MH_ENUM_REFLECT_BEGIN(tf2_bot_detector::ModerationDecisionType)
+	MH_ENUM_REFLECT_VALUE(RuleMatch)
+	MH_ENUM_REFLECT_VALUE(ChatWarning)
+	MH_ENUM_REFLECT_VALUE(ConnectingWarning)
+	MH_ENUM_REFLECT_VALUE(Votekick)
+MH_ENUM_REFLECT_END()
+
 MH_ENUM_REFLECT_BEGIN(tf2_bot_detector::AttributePersistence)
 	MH_ENUM_REFLECT_VALUE(Saved)
 	MH_ENUM_REFLECT_VALUE(Transient)
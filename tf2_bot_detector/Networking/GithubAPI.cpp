@@ -31,7 +31,8 @@ namespace
 
 static mh::generator<InternalRelease> GetAllReleases(const HTTPClient& client)
 {
-	auto str = co_await client.GetStringAsync("https://api.github.com/repos/PazerOP/tf2_bot_detector/releases");
+	auto str = co_await client.GetStringAsync("https://api.github.com/repos/PazerOP/tf2_bot_detector/releases",
+		HTTPRequestTag::UpdateCheck);
 	if (str.empty())
 		throw std::runtime_error("Autoupdate: response string was empty");
 
@@ -0,0 +1,125 @@
+#include "HTTPCache.h"
+#include "Util/JSONUtils.h"
+#include "Filesystem.h"
+#include "Log.h"
+
+#include <mh/text/string_insertion.hpp>
+#include <nlohmann/json.hpp>
+
+#include <map>
+#include <mutex>
+
+using namespace tf2_bot_detector;
+
+namespace
+{
+	class HTTPCacheFile final
+	{
+	public:
+		HTTPCacheFile();
+
+		std::optional<HTTPCacheValidators> Find(const std::string& url) const;
+		void Set(const std::string& url, HTTPCacheValidators validators);
+		void Remove(const std::string& url);
+
+	private:
+		void Save() const;
+
+		std::filesystem::path m_FileName;
+		mutable std::mutex m_Mutex;
+		std::map<std::string, HTTPCacheValidators, std::less<>> m_Validators;
+	};
+
+	HTTPCacheFile& GetCacheFile()
+	{
+		static HTTPCacheFile s_CacheFile;
+		return s_CacheFile;
+	}
+}
+
+HTTPCacheFile::HTTPCacheFile() :
+	m_FileName(IFilesystem::Get().GetLocalAppDataDir() / "http_cache.json")
+{
+	try
+	{
+		if (!std::filesystem::exists(m_FileName))
+			return;
+
+		const auto json = nlohmann::json::parse(IFilesystem::Get().ReadFile(m_FileName));
+		for (const auto& [url, entry] : json.items())
+		{
+			HTTPCacheValidators validators;
+			try_get_to_defaulted(entry, validators.m_ETag, "etag");
+			try_get_to_defaulted(entry, validators.m_LastModified, "last_modified");
+
+			if (!validators.empty())
+				m_Validators.emplace(url, std::move(validators));
+		}
+	}
+	catch (...)
+	{
+		// Worst case we just re-download everything once
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to load {}, starting with an empty HTTP cache", m_FileName);
+		m_Validators.clear();
+	}
+}
+
+std::optional<HTTPCacheValidators> HTTPCacheFile::Find(const std::string& url) const
+{
+	std::lock_guard lock(m_Mutex);
+	if (auto found = m_Validators.find(url); found != m_Validators.end())
+		return found->second;
+
+	return std::nullopt;
+}
+
+void HTTPCacheFile::Set(const std::string& url, HTTPCacheValidators validators)
+{
+	if (validators.empty())
+		return Remove(url);
+
+	std::lock_guard lock(m_Mutex);
+	m_Validators.insert_or_assign(url, std::move(validators));
+	Save();
+}
+
+void HTTPCacheFile::Remove(const std::string& url)
+{
+	std::lock_guard lock(m_Mutex);
+	if (m_Validators.erase(url))
+		Save();
+}
+
+void HTTPCacheFile::Save() const try
+{
+	nlohmann::json json = nlohmann::json::object();
+	for (const auto& [url, validators] : m_Validators)
+	{
+		auto& entry = json[url];
+		if (!validators.m_ETag.empty())
+			entry["etag"] = validators.m_ETag;
+		if (!validators.m_LastModified.empty())
+			entry["last_modified"] = validators.m_LastModified;
+	}
+
+	IFilesystem::Get().WriteFile(m_FileName, json.dump(1, '\t') << '\n', PathUsage::WriteLocal);
+}
+catch (...)
+{
+	LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to save {}", m_FileName);
+}
+
+std::optional<HTTPCacheValidators> HTTPCache::FindValidators(const std::string& url)
+{
+	return GetCacheFile().Find(url);
+}
+
+void HTTPCache::SetValidators(const std::string& url, HTTPCacheValidators validators)
+{
+	GetCacheFile().Set(url, std::move(validators));
+}
+
+void HTTPCache::RemoveValidators(const std::string& url)
+{
+	GetCacheFile().Remove(url);
+}
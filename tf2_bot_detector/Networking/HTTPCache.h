@@ -0,0 +1,21 @@
+#pragma once
+
+#include "HTTPClient.h"
+
+#include <optional>
+#include <string>
+
+namespace tf2_bot_detector
+{
+	// Remembers the ETag/Last-Modified of downloads we still have a copy of on disk (auto-updated
+	// config files), so the next request for the same URL can be conditional. Saved to
+	// http_cache.json in the local app data folder. Thread-safe.
+	namespace HTTPCache
+	{
+		std::optional<HTTPCacheValidators> FindValidators(const std::string& url);
+
+		// Only call once the response body has been safely written to disk. Empty validators remove the entry.
+		void SetValidators(const std::string& url, HTTPCacheValidators validators);
+		void RemoveValidators(const std::string& url);
+	}
+}
@@ -6,50 +6,285 @@
 #include <mh/error/error_code_exception.hpp>
 #include <mh/text/case_insensitive_string.hpp>
 
+#include "EventLog.h"
 #include "GlobalDispatcher.h"
 #include "HTTPClient.h"
 #include "HTTPHelpers.h"
+#include "HTTPRateLimiter.h"
+#include "SessionArchive.h"
+#include "Util/MemoryTracker.h"
 
 #pragma warning(push, 1)
 #include <cpprest/http_client.h>
 #include <pplawait.h>
 #pragma warning(pop)
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <fstream>
+#include <shared_mutex>
+
 using namespace std::chrono_literals;
 using namespace std::string_literals;
 using namespace tf2_bot_detector;
 
 namespace
 {
+	// Everything in here is updated without locks, from whatever thread a request finishes on
+	class HostStatsCounters final
+	{
+	public:
+		static constexpr size_t LATENCY_BUCKET_COUNT = 18; // Bucket n holds latencies in [2^n, 2^(n+1)) ms
+
+		void AddRequest(std::chrono::milliseconds latency, size_t bytes);
+		void AddFailure() { m_Requests++; m_Failed++; AddToLastMinute(); }
+		void AddRetry() { m_Retries++; }
+		void AddBytesReceived(size_t bytes) { m_BytesReceived += bytes; }
+
+		IHTTPClient::HostStats GetStats(std::string host) const;
+
+	private:
+		void AddToLastMinute();
+		std::chrono::milliseconds GetLatencyPercentile(float percentile) const;
+
+		static uint32_t GetCurrentSecond();
+
+		std::atomic_uint32_t m_Requests = 0;
+		std::atomic_uint32_t m_Failed = 0;
+		std::atomic_uint32_t m_Retries = 0;
+		std::atomic_uint64_t m_BytesReceived = 0;
+		std::array<std::atomic_uint32_t, LATENCY_BUCKET_COUNT> m_LatencyHistogram{};
+
+		// One slot per second of the last minute, the second it's for in the high 32 bits and the count in the low ones
+		std::array<std::atomic_uint64_t, 60> m_RequestsPerSecond{};
+	};
+
+	// Where a DownloadFileAsync() is at, kept next to the .part file so a later attempt can pick up
+	// where this one left off
+	struct DownloadState
+	{
+		DownloadState(URL url, HTTPRequestTag tag, const std::filesystem::path& path);
+
+		URL m_URL;
+		HTTPRequestTag m_Tag;
+		std::filesystem::path m_PartPath;
+		std::filesystem::path m_StatePath;
+
+		// Without ranges, there's a single segment with no known end, and nothing to resume
+		bool m_Ranged = false;
+		uint64_t m_Length = 0;
+		std::string m_Validator;  // ETag, or Last-Modified if there wasn't one
+
+		struct Segment
+		{
+			uint64_t m_Begin = 0;
+			uint64_t m_End = 0;
+			uint64_t m_Done = 0;    // Bytes from m_Begin that are already in the .part file
+
+			bool IsComplete() const { return (m_Begin + m_Done) >= m_End; }
+		};
+		std::vector<Segment> m_Segments; // Never resized once the download starts
+		std::mutex m_Mutex;              // m_Done of each segment, and the state file
+
+		// Whether the state file is for this same file, and the .part file is still there
+		bool TryLoad();
+		void Save() const;
+		uint64_t GetDoneBytes() const;
+	};
+
 	class HTTPClientImpl final : public IHTTPClient
 	{
 	public:
-		std::string GetString(const URL& url) const override;
-		mh::task<std::string> GetStringAsync(URL url) const override;
+		std::string GetString(const URL& url, HTTPRequestTag tag) const override;
+		mh::task<std::string> GetStringAsync(URL url, HTTPRequestTag tag, CancellationToken cancel = {}) const override;
+		mh::task<HTTPConditionalResponse> GetStringConditionalAsync(URL url, HTTPRequestTag tag, HTTPCacheValidators validators) const override;
+		mh::task<> PutStringAsync(URL url, HTTPRequestTag tag, std::string body, std::string contentType) const override;
+		mh::task<> DownloadFileAsync(URL url, HTTPRequestTag tag, std::filesystem::path path) const override;
 
 		RequestCounts GetRequestCounts() const override;
+		void RecordNegativeCacheLookup(bool hit) const override;
+		std::vector<HostStats> GetHostStats() const override;
+		TagStats GetTagStats(HTTPRequestTag tag) const override;
+		void PrewarmHosts(std::vector<URL> hosts) const override;
 
 	private:
+		HostStatsCounters& GetHostStatsCounters(const std::string& host) const;
+		mutable std::shared_mutex m_HostStatsMutex;
+		mutable std::map<std::string, std::unique_ptr<HostStatsCounters>, std::less<>> m_HostStats;
+
+		struct TagCounters
+		{
+			std::atomic_uint32_t m_Requests = 0;
+			std::atomic_uint32_t m_Failed = 0;
+			std::atomic_uint64_t m_BytesSent = 0;
+			std::atomic_uint64_t m_BytesTransferred = 0;
+			std::atomic_uint64_t m_BytesReceived = 0;
+			std::atomic_uint32_t m_RateLimitWaits = 0;
+			std::atomic_uint64_t m_RateLimitWaitMS = 0;
+		};
+		TagCounters& GetTagCounters(HTTPRequestTag tag) const { return m_TagCounters[size_t(tag)]; }
+		mutable std::array<TagCounters, size_t(HTTPRequestTag::COUNT)> m_TagCounters;
+
+		// Identical requests made while one is already in flight share its result
+		struct SharedRequest
+		{
+			mh::task<std::string> m_Task;
+			std::vector<CancellationToken> m_Waiters;
+		};
+		mh::task<std::string> GetSharedStringAsync(std::string key, URL url, HTTPRequestTag tag) const;
+		bool IsSharedRequestCancelled(const std::string& key) const;
+		mutable std::recursive_mutex m_SharedRequestsMutex;
+		mutable std::map<std::string, SharedRequest, std::less<>> m_InFlightRequests;
+
+		// Split into DOWNLOAD_MAX_SEGMENTS ranges at most, each at least DOWNLOAD_MIN_SEGMENT_SIZE
+		static constexpr size_t DOWNLOAD_MAX_SEGMENTS = 4;
+		static constexpr uint64_t DOWNLOAD_MIN_SEGMENT_SIZE = 2 * 1024 * 1024;
+		static constexpr size_t DOWNLOAD_CHUNK_SIZE = 256 * 1024;
+		static constexpr int32_t DOWNLOAD_SEGMENT_RETRIES = 5;
+		mh::task<> DownloadSegmentAsync(std::shared_ptr<DownloadState> state, size_t index) const;
+
+		// Rate limited and counted like any other request, but the body is left for the caller to read
+		mh::task<web::http::http_response> SendDownloadRequestAsync(const URL& url, HTTPRequestTag tag,
+			web::http::http_request request) const;
+
+		// Dropped before it's sent once IsSharedRequestCancelled(sharedKey), unless sharedKey is empty
+		mh::task<HTTPConditionalResponse> SendRequestAsync(URL url, HTTPRequestTag tag, HTTPCacheValidators validators,
+			std::string sharedKey) const;
+
+		// Tiny, only meant to catch the same thing being asked for from several places in a row
+		static constexpr duration_t RESPONSE_CACHE_LIFETIME = 10s;
+		static constexpr size_t RESPONSE_CACHE_MAX_SIZE = 256 * 1024;
+		struct CachedResponse
+		{
+			std::string m_Body;
+			tfbd_clock_t::time_point m_ExpirationTime;
+		};
+		mutable std::map<std::string, CachedResponse, std::less<>> m_ResponseCache;
+
 		mutable std::mutex m_InnerClientMutex;
 		mutable std::map<std::string, std::shared_ptr<web::http::client::http_client>> m_InnerClients;
+		mutable std::map<std::string, tfbd_clock_t::time_point> m_InnerClientLastUsed;
 		std::shared_ptr<web::http::client::http_client> GetInnerClient(const URL& url) const;
+		duration_t GetInnerClientIdleTime(const URL& url) const;
+
+		// Under most servers' keep-alive timeouts (nginx's 75s default, for one)
+		static constexpr duration_t KEEP_WARM_INTERVAL = 50s;
+		static mh::task<> KeepWarm(std::weak_ptr<const IHTTPClient> weakSelf, URL url);
+		mh::task<> SendKeepWarmRequest(URL url) const;
+		mutable std::mutex m_KeepWarmMutex;
+		mutable std::map<std::string, mh::task<>> m_KeepWarmTasks;
 
 		mutable std::atomic_uint32_t m_TotalRequestCount = 0;
 		mutable std::atomic_uint32_t m_FailedRequestCount = 0;
+		mutable std::atomic_uint32_t m_CancelledRequestCount = 0;
 
 		// This is a pretty stupid way of implementing this lol, but its easy
 		struct RequestInProgressObj {};
 		struct RequestQueuedObj {};
 		const std::shared_ptr<RequestInProgressObj> m_InProgressRequestCount = std::make_shared<RequestInProgressObj>();
 		const std::shared_ptr<RequestQueuedObj> m_QueuedRequestCount = std::make_shared<RequestQueuedObj>();
+
+		mutable HTTPRateLimiter m_RateLimiter;
+		struct RequestRateLimitedObj {};
+		const std::shared_ptr<RequestRateLimitedObj> m_RateLimitedRequestCount = std::make_shared<RequestRateLimitedObj>();
+		mutable std::atomic_uint32_t m_RateLimitWaitCount = 0;
+		mutable std::atomic_uint64_t m_TotalRateLimitWaitMS = 0;
+		mutable std::atomic_uint64_t m_MaxRateLimitWaitMS = 0;
+		void RecordRateLimitWait(std::chrono::milliseconds wait, HTTPRequestTag tag) const;
+
+		mutable std::atomic_uint32_t m_NegativeCacheLookupCount = 0;
+		mutable std::atomic_uint32_t m_NegativeCacheHitCount = 0;
+
+		mutable std::atomic_uint64_t m_BytesTransferred = 0;
+		mutable std::atomic_uint64_t m_BytesReceived = 0;
+		mutable std::atomic_uint32_t m_CompressedResponseCount = 0;
+		void RecordResponseSize(const web::http::http_response& response, size_t bodySize, HTTPRequestTag tag) const;
+	};
+}
+
+uint32_t HostStatsCounters::GetCurrentSecond()
+{
+	return uint32_t(std::chrono::duration_cast<std::chrono::seconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void HostStatsCounters::AddRequest(std::chrono::milliseconds latency, size_t bytes)
+{
+	m_Requests++;
+	m_BytesReceived += bytes;
+
+	const auto ms = uint64_t(std::max<int64_t>(latency.count(), 0));
+	m_LatencyHistogram[std::min<size_t>(ms ? std::bit_width(ms) - 1 : 0, LATENCY_BUCKET_COUNT - 1)]++;
+
+	AddToLastMinute();
+}
+
+void HostStatsCounters::AddToLastMinute()
+{
+	const uint32_t second = GetCurrentSecond();
+	auto& slot = m_RequestsPerSecond[second % m_RequestsPerSecond.size()];
+
+	uint64_t current = slot.load(std::memory_order_relaxed);
+	uint64_t desired;
+	do
+	{
+		if (uint32_t(current >> 32) == second)
+			desired = current + 1;
+		else
+			desired = (uint64_t(second) << 32) | 1; // Slot was for a minute ago, start over
+	} while (!slot.compare_exchange_weak(current, desired, std::memory_order_relaxed));
+}
+
+std::chrono::milliseconds HostStatsCounters::GetLatencyPercentile(float percentile) const
+{
+	std::array<uint32_t, LATENCY_BUCKET_COUNT> histogram;
+	uint32_t total = 0;
+	for (size_t i = 0; i < histogram.size(); i++)
+		total += (histogram[i] = m_LatencyHistogram[i].load(std::memory_order_relaxed));
+
+	const auto target = uint32_t(total * percentile);
+	uint32_t seen = 0;
+	for (size_t i = 0; i < histogram.size(); i++)
+	{
+		seen += histogram[i];
+		if (seen > target)
+			return std::chrono::milliseconds(uint64_t(1) << (i + 1));
+	}
+
+	return {};
+}
+
+IHTTPClient::HostStats HostStatsCounters::GetStats(std::string host) const
+{
+	const uint32_t now = GetCurrentSecond();
+	uint32_t lastMinute = 0;
+	for (const auto& slot : m_RequestsPerSecond)
+	{
+		const uint64_t value = slot.load(std::memory_order_relaxed);
+		if ((now - uint32_t(value >> 32)) < m_RequestsPerSecond.size())
+			lastMinute += uint32_t(value);
+	}
+
+	return IHTTPClient::HostStats
+	{
+		.m_Host = std::move(host),
+		.m_Requests = m_Requests,
+		.m_Failed = m_Failed,
+		.m_Retries = m_Retries,
+		.m_RequestsLastMinute = lastMinute,
+		.m_BytesReceived = m_BytesReceived,
+		.m_LatencyP50 = GetLatencyPercentile(0.5f),
+		.m_LatencyP95 = GetLatencyPercentile(0.95f),
+		.m_LatencyP99 = GetLatencyPercentile(0.99f),
 	};
 }
 
-std::string HTTPClientImpl::GetString(const URL& url) const
+std::string HTTPClientImpl::GetString(const URL& url, HTTPRequestTag tag) const
 {
-	auto task = GetStringAsync(url);
+	auto task = GetStringAsync(url, tag);
 	task.wait();
-	return std::move(task.get());
+	return task.get(); // Might be shared with other callers, so no moving out of it
 }
 
 std::shared_ptr<web::http::client::http_client> HTTPClientImpl::GetInnerClient(const URL& url) const
@@ -57,6 +292,8 @@ std::shared_ptr<web::http::client::http_client> HTTPClientImpl::GetInnerClient(c
 	std::lock_guard lock(m_InnerClientMutex);
 
 	const std::string schemeHostPort = url.GetSchemeHostPort();
+	m_InnerClientLastUsed.insert_or_assign(schemeHostPort, tfbd_clock_t::now());
+
 	if (auto found = m_InnerClients.find(schemeHostPort); found != m_InnerClients.end())
 	{
 		return found->second;
@@ -68,29 +305,517 @@ std::shared_ptr<web::http::client::http_client> HTTPClientImpl::GetInnerClient(c
 	}
 }
 
-static duration_t GetMinRequestInterval(const URL& url)
+duration_t HTTPClientImpl::GetInnerClientIdleTime(const URL& url) const
+{
+	std::lock_guard lock(m_InnerClientMutex);
+
+	if (auto found = m_InnerClientLastUsed.find(url.GetSchemeHostPort()); found != m_InnerClientLastUsed.end())
+		return tfbd_clock_t::now() - found->second;
+
+	return duration_t::max();
+}
+
+void HTTPClientImpl::PrewarmHosts(std::vector<URL> hosts) const
+{
+	std::lock_guard lock(m_KeepWarmMutex);
+
+	for (auto& url : hosts)
+	{
+		std::string key = url.GetSchemeHostPort();
+		if (!m_KeepWarmTasks.contains(key))
+			m_KeepWarmTasks.emplace(std::move(key), KeepWarm(weak_from_this(), std::move(url)));
+	}
+}
+
+mh::task<> HTTPClientImpl::KeepWarm(std::weak_ptr<const IHTTPClient> weakSelf, URL url)
+{
+	while (true)
+	{
+		// Don't keep the client alive just for this
+		if (auto self = std::static_pointer_cast<const HTTPClientImpl>(weakSelf.lock()))
+		{
+			// Real requests keep the connection open just as well
+			if (self->GetInnerClientIdleTime(url) >= KEEP_WARM_INTERVAL)
+				co_await self->SendKeepWarmRequest(url);
+		}
+		else
+		{
+			co_return;
+		}
+
+		co_await GetDispatcher().co_delay_for(KEEP_WARM_INTERVAL);
+	}
+}
+
+mh::task<> HTTPClientImpl::SendKeepWarmRequest(URL url) const try
+{
+	auto self = shared_from_this(); // Make sure we don't vanish
+
+	// Whatever the status is, the connection is open. Not counted as a request, and skips the rate
+	// limiter since it doesn't touch any api.
+	web::http::http_request request(web::http::methods::HEAD);
+	request.set_request_uri(utility::conversions::to_string_t("/"));
+
+	const auto startTime = tfbd_clock_t::now();
+	co_await GetInnerClient(url)->request(request);
+
+	DebugLog("[{}ms] Kept {} warm", std::chrono::duration_cast<std::chrono::milliseconds>(tfbd_clock_t::now() - startTime).count(),
+		url.GetSchemeHostPort());
+}
+catch (...)
+{
+	DebugLogException("Failed to keep {} warm", url.GetSchemeHostPort());
+}
+
+mh::task<std::string> HTTPClientImpl::GetStringAsync(URL url, HTTPRequestTag tag, CancellationToken cancel) const
+{
+	if (cancel.IsCancelled())
+	{
+		m_CancelledRequestCount++;
+		throw OperationCanceledError();
+	}
+
+	std::string key = url.ToString();
+
+	std::lock_guard lock(m_SharedRequestsMutex);
+
+	if (auto found = m_ResponseCache.find(key); found != m_ResponseCache.end())
+	{
+		if (tfbd_clock_t::now() < found->second.m_ExpirationTime)
+			return mh::make_ready_task<std::string>(found->second.m_Body);
+
+		m_ResponseCache.erase(found);
+	}
+
+	if (auto found = m_InFlightRequests.find(key); found != m_InFlightRequests.end())
+	{
+		found->second.m_Waiters.push_back(std::move(cancel));
+		return found->second.m_Task;
+	}
+
+	auto task = GetSharedStringAsync(key, std::move(url), tag);
+
+	// If it somehow already finished, it has already tried (and failed) to remove itself
+	if (!task.is_ready())
+		m_InFlightRequests.emplace(std::move(key), SharedRequest{ task, { std::move(cancel) } });
+
+	return task;
+}
+
+bool HTTPClientImpl::IsSharedRequestCancelled(const std::string& key) const
+{
+	std::lock_guard lock(m_SharedRequestsMutex);
+
+	// Not in there yet if it's still being created, by someone who just checked their token
+	const auto found = m_InFlightRequests.find(key);
+	if (found == m_InFlightRequests.end())
+		return false;
+
+	return std::all_of(found->second.m_Waiters.begin(), found->second.m_Waiters.end(),
+		[](const CancellationToken& token) { return token.IsCancelled(); });
+}
+
+mh::task<std::string> HTTPClientImpl::GetSharedStringAsync(std::string key, URL url, HTTPRequestTag tag) const
+{
+	auto self = shared_from_this(); // Make sure we don't vanish
+
+	std::string body;
+	try
+	{
+		body = (co_await SendRequestAsync(std::move(url), tag, {}, key)).m_Body;
+	}
+	catch (...)
+	{
+		std::lock_guard lock(m_SharedRequestsMutex);
+		m_InFlightRequests.erase(key);
+		throw;
+	}
+
+	{
+		std::lock_guard lock(m_SharedRequestsMutex);
+		m_InFlightRequests.erase(key);
+
+		const auto now = tfbd_clock_t::now();
+		std::erase_if(m_ResponseCache, [&](const auto& entry) { return now >= entry.second.m_ExpirationTime; });
+
+		if (body.size() <= RESPONSE_CACHE_MAX_SIZE)
+			m_ResponseCache.insert_or_assign(std::move(key), CachedResponse{ body, now + RESPONSE_CACHE_LIFETIME });
+	}
+
+	co_return body;
+}
+
+mh::task<HTTPConditionalResponse> HTTPClientImpl::GetStringConditionalAsync(URL url, HTTPRequestTag tag,
+	HTTPCacheValidators validators) const
+{
+	return SendRequestAsync(std::move(url), tag, std::move(validators), {});
+}
+
+mh::task<> HTTPClientImpl::PutStringAsync(URL url, HTTPRequestTag tag, std::string body, std::string contentType) const try
+{
+	auto self = shared_from_this(); // Make sure we don't vanish
+	HostStatsCounters& hostStats = GetHostStatsCounters(url.m_Host);
+	TagCounters& tagCounters = GetTagCounters(tag);
+
+	if (const auto sendTime = m_RateLimiter.Reserve(url); sendTime > HTTPRateLimiter::clock_t::now())
+	{
+		auto queuedObj = m_QueuedRequestCount;
+		auto rateLimitedObj = m_RateLimitedRequestCount;
+		const auto waitStart = HTTPRateLimiter::clock_t::now();
+		co_await GetDispatcher().co_delay_until(sendTime);
+		RecordRateLimitWait(std::chrono::duration_cast<std::chrono::milliseconds>(HTTPRateLimiter::clock_t::now() - waitStart), tag);
+	}
+
+	auto inProgressObj = m_InProgressRequestCount;
+	const auto startTime = tfbd_clock_t::now();
+	const auto requestIndex = ++m_TotalRequestCount;
+	tagCounters.m_Requests++;
+	tagCounters.m_BytesSent += body.size();
+	try
+	{
+		web::http::http_request request(web::http::methods::PUT);
+		request.set_request_uri(utility::conversions::to_string_t(url.m_Path));
+		request.set_body(body, contentType);
+
+		auto response = co_await GetInnerClient(url)->request(request);
+		if (response.status_code() >= 400 && response.status_code() < 600)
+			throw http_error((HTTPResponseCode)response.status_code(), mh::format("Failed to HTTP PUT {}", url));
+
+		const auto duration = tfbd_clock_t::now() - startTime;
+		hostStats.AddRequest(std::chrono::duration_cast<std::chrono::milliseconds>(duration), 0);
+		DebugLog("[{}ms] HTTP PUT #{} ({} bytes): {}", std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(),
+			requestIndex, body.size(), url);
+	}
+	catch (...)
+	{
+		++m_FailedRequestCount;
+		tagCounters.m_Failed++;
+		hostStats.AddFailure();
+		throw;
+	}
+}
+catch (const http_error&)
+{
+	DebugLogException("{}", url);
+	throw;
+}
+catch (...)
+{
+	LogException("{}", url);
+	throw;
+}
+
+DownloadState::DownloadState(URL url, HTTPRequestTag tag, const std::filesystem::path& path) :
+	m_URL(std::move(url)),
+	m_Tag(tag),
+	m_PartPath(std::filesystem::path(path).concat(".part")),
+	m_StatePath(std::filesystem::path(path).concat(".part.json"))
+{
+}
+
+bool DownloadState::TryLoad() try
+{
+	std::ifstream file(m_StatePath);
+	if (!file.good())
+		return false;
+
+	const auto json = nlohmann::json::parse(file);
+	if (json.at("url").get<std::string>() != m_URL.ToString() ||
+		json.at("length").get<uint64_t>() != m_Length ||
+		json.at("validator").get<std::string>() != m_Validator)
+	{
+		DebugLog("{} changed on the server since it was partially downloaded, starting over", m_URL);
+		return false;
+	}
+
+	std::error_code ec;
+	if (std::filesystem::file_size(m_PartPath, ec) != m_Length || ec)
+		return false;
+
+	std::vector<Segment> segments;
+	for (const auto& segment : json.at("segments"))
+	{
+		segments.push_back(Segment
+			{
+				.m_Begin = segment.at(0).get<uint64_t>(),
+				.m_End = segment.at(1).get<uint64_t>(),
+				.m_Done = segment.at(2).get<uint64_t>(),
+			});
+	}
+
+	if (segments.empty() || segments.front().m_Begin != 0 || segments.back().m_End != m_Length)
+		return false;
+
+	m_Segments = std::move(segments);
+	return true;
+}
+catch (...)
+{
+	DebugLogException("Ignoring the state of the partial download of {}", m_URL);
+	return false;
+}
+
+void DownloadState::Save() const
+{
+	nlohmann::json segments = nlohmann::json::array();
+	for (const Segment& segment : m_Segments)
+		segments.push_back({ segment.m_Begin, segment.m_End, segment.m_Done });
+
+	const nlohmann::json json =
+	{
+		{ "url", m_URL.ToString() },
+		{ "length", m_Length },
+		{ "validator", m_Validator },
+		{ "segments", std::move(segments) },
+	};
+
+	std::ofstream file(m_StatePath, std::ios::trunc);
+	file << json.dump();
+}
+
+uint64_t DownloadState::GetDoneBytes() const
 {
-	if (url.m_Host.ends_with("akamaihd.net") ||
-		url.m_Host.ends_with("steamstatic.com"))
+	uint64_t done = 0;
+	for (const Segment& segment : m_Segments)
+		done += segment.m_Done;
+
+	return done;
+}
+
+mh::task<> HTTPClientImpl::DownloadFileAsync(URL url, HTTPRequestTag tag, std::filesystem::path path) const try
+{
+	auto self = shared_from_this(); // Make sure we don't vanish
+	auto state = std::make_shared<DownloadState>(url, tag, path);
+
+	using web::http::header_names;
+
+	// How big it is, and whether it can be fetched in pieces
+	{
+		web::http::http_request request(web::http::methods::HEAD);
+		request.set_request_uri(utility::conversions::to_string_t(url.m_Path));
+		const auto response = co_await SendDownloadRequestAsync(url, tag, std::move(request));
+		const auto& headers = response.headers();
+
+		if (auto found = headers.find(header_names::etag); found != headers.end())
+			state->m_Validator = utility::conversions::to_utf8string(found->second);
+		else if (auto found = headers.find(header_names::last_modified); found != headers.end())
+			state->m_Validator = utility::conversions::to_utf8string(found->second);
+
+		const auto acceptRanges = headers.find(header_names::accept_ranges);
+		state->m_Length = headers.has(header_names::content_length) ? headers.content_length() : 0;
+		state->m_Ranged = state->m_Length > 0 && acceptRanges != headers.end() &&
+			utility::conversions::to_utf8string(acceptRanges->second) == "bytes";
+	}
+
+	std::filesystem::create_directories(path.parent_path());
+
+	if (!state->m_Ranged)
 	{
-		return 0ms;
+		state->m_Segments.push_back({});
+		std::ofstream(state->m_PartPath, std::ios::binary | std::ios::trunc);
+		std::filesystem::remove(state->m_StatePath);
 	}
-	else if (url.m_Host == "api.steampowered.com" || url.m_Host == "tf2bd-util.pazer.us")
+	else if (state->TryLoad())
 	{
-		if (mh::case_insensitive_view(url.m_Path).find("/GetPlayerItems/") != url.m_Path.npos)
-			return 1000ms; // This is a slow/heavily throttled api
+		Log("Resuming the download of {}, {} of {} bytes already downloaded", url, state->GetDoneBytes(), state->m_Length);
+	}
+	else
+	{
+		const size_t segmentCount = std::clamp<size_t>(state->m_Length / DOWNLOAD_MIN_SEGMENT_SIZE, 1, DOWNLOAD_MAX_SEGMENTS);
+		const uint64_t segmentSize = state->m_Length / segmentCount;
+
+		state->m_Segments.clear();
+		for (size_t i = 0; i < segmentCount; i++)
+		{
+			state->m_Segments.push_back(DownloadState::Segment
+				{
+					.m_Begin = i * segmentSize,
+					.m_End = (i + 1) == segmentCount ? state->m_Length : (i + 1) * segmentSize,
+				});
+		}
 
-		return 100ms;
+		std::ofstream(state->m_PartPath, std::ios::binary | std::ios::trunc);
+		std::filesystem::resize_file(state->m_PartPath, state->m_Length);
+		state->Save();
 	}
-	else if (url.m_Host == "steamcommunity.com")
+
+	const auto startTime = tfbd_clock_t::now();
+
+	std::vector<mh::task<>> segments;
+	for (size_t i = 0; i < state->m_Segments.size(); i++)
+		segments.push_back(DownloadSegmentAsync(state, i));
+
+	// Let the others finish (and save what they got) even if one of them fails
+	std::exception_ptr error;
+	for (auto& segment : segments)
 	{
-		return 2000ms;
+		try
+		{
+			co_await segment;
+		}
+		catch (...)
+		{
+			if (!error)
+				error = std::current_exception();
+		}
 	}
 
-	return 500ms;
+	if (error)
+		std::rethrow_exception(error);
+
+	std::filesystem::remove(state->m_StatePath);
+	std::filesystem::rename(state->m_PartPath, path);
+
+	DebugLog("[{}ms] Downloaded {} ({} bytes, {} segments) -> {}",
+		std::chrono::duration_cast<std::chrono::milliseconds>(tfbd_clock_t::now() - startTime).count(),
+		url, state->GetDoneBytes(), state->m_Segments.size(), path);
+}
+catch (...)
+{
+	LogException("Failed to download {} to {}", url, path);
+	throw;
 }
 
-mh::task<std::string> HTTPClientImpl::GetStringAsync(URL url) const try
+mh::task<> HTTPClientImpl::DownloadSegmentAsync(std::shared_ptr<DownloadState> state, size_t index) const
+{
+	auto self = shared_from_this(); // Make sure we don't vanish
+	DownloadState::Segment& segment = state->m_Segments[index];
+
+	std::fstream file(state->m_PartPath, std::ios::binary | std::ios::in | std::ios::out);
+	if (!file.good())
+		throw std::runtime_error(mh::format("Failed to open {}", state->m_PartPath));
+
+	int32_t retryCount = 0;
+	while (true)
+	{
+		uint64_t offset;
+		{
+			std::lock_guard lock(state->m_Mutex);
+			if (state->m_Ranged && segment.IsComplete())
+				co_return;
+
+			offset = segment.m_Begin + segment.m_Done;
+		}
+
+		try
+		{
+			web::http::http_request request(web::http::methods::GET);
+			request.set_request_uri(utility::conversions::to_string_t(state->m_URL.m_Path));
+			if (state->m_Ranged)
+			{
+				request.headers().add(web::http::header_names::range,
+					utility::conversions::to_string_t(mh::format("bytes={}-{}", offset, segment.m_End - 1)));
+			}
+
+			auto response = co_await SendDownloadRequestAsync(state->m_URL, state->m_Tag, std::move(request));
+			if (state->m_Ranged && response.status_code() != web::http::status_codes::PartialContent)
+			{
+				throw std::runtime_error(mh::format("{} sent HTTP {} instead of the requested range",
+					state->m_URL, response.status_code()));
+			}
+
+			file.seekp(offset);
+
+			auto body = response.body();
+			uint64_t received = 0;
+			while (true)
+			{
+				concurrency::streams::container_buffer<std::string> buffer;
+				const size_t read = co_await body.read(buffer, DOWNLOAD_CHUNK_SIZE);
+				if (read == 0)
+					break;
+
+				file.write(buffer.collection().data(), read);
+				file.flush();
+				if (!file.good())
+					throw std::runtime_error(mh::format("Failed to write to {}", state->m_PartPath));
+
+				received += read;
+				GetHostStatsCounters(state->m_URL.m_Host).AddBytesReceived(read);
+
+				std::lock_guard lock(state->m_Mutex);
+				segment.m_Done += read;
+				if (state->m_Ranged)
+					state->Save();
+			}
+
+			RecordResponseSize(response, received, state->m_Tag);
+
+			if (!state->m_Ranged || segment.IsComplete())
+				co_return;
+
+			throw web::http::http_exception(utility::conversions::to_string_t(
+				mh::format("Connection closed {} bytes into the range", received)));
+		}
+		catch (const http_error& e)
+		{
+			// Same as SendRequestAsync(), a busy server is worth waiting on
+			if (!state->m_Ranged || retryCount >= DOWNLOAD_SEGMENT_RETRIES ||
+				(e.code() != HTTPResponseCode::TooManyRequests && int(e.code().value()) < 500))
+			{
+				throw;
+			}
+		}
+		catch (const web::http::http_exception& e)
+		{
+			if (!state->m_Ranged || retryCount >= DOWNLOAD_SEGMENT_RETRIES)
+				throw;
+
+			DebugLogWarning("Segment {} of {} failed: {}", index, state->m_URL, e.what());
+		}
+
+		retryCount++;
+		GetHostStatsCounters(state->m_URL.m_Host).AddRetry();
+		co_await GetDispatcher().co_delay_for(retryCount * 2s);
+		DebugLogWarning("Retry #{} for segment {} of {}", retryCount, index, state->m_URL);
+	}
+}
+
+mh::task<web::http::http_response> HTTPClientImpl::SendDownloadRequestAsync(const URL& url, HTTPRequestTag tag,
+	web::http::http_request request) const
+{
+	auto self = shared_from_this(); // Make sure we don't vanish
+	HostStatsCounters& hostStats = GetHostStatsCounters(url.m_Host);
+	TagCounters& tagCounters = GetTagCounters(tag);
+
+	if (const auto sendTime = m_RateLimiter.Reserve(url); sendTime > HTTPRateLimiter::clock_t::now())
+	{
+		auto queuedObj = m_QueuedRequestCount;
+		auto rateLimitedObj = m_RateLimitedRequestCount;
+		const auto waitStart = HTTPRateLimiter::clock_t::now();
+		co_await GetDispatcher().co_delay_until(sendTime);
+		RecordRateLimitWait(std::chrono::duration_cast<std::chrono::milliseconds>(HTTPRateLimiter::clock_t::now() - waitStart), tag);
+	}
+
+	auto inProgressObj = m_InProgressRequestCount;
+	const auto startTime = tfbd_clock_t::now();
+	const auto requestIndex = ++m_TotalRequestCount;
+	tagCounters.m_Requests++;
+	try
+	{
+		const auto method = utility::conversions::to_utf8string(request.method());
+		auto response = co_await GetInnerClient(url)->request(request);
+		if (response.status_code() >= 400 && response.status_code() < 600)
+			throw http_error((HTTPResponseCode)response.status_code(), mh::format("Failed to HTTP {} {}", method, url));
+
+		// The body is counted as it's read
+		const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(tfbd_clock_t::now() - startTime);
+		hostStats.AddRequest(duration, 0);
+		DebugLog("[{}ms] HTTP {} #{} (download): {}", duration.count(), method, requestIndex, url);
+
+		co_return response;
+	}
+	catch (...)
+	{
+		++m_FailedRequestCount;
+		tagCounters.m_Failed++;
+		hostStats.AddFailure();
+		throw;
+	}
+}
+
+mh::task<HTTPConditionalResponse> HTTPClientImpl::SendRequestAsync(URL url, HTTPRequestTag tag, HTTPCacheValidators validators,
+	std::string sharedKey) const try
 {
 	auto self = shared_from_this(); // Make sure we don't vanish
 	std::shared_ptr<RequestInProgressObj> inProgressObj;
@@ -112,72 +837,110 @@ mh::task<std::string> HTTPClientImpl::GetStringAsync(URL url) const try
 
 	SetThrottled(false);
 
-	int32_t retryCount = 0;
-	while (true)
+	const auto ThrowIfCancelled = [&]
 	{
-		using throttle_time_t = mh::thread_pool::clock_t::time_point;
-		throttle_time_t throttleTime{};
+		if (!sharedKey.empty() && IsSharedRequestCancelled(sharedKey))
 		{
-			const duration_t MIN_INTERVAL = GetMinRequestInterval(url);
-
-			static std::mutex s_ThrottleMutex;
-			static std::map<std::string, throttle_time_t> s_ThrottleDomains;
-			std::lock_guard lock(s_ThrottleMutex);
+			m_CancelledRequestCount++;
+			throw OperationCanceledError();
+		}
+	};
 
-			auto now = mh::thread_pool::clock_t::now();
+	HostStatsCounters& hostStats = GetHostStatsCounters(url.m_Host);
+	TagCounters& tagCounters = GetTagCounters(tag);
 
-			if (auto found = s_ThrottleDomains.find(url.m_Host);
-				found != s_ThrottleDomains.end())
-			{
-				if (now > found->second)
-				{
-					found->second = now + MIN_INTERVAL;
-				}
-				else
-				{
-					throttleTime = found->second;
-					found->second += MIN_INTERVAL;
-				}
-			}
-			else
-			{
-				s_ThrottleDomains.emplace(url.m_Host, now + MIN_INTERVAL);
-			}
-		}
+	int32_t retryCount = 0;
+	while (true)
+	{
+		ThrowIfCancelled();
 
-		if (throttleTime != throttle_time_t{})
+		if (const auto sendTime = m_RateLimiter.Reserve(url); sendTime > HTTPRateLimiter::clock_t::now())
 		{
+			const auto waitStart = HTTPRateLimiter::clock_t::now();
+
 			SetThrottled(true);
-			co_await GetDispatcher().co_delay_until(throttleTime);
+			auto rateLimitedObj = m_RateLimitedRequestCount;
+			co_await GetDispatcher().co_delay_until(sendTime);
+			rateLimitedObj.reset();
 			SetThrottled(false);
+
+			RecordRateLimitWait(std::chrono::duration_cast<std::chrono::milliseconds>(HTTPRateLimiter::clock_t::now() - waitStart), tag);
+
+			// Could have been a while
+			ThrowIfCancelled();
 		}
 
 		auto retryDelayTime = 10s;
 		try
 		{
+			const auto startTime = tfbd_clock_t::now();
+			uint16_t statusCode = 0;
+
 			try // exceptions are fun and cool and not a code smell
 			{
 				auto requestIndex = ++m_TotalRequestCount;
+				tagCounters.m_Requests++;
 
 				auto client = GetInnerClient(url);
 
-				const auto startTime = tfbd_clock_t::now();
+				using web::http::header_names;
+
+				web::http::http_request request(web::http::methods::GET);
+				request.set_request_uri(utility::conversions::to_string_t(url.m_Path));
+				if (!validators.m_ETag.empty())
+					request.headers().add(header_names::if_none_match, utility::conversions::to_string_t(validators.m_ETag));
+				if (!validators.m_LastModified.empty())
+					request.headers().add(header_names::if_modified_since, utility::conversions::to_string_t(validators.m_LastModified));
+
+				// Asks for everything cpprest was built to decompress (gzip/deflate/brotli), and
+				// decompresses it as it's read rather than after the whole thing has arrived
+				request.set_decompress_factories();
 
-				auto response = co_await client->request(web::http::methods::GET, utility::conversions::to_string_t(url.m_Path));
+				auto response = co_await client->request(request);
+				statusCode = response.status_code();
 
 				if (response.status_code() >= 400 && response.status_code() < 600)
 					throw http_error((HTTPResponseCode)response.status_code(), mh::format("Failed to HTTP GET {}", url));
 
-				std::string stringResponse = co_await response.extract_utf8string(true);
+				HTTPConditionalResponse retVal;
+				retVal.m_NotModified = response.status_code() == web::http::status_codes::NotModified;
+
+				if (auto found = response.headers().find(header_names::etag); found != response.headers().end())
+					retVal.m_Validators.m_ETag = utility::conversions::to_utf8string(found->second);
+				if (auto found = response.headers().find(header_names::last_modified); found != response.headers().end())
+					retVal.m_Validators.m_LastModified = utility::conversions::to_utf8string(found->second);
+
+				if (!retVal.m_NotModified)
+					retVal.m_Body = co_await response.extract_utf8string(true);
+
+				RecordResponseSize(response, retVal.m_Body.size(), tag);
+
+				const TrackedMemory trackedResponse(MemoryCategory::HTTPResponses, retVal.m_Body.size());
 
 				const auto duration = tfbd_clock_t::now() - startTime;
-				DebugLog("[{}ms] HTTP GET #{}: {}", std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(), requestIndex, url);
+				hostStats.AddRequest(std::chrono::duration_cast<std::chrono::milliseconds>(duration), retVal.m_Body.size());
+				DebugLog("[{}ms] HTTP GET #{}{}: {}", std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(), requestIndex,
+					retVal.m_NotModified ? " (not modified)" : "", url);
+				if (IEventLog::IsEnabled())
+				{
+					IEventLog::Record(EventLogRecordType::HTTPRequest, statusCode,
+						std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(), retVal.m_Body.size(), mh::format("{}", url));
+				}
+				if (!retVal.m_NotModified && ISessionArchive::IsRecording())
+					ISessionArchive::Record(SessionArchiveRecordType::HTTPResponse, url.ToString(), retVal.m_Body);
 
-				co_return std::move(stringResponse);
+				co_return std::move(retVal);
 			}
 			catch (...)
 			{
 				++m_FailedRequestCount;
+				tagCounters.m_Failed++;
+				hostStats.AddFailure();
+				if (IEventLog::IsEnabled())
+				{
+					IEventLog::Record(EventLogRecordType::HTTPRequest, statusCode,
+						std::chrono::duration_cast<std::chrono::milliseconds>(tfbd_clock_t::now() - startTime).count(), 0, mh::format("{}", url));
+				}
 				throw;
 			}
 		}
@@ -224,6 +987,7 @@ mh::task<std::string> HTTPClientImpl::GetStringAsync(URL url) const try
 			SetThrottled(false);
 		}
 		retryCount++;
+		hostStats.AddRetry();
 		DebugLogWarning("Retry #{} for {}", retryCount, url);
 	}
 }
@@ -232,23 +996,125 @@ catch (const http_error&)
 	DebugLogException("{}", url);
 	throw;
 }
+catch (const OperationCanceledError&)
+{
+	DebugLog("Cancelled HTTP GET {}", url);
+	throw;
+}
 catch (...)
 {
 	LogException("{}", url);
 	throw;
 }
 
+void HTTPClientImpl::RecordRateLimitWait(std::chrono::milliseconds wait, HTTPRequestTag tag) const
+{
+	const auto waitMS = uint64_t(wait.count());
+	m_RateLimitWaitCount++;
+	m_TotalRateLimitWaitMS += waitMS;
+
+	TagCounters& tagCounters = GetTagCounters(tag);
+	tagCounters.m_RateLimitWaits++;
+	tagCounters.m_RateLimitWaitMS += waitMS;
+
+	auto maxWait = m_MaxRateLimitWaitMS.load();
+	while (waitMS > maxWait && !m_MaxRateLimitWaitMS.compare_exchange_weak(maxWait, waitMS))
+		;
+}
+
+void HTTPClientImpl::RecordResponseSize(const web::http::http_response& response, size_t bodySize, HTTPRequestTag tag) const
+{
+	using web::http::header_names;
+
+	// Still the size of the compressed body, cpprest doesn't touch the headers when it decompresses
+	uint64_t transferred = bodySize;
+	if (const auto& headers = response.headers(); headers.has(header_names::content_length))
+		transferred = headers.content_length();
+
+	m_BytesTransferred += transferred;
+	m_BytesReceived += bodySize;
+
+	TagCounters& tagCounters = GetTagCounters(tag);
+	tagCounters.m_BytesTransferred += transferred;
+	tagCounters.m_BytesReceived += bodySize;
+
+	if (response.headers().has(header_names::content_encoding))
+		m_CompressedResponseCount++;
+}
+
+HostStatsCounters& HTTPClientImpl::GetHostStatsCounters(const std::string& host) const
+{
+	{
+		std::shared_lock lock(m_HostStatsMutex);
+		if (auto found = m_HostStats.find(host); found != m_HostStats.end())
+			return *found->second;
+	}
+
+	std::unique_lock lock(m_HostStatsMutex);
+	auto& counters = m_HostStats[host];
+	if (!counters)
+		counters = std::make_unique<HostStatsCounters>();
+
+	return *counters;
+}
+
+auto HTTPClientImpl::GetHostStats() const -> std::vector<HostStats>
+{
+	std::shared_lock lock(m_HostStatsMutex);
+
+	std::vector<HostStats> retVal;
+	retVal.reserve(m_HostStats.size());
+	for (const auto& [host, counters] : m_HostStats)
+		retVal.push_back(counters->GetStats(host));
+
+	return retVal;
+}
+
+auto HTTPClientImpl::GetTagStats(HTTPRequestTag tag) const -> TagStats
+{
+	const TagCounters& counters = GetTagCounters(tag);
+
+	return TagStats
+	{
+		.m_Requests = counters.m_Requests,
+		.m_Failed = counters.m_Failed,
+		.m_BytesSent = counters.m_BytesSent,
+		.m_BytesTransferred = counters.m_BytesTransferred,
+		.m_BytesReceived = counters.m_BytesReceived,
+		.m_RateLimitWaits = counters.m_RateLimitWaits,
+		.m_RateLimitWaitTotal = std::chrono::milliseconds(counters.m_RateLimitWaitMS.load()),
+	};
+}
+
 auto HTTPClientImpl::GetRequestCounts() const -> RequestCounts
 {
+	const uint32_t waitCount = m_RateLimitWaitCount;
+
 	return RequestCounts
 	{
 		.m_Total = m_TotalRequestCount,
 		.m_Failed = m_FailedRequestCount,
+		.m_Cancelled = m_CancelledRequestCount,
 		.m_InProgress = static_cast<uint32_t>(m_InProgressRequestCount.use_count() - 1),
 		.m_Throttled = static_cast<uint32_t>(m_QueuedRequestCount.use_count() - 1),
+		.m_RateLimited = static_cast<uint32_t>(m_RateLimitedRequestCount.use_count() - 1),
+		.m_AverageRateLimitWait = std::chrono::milliseconds(waitCount ? m_TotalRateLimitWaitMS / waitCount : 0),
+		.m_MaxRateLimitWait = std::chrono::milliseconds(m_MaxRateLimitWaitMS.load()),
+		.m_NegativeCacheLookups = m_NegativeCacheLookupCount,
+		.m_NegativeCacheHits = m_NegativeCacheHitCount,
+		.m_BytesTransferred = m_BytesTransferred,
+		.m_BytesReceived = m_BytesReceived,
+		.m_CompressedResponses = m_CompressedResponseCount,
 	};
 }
 
+void HTTPClientImpl::RecordNegativeCacheLookup(bool hit) const
+{
+	m_NegativeCacheLookupCount++;
+	if (hit)
+		m_NegativeCacheHitCount++;
+}
+
 std::shared_ptr<IHTTPClient> tf2_bot_detector::IHTTPClient::Create()
 {
 	return std::make_shared<HTTPClientImpl>();
@@ -1,14 +1,57 @@
 #pragma once
 
+#include "Util/CancellationToken.h"
+
 #include <mh/coroutine/task.hpp>
+#include <mh/reflection/enum.hpp>
 
+#include <chrono>
+#include <filesystem>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace tf2_bot_detector
 {
 	class URL;
 
+	// Who a request is for, so what each feature costs in requests, bytes and rate limit waits can
+	// be told apart. Identical GETs that end up sharing one request are counted against whoever
+	// sent it first.
+	enum class HTTPRequestTag
+	{
+		PlayerSummaries,
+		PlayerBans,
+		FriendList,
+		Inventory,
+		Playtime,
+		LogsTF,
+		Avatars,
+		ConfigAutoUpdate,
+		Sponsors,
+		UpdateCheck,     // GitHub releases and the tf2bd-util version check
+		UpdateDownload,
+		RemoteCache,
+
+		COUNT,
+	};
+
+	// Validators from an earlier response, sent back so the server can answer 304 Not Modified
+	struct HTTPCacheValidators
+	{
+		std::string m_ETag;
+		std::string m_LastModified;
+
+		bool empty() const { return m_ETag.empty() && m_LastModified.empty(); }
+	};
+
+	struct HTTPConditionalResponse
+	{
+		bool m_NotModified = false;           // m_Body is empty, whatever the validators were taken from is still current
+		std::string m_Body;
+		HTTPCacheValidators m_Validators;     // For the next request, if the server sent any
+	};
+
 	// Only intended to be stored if you are doing something async
 	class IHTTPClient : public std::enable_shared_from_this<IHTTPClient>
 	{
@@ -17,19 +60,107 @@ namespace tf2_bot_detector
 
 		static std::shared_ptr<IHTTPClient> Create();
 
-		virtual std::string GetString(const URL& url) const = 0;
-		virtual mh::task<std::string> GetStringAsync(URL url) const = 0;
+		virtual std::string GetString(const URL& url, HTTPRequestTag tag) const = 0;
+
+		// Throws OperationCanceledError if cancel is cancelled before the request is sent, including
+		// while it's waiting on the rate limit or a retry. Identical requests share one, which is only
+		// dropped once everyone waiting on it has been cancelled.
+		virtual mh::task<std::string> GetStringAsync(URL url, HTTPRequestTag tag, CancellationToken cancel = {}) const = 0;
+
+		// Sends If-None-Match/If-Modified-Since from the given validators
+		virtual mh::task<HTTPConditionalResponse> GetStringConditionalAsync(URL url, HTTPRequestTag tag,
+			HTTPCacheValidators validators) const = 0;
+
+		// Goes through the same rate limiter as everything else, but is never retried, shared
+		// with another request, or cached. Throws http_error on a 4xx/5xx response.
+		virtual mh::task<> PutStringAsync(URL url, HTTPRequestTag tag, std::string body, std::string contentType) const = 0;
+
+		// For big files. Streams the body to path + ".part" instead of holding it in memory, in a few
+		// ranges at once if the server supports them, then renames it to path. A failed download
+		// leaves the .part file behind, and the next call for the same URL and path only fetches
+		// what's missing, as long as the server still has the same file. Not shared or cached.
+		virtual mh::task<> DownloadFileAsync(URL url, HTTPRequestTag tag, std::filesystem::path path) const = 0;
 
 		struct RequestCounts
 		{
 			uint32_t m_Total;
 			uint32_t m_Failed;
+			uint32_t m_Cancelled;   // Dropped before being sent, see GetStringAsync()
 			uint32_t m_InProgress;  // Waiting on the server
 			uint32_t m_Throttled;   // Locally throttled
+			uint32_t m_RateLimited; // Part of m_Throttled, waiting on the per-host rate limit rather than a retry
+
+			// Of requests that had to wait on the rate limit at all
+			std::chrono::milliseconds m_AverageRateLimitWait;
+			std::chrono::milliseconds m_MaxRateLimitWait;
+
+			// Lookups that checked for a remembered failure first, and how many of them found one
+			uint32_t m_NegativeCacheLookups;
+			uint32_t m_NegativeCacheHits;
+
+			// Response bodies as they came over the wire, and after decompression. Responses without a
+			// Content-Length count the same for both.
+			uint64_t m_BytesTransferred;
+			uint64_t m_BytesReceived;
+			uint32_t m_CompressedResponses;
 		};
 
 		virtual RequestCounts GetRequestCounts() const = 0;
+
+		// For lookups that skip the request entirely on a remembered failure, see DB::FailedLookupCacheInfo
+		virtual void RecordNegativeCacheLookup(bool hit) const = 0;
+
+		struct HostStats
+		{
+			std::string m_Host;
+			uint32_t m_Requests;           // Including retries
+			uint32_t m_Failed;
+			uint32_t m_Retries;
+			uint32_t m_RequestsLastMinute;
+			uint64_t m_BytesReceived;      // Response bodies, after decompression
+
+			// Upper bounds of the power of two bucket each percentile landed in
+			std::chrono::milliseconds m_LatencyP50;
+			std::chrono::milliseconds m_LatencyP95;
+			std::chrono::milliseconds m_LatencyP99;
+		};
+
+		virtual std::vector<HostStats> GetHostStats() const = 0;
+
+		struct TagStats
+		{
+			uint32_t m_Requests;               // Including retries
+			uint32_t m_Failed;
+			uint64_t m_BytesSent;              // Request bodies
+			uint64_t m_BytesTransferred;       // Response bodies as they came over the wire...
+			uint64_t m_BytesReceived;          // ...and after decompression
+			uint32_t m_RateLimitWaits;         // Requests that had to wait on the rate limit at all
+			std::chrono::milliseconds m_RateLimitWaitTotal;
+		};
+
+		virtual TagStats GetTagStats(HTTPRequestTag tag) const = 0;
+
+		// Connects to each of these hosts ahead of the first real request to them, so that isn't the
+		// one paying for DNS and the TLS handshake. After that, the connections are kept from timing
+		// out with a HEAD request whenever they've been idle for a while. Only the scheme, host and
+		// port are used. Hosts that are already being kept warm are skipped.
+		virtual void PrewarmHosts(std::vector<URL> hosts) const = 0;
 	};
 
 	using HTTPClient = IHTTPClient; // temp, but probably valve time temp if i'm being totally honest
 }
+
+MH_ENUM_REFLECT_BEGIN(tf2_bot_detector::HTTPRequestTag)
+	MH_ENUM_REFLECT_VALUE(PlayerSummaries)
+	MH_ENUM_REFLECT_VALUE(PlayerBans)
+	MH_ENUM_REFLECT_VALUE(FriendList)
+	MH_ENUM_REFLECT_VALUE(Inventory)
+	MH_ENUM_REFLECT_VALUE(Playtime)
+	MH_ENUM_REFLECT_VALUE(LogsTF)
+	MH_ENUM_REFLECT_VALUE(Avatars)
+	MH_ENUM_REFLECT_VALUE(ConfigAutoUpdate)
+	MH_ENUM_REFLECT_VALUE(Sponsors)
+	MH_ENUM_REFLECT_VALUE(UpdateCheck)
+	MH_ENUM_REFLECT_VALUE(UpdateDownload)
+	MH_ENUM_REFLECT_VALUE(RemoteCache)
+MH_ENUM_REFLECT_END()
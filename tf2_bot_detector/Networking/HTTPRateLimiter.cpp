@@ -0,0 +1,94 @@
+#include "HTTPRateLimiter.h"
+#include "HTTPHelpers.h"
+
+#include <mh/text/case_insensitive_string.hpp>
+
+#include <algorithm>
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+static bool IsGetPlayerItems(const URL& url)
+{
+	return mh::case_insensitive_view(url.m_Path).find("/GetPlayerItems/") != url.m_Path.npos;
+}
+
+// Steam's limits are per key rather than per address, see SteamAPI::KeyPool
+static std::string_view GetSteamAPIKey(const URL& url)
+{
+	if (url.m_Host != "api.steampowered.com")
+		return {};
+
+	const std::string_view path = url.m_Path;
+	for (const auto& prefix : { "?key=", "&key=" })
+	{
+		if (auto begin = path.find(prefix); begin != path.npos)
+		{
+			begin += 5;
+			return path.substr(begin, path.find('&', begin) - begin);
+		}
+	}
+
+	return {};
+}
+
+HTTPRateLimit HTTPRateLimiter::GetRateLimit(const URL& url)
+{
+	if (url.m_Host.ends_with("akamaihd.net") ||
+		url.m_Host.ends_with("steamstatic.com"))
+	{
+		return { .m_Burst = 1, .m_RefillInterval = 0ms };
+	}
+	else if (url.m_Host == "api.steampowered.com" || url.m_Host == "tf2bd-util.pazer.us")
+	{
+		if (IsGetPlayerItems(url))
+			return { .m_Burst = 1, .m_RefillInterval = 1000ms }; // This is a slow/heavily throttled api
+
+		return { .m_Burst = 10, .m_RefillInterval = 100ms };
+	}
+	else if (url.m_Host == "steamcommunity.com")
+	{
+		return { .m_Burst = 1, .m_RefillInterval = 2000ms };
+	}
+	else if (url.m_Host == "logs.tf")
+	{
+		return { .m_Burst = 4, .m_RefillInterval = 500ms };
+	}
+	else if (url.m_Host == "api.github.com")
+	{
+		// Unauthenticated requests get 60/hour, we only need a couple at startup
+		return { .m_Burst = 3, .m_RefillInterval = 5000ms };
+	}
+
+	return { .m_Burst = 1, .m_RefillInterval = 500ms };
+}
+
+auto HTTPRateLimiter::Reserve(const URL& url) -> clock_t::time_point
+{
+	const auto now = clock_t::now();
+
+	const HTTPRateLimit limit = GetRateLimit(url);
+	if (limit.m_RefillInterval <= 0ms)
+		return now;
+
+	std::string key = url.m_Host;
+	if (IsGetPlayerItems(url))
+		key += "/GetPlayerItems/";
+	if (const auto apiKey = GetSteamAPIKey(url); !apiKey.empty())
+		key.append("?key=").append(apiKey);
+
+	std::lock_guard lock(m_Mutex);
+
+	auto& bucket = m_Buckets.try_emplace(std::move(key), Bucket{ double(limit.m_Burst), now }).first->second;
+
+	const std::chrono::duration<double> interval = limit.m_RefillInterval;
+	bucket.m_Tokens = std::min<double>(limit.m_Burst, bucket.m_Tokens + (now - bucket.m_LastRefill) / interval);
+	bucket.m_LastRefill = now;
+
+	bucket.m_Tokens -= 1;
+	if (bucket.m_Tokens >= 0)
+		return now;
+
+	// Wait for however many tokens the requests ahead of us (and this one) still need
+	return now + std::chrono::duration_cast<clock_t::duration>(interval * -bucket.m_Tokens);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <mh/concurrency/thread_pool.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace tf2_bot_detector
+{
+	class URL;
+
+	struct HTTPRateLimit
+	{
+		uint32_t m_Burst = 1;                          // Requests that can go out back to back after being idle
+		std::chrono::milliseconds m_RefillInterval{};  // Time to earn back one request, zero for no limit
+	};
+
+	// Token bucket per host (and per endpoint, for a few heavily throttled ones, and per Steam API
+	// key). Requests reserve a send time up front and wait for it on the dispatcher, so queued
+	// requests don't tie up threads.
+	class HTTPRateLimiter final
+	{
+	public:
+		using clock_t = mh::thread_pool::clock_t;
+
+		static HTTPRateLimit GetRateLimit(const URL& url);
+
+		// Takes a token, returning when the request is allowed to go out
+		clock_t::time_point Reserve(const URL& url);
+
+	private:
+		struct Bucket
+		{
+			double m_Tokens;              // Negative once requests are queued up waiting for tokens
+			clock_t::time_point m_LastRefill;
+		};
+
+		std::mutex m_Mutex;
+		std::map<std::string, Bucket, std::less<>> m_Buckets;
+	};
+}
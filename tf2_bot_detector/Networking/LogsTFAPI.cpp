@@ -1,19 +1,87 @@
 #include "LogsTFAPI.h"
 #include "HTTPClient.h"
 #include "HTTPHelpers.h"
+#include "Util/JSONSaxReader.h"
+#include "Log.h"
 
-#include <nlohmann/json.hpp>
+#include <exception>
+#include <optional>
+#include <stdexcept>
 
+using namespace std::string_view_literals;
 using namespace tf2_bot_detector;
 
-mh::task<LogsTFAPI::PlayerLogsInfo> LogsTFAPI::GetPlayerLogsInfoAsync(std::shared_ptr<const IHTTPClient> client, SteamID id)
+namespace
 {
-	const std::string string = co_await client->GetStringAsync(mh::format("https://logs.tf/api/v1/log?player={}&limit=0", id.ID64));
+	// Only the total is needed, everything else in the response is skipped over
+	class PlayerLogsReader final : public JSONSaxReader
+	{
+	public:
+		std::optional<uint32_t> m_Total;
 
-	const nlohmann::json json = nlohmann::json::parse(string);
+	protected:
+		bool OnScalar(const std::string_view& key, const scalar_type& value) override
+		{
+			if (key == "total"sv && IsPath({}))
+				return TryGetNumber(value, m_Total.emplace());
+
+			return true;
+		}
+	};
+}
+
+mh::task<LogsTFAPI::PlayerLogsInfo> LogsTFAPI::GetPlayerLogsInfoAsync(std::shared_ptr<const IHTTPClient> client, SteamID id,
+	CancellationToken cancel)
+{
+	const std::string string = co_await client->GetStringAsync(mh::format("https://logs.tf/api/v1/log?player={}&limit=0", id.ID64),
+		HTTPRequestTag::LogsTF, std::move(cancel));
+
+	PlayerLogsReader reader;
+	if (!reader.Parse(string) || !reader.m_Total)
+		throw std::runtime_error(mh::format("Failed to read logs.tf response for {}", id));
 
 	PlayerLogsInfo info{};
 	info.m_ID = id;
-	json.at("total").get_to(info.m_LogsCount);
+	info.m_LogsCount = *reader.m_Total;
 	co_return info;
 }
+
+mh::task<std::vector<LogsTFAPI::PlayerLogsInfo>> LogsTFAPI::GetPlayerLogsInfoAsync(
+	std::shared_ptr<const IHTTPClient> client, std::vector<SteamID> ids, std::vector<CancellationToken> cancel)
+{
+	std::vector<mh::task<PlayerLogsInfo>> requests;
+	requests.reserve(ids.size());
+	for (size_t i = 0; i < ids.size(); i++)
+		requests.push_back(GetPlayerLogsInfoAsync(client, ids[i], i < cancel.size() ? cancel[i] : CancellationToken{}));
+
+	std::vector<PlayerLogsInfo> retVal;
+	retVal.reserve(requests.size());
+	std::exception_ptr firstException;
+	size_t failedCount = 0;
+	size_t cancelledCount = 0;
+	for (auto& request : requests)
+	{
+		try
+		{
+			retVal.push_back(co_await request);
+		}
+		catch (const OperationCanceledError&)
+		{
+			cancelledCount++;
+		}
+		catch (...)
+		{
+			if (!firstException)
+				firstException = std::current_exception();
+
+			failedCount++;
+		}
+	}
+
+	if (failedCount == (requests.size() - cancelledCount) && firstException)
+		std::rethrow_exception(firstException);
+	else if (failedCount > 0)
+		LogWarning(MH_SOURCE_LOCATION_CURRENT(), "{} of {} logs.tf requests failed", failedCount, requests.size());
+
+	co_return retVal;
+}
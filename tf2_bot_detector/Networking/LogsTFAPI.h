@@ -1,10 +1,12 @@
 #pragma once
 
 #include "SteamID.h"
+#include "Util/CancellationToken.h"
 
 #include <mh/coroutine/task.hpp>
 
 #include <memory>
+#include <vector>
 
 namespace tf2_bot_detector
 {
@@ -19,5 +21,14 @@ namespace tf2_bot_detector::LogsTFAPI
 		uint32_t m_LogsCount;
 	};
 
-	mh::task<PlayerLogsInfo> GetPlayerLogsInfoAsync(std::shared_ptr<const IHTTPClient> client, SteamID id);
+	mh::task<PlayerLogsInfo> GetPlayerLogsInfoAsync(std::shared_ptr<const IHTTPClient> client, SteamID id,
+		CancellationToken cancel = {});
+
+	// logs.tf can't count logs for several players in one request (player=a,b only matches logs
+	// with all of them in it), so this is still one request per player. They're all handed to the
+	// client at once, which sends them as fast as its logs.tf rate limit allows. Players whose
+	// request failed are left out of the results, unless they all fail. If given, cancel[i] is for
+	// ids[i], and cancelled players are left out without counting as failures.
+	mh::task<std::vector<PlayerLogsInfo>> GetPlayerLogsInfoAsync(std::shared_ptr<const IHTTPClient> client,
+		std::vector<SteamID> ids, std::vector<CancellationToken> cancel = {});
 }
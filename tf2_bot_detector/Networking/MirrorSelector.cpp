@@ -0,0 +1,202 @@
+#include "MirrorSelector.h"
+#include "Util/JSONUtils.h"
+#include "Clock.h"
+#include "Filesystem.h"
+#include "Log.h"
+
+#include <mh/text/string_insertion.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+namespace
+{
+	struct MirrorStats
+	{
+		float m_LatencyMS = 0;          // Moving average of successful requests
+		uint32_t m_Successes = 0;
+		uint32_t m_ConsecutiveFailures = 0;
+		int64_t m_LastFailureTime = 0;  // Unix seconds
+	};
+
+	class MirrorStatsFile final
+	{
+	public:
+		MirrorStatsFile();
+
+		std::vector<std::string> Rank(std::vector<std::string> urls) const;
+		void RecordSuccess(const std::string& url, std::chrono::milliseconds latency);
+		void RecordFailure(const std::string& url);
+
+	private:
+		static constexpr float LATENCY_SMOOTHING = 0.3f;   // Weight of the newest sample
+		static constexpr float UNTRIED_LATENCY_MS = 1000;
+
+		// A failing mirror is skipped for this long, doubling with every failure in a row after that
+		static constexpr std::chrono::seconds FAILURE_BACKOFF = 10min;
+		static constexpr std::chrono::seconds MAX_FAILURE_BACKOFF = 24h;
+
+		bool IsHealthy(const MirrorStats& stats, int64_t now) const;
+		void Save() const;
+
+		std::filesystem::path m_FileName;
+		mutable std::mutex m_Mutex;
+		std::map<std::string, MirrorStats, std::less<>> m_Stats;
+	};
+
+	MirrorStatsFile& GetStatsFile()
+	{
+		static MirrorStatsFile s_StatsFile;
+		return s_StatsFile;
+	}
+
+	int64_t GetUnixSeconds()
+	{
+		return std::chrono::duration_cast<std::chrono::seconds>(tfbd_clock_t::now().time_since_epoch()).count();
+	}
+}
+
+MirrorStatsFile::MirrorStatsFile() :
+	m_FileName(IFilesystem::Get().GetLocalAppDataDir() / "mirror_stats.json")
+{
+	try
+	{
+		if (!std::filesystem::exists(m_FileName))
+			return;
+
+		const auto json = nlohmann::json::parse(IFilesystem::Get().ReadFile(m_FileName));
+		for (const auto& [url, entry] : json.items())
+		{
+			MirrorStats stats;
+			try_get_to_defaulted(entry, stats.m_LatencyMS, "latency_ms");
+			try_get_to_defaulted(entry, stats.m_Successes, "successes");
+			try_get_to_defaulted(entry, stats.m_ConsecutiveFailures, "consecutive_failures");
+			try_get_to_defaulted(entry, stats.m_LastFailureTime, "last_failure");
+			m_Stats.emplace(url, stats);
+		}
+	}
+	catch (...)
+	{
+		// Nothing lost but the order, every mirror looks untried again
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to load {}, starting without mirror stats", m_FileName);
+		m_Stats.clear();
+	}
+}
+
+bool MirrorStatsFile::IsHealthy(const MirrorStats& stats, int64_t now) const
+{
+	if (stats.m_ConsecutiveFailures == 0)
+		return true;
+
+	const std::chrono::seconds backoff = std::min<std::chrono::seconds>(
+		FAILURE_BACKOFF * (int64_t(1) << std::min<uint32_t>(stats.m_ConsecutiveFailures - 1, 16)), MAX_FAILURE_BACKOFF);
+	return (now - stats.m_LastFailureTime) >= backoff.count();
+}
+
+std::vector<std::string> MirrorStatsFile::Rank(std::vector<std::string> urls) const
+{
+	struct Ranked
+	{
+		bool m_Healthy;
+		uint32_t m_ConsecutiveFailures;
+		float m_LatencyMS;
+	};
+
+	const int64_t now = GetUnixSeconds();
+	std::map<std::string_view, Ranked> ranks;
+	{
+		std::lock_guard lock(m_Mutex);
+		for (const auto& url : urls)
+		{
+			if (auto found = m_Stats.find(url); found != m_Stats.end())
+			{
+				const MirrorStats& stats = found->second;
+				ranks.emplace(url, Ranked{ IsHealthy(stats, now), stats.m_ConsecutiveFailures,
+					stats.m_Successes ? stats.m_LatencyMS : UNTRIED_LATENCY_MS });
+			}
+			else
+			{
+				ranks.emplace(url, Ranked{ true, 0, UNTRIED_LATENCY_MS });
+			}
+		}
+	}
+
+	std::stable_sort(urls.begin(), urls.end(), [&](const std::string& a, const std::string& b)
+		{
+			const Ranked& rankA = ranks.at(a);
+			const Ranked& rankB = ranks.at(b);
+			if (rankA.m_Healthy != rankB.m_Healthy)
+				return rankA.m_Healthy;
+			if (!rankA.m_Healthy)
+				return rankA.m_ConsecutiveFailures < rankB.m_ConsecutiveFailures;
+
+			return rankA.m_LatencyMS < rankB.m_LatencyMS;
+		});
+
+	return urls;
+}
+
+void MirrorStatsFile::RecordSuccess(const std::string& url, std::chrono::milliseconds latency)
+{
+	std::lock_guard lock(m_Mutex);
+
+	MirrorStats& stats = m_Stats[url];
+	const auto latencyMS = float(latency.count());
+	stats.m_LatencyMS = stats.m_Successes ? (stats.m_LatencyMS + (latencyMS - stats.m_LatencyMS) * LATENCY_SMOOTHING) : latencyMS;
+	stats.m_Successes++;
+	stats.m_ConsecutiveFailures = 0;
+
+	Save();
+}
+
+void MirrorStatsFile::RecordFailure(const std::string& url)
+{
+	std::lock_guard lock(m_Mutex);
+
+	MirrorStats& stats = m_Stats[url];
+	stats.m_ConsecutiveFailures++;
+	stats.m_LastFailureTime = GetUnixSeconds();
+
+	Save();
+}
+
+void MirrorStatsFile::Save() const try
+{
+	nlohmann::json json = nlohmann::json::object();
+	for (const auto& [url, stats] : m_Stats)
+	{
+		json[url] =
+		{
+			{ "latency_ms", stats.m_LatencyMS },
+			{ "successes", stats.m_Successes },
+			{ "consecutive_failures", stats.m_ConsecutiveFailures },
+			{ "last_failure", stats.m_LastFailureTime },
+		};
+	}
+
+	IFilesystem::Get().WriteFile(m_FileName, json.dump(1, '\t') << '\n', PathUsage::WriteLocal);
+}
+catch (...)
+{
+	LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to save {}", m_FileName);
+}
+
+std::vector<std::string> MirrorSelector::Rank(std::vector<std::string> urls)
+{
+	return GetStatsFile().Rank(std::move(urls));
+}
+
+void MirrorSelector::RecordSuccess(const std::string& url, std::chrono::milliseconds latency)
+{
+	GetStatsFile().RecordSuccess(url, latency);
+}
+
+void MirrorSelector::RecordFailure(const std::string& url)
+{
+	GetStatsFile().RecordFailure(url);
+}
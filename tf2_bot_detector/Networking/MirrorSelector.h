@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	// Remembers how fast and how reliable each URL a config file can be auto-updated from has been,
+	// so the next startup goes to the best one first instead of always the first one listed. Saved
+	// to mirror_stats.json in the local app data folder. Thread-safe.
+	namespace MirrorSelector
+	{
+		// Best first: everything that hasn't failed recently by latency, then the ones that have, by
+		// how many times in a row. URLs without any history count as a middling success, so a slow
+		// mirror gets passed over for one nobody tried yet. Ties keep the order they were given in.
+		std::vector<std::string> Rank(std::vector<std::string> urls);
+
+		void RecordSuccess(const std::string& url, std::chrono::milliseconds latency);
+		void RecordFailure(const std::string& url);
+	}
+}
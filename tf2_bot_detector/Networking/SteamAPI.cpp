@@ -1,13 +1,15 @@
 #include "SteamAPI.h"
 #include "Config/Settings.h"
+#include "Util/JSONSaxReader.h"
 #include "Util/JSONUtils.h"
 #include "Util/PathUtils.h"
+#include "Util/TaskScheduler.h"
 #include "HTTPClient.h"
 #include "HTTPHelpers.h"
+#include "SteamAPIKeyPool.h"
 #include "Log.h"
 #include "Filesystem.h"
 
-#include <mh/concurrency/thread_pool.hpp>
 #include <mh/coroutine/future.hpp>
 #include <mh/text/fmtstr.hpp>
 #include <mh/text/format.hpp>
@@ -16,8 +18,13 @@
 #include <nlohmann/json.hpp>
 #include <stb_image.h>
 
+#include <exception>
 #include <fstream>
+#include <iterator>
+#include <optional>
 #include <regex>
+#include <stdexcept>
+#include <unordered_map>
 
 using namespace std::chrono_literals;
 using namespace std::string_literals;
@@ -33,6 +40,10 @@ namespace
 		std::string m_Response;
 	};
 
+	// Avatars are cached already decoded, as raw pixels behind a small header, so loading one is a
+	// single read rather than a JPEG decode. Full size avatars are exactly what the player tooltip
+	// draws (184x184), so they're stored as-is. Kept as the RGB the JPEG decodes to, the texture
+	// doesn't need an alpha channel either.
 	class AvatarCacheManager final
 	{
 	public:
@@ -40,51 +51,165 @@ namespace
 		{
 			m_CacheDir = IFilesystem::Get().GetTempDir() / "Steam Avatar Cache";
 			std::filesystem::create_directories(m_CacheDir);
+		}
+
+		void DeleteOldAvatars() const
+		{
 			DeleteOldFiles(m_CacheDir, 24h * 7);
 		}
 
 		mh::task<Bitmap> GetAvatarBitmap(const HTTPClient* client,
 			const std::string url, const std::string hash) const
 		{
-			const std::filesystem::path cachedPath = m_CacheDir / mh::fmtstr<128>("{}.jpg", hash).view();
-
-			// See if we're already stored in the cache
+			// Everyone asking for the same avatar at once shares one load. Different avatars
+			// don't wait on each other, the lock is only held to look in m_InFlight.
 			{
-				std::lock_guard lock(m_CacheMutex);
-				try
+				std::lock_guard lock(m_InFlightMutex);
+				if (auto found = m_InFlight.find(url); found != m_InFlight.end())
 				{
-					if (std::filesystem::exists(cachedPath))
-						co_return Bitmap(cachedPath);
-				}
-				catch (const std::exception& e)
-				{
-					LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to load cached avatar from {}, re-fetching...", cachedPath);
+					auto task = found->second;
+					if (task.is_ready())
+						m_InFlight.erase(found); // Finished just before it could be added
+
+					return task;
 				}
 			}
 
-			if (client)
+			auto task = LoadAvatarBitmap(client ? client->shared_from_this() : nullptr, url,
+				m_CacheDir / mh::fmtstr<128>("{}{}.rgba", hash, GetQualitySuffix(url)).view());
+
+			if (!task.is_ready())
 			{
-				auto clientPtr = client->shared_from_this();
+				std::lock_guard lock(m_InFlightMutex);
+				m_InFlight.try_emplace(url, task);
+			}
+
+			return task;
+		}
+
+	private:
+		struct CachedAvatarHeader
+		{
+			static constexpr uint32_t MAGIC = 0x41444254; // "TBDA"
+
+			uint32_t m_Magic;
+			uint32_t m_Width;
+			uint32_t m_Height;
+			uint32_t m_Channels;
+		};
 
-				// We're not stored in the cache, download now
-				std::string data = co_await clientPtr->GetStringAsync(url);
+		// The cache used to hold the original JPEGs, for every quality under the same name
+		static std::string_view GetQualitySuffix(const std::string_view& url)
+		{
+			if (url.ends_with("_full.jpg"))
+				return "_full";
+			if (url.ends_with("_medium.jpg"))
+				return "_medium";
 
-				std::lock_guard lock(m_CacheMutex);
+			return "";
+		}
+
+		static std::optional<Bitmap> TryReadCachedAvatar(const std::filesystem::path& path)
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (!file.good())
+				return std::nullopt;
+
+			CachedAvatarHeader header{};
+			if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+				header.m_Magic != CachedAvatarHeader::MAGIC ||
+				header.m_Width == 0 || header.m_Width > 4096 ||
+				header.m_Height == 0 || header.m_Height > 4096 ||
+				header.m_Channels == 0 || header.m_Channels > 4)
+			{
+				throw std::runtime_error(mh::format("Invalid cached avatar header in {}", path));
+			}
+
+			Bitmap bitmap(header.m_Width, header.m_Height, uint8_t(header.m_Channels));
+			if (!file.read(reinterpret_cast<char*>(bitmap.GetData()), bitmap.GetDataSize()))
+				throw std::runtime_error(mh::format("Truncated cached avatar {}", path));
+
+			return bitmap;
+		}
+
+		static void WriteCachedAvatar(const std::filesystem::path& path, const Bitmap& bitmap)
+		{
+			// Written under another name first, so a half written file is never picked up
+			auto tempPath = path;
+			tempPath += ".tmp";
+
+			{
+				std::ofstream file(tempPath, std::ios::trunc | std::ios::binary);
+				const CachedAvatarHeader header{ CachedAvatarHeader::MAGIC,
+					bitmap.GetWidth(), bitmap.GetHeight(), bitmap.GetChannelCount() };
+
+				file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				file.write(reinterpret_cast<const char*>(bitmap.GetData()), bitmap.GetDataSize());
+				if (!file.good())
+					throw std::runtime_error(mh::format("Failed to write cached avatar to {}", tempPath));
+			}
+
+			std::filesystem::rename(tempPath, path);
+		}
+
+		mh::task<Bitmap> LoadAvatarBitmap(std::shared_ptr<const HTTPClient> client, std::string url,
+			std::filesystem::path cachedPath) const
+		{
+			struct InFlightEraser
+			{
+				~InFlightEraser()
 				{
-					std::ofstream file(cachedPath, std::ios::trunc | std::ios::binary);
-					file << data;
+					std::lock_guard lock(m_Manager.m_InFlightMutex);
+					m_Manager.m_InFlight.erase(m_URL);
 				}
-				co_return Bitmap(cachedPath);
+
+				const AvatarCacheManager& m_Manager;
+				const std::string& m_URL;
+			} eraser{ *this, url };
+
+			// Nothing below belongs on the caller's (usually the UI) thread, not even the cache read
+			co_await TaskScheduler::Get().co_schedule(TaskLane::IO);
+
+			// See if we're already stored in the cache
+			try
+			{
+				if (auto cached = TryReadCachedAvatar(cachedPath))
+					co_return std::move(*cached);
+			}
+			catch (const std::exception& e)
+			{
+				LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to load cached avatar from {}, re-fetching...", cachedPath);
 			}
 
 			// No HTTPClient and we're not in the cache, so just give up
-			co_return Bitmap{};
+			if (!client)
+				co_return Bitmap{};
+
+			// We're not stored in the cache, download now and decode straight from the response
+			const std::string data = co_await client->GetStringAsync(url, HTTPRequestTag::Avatars);
+
+			// Back off the http client's thread before decoding
+			co_await TaskScheduler::Get().co_schedule(TaskLane::CPU);
+
+			Bitmap bitmap;
+			bitmap.LoadMemory(data.data(), data.size());
+
+			try
+			{
+				WriteCachedAvatar(cachedPath, bitmap);
+			}
+			catch (const std::exception& e)
+			{
+				LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to cache avatar");
+			}
+
+			co_return bitmap;
 		}
 
-	private:
 		std::filesystem::path m_CacheDir;
-		mutable std::mutex m_CacheMutex;
 
+		mutable std::mutex m_InFlightMutex;
+		mutable std::unordered_map<std::string, mh::task<Bitmap>> m_InFlight;
 	};
 
 	static AvatarCacheManager& GetAvatarCacheManager()
@@ -94,6 +219,11 @@ namespace
 	}
 }
 
+void tf2_bot_detector::SteamAPI::DeleteOldCachedAvatars()
+{
+	GetAvatarCacheManager().DeleteOldAvatars();
+}
+
 std::optional<duration_t> PlayerSummary::GetAccountAge() const
 {
 	if (m_CreationTime)
@@ -124,27 +254,82 @@ std::string PlayerSummary::GetAvatarURL(AvatarQuality quality) const
 	}
 
 	return mh::format("https://steamcdn-a.akamaihd.net/steamcommunity/public/images/avatars/{0:.2}/{0}{1}.jpg",
-		m_AvatarHash, qualityStr);
+		FormatAvatarHash(m_AvatarHash), qualityStr);
 }
 
 mh::task<Bitmap> PlayerSummary::GetAvatarBitmap(std::shared_ptr<const HTTPClient> client, AvatarQuality quality) const
 {
-	return GetAvatarCacheManager().GetAvatarBitmap(client.get(), GetAvatarURL(quality), m_AvatarHash);
+	return GetAvatarCacheManager().GetAvatarBitmap(client.get(), GetAvatarURL(quality), FormatAvatarHash(m_AvatarHash));
+}
+
+static constexpr std::string_view VANITY_URL_BASE = "https://steamcommunity.com/id/";
+
+std::string PlayerSummary::GetProfileURL() const
+{
+	if (!m_VanityURL.empty())
+		return mh::format("{}{}/", VANITY_URL_BASE, m_VanityURL);
+
+	return mh::format("https://steamcommunity.com/profiles/{}/", m_SteamID.ID64);
 }
 
-std::string_view PlayerSummary::GetVanityURL() const
+void PlayerSummary::SetProfileURL(const std::string_view& profileURL)
 {
-	constexpr std::string_view vanityBase = "https://steamcommunity.com/id/";
-	if (m_ProfileURL.starts_with(vanityBase))
+	m_VanityURL.clear();
+
+	// Anything else is the /profiles/<steamid64>/ form, which GetProfileURL() gives back anyway
+	if (profileURL.starts_with(VANITY_URL_BASE))
 	{
-		auto retVal = std::string_view(m_ProfileURL).substr(vanityBase.size());
-		if (retVal.ends_with('/'))
-			retVal = retVal.substr(0, retVal.size() - 1);
+		auto vanity = profileURL.substr(VANITY_URL_BASE.size());
+		if (vanity.ends_with('/'))
+			vanity.remove_suffix(1);
 
-		return retVal;
+		m_VanityURL = vanity;
 	}
+}
 
-	return "";
+static constexpr int HexDigitValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+
+	return -1;
+}
+
+std::optional<AvatarHash> tf2_bot_detector::SteamAPI::ParseAvatarHash(const std::string_view& hex)
+{
+	AvatarHash hash;
+	if (hex.size() != hash.size() * 2)
+		return std::nullopt;
+
+	for (size_t i = 0; i < hash.size(); i++)
+	{
+		const int hi = HexDigitValue(hex[i * 2]);
+		const int lo = HexDigitValue(hex[i * 2 + 1]);
+		if (hi < 0 || lo < 0)
+			return std::nullopt;
+
+		hash[i] = uint8_t((hi << 4) | lo);
+	}
+
+	return hash;
+}
+
+std::string tf2_bot_detector::SteamAPI::FormatAvatarHash(const AvatarHash& hash)
+{
+	constexpr char DIGITS[] = "0123456789abcdef";
+
+	std::string hex(hash.size() * 2, '\0');
+	for (size_t i = 0; i < hash.size(); i++)
+	{
+		hex[i * 2] = DIGITS[hash[i] >> 4];
+		hex[i * 2 + 1] = DIGITS[hash[i] & 0xF];
+	}
+
+	return hex;
 }
 
 void tf2_bot_detector::SteamAPI::from_json(const nlohmann::json& j, PlayerSummary& d)
@@ -153,11 +338,15 @@ void tf2_bot_detector::SteamAPI::from_json(const nlohmann::json& j, PlayerSummar
 
 	d.m_SteamID = j.at("steamid");
 	try_get_to_defaulted(j, d.m_RealName, "realname");
-	d.m_Nickname = j.at("personaname");
+	d.m_Nickname = InternedString(j.at("personaname").get<std::string_view>());
 	d.m_Status = j.at("personastate");
 	d.m_Visibility = j.at("communityvisibilitystate");
-	d.m_AvatarHash = j.at("avatarhash");
-	d.m_ProfileURL = j.at("profileurl");
+	if (auto hash = ParseAvatarHash(j.at("avatarhash").get<std::string_view>()))
+		d.m_AvatarHash = *hash;
+	else
+		throw std::invalid_argument("Invalid avatarhash for "s << d.m_SteamID);
+
+	d.SetProfileURL(j.at("profileurl").get<std::string_view>());
 
 	if (auto found = j.find("lastlogoff"); found != j.end())
 		d.m_LastLogOff = std::chrono::system_clock::time_point(std::chrono::seconds(found->get<uint64_t>()));
@@ -171,8 +360,171 @@ void tf2_bot_detector::SteamAPI::from_json(const nlohmann::json& j, PlayerSummar
 		d.m_CreationTime = std::chrono::system_clock::time_point(std::chrono::seconds(found->get<uint64_t>()));
 }
 
+namespace
+{
+	static bool TryGetSteamID(const JSONSaxReader::scalar_type& value, SteamID& out)
+	{
+		if (auto id64 = std::get_if<uint64_t>(&value))
+			out = SteamID(*id64);
+		else if (auto str = std::get_if<std::string_view>(&value))
+			out = SteamID(*str);
+		else
+			return false;
+
+		return true;
+	}
+
+	// The Steam API responses we care about can be big (100 players at a time, or every item in
+	// a backpack), so they're read straight into the result types instead of through a DOM.
+	class PlayerSummariesReader final : public JSONSaxReader
+	{
+	public:
+		std::vector<PlayerSummary> m_Summaries;
+
+	protected:
+		bool OnStartContainer(const std::string_view& key, bool isArray) override
+		{
+			if (!isArray && IsPlayer())
+			{
+				m_Summaries.emplace_back();
+				m_RequiredFields = 0;
+			}
+
+			return true;
+		}
+
+		bool OnEndContainer(const std::string_view& key, bool isArray) override
+		{
+			if (!isArray && IsPlayer())
+				return m_RequiredFields == ALL_REQUIRED_FIELDS;
+
+			return true;
+		}
+
+		bool OnScalar(const std::string_view& key, const scalar_type& value) override
+		{
+			if (!IsPlayer())
+				return true;
+
+			auto& d = m_Summaries.back();
+			if (key == "steamid"sv)
+				return Required(REQUIRED_STEAMID, TryGetSteamID(value, d.m_SteamID));
+			else if (key == "realname"sv)
+				TryGetString(value, d.m_RealName);
+			else if (key == "personaname"sv)
+				return Required(REQUIRED_PERSONANAME, TryGetInternedString(value, d.m_Nickname));
+			else if (key == "personastate"sv)
+				return Required(REQUIRED_PERSONASTATE, TryGetNumber(value, d.m_Status));
+			else if (key == "communityvisibilitystate"sv)
+				return Required(REQUIRED_VISIBILITY, TryGetNumber(value, d.m_Visibility));
+			else if (key == "avatarhash"sv)
+				return Required(REQUIRED_AVATARHASH, TryGetAvatarHash(value, d.m_AvatarHash));
+			else if (key == "profileurl"sv)
+				return Required(REQUIRED_PROFILEURL, TryGetProfileURL(value, d));
+			else if (key == "lastlogoff"sv)
+				return TryGetTime(value, d.m_LastLogOff);
+			else if (key == "profilestate"sv)
+				return TryGetNumber(value, d.m_ProfileConfigured);
+			else if (key == "commentpermission"sv)
+				return TryGetNumber(value, d.m_CommentPermissions);
+			else if (key == "timecreated"sv)
+				return TryGetTime(value, d.m_CreationTime);
+
+			return true;
+		}
+
+	private:
+		enum RequiredField : uint8_t
+		{
+			REQUIRED_STEAMID = 1 << 0,
+			REQUIRED_PERSONANAME = 1 << 1,
+			REQUIRED_PERSONASTATE = 1 << 2,
+			REQUIRED_VISIBILITY = 1 << 3,
+			REQUIRED_AVATARHASH = 1 << 4,
+			REQUIRED_PROFILEURL = 1 << 5,
+
+			ALL_REQUIRED_FIELDS = (1 << 6) - 1,
+		};
+
+		bool IsPlayer() const { return IsPath({ "response", "players", "" }); }
+
+		bool Required(RequiredField field, bool found)
+		{
+			if (found)
+				m_RequiredFields |= field;
+
+			return found;
+		}
+
+		static bool TryGetInternedString(const scalar_type& value, InternedString& out)
+		{
+			auto str = std::get_if<std::string_view>(&value);
+			if (!str)
+				return false;
+
+			out = InternedString(*str);
+			return true;
+		}
+
+		static bool TryGetAvatarHash(const scalar_type& value, AvatarHash& out)
+		{
+			auto str = std::get_if<std::string_view>(&value);
+			if (!str)
+				return false;
+
+			auto hash = ParseAvatarHash(*str);
+			if (!hash)
+				return false;
+
+			out = *hash;
+			return true;
+		}
+
+		static bool TryGetProfileURL(const scalar_type& value, PlayerSummary& out)
+		{
+			auto str = std::get_if<std::string_view>(&value);
+			if (!str)
+				return false;
+
+			out.SetProfileURL(*str);
+			return true;
+		}
+
+		static bool TryGetTime(const scalar_type& value, std::optional<time_point_t>& out)
+		{
+			uint64_t seconds;
+			if (!TryGetNumber(value, seconds))
+				return false;
+
+			out = time_point_t(std::chrono::seconds(seconds));
+			return true;
+		}
+
+		uint8_t m_RequiredFields = 0;
+	};
+}
+
+// Maps failures to the same error codes the DOM based parsing used
+static void ReadSteamAPIResponse(JSONSaxReader& reader, const std::string_view& data)
+{
+	bool success;
+	try
+	{
+		success = reader.Parse(data);
+	}
+	catch (...)
+	{
+		throw SteamAPIError(ErrorCode::JSONDeserializeError);
+	}
+
+	if (reader.HasParseError())
+		throw SteamAPIError(ErrorCode::JSONParseError);
+	if (!success)
+		throw SteamAPIError(ErrorCode::JSONDeserializeError);
+}
+
 static std::string GenerateSteamAPIURL(const ISteamAPISettings& apiSettings,
-	const std::string_view& endpoint, std::string query = "") try
+	const std::string_view& endpoint, std::string query, const std::string_view& apiKey) try
 {
 	assert(apiSettings.IsSteamAPIAvailable());
 	assert(query.empty() || query.starts_with("?"));
@@ -184,7 +536,7 @@ static std::string GenerateSteamAPIURL(const ISteamAPISettings& apiSettings,
 		if (!query.empty())
 			query[0] = '&';
 
-		return mh::format(MH_FMT_STRING("https://api.steampowered.com{}/?key={}{}"), endpoint, apiSettings.GetSteamAPIKey(), query);
+		return mh::format(MH_FMT_STRING("https://api.steampowered.com{}/?key={}{}"), endpoint, apiKey, query);
 	}
 	else if (apiSettings.GetSteamAPIMode() == SteamAPIMode::Proxy)
 	{
@@ -201,6 +553,47 @@ catch (...)
 	throw;
 }
 
+// Direct mode requests go out with whichever key the KeyPool picks, and go again with another one
+// if that key was rate limited or rejected. forbiddenIsKeyError is false for the endpoints that
+// answer private profiles with a 403.
+template<typename TFunc>
+static auto SendSteamAPIRequestAsync(const ISteamAPISettings& apiSettings, std::string_view endpoint,
+	std::string query, bool forbiddenIsKeyError, TFunc sendRequest) -> decltype(sendRequest(std::string()))
+{
+	if (apiSettings.GetSteamAPIMode() != SteamAPIMode::Direct)
+		co_return co_await sendRequest(GenerateSteamAPIURL(apiSettings, endpoint, std::move(query), {}));
+
+	const auto keys = apiSettings.GetSteamAPIKeys();
+	std::exception_ptr lastException;
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		auto lease = KeyPool::Get().Acquire(keys);
+		if (!lease)
+			break;
+
+		try
+		{
+			co_return co_await sendRequest(GenerateSteamAPIURL(apiSettings, endpoint, query, lease->GetKey()));
+		}
+		catch (const http_error& e)
+		{
+			if (e.code() == HTTPResponseCode::TooManyRequests)
+				lease->OnRateLimited();
+			else if (forbiddenIsKeyError && e.code() == HTTPResponseCode::Forbidden)
+				lease->OnRejected();
+			else
+				throw;
+
+			lastException = std::current_exception();
+		}
+	}
+
+	if (lastException)
+		std::rethrow_exception(lastException);
+
+	throw SteamAPIError(ErrorCode::APIKeysUnavailable);
+}
+
 static std::string GenerateSteamIDsQueryParam(const std::vector<SteamID>& steamIDs, size_t max, MH_SOURCE_LOCATION_AUTO(location))
 {
 	if (steamIDs.size() > max)
@@ -218,36 +611,92 @@ static std::string GenerateSteamIDsQueryParam(const std::vector<SteamID>& steamI
 	return steamIDsString;
 }
 
+// Most steamids the Steam web API accepts in a single request
+static constexpr size_t MAX_STEAMIDS_PER_REQUEST = 100;
+
+// Splits steamIDs into MAX_STEAMIDS_PER_REQUEST sized requests, all of them issued up front so the
+// HTTP client can have them in flight at the same time, and merges the results in order. A failed
+// request only loses its own part of the results, unless they all fail.
+template<typename T, typename TFunc>
+static mh::task<std::vector<T>> GetInBatchesAsync(const std::vector<SteamID>& steamIDs, TFunc requestBatch)
+{
+	std::vector<std::vector<SteamID>> batchIDs;
+	for (size_t i = 0; i < steamIDs.size(); i += MAX_STEAMIDS_PER_REQUEST)
+	{
+		batchIDs.emplace_back(steamIDs.begin() + i,
+			steamIDs.begin() + std::min(i + MAX_STEAMIDS_PER_REQUEST, steamIDs.size()));
+	}
+
+	std::vector<mh::task<std::vector<T>>> batches;
+	batches.reserve(batchIDs.size());
+	for (const auto& ids : batchIDs)
+		batches.push_back(requestBatch(ids));
+
+	std::vector<T> retVal;
+	std::exception_ptr firstException;
+	size_t failedCount = 0;
+	for (auto& batch : batches)
+	{
+		try
+		{
+			auto results = co_await batch;
+			retVal.insert(retVal.end(), std::make_move_iterator(results.begin()), std::make_move_iterator(results.end()));
+		}
+		catch (...)
+		{
+			if (!firstException)
+				firstException = std::current_exception();
+
+			failedCount++;
+		}
+	}
+
+	if (failedCount == batches.size() && firstException)
+		std::rethrow_exception(firstException);
+	else if (failedCount > 0)
+		LogWarning(MH_SOURCE_LOCATION_CURRENT(), "{} of {} Steam API requests failed", failedCount, batches.size());
+
+	co_return retVal;
+}
+
+static mh::task<std::vector<PlayerSummary>> GetPlayerSummariesBatchAsync(
+	const ISteamAPISettings& apiSettings, const std::vector<SteamID>& steamIDs, const HTTPClient& client)
+{
+	auto clientPtr = client.shared_from_this();
+	const std::string data = co_await SendSteamAPIRequestAsync(apiSettings, "/ISteamUser/GetPlayerSummaries/v0002",
+		GenerateSteamIDsQueryParam(steamIDs, MAX_STEAMIDS_PER_REQUEST), true,
+		[&](std::string url) { return clientPtr->GetStringAsync(std::move(url), HTTPRequestTag::PlayerSummaries); });
+
+	PlayerSummariesReader reader;
+	ReadSteamAPIResponse(reader, data);
+	co_return std::move(reader.m_Summaries);
+}
+
 mh::task<std::vector<PlayerSummary>> tf2_bot_detector::SteamAPI::GetPlayerSummariesAsync(
 	const ISteamAPISettings& apiSettings, const std::vector<SteamID>& steamIDs, const HTTPClient& client)
 {
 	if (steamIDs.empty())
-		co_return {};
-
-	std::string url = GenerateSteamAPIURL(apiSettings, "/ISteamUser/GetPlayerSummaries/v0002",
-		GenerateSteamIDsQueryParam(steamIDs, 100));
+		return mh::make_ready_task<std::vector<PlayerSummary>>();
+	if (steamIDs.size() <= MAX_STEAMIDS_PER_REQUEST)
+		return GetPlayerSummariesBatchAsync(apiSettings, steamIDs, client);
 
-	auto clientPtr = client.shared_from_this();
-	const std::string data = co_await clientPtr->GetStringAsync(url);
+	return GetInBatchesAsync<PlayerSummary>(steamIDs, [&](const std::vector<SteamID>& ids)
+		{
+			return GetPlayerSummariesBatchAsync(apiSettings, ids, client);
+		});
+}
 
-	nlohmann::json json;
-	try
-	{
-		json = nlohmann::json::parse(data);
-	}
-	catch (...)
-	{
-		throw SteamAPIError(ErrorCode::JSONParseError);
-	}
+static PlayerEconomyBan ParseEconomyBan(const std::string_view& economyBan)
+{
+	if (economyBan == "none"sv)
+		return PlayerEconomyBan::None;
+	else if (economyBan == "banned"sv)
+		return PlayerEconomyBan::Banned;
+	else if (economyBan == "probation"sv)
+		return PlayerEconomyBan::Probation;
 
-	try
-	{
-		co_return json.at("response").at("players").get<std::vector<PlayerSummary>>();
-	}
-	catch (...)
-	{
-		throw SteamAPIError(ErrorCode::JSONDeserializeError);
-	}
+	LogError(MH_SOURCE_LOCATION_CURRENT(), "Unknown EconomyBan value "s << std::quoted(economyBan));
+	return PlayerEconomyBan::Unknown;
 }
 
 void tf2_bot_detector::SteamAPI::from_json(const nlohmann::json& j, PlayerBans& d)
@@ -259,62 +708,134 @@ void tf2_bot_detector::SteamAPI::from_json(const nlohmann::json& j, PlayerBans&
 	d.m_GameBanCount = j.at("NumberOfGameBans");
 	d.m_TimeSinceLastBan = 24h * j.at("DaysSinceLastBan").get<uint32_t>();
 
-	const std::string_view economyBan = j.at("EconomyBan");
-	if (economyBan == "none"sv)
-		d.m_EconomyBan = PlayerEconomyBan::None;
-	else if (economyBan == "banned"sv)
-		d.m_EconomyBan = PlayerEconomyBan::Banned;
-	else if (economyBan == "probation"sv)
-		d.m_EconomyBan = PlayerEconomyBan::Probation;
-	else
-	{
-		LogError(MH_SOURCE_LOCATION_CURRENT(), "Unknown EconomyBan value "s << std::quoted(economyBan));
-		d.m_EconomyBan = PlayerEconomyBan::Unknown;
-	}
+	d.m_EconomyBan = ParseEconomyBan(j.at("EconomyBan").get<std::string_view>());
 }
 
-mh::task<std::vector<PlayerBans>> tf2_bot_detector::SteamAPI::GetPlayerBansAsync(
-	const ISteamAPISettings& apiSettings, const std::vector<SteamID>& steamIDs, const HTTPClient& client)
+namespace
 {
-	if (steamIDs.empty())
-		co_return std::vector<PlayerBans>();
+	class PlayerBansReader final : public JSONSaxReader
+	{
+	public:
+		std::vector<PlayerBans> m_Bans;
+
+	protected:
+		bool OnStartContainer(const std::string_view& key, bool isArray) override
+		{
+			if (!isArray && IsPlayer())
+			{
+				m_Bans.emplace_back();
+				m_RequiredFields = 0;
+			}
+
+			return true;
+		}
 
-	std::string url = GenerateSteamAPIURL(apiSettings, "/ISteamUser/GetPlayerBans/v0001",
-		GenerateSteamIDsQueryParam(steamIDs, 100));
+		bool OnEndContainer(const std::string_view& key, bool isArray) override
+		{
+			if (!isArray && IsPlayer())
+				return m_RequiredFields == ALL_REQUIRED_FIELDS;
+
+			return true;
+		}
+
+		bool OnScalar(const std::string_view& key, const scalar_type& value) override
+		{
+			if (!IsPlayer())
+				return true;
+
+			auto& d = m_Bans.back();
+			if (key == "SteamId"sv)
+				return Required(REQUIRED_STEAMID, TryGetSteamID(value, d.m_SteamID));
+			else if (key == "CommunityBanned"sv)
+				return Required(REQUIRED_COMMUNITYBANNED, TryGetBool(value, d.m_CommunityBanned));
+			else if (key == "NumberOfVACBans"sv)
+				return Required(REQUIRED_VACBANS, TryGetNumber(value, d.m_VACBanCount));
+			else if (key == "NumberOfGameBans"sv)
+				return Required(REQUIRED_GAMEBANS, TryGetNumber(value, d.m_GameBanCount));
+			else if (key == "DaysSinceLastBan"sv)
+			{
+				uint32_t days;
+				if (!Required(REQUIRED_DAYSSINCELASTBAN, TryGetNumber(value, days)))
+					return false;
+
+				d.m_TimeSinceLastBan = 24h * days;
+			}
+			else if (key == "EconomyBan"sv)
+			{
+				auto economyBan = std::get_if<std::string_view>(&value);
+				if (!Required(REQUIRED_ECONOMYBAN, economyBan != nullptr))
+					return false;
+
+				d.m_EconomyBan = ParseEconomyBan(*economyBan);
+			}
 
+			return true;
+		}
+
+	private:
+		enum RequiredField : uint8_t
+		{
+			REQUIRED_STEAMID = 1 << 0,
+			REQUIRED_COMMUNITYBANNED = 1 << 1,
+			REQUIRED_VACBANS = 1 << 2,
+			REQUIRED_GAMEBANS = 1 << 3,
+			REQUIRED_DAYSSINCELASTBAN = 1 << 4,
+			REQUIRED_ECONOMYBAN = 1 << 5,
+
+			ALL_REQUIRED_FIELDS = (1 << 6) - 1,
+		};
+
+		bool IsPlayer() const { return IsPath({ "players", "" }); }
+
+		bool Required(RequiredField field, bool found)
+		{
+			if (found)
+				m_RequiredFields |= field;
+
+			return found;
+		}
+
+		uint8_t m_RequiredFields = 0;
+	};
+}
+
+static mh::task<std::vector<PlayerBans>> GetPlayerBansBatchAsync(
+	const ISteamAPISettings& apiSettings, const std::vector<SteamID>& steamIDs, const HTTPClient& client)
+{
 	auto clientPtr = client.shared_from_this();
 	std::string response;
 	try
 	{
-		response = co_await clientPtr->GetStringAsync(url);
+		response = co_await SendSteamAPIRequestAsync(apiSettings, "/ISteamUser/GetPlayerBans/v0001",
+			GenerateSteamIDsQueryParam(steamIDs, MAX_STEAMIDS_PER_REQUEST), true,
+			[&](std::string url) { return clientPtr->GetStringAsync(std::move(url), HTTPRequestTag::PlayerBans); });
 	}
 	catch (const std::exception&)
 	{
 		throw SteamAPIError(ErrorCode::GenericHttpError);
 	}
 
-	nlohmann::json json;
-	try
-	{
-		json = nlohmann::json::parse(response);
-	}
-	catch (const std::exception&)
-	{
-		throw SteamAPIError(ErrorCode::JSONParseError);
-	}
+	PlayerBansReader reader;
+	ReadSteamAPIResponse(reader, response);
+	co_return std::move(reader.m_Bans);
+}
 
-	try
-	{
-		co_return json.at("players").get<std::vector<PlayerBans>>();
-	}
-	catch (...)
-	{
-		throw SteamAPIError(ErrorCode::JSONDeserializeError);
-	}
+mh::task<std::vector<PlayerBans>> tf2_bot_detector::SteamAPI::GetPlayerBansAsync(
+	const ISteamAPISettings& apiSettings, const std::vector<SteamID>& steamIDs, const HTTPClient& client)
+{
+	if (steamIDs.empty())
+		return mh::make_ready_task<std::vector<PlayerBans>>();
+	if (steamIDs.size() <= MAX_STEAMIDS_PER_REQUEST)
+		return GetPlayerBansBatchAsync(apiSettings, steamIDs, client);
+
+	return GetInBatchesAsync<PlayerBans>(steamIDs, [&](const std::vector<SteamID>& ids)
+		{
+			return GetPlayerBansBatchAsync(apiSettings, ids, client);
+		});
 }
 
 mh::task<duration_t> tf2_bot_detector::SteamAPI::GetTF2PlaytimeAsync(
-	const ISteamAPISettings& apiSettings, const SteamID& steamID, const HTTPClient& client)
+	const ISteamAPISettings& apiSettings, const SteamID& steamID, const HTTPClient& client, CancellationToken cancel)
 {
 	if (!steamID.IsValid())
 	{
@@ -322,15 +843,18 @@ mh::task<duration_t> tf2_bot_detector::SteamAPI::GetTF2PlaytimeAsync(
 			mh::format(MH_FMT_STRING("Invalid SteamID {}"), steamID));
 	}
 
-	std::string url = GenerateSteamAPIURL(apiSettings, "/IPlayerService/GetOwnedGames/v0001",
-		mh::format(MH_FMT_STRING("?input_json=%7B%22appids_filter%22%3A%5B440%5D,%22include_played_free_games%22%3Atrue,%22steamid%22%3A{}%7D"),
-			steamID.ID64));
-
 	auto clientPtr = client.shared_from_this();
 	std::string responseString;
 	try
 	{
-		responseString = co_await clientPtr->GetStringAsync(url);
+		responseString = co_await SendSteamAPIRequestAsync(apiSettings, "/IPlayerService/GetOwnedGames/v0001",
+			mh::format(MH_FMT_STRING("?input_json=%7B%22appids_filter%22%3A%5B440%5D,%22include_played_free_games%22%3Atrue,%22steamid%22%3A{}%7D"),
+				steamID.ID64), true,
+			[&](std::string url) { return clientPtr->GetStringAsync(std::move(url), HTTPRequestTag::Playtime, cancel); });
+	}
+	catch (const OperationCanceledError&)
+	{
+		throw;
 	}
 	catch (...)
 	{
@@ -406,6 +930,8 @@ namespace tf2_bot_detector::SteamAPI
 				return "The provided Steam Web API key was an empty string.";
 			case ErrorCode::SteamAPIDisabled:
 				return "Steam API support has been disabled via the tool settings.";
+			case ErrorCode::APIKeysUnavailable:
+				return "Every Steam Web API key is rate limited, rejected or out of quota for today.";
 			}
 
 			return mh::format("Unknown SteamAPI error ({})", condition);
@@ -424,8 +950,8 @@ std::error_condition tf2_bot_detector::SteamAPI::make_error_condition(tf2_bot_de
 	return std::error_condition(int(e), tf2_bot_detector::SteamAPI::ErrorCategory());
 }
 
-mh::task<std::unordered_set<SteamID>> tf2_bot_detector::SteamAPI::GetFriendList(const ISteamAPISettings& apiSettings,
-	const SteamID& steamID, const HTTPClient& client)
+mh::task<SteamAPI::FriendListUpdate> tf2_bot_detector::SteamAPI::GetFriendList(const ISteamAPISettings& apiSettings,
+	const SteamID& steamID, const HTTPClient& client, FriendListVersion previous)
 {
 	if (!steamID.IsValid())
 	{
@@ -433,20 +959,33 @@ mh::task<std::unordered_set<SteamID>> tf2_bot_detector::SteamAPI::GetFriendList(
 		co_return {};
 	}
 
-	auto url = GenerateSteamAPIURL(apiSettings, "/ISteamUser/GetFriendList/v0001", mh::format("?steamid={}", steamID.ID64));
-
+	// Private friends lists are a 401, not a 403
 	auto clientPtr = client.shared_from_this();
-	std::string data = co_await clientPtr->GetStringAsync(url);
+	auto response = co_await SendSteamAPIRequestAsync(apiSettings, "/ISteamUser/GetFriendList/v0001",
+		mh::format("?steamid={}", steamID.ID64), true,
+		[&](std::string url) { return clientPtr->GetStringConditionalAsync(std::move(url), HTTPRequestTag::FriendList, previous.m_Validators); });
 
-	const auto json = nlohmann::json::parse(data);
+	FriendListUpdate retVal;
+	if (response.m_NotModified)
+	{
+		retVal.m_Version = std::move(previous);
+		co_return retVal;
+	}
+
+	retVal.m_Version.m_Validators = std::move(response.m_Validators);
+	retVal.m_Version.m_BodyHash = std::hash<std::string_view>{}(response.m_Body);
+	if (previous.m_BodyHash != 0 && retVal.m_Version.m_BodyHash == previous.m_BodyHash)
+		co_return retVal;
 
-	std::unordered_set<SteamID> retVal;
+	const auto json = nlohmann::json::parse(response.m_Body);
 
 	auto& friendsList = json.at("friendslist");
 	auto& friends = friendsList.at("friends");
 
+	auto& retFriends = retVal.m_Friends.emplace();
+	retFriends.reserve(friends.size());
 	for (const auto& friendEntry : friends)
-		retVal.insert(SteamID(friendEntry.at("steamid").get<std::string_view>()));
+		retFriends.insert(SteamID(friendEntry.at("steamid").get<std::string_view>()));
 
 	co_return retVal;
 }
@@ -474,8 +1013,88 @@ bool SteamAPI::PlayerBans::HasAnyBans() const
 	return false;
 }
 
+namespace
+{
+	// Only counts the items, none of their (many) attributes are kept around. Traders can have
+	// megabytes of them, so this stops as soon as it has everything.
+	class InventoryReader final : public JSONSaxReader
+	{
+	public:
+		PlayerInventoryInfo m_Info{};
+		std::optional<int> m_Status;
+		bool m_HasItems = false;
+		bool m_HasSlots = false;
+
+	protected:
+		bool OnStartContainer(const std::string_view& key, bool isArray) override
+		{
+			// Everything in an item, skipped without comparing paths
+			if (m_ItemsDepth)
+			{
+				if (GetDepth() == m_ItemsDepth + 1)
+					m_Info.m_Items++;
+
+				return true;
+			}
+
+			if (!m_HasItems && isArray && IsPath({ "result", "items" }))
+			{
+				m_HasItems = true;
+				m_ItemsDepth = GetDepth();
+			}
+
+			return true;
+		}
+
+		bool OnEndContainer(const std::string_view& key, bool isArray) override
+		{
+			if (m_ItemsDepth && GetDepth() == m_ItemsDepth)
+			{
+				m_ItemsDepth = 0;
+				TryStop();
+			}
+
+			return true;
+		}
+
+		bool OnScalar(const std::string_view& key, const scalar_type& value) override
+		{
+			if (!IsPath({ "result" }))
+				return true;
+
+			if (key == "status"sv)
+			{
+				if (!TryGetNumber(value, m_Status.emplace()))
+					return false;
+			}
+			else if (key == "num_backpack_slots"sv)
+			{
+				m_HasSlots = TryGetNumber(value, m_Info.m_Slots);
+				if (!m_HasSlots)
+					return false;
+			}
+			else
+			{
+				return true;
+			}
+
+			TryStop();
+			return true;
+		}
+
+	private:
+		size_t m_ItemsDepth = 0; // While we're inside result.items
+
+		void TryStop()
+		{
+			if (m_Status && m_HasSlots && m_HasItems && !m_ItemsDepth)
+				StopParsing();
+		}
+	};
+}
+
 mh::task<PlayerInventoryInfo> SteamAPI::GetTF2InventoryInfoAsync(const ISteamAPISettings& apiSettings,
-	const SteamID& steamID, const IHTTPClient& client)
+	const SteamID& steamID, const IHTTPClient& client, CancellationToken cancel)
 {
 	if (!steamID.IsValid())
 	{
@@ -486,11 +1105,12 @@ mh::task<PlayerInventoryInfo> SteamAPI::GetTF2InventoryInfoAsync(const ISteamAPI
 	auto clientPtr = client.shared_from_this();
 	std::string data;
 
-	auto url = GenerateSteamAPIURL(apiSettings, "/IEconItems_440/GetPlayerItems/v0001", mh::format("?steamid={}", steamID.ID64));
-
 	try
 	{
-		data = co_await clientPtr->GetStringAsync(url);
+		// A 403 here is a private backpack, not a bad key
+		data = co_await SendSteamAPIRequestAsync(apiSettings, "/IEconItems_440/GetPlayerItems/v0001",
+			mh::format("?steamid={}", steamID.ID64), false,
+			[&](std::string url) { return clientPtr->GetStringAsync(std::move(url), HTTPRequestTag::Inventory, cancel); });
 	}
 	catch (const http_error& error)
 	{
@@ -500,37 +1120,15 @@ mh::task<PlayerInventoryInfo> SteamAPI::GetTF2InventoryInfoAsync(const ISteamAPI
 			throw; // rethrow generic http errors
 	}
 
-	nlohmann::json json;
-	try
-	{
-		json = nlohmann::json::parse(data);
-	}
-	catch (...)
-	{
-		throw SteamAPIError(ErrorCode::JSONParseError);
-	}
-
-	PlayerInventoryInfo info{};
+	InventoryReader reader;
+	ReadSteamAPIResponse(reader, data);
 
-	try
-	{
-		const nlohmann::json& result = json.at("result");
-
-		int status = result.at("status");
-		if (status == 15)
-			throw SteamAPIError(ErrorCode::InfoPrivate);
-
-		info.m_Items = static_cast<uint32_t>(result.at("items").size());
-		result.at("num_backpack_slots").get_to(info.m_Slots);
-	}
-	catch (const SteamAPIError&)
-	{
-		throw; // Don't touch these
-	}
-	catch (...)
-	{
+	if (!reader.m_Status)
+		throw SteamAPIError(ErrorCode::JSONDeserializeError);
+	if (*reader.m_Status == 15)
+		throw SteamAPIError(ErrorCode::InfoPrivate);
+	if (!reader.m_HasItems || !reader.m_HasSlots)
 		throw SteamAPIError(ErrorCode::JSONDeserializeError);
-	}
 
-	co_return info;
+	co_return reader.m_Info;
 }
@@ -2,12 +2,15 @@
 
 #include "Bitmap.h"
 #include "Clock.h"
+#include "HTTPClient.h"
 #include "SteamID.h"
+#include "Util/InternedString.h"
 
 #include <mh/coroutine/task.hpp>
 #include <mh/error/error_code_exception.hpp>
 #include <nlohmann/json_fwd.hpp>
 
+#include <array>
 #include <optional>
 #include <string>
 #include <unordered_set>
@@ -36,6 +39,7 @@ namespace tf2_bot_detector::SteamAPI
 		InvalidSteamID,
 		EmptyAPIKey,
 		SteamAPIDisabled,
+		APIKeysUnavailable,
 	};
 
 	struct SteamAPIError : mh::error_condition_exception, std::nested_exception
@@ -55,14 +59,14 @@ namespace std
 
 namespace tf2_bot_detector::SteamAPI
 {
-	enum class CommunityVisibilityState
+	enum class CommunityVisibilityState : uint8_t
 	{
 		Private = 1,
 		FriendsOnly = 2,
 		Public = 3,
 	};
 
-	enum class PersonaState
+	enum class PersonaState : uint8_t
 	{
 		Offline = 0,
 		Online = 1,
@@ -80,13 +84,20 @@ namespace tf2_bot_detector::SteamAPI
 		Large,
 	};
 
+	// The SHA-1 digest avatars are named after, which the API sends as 40 hex characters
+	using AvatarHash = std::array<uint8_t, 20>;
+	std::optional<AvatarHash> ParseAvatarHash(const std::string_view& hex);
+	std::string FormatAvatarHash(const AvatarHash& hash);
+
+	// One of these is kept for every player we've seen, so only what can't be rebuilt from
+	// something else is stored.
 	struct PlayerSummary
 	{
 		SteamID m_SteamID;
 		std::string m_RealName;
-		std::string m_Nickname;
-		std::string m_AvatarHash;
-		std::string m_ProfileURL;
+		InternedString m_Nickname; // Usually the same as their in-game name, which is interned already
+		std::string m_VanityURL; // Just the custom part of the profile URL, empty if there isn't one
+		AvatarHash m_AvatarHash{};
 		PersonaState m_Status{};
 		CommunityVisibilityState m_Visibility{};
 		bool m_ProfileConfigured = false;
@@ -100,10 +111,13 @@ namespace tf2_bot_detector::SteamAPI
 		mh::task<Bitmap> GetAvatarBitmap(std::shared_ptr<const IHTTPClient> client,
 			AvatarQuality quality = AvatarQuality::Large) const;
 
-		std::string_view GetVanityURL() const;
+		std::string_view GetVanityURL() const { return m_VanityURL; }
+		std::string GetProfileURL() const;
+		void SetProfileURL(const std::string_view& profileURL);
 	};
 	void from_json(const nlohmann::json& j, PlayerSummary& d);
 
+	// Any number of steamIDs, anything over 100 is split into concurrent requests
 	mh::task<std::vector<PlayerSummary>> GetPlayerSummariesAsync(const ISteamAPISettings& apiSettings,
 		const std::vector<SteamID>& steamIDs, const IHTTPClient& client);
 
@@ -129,19 +143,39 @@ namespace tf2_bot_detector::SteamAPI
 	};
 	void from_json(const nlohmann::json& j, PlayerBans& d);
 
+	// Any number of steamIDs, anything over 100 is split into concurrent requests
 	mh::task<std::vector<PlayerBans>> GetPlayerBansAsync(const ISteamAPISettings& apiSettings,
 		const std::vector<SteamID>& steamIDs, const IHTTPClient& client);
 
 	mh::task<duration_t> GetTF2PlaytimeAsync(const ISteamAPISettings& apiSettings,
-		const SteamID& steamID, const IHTTPClient& client);
+		const SteamID& steamID, const IHTTPClient& client, CancellationToken cancel = {});
+
+	// Which friends list response we already have, so an unchanged one isn't parsed again
+	struct FriendListVersion
+	{
+		HTTPCacheValidators m_Validators;
+		size_t m_BodyHash = 0;
+	};
 
-	mh::task<std::unordered_set<SteamID>> GetFriendList(const ISteamAPISettings& apiSettings,
-		const SteamID& steamID, const IHTTPClient& client);
+	struct FriendListUpdate
+	{
+		std::optional<std::unordered_set<SteamID>> m_Friends; // Empty if it's the same as previous
+		FriendListVersion m_Version;
+	};
+
+	// Sends the validators from previous. Steam doesn't always answer those with 304 Not Modified,
+	// so a body that hashes the same as previous is treated as unchanged too.
+	mh::task<FriendListUpdate> GetFriendList(const ISteamAPISettings& apiSettings,
+		const SteamID& steamID, const IHTTPClient& client, FriendListVersion previous = {});
 
 	struct PlayerInventoryInfo
 	{
 		uint32_t m_Items = 0;
 		uint32_t m_Slots = 0;
 	};
-	mh::task<PlayerInventoryInfo> GetTF2InventoryInfoAsync(const ISteamAPISettings& apiSettings, const SteamID& steamID, const IHTTPClient& client);
+	mh::task<PlayerInventoryInfo> GetTF2InventoryInfoAsync(const ISteamAPISettings& apiSettings, const SteamID& steamID,
+		const IHTTPClient& client, CancellationToken cancel = {});
+
+	// Clears out avatars that haven't been downloaded again in a week. Slow with a big cache.
+	void DeleteOldCachedAvatars();
 }
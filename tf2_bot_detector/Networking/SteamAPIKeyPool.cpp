@@ -0,0 +1,122 @@
+#include "SteamAPIKeyPool.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace tf2_bot_detector;
+using namespace tf2_bot_detector::SteamAPI;
+
+KeyPool& KeyPool::Get()
+{
+	static KeyPool s_Pool;
+	return s_Pool;
+}
+
+KeyPool::Lease::Lease(Lease&& other) noexcept :
+	m_Pool(std::exchange(other.m_Pool, nullptr)),
+	m_Key(std::move(other.m_Key))
+{
+}
+
+KeyPool::Lease::~Lease()
+{
+	if (m_Pool)
+		m_Pool->Release(m_Key);
+}
+
+void KeyPool::Lease::OnRateLimited()
+{
+	m_Pool->SetCooldown(m_Key, RATE_LIMITED_COOLDOWN, true);
+}
+
+void KeyPool::Lease::OnRejected()
+{
+	m_Pool->SetCooldown(m_Key, REJECTED_COOLDOWN, false);
+}
+
+int64_t KeyPool::GetCurrentDay()
+{
+	using days = std::chrono::duration<int64_t, std::ratio<86400>>;
+	return std::chrono::duration_cast<days>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+auto KeyPool::Acquire(const std::vector<std::string>& keys) -> std::optional<Lease>
+{
+	const auto now = tfbd_clock_t::now();
+	const auto today = GetCurrentDay();
+
+	std::lock_guard lock(m_Mutex);
+
+	KeyState* best = nullptr;
+	const std::string* bestKey = nullptr;
+	for (const std::string& key : keys)
+	{
+		auto& state = m_Keys.try_emplace(key).first->second;
+		if (state.m_Day != today)
+		{
+			state.m_Day = today;
+			state.m_RequestsToday = 0;
+		}
+
+		if (now < state.m_CooldownEnd || state.m_RequestsToday >= DAILY_QUOTA)
+			continue;
+
+		if (!best || state.m_InFlight < best->m_InFlight ||
+			(state.m_InFlight == best->m_InFlight && state.m_RequestsToday < best->m_RequestsToday))
+		{
+			best = &state;
+			bestKey = &key;
+		}
+	}
+
+	if (!best)
+		return std::nullopt;
+
+	best->m_InFlight++;
+	best->m_RequestsToday++;
+	return Lease(*this, *bestKey);
+}
+
+void KeyPool::Release(const std::string& key)
+{
+	std::lock_guard lock(m_Mutex);
+	if (auto found = m_Keys.find(key); found != m_Keys.end() && found->second.m_InFlight > 0)
+		found->second.m_InFlight--;
+}
+
+void KeyPool::SetCooldown(const std::string& key, duration_t cooldown, bool rateLimited)
+{
+	std::lock_guard lock(m_Mutex);
+	auto& state = m_Keys.try_emplace(key).first->second;
+	state.m_CooldownEnd = std::max(state.m_CooldownEnd, tfbd_clock_t::now() + cooldown);
+	if (rateLimited)
+		state.m_RateLimitedCount++;
+
+	LogWarning("Steam API key {}... {}, not using it for {}s", key.substr(0, 4),
+		rateLimited ? "was rate limited" : "was rejected", std::chrono::duration_cast<std::chrono::seconds>(cooldown).count());
+}
+
+auto KeyPool::GetStats() const -> std::vector<KeyStats>
+{
+	const auto now = tfbd_clock_t::now();
+	const auto today = GetCurrentDay();
+
+	std::lock_guard lock(m_Mutex);
+
+	std::vector<KeyStats> retVal;
+	retVal.reserve(m_Keys.size());
+	for (const auto& [key, state] : m_Keys)
+	{
+		retVal.push_back(KeyStats
+			{
+				.m_KeyPrefix = key.substr(0, 4),
+				.m_InFlight = state.m_InFlight,
+				.m_RequestsToday = state.m_Day == today ? state.m_RequestsToday : 0,
+				.m_RateLimitedCount = state.m_RateLimitedCount,
+				.m_CooldownRemaining = std::max<duration_t>(state.m_CooldownEnd - now, duration_t::zero()),
+			});
+	}
+
+	return retVal;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Clock.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tf2_bot_detector::SteamAPI
+{
+	// Spreads Direct mode requests over every configured Steam API key. Each key already gets its
+	// own token bucket in HTTPRateLimiter, this decides which one a request goes out with: the one
+	// with the fewest requests in flight, then the fewest sent today. Keys that got a 429 or were
+	// rejected sit out for a while, and keys that used up their daily quota sit out until tomorrow.
+	class KeyPool final
+	{
+	public:
+		static KeyPool& Get();
+
+		static constexpr uint32_t DAILY_QUOTA = 100'000; // https://steamcommunity.com/dev/apiterms
+		static constexpr duration_t RATE_LIMITED_COOLDOWN = std::chrono::minutes(1);
+		static constexpr duration_t REJECTED_COOLDOWN = std::chrono::minutes(30);
+
+		// Counts as in flight until destroyed
+		class Lease final
+		{
+		public:
+			Lease(Lease&& other) noexcept;
+			Lease& operator=(Lease&&) = delete;
+			~Lease();
+
+			const std::string& GetKey() const { return m_Key; }
+
+			void OnRateLimited();
+			void OnRejected(); // 401/403, revoked or otherwise not valid anymore
+
+		private:
+			friend class KeyPool;
+			Lease(KeyPool& pool, std::string key) : m_Pool(&pool), m_Key(std::move(key)) {}
+
+			KeyPool* m_Pool;
+			std::string m_Key;
+		};
+
+		// Empty if every one of keys is sitting out
+		std::optional<Lease> Acquire(const std::vector<std::string>& keys);
+
+		struct KeyStats
+		{
+			std::string m_KeyPrefix;      // Enough to tell them apart, without being a secret
+			uint32_t m_InFlight;
+			uint32_t m_RequestsToday;
+			uint32_t m_RateLimitedCount;
+			duration_t m_CooldownRemaining;
+		};
+		std::vector<KeyStats> GetStats() const;
+
+	private:
+		struct KeyState
+		{
+			uint32_t m_InFlight = 0;
+			uint32_t m_RequestsToday = 0;
+			int64_t m_Day = 0;             // Days since the epoch (UTC) that m_RequestsToday is for
+			uint32_t m_RateLimitedCount = 0;
+			time_point_t m_CooldownEnd{};
+		};
+
+		void Release(const std::string& key);
+		void SetCooldown(const std::string& key, duration_t cooldown, bool rateLimited);
+		static int64_t GetCurrentDay();
+
+		mutable std::mutex m_Mutex;
+		std::map<std::string, KeyState, std::less<>> m_Keys;
+	};
+}
@@ -7,14 +7,18 @@
 #include <mh/coroutine/task.hpp>
 #include <mh/reflection/enum.hpp>
 
+#include <chrono>
 #include <filesystem>
 #include <future>
+#include <memory>
 #include <string>
 #include <variant>
+#include <vector>
 
 namespace tf2_bot_detector
 {
 	class IHTTPClient;
+	class MappedFile;
 	struct BuildInfo;
 
 	inline namespace Platform
@@ -27,10 +31,26 @@ namespace tf2_bot_detector
 		std::filesystem::path GetRootRoamingAppDataDir();
 		std::filesystem::path GetLegacyAppDataDir();
 		std::filesystem::path GetRootTempDataDir();
+
+		// System fonts to pull glyphs from when ours don't have them, most preferred first.
+		// Only files that exist are returned.
+		std::vector<std::filesystem::path> GetFallbackFontPaths();
 		bool IsPortAvailable(uint16_t port);
 
 		bool IsDebuggerAttached();
 
+		enum class ThreadPriority
+		{
+			Normal,
+			BelowNormal,
+		};
+
+		// Only affect the calling thread. Failures are logged and otherwise ignored, we run fine either way.
+		// powerThrottled opts it into EcoQoS where the OS has it: efficiency cores and lower clocks.
+		void SetCurrentThreadPriority(ThreadPriority priority, bool powerThrottled = false);
+		// Bit n allows logical core n, 0 allows all of them. Cores the process itself can't use are ignored.
+		void SetCurrentThreadAffinity(uint64_t coreMask);
+
 		enum class OS
 		{
 			Windows,
@@ -69,12 +89,31 @@ namespace tf2_bot_detector
 
 		bool NeedsElevationToWrite(const std::filesystem::path& path, bool recursive = false);
 
+		// Goes up whenever a file or folder is created, deleted or renamed anywhere under directory,
+		// which is watched from the first call on. If it can't be watched, every call returns a new value.
+		uint64_t GetDirectoryChangeCount(const std::filesystem::path& directory);
+
+		// Throws std::filesystem::filesystem_error if the file can't be opened or mapped
+		MappedFile MapFileReadOnly(const std::filesystem::path& path);
+
+		// Zero filled, read/write memory that other processes can open by name for as long as the
+		// returned pointer (or a copy of it) is alive. Throws std::system_error if it can't be
+		// created, including when something else already created one with the same name.
+		std::shared_ptr<void> CreateSharedMemory(const std::string_view& name, size_t size);
+
 		namespace Processes
 		{
 			bool IsTF2Running();
 			mh::task<std::vector<std::string>> GetTF2CommandLineArgsAsync();
 			bool IsSteamRunning();
 			bool IsProcessRunning(const std::string_view& processName);
+
+			// Goes up whenever TF2, Steam or FACEIT starts or exits, so callers can skip re-checking
+			// while it stays the same. If we can't watch processes, every call returns a new value.
+			uint64_t GetProcessChangeCount();
+
+			// The game window is the one with keyboard focus
+			bool IsTF2Foreground();
 			void RequireTF2NotRunning();
 
 			void Launch(const std::filesystem::path& executable, const std::vector<std::string>& args = {},
@@ -83,7 +122,14 @@ namespace tf2_bot_detector
 					bool elevated = false);
 			int GetCurrentProcessID();
 
+			// How long ago the OS created this process, including the time it spent loading our DLLs
+			std::chrono::steady_clock::duration GetCurrentProcessUptime();
+
 			size_t GetCurrentRAMUsage();
+
+			// Gives the heap's free pages back to the OS and pages out the rest of the working set,
+			// which comes back in as it's touched again. For once we're idle.
+			void TrimMemory();
 		}
 
 		namespace Shell
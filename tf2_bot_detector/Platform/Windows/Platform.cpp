@@ -4,6 +4,7 @@
 
 #include <mh/memory/unique_object.hpp>
 #include <mh/text/fmtstr.hpp>
+#include <mh/text/formatters/error_code.hpp>
 
 #include <Windows.h>
 #include <winsock2.h>
@@ -78,6 +79,46 @@ bool tf2_bot_detector::Platform::IsDebuggerAttached()
 	return ::IsDebuggerPresent();
 }
 
+void tf2_bot_detector::Platform::SetCurrentThreadPriority(ThreadPriority priority, bool powerThrottled)
+{
+	const HANDLE thread = GetCurrentThread();
+
+	const int winPriority = priority == ThreadPriority::BelowNormal ? THREAD_PRIORITY_BELOW_NORMAL : THREAD_PRIORITY_NORMAL;
+	if (!SetThreadPriority(thread, winPriority))
+		LogError("Failed to set thread priority to {}: {}", winPriority, Windows::GetLastErrorCode());
+
+	// Windows 10 1709 and up. Explicitly turned off when not wanted, so the OS doesn't guess.
+	THREAD_POWER_THROTTLING_STATE throttling{};
+	throttling.Version = THREAD_POWER_THROTTLING_CURRENT_VERSION;
+	throttling.ControlMask = THREAD_POWER_THROTTLING_EXECUTION_SPEED;
+	throttling.StateMask = powerThrottled ? THREAD_POWER_THROTTLING_EXECUTION_SPEED : 0;
+	if (!SetThreadInformation(thread, ThreadPowerThrottling, &throttling, sizeof(throttling)))
+		DebugLog("Failed to set thread power throttling to {}: {}", powerThrottled, Windows::GetLastErrorCode());
+}
+
+void tf2_bot_detector::Platform::SetCurrentThreadAffinity(uint64_t coreMask)
+{
+	DWORD_PTR processMask = 0;
+	DWORD_PTR systemMask = 0;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+	{
+		LogError("Failed to get the process affinity mask: {}", Windows::GetLastErrorCode());
+		return;
+	}
+
+	DWORD_PTR threadMask = processMask & DWORD_PTR(coreMask);
+	if (!threadMask)
+	{
+		if (coreMask)
+			LogWarning("None of the cores in affinity mask {:#x} are available, using all of them", coreMask);
+
+		threadMask = processMask;
+	}
+
+	if (!SetThreadAffinityMask(GetCurrentThread(), threadMask))
+		LogError("Failed to set thread affinity mask to {:#x}: {}", threadMask, Windows::GetLastErrorCode());
+}
+
 bool tf2_bot_detector::Platform::IsPortAvailable(uint16_t port)
 {
 	EnsureWSAInit();
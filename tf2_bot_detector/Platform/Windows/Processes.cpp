@@ -1,4 +1,5 @@
 #include "../Platform.h"
+#include "Util/MemoryTracker.h"
 #include "Util/TextUtils.h"
 #include "Log.h"
 
@@ -11,13 +12,18 @@
 #include <mh/text/insertion_conversion.hpp>
 #include <mh/text/string_insertion.hpp>
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <chrono>
 #include <exception>
 #include <mutex>
+#include <shared_mutex>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
+#include <malloc.h>
 #include <Windows.h>
 #include <shellapi.h>
 #include "WindowsHelpers.h"
@@ -65,9 +71,57 @@ namespace
 
 	using SafeHandle = std::unique_ptr<std::remove_pointer_t<HANDLE>, HandleDeleter>;
 }
-bool tf2_bot_detector::Processes::IsTF2Running()
+
+namespace
 {
-	return !!FindWindowA("Valve001", nullptr);
+	constexpr std::string_view TF2_PROCESS_NAME = "hl2.exe";
+	constexpr std::string_view STEAM_PROCESS_NAME = "Steam.exe";
+	constexpr std::string_view WATCHED_PROCESS_NAMES[] = { TF2_PROCESS_NAME, STEAM_PROCESS_NAME, "faceitservice.exe" };
+
+	bool IsWatchedProcess(const std::string_view& processName)
+	{
+		for (const auto& name : WATCHED_PROCESS_NAMES)
+		{
+			if (mh::case_insensitive_compare(name, processName))
+				return true;
+		}
+
+		return false;
+	}
+
+	// https://docs.microsoft.com/en-us/windows/win32/wmisdk/example--getting-wmi-data-from-the-local-computer
+	ComPtr<IWbemServices> ConnectToWMI()
+	{
+		CHECK_HR(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+		ComPtr<IWbemLocator> pLoc;
+		CHECK_HR(CoCreateInstance(
+			CLSID_WbemLocator,
+			0,
+			CLSCTX_INPROC_SERVER,
+			IID_PPV_ARGS(pLoc.ReleaseAndGetAddressOf())));
+
+		ComPtr<IWbemServices> pSvc;
+		CHECK_HR(pLoc->ConnectServer(_bstr_t(L"ROOT\\CIMV2"),
+			NULL,
+			NULL,
+			0,
+			NULL,
+			0,
+			0,
+			pSvc.ReleaseAndGetAddressOf()));
+
+		CHECK_HR(CoSetProxyBlanket(pSvc.Get(),  // Indicates the proxy to set
+			RPC_C_AUTHN_WINNT,                  // RPC_C_AUTHN_xxx
+			RPC_C_AUTHZ_NONE,                   // RPC_C_AUTHZ_xxx
+			NULL,                               // Server principal name
+			RPC_C_AUTHN_LEVEL_CALL,             // RPC_C_AUTHN_LEVEL_xxx
+			RPC_C_IMP_LEVEL_IMPERSONATE,        // RPC_C_IMP_LEVEL_xxx
+			NULL,                               // client identity
+			EOAC_NONE));                        // proxy capabilities
+
+		return pSvc;
+	}
 }
 
 namespace
@@ -166,93 +220,327 @@ namespace
 
 		mh::promise<std::vector<std::string>> m_Promise;
 	};
-}
 
-// https://docs.microsoft.com/en-us/windows/win32/wmisdk/example--getting-wmi-data-from-the-local-computer
-mh::task<std::vector<std::string>> tf2_bot_detector::Processes::GetTF2CommandLineArgsAsync()
-{
-	try
+	// https://docs.microsoft.com/en-us/windows/win32/wmisdk/example--getting-wmi-data-from-the-local-computer
+	mh::task<std::vector<std::string>> QueryTF2CommandLineArgsAsync()
 	{
-		CHECK_HR(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+		try
+		{
+			auto pSvc = ConnectToWMI();
 
-		ComPtr<IWbemLocator> pLoc;
-		CHECK_HR(CoCreateInstance(
-			CLSID_WbemLocator,
-			0,
-			CLSCTX_INPROC_SERVER,
-			IID_PPV_ARGS(pLoc.ReleaseAndGetAddressOf())));
+			ComPtr<CommandLineArgsQuerySink> pResponseSink(new CommandLineArgsQuerySink());
 
-		ComPtr<IWbemServices> pSvc;
-		CHECK_HR(pLoc->ConnectServer(_bstr_t(L"ROOT\\CIMV2"),
-			NULL,
-			NULL,
-			0,
-			NULL,
-			0,
-			0,
-			pSvc.ReleaseAndGetAddressOf()));
+			const bstr_t query(
+				"SELECT Name,CommandLine,CreationDate FROM Win32_Process "
+				"WHERE Name = \"hl2.exe\" "
+				//"ORDER BY CreationDate DESC "
+				//"LIMIT 1"
+			);
 
-		CHECK_HR(CoSetProxyBlanket(pSvc.Get(),  // Indicates the proxy to set
-			RPC_C_AUTHN_WINNT,                  // RPC_C_AUTHN_xxx
-			RPC_C_AUTHZ_NONE,                   // RPC_C_AUTHZ_xxx
-			NULL,                               // Server principal name
-			RPC_C_AUTHN_LEVEL_CALL,             // RPC_C_AUTHN_LEVEL_xxx
-			RPC_C_IMP_LEVEL_IMPERSONATE,        // RPC_C_IMP_LEVEL_xxx
-			NULL,                               // client identity
-			EOAC_NONE));                        // proxy capabilities
+			CHECK_HR(pSvc->ExecQueryAsync(bstr_t("WQL"),
+				query,
+				WBEM_FLAG_BIDIRECTIONAL,
+				NULL,
+				pResponseSink.Get()));
 
-		ComPtr<CommandLineArgsQuerySink> pResponseSink(new CommandLineArgsQuerySink());
+			return pResponseSink->GetTask();
+		}
+		catch (const GetLastErrorException& e)
+		{
+			LogException(e);
+			throw;
+		}
+	}
 
-		const bstr_t query(
-			"SELECT Name,CommandLine,CreationDate FROM Win32_Process "
-			"WHERE Name = \"hl2.exe\" "
-			//"ORDER BY CreationDate DESC "
-			//"LIMIT 1"
-		);
+	bool SnapshotIsProcessRunning(const std::string_view& processName)
+	{
+		const SafeHandle snapshot(CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0));
 
-		CHECK_HR(pSvc->ExecQueryAsync(bstr_t("WQL"),
-			query,
-			WBEM_FLAG_BIDIRECTIONAL,
-			NULL,
-			pResponseSink.Get()));
+		PROCESSENTRY32 entry{};
+		entry.dwSize = sizeof(entry);
+
+		if (!Process32First(snapshot.get(), &entry))
+		{
+			auto error = GetLastErrorCode();
+			LogError("Failed to enumerate processes: {}", error);
+			return false;
+		}
+
+		do
+		{
+			if (mh::case_insensitive_compare(std::string_view(entry.szExeFile), processName))
+				return true;
+
+		} while (Process32Next(snapshot.get(), &entry));
 
-		return pResponseSink->GetTask();
+		return false;
 	}
-	catch (const GetLastErrorException& e)
+
+	struct WatchedProcess
+	{
+		DWORD m_ProcessID = 0;
+		std::string m_Name;
+		std::string m_CommandLine;
+	};
+
+	WatchedProcess ReadWatchedProcess(IWbemClassObject& process)
+	{
+		_variant_t processID, name, cmdLine;
+		CHECK_HR(process.Get(_bstr_t(L"ProcessId"), 0, &processID, nullptr, nullptr));
+		CHECK_HR(process.Get(_bstr_t(L"Name"), 0, &name, nullptr, nullptr));
+		CHECK_HR(process.Get(_bstr_t(L"CommandLine"), 0, &cmdLine, nullptr, nullptr));
+
+		WatchedProcess retVal;
+		retVal.m_ProcessID = static_cast<DWORD>(static_cast<long>(processID));
+		retVal.m_Name = ToMB(name.vt == VT_BSTR && name.bstrVal ? name.bstrVal : L"");
+		retVal.m_CommandLine = ToMB(cmdLine.vt == VT_BSTR && cmdLine.bstrVal ? cmdLine.bstrVal : L"");
+		return retVal;
+	}
+
+	// Keeps track of the few processes we care about (WATCHED_PROCESS_NAMES) from WMI process
+	// creation/deletion events, so asking about them doesn't mean enumerating every process or
+	// running a fresh WMI query each time.
+	class ProcessMonitor final
+	{
+	public:
+		// nullptr if WMI isn't available, callers fall back to asking the OS directly
+		static ProcessMonitor* Get()
+		{
+			static ProcessMonitor* s_Monitor = []() -> ProcessMonitor*
+			{
+				try
+				{
+					// Never destroyed, WMI can call into it right up until we exit
+					return new ProcessMonitor();
+				}
+				catch (const std::exception& e)
+				{
+					LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to start watching processes, falling back to polling");
+					return nullptr;
+				}
+			}();
+
+			return s_Monitor;
+		}
+
+		bool IsRunning(const std::string_view& processName) const
+		{
+			std::shared_lock lock(m_Mutex);
+			return std::any_of(m_Processes.begin(), m_Processes.end(),
+				[&](const auto& pair) { return mh::case_insensitive_compare(pair.second.m_Name, processName); });
+		}
+
+		std::vector<std::string> GetCommandLines(const std::string_view& processName) const
+		{
+			std::vector<std::string> retVal;
+
+			std::shared_lock lock(m_Mutex);
+			for (const auto& [processID, process] : m_Processes)
+			{
+				if (mh::case_insensitive_compare(process.m_Name, processName))
+					retVal.push_back(process.m_CommandLine);
+			}
+
+			return retVal;
+		}
+
+		uint64_t GetChangeCount() const { return m_ChangeCount.load(std::memory_order_acquire); }
+
+		void OnProcessStarted(WatchedProcess process)
+		{
+			DebugLog("Process started: {} ({})", process.m_Name, process.m_ProcessID);
+			{
+				std::unique_lock lock(m_Mutex);
+				m_Processes.insert_or_assign(process.m_ProcessID, std::move(process));
+			}
+			m_ChangeCount++;
+		}
+
+		void OnProcessExited(DWORD processID)
+		{
+			DebugLog("Process exited: {}", processID);
+			{
+				std::unique_lock lock(m_Mutex);
+				m_Processes.erase(processID);
+				if (!m_InitialScanDone)
+					m_ExitedDuringInitialScan.insert(processID);
+			}
+			m_ChangeCount++;
+		}
+
+	private:
+		class EventSink final : public BaseQuerySink
+		{
+		public:
+			explicit EventSink(ProcessMonitor& monitor) : m_Monitor(monitor) {}
+
+			HRESULT STDMETHODCALLTYPE Indicate(LONG lObjectCount,
+				IWbemClassObject __RPC_FAR* __RPC_FAR* apObjArray) override
+			{
+				for (LONG i = 0; i < lObjectCount; i++)
+				{
+					try
+					{
+						_variant_t eventClass, targetInstance;
+						CHECK_HR(apObjArray[i]->Get(_bstr_t(L"__CLASS"), 0, &eventClass, nullptr, nullptr));
+						CHECK_HR(apObjArray[i]->Get(_bstr_t(L"TargetInstance"), 0, &targetInstance, nullptr, nullptr));
+
+						ComPtr<IWbemClassObject> process;
+						if (targetInstance.vt != VT_UNKNOWN || !targetInstance.punkVal)
+							continue;
+
+						CHECK_HR(targetInstance.punkVal->QueryInterface(IID_PPV_ARGS(process.GetAddressOf())));
+
+						auto watched = ReadWatchedProcess(*process.Get());
+						if (eventClass.vt == VT_BSTR && std::wstring_view(eventClass.bstrVal) == L"__InstanceDeletionEvent")
+							m_Monitor.OnProcessExited(watched.m_ProcessID);
+						else
+							m_Monitor.OnProcessStarted(std::move(watched));
+					}
+					catch (const GetLastErrorException& e)
+					{
+						LogException(e);
+					}
+				}
+
+				return WBEM_S_NO_ERROR;
+			}
+
+		protected:
+			void OnComplete() override
+			{
+				LogWarning("Process watching subscription was cancelled");
+			}
+
+		private:
+			ProcessMonitor& m_Monitor;
+		};
+
+		ProcessMonitor()
+		{
+			m_Services = ConnectToWMI();
+
+			// Subscribe first, then look at what's already running, so nothing slips through in between.
+			// WITHIN 1 is how often WMI polls; the kernel trace events that wouldn't need it require admin.
+			m_EventSink = new EventSink(*this);
+			CHECK_HR(m_Services->ExecNotificationQueryAsync(bstr_t("WQL"),
+				bstr_t("SELECT * FROM __InstanceOperationEvent WITHIN 1 "
+					"WHERE (__CLASS = '__InstanceCreationEvent' OR __CLASS = '__InstanceDeletionEvent') "
+					"AND TargetInstance ISA 'Win32_Process' "
+					"AND (TargetInstance.Name = 'hl2.exe' OR TargetInstance.Name = 'Steam.exe' OR TargetInstance.Name = 'faceitservice.exe')"),
+				0,
+				NULL,
+				m_EventSink.Get()));
+
+			ComPtr<IEnumWbemClassObject> enumerator;
+			CHECK_HR(m_Services->ExecQuery(bstr_t("WQL"),
+				bstr_t("SELECT ProcessId,Name,CommandLine FROM Win32_Process "
+					"WHERE Name = 'hl2.exe' OR Name = 'Steam.exe' OR Name = 'faceitservice.exe'"),
+				WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
+				NULL,
+				enumerator.GetAddressOf()));
+
+			std::vector<WatchedProcess> running;
+			while (true)
+			{
+				ComPtr<IWbemClassObject> process;
+				ULONG returned = 0;
+				CHECK_HR(enumerator->Next(WBEM_INFINITE, 1, process.GetAddressOf(), &returned));
+				if (returned == 0)
+					break;
+
+				running.push_back(ReadWatchedProcess(*process.Get()));
+			}
+
+			{
+				std::unique_lock lock(m_Mutex);
+				for (auto& process : running)
+				{
+					if (!m_ExitedDuringInitialScan.contains(process.m_ProcessID))
+						m_Processes.try_emplace(process.m_ProcessID, std::move(process));
+				}
+
+				m_InitialScanDone = true;
+				m_ExitedDuringInitialScan.clear();
+			}
+
+			m_ChangeCount++;
+			DebugLog("Watching for process changes, {} relevant processes already running", running.size());
+		}
+
+		mutable std::shared_mutex m_Mutex;
+		std::unordered_map<DWORD, WatchedProcess> m_Processes;
+		bool m_InitialScanDone = false;
+		std::unordered_set<DWORD> m_ExitedDuringInitialScan;
+		std::atomic<uint64_t> m_ChangeCount = 0;
+
+		ComPtr<IWbemServices> m_Services;
+		ComPtr<EventSink> m_EventSink;
+	};
+}
+
+bool tf2_bot_detector::Processes::IsTF2Running()
+{
+	if (auto monitor = ProcessMonitor::Get())
+		return monitor->IsRunning(TF2_PROCESS_NAME);
+
+	return !!FindWindowA("Valve001", nullptr);
+}
+
+mh::task<std::vector<std::string>> tf2_bot_detector::Processes::GetTF2CommandLineArgsAsync()
+{
+	if (auto monitor = ProcessMonitor::Get())
 	{
-		LogException(e);
-		throw;
+		// Very new processes can briefly report an empty command line, ask WMI directly then
+		auto cmdLines = monitor->GetCommandLines(TF2_PROCESS_NAME);
+		if (std::none_of(cmdLines.begin(), cmdLines.end(), [](const std::string& cmdLine) { return cmdLine.empty(); }))
+			co_return cmdLines;
 	}
+
+	co_return co_await QueryTF2CommandLineArgsAsync();
 }
 
 bool tf2_bot_detector::Processes::IsSteamRunning()
 {
-	static mh::cached_variable m_CachedValue(std::chrono::seconds(1), []() { return IsProcessRunning("Steam.exe"); });
+	if (auto monitor = ProcessMonitor::Get())
+		return monitor->IsRunning(STEAM_PROCESS_NAME);
+
+	static mh::cached_variable m_CachedValue(std::chrono::seconds(1), []() { return SnapshotIsProcessRunning(STEAM_PROCESS_NAME); });
 	return m_CachedValue.get();
 }
 
 bool tf2_bot_detector::Processes::IsProcessRunning(const std::string_view& processName)
 {
-	const SafeHandle snapshot(CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0));
-
-	PROCESSENTRY32 entry{};
-	entry.dwSize = sizeof(entry);
-
-	if (!Process32First(snapshot.get(), &entry))
+	if (IsWatchedProcess(processName))
 	{
-		auto error = GetLastErrorCode();
-		LogError("Failed to enumerate processes: {}", error);
-		return false;
+		if (auto monitor = ProcessMonitor::Get())
+			return monitor->IsRunning(processName);
 	}
 
-	do
-	{
-		if (mh::case_insensitive_compare(std::string_view(entry.szExeFile), processName))
-			return true;
+	return SnapshotIsProcessRunning(processName);
+}
+
+uint64_t tf2_bot_detector::Processes::GetProcessChangeCount()
+{
+	if (auto monitor = ProcessMonitor::Get())
+		return monitor->GetChangeCount();
+
+	// Can't tell, so always look like something changed
+	static std::atomic<uint64_t> s_FallbackCount = 0;
+	return ++s_FallbackCount;
+}
+
+bool tf2_bot_detector::Processes::IsTF2Foreground()
+{
+	const HWND window = GetForegroundWindow();
+	if (!window)
+		return false;
 
-	} while (Process32Next(snapshot.get(), &entry));
+	char className[32];
+	if (!GetClassNameA(window, className, int(std::size(className))))
+		return false;
 
-	return false;
+	return std::string_view(className) == "Valve001";
 }
 
 void tf2_bot_detector::Processes::RequireTF2NotRunning()
@@ -291,7 +579,7 @@ void tf2_bot_detector::Processes::Launch(const std::filesystem::path& executable
 {
 	DebugLog("ShellExecute({}, {}) (elevated = {})", executable, args, elevated);
 
-	const auto cmdLineWide = mh::change_encoding<wchar_t>(args);
+	const auto cmdLineWide = ToWCSmall(args);
 
 	const auto result = ShellExecuteW(
 		NULL,
@@ -337,6 +625,22 @@ int tf2_bot_detector::Processes::GetCurrentProcessID()
 	return ::GetCurrentProcessId();
 }
 
+std::chrono::steady_clock::duration tf2_bot_detector::Processes::GetCurrentProcessUptime()
+{
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	mh_ensure(GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime));
+
+	FILETIME now;
+	GetSystemTimePreciseAsFileTime(&now);
+
+	const auto toTicks = [](const FILETIME& ft) { return (int64_t(ft.dwHighDateTime) << 32) | ft.dwLowDateTime; };
+
+	// FILETIMEs are in 100ns ticks
+	using filetime_duration_t = std::chrono::duration<int64_t, std::ratio<1, 10'000'000>>;
+	return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		filetime_duration_t(toTicks(now) - toTicks(creationTime)));
+}
+
 size_t tf2_bot_detector::Processes::GetCurrentRAMUsage()
 {
 	PROCESS_MEMORY_COUNTERS counters{};
@@ -344,3 +648,17 @@ size_t tf2_bot_detector::Processes::GetCurrentRAMUsage()
 	mh_ensure(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)));
 	return counters.WorkingSetSize;
 }
+
+void tf2_bot_detector::Processes::TrimMemory()
+{
+	MemoryTracker::CollectHeap();
+
+	if (_heapmin() != 0)
+		DebugLog("_heapmin() failed: {}", std::error_code(errno, std::generic_category()));
+
+	if (!HeapCompact(GetProcessHeap(), 0))
+		DebugLog("HeapCompact() failed: {}", GetLastErrorCode());
+
+	if (!SetProcessWorkingSetSize(GetCurrentProcess(), SIZE_T(-1), SIZE_T(-1)))
+		LogError("Failed to trim the working set: {}", GetLastErrorCode());
+}
@@ -4,6 +4,7 @@
 #include "Platform/Platform.h"
 #include "Platform/PlatformCommon.h"
 #include "Util/TextUtils.h"
+#include "Filesystem.h"
 #include "Log.h"
 #include "WindowsHelpers.h"
 #include "tf2_bot_detector_winrt.h"
@@ -15,6 +16,10 @@
 #include <mh/text/formatters/error_code.hpp>
 #include <mh/text/stringops.hpp>
 
+#include <map>
+#include <memory>
+#include <mutex>
+
 #define WIN32_LEAN_AND_MEAN 1
 #include <Windows.h>
 #include <Shlobj.h>
@@ -209,3 +214,148 @@ std::filesystem::path tf2_bot_detector::Platform::GetRootTempDataDir()
 
 	return std::filesystem::temp_directory_path();
 }
+
+std::vector<std::filesystem::path> tf2_bot_detector::Platform::GetFallbackFontPaths()
+{
+	static constexpr const char* FONT_FILES[] =
+	{
+		"segoeui.ttf",  // Latin extended, Cyrillic, Greek, Arabic, Hebrew
+		"msyh.ttc",     // Chinese
+		"meiryo.ttc",   // Japanese
+		"malgun.ttf",   // Korean
+		"seguisym.ttf", // Symbols and (monochrome) emoji
+	};
+
+	std::vector<std::filesystem::path> retVal;
+
+	try
+	{
+		const auto fontsDir = GetKnownFolderPath(FOLDERID_Fonts);
+		for (const char* file : FONT_FILES)
+		{
+			auto path = fontsDir / file;
+			if (std::error_code ec; std::filesystem::exists(path, ec))
+				retVal.push_back(std::move(path));
+		}
+	}
+	catch (...)
+	{
+		LogException();
+	}
+
+	return retVal;
+}
+
+uint64_t tf2_bot_detector::Platform::GetDirectoryChangeCount(const std::filesystem::path& directory)
+{
+	struct WatchedDirectory
+	{
+		HANDLE m_Handle = INVALID_HANDLE_VALUE;
+		uint64_t m_ChangeCount = 0;
+	};
+
+	// Handles are left open until we exit
+	static std::mutex s_Mutex;
+	static std::map<std::filesystem::path, WatchedDirectory> s_Directories;
+
+	std::lock_guard lock(s_Mutex);
+
+	auto [it, inserted] = s_Directories.try_emplace(directory);
+	auto& watched = it->second;
+	if (inserted)
+	{
+		watched.m_Handle = FindFirstChangeNotificationW(directory.c_str(), TRUE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME);
+
+		if (watched.m_Handle == INVALID_HANDLE_VALUE)
+			LogWarning(MH_SOURCE_LOCATION_CURRENT(), "Unable to watch {} for changes: {}", directory, Windows::GetLastErrorCode());
+	}
+
+	if (watched.m_Handle == INVALID_HANDLE_VALUE)
+		return ++watched.m_ChangeCount;
+
+	// Just checking whether the handle is signaled, this doesn't touch the disk
+	if (WaitForSingleObject(watched.m_Handle, 0) == WAIT_OBJECT_0)
+	{
+		++watched.m_ChangeCount;
+
+		if (!FindNextChangeNotification(watched.m_Handle))
+		{
+			LogWarning(MH_SOURCE_LOCATION_CURRENT(), "Stopped watching {} for changes: {}", directory, Windows::GetLastErrorCode());
+			FindCloseChangeNotification(watched.m_Handle);
+			watched.m_Handle = INVALID_HANDLE_VALUE;
+		}
+	}
+
+	return watched.m_ChangeCount;
+}
+
+MappedFile tf2_bot_detector::Platform::MapFileReadOnly(const std::filesystem::path& path)
+{
+	const auto ThrowLastError = [&](const char* what)
+	{
+		throw std::filesystem::filesystem_error(what, path, Windows::GetLastErrorCode());
+	};
+
+	using handle_t = std::unique_ptr<void, decltype(&CloseHandle)>;
+
+	const HANDLE fileRaw = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileRaw == INVALID_HANDLE_VALUE)
+		ThrowLastError("CreateFileW failed");
+
+	const handle_t file(fileRaw, &CloseHandle);
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file.get(), &size))
+		ThrowLastError("GetFileSizeEx failed");
+
+	// CreateFileMappingW refuses to map empty files
+	if (size.QuadPart == 0)
+		return {};
+
+	if (uint64_t(size.QuadPart) > SIZE_MAX)
+		throw std::filesystem::filesystem_error("File is too large to map", path, make_error_code(std::errc::file_too_large));
+
+	// The view keeps both of these alive on its own
+	const handle_t mapping(CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr), &CloseHandle);
+	if (!mapping)
+		ThrowLastError("CreateFileMappingW failed");
+
+	const void* view = MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+		ThrowLastError("MapViewOfFile failed");
+
+	return MappedFile(
+		std::shared_ptr<const void>(view, [](const void* v) { UnmapViewOfFile(v); }),
+		std::string_view(static_cast<const char*>(view), size_t(size.QuadPart)));
+}
+
+std::shared_ptr<void> tf2_bot_detector::Platform::CreateSharedMemory(const std::string_view& name, size_t size)
+{
+	const auto ThrowLastError = [&](const char* what)
+	{
+		throw std::system_error(Windows::GetLastErrorCode(), mh::format("{} for {}", what, name));
+	};
+
+	// Local\ so it's visible to everything running in the same session, without needing SeCreateGlobalPrivilege
+	SmallString<wchar_t> mappingName;
+	mappingName.append(L"Local\\");
+	AppendWC(mappingName, name);
+
+	const HANDLE mappingRaw = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+		DWORD(uint64_t(size) >> 32), DWORD(size & 0xFFFFFFFF), mappingName.c_str());
+	if (!mappingRaw)
+		ThrowLastError("CreateFileMappingW failed");
+
+	auto mapping = std::shared_ptr<void>(mappingRaw, &CloseHandle);
+	if (GetLastError() == ERROR_ALREADY_EXISTS)
+		throw std::system_error(std::make_error_code(std::errc::file_exists), mh::format("{} already exists", name));
+
+	void* view = MapViewOfFile(mappingRaw, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!view)
+		ThrowLastError("MapViewOfFile failed");
+
+	// Hang on to the handle too, so the name stays around for readers to open
+	return std::shared_ptr<void>(view, [mapping](void* v) { UnmapViewOfFile(v); });
+}
@@ -3,6 +3,7 @@
 #include "Clock.h"
 #include "SteamID.h"
 #include "TFConstants.h"
+#include "Util/InternedString.h"
 
 #include <cstdint>
 #include <string>
@@ -21,7 +22,7 @@ namespace tf2_bot_detector
 
 	struct PlayerStatus
 	{
-		std::string m_Name;
+		InternedString m_Name;
 		std::string m_Address;
 		SteamID m_SteamID;
 
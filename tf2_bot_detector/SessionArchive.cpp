@@ -0,0 +1,182 @@
+#include "SessionArchive.h"
+#include "Log.h"
+
+#include <mh/text/format.hpp>
+
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+namespace
+{
+	constexpr duration_t FLUSH_INTERVAL = 1s;
+
+	int64_t ToMicroseconds(time_point_t time)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+	}
+
+	template<typename T>
+	void Write(std::ofstream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	template<typename T>
+	bool Read(std::ifstream& file, T& value)
+	{
+		return !!file.read(reinterpret_cast<char*>(&value), sizeof(value));
+	}
+
+	class SessionRecorder final
+	{
+	public:
+		static SessionRecorder& Get()
+		{
+			static SessionRecorder s_Recorder;
+			return s_Recorder;
+		}
+
+		bool Start(std::filesystem::path path);
+		void Stop();
+		void Record(SessionArchiveRecordType type, const std::string_view& key, const std::string_view& data);
+
+	private:
+		std::mutex m_Mutex;
+		std::optional<SessionArchiveWriter> m_File;
+		std::chrono::steady_clock::time_point m_StartTime{};
+		std::chrono::steady_clock::time_point m_LastFlushTime{};
+	};
+
+	bool SessionRecorder::Start(std::filesystem::path path)
+	{
+		std::lock_guard lock(m_Mutex);
+		if (m_File)
+		{
+			LogError("Already recording to {}, not starting another recording to {}", m_File->GetPath(), path);
+			return false;
+		}
+
+		if (path.has_parent_path())
+		{
+			std::error_code ec;
+			std::filesystem::create_directories(path.parent_path(), ec);
+		}
+
+		m_File.emplace(std::move(path), tfbd_clock_t::now());
+		if (!m_File->IsOpen())
+		{
+			LogError("Failed to open {} for recording", m_File->GetPath());
+			m_File.reset();
+			return false;
+		}
+
+		m_StartTime = m_LastFlushTime = std::chrono::steady_clock::now();
+		Log("Recording session to {}", m_File->GetPath());
+		detail::SessionArchive_h::s_Recording = true;
+		return true;
+	}
+
+	void SessionRecorder::Stop()
+	{
+		std::lock_guard lock(m_Mutex);
+		detail::SessionArchive_h::s_Recording = false;
+		if (m_File)
+		{
+			Log("Finished recording session to {}", m_File->GetPath());
+			m_File.reset();
+		}
+	}
+
+	void SessionRecorder::Record(SessionArchiveRecordType type, const std::string_view& key, const std::string_view& data)
+	{
+		const auto now = std::chrono::steady_clock::now();
+
+		std::lock_guard lock(m_Mutex);
+		if (!m_File)
+			return;
+
+		m_File->Write(type, std::chrono::duration_cast<std::chrono::microseconds>(now - m_StartTime), key, data);
+
+		// Whatever made us want a recording might also crash us
+		if ((now - m_LastFlushTime) >= FLUSH_INTERVAL)
+		{
+			m_File->Flush();
+			m_LastFlushTime = now;
+		}
+	}
+}
+
+SessionArchiveWriter::SessionArchiveWriter(std::filesystem::path path, time_point_t startTime) :
+	m_Path(std::move(path)),
+	m_File(m_Path, std::ios::binary | std::ios::trunc)
+{
+	m_File.write(MAGIC, sizeof(MAGIC));
+	::Write(m_File, ToMicroseconds(startTime));
+}
+
+void SessionArchiveWriter::Write(SessionArchiveRecordType type, std::chrono::microseconds offset,
+	const std::string_view& key, const std::string_view& data)
+{
+	::Write(m_File, type);
+	::Write(m_File, int64_t(offset.count()));
+	::Write(m_File, uint32_t(key.size()));
+	::Write(m_File, uint32_t(data.size()));
+	m_File.write(key.data(), key.size());
+	m_File.write(data.data(), data.size());
+}
+
+SessionArchiveReader::SessionArchiveReader(const std::filesystem::path& path) :
+	m_File(path, std::ios::binary)
+{
+	if (!m_File.good())
+		throw std::runtime_error(mh::format("Failed to open {}", path));
+
+	char magic[sizeof(SessionArchiveWriter::MAGIC)];
+	int64_t startTime;
+	if (!m_File.read(magic, sizeof(magic)) || std::memcmp(magic, SessionArchiveWriter::MAGIC, sizeof(magic)) ||
+		!Read(m_File, startTime))
+	{
+		throw std::runtime_error(mh::format("{} is not a session archive", path));
+	}
+
+	m_StartTime = time_point_t(std::chrono::duration_cast<duration_t>(std::chrono::microseconds(startTime)));
+}
+
+bool SessionArchiveReader::ReadNext(SessionArchiveRecord& record)
+{
+	int64_t offset;
+	uint32_t keySize, dataSize;
+	if (!Read(m_File, record.m_Type) || !Read(m_File, offset) || !Read(m_File, keySize) || !Read(m_File, dataSize))
+		return false;
+
+	if (record.m_Type >= SessionArchiveRecordType::COUNT)
+	{
+		LogError("Unknown session archive record type {}, stopping here", +uint8_t(record.m_Type));
+		return false;
+	}
+
+	record.m_Offset = std::chrono::microseconds(offset);
+	record.m_Key.resize(keySize);
+	record.m_Data.resize(dataSize);
+	return m_File.read(record.m_Key.data(), keySize) && m_File.read(record.m_Data.data(), dataSize);
+}
+
+void detail::SessionArchive_h::Record(SessionArchiveRecordType type, const std::string_view& key, const std::string_view& data)
+{
+	SessionRecorder::Get().Record(type, key, data);
+}
+
+bool ISessionArchive::StartRecording(std::filesystem::path path)
+{
+	return SessionRecorder::Get().Start(std::move(path));
+}
+
+void ISessionArchive::StopRecording()
+{
+	SessionRecorder::Get().Stop();
+}
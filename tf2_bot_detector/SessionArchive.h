@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Clock.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	// Everything that comes into the tool from outside during a session (--record), so it can be
+	// played back through the same code later (--replay) without a game running.
+	//
+	// File layout: 8 byte magic, int64 recording start time (us since 1970), then records of
+	//   uint8 SessionArchiveRecordType, int64 offset (us since the start), uint32 key size, uint32 data size
+	// followed by the key and the data.
+	enum class SessionArchiveRecordType : uint8_t
+	{
+		ConsoleOutput, // key: console.log path, data: bytes as they were read
+		RCONResponse,  // key: command, data: response
+		HTTPResponse,  // key: url, data: body
+		ChatWrappers,  // key: empty, data: the json of the wrappers the parser started using
+
+		COUNT,
+	};
+
+	struct SessionArchiveRecord
+	{
+		SessionArchiveRecordType m_Type{};
+		std::chrono::microseconds m_Offset{};
+		std::string m_Key;
+		std::string m_Data;
+	};
+
+	class SessionArchiveWriter final
+	{
+	public:
+		static constexpr char MAGIC[8] = { 'T', 'F', 'B', 'D', 'R', 'E', 'C', '1' };
+
+		SessionArchiveWriter(std::filesystem::path path, time_point_t startTime);
+
+		bool IsOpen() const { return m_File.good(); }
+		const std::filesystem::path& GetPath() const { return m_Path; }
+
+		void Write(SessionArchiveRecordType type, std::chrono::microseconds offset,
+			const std::string_view& key, const std::string_view& data);
+		void Flush() { m_File.flush(); }
+
+	private:
+		std::filesystem::path m_Path;
+		std::ofstream m_File;
+	};
+
+	class SessionArchiveReader final
+	{
+	public:
+		// Throws if the file can't be opened or isn't an archive
+		explicit SessionArchiveReader(const std::filesystem::path& path);
+
+		time_point_t GetStartTime() const { return m_StartTime; }
+
+		// False at the end of the file, or at a record that was only partly written
+		bool ReadNext(SessionArchiveRecord& record);
+
+	private:
+		std::ifstream m_File;
+		time_point_t m_StartTime{};
+	};
+
+	namespace detail::SessionArchive_h
+	{
+		inline std::atomic_bool s_Recording = false;
+
+		void Record(SessionArchiveRecordType type, const std::string_view& key, const std::string_view& data);
+	}
+
+	class ISessionArchive final
+	{
+	public:
+		// Records everything from now on to path. Only one recording per process.
+		static bool StartRecording(std::filesystem::path path);
+		static void StopRecording();
+		static bool IsRecording() { return detail::SessionArchive_h::s_Recording.load(std::memory_order_relaxed); }
+
+		// Safe to call from any thread, does nothing unless we're recording
+		static void Record(SessionArchiveRecordType type, const std::string_view& key, const std::string_view& data)
+		{
+			if (IsRecording())
+				detail::SessionArchive_h::Record(type, key, data);
+		}
+	};
+}
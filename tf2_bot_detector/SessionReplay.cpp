@@ -0,0 +1,292 @@
+#include "SessionReplay.h"
+#include "Actions/ActionGenerators.h"
+#include "Networking/HTTPClient.h"
+#include "Networking/HTTPHelpers.h"
+#include "SetupFlow/ChatWrappersGeneratorPage.h"
+#include "Util/TaskScheduler.h"
+#include "GlobalDispatcher.h"
+#include "Log.h"
+
+#include <mh/concurrency/dispatcher.hpp>
+#include <mh/text/format.hpp>
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+namespace tf2_bot_detector
+{
+	// Responses by key. Each one is handed out once, in the order they were recorded, except the
+	// last, which keeps being handed out after that.
+	class ReplayResponses
+	{
+	public:
+		void Add(std::string key, std::string response)
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Responses[std::move(key)].push_back(std::move(response));
+		}
+
+		std::optional<std::string> Take(const std::string_view& key)
+		{
+			std::lock_guard lock(m_Mutex);
+			auto found = m_Responses.find(key);
+			if (found == m_Responses.end())
+			{
+				m_Misses++;
+				return std::nullopt;
+			}
+
+			m_Hits++;
+			auto& responses = found->second;
+			if (responses.size() == 1)
+				return responses.front();
+
+			auto response = std::move(responses.front());
+			responses.pop_front();
+			return response;
+		}
+
+		uint32_t GetHits() const { return m_Hits; }
+		uint32_t GetMisses() const { return m_Misses; }
+
+	private:
+		mutable std::mutex m_Mutex;
+		std::map<std::string, std::deque<std::string>, std::less<>> m_Responses;
+		std::atomic_uint32_t m_Hits = 0;
+		std::atomic_uint32_t m_Misses = 0;
+	};
+
+	class ReplayRCONResponses final : public ReplayResponses
+	{
+	public:
+		std::shared_future<std::string> Send(const std::string& cmd)
+		{
+			// A command the recording never sent gets no output, like most commands
+			std::promise<std::string> promise;
+			promise.set_value(Take(cmd).value_or(std::string{}));
+			return promise.get_future().share();
+		}
+	};
+
+	class ReplayHTTPClient final : public IHTTPClient
+	{
+	public:
+		ReplayResponses& GetResponses() const { return m_Responses; }
+
+		std::string GetString(const URL& url, HTTPRequestTag tag) const override
+		{
+			m_Requests++;
+			if (auto body = m_Responses.Take(url.ToString()))
+				return std::move(*body);
+
+			m_Failed++;
+			throw http_error(HTTPResponseCode::NotFound, mh::format("{} isn't in the recording", url));
+		}
+
+		mh::task<std::string> GetStringAsync(URL url, HTTPRequestTag tag, CancellationToken cancel = {}) const override
+		{
+			co_return GetString(url, tag);
+		}
+
+		mh::task<HTTPConditionalResponse> GetStringConditionalAsync(URL url, HTTPRequestTag tag, HTTPCacheValidators validators) const override
+		{
+			co_return HTTPConditionalResponse{ .m_Body = GetString(url, tag) };
+		}
+
+		// Nothing a replay does should reach a real server
+		mh::task<> PutStringAsync(URL url, HTTPRequestTag tag, std::string body, std::string contentType) const override
+		{
+			co_return;
+		}
+
+		// Downloads aren't recorded, so this only works for something that was also fetched normally
+		mh::task<> DownloadFileAsync(URL url, HTTPRequestTag tag, std::filesystem::path path) const override
+		{
+			const std::string body = GetString(url, tag);
+			std::ofstream(path, std::ios::binary | std::ios::trunc).write(body.data(), body.size());
+			co_return;
+		}
+
+		RequestCounts GetRequestCounts() const override
+		{
+			return RequestCounts{ .m_Total = m_Requests, .m_Failed = m_Failed };
+		}
+
+		void RecordNegativeCacheLookup(bool hit) const override {}
+		std::vector<HostStats> GetHostStats() const override { return {}; }
+		TagStats GetTagStats(HTTPRequestTag tag) const override { return {}; }
+		void PrewarmHosts(std::vector<URL> hosts) const override {}
+
+	private:
+		mutable ReplayResponses m_Responses;
+		mutable std::atomic_uint32_t m_Requests = 0;
+		mutable std::atomic_uint32_t m_Failed = 0;
+	};
+}
+
+SessionReplay::SessionReplay(const std::filesystem::path& archive, float speed) :
+	m_Speed(speed),
+	m_HTTPClient(std::make_shared<ReplayHTTPClient>()),
+	m_RCONResponses(std::make_shared<ReplayRCONResponses>())
+{
+	// Read everything now, so none of it shows up while the pipeline is being profiled
+	SessionArchiveReader reader(archive);
+	m_RecordingStartTime = reader.GetStartTime();
+
+	std::string consoleLogPath;
+	for (SessionArchiveRecord record; reader.ReadNext(record); )
+	{
+		switch (record.m_Type)
+		{
+		case SessionArchiveRecordType::ConsoleOutput:
+			if (consoleLogPath.empty())
+				consoleLogPath = record.m_Key;
+			else if (record.m_Key != consoleLogPath)
+				break;
+
+			m_Timeline.push_back(std::move(record));
+			break;
+
+		case SessionArchiveRecordType::ChatWrappers:
+			// They're recorded when the parser first gets to them, after the console output it was parsing
+			if (!m_Settings.m_Unsaved.m_ChatMsgWrappers)
+				LoadChatWrappers(record.m_Data);
+			else
+				m_Timeline.push_back(std::move(record));
+			break;
+
+		case SessionArchiveRecordType::RCONResponse:
+			m_RCONResponses->Add(std::move(record.m_Key), std::move(record.m_Data));
+			break;
+		case SessionArchiveRecordType::HTTPResponse:
+			m_HTTPClient->GetResponses().Add(std::move(record.m_Key), std::move(record.m_Data));
+			break;
+
+		case SessionArchiveRecordType::COUNT:
+			break;
+		}
+	}
+
+	Log("Replaying {} ({} records of console output and chat wrappers) from {}", archive, m_Timeline.size(),
+		consoleLogPath.empty() ? "nowhere" : consoleLogPath);
+
+	m_Settings.SetHTTPClient(m_HTTPClient);
+
+	if (!m_Settings.m_Unsaved.m_ChatMsgWrappers)
+	{
+		m_Settings.m_Unsaved.m_ChatMsgWrappers = ChatWrappersGeneratorPage::TryLoadSavedChatWrappers(m_Settings.GetTFDir());
+		if (!m_Settings.m_Unsaved.m_ChatMsgWrappers)
+			throw std::runtime_error(mh::format("{} has no chat wrappers, and there are no saved ones to use instead", archive));
+
+		LogWarning("{} has no chat wrappers, using the saved ones. Chat messages probably won't be recognized.", archive);
+	}
+
+	m_WorldState = IWorldState::Create(m_Settings);
+	m_ActionManager = IRCONActionManager::Create(m_Settings, *m_WorldState,
+		[responses = m_RCONResponses](const std::string& cmd) { return responses->Send(cmd); });
+	m_ActionManager->AddPeriodicActionGenerator<StatusUpdateActionGenerator>(*m_WorldState);
+	m_ActionManager->AddPeriodicActionGenerator<ConfigActionGenerator>();
+	m_ActionManager->AddPeriodicActionGenerator<LobbyDebugActionGenerator>(*m_WorldState);
+	m_ModeratorLogic = IModeratorLogic::Create(*m_WorldState, m_Settings, *m_ActionManager);
+
+	// Nothing is ever read from this, it's all handed to ParseText()
+	m_Parser.emplace(*m_WorldState, m_Settings, consoleLogPath);
+	m_Parser->SetMirrorToLogFile(false);
+
+	m_StartTime = std::chrono::steady_clock::now();
+}
+
+SessionReplay::~SessionReplay() = default;
+
+bool SessionReplay::Update()
+{
+	if (m_NextRecord >= m_Timeline.size())
+	{
+		LogSummary();
+		return false;
+	}
+
+	if (m_Speed > 0)
+	{
+		m_Offset = std::chrono::duration_cast<std::chrono::microseconds>(
+			(std::chrono::steady_clock::now() - m_StartTime) * m_Speed);
+	}
+	else
+	{
+		m_Offset = m_Timeline[m_NextRecord].m_Offset;
+	}
+
+	FrameClock::BeginFrame(m_RecordingStartTime + m_Offset, m_StartTime + m_Offset);
+
+	GetDispatcher().run_for(10ms);
+	TaskScheduler::Get().RunMainThreadTasks(10ms);
+
+	m_WorldState->Update();
+
+	if (m_Speed > 0)
+	{
+		while (m_NextRecord < m_Timeline.size() && m_Timeline[m_NextRecord].m_Offset <= m_Offset)
+			ReplayRecord(m_Timeline[m_NextRecord++]);
+	}
+	else
+	{
+		// Still one read per update, the same as it came in
+		ReplayRecord(m_Timeline[m_NextRecord++]);
+	}
+
+	m_ModeratorLogic->Update();
+	m_ActionManager->Update();
+
+	return true;
+}
+
+void SessionReplay::ReplayRecord(const SessionArchiveRecord& record)
+{
+	if (record.m_Type == SessionArchiveRecordType::ChatWrappers)
+	{
+		LoadChatWrappers(record.m_Data);
+	}
+	else
+	{
+		m_ConsoleBytes += record.m_Data.size();
+		m_Parser->ParseText(record.m_Data);
+	}
+}
+
+void SessionReplay::LoadChatWrappers(const std::string_view& json)
+{
+	try
+	{
+		m_Settings.m_Unsaved.m_ChatMsgWrappers = nlohmann::json::parse(json).get<ChatWrappers>();
+	}
+	catch (const std::exception& e)
+	{
+		LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to load the recorded chat wrappers");
+	}
+}
+
+void SessionReplay::LogSummary() const
+{
+	const auto elapsed = std::chrono::steady_clock::now() - m_StartTime;
+	const auto stats = m_Parser->GetStats();
+
+	uint64_t linesParsed = 0;
+	for (auto count : stats.m_LinesParsed)
+		linesParsed += count;
+
+	Log("Replayed {} of recording in {:.3f} seconds: {} bytes of console output, {} lines parsed, {} unparsed, {:.3f} seconds parsing",
+		HumanDuration(std::chrono::duration_cast<std::chrono::seconds>(m_Offset)), to_seconds(elapsed), m_ConsoleBytes,
+		linesParsed, stats.m_LinesUnparsed, to_seconds(stats.m_ParseTime));
+	Log("RCON responses: {} from the recording, {} commands it never sent. HTTP responses: {} from the recording, {} missing.",
+		m_RCONResponses->GetHits(), m_RCONResponses->GetMisses(), m_HTTPClient->GetResponses().GetHits(), m_HTTPClient->GetResponses().GetMisses());
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Actions/RCONActionManager.h"
+#include "Clock.h"
+#include "ConsoleLog/ConsoleLogParser.h"
+#include "Config/Settings.h"
+#include "ModeratorLogic.h"
+#include "SessionArchive.h"
+#include "WorldState.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	class ReplayHTTPClient;
+	class ReplayRCONResponses;
+
+	// Plays a session archive (--replay) back through the console log parser, world state,
+	// moderation logic and RCON action manager, with nothing but the recording on the other end.
+	// RCON commands and HTTP requests are answered straight away with what the recording got last
+	// time, the frame clock follows the recording's timeline, and the whole archive is read up
+	// front, so runs of the same archive do the same work and are comparable with a profiler. Only
+	// meant to run after IFilesystem::RedirectWrites(), so nothing it saves (rule marks, the TempDB)
+	// touches the user's files or carries over into the next run.
+	//
+	// Recordings of several sessions at once are played back one console log at a time, the first one.
+	class SessionReplay final
+	{
+	public:
+		// speed is how many times faster than real time to play it back, or 0 for as fast as possible
+		SessionReplay(const std::filesystem::path& archive, float speed);
+		~SessionReplay();
+
+		// Returns false once everything in the archive has been replayed
+		bool Update();
+
+		// There's nothing to wait on like vsync either, when playing back in real time
+		static constexpr duration_t UPDATE_INTERVAL = std::chrono::milliseconds(10);
+
+	private:
+		void ReplayRecord(const SessionArchiveRecord& record);
+		void LoadChatWrappers(const std::string_view& json);
+		void LogSummary() const;
+
+		float m_Speed = 1;
+		time_point_t m_RecordingStartTime{};
+		std::chrono::steady_clock::time_point m_StartTime{};
+		std::chrono::microseconds m_Offset{};
+
+		// Console output and chat wrappers, in the order they came in
+		std::vector<SessionArchiveRecord> m_Timeline;
+		size_t m_NextRecord = 0;
+		uint64_t m_ConsoleBytes = 0;
+
+		std::shared_ptr<ReplayHTTPClient> m_HTTPClient;
+		std::shared_ptr<ReplayRCONResponses> m_RCONResponses;
+
+		Settings m_Settings;
+		std::shared_ptr<IWorldState> m_WorldState;
+		std::unique_ptr<IRCONActionManager> m_ActionManager;
+		std::unique_ptr<IModeratorLogic> m_ModeratorLogic;
+		std::optional<ConsoleLogParser> m_Parser;
+	};
+}
@@ -0,0 +1,318 @@
+#include "SessionSnapshot.h"
+#include "Config/Settings.h"
+#include "ConsoleLog/ConsoleLines.h"
+#include "Util/JSONUtils.h"
+#include "Filesystem.h"
+#include "Log.h"
+#include "ModeratorLogic.h"
+#include "WorldState.h"
+
+#include <nlohmann/json.hpp>
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+static int64_t TimeToJSON(time_point_t time)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+static time_point_t TimeFromJSON(const nlohmann::json& j)
+{
+	return time_point_t(std::chrono::duration_cast<duration_t>(std::chrono::milliseconds(j.get<int64_t>())));
+}
+
+static nlohmann::json OptionalTimeToJSON(const std::optional<time_point_t>& time)
+{
+	return time ? nlohmann::json(TimeToJSON(*time)) : nlohmann::json(nullptr);
+}
+static std::optional<time_point_t> OptionalTimeFromJSON(const nlohmann::json& j)
+{
+	return j.is_null() ? std::nullopt : std::optional(TimeFromJSON(j));
+}
+
+static nlohmann::json LobbyMembersToJSON(const std::vector<LobbyMember>& members)
+{
+	nlohmann::json json = nlohmann::json::array();
+	for (const auto& member : members)
+	{
+		json.push_back(nlohmann::json{
+			{ "steamid", member.m_SteamID },
+			{ "index", member.m_Index },
+			{ "team", member.m_Team },
+			{ "type", member.m_Type },
+			{ "pending", member.m_Pending },
+		});
+	}
+
+	return json;
+}
+static std::vector<LobbyMember> LobbyMembersFromJSON(const nlohmann::json& json)
+{
+	std::vector<LobbyMember> members;
+	for (const auto& entry : json)
+	{
+		auto& member = members.emplace_back();
+		member.m_SteamID = entry.at("steamid");
+		member.m_Index = entry.at("index");
+		member.m_Team = entry.at("team");
+		member.m_Type = entry.at("type");
+		member.m_Pending = entry.at("pending");
+	}
+
+	return members;
+}
+
+static nlohmann::json SnapshotToJSON(const SessionSnapshot& snapshot)
+{
+	nlohmann::json json =
+	{
+		{ "version", SessionSnapshot::VERSION },
+		{ "saved_time", TimeToJSON(snapshot.m_SavedTime) },
+		{ "local_steamid", snapshot.m_LocalSteamID },
+		{ "server_address", snapshot.m_ServerAddress },
+		{ "current_lobby_members", LobbyMembersToJSON(snapshot.m_CurrentLobbyMembers) },
+		{ "pending_lobby_members", LobbyMembersToJSON(snapshot.m_PendingLobbyMembers) },
+		{ "local_player_initialized", snapshot.m_IsLocalPlayerInitialized },
+	};
+
+	auto& players = json["players"] = nlohmann::json::array();
+	for (const auto& player : snapshot.m_Players)
+	{
+		players.push_back(nlohmann::json{
+			{ "steamid", player.m_Status.m_SteamID },
+			{ "name", player.m_Status.m_Name.str() },
+			{ "userid", player.m_Status.m_UserID },
+			{ "connection_time", TimeToJSON(player.m_Status.m_ConnectionTime) },
+			{ "ping", player.m_Status.m_Ping },
+			{ "loss", player.m_Status.m_Loss },
+			{ "state", player.m_Status.m_State },
+			{ "kills", player.m_Scores.m_Kills },
+			{ "deaths", player.m_Scores.m_Deaths },
+			{ "local_kills", player.m_Scores.m_LocalKills },
+			{ "local_deaths", player.m_Scores.m_LocalDeaths },
+			{ "team", player.m_Team },
+			{ "client_index", player.m_ClientIndex },
+			{ "last_status_update", TimeToJSON(player.m_LastStatusUpdateTime) },
+			{ "last_status_active_begin", TimeToJSON(player.m_LastStatusActiveBegin) },
+		});
+	}
+
+	const auto& modLogic = snapshot.m_ModeratorLogic;
+	auto& modLogicJson = json["moderator_logic"] =
+	{
+		{ "players_running_tool", modLogic.m_PlayersRunningTool },
+		{ "next_connecting_cheater_warning", TimeToJSON(modLogic.m_NextConnectingCheaterWarningTime) },
+		{ "next_cheater_warning", TimeToJSON(modLogic.m_NextCheaterWarningTime) },
+		{ "last_vote_call", TimeToJSON(modLogic.m_LastVoteCallTime) },
+	};
+
+	auto& modPlayers = modLogicJson["players"] = nlohmann::json::array();
+	for (const auto& player : modLogic.m_Players)
+	{
+		modPlayers.push_back(nlohmann::json{
+			{ "steamid", player.m_SteamID },
+			{ "prewarned_other_team", player.m_PreWarnedOtherTeam },
+			{ "connecting_warning_delay_end", OptionalTimeToJSON(player.m_ConnectingWarningDelayEnd) },
+			{ "warning_delay_end", OptionalTimeToJSON(player.m_WarningDelayEnd) },
+			{ "detected_time", OptionalTimeToJSON(player.m_DetectedTime) },
+			{ "detected_game_time", TimeToJSON(player.m_DetectedGameTime) },
+		});
+	}
+
+	return json;
+}
+
+static std::optional<SessionSnapshot> SnapshotFromJSON(const nlohmann::json& json)
+{
+	if (json.at("version").get<int>() != SessionSnapshot::VERSION)
+		return std::nullopt;
+
+	SessionSnapshot snapshot;
+	snapshot.m_SavedTime = TimeFromJSON(json.at("saved_time"));
+	snapshot.m_LocalSteamID = json.at("local_steamid");
+	snapshot.m_ServerAddress = json.at("server_address");
+	snapshot.m_CurrentLobbyMembers = LobbyMembersFromJSON(json.at("current_lobby_members"));
+	snapshot.m_PendingLobbyMembers = LobbyMembersFromJSON(json.at("pending_lobby_members"));
+	snapshot.m_IsLocalPlayerInitialized = json.at("local_player_initialized");
+
+	for (const auto& entry : json.at("players"))
+	{
+		auto& player = snapshot.m_Players.emplace_back();
+		player.m_Status.m_SteamID = entry.at("steamid");
+		player.m_Status.m_Name = InternedString(entry.at("name").get<std::string>());
+		player.m_Status.m_UserID = entry.at("userid");
+		player.m_Status.m_ConnectionTime = TimeFromJSON(entry.at("connection_time"));
+		player.m_Status.m_Ping = entry.at("ping");
+		player.m_Status.m_Loss = entry.at("loss");
+		player.m_Status.m_State = entry.at("state");
+		player.m_Scores.m_Kills = entry.at("kills");
+		player.m_Scores.m_Deaths = entry.at("deaths");
+		player.m_Scores.m_LocalKills = entry.at("local_kills");
+		player.m_Scores.m_LocalDeaths = entry.at("local_deaths");
+		player.m_Team = entry.at("team");
+		player.m_ClientIndex = entry.at("client_index");
+		player.m_LastStatusUpdateTime = TimeFromJSON(entry.at("last_status_update"));
+		player.m_LastStatusActiveBegin = TimeFromJSON(entry.at("last_status_active_begin"));
+	}
+
+	const auto& modLogicJson = json.at("moderator_logic");
+	auto& modLogic = snapshot.m_ModeratorLogic;
+	modLogic.m_PlayersRunningTool = modLogicJson.at("players_running_tool").get<std::vector<SteamID>>();
+	modLogic.m_NextConnectingCheaterWarningTime = TimeFromJSON(modLogicJson.at("next_connecting_cheater_warning"));
+	modLogic.m_NextCheaterWarningTime = TimeFromJSON(modLogicJson.at("next_cheater_warning"));
+	modLogic.m_LastVoteCallTime = TimeFromJSON(modLogicJson.at("last_vote_call"));
+
+	for (const auto& entry : modLogicJson.at("players"))
+	{
+		auto& player = modLogic.m_Players.emplace_back();
+		player.m_SteamID = entry.at("steamid");
+		player.m_PreWarnedOtherTeam = entry.at("prewarned_other_team");
+		player.m_ConnectingWarningDelayEnd = OptionalTimeFromJSON(entry.at("connecting_warning_delay_end"));
+		player.m_WarningDelayEnd = OptionalTimeFromJSON(entry.at("warning_delay_end"));
+		player.m_DetectedTime = OptionalTimeFromJSON(entry.at("detected_time"));
+		player.m_DetectedGameTime = TimeFromJSON(entry.at("detected_game_time"));
+	}
+
+	return snapshot;
+}
+
+SessionSnapshotManager::SessionSnapshotManager(IWorldState& world, IModeratorLogic& modLogic, const Settings& settings,
+	std::string_view fileName) :
+	AutoConsoleLineListener(world,
+		{
+			ConsoleLineType::PlayerStatusIP,
+			ConsoleLineType::Connecting,
+			ConsoleLineType::HostNewGame,
+		}),
+	m_World(&world),
+	m_ModLogic(&modLogic),
+	m_Settings(&settings),
+	m_FileName(IFilesystem::Get().GetTempDir() / fileName)
+{
+	try
+	{
+		if (!std::filesystem::exists(m_FileName))
+			return;
+
+		auto snapshot = SnapshotFromJSON(nlohmann::json::parse(IFilesystem::Get().MapFile(m_FileName).GetData()));
+		if (!snapshot)
+			return;
+
+		if (const auto age = tfbd_clock_t::now() - snapshot->m_SavedTime; age > MAX_SNAPSHOT_AGE || age < -MAX_SNAPSHOT_AGE)
+			DebugLog("Ignoring session snapshot from {:.0f} seconds ago", to_seconds(age));
+		else if (snapshot->m_LocalSteamID != settings.GetLocalSteamID())
+			DebugLog("Ignoring session snapshot for {}", snapshot->m_LocalSteamID);
+		else
+			m_PendingRestore = std::move(snapshot);
+	}
+	catch (...)
+	{
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to load {}", m_FileName);
+	}
+}
+
+SessionSnapshotManager::~SessionSnapshotManager()
+{
+	if (m_SaveTask.valid())
+		m_SaveTask.wait();
+}
+
+void SessionSnapshotManager::Update()
+{
+	const auto now = tfbd_clock_t::now();
+
+	if (m_PendingRestore && (now - m_PendingRestore->m_SavedTime) > MAX_SNAPSHOT_AGE)
+	{
+		DebugLog("Never saw {} in status, dropping the session snapshot", m_PendingRestore->m_ServerAddress);
+		m_PendingRestore.reset();
+	}
+
+	// Don't overwrite the last run's snapshot before we've had a chance to use it
+	if (m_PendingRestore || m_ServerAddress.empty())
+		return;
+
+	// Only while we're on a server and caught up with console.log, not halfway through an old one
+	const auto worldTime = m_World->GetCurrentTime();
+	if ((now - worldTime) > 30s || (worldTime - m_World->GetLastStatusUpdateTime()) > 30s)
+		return;
+
+	if ((now - m_LastSaveTime) < SAVE_INTERVAL || (m_SaveTask.valid() && !m_SaveTask.is_ready()))
+		return;
+
+	m_LastSaveTime = now;
+	Save();
+}
+
+void SessionSnapshotManager::Save() try
+{
+	SessionSnapshot snapshot;
+	snapshot.m_SavedTime = tfbd_clock_t::now();
+	snapshot.m_LocalSteamID = m_Settings->GetLocalSteamID();
+	snapshot.m_ServerAddress = m_ServerAddress;
+	m_World->SaveSnapshot(snapshot);
+	m_ModLogic->SaveSnapshot(snapshot);
+
+	// Serialized here, written on the pool so the disk never holds up a frame
+	m_SaveTask = [](mh::thread_pool& pool, std::filesystem::path fileName, std::string contents) -> mh::task<>
+	{
+		co_await pool.co_add_task();
+
+		try
+		{
+			IFilesystem::Get().WriteFile(fileName, contents, PathUsage::WriteLocal);
+		}
+		catch (...)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to save {}", fileName);
+		}
+
+	}(m_SavePool, m_FileName, SnapshotToJSON(snapshot).dump());
+}
+catch (...)
+{
+	LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to save session snapshot");
+}
+
+void SessionSnapshotManager::OnConsoleLineParsed(IWorldState& world, IConsoleLine& line)
+{
+	switch (line.GetType())
+	{
+	case ConsoleLineType::PlayerStatusIP:
+	{
+		m_ServerAddress = static_cast<const ServerStatusPlayerIPLine&>(line).GetLocalIP();
+
+		// Anything older is left over from before the snapshot was saved
+		if (!m_PendingRestore || line.GetTimestamp() < m_PendingRestore->m_SavedTime)
+			break;
+
+		if (m_PendingRestore->m_ServerAddress == m_ServerAddress)
+		{
+			Log("Restoring {} players and {} lobby members from the session snapshot", m_PendingRestore->m_Players.size(),
+				m_PendingRestore->m_CurrentLobbyMembers.size() + m_PendingRestore->m_PendingLobbyMembers.size());
+			m_World->RestoreSnapshot(*m_PendingRestore);
+			m_ModLogic->RestoreSnapshot(*m_PendingRestore);
+		}
+		else
+		{
+			DebugLog("On {} instead of {}, dropping the session snapshot", m_ServerAddress, m_PendingRestore->m_ServerAddress);
+		}
+
+		m_PendingRestore.reset();
+		break;
+	}
+	case ConsoleLineType::Connecting:
+	case ConsoleLineType::HostNewGame:
+	{
+		m_ServerAddress.clear();
+
+		if (m_PendingRestore && line.GetTimestamp() >= m_PendingRestore->m_SavedTime)
+		{
+			DebugLog("Changed servers since the session snapshot was saved, dropping it");
+			m_PendingRestore.reset();
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Clock.h"
+#include "ConsoleLog/ConsoleLineListener.h"
+#include "IPlayer.h"
+#include "LobbyMember.h"
+#include "PlayerStatus.h"
+#include "SteamID.h"
+#include "TFConstants.h"
+
+#include <mh/concurrency/thread_pool.hpp>
+#include <mh/coroutine/task.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	class IModeratorLogic;
+	class Settings;
+
+	// Enough of WorldState and ModeratorLogic to pick up where we left off if the tool restarts in the
+	// middle of a match, instead of being blind until status/tf_lobby_debug and the Steam API lookups
+	// come back. Player IPs are left out.
+	struct SessionSnapshot
+	{
+		static constexpr int VERSION = 1;
+
+		time_point_t m_SavedTime{};
+		SteamID m_LocalSteamID;
+		std::string m_ServerAddress; // udp/ip from status
+
+		struct Player
+		{
+			PlayerStatus m_Status;
+			PlayerScores m_Scores;
+			TFTeam m_Team{};
+			uint8_t m_ClientIndex{};
+			time_point_t m_LastStatusUpdateTime{};
+			time_point_t m_LastStatusActiveBegin{};
+		};
+
+		std::vector<LobbyMember> m_CurrentLobbyMembers;
+		std::vector<LobbyMember> m_PendingLobbyMembers;
+		std::vector<Player> m_Players;
+		bool m_IsLocalPlayerInitialized = false;
+
+		struct ModeratorPlayer
+		{
+			SteamID m_SteamID;
+			bool m_PreWarnedOtherTeam = false;
+			std::optional<time_point_t> m_ConnectingWarningDelayEnd;
+			std::optional<time_point_t> m_WarningDelayEnd;
+			std::optional<time_point_t> m_DetectedTime;
+			time_point_t m_DetectedGameTime{};
+		};
+
+		struct
+		{
+			std::vector<SteamID> m_PlayersRunningTool;
+			std::vector<ModeratorPlayer> m_Players;
+			time_point_t m_NextConnectingCheaterWarningTime{};
+			time_point_t m_NextCheaterWarningTime{};
+			time_point_t m_LastVoteCallTime{};
+		} m_ModeratorLogic;
+	};
+
+	// Saves a SessionSnapshot every few seconds while we're on a server. The one left behind by the
+	// last run is restored once status shows we're still on the same server, if it isn't too old.
+	class SessionSnapshotManager final : AutoConsoleLineListener
+	{
+	public:
+		SessionSnapshotManager(IWorldState& world, IModeratorLogic& modLogic, const Settings& settings,
+			std::string_view fileName = "session_snapshot.json");
+		~SessionSnapshotManager();
+
+		void Update();
+
+	private:
+		// Anything older than this is more wrong than starting from scratch
+		static constexpr duration_t MAX_SNAPSHOT_AGE = std::chrono::minutes(2);
+		static constexpr duration_t SAVE_INTERVAL = std::chrono::seconds(5);
+
+		void OnConsoleLineParsed(IWorldState& world, IConsoleLine& line) override;
+		void Save();
+
+		IWorldState* m_World = nullptr;
+		IModeratorLogic* m_ModLogic = nullptr;
+		const Settings* m_Settings = nullptr;
+
+		std::filesystem::path m_FileName;
+		std::optional<SessionSnapshot> m_PendingRestore;
+		std::string m_ServerAddress;
+		time_point_t m_LastSaveTime{};
+
+		mh::thread_pool m_SavePool{ 1 };
+		mh::task<> m_SaveTask;
+	};
+}
@@ -74,7 +74,7 @@ static std::filesystem::path GetSavedChatMsgWrappersFilename(const std::filesyst
 	return tfDir / "custom" / TF2BD_CHAT_WRAPPERS_DIR / "__tf2bd_chat_msg_wrappers.json";
 }
 
-static std::optional<ChatWrappers> TryLoadChatWrappers(const std::filesystem::path& tfDir)
+std::optional<ChatWrappers> ChatWrappersGeneratorPage::TryLoadSavedChatWrappers(const std::filesystem::path& tfDir)
 {
 	const auto path = GetSavedChatMsgWrappersFilename(tfDir);
 
@@ -100,7 +100,7 @@ void ChatWrappersGeneratorPage::Init(const InitState& is)
 		DebugLog("TF2 was found running, trying to load saved chat wrappers...");
 		try
 		{
-			m_ChatWrappersLoaded = TryLoadChatWrappers(tfDir);
+			m_ChatWrappersLoaded = TryLoadSavedChatWrappers(tfDir);
 		}
 		catch (const std::exception& e)
 		{
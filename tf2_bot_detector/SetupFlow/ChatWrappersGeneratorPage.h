@@ -28,6 +28,10 @@ namespace tf2_bot_detector
 		SetupFlowPage GetPage() const override { return SetupFlowPage::ChatWrappersGenerate; }
 
 		static std::string GetChatWrapperStringToken(uint32_t token);
+
+		// The wrappers written out the last time they were generated, if there are any
+		static std::optional<ChatWrappers> TryLoadSavedChatWrappers(const std::filesystem::path& tfDir);
+
 		static constexpr char VERIFY_CFG_FILE_NAME[] = "__tf2bd_chat_wrappers_verify.cfg";
 
 	private:
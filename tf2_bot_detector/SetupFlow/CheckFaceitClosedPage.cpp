@@ -1,6 +1,7 @@
 #include "UI/ImGui_TF2BotDetector.h"
 #include "Filesystem.h"
 #include "ISetupFlowPage.h"
+#include "PolledCheck.h"
 #include "Platform/Platform.h"
 
 #include <mh/algorithm/multi_compare.hpp>
@@ -10,6 +11,7 @@
 
 #undef DrawState
 
+using namespace std::chrono_literals;
 using namespace tf2_bot_detector;
 
 namespace
@@ -19,9 +21,15 @@ namespace
 	public:
 		ValidateSettingsResult ValidateSettings(const Settings& settings) const override
 		{
-			return Processes::IsProcessRunning("faceitservice.exe") ? ValidateSettingsResult::TriggerOpen : ValidateSettingsResult::Success;
+			const auto& isFaceitRunning = m_IsFaceitRunning.GetValue();
+			if (!isFaceitRunning.has_value())
+				return ValidateSettingsResult::Pending;
+
+			return *isFaceitRunning ? ValidateSettingsResult::TriggerOpen : ValidateSettingsResult::Success;
 		}
 
+		void Update(const UpdateState& us) override { m_IsFaceitRunning.Update(); }
+
 		OnDrawResult OnDraw(const DrawState& ds) override
 		{
 			if (ValidateSettings(*ds.m_Settings) == ValidateSettingsResult::TriggerOpen)
@@ -41,6 +49,9 @@ namespace
 		bool WantsSetupText() const { return false; }
 		bool WantsContinueButton() const { return false; }
 		SetupFlowPage GetPage() const override { return SetupFlowPage::CheckFaceitClosed; }
+
+	private:
+		PolledCheck<bool> m_IsFaceitRunning{ 1s, [] { return Processes::IsProcessRunning("faceitservice.exe"); } };
 	};
 }
 
@@ -1,9 +1,11 @@
 #include "ISetupFlowPage.h"
+#include "PolledCheck.h"
 #include "UI/ImGui_TF2BotDetector.h"
 #include "Platform/Platform.h"
 
 #undef DrawState
 
+using namespace std::chrono_literals;
 using namespace tf2_bot_detector;
 
 namespace
@@ -12,6 +14,7 @@ namespace
 	{
 	public:
 		ValidateSettingsResult ValidateSettings(const Settings& settings) const override;
+		void Update(const UpdateState& us) override { m_IsSteamRunning.Update(); }
 
 		OnDrawResult OnDraw(const DrawState& ds) override;
 
@@ -26,11 +29,15 @@ namespace
 
 	private:
 		bool m_CanContinue = false;
+		PolledCheck<bool> m_IsSteamRunning{ 1s, &Platform::Processes::IsSteamRunning };
 	};
 
 	auto CheckSteamOpenPage::ValidateSettings(const Settings& settings) const -> ValidateSettingsResult
 	{
-		if (!Platform::Processes::IsSteamRunning())
+		const auto& isSteamRunning = m_IsSteamRunning.GetValue();
+		if (!isSteamRunning.has_value())
+			return ValidateSettingsResult::Pending;
+		if (!*isSteamRunning)
 			return ValidateSettingsResult::TriggerOpen;
 
 		return ValidateSettingsResult::Success;
@@ -40,7 +47,7 @@ namespace
 	{
 		ImGui::Text("Steam must be open to use TF2 Bot Detector.");
 
-		const bool isSteamRunning = Platform::Processes::IsSteamRunning();
+		const bool isSteamRunning = m_IsSteamRunning.GetValue().value_or(false);
 		m_CanContinue = isSteamRunning;
 		if (isSteamRunning)
 		{
@@ -37,10 +37,26 @@ namespace tf2_bot_detector
 			// Either something's wrong, or we need to run some blocking logic.
 			// Open this page.
 			TriggerOpen,
+
+			// A background check hasn't finished yet. Passed over if another page is already open,
+			// otherwise the setup flow waits on it rather than guessing.
+			Pending,
 		};
 
 		[[nodiscard]] virtual ValidateSettingsResult ValidateSettings(const Settings& settings) const = 0;
 
+		struct UpdateState
+		{
+			explicit UpdateState(const Settings& settings) : m_Settings(settings) {}
+
+			const Settings& m_Settings;
+			IUpdateManager* m_UpdateManager = nullptr;
+		};
+
+		// Called every frame for every page, open or not, so slow checks (process enumeration, WMI,
+		// filesystem access) can be started on the IO lane long before their page's turn.
+		virtual void Update(const UpdateState& us) {}
+
 		enum class OnDrawResult
 		{
 			// Draw again next frame unless the user clicks "Done"/"Next"
@@ -2,8 +2,11 @@
 #include "Filesystem.h"
 #include "ISetupFlowPage.h"
 #include "Platform/Platform.h"
+#include "Util/StartupTimeline.h"
+#include "Util/TaskScheduler.h"
 
 #include <mh/algorithm/multi_compare.hpp>
+#include <mh/coroutine/task.hpp>
 
 #include <filesystem>
 #include <fstream>
@@ -19,11 +22,26 @@ namespace
 	public:
 		ValidateSettingsResult ValidateSettings(const Settings& settings) const override;
 
-		OnDrawResult OnDraw(const DrawState& ds) override
+		void Update(const UpdateState& us) override
 		{
-			if (m_ValidationState == ValidationState::Unvalidated)
-				Validate(IFilesystem::Get());
+			if (m_ValidationState != ValidationState::Unvalidated)
+				return;
 
+			if (!m_ValidationTask.valid())
+			{
+				m_ValidationTask = ValidateAsync(IFilesystem::Get());
+			}
+			else if (m_ValidationTask.is_ready())
+			{
+				const auto& result = m_ValidationTask.get();
+				m_ValidationState = result.m_State;
+				m_ValidationMessage = result.m_Message;
+				m_ValidationTask = {};
+			}
+		}
+
+		OnDrawResult OnDraw(const DrawState& ds) override
+		{
 			if (m_ValidationState == ValidationState::ValidationSuccess)
 				return OnDrawResult::EndDrawing;
 
@@ -65,32 +83,45 @@ namespace
 	private:
 
 		ValidationState m_ValidationState = ValidationState::Unvalidated;
-		std::error_code m_ErrorCode;
 		std::string m_ValidationMessage;
 
-		void Validate(const IFilesystem& fs) try
+		struct ValidationResult
+		{
+			ValidationState m_State = ValidationState::ValidationFailure;
+			std::string m_Message = "Validation of filesystem permissions failed";
+		};
+		mh::task<ValidationResult> m_ValidationTask;
+
+		static mh::task<ValidationResult> ValidateAsync(const IFilesystem& fs)
 		{
-			assert(m_ValidationState == ValidationState::Unvalidated);
-			m_ValidationState = ValidationState::ValidationFailure;
-			m_ValidationMessage = "Validation of filesystem permissions failed";
+			co_await TaskScheduler::Get().co_schedule(TaskLane::IO, TaskPriority::High);
+			TF2BD_STARTUP_PHASE("PermissionsCheckPage::Validate");
 
+			ValidationResult result;
+			Validate(fs, result);
+			co_return result;
+		}
+
+		static void Validate(const IFilesystem& fs, ValidationResult& result) try
+		{
+			std::error_code ec;
 			const auto cfgDir = fs.GetConfigDir();
 
 			// Check that /cfg exists
 			{
-				bool exists = std::filesystem::exists(cfgDir, m_ErrorCode);
-				if (m_ErrorCode)
+				bool exists = std::filesystem::exists(cfgDir, ec);
+				if (ec)
 				{
-					m_ValidationMessage = mh::format("Filesystem error when checking status of {}: {}", cfgDir, m_ErrorCode);
+					result.m_Message = mh::format("Filesystem error when checking status of {}: {}", cfgDir, ec);
 					return;
 				}
 
 				if (!exists)
 				{
-					std::filesystem::create_directories(cfgDir, m_ErrorCode);
-					if (m_ErrorCode)
+					std::filesystem::create_directories(cfgDir, ec);
+					if (ec)
 					{
-						m_ValidationMessage = mh::format("Filesystem error when creating {}: {}", cfgDir, m_ErrorCode);
+						result.m_Message = mh::format("Filesystem error when creating {}: {}", cfgDir, ec);
 						return;
 					}
 				}
@@ -101,11 +132,11 @@ namespace
 
 			const auto DeleteFile = [&]()
 			{
-				std::filesystem::remove(testFile, m_ErrorCode);
-				if (m_ErrorCode)
+				std::filesystem::remove(testFile, ec);
+				if (ec)
 				{
-					m_ValidationMessage = mh::format(
-						"Filesystem error when trying to delete {}: {}", testFile, m_ErrorCode);
+					result.m_Message = mh::format(
+						"Filesystem error when trying to delete {}: {}", testFile, ec);
 					return false;
 				}
 
@@ -120,14 +151,14 @@ namespace
 				std::ofstream file(testFile, std::ios::trunc | std::ios::binary);
 				if (!file.good())
 				{
-					m_ValidationMessage = mh::format("Filesystem error when trying to create {}", testFile);
+					result.m_Message = mh::format("Filesystem error when trying to create {}", testFile);
 					return;
 				}
 
 				file << "hello world permissions test" << std::flush;
 				if (!file.good())
 				{
-					m_ValidationMessage = mh::format("Filesystem error when writing to {}", testFile);
+					result.m_Message = mh::format("Filesystem error when writing to {}", testFile);
 					return;
 				}
 			}
@@ -135,13 +166,13 @@ namespace
 			if (!DeleteFile())
 				return;
 
-			m_ValidationMessage = "Validation success";
-			m_ValidationState = ValidationState::ValidationSuccess;
+			result.m_Message = "Validation success";
+			result.m_State = ValidationState::ValidationSuccess;
 		}
 		catch (const std::exception& e)
 		{
 			LogException(MH_SOURCE_LOCATION_CURRENT(), e);
-			m_ValidationMessage = mh::format("Exception: {}: {}\n\nPlease report this issue if possible.",
+			result.m_Message = mh::format("Exception: {}: {}\n\nPlease report this issue if possible.",
 				typeid(e).name(), e.what());
 		}
 	};
@@ -161,6 +192,8 @@ auto PermissionsCheckPage::ValidateSettings(const Settings& settings) const -> V
 		LogError(MH_SOURCE_LOCATION_CURRENT(), "Unknown {}", mh::enum_fmt(m_ValidationState));
 
 	case ValidationState::Unvalidated:
+		return ValidateSettingsResult::Pending;
+
 	case ValidationState::ValidationFailure:
 		return ValidateSettingsResult::TriggerOpen;
 
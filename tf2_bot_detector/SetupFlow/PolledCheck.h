@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Clock.h"
+#include "ISetupFlowPage.h"
+#include "Util/TaskScheduler.h"
+
+#include <mh/coroutine/task.hpp>
+
+#include <functional>
+#include <optional>
+
+namespace tf2_bot_detector
+{
+	// Re-runs a slow check on the IO lane no more than once per interval, keeping the
+	// last result around so ValidateSettings() can read it without blocking.
+	template<typename T>
+	class PolledCheck final
+	{
+	public:
+		PolledCheck(duration_t interval, std::function<T()> check) :
+			m_Interval(interval), m_Check(std::move(check))
+		{
+		}
+
+		void Update()
+		{
+			if (m_Task.is_ready())
+			{
+				m_Value = m_Task.get();
+				m_Task = {};
+			}
+
+			const auto curTime = tfbd_clock_t::now();
+			if (!m_Task.valid() && curTime >= (m_LastStartTime + m_Interval))
+			{
+				m_Task = RunAsync(m_Check);
+				m_LastStartTime = curTime;
+			}
+		}
+
+		// Empty until the first check finishes
+		const std::optional<T>& GetValue() const { return m_Value; }
+
+	private:
+		static mh::task<T> RunAsync(std::function<T()> check)
+		{
+			co_await TaskScheduler::Get().co_schedule(TaskLane::IO, TaskPriority::High);
+			co_return check();
+		}
+
+		duration_t m_Interval;
+		std::function<T()> m_Check;
+		mh::task<T> m_Task;
+		std::optional<T> m_Value;
+		time_point_t m_LastStartTime{};
+	};
+}
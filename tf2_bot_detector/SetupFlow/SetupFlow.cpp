@@ -52,24 +52,48 @@ SetupFlow::SetupFlow()
 		});
 }
 
-bool SetupFlow::OnUpdate(const Settings& settings)
+bool SetupFlow::OnUpdate(const ISetupFlowPage::UpdateState& us)
 {
+	for (const auto& page : m_Pages)
+		page->Update(us);
+
 	if (ShouldDraw())
 		return true;
 
 	size_t pageIndex = INVALID_PAGE;
 	bool dummy;
-	GetPageState(settings, pageIndex, dummy);
-	return m_ShouldDraw = pageIndex != INVALID_PAGE;
+	bool isWaiting;
+	GetPageState(us.m_Settings, pageIndex, dummy, isWaiting);
+	return m_ShouldDraw = (pageIndex != INVALID_PAGE || isWaiting);
 }
 
-void SetupFlow::GetPageState(const Settings& settings, size_t& currentPage, bool& hasNextPage) const
+void SetupFlow::GetPageState(const Settings& settings, size_t& currentPage, bool& hasNextPage, bool& isWaiting) const
 {
 	hasNextPage = false;
+	isWaiting = false;
 
 	for (size_t i = 0; i < m_Pages.size(); i++)
 	{
-		if (m_Pages[i]->ValidateSettings(settings) != ISetupFlowPage::ValidateSettingsResult::TriggerOpen)
+		const auto result = m_Pages[i]->ValidateSettings(settings);
+		if (result == ISetupFlowPage::ValidateSettingsResult::Pending)
+		{
+			if (currentPage == INVALID_PAGE)
+			{
+				// Can't tell what comes first until this finishes
+				isWaiting = true;
+				return;
+			}
+
+			if (i > currentPage)
+			{
+				hasNextPage = true;
+				return;
+			}
+
+			continue;
+		}
+
+		if (result != ISetupFlowPage::ValidateSettingsResult::TriggerOpen)
 			continue;
 
 		if (currentPage == INVALID_PAGE || i < currentPage)
@@ -89,8 +113,16 @@ bool SetupFlow::OnDraw(Settings& settings, const ISetupFlowPage::DrawState& ds)
 		return false;
 
 	bool hasNextPage = false;
+	bool isWaiting = false;
 	const auto lastPage = m_ActivePage;
-	GetPageState(settings, m_ActivePage, hasNextPage);
+	GetPageState(settings, m_ActivePage, hasNextPage, isWaiting);
+
+	if (isWaiting)
+	{
+		ImGui::NewLine();
+		ImGui::TextFmt("Checking your setup..."sv);
+		return true;
+	}
 
 	bool drewPage = false;
 	if (m_ActivePage != INVALID_PAGE)
@@ -15,7 +15,7 @@ namespace tf2_bot_detector
 		SetupFlow();
 
 		// Returns true if the setup flow needs to draw.
-		[[nodiscard]] bool OnUpdate(const Settings& settings);
+		[[nodiscard]] bool OnUpdate(const ISetupFlowPage::UpdateState& us);
 		[[nodiscard]] bool OnDraw(Settings& settings, const ISetupFlowPage::DrawState& ds);
 
 		bool ShouldDraw() const { return m_ShouldDraw; }
@@ -26,7 +26,8 @@ namespace tf2_bot_detector
 		bool m_ShouldDraw = false;
 		std::vector<std::unique_ptr<ISetupFlowPage>> m_Pages;
 
-		void GetPageState(const Settings& settings, size_t& currentPage, bool& hasNextPage) const;
+		// isWaiting is set if nothing is open yet and the first page that isn't done is still Pending
+		void GetPageState(const Settings& settings, size_t& currentPage, bool& hasNextPage, bool& isWaiting) const;
 
 		static constexpr size_t INVALID_PAGE = size_t(-1);
 		size_t m_ActivePage = INVALID_PAGE;
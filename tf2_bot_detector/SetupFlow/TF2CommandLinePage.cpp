@@ -3,6 +3,8 @@
 #include "Platform/Platform.h"
 #include "UI/ImGui_TF2BotDetector.h"
 #include "Log.h"
+#include "Util/StartupTimeline.h"
+#include "Util/TaskScheduler.h"
 #include "Util/TextUtils.h"
 
 #include <mh/future.hpp>
@@ -39,6 +41,14 @@ static std::string GenerateRandomRCONPassword(size_t length = 16)
 	return retVal;
 }
 
+static mh::task<std::vector<std::string>> GetTF2CommandLineArgsInBackground()
+{
+	// The WMI connection setup is synchronous
+	co_await TaskScheduler::Get().co_schedule(TaskLane::IO, TaskPriority::High);
+	TF2BD_STARTUP_PHASE("GetTF2CommandLineArgsAsync");
+	co_return co_await Processes::GetTF2CommandLineArgsAsync();
+}
+
 void TF2CommandLinePage::Data::TryUpdateCmdlineArgs()
 {
 	if (m_CommandLineArgsTask.is_ready())
@@ -61,10 +71,13 @@ void TF2CommandLinePage::Data::TryUpdateCmdlineArgs()
 	{
 		// See about starting a new update
 
+		// The command line can't change without TF2 restarting
 		const auto curTime = clock_t::now();
-		if (!m_AtLeastOneUpdateRun || (curTime >= (m_LastCLUpdate + CL_UPDATE_INTERVAL)))
+		if (!m_AtLeastOneUpdateRun || ((curTime >= (m_LastCLUpdate + CL_UPDATE_INTERVAL)) &&
+			Processes::GetProcessChangeCount() != m_LastProcessChangeCount))
 		{
-			m_CommandLineArgsTask = Processes::GetTF2CommandLineArgsAsync();
+			m_LastProcessChangeCount = Processes::GetProcessChangeCount();
+			m_CommandLineArgsTask = GetTF2CommandLineArgsInBackground();
 			m_LastCLUpdate = curTime;
 		}
 	}
@@ -80,6 +93,12 @@ auto TF2CommandLinePage::ValidateSettings(const Settings& settings) const -> Val
 	return ValidateSettingsResult::Success;
 }
 
+void TF2CommandLinePage::Update(const UpdateState& us)
+{
+	if (!m_HasBeenOpened && !m_Data.m_AtLeastOneUpdateRun && Processes::IsTF2Running())
+		m_Data.TryUpdateCmdlineArgs();
+}
+
 auto TF2CommandLinePage::TF2CommandLine::Parse(const std::string_view& cmdLine) -> TF2CommandLine
 {
 	const auto args = Shell::SplitCommandLineArgs(cmdLine);
@@ -443,7 +462,22 @@ auto TF2CommandLinePage::OnDraw(const DrawState& ds) -> OnDrawResult
 
 void TF2CommandLinePage::Init(const InitState& is)
 {
-	m_Data = {};
+	if (m_HasBeenOpened)
+	{
+		m_Data = {};
+		return;
+	}
+
+	// Keep what Update() fetched, the rest starts fresh
+	Data data;
+	data.m_MultipleInstances = m_Data.m_MultipleInstances;
+	data.m_CommandLineArgs = std::move(m_Data.m_CommandLineArgs);
+	data.m_CommandLineArgsTask = std::move(m_Data.m_CommandLineArgsTask);
+	data.m_AtLeastOneUpdateRun = m_Data.m_AtLeastOneUpdateRun;
+	data.m_LastCLUpdate = m_Data.m_LastCLUpdate;
+	data.m_LastProcessChangeCount = m_Data.m_LastProcessChangeCount;
+	m_Data = std::move(data);
+	m_HasBeenOpened = true;
 }
 
 void TF2CommandLinePage::Commit(const CommitState& cs)
@@ -18,6 +18,7 @@ namespace tf2_bot_detector
 	{
 	public:
 		ValidateSettingsResult ValidateSettings(const Settings& settings) const override;
+		void Update(const UpdateState& us) override;
 		OnDrawResult OnDraw(const DrawState& ds) override;
 
 		void Init(const InitState& is) override;
@@ -28,9 +29,6 @@ namespace tf2_bot_detector
 		bool WantsContinueButton() const override { return false; }
 		SetupFlowPage GetPage() const override { return SetupFlowPage::TF2CommandLine; }
 
-	private:
-		static constexpr duration_t CL_UPDATE_INTERVAL = std::chrono::seconds(1);
-
 		struct TF2CommandLine
 		{
 			static TF2CommandLine Parse(const std::string_view& cmdLine);
@@ -45,6 +43,9 @@ namespace tf2_bot_detector
 			bool IsPopulated() const;
 		};
 
+	private:
+		static constexpr duration_t CL_UPDATE_INTERVAL = std::chrono::seconds(1);
+
 		void DrawAutoLaunchTF2Checkbox(const DrawState& ds);
 		void DrawLaunchTF2Button(const DrawState& ds);
 		void DrawCommandLineArgsInvalid(const DrawState& ds, const TF2CommandLine& args);
@@ -67,6 +68,10 @@ namespace tf2_bot_detector
 		// tf2 auto-relaunching the moment they close the game.
 		bool m_IsAutoLaunchAllowed = true;
 
+		// Until the page is first opened, Update() fetches the command line in the background so
+		// it's ready by the time we get here
+		bool m_HasBeenOpened = false;
+
 		struct Data
 		{
 			time_point_t m_LastTF2LaunchTime{};
@@ -77,6 +82,7 @@ namespace tf2_bot_detector
 			bool m_AtLeastOneUpdateRun = false;
 
 			time_point_t m_LastCLUpdate{};
+			uint64_t m_LastProcessChangeCount = 0;
 
 			std::string m_RandomRCONPassword;
 			uint16_t m_RandomRCONPort;
@@ -17,6 +17,7 @@ namespace
 	{
 	public:
 		ValidateSettingsResult ValidateSettings(const Settings& settings) const override;
+		void Update(const UpdateState& us) override;
 		OnDrawResult OnDraw(const DrawState& ds) override;
 		void Init(const InitState& is) override;
 
@@ -32,6 +33,7 @@ namespace
 		bool m_HasChangedReleaseChannel = false;
 		bool m_UpdateButtonPressed = false;
 		bool m_DrawnOnce = false;
+		bool m_SkippedOnce = false; // The rest of the setup flow went ahead without us
 	};
 
 	auto UpdateCheckPage::ValidateSettings(const Settings& settings) const -> ValidateSettingsResult
@@ -46,13 +48,20 @@ namespace
 		case UpdateStatus::Unknown:
 		case UpdateStatus::CheckQueued:
 		case UpdateStatus::Checking:
+		{
+			// Nothing cached from last time to go on. Not worth holding up the scoreboard on a slow
+			// connection, if there is something newer it goes to the log and the help menu instead.
+			return ValidateSettingsResult::Success;
+		}
+
 		case UpdateStatus::UpdateAvailable:
 		case UpdateStatus::UpdateToolRequired:
 		case UpdateStatus::UpdateToolDownloading:
 		case UpdateStatus::Downloading:
 		case UpdateStatus::Updating:
 		{
-			if (m_DrawnOnce)
+			// Popping up in the middle of a match is worse than waiting for the next startup
+			if (m_DrawnOnce || m_SkippedOnce)
 				return ValidateSettingsResult::Success;
 			else
 				return ValidateSettingsResult::TriggerOpen;
@@ -76,6 +85,20 @@ namespace
 		return ValidateSettingsResult::Success;
 	}
 
+	void UpdateCheckPage::Update(const UpdateState& us)
+	{
+		if (us.m_UpdateManager && !m_StatusReader.has_value())
+			m_StatusReader = us.m_UpdateManager->GetUpdateStatus();
+
+		// Anything found after this was found by a background check
+		if (m_StatusReader.has_value() && !m_DrawnOnce && !mh::any_eq(m_StatusReader.get().m_Status,
+			UpdateStatus::UpdateAvailable, UpdateStatus::UpdateToolRequired, UpdateStatus::UpdateToolDownloading,
+			UpdateStatus::Downloading, UpdateStatus::Updating))
+		{
+			m_SkippedOnce = true;
+		}
+	}
+
 	auto UpdateCheckPage::OnDraw(const DrawState& ds) -> OnDrawResult
 	{
 		if (!m_StatusReader.has_value())
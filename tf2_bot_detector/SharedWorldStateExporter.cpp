@@ -0,0 +1,125 @@
+#include "SharedWorldStateExporter.h"
+#include "Config/PlayerListJSON.h"
+#include "Config/Settings.h"
+#include "Platform/Platform.h"
+#include "Log.h"
+#include "ModeratorLogic.h"
+#include "WorldSnapshot.h"
+#include "WorldState.h"
+
+#include <algorithm>
+#include <new>
+
+using namespace tf2_bot_detector;
+
+static void CopyName(char (&dst)[SharedWorldState::MAX_NAME_LENGTH], const std::string_view& src)
+{
+	size_t length = std::min(src.size(), std::size(dst) - 1);
+
+	// Don't cut a code point in half
+	if (length < src.size())
+	{
+		while (length > 0 && (uint8_t(src[length]) & 0xC0) == 0x80)
+			length--;
+	}
+
+	std::memcpy(dst, src.data(), length);
+	dst[length] = '\0';
+}
+
+SharedWorldStateExporter::SharedWorldStateExporter(const IWorldState& world, const IModeratorLogic& modLogic,
+	const Settings& settings, std::string regionName) :
+	m_World(&world),
+	m_ModLogic(&modLogic),
+	m_Settings(&settings),
+	m_RegionName(std::move(regionName))
+{
+}
+
+void SharedWorldStateExporter::Update()
+{
+	if (!m_Settings->m_ExportSharedWorldState)
+	{
+		// Readers see the region disappear instead of going stale
+		m_Region = nullptr;
+		m_Mapping.reset();
+		m_CreateFailed = false;
+		return;
+	}
+
+	if (!m_Region)
+	{
+		if (m_CreateFailed)
+			return;
+
+		try
+		{
+			m_Mapping = Platform::CreateSharedMemory(m_RegionName, sizeof(SharedWorldState::Region));
+		}
+		catch (const std::exception& e)
+		{
+			LogException(MH_SOURCE_LOCATION_CURRENT(), e, "Failed to create shared memory region {}", m_RegionName);
+			m_CreateFailed = true;
+			return;
+		}
+
+		m_Region = new (m_Mapping.get()) SharedWorldState::Region{};
+		m_Region->m_LayoutVersion = SharedWorldState::LAYOUT_VERSION;
+		m_Region->m_Size = sizeof(SharedWorldState::Region);
+		m_Region->m_Magic = SharedWorldState::MAGIC;
+
+		m_LastWorldVersion = 0;
+		DebugLog("Exporting world state to shared memory region {}", m_RegionName);
+	}
+
+	const auto snapshot = m_World->GetWorldSnapshot();
+	if (!snapshot)
+		return;
+
+	const auto now = FrameClock::Now();
+	if (snapshot->m_Version == m_LastWorldVersion && (now - m_LastWriteTime) < MARKS_REFRESH_INTERVAL)
+		return;
+
+	if (!m_Data)
+		m_Data = std::make_unique<SharedWorldState::Data>();
+
+	auto& data = *m_Data;
+	data.m_WorldVersion = snapshot->m_Version;
+	data.m_UpdateTimeUnixMS = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+	data.m_LocalSteamID = m_Settings->GetLocalSteamID().ID64;
+	data.m_PlayerCount = 0;
+	data.m_Reserved = 0;
+
+	for (const auto& player : snapshot->m_Players)
+	{
+		if (data.m_PlayerCount >= SharedWorldState::MAX_PLAYERS)
+			break;
+
+		auto& dst = data.m_Players[data.m_PlayerCount++];
+		dst = {};
+		dst.m_SteamID = player.m_Status.m_SteamID.ID64;
+		CopyName(dst.m_Name, player.m_Status.m_Name);
+		dst.m_UserID = player.m_Status.m_UserID;
+		dst.m_Ping = player.m_Status.m_Ping;
+		dst.m_Kills = player.m_Scores.m_Kills;
+		dst.m_Deaths = player.m_Scores.m_Deaths;
+		dst.m_Loss = player.m_Status.m_Loss;
+		dst.m_Team = uint8_t(player.m_Team);
+		dst.m_State = uint8_t(player.m_Status.m_State);
+		dst.m_ClientIndex = player.m_ClientIndex;
+
+		PlayerAttributesList attributes;
+		for (const auto& mark : m_ModLogic->GetPlayerAttributes(player.m_Status.m_SteamID))
+			attributes |= mark.m_Attributes;
+
+		for (size_t i = 0; i < PlayerAttributesList::size(); i++)
+		{
+			if (attributes.HasAttribute(PlayerAttribute(i)))
+				dst.m_Marks |= uint32_t(1) << i;
+		}
+	}
+
+	SharedWorldState::Write(*m_Region, data);
+	m_LastWorldVersion = snapshot->m_Version;
+	m_LastWriteTime = now;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Clock.h"
+#include "SharedWorldStateLayout.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace tf2_bot_detector
+{
+	class IModeratorLogic;
+	class IWorldState;
+	class Settings;
+
+	// Copies the players, teams, scores and marks into a named shared memory region (see
+	// SharedWorldStateLayout.h) whenever a new WorldSnapshot is published, while
+	// Settings::m_ExportSharedWorldState is enabled.
+	class SharedWorldStateExporter final
+	{
+	public:
+		SharedWorldStateExporter(const IWorldState& world, const IModeratorLogic& modLogic, const Settings& settings,
+			std::string regionName = SharedWorldState::REGION_NAME);
+
+		void Update();
+
+	private:
+		// Marks change without a new snapshot being published
+		static constexpr duration_t MARKS_REFRESH_INTERVAL = std::chrono::seconds(1);
+
+		const IWorldState* m_World = nullptr;
+		const IModeratorLogic* m_ModLogic = nullptr;
+		const Settings* m_Settings = nullptr;
+		std::string m_RegionName;
+
+		std::shared_ptr<void> m_Mapping;
+		SharedWorldState::Region* m_Region = nullptr;
+		bool m_CreateFailed = false;  // Don't spam the log every frame
+
+		uint64_t m_LastWorldVersion = 0;
+		time_point_t m_LastWriteTime{};
+		std::unique_ptr<SharedWorldState::Data> m_Data;  // Too big for the stack
+	};
+}
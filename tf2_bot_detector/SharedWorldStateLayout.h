@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// The layout of the shared memory region SharedWorldStateExporter writes to, for overlays and
+// other tools that want to know who is on the server without scraping our logs. Only depends on
+// the standard library so it can be copied into other projects as is.
+//
+// On Windows the region is a named file mapping, "Local\" + REGION_NAME (with "_<n>" appended
+// for every headless session after the first). Open it with OpenFileMappingW(FILE_MAP_READ) and
+// call TryRead() on the view until it returns true.
+namespace tf2_bot_detector::SharedWorldState
+{
+	inline constexpr char REGION_NAME[] = "tf2_bot_detector_world_state";
+	inline constexpr uint32_t MAGIC = 0x44424654;  // "TFBD"
+	inline constexpr uint32_t LAYOUT_VERSION = 1;  // Goes up whenever anything below changes
+	inline constexpr uint32_t MAX_PLAYERS = 128;
+	inline constexpr uint32_t MAX_NAME_LENGTH = 128;  // Including the null terminator
+
+	struct Player
+	{
+		uint64_t m_SteamID;
+		char m_Name[MAX_NAME_LENGTH];  // UTF-8, null terminated, truncated at a code point boundary
+		uint16_t m_UserID;
+		uint16_t m_Ping;
+		uint16_t m_Kills;
+		uint16_t m_Deaths;
+		uint8_t m_Loss;
+		uint8_t m_Team;         // TFTeam: 0 unknown, 1 spectator, 2 red, 3 blue
+		uint8_t m_State;        // PlayerStatusState: 0 invalid, 1 challenging, 2 connecting, 3 spawning, 4 active
+		uint8_t m_ClientIndex;
+		uint32_t m_Marks;       // Bit n is set if the player is marked with PlayerAttribute n
+	};
+	static_assert(sizeof(Player) == 152);
+
+	struct Data
+	{
+		uint64_t m_WorldVersion;      // WorldSnapshot::m_Version this was written from
+		int64_t m_UpdateTimeUnixMS;   // When this was written
+		uint64_t m_LocalSteamID;
+		uint32_t m_PlayerCount;       // Only the first m_PlayerCount entries of m_Players are valid
+		uint32_t m_Reserved;
+		Player m_Players[MAX_PLAYERS];
+	};
+	static_assert(sizeof(Data) == 32 + sizeof(Player) * MAX_PLAYERS);
+
+	struct Region
+	{
+		// Written once, before anything else
+		uint32_t m_Magic;
+		uint32_t m_LayoutVersion;
+		uint32_t m_Size;  // sizeof(Region)
+
+		// Seqlock around m_Data: odd while it's being written, goes up by two with every write
+		std::atomic<uint32_t> m_Sequence;
+
+		Data m_Data;
+	};
+	static_assert(std::atomic<uint32_t>::is_always_lock_free);
+	static_assert(sizeof(Region) == 16 + sizeof(Data));
+
+	// Only ever called by the one process that created the region
+	inline void Write(Region& region, const Data& data)
+	{
+		const uint32_t sequence = region.m_Sequence.load(std::memory_order_relaxed);
+		region.m_Sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		std::memcpy(&region.m_Data, &data, sizeof(data));
+
+		region.m_Sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	// Returns false if the region is from a different layout version, or it was being written
+	// while we were copying it. Try again later in either case.
+	inline bool TryRead(const Region& region, Data& data)
+	{
+		if (region.m_Magic != MAGIC || region.m_LayoutVersion != LAYOUT_VERSION || region.m_Size != sizeof(Region))
+			return false;
+
+		const uint32_t before = region.m_Sequence.load(std::memory_order_acquire);
+		if (before & 1)
+			return false;
+
+		std::memcpy(&data, &region.m_Data, sizeof(data));
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return region.m_Sequence.load(std::memory_order_relaxed) == before;
+	}
+}
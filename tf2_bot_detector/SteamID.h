@@ -4,6 +4,7 @@
 
 #include <cassert>
 #include <compare>
+#include <cstdint>
 #include <functional>
 #include <iosfwd>
 #include <string_view>
@@ -42,10 +43,177 @@ namespace tf2_bot_detector
 		Web = (1 << 2),
 	};
 
+	enum class SteamIDParseError : uint8_t
+	{
+		None,
+		UnknownFormat,
+		UnknownAccountType,      // Steam3
+		IDOutOfRange,            // Steam3
+		InstanceOutOfRange,      // Steam3
+		ID64OutOfRange,          // Steam64
+	};
+
+	struct SteamIDParseResult
+	{
+		uint64_t m_ID64 = 0;
+		SteamIDParseError m_Error = SteamIDParseError::None;
+		char m_AccountTypeChar = 0; // Set for UnknownAccountType
+	};
+
+	namespace detail::SteamID_h
+	{
+		inline constexpr bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+		inline constexpr bool IsSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+		inline constexpr bool IsAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+
+		// Parses leading digits. False if there aren't any, or they don't fit.
+		template<typename T>
+		inline constexpr bool ParseDigits(const std::string_view& str, size_t& pos, T& value)
+		{
+			const size_t begin = pos;
+			value = 0;
+			for (; pos < str.size() && IsDigit(str[pos]); pos++)
+			{
+				const T digit = T(str[pos] - '0');
+				if (value > (T(-1) - digit) / 10)
+					return false;
+
+				value = value * 10 + digit;
+			}
+
+			return pos > begin;
+		}
+
+		// Same layout as the SteamID bitfields
+		inline constexpr uint64_t MakeID64(uint32_t id, uint32_t instance, uint32_t type, uint32_t universe)
+		{
+			return uint64_t(id) | (uint64_t(instance & 0xFFFFF) << 32) | (uint64_t(type & 0xF) << 52) |
+				(uint64_t(universe & 0xFF) << 56);
+		}
+
+		inline constexpr SteamIDParseResult ParseSteam3(const std::string_view& str)
+		{
+			// \[([a-zA-Z]):(\d):(\d+)(?::(\d+))?\]
+			if (str.size() < 7 || str.front() != '[' || str.back() != ']' || !IsAlpha(str[1]) || str[2] != ':' ||
+				!IsDigit(str[3]) || str[4] != ':' || !IsDigit(str[5]))
+			{
+				return { .m_Error = SteamIDParseError::UnknownFormat };
+			}
+
+			// Everything up to the closing ] has to fit the pattern before we start complaining about values
+			size_t pos = 5;
+			while (IsDigit(str[pos]))
+				pos++;
+
+			const size_t idEnd = pos;
+			if (str[pos] == ':')
+			{
+				pos++;
+				if (!IsDigit(str[pos]))
+					return { .m_Error = SteamIDParseError::UnknownFormat };
+
+				while (IsDigit(str[pos]))
+					pos++;
+			}
+
+			if (pos != str.size() - 1)
+				return { .m_Error = SteamIDParseError::UnknownFormat };
+
+			uint32_t type;
+			switch (str[1])
+			{
+			case 'U': type = uint32_t(SteamAccountType::Individual); break;
+			case 'M': type = uint32_t(SteamAccountType::Multiseat); break;
+			case 'G': type = uint32_t(SteamAccountType::GameServer); break;
+			case 'A': type = uint32_t(SteamAccountType::AnonGameServer); break;
+			case 'P': type = uint32_t(SteamAccountType::Pending); break;
+			case 'C': type = uint32_t(SteamAccountType::ContentServer); break;
+			case 'g': type = uint32_t(SteamAccountType::Clan); break;
+			case 'a': type = uint32_t(SteamAccountType::AnonUser); break;
+
+			case 'T':
+			case 'L':
+			case 'c':
+				type = uint32_t(SteamAccountType::Chat); break;
+
+			case 'I':
+				return {}; // Invalid, nothing else matters
+
+			default:
+				return { .m_Error = SteamIDParseError::UnknownAccountType, .m_AccountTypeChar = str[1] };
+			}
+
+			const uint32_t universe = uint32_t(str[3] - '0');
+
+			uint32_t id;
+			pos = 5;
+			if (!ParseDigits(str, pos, id))
+				return { .m_Error = SteamIDParseError::IDOutOfRange };
+
+			uint32_t instance = uint32_t(SteamAccountInstance::Desktop);
+			if (idEnd != str.size() - 1)
+			{
+				pos = idEnd + 1;
+				if (!ParseDigits(str, pos, instance))
+					return { .m_Error = SteamIDParseError::InstanceOutOfRange };
+			}
+
+			return { .m_ID64 = MakeID64(id, instance, type, universe) };
+		}
+
+		inline constexpr SteamIDParseResult ParseSteam64(const std::string_view& str)
+		{
+			for (char c : str)
+			{
+				if (!IsDigit(c) && !IsSpace(c))
+					return { .m_Error = SteamIDParseError::UnknownFormat };
+			}
+
+			// Trailing whitespace (and anything after it) is ignored, leading whitespace isn't allowed
+			uint64_t id64;
+			size_t pos = 0;
+			if (!ParseDigits(str, pos, id64))
+				return { .m_Error = SteamIDParseError::ID64OutOfRange };
+
+			return { .m_ID64 = id64 };
+		}
+	}
+
+	// Steam3 ([U:1:123], optionally with an instance: [U:1:123:1]) or Steam64 (7656...) without
+	// any allocations or regexes
+	inline constexpr SteamIDParseResult ParseSteamID(const std::string_view& str)
+	{
+		using namespace detail::SteamID_h;
+
+		// Nearly everything we see is an individual in the public universe
+		if (str.size() > 6 && str.starts_with("[U:1:") && str.back() == ']')
+		{
+			uint32_t id;
+			size_t pos = 5;
+			if (ParseDigits(str, pos, id) && pos == str.size() - 1)
+			{
+				return { .m_ID64 = MakeID64(id, uint32_t(SteamAccountInstance::Desktop),
+					uint32_t(SteamAccountType::Individual), uint32_t(SteamAccountUniverse::Public)) };
+			}
+		}
+
+		if (!str.empty() && str.front() == '[')
+		{
+			if (auto result = ParseSteam3(str); result.m_Error != SteamIDParseError::UnknownFormat)
+				return result;
+		}
+
+		if (auto result = ParseSteam64(str); result.m_Error != SteamIDParseError::UnknownFormat)
+			return result;
+
+		return { .m_Error = SteamIDParseError::UnknownFormat };
+	}
+
 	class SteamID final
 	{
 	public:
 		constexpr SteamID() = default;
+		// Throws std::invalid_argument if str isn't a valid Steam3 or Steam64 ID. See ParseSteamID().
 		explicit SteamID(const std::string_view& str);
 		explicit constexpr SteamID(uint64_t id64) : ID64(id64) {}
 		explicit constexpr SteamID(uint32_t id, SteamAccountType type, SteamAccountUniverse universe = SteamAccountUniverse::Public,
@@ -0,0 +1,77 @@
+#include "Util/BinaryPatch.h"
+
+#include <catch2/catch.hpp>
+
+using namespace std::string_view_literals;
+using namespace tf2_bot_detector;
+
+namespace
+{
+	class PatchBuilder final
+	{
+	public:
+		explicit PatchBuilder(uint64_t targetSize)
+		{
+			m_Patch.append(BINARY_PATCH_MAGIC, sizeof(BINARY_PATCH_MAGIC));
+			AddUInt64(targetSize);
+		}
+
+		PatchBuilder& Copy(uint64_t offset, uint64_t length)
+		{
+			m_Patch.push_back(char(BinaryPatchOp::Copy));
+			AddUInt64(offset);
+			AddUInt64(length);
+			return *this;
+		}
+		PatchBuilder& Insert(const std::string_view& bytes)
+		{
+			m_Patch.push_back(char(BinaryPatchOp::Insert));
+			AddUInt64(bytes.size());
+			m_Patch.append(bytes);
+			return *this;
+		}
+
+		const std::string& str() const { return m_Patch; }
+
+	private:
+		void AddUInt64(uint64_t value)
+		{
+			for (size_t i = 0; i < 8; i++)
+				m_Patch.push_back(char(uint8_t(value >> (i * 8))));
+		}
+
+		std::string m_Patch;
+	};
+}
+
+TEST_CASE("tf2bd_binary_patch", "[tf2bd]")
+{
+	constexpr std::string_view SOURCE = "The quick brown fox jumps over the lazy dog";
+
+	REQUIRE(ApplyBinaryPatch(SOURCE, PatchBuilder(0).str()) == "");
+	REQUIRE(ApplyBinaryPatch(SOURCE, PatchBuilder(SOURCE.size()).Copy(0, SOURCE.size()).str()) == SOURCE);
+
+	REQUIRE(ApplyBinaryPatch(SOURCE, PatchBuilder(39)
+		.Copy(0, 10).Insert("red").Copy(15, 20).Insert("sleepy").str()) == "The quick red fox jumps over the sleepy");
+
+	// Binary safe
+	REQUIRE(ApplyBinaryPatch(""sv, PatchBuilder(3).Insert("\0\xff\0"sv).str()) == "\0\xff\0"sv);
+
+	SECTION("Malformed patches")
+	{
+		REQUIRE_THROWS(ApplyBinaryPatch(SOURCE, ""));
+		REQUIRE_THROWS(ApplyBinaryPatch(SOURCE, "TFBDPAT2\0\0\0\0\0\0\0\0"sv));
+
+		// Copying from outside the source
+		REQUIRE_THROWS(ApplyBinaryPatch(SOURCE, PatchBuilder(1).Copy(SOURCE.size(), 1).str()));
+		REQUIRE_THROWS(ApplyBinaryPatch(SOURCE, PatchBuilder(2).Copy(1, uint64_t(-1)).str()));
+
+		// Wrong target size
+		REQUIRE_THROWS(ApplyBinaryPatch(SOURCE, PatchBuilder(4).Insert("abc").str()));
+		REQUIRE_THROWS(ApplyBinaryPatch(SOURCE, PatchBuilder(2).Insert("abc").str()));
+
+		// Truncated
+		REQUIRE_THROWS(ApplyBinaryPatch(SOURCE, PatchBuilder(3).Insert("abc").str().substr(0, 20)));
+		REQUIRE_THROWS(ApplyBinaryPatch(SOURCE, PatchBuilder(1).str() + char(7)));
+	}
+}
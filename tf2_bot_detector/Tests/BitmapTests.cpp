@@ -0,0 +1,73 @@
+#include "Bitmap.h"
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_bitmap_convert", "[tf2bd]")
+{
+	// Odd sizes, so both the vectorized part and what's left over get used
+	for (size_t count : { 1, 3, 4, 5, 16, 17, 33 })
+	{
+		std::vector<uint8_t> rgb(count * 3);
+		for (size_t i = 0; i < rgb.size(); i++)
+			rgb[i] = uint8_t(i * 7 + 1);
+
+		std::vector<uint8_t> rgba(count * 4);
+		Bitmap::ConvertPixels(rgb.data(), 3, rgba.data(), 4, count);
+		for (size_t i = 0; i < count; i++)
+		{
+			REQUIRE(rgba[i * 4 + 0] == rgb[i * 3 + 0]);
+			REQUIRE(rgba[i * 4 + 1] == rgb[i * 3 + 1]);
+			REQUIRE(rgba[i * 4 + 2] == rgb[i * 3 + 2]);
+			REQUIRE(rgba[i * 4 + 3] == 255);
+		}
+
+		std::vector<uint8_t> gray(count);
+		for (size_t i = 0; i < count; i++)
+			gray[i] = uint8_t(i * 13);
+
+		Bitmap::ConvertPixels(gray.data(), 1, rgba.data(), 4, count);
+		for (size_t i = 0; i < count; i++)
+		{
+			REQUIRE(rgba[i * 4 + 0] == gray[i]);
+			REQUIRE(rgba[i * 4 + 2] == gray[i]);
+			REQUIRE(rgba[i * 4 + 3] == 255);
+		}
+	}
+}
+
+TEST_CASE("tf2bd_bitmap_resize", "[tf2bd]")
+{
+	Bitmap bitmap(4, 4, 4);
+	auto* pixels = static_cast<uint8_t*>(bitmap.GetData());
+	for (size_t i = 0; i < bitmap.GetDataSize(); i++)
+		pixels[i] = uint8_t(i * 4);
+
+	// Box: every 2x2 block averaged
+	const Bitmap half = bitmap.Resize(2, 2);
+	const auto* halfPixels = static_cast<const uint8_t*>(half.GetData());
+	REQUIRE(half.GetWidth() == 2);
+	REQUIRE(half.GetChannelCount() == 4);
+	REQUIRE(halfPixels[0] == (0 + 16 + 64 + 80) / 4);
+	REQUIRE(halfPixels[15] == (172 + 188 + 236 + 252) / 4);
+
+	// Bilinear, the 4 channel fast path has to match the generic one
+	const Bitmap rgb = bitmap.ConvertChannels(3);
+	const Bitmap scaledRGBA = bitmap.Resize(3, 3);
+	const Bitmap scaledRGB = rgb.Resize(3, 3);
+	const auto* rgbaOut = static_cast<const uint8_t*>(scaledRGBA.GetData());
+	const auto* rgbOut = static_cast<const uint8_t*>(scaledRGB.GetData());
+	for (size_t i = 0; i < 9; i++)
+	{
+		for (size_t c = 0; c < 3; c++)
+			REQUIRE(rgbaOut[i * 4 + c] == rgbOut[i * 3 + c]);
+	}
+
+	// Corners stay where they are
+	const Bitmap doubled = bitmap.Resize(8, 8);
+	REQUIRE(static_cast<const uint8_t*>(doubled.GetData())[0] == pixels[0]);
+	REQUIRE(static_cast<const uint8_t*>(doubled.GetData())[doubled.GetDataSize() - 1] == pixels[bitmap.GetDataSize() - 1]);
+}
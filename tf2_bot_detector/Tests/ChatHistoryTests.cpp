@@ -0,0 +1,80 @@
+#include "ConsoleLog/ChatHistory.h"
+
+#include <catch2/catch.hpp>
+#include <mh/text/format.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_chat_history", "[tf2bd]")
+{
+	ChatHistory history;
+	const time_point_t now = tfbd_clock_t::now();
+	const SteamID bot(1118537734, SteamAccountType::Individual);
+
+	history.Add(now, SteamID(89344206, SteamAccountType::Individual), InternedString("Forsaken Pyro"), "gg", false, false);
+	history.Add(now, bot, InternedString("MYG)T"), "Join our DISCORD at bots . tf", false, true);
+	history.Add(now, SteamID{}, InternedString("ghost"), "what discord?", true, false);
+	history.Add(now, bot, InternedString("MYG)T"), "jоin оur discоrd", false, false); // Cyrillic o
+
+	REQUIRE(history.size() == 4);
+	{
+		const auto entry = history.GetEntry(1);
+		REQUIRE(entry.m_SteamID == bot);
+		REQUIRE(entry.m_Name == "MYG)T");
+		REQUIRE(entry.m_Text == "Join our DISCORD at bots . tf");
+		REQUIRE(!entry.m_IsTeam);
+		REQUIRE(entry.m_IsDead);
+	}
+
+	// Newest first, case insensitive, and through lookalikes
+	REQUIRE(history.Search("discord") == std::vector<uint32_t>{ 3, 2, 1 });
+	REQUIRE(history.Search("join our") == std::vector<uint32_t>{ 3, 1 });
+	REQUIRE(history.Search("discord", 2) == std::vector<uint32_t>{ 3, 2 });
+
+	// Names are searched too
+	REQUIRE(history.Search("myg)t") == std::vector<uint32_t>{ 3, 1 });
+	REQUIRE(history.Search("pyro") == std::vector<uint32_t>{ 0 });
+
+	REQUIRE(history.Search("nothing like this").empty());
+
+	// Too short for the index
+	REQUIRE(history.Search("gg") == std::vector<uint32_t>{ 0 });
+	REQUIRE(history.Search("?") == std::vector<uint32_t>{ 2 });
+	REQUIRE(history.Search("").empty());
+
+	// Every trigram is there, but not in that order
+	history.Add(now, SteamID{}, InternedString("ghost"), "abcd bcde", false, false);
+	REQUIRE(history.Search("abcde").empty());
+	REQUIRE(history.Search("bcd") == std::vector<uint32_t>{ 4 });
+
+	history.Clear();
+	REQUIRE(history.size() == 0);
+	REQUIRE(history.Search("discord").empty());
+}
+
+TEST_CASE("tf2bd_chat_history_benchmark", "[tf2bd][.][benchmark]")
+{
+	// About a busy server's worth of chat over a few hours
+	ChatHistory history;
+	const time_point_t now = tfbd_clock_t::now();
+	for (int i = 0; i < 100'000; i++)
+	{
+		history.Add(now, SteamID{}, InternedString(mh::format("Player {}", i % 24)),
+			mh::format("message number {} with some filler text {}", i, i * 7919), (i % 3) == 0, false);
+	}
+	history.Add(now, SteamID{}, InternedString("spammer"), "free skins at example dot com", false, false);
+
+	BENCHMARK("ChatHistory::Search (rare)")
+	{
+		return history.Search("example dot com").size();
+	};
+
+	BENCHMARK("ChatHistory::Search (common, first 1000)")
+	{
+		return history.Search("filler", 1000).size();
+	};
+}
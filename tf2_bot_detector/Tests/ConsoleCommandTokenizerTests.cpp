@@ -0,0 +1,44 @@
+#include "Util/ConsoleCommandTokenizer.h"
+#include "Util/StaticStringSet.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_console_command_tokenizer", "[tf2bd]")
+{
+	const auto GetCommands = [](const std::string_view& text)
+	{
+		std::vector<std::string> commands;
+		ConsoleCommandTokenizer tokenizer(text);
+		while (auto cmd = tokenizer.NextCommand())
+			commands.emplace_back(*cmd);
+
+		return commands;
+	};
+
+	using list = std::vector<std::string>;
+
+	REQUIRE(GetCommands("tf_lobby_debug") == list{ "tf_lobby_debug" });
+	REQUIRE(GetCommands("  ;; \n ").empty());
+	REQUIRE(GetCommands("say hi; kick 5\nstatus") == list{ "say", "kick", "status" });
+
+	// Quoted separators and comments belong to the argument
+	REQUIRE(GetCommands(R"(say "a; quit // b"; net_status)") == list{ "say", "net_status" });
+	REQUIRE(GetCommands("con_logfile x // ; quit\n\"quoted cmd\" a") == list{ "con_logfile", "quoted cmd" });
+	REQUIRE(GetCommands("echo//quit") == list{ "echo" });
+}
+
+TEST_CASE("tf2bd_static_string_set", "[tf2bd]")
+{
+	static constexpr StaticStringSet s_Set({ "net_status", "con_logfile", "con_timestamp", "tf_mm_debug_level" });
+	static_assert(s_Set.contains("con_logfile"));
+	static_assert(!s_Set.contains("con_logfil"));
+
+	REQUIRE(s_Set.contains(std::string("tf_mm_debug_level")));
+	REQUIRE(!s_Set.contains(""));
+	REQUIRE(!s_Set.contains("status"));
+}
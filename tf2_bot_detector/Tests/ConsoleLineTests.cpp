@@ -1,9 +1,21 @@
 #include "ConsoleLog/ConsoleLines.h"
+#include "ConsoleLog/ConsoleLogTimestamp.h"
+#include "ConsoleLog/HighFrequencyLines.h"
+#include "GameData/UserMessageType.h"
 #include "SteamID.h"
+#include "Util/StaticRegex.h"
 #include "WorldState.h"
 
 #include <catch2/catch.hpp>
 #include <mh/error/not_implemented_error.hpp>
+#include <mh/text/charconv_helper.hpp>
+#include <mh/text/format.hpp>
+#include <mh/text/string_insertion.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <regex>
+#include <sstream>
 
 using namespace std::chrono_literals;
 using namespace tf2_bot_detector;
@@ -21,6 +33,10 @@ namespace
 		{
 			throw mh::not_implemented_error();
 		}
+		virtual bool IsDuplicateCommandResponseLine(const IConsoleLine& line, size_t textHash) override
+		{
+			throw mh::not_implemented_error();
+		}
 		virtual void Update() override
 		{
 			throw mh::not_implemented_error();
@@ -41,7 +57,7 @@ namespace
 		{
 			throw mh::not_implemented_error();
 		}
-		virtual void AddConsoleLineListener(IConsoleLineListener* listener) override
+		virtual void AddConsoleLineListener(IConsoleLineListener* listener, ConsoleLineTypeMask lineTypes) override
 		{
 			throw mh::not_implemented_error();
 		}
@@ -53,11 +69,15 @@ namespace
 		{
 			throw mh::not_implemented_error();
 		}
+		virtual void AddCommandResponse(const std::string_view& response, std::span<const IConsoleLine::TryParseFunc> parsers) override
+		{
+			throw mh::not_implemented_error();
+		}
 		virtual mh::task<> AddConsoleOutputLine(std::string line) override
 		{
 			throw mh::not_implemented_error();
 		}
-		virtual std::optional<SteamID> FindSteamIDForName(const std::string_view& playerName) const override
+		virtual std::optional<SteamID> FindSteamIDForName(const InternedString& playerName) const override
 		{
 			throw mh::not_implemented_error();
 		}
@@ -81,6 +101,14 @@ namespace
 		{
 			throw mh::not_implemented_error();
 		}
+		virtual const LobbyTeamStats& GetLobbyTeamStats(LobbyMemberTeam team) const override
+		{
+			throw mh::not_implemented_error();
+		}
+		virtual const ActivePlayerTable& GetActivePlayers() const override
+		{
+			throw mh::not_implemented_error();
+		}
 		virtual const IPlayer* FindPlayer(const SteamID& id) const override
 		{
 			throw mh::not_implemented_error();
@@ -101,7 +129,11 @@ namespace
 		{
 			throw mh::not_implemented_error();
 		}
-		virtual bool IsVoteInProgress() const override
+		virtual const VoteState& GetVoteState() const override
+		{
+			throw mh::not_implemented_error();
+		}
+		virtual void RecordVoteCall(const SteamID& target) override
 		{
 			throw mh::not_implemented_error();
 		}
@@ -109,6 +141,22 @@ namespace
 		{
 			throw mh::not_implemented_error();
 		}
+		virtual std::shared_ptr<const WorldSnapshot> GetWorldSnapshot() const override
+		{
+			throw mh::not_implemented_error();
+		}
+		virtual void SaveSnapshot(SessionSnapshot& snapshot) const override
+		{
+			throw mh::not_implemented_error();
+		}
+		virtual void RestoreSnapshot(const SessionSnapshot& snapshot) override
+		{
+			throw mh::not_implemented_error();
+		}
+		virtual size_t ReleaseIdleMemory() override
+		{
+			throw mh::not_implemented_error();
+		}
 
 	} static s_DummyWorldState;
 }
@@ -172,3 +220,249 @@ TEST_CASE("tf2bd_cl_status", "[ConsoleLines]")
 		REQUIRE(playerStatus.m_State == test.m_ExpectedState);
 	}
 }
+
+TEST_CASE("tf2bd_cl_dispatch", "[ConsoleLines]")
+{
+	const auto ParseType = [](const std::string_view& text) -> std::optional<ConsoleLineType>
+	{
+		if (auto parsed = IConsoleLine::ParseConsoleLine(text, tfbd_clock_t::now(), s_DummyWorldState))
+			return parsed->GetType();
+
+		return std::nullopt;
+	};
+
+	// Prefixed types
+	REQUIRE(ParseType("Lobby created") == ConsoleLineType::LobbyChanged);
+	REQUIRE(ParseType("edicts  : 1234 used of 2048 max") == ConsoleLineType::EdictUsage);
+	REQUIRE(ParseType("#    348 \"name\" [U:1:1118537734] 00:51  157    0 active") == ConsoleLineType::PlayerStatus);
+	REQUIRE(ParseType("#2 - name") == ConsoleLineType::PlayerStatusShort);
+	REQUIRE(ParseType("  Member[0] [U:1:1118537734]  team = TF_GC_TEAM_DEFENDERS  type = MATCH_PLAYER") == ConsoleLineType::LobbyMember);
+	REQUIRE(ParseType(" 57 ms : name") == ConsoleLineType::Ping);
+	REQUIRE(ParseType("- latency: 57.0, loss 0.00") == ConsoleLineType::NetChannelLatencyLoss);
+
+	// Unprefixed types still get a chance
+	REQUIRE(ParseType("attacker killed victim with scattergun.") == ConsoleLineType::KillNotification);
+
+	// Prefix matches, but nothing else does
+	REQUIRE(!ParseType("Lobby nonsense"));
+	REQUIRE(!ParseType(""));
+}
+
+TEST_CASE("tf2bd_cl_high_frequency", "[ConsoleLines]")
+{
+	HighFrequencyLineCounters counters;
+	const time_point_t now = tfbd_clock_t::now();
+
+	REQUIRE(counters.TryCount("Voice - chan 1, ent 7, bufsize: 412\n", now));
+	REQUIRE(counters.TryCount("Voice - chan 1, ent 7, bufsize: 100", now));
+	REQUIRE(counters.GetVoice(7).GetCount() == 2);
+	REQUIRE(counters.GetVoice(7).GetBytes() == 512);
+	REQUIRE(counters.GetVoice(7).GetLastSeen() == now);
+	REQUIRE(counters.GetVoice(6).GetCount() == 0);
+
+	REQUIRE(counters.TryCount("<-- [cl ] Split packet  1/ 2 seq  9876 size 1260 mtu 1260 from 1.2.3.4:27015", now));
+	REQUIRE(counters.GetSplitPackets(SocketType::Client).GetBytes() == 1260);
+
+	// First one from each address goes through the normal path, the rest are only counted
+	REQUIRE(!counters.TryCount("Msg from 1.2.3.4:27015: svc_UserMessage: type 4, bytes 52", now));
+	REQUIRE(counters.TryCount("Msg from 1.2.3.4:27015: svc_UserMessage: type 4, bytes 52", now));
+	REQUIRE(!counters.TryCount("Msg from 1.2.3.4:27015: svc_UserMessage: type 4, bytes 52", now + 1s));
+	REQUIRE(!counters.TryCount(mh::format("Msg from 1.2.3.4:27015: svc_UserMessage: type {}, bytes 8",
+		int(UserMessageType::VoteStart)), now + 1s));
+	REQUIRE(counters.GetUserMessages(UserMessageType(4)).GetCount() == 3);
+	REQUIRE(counters.GetUserMessages(UserMessageType::VoteStart).GetCount() == 1);
+
+	static_assert(GetUserMessageTypeInfo(UserMessageType::VoteStart).IsHandled());
+	static_assert(!GetUserMessageTypeInfo(UserMessageType::SayText2).IsHandled());
+	static_assert(!GetUserMessageTypeInfo(UserMessageType(200)).IsHandled());
+
+	// Not ours, or not quite what we expect
+	REQUIRE(!counters.TryCount("Voice - chan 1, ent 7", now));
+	REQUIRE(!counters.TryCount("<-- [xyz] Split packet  1/ 2 seq  9876 size 1260", now));
+	REQUIRE(!counters.TryCount("Lobby created", now));
+	REQUIRE(!counters.TryCount("", now));
+
+	counters.Reset();
+	REQUIRE(counters.GetVoice(7).GetCount() == 0);
+}
+
+TEST_CASE("tf2bd_static_regex", "[ConsoleLines]")
+{
+	using namespace tf2_bot_detector::static_regex;
+
+	// The captures must be identical to what std::regex produces, including all the backtracking corner cases
+	const auto RequireSameAsStdRegex = [](const char* pattern, const auto& staticRegex, const std::string_view& text)
+	{
+		const std::regex stdRegex(pattern);
+		std::match_results<std::string_view::const_iterator> expected;
+		const bool expectedMatch = std::regex_match(text.begin(), text.end(), expected, stdRegex);
+
+		const auto actual = staticRegex.match(text);
+		REQUIRE(bool(actual) == expectedMatch);
+		if (!expectedMatch)
+			return;
+
+		for (size_t i = 1; i < expected.size(); i++)
+		{
+			REQUIRE(actual[i].matched == expected[i].matched);
+			REQUIRE(actual[i].str() == expected[i].str());
+		}
+	};
+
+	{
+		constexpr auto killRegex = regex(seq(cap<1>(star(dot)), lit(" killed "), cap<2>(star(dot)), lit(" with "),
+			cap<3>(star(dot)), lit("."), opt(cap<4>(lit(" (crit)")))));
+		constexpr const char KILL_PATTERN[] = R"regex((.*) killed (.*) with (.*)\.( \(crit\))?)regex";
+
+		RequireSameAsStdRegex(KILL_PATTERN, killRegex, "a killed b with c.");
+		RequireSameAsStdRegex(KILL_PATTERN, killRegex, "a killed b with c. (crit)");
+		RequireSameAsStdRegex(KILL_PATTERN, killRegex, "a killed b killed c with d with e. (crit).");
+		RequireSameAsStdRegex(KILL_PATTERN, killRegex, "a killed b\nwith c.");
+	}
+
+	{
+		constexpr auto cvarRegex = regex(seq(cap<1>(plus(non_space)), plus(space), lit(":"), plus(space),
+			cap<2>(plus(chars("-0123456789."))), plus(space), lit(":"), plus(space),
+			opt(cap<3>(plus(dot))), plus(space), lit(":"), plus(chars("\t ")), opt(cap<4>(plus(dot)))));
+		constexpr const char CVAR_PATTERN[] = R"regex((\S+)\s+:\s+([-\d.]+)\s+:\s+(.+)?\s+:[\t ]+(.+)?)regex";
+
+		RequireSameAsStdRegex(CVAR_PATTERN, cvarRegex, R"(sv_cheats : 0 : , "notify", "rep" : Allow cheats on server)");
+		RequireSameAsStdRegex(CVAR_PATTERN, cvarRegex, "cl_foo   : 1  :            : help");
+		RequireSameAsStdRegex(CVAR_PATTERN, cvarRegex, "cl_foo : 1 : : help");
+		RequireSameAsStdRegex(CVAR_PATTERN, cvarRegex, "cl_foo : -1.5 : , \"a\" :\t");
+	}
+
+	{
+		constexpr auto connectingRegex = regex(seq(lit("Connecting to"), opt(cap<1>(lit(" matchmaking server"))), lit(" "),
+			cap<2>(lazy_star(dot)), opt(cap<3>(lit("...")))));
+		constexpr const char CONNECTING_PATTERN[] = R"regex(Connecting to( matchmaking server)? (.*?)(\.\.\.)?)regex";
+
+		RequireSameAsStdRegex(CONNECTING_PATTERN, connectingRegex, "Connecting to matchmaking server 1.2.3.4:27015...");
+		RequireSameAsStdRegex(CONNECTING_PATTERN, connectingRegex, "Connecting to 1.2.3.4:27015");
+		RequireSameAsStdRegex(CONNECTING_PATTERN, connectingRegex, "Connecting to matchmaking serverX...");
+	}
+}
+
+namespace
+{
+	// Set TF2BD_BENCHMARK_CONSOLE_LOG to the path of a recorded console.log to benchmark against
+	// real data. Otherwise, a synthetic log approximating status spam on a full server is used.
+	std::string LoadBenchmarkConsoleLog()
+	{
+		if (const char* path = std::getenv("TF2BD_BENCHMARK_CONSOLE_LOG"))
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (file.good())
+			{
+				std::ostringstream ss;
+				ss << file.rdbuf();
+				return ss.str();
+			}
+		}
+
+		std::string log;
+		for (int block = 0; block < 200; block++)
+		{
+			const auto timestamp = mh::format("\n10/14/2020 - 21:{:02}:{:02}: ", (block / 60) % 60, block % 60);
+			log << timestamp << "hostname: Valve Matchmaking Server (Virginia iad-1/srcds138 #42)";
+			log << timestamp << "players : 24 humans, 0 bots (24 max)";
+			log << timestamp << "# userid name                uniqueid            connected ping loss state";
+
+			for (int i = 0; i < 24; i++)
+			{
+				log << timestamp << mh::format("#    {:3} \"Player / {}\"  [U:1:{}]  {:02}:{:02}  {:3}    0 active",
+					300 + i, i, 100000000 + i, i, block % 60, 40 + i);
+			}
+
+			log << timestamp << "Some player killed Another player with scattergun. (crit)";
+			log << timestamp << "Voice - chan 3, ent 12, bufsize: 234";
+		}
+
+		log << '\n';
+		return log;
+	}
+
+	struct TimestampLocation
+	{
+		size_t m_Begin;
+		size_t m_End;
+		int m_Fields[6];
+
+		bool operator==(const TimestampLocation&) const = default;
+	};
+
+	std::vector<TimestampLocation> ScanTimestampsRegex(const std::string& log)
+	{
+		static const std::regex s_TimestampRegex(R"regex(\n(\d\d)\/(\d\d)\/(\d\d\d\d) - (\d\d):(\d\d):(\d\d):[ \n])regex", std::regex::optimize);
+
+		std::vector<TimestampLocation> retVal;
+		std::smatch match;
+		for (auto it = log.cbegin(); std::regex_search(it, log.cend(), match, s_TimestampRegex); it = match[0].second)
+		{
+			TimestampLocation& loc = retVal.emplace_back();
+			loc.m_Begin = match[0].first - log.cbegin();
+			loc.m_End = match[0].second - log.cbegin();
+			for (size_t i = 0; i < std::size(loc.m_Fields); i++)
+				mh::from_chars(std::string_view(&*match[i + 1].first, match[i + 1].length()), loc.m_Fields[i]);
+		}
+
+		return retVal;
+	}
+
+	std::vector<TimestampLocation> ScanTimestampsScanner(const std::string& log)
+	{
+		std::vector<TimestampLocation> retVal;
+		size_t offset = 0;
+		while (auto timestamp = FindConsoleLogTimestamp(log, offset))
+		{
+			retVal.push_back(TimestampLocation{ timestamp->m_Begin, timestamp->m_End,
+				{ timestamp->m_Month, timestamp->m_Day, timestamp->m_Year, timestamp->m_Hour, timestamp->m_Minute, timestamp->m_Second } });
+			offset = timestamp->m_End;
+		}
+
+		return retVal;
+	}
+}
+
+TEST_CASE("tf2bd_conlog_timestamp", "[ConsoleLines]")
+{
+	const std::string log = LoadBenchmarkConsoleLog();
+	REQUIRE(ScanTimestampsScanner(log) == ScanTimestampsRegex(log));
+
+	// Near misses
+	REQUIRE(!FindConsoleLogTimestamp("\n10/14/2020 - 21:05:0x: "));
+	REQUIRE(!FindConsoleLogTimestamp("\n1/14/2020 - 21:05:07: "));
+	REQUIRE(!FindConsoleLogTimestamp("\n10/14/2020 - 21:05:07:"));  // Incomplete
+	REQUIRE(FindConsoleLogTimestamp("\n10/14/2020 - 21:05:07:\n"));
+
+	ConsoleLogTimestampDecoder decoder;
+	const auto timestamp = FindConsoleLogTimestamp("garbage\n10/14/2020 - 21:05:07: text");
+	REQUIRE(timestamp);
+	REQUIRE(timestamp->m_Begin == 7);
+	REQUIRE(timestamp->m_End == 7 + ConsoleLogTimestamp::LENGTH);
+
+	std::tm expected{};
+	expected.tm_isdst = -1;
+	expected.tm_year = 2020 - 1900;
+	expected.tm_mon = 10 - 1;
+	expected.tm_mday = 14;
+	expected.tm_hour = 21;
+	expected.tm_min = 5;
+	expected.tm_sec = 7;
+	REQUIRE(decoder.Decode(*timestamp) == tfbd_clock_t::from_time_t(std::mktime(&expected)));
+}
+
+TEST_CASE("tf2bd_conlog_timestamp_benchmark", "[ConsoleLines][.][benchmark]")
+{
+	const std::string log = LoadBenchmarkConsoleLog();
+
+	BENCHMARK("std::regex")
+	{
+		return ScanTimestampsRegex(log).size();
+	};
+
+	BENCHMARK("FindConsoleLogTimestamp")
+	{
+		return ScanTimestampsScanner(log).size();
+	};
+}
@@ -0,0 +1,442 @@
+#include "Clock.h"
+#include "Config/ChatWrappers.h"
+#include "Config/Settings.h"
+#include "ConsoleLog/ConsoleLineListener.h"
+#include "ConsoleLog/ConsoleLogParser.h"
+#include "ConsoleLog/ConsoleLogTimestamp.h"
+#include "ConsoleLog/IConsoleLine.h"
+#include "SteamID.h"
+#include "WorldState.h"
+
+#include <catch2/catch.hpp>
+#include <mh/text/format.hpp>
+#include <mh/text/string_insertion.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+using namespace std::string_view_literals;
+using namespace tf2_bot_detector;
+
+namespace
+{
+	// Only here to catch runaway regex backtracking, so it's generous enough for a slow debug build
+	constexpr auto MAX_LINE_PARSE_TIME = 250ms;
+
+	// Chat wrappers are random, so the corpus can't contain real ones. Chat lines are written as
+	//   @chat <category>|<name>|<message>
+	// instead (with the ChatCategory names used in settings.json), and wrapped when they're loaded.
+	constexpr std::string_view CHAT_PLACEHOLDER = "@chat ";
+
+	struct CorpusFile
+	{
+		std::string m_Name;
+		std::string m_Text; // Exactly like console.log, starting with the '\n' before the first timestamp
+	};
+
+	std::string WrapChatPlaceholder(const std::string_view& line, const ChatWrappers& wrappers)
+	{
+		const auto nameSep = line.find('|');
+		const auto msgSep = line.find('|', nameSep + 1);
+		if (nameSep == line.npos || msgSep == line.npos)
+			throw std::runtime_error(mh::format("Malformed chat placeholder {}", std::quoted(line)));
+
+		const auto categoryName = line.substr(CHAT_PLACEHOLDER.size(), nameSep - CHAT_PLACEHOLDER.size());
+		const auto category = nlohmann::json(categoryName).get<ChatCategory>();
+		const auto& type = wrappers.m_Types[size_t(category)];
+
+		std::string retVal;
+		retVal << type.m_Full.m_Start.m_Narrow
+			<< type.m_Name.m_Start.m_Narrow << line.substr(nameSep + 1, msgSep - nameSep - 1) << type.m_Name.m_End.m_Narrow
+			<< " :  "
+			<< type.m_Message.m_Start.m_Narrow << line.substr(msgSep + 1) << type.m_Message.m_End.m_Narrow
+			<< type.m_Full.m_End.m_Narrow;
+
+		return retVal;
+	}
+
+	// Calls func(timestamp, line) for every line, where line is everything up to the next timestamp
+	template<typename TFunc>
+	void ForEachLine(const std::string_view& text, TFunc&& func)
+	{
+		auto timestamp = FindConsoleLogTimestamp(text);
+		while (timestamp)
+		{
+			const auto next = FindConsoleLogTimestamp(text, timestamp->m_End);
+			const size_t lineEnd = next ? next->m_Begin : text.size();
+
+			func(text.substr(timestamp->m_Begin, timestamp->m_End - timestamp->m_Begin),
+				text.substr(timestamp->m_End, lineEnd - timestamp->m_End));
+
+			timestamp = next;
+		}
+	}
+
+	std::string ExpandChatPlaceholders(const std::string_view& text, const ChatWrappers& wrappers)
+	{
+		std::string retVal;
+		retVal.reserve(text.size());
+		ForEachLine(text, [&](const std::string_view& timestamp, std::string_view line)
+		{
+			retVal << timestamp;
+			if (!line.starts_with(CHAT_PLACEHOLDER))
+			{
+				retVal << line;
+				return;
+			}
+
+			// The last line in the file still has its newline
+			const bool newline = line.ends_with('\n');
+			if (newline)
+				line.remove_suffix(1);
+
+			retVal << WrapChatPlaceholder(line, wrappers);
+			if (newline)
+				retVal << '\n';
+		});
+
+		return retVal;
+	}
+
+	// Everything in Tests/ConsoleLogCorpus, sorted by name
+	std::vector<CorpusFile> LoadCorpus(const ChatWrappers& wrappers)
+	{
+		std::vector<CorpusFile> retVal;
+		for (const auto& entry : std::filesystem::directory_iterator(TF2BD_TEST_CORPUS_DIR))
+		{
+			if (!entry.is_regular_file() || entry.path().extension() != ".log")
+				continue;
+
+			std::ifstream file(entry.path(), std::ios::binary);
+			std::ostringstream ss;
+			ss << file.rdbuf();
+
+			CorpusFile& corpusFile = retVal.emplace_back();
+			corpusFile.m_Name = entry.path().stem().string();
+			corpusFile.m_Text = ExpandChatPlaceholders('\n' + ss.str(), wrappers);
+		}
+
+		std::sort(retVal.begin(), retVal.end(), [](const CorpusFile& a, const CorpusFile& b) { return a.m_Name < b.m_Name; });
+		return retVal;
+	}
+
+	// Every line of every file, without the timestamps, as ConsoleLogParser would hand them to ParseConsoleLine()
+	std::vector<std::string> GetCorpusLines(const std::vector<CorpusFile>& corpus)
+	{
+		std::vector<std::string> retVal;
+		for (const CorpusFile& file : corpus)
+		{
+			ForEachLine(file.m_Text, [&](const std::string_view&, std::string_view line)
+			{
+				if (line.ends_with('\n'))
+					line.remove_suffix(1);
+
+				retVal.emplace_back(line);
+			});
+		}
+
+		return retVal;
+	}
+
+	class LineTypeCounter final : public AutoConsoleLineListener
+	{
+	public:
+		using AutoConsoleLineListener::AutoConsoleLineListener;
+
+		void OnConsoleLineParsed(IWorldState& world, IConsoleLine& line) override { m_Counts[size_t(line.GetType())]++; }
+		void OnConsoleLineUnparsed(IWorldState& world, const std::string_view& text) override { m_UnparsedCount++; }
+
+		size_t GetCount(ConsoleLineType type) const { return m_Counts[size_t(type)]; }
+
+		std::array<size_t, size_t(ConsoleLineType::COUNT)> m_Counts{};
+		size_t m_UnparsedCount = 0;
+	};
+
+	struct CorpusEnvironment
+	{
+		CorpusEnvironment()
+		{
+			m_Settings.m_BackgroundConsoleLogParsing = false;
+			m_Settings.m_Unsaved.m_ChatMsgWrappers = ChatWrappers(ChatFmtStrLengths{});
+			m_World = IWorldState::Create(m_Settings);
+			m_Corpus = LoadCorpus(*m_Settings.m_Unsaved.m_ChatMsgWrappers);
+		}
+
+		// Whatever happens, it has to happen quickly. Parsers are allowed to reject with a std::exception.
+		std::shared_ptr<IConsoleLine> ParseLine(const std::string_view& line)
+		{
+			using clock = std::chrono::steady_clock;
+			const auto startTime = clock::now();
+
+			std::shared_ptr<IConsoleLine> parsed;
+			try
+			{
+				parsed = IConsoleLine::ParseConsoleLine(line, tfbd_clock_t::now(), *m_World);
+			}
+			catch (const std::exception&)
+			{
+			}
+
+			const auto parseTime = clock::now() - startTime;
+			INFO("Took " << to_seconds(parseTime) * 1000 << "ms to parse " << std::quoted(line));
+			REQUIRE(parseTime < MAX_LINE_PARSE_TIME);
+
+			return parsed;
+		}
+
+		Settings m_Settings;
+		std::shared_ptr<IWorldState> m_World;
+		std::vector<CorpusFile> m_Corpus;
+	};
+
+	const CorpusFile& FindCorpusFile(const std::vector<CorpusFile>& corpus, const std::string_view& name)
+	{
+		for (const CorpusFile& file : corpus)
+		{
+			if (file.m_Name == name)
+				return file;
+		}
+
+		throw std::runtime_error(mh::format("Corpus file {} is missing from " TF2BD_TEST_CORPUS_DIR, name));
+	}
+
+	// Things parsers look for, and things that tend to break them
+	constexpr std::string_view FUZZ_TOKENS[] =
+	{
+		"\"", "[", "]", ":", " :  ", "[U:1:", "[U:1:4294967296]", "[A:1:2:3]", "76561197960265728",
+		"18446744073709551616", "-", ".", "e", "nan", " killed ", " with ", ". (crit)", " ms : ", "#", " - ",
+		"Member[", "  team = ", "  type = ", "\n", "\r", "\t", "    ", "\xFF", "\xC0", "\xE2\x80\x8B", "\xF0\x9F\x98",
+	};
+
+	// Flips, inserts, erases, repeats and splices bytes. Repeats are what find backtracking problems.
+	void Mutate(std::string& text, const std::vector<std::string>& corpusLines, std::mt19937& random)
+	{
+		const auto Pos = [&](size_t max) { return std::uniform_int_distribution<size_t>(0, max)(random); };
+
+		const size_t mutationCount = 1 + Pos(3);
+		for (size_t i = 0; i < mutationCount; i++)
+		{
+			switch (Pos(5))
+			{
+			case 0:
+				if (!text.empty())
+					text[Pos(text.size() - 1)] = char(Pos(255));
+				break;
+
+			case 1:
+				text.insert(Pos(text.size()), FUZZ_TOKENS[Pos(std::size(FUZZ_TOKENS) - 1)]);
+				break;
+
+			case 2:
+			{
+				const size_t begin = Pos(text.size());
+				text.erase(begin, Pos(text.size() - begin));
+				break;
+			}
+
+			case 3:
+			{
+				const size_t begin = Pos(text.size());
+				const auto range = text.substr(begin, Pos(std::min<size_t>(text.size() - begin, 16)));
+				std::string repeated;
+				for (size_t repeat = 1 + Pos(63); repeat > 0; repeat--)
+					repeated += range;
+
+				text.insert(begin, repeated);
+				break;
+			}
+
+			case 4:
+			{
+				const std::string& other = corpusLines[Pos(corpusLines.size() - 1)];
+				text = text.substr(0, Pos(text.size())) + other.substr(Pos(other.size()));
+				break;
+			}
+
+			case 5:
+				text.resize(Pos(text.size()));
+				break;
+			}
+		}
+	}
+
+	void CheckSteamIDParse(const std::string_view& str)
+	{
+		INFO("SteamID " << std::quoted(str));
+
+		const auto result = ParseSteamID(str);
+		bool threw = false;
+		try
+		{
+			const SteamID id(str);
+			REQUIRE(id.ID64 == result.m_ID64);
+		}
+		catch (const std::invalid_argument&)
+		{
+			threw = true;
+		}
+
+		REQUIRE(threw == (result.m_Error != SteamIDParseError::None));
+	}
+
+	size_t GetEnvSize(const char* name, size_t defaultValue)
+	{
+		if (const char* value = std::getenv(name))
+			return std::strtoull(value, nullptr, 10);
+
+		return defaultValue;
+	}
+}
+
+TEST_CASE("tf2bd_conlog_corpus", "[ConsoleLines]")
+{
+	CorpusEnvironment env;
+	REQUIRE(!env.m_Corpus.empty());
+
+	LineTypeCounter counter(*env.m_World);
+	const auto ParseFile = [&](const std::string_view& name)
+	{
+		counter.m_Counts = {};
+		counter.m_UnparsedCount = 0;
+
+		ConsoleLogParser parser(*env.m_World, env.m_Settings, "tf2bd_conlog_corpus.log");
+		parser.ParseText(FindCorpusFile(env.m_Corpus, name).m_Text);
+		env.m_World->Update();
+	};
+
+	ParseFile("status_flood");
+	REQUIRE(counter.GetCount(ConsoleLineType::PlayerStatus) >= 20);
+	REQUIRE(counter.GetCount(ConsoleLineType::PlayerStatusShort) > 0);
+	REQUIRE(counter.GetCount(ConsoleLineType::PlayerStatusCount) > 0);
+	REQUIRE(counter.GetCount(ConsoleLineType::EdictUsage) > 0);
+	REQUIRE(counter.GetCount(ConsoleLineType::Ping) > 0);
+	REQUIRE(counter.GetCount(ConsoleLineType::ServerDroppedPlayer) > 0);
+
+	ParseFile("lobby_debug");
+	REQUIRE(counter.GetCount(ConsoleLineType::LobbyHeader) > 0);
+	REQUIRE(counter.GetCount(ConsoleLineType::LobbyMember) >= 8);
+	REQUIRE(counter.GetCount(ConsoleLineType::LobbyChanged) > 0);
+	REQUIRE(counter.GetCount(ConsoleLineType::DifferingLobbyReceived) > 0);
+	REQUIRE(counter.GetCount(ConsoleLineType::Connecting) > 0);
+
+	ParseFile("chat_multilang");
+	REQUIRE(counter.GetCount(ConsoleLineType::Chat) >= 12);
+	REQUIRE(counter.GetCount(ConsoleLineType::KillNotification) > 0);
+
+	ParseFile("net_graph");
+	REQUIRE(counter.GetCount(ConsoleLineType::NetStatusConfig) > 0);
+	REQUIRE(counter.GetCount(ConsoleLineType::NetChannelLatencyLoss) > 0);
+
+	// Every line on its own, so a slow one can be pinned down
+	for (const std::string& line : GetCorpusLines(env.m_Corpus))
+		env.ParseLine(line);
+}
+
+// Set TF2BD_FUZZ_ITERATIONS for a longer run, and TF2BD_FUZZ_SEED to reproduce a failure
+TEST_CASE("tf2bd_conlog_fuzz", "[ConsoleLines][fuzz]")
+{
+	CorpusEnvironment env;
+	const auto corpusLines = GetCorpusLines(env.m_Corpus);
+	REQUIRE(!corpusLines.empty());
+
+	const size_t iterations = GetEnvSize("TF2BD_FUZZ_ITERATIONS", 2000);
+	const auto seed = unsigned(GetEnvSize("TF2BD_FUZZ_SEED", std::random_device{}()));
+	std::mt19937 random(seed);
+
+	// Mutated lines are also run through a parser in batches, since chat wrappers and multi-line
+	// output can only be found there
+	ConsoleLogParser parser(*env.m_World, env.m_Settings, "tf2bd_conlog_fuzz.log");
+	std::string batch;
+	constexpr size_t BATCH_SIZE = 64;
+
+	for (size_t i = 0; i < iterations; i++)
+	{
+		std::string text = corpusLines[std::uniform_int_distribution<size_t>(0, corpusLines.size() - 1)(random)];
+		Mutate(text, corpusLines, random);
+		INFO("TF2BD_FUZZ_SEED=" << seed << ", iteration " << i << ": " << std::quoted(text));
+
+		env.ParseLine(text);
+
+		CheckSteamIDParse(text);
+		for (size_t begin = text.find('['); begin != text.npos; begin = text.find('[', begin + 1))
+		{
+			const size_t end = text.find(']', begin);
+			CheckSteamIDParse(std::string_view(text).substr(begin, end == text.npos ? text.npos : (end - begin + 1)));
+		}
+
+		batch << mh::format("\n10/14/2020 - 21:06:{:02}: ", i % 60) << text;
+		if ((i % BATCH_SIZE) == (BATCH_SIZE - 1))
+		{
+			parser.ParseText(batch);
+			env.m_World->Update();
+			batch.clear();
+		}
+	}
+}
+
+TEST_CASE("tf2bd_conlog_corpus_benchmark", "[ConsoleLines][.][benchmark]")
+{
+	CorpusEnvironment env;
+
+	// Grouped by whatever they parse as, since each type has its own parser
+	std::array<std::vector<std::string>, size_t(ConsoleLineType::COUNT)> linesByType;
+	std::vector<std::string> unparsedLines;
+	for (std::string& line : GetCorpusLines(env.m_Corpus))
+	{
+		if (auto parsed = env.ParseLine(line))
+			linesByType[size_t(parsed->GetType())].push_back(std::move(line));
+		else
+			unparsedLines.push_back(std::move(line));
+	}
+
+	const auto ParseAll = [&](const std::vector<std::string>& lines)
+	{
+		size_t parsedCount = 0;
+		for (const std::string& line : lines)
+		{
+			if (IConsoleLine::ParseConsoleLine(line, tfbd_clock_t::now(), *env.m_World))
+				parsedCount++;
+		}
+
+		return parsedCount;
+	};
+
+	for (size_t type = 0; type < linesByType.size(); type++)
+	{
+		if (linesByType[type].empty())
+			continue;
+
+		BENCHMARK(mh::format("ParseConsoleLine: {} ({} lines)", mh::enum_fmt(ConsoleLineType(type)), linesByType[type].size()))
+		{
+			return ParseAll(linesByType[type]);
+		};
+	}
+
+	// Everything that falls through every parser, the most expensive kind of line
+	BENCHMARK(mh::format("ParseConsoleLine: unparsed ({} lines)", unparsedLines.size()))
+	{
+		return ParseAll(unparsedLines);
+	};
+
+	for (const CorpusFile& file : env.m_Corpus)
+	{
+		BENCHMARK(mh::format("ConsoleLogParser::ParseText: {}", file.m_Name))
+		{
+			ConsoleLogParser parser(*env.m_World, env.m_Settings, "tf2bd_conlog_corpus_benchmark.log");
+			parser.ParseText(file.m_Text);
+			return parser.GetParseProgress();
+		};
+	}
+}
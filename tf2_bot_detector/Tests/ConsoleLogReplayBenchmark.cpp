@@ -0,0 +1,205 @@
+#include "Actions/RCONActionManager.h"
+#include "Config/ChatWrappers.h"
+#include "Config/Settings.h"
+#include "ConsoleLog/ConsoleLineListener.h"
+#include "ConsoleLog/ConsoleLogParser.h"
+#include "Log.h"
+#include "ModeratorLogic.h"
+#include "WorldState.h"
+
+#include <catch2/catch.hpp>
+#include <mh/text/format.hpp>
+#include <mh/text/string_insertion.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#define TF2BD_BENCHMARK_COUNT_ALLOCATIONS 1
+#else
+#define TF2BD_BENCHMARK_COUNT_ALLOCATIONS 0
+#endif
+
+namespace
+{
+	// Counts heap allocations only while it's alive, through the debug CRT's allocation hook. This
+	// leaves the process's operator new alone: the tests are built into the shipped dll, next to
+	// TF2BD_USE_MIMALLOC. Release builds, and those using mimalloc, have nothing to count with.
+	class ScopedAllocationCounter final
+	{
+	public:
+		ScopedAllocationCounter()
+		{
+#if TF2BD_BENCHMARK_COUNT_ALLOCATIONS
+			s_Count = 0;
+			m_PrevHook = _CrtSetAllocHook(&AllocHook);
+#endif
+		}
+		~ScopedAllocationCounter()
+		{
+#if TF2BD_BENCHMARK_COUNT_ALLOCATIONS
+			_CrtSetAllocHook(m_PrevHook);
+#endif
+		}
+		ScopedAllocationCounter(const ScopedAllocationCounter&) = delete;
+		ScopedAllocationCounter& operator=(const ScopedAllocationCounter&) = delete;
+
+		static constexpr bool IsAvailable() { return TF2BD_BENCHMARK_COUNT_ALLOCATIONS; }
+		uint64_t GetCount() const { return s_Count.load(std::memory_order_relaxed); }
+
+	private:
+		static inline std::atomic<uint64_t> s_Count = 0;
+
+#if TF2BD_BENCHMARK_COUNT_ALLOCATIONS
+		static int __cdecl AllocHook(int allocType, void*, size_t, int, long, const unsigned char*, int)
+		{
+			if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC)
+				s_Count.fetch_add(1, std::memory_order_relaxed);
+
+			return 1; // Let the allocation go ahead
+		}
+
+		_CRT_ALLOC_HOOK m_PrevHook = nullptr;
+#endif
+	};
+}
+
+namespace
+{
+	class NullActionManager final : public IRCONActionManager
+	{
+	public:
+		void Update() override {}
+		bool QueueAction(std::unique_ptr<IAction>&& action, AckFunc onAck) override { return true; }
+		void AddPeriodicActionGenerator(std::unique_ptr<IPeriodicActionGenerator>&& action) override {}
+		void RequestFastPolling(time_point_t until) override {}
+		Stats GetStats() const override { return {}; }
+		bool IsResponding() const override { return false; }
+	};
+
+	class LineCounter final : public AutoConsoleLineListener
+	{
+	public:
+		using AutoConsoleLineListener::AutoConsoleLineListener;
+
+		void OnConsoleLineParsed(IWorldState& world, IConsoleLine& line) override { m_LineCount++; }
+		void OnConsoleLineUnparsed(IWorldState& world, const std::string_view& text) override { m_LineCount++; }
+
+		size_t m_LineCount = 0;
+	};
+
+	// Set TF2BD_BENCHMARK_CONSOLE_LOG to the path of a recorded console.log. Otherwise, a synthetic
+	// log with status output, chat, kills and voice spam from a full server is used.
+	std::string LoadReplayConsoleLog(const ChatWrappers& wrappers)
+	{
+		if (const char* path = std::getenv("TF2BD_BENCHMARK_CONSOLE_LOG"))
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (file.good())
+			{
+				std::ostringstream ss;
+				ss << file.rdbuf();
+				return ss.str();
+			}
+
+			LogWarning("Failed to open {}, falling back to a synthetic console log", path);
+		}
+
+		const auto& chat = wrappers.m_Types[size_t(ChatCategory::All)];
+
+		std::string log;
+		for (int block = 0; block < 2000; block++)
+		{
+			const auto timestamp = mh::format("\n10/14/2020 - {:02}:{:02}:{:02}: ", (block / 3600) % 24, (block / 60) % 60, block % 60);
+			log << timestamp << "hostname: Valve Matchmaking Server (Virginia iad-1/srcds138 #42)";
+			log << timestamp << "players : 24 humans, 0 bots (24 max)";
+			log << timestamp << "# userid name                uniqueid            connected ping loss state";
+
+			for (int i = 0; i < 24; i++)
+			{
+				log << timestamp << mh::format("#    {:3} \"Player / {}\"  [U:1:{}]  {:02}:{:02}  {:3}    0 active",
+					300 + i, i, 100000000 + i, i, block % 60, 40 + i);
+			}
+
+			log << timestamp << chat.m_Full.m_Start.m_Narrow
+				<< chat.m_Name.m_Start.m_Narrow << "Player / " << (block % 24) << chat.m_Name.m_End.m_Narrow
+				<< " :  "
+				<< chat.m_Message.m_Start.m_Narrow << "gg ez " << block << chat.m_Message.m_End.m_Narrow
+				<< chat.m_Full.m_End.m_Narrow;
+
+			log << timestamp << "Player / 3 killed Player / 7 with scattergun. (crit)";
+			log << timestamp << "Voice - chan 3, ent 12, bufsize: 234";
+		}
+
+		log << '\n';
+		return log;
+	}
+}
+
+TEST_CASE("tf2bd_conlog_replay_benchmark", "[ConsoleLogParser][.][benchmark]")
+{
+	Settings settings;
+	settings.m_BackgroundConsoleLogParsing = false;
+	settings.m_Unsaved.m_ChatMsgWrappers = ChatWrappers(ChatFmtStrLengths{});
+
+	const std::string log = LoadReplayConsoleLog(*settings.m_Unsaved.m_ChatMsgWrappers);
+
+	// Set TF2BD_BENCHMARK_ADAPTIVE_PARSE_ORDER to compare against the fixed order
+	const bool adaptiveParseOrder = !!std::getenv("TF2BD_BENCHMARK_ADAPTIVE_PARSE_ORDER");
+	IConsoleLine::SetAdaptiveParseOrder(adaptiveParseOrder);
+
+	auto world = IWorldState::Create(settings);
+	NullActionManager actionManager;
+	auto modLogic = IModeratorLogic::Create(*world, settings, actionManager);
+	LineCounter counter(*world);
+	ConsoleLogParser parser(*world, settings, "tf2bd_conlog_replay_benchmark.log");
+
+	// Same size as ConsoleLogParser's own reads
+	constexpr size_t CHUNK_SIZE = 256 * 1024;
+
+	using clock = std::chrono::steady_clock;
+	std::vector<clock::duration> chunkTimes;
+
+	const ScopedAllocationCounter allocationCounter;
+	const auto startTime = clock::now();
+
+	for (size_t offset = 0; offset < log.size(); offset += CHUNK_SIZE)
+	{
+		const auto chunkStart = clock::now();
+
+		parser.ParseText(std::string_view(log).substr(offset, CHUNK_SIZE));
+		world->Update();
+		modLogic->Update();
+
+		chunkTimes.push_back(clock::now() - chunkStart);
+	}
+
+	const auto totalTime = clock::now() - startTime;
+	const uint64_t allocations = allocationCounter.GetCount();
+	IConsoleLine::SetAdaptiveParseOrder(false);
+
+	REQUIRE(counter.m_LineCount > 0);
+
+	std::sort(chunkTimes.begin(), chunkTimes.end());
+	const auto Percentile = [&](double p)
+	{
+		return to_seconds(chunkTimes[std::min(chunkTimes.size() - 1, size_t(p * chunkTimes.size()))]) * 1000;
+	};
+
+	const std::string allocationsPerLine = ScopedAllocationCounter::IsAvailable() ?
+		mh::format("{:.2f}", double(allocations) / counter.m_LineCount) : "n/a (debug CRT only)";
+
+	Log("console.log replay ({} parse order): {} bytes, {} lines in {:.3f}s ({:.0f} lines/s), {} allocations/line, "
+		"{} chunks p50 {:.3f}ms p99 {:.3f}ms",
+		adaptiveParseOrder ? "adaptive" : "fixed", log.size(), counter.m_LineCount, to_seconds(totalTime), counter.m_LineCount / to_seconds(totalTime),
+		allocationsPerLine, chunkTimes.size(), Percentile(0.5), Percentile(0.99));
+}
@@ -0,0 +1,61 @@
+#include "EventLog.h"
+
+#include <catch2/catch.hpp>
+
+#include <sstream>
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_event_log_roundtrip", "[tf2bd]")
+{
+	using namespace detail::EventLog_h;
+
+	const auto path = std::filesystem::temp_directory_path() / "tf2bd_event_log_test.tfbdevents";
+	const auto startTime = tfbd_clock_t::now();
+
+	{
+		EventLogFile file(path);
+		REQUIRE(file.IsOpen());
+
+		std::string record;
+		BeginRecord(record, EventLogRecordType::ChatMessage, 3);
+		AddField(record, SteamID(76561197960287930));
+		AddField(record, std::string("a \"name\""));
+		AddField(record, std::string_view("hello, world"));
+		EndRecord(record);
+		file.Write(record, tfbd_clock_t::now());
+
+		BeginRecord(record, EventLogRecordType::RCONCommand, 1);
+		AddField(record, std::string_view("status"));
+		EndRecord(record);
+		file.Write(record, tfbd_clock_t::now());
+
+		file.Flush();
+	}
+
+	const auto endTime = tfbd_clock_t::now();
+
+	{
+		std::ostringstream json;
+		REQUIRE(ExportEventLog(path, startTime, endTime, EventLogExportFormat::JSON, json) == 2);
+		REQUIRE(json.str().find(R"("steam_id":76561197960287930)") != std::string::npos);
+		REQUIRE(json.str().find(R"("name":"a \"name\"")") != std::string::npos);
+		REQUIRE(json.str().find(R"("command":"status")") != std::string::npos);
+	}
+
+	{
+		std::ostringstream csv;
+		REQUIRE(ExportEventLog(path, startTime, endTime, EventLogExportFormat::CSV, csv) == 2);
+		REQUIRE(csv.str().find(R"(,ChatMessage,76561197960287930,"a ""name""","hello, world")") != std::string::npos);
+	}
+
+	{
+		std::ostringstream later;
+		REQUIRE(ExportEventLog(path, endTime + 1h, time_point_t::max(), EventLogExportFormat::JSON, later) == 0);
+		REQUIRE(later.str().empty());
+	}
+
+	std::filesystem::remove(path);
+	std::filesystem::remove(std::filesystem::path(path) += ".idx");
+}
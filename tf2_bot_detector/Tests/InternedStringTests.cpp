@@ -0,0 +1,35 @@
+#include "Util/InternedString.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <unordered_map>
+
+using namespace std::string_literals;
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_interned_string", "[tf2bd]")
+{
+	const InternedString a("Special Gamer");
+	const InternedString b("Special Gamer"s);
+	const InternedString c("Special Gamer2");
+
+	REQUIRE(a == b);
+	REQUIRE(a.GetHandle() == b.GetHandle());
+	REQUIRE(a != c);
+	REQUIRE(a == "Special Gamer");
+	REQUIRE(a.str() == "Special Gamer");
+	REQUIRE(a < c);
+
+	REQUIRE(InternedString() == InternedString(""));
+	REQUIRE(InternedString().empty());
+
+	REQUIRE(InternedString::Find("Special Gamer") == a);
+	REQUIRE(!InternedString::Find("Never interned by anything"));
+
+	std::unordered_map<InternedString, int> map;
+	map[a] = 1;
+	map[c] = 2;
+	REQUIRE(map.at(b) == 1);
+	REQUIRE(map.size() == 2);
+}
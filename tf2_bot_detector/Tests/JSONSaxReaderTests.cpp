@@ -0,0 +1,113 @@
+#include "Util/JSONSaxReader.h"
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+using namespace tf2_bot_detector;
+using namespace std::string_view_literals;
+
+namespace
+{
+	class TestReader final : public JSONSaxReader
+	{
+	public:
+		std::vector<std::string> m_Names;
+		std::vector<uint32_t> m_Ages;
+		uint32_t m_Containers = 0;
+
+	protected:
+		bool OnStartContainer(const std::string_view& key, bool isArray) override
+		{
+			if (IsPath({ "people", "" }))
+				m_Containers++;
+
+			return true;
+		}
+
+		bool OnScalar(const std::string_view& key, const scalar_type& value) override
+		{
+			if (!IsPath({ "people", "" }))
+				return true;
+
+			if (key == "name"sv)
+				return TryGetString(value, m_Names.emplace_back());
+			else if (key == "age"sv)
+				return TryGetNumber(value, m_Ages.emplace_back());
+
+			return true;
+		}
+	};
+
+	// Counts the elements of the top level array by depth, then stops at "done"
+	class StoppingReader final : public JSONSaxReader
+	{
+	public:
+		uint32_t m_Elements = 0;
+		uint32_t m_ScalarsAfterStop = 0;
+		bool m_Stopped = false;
+
+	protected:
+		bool OnStartContainer(const std::string_view& key, bool isArray) override
+		{
+			if (GetDepth() == 2)
+				m_Elements++;
+
+			return true;
+		}
+
+		bool OnScalar(const std::string_view& key, const scalar_type& value) override
+		{
+			if (m_Stopped)
+			{
+				m_ScalarsAfterStop++;
+			}
+			else if (key == "done"sv)
+			{
+				m_Stopped = true;
+				StopParsing();
+			}
+
+			return true;
+		}
+	};
+}
+
+TEST_CASE("tf2bd_json_sax_reader", "[tf2bd]")
+{
+	{
+		TestReader reader;
+		REQUIRE(reader.Parse(R"({ "people": [
+			{ "name": "a", "age": 1, "pets": [ { "name": "ignored" } ] },
+			{ "age": 2, "name": "b", "extra": { "age": 99 } },
+			"c"
+		], "name": "ignored" })"));
+
+		REQUIRE(!reader.HasParseError());
+		REQUIRE(reader.m_Names == std::vector<std::string>{ "a", "b" });
+		REQUIRE(reader.m_Ages == std::vector<uint32_t>{ 1, 2 });
+		REQUIRE(reader.m_Containers == 2);
+	}
+
+	{
+		TestReader reader;
+		REQUIRE(!reader.Parse(R"({ "people": [ { "name": "a" )"));
+		REQUIRE(reader.HasParseError());
+	}
+
+	{
+		// Rejected by the reader rather than the parser
+		TestReader reader;
+		REQUIRE(!reader.Parse(R"({ "people": [ { "name": 5 } ] })"));
+		REQUIRE(!reader.HasParseError());
+	}
+
+	{
+		// Everything after the stop is never looked at, not even to see if it's malformed
+		StoppingReader reader;
+		REQUIRE(reader.Parse(R"([ { "a": [ {}, {} ] }, [], { "done": true }, { "more": 1 }, { "trunc)"));
+		REQUIRE(!reader.HasParseError());
+		REQUIRE(reader.m_Elements == 3);
+		REQUIRE(reader.m_ScalarsAfterStop == 0);
+	}
+}
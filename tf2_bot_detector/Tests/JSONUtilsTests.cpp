@@ -0,0 +1,27 @@
+#include "Util/JSONUtils.h"
+
+#include <catch2/catch.hpp>
+
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_json_find_root_string", "[tf2bd]")
+{
+	constexpr const char SCHEMA[] = "https://raw.githubusercontent.com/PazerOP/tf2_bot_detector/master/schemas/v3/playerlist.schema.json";
+
+	REQUIRE(try_find_root_string(R"({ "$schema": "https://raw.githubusercontent.com/PazerOP/tf2_bot_detector/master/schemas/v3/playerlist.schema.json", "players": [] })",
+		"$schema") == SCHEMA);
+
+	// Everything before it is skipped over, including lookalikes nested further down
+	REQUIRE(try_find_root_string("\xEF\xBB\xBF" R"({
+		"file_info": { "$schema": "nested", "authors": [ "a]}", "b\"" ] },
+		"players": [ { "steamid": 1, "attributes": [ "cheater" ], "last_seen": { "time": 1.5e9, "name": null } } ],
+		"enabled": true,
+		"$schema": "https:\/\/example.com"
+	})", "$schema") == "https://example.com");
+
+	REQUIRE(!try_find_root_string(R"({ "players": [ { "$schema": "nested" } ] })", "$schema"));
+	REQUIRE(!try_find_root_string(R"({ "$schema": 3 })", "$schema"));
+	REQUIRE(!try_find_root_string(R"([ "$schema" ])", "$schema"));
+	REQUIRE(!try_find_root_string(R"({ "players": [ { )", "$schema"));
+	REQUIRE(!try_find_root_string("", "$schema"));
+}
@@ -0,0 +1,71 @@
+#include "Util/MPSCQueue.h"
+
+#include <catch2/catch.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_mpsc_queue_single_thread", "[tf2bd]")
+{
+	MPSCQueue<int, 4> queue;
+	REQUIRE(!queue.try_pop());
+
+	for (int i = 0; i < 4; i++)
+		REQUIRE(queue.try_push(i));
+
+	int extra = 4;
+	REQUIRE(!queue.try_push(extra));
+	REQUIRE(extra == 4);
+
+	for (int i = 0; i < 4; i++)
+		REQUIRE(queue.try_pop() == i);
+
+	REQUIRE(!queue.try_pop());
+
+	// Wraps around
+	REQUIRE(queue.try_push(extra));
+	REQUIRE(queue.try_pop() == 4);
+}
+
+TEST_CASE("tf2bd_mpsc_queue_multi_producer", "[tf2bd]")
+{
+	constexpr int PRODUCER_COUNT = 4;
+	constexpr int ITEMS_PER_PRODUCER = 10000;
+
+	MPSCQueue<int, 64> queue;
+	std::vector<std::thread> producers;
+	for (int p = 0; p < PRODUCER_COUNT; p++)
+	{
+		producers.emplace_back([&, p]
+			{
+				for (int i = 0; i < ITEMS_PER_PRODUCER; i++)
+				{
+					int value = p * ITEMS_PER_PRODUCER + i;
+					while (!queue.try_push(value))
+						std::this_thread::yield();
+				}
+			});
+	}
+
+	// Every item shows up exactly once, and each producer's items stay in order
+	std::vector<int> lastSeen(PRODUCER_COUNT, -1);
+	int received = 0;
+	while (received < PRODUCER_COUNT * ITEMS_PER_PRODUCER)
+	{
+		if (auto value = queue.try_pop())
+		{
+			const int producer = *value / ITEMS_PER_PRODUCER;
+			const int index = *value % ITEMS_PER_PRODUCER;
+			REQUIRE(index == lastSeen[producer] + 1);
+			lastSeen[producer] = index;
+			received++;
+		}
+	}
+
+	for (auto& thread : producers)
+		thread.join();
+
+	REQUIRE(!queue.try_pop());
+}
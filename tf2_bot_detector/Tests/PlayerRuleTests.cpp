@@ -1,9 +1,13 @@
 #include "Config/Rules.h"
+#include "Util/SimHash.h"
 #include "IPlayer.h"
 
 #include <mh/error/not_implemented_error.hpp>
 #include <mh/text/codecvt.hpp>
 
+#include <algorithm>
+#include <iterator>
+
 #include <catch2/catch.hpp>
 
 using namespace std::string_view_literals;
@@ -79,11 +83,7 @@ namespace
 		{
 			throw mh::not_implemented_error();
 		}
-		std::any& GetOrCreateDataStorage(const std::type_index& type) override
-		{
-			throw mh::not_implemented_error();
-		}
-		const std::any* FindDataStorage(const std::type_index& type) const override
+		const PlayerDataStorage& GetDataStorage() const override
 		{
 			throw mh::not_implemented_error();
 		}
@@ -193,3 +193,192 @@ TEST_CASE("Player Rules - chatmsg word", "[PlayerRuleTests]")
 	textMatch.m_Patterns = { "smelly" };
 	REQUIRE(!rule.Match(player, chatMsg));
 }
+
+TEST_CASE("Player Rules - regex", "[PlayerRuleTests]")
+{
+	MockPlayer player;
+	player.m_Name = "Special Gamer";
+
+	ModerationRule rule;
+	rule.m_Description = "test rule - regex";
+
+	auto& usernameTextMatch = rule.m_Triggers.m_UsernameTextMatch.emplace();
+	usernameTextMatch.m_Mode = TextMatchMode::Regex;
+
+	usernameTextMatch.m_Patterns = { "special .*" };
+	usernameTextMatch.CompileRegexes();
+	REQUIRE(rule.Match(player));
+
+	usernameTextMatch.m_CaseSensitive = true;
+	usernameTextMatch.CompileRegexes();
+	REQUIRE(!rule.Match(player));
+
+	// Invalid patterns are skipped rather than failing every match
+	usernameTextMatch.m_Patterns = { "(unterminated", "Special Gamer" };
+	usernameTextMatch.CompileRegexes();
+	REQUIRE(rule.Match(player));
+}
+
+TEST_CASE("Player Rules - lookalike characters", "[PlayerRuleTests]")
+{
+	MockPlayer player;
+	player.m_Name = mh::change_encoding<char>(u8"MYG)T \u0412\u043Et"); // Cyrillic Ve and o
+
+	ModerationRule rule;
+	auto& usernameTextMatch = rule.m_Triggers.m_UsernameTextMatch.emplace();
+	usernameTextMatch.m_Mode = TextMatchMode::EndsWith;
+	usernameTextMatch.m_Patterns = { "bot" };
+
+	const CompiledRules compiled({ rule });
+	std::vector<size_t> matches;
+
+	REQUIRE(rule.Match(player));
+	compiled.FindMatches(player, {}, matches);
+	REQUIRE(matches.size() == 1);
+
+	// Case sensitive triggers match exactly what they say
+	usernameTextMatch.m_CaseSensitive = true;
+	REQUIRE(!rule.Match(player));
+	matches.clear();
+	CompiledRules({ rule }).FindMatches(player, {}, matches);
+	REQUIRE(matches.empty());
+}
+
+TEST_CASE("Player Rules - chatmsg similar", "[PlayerRuleTests]")
+{
+	MockPlayer player;
+	player.m_Name = "Special Gamer";
+
+	ModerationRule rule;
+	auto& similarMatch = rule.m_Triggers.m_ChatMsgSimilarMatch.emplace();
+	similarMatch.m_Messages = { "Join our discord at bots . tf for free hacks and skins!" };
+	similarMatch.ComputeFingerprints();
+
+	REQUIRE(rule.Match(player, "join our discord at bots.tf for free hacks and skins 4821"sv));
+	REQUIRE(!rule.Match(player, "does anyone know how to rocket jump well"sv));
+	REQUIRE(!rule.Match(player));
+
+	// Repeats of anything count too, but only from the history that was passed in
+	similarMatch.m_Messages.clear();
+	similarMatch.ComputeFingerprints();
+	similarMatch.m_RepeatCount = 3;
+
+	const CompiledRules compiled({ rule });
+	REQUIRE(compiled.HasChatMsgSimilarTriggers());
+
+	const auto msg = "buy cheap keys at example dot com"sv;
+	std::vector<uint64_t> recent;
+	for (size_t i = 0; i < 3; i++)
+	{
+		std::vector<size_t> matches;
+		compiled.FindMatches(player, msg, matches, recent);
+		REQUIRE(matches.size() == (i == 2 ? 1 : 0));
+		recent.push_back(ComputeSimHash(msg));
+	}
+}
+
+namespace
+{
+	std::vector<ModerationRule> MakeBenchmarkRules()
+	{
+		std::vector<ModerationRule> rules;
+
+		for (int i = 0; i < 250; i++)
+		{
+			ModerationRule& rule = rules.emplace_back();
+			rule.m_Triggers.m_Mode = (i % 3) ? TriggerMatchMode::MatchAny : TriggerMatchMode::MatchAll;
+
+			auto& usernameTextMatch = rule.m_Triggers.m_UsernameTextMatch.emplace();
+			usernameTextMatch.m_Mode = static_cast<TextMatchMode>(i % 4); // Equal, Contains, StartsWith, EndsWith
+			usernameTextMatch.m_CaseSensitive = (i % 2) != 0;
+			usernameTextMatch.m_Patterns = { "gamer" + std::to_string(i), "Special " + std::to_string(i) };
+
+			if (i % 5 == 0)
+			{
+				auto& chatMsgTextMatch = rule.m_Triggers.m_ChatMsgTextMatch.emplace();
+				chatMsgTextMatch.m_Mode = TextMatchMode::Word;
+				chatMsgTextMatch.m_Patterns = { "word" + std::to_string(i) };
+			}
+		}
+
+		// A few that actually match
+		rules[10].m_Triggers.m_UsernameTextMatch->m_Patterns.push_back("Special Gamer");
+		rules[25].m_Triggers.m_ChatMsgTextMatch->m_Patterns.push_back("stinky");
+		rules[41].m_Triggers.m_UsernameTextMatch->m_Patterns.push_back("Spec");
+
+		return rules;
+	}
+
+	std::vector<size_t> MatchSequentially(const std::vector<ModerationRule>& rules, const IPlayer& player,
+		const std::string_view& chatMsg)
+	{
+		std::vector<size_t> matches;
+		for (size_t i = 0; i < rules.size(); i++)
+		{
+			if (rules[i].Match(player, chatMsg))
+				matches.push_back(i);
+		}
+
+		return matches;
+	}
+
+	std::vector<size_t> MatchCompiled(const CompiledRules& rules, const IPlayer& player, const std::string_view& chatMsg)
+	{
+		std::vector<size_t> matches;
+		rules.FindMatches(player, chatMsg, matches);
+		return matches;
+	}
+}
+
+TEST_CASE("Player Rules - compiled", "[PlayerRuleTests]")
+{
+	MockPlayer player;
+	player.m_Name = "Special Gamer";
+
+	const auto rules = MakeBenchmarkRules();
+	const CompiledRules compiled(rules);
+	REQUIRE(compiled.size() == rules.size());
+
+	for (const auto chatMsg : { ""sv, "you are stinky"sv, "word5 word25"sv, "nothing to see here"sv })
+	{
+		const auto expected = MatchSequentially(rules, player, chatMsg);
+		REQUIRE(!expected.empty());
+		REQUIRE(MatchCompiled(compiled, player, chatMsg) == expected);
+
+		// What GetMatchingRules() puts together from the cached status matches
+		CompiledRules::PlayerResults results;
+		compiled.EvaluatePlayer(player, results);
+		std::vector<size_t> statusMatches, chatMatches, combined;
+		compiled.FindMatches(results, {}, statusMatches);
+		compiled.FindChatMatches(results, chatMsg, chatMatches);
+		std::set_union(statusMatches.begin(), statusMatches.end(), chatMatches.begin(), chatMatches.end(),
+			std::back_inserter(combined));
+		REQUIRE(combined == expected);
+	}
+
+	{
+		ModerationRule noTriggers;
+		noTriggers.m_Triggers.m_Mode = TriggerMatchMode::MatchAll;
+		const CompiledRules single({ noTriggers });
+		REQUIRE(MatchCompiled(single, player, "hello"sv).empty());
+	}
+}
+
+TEST_CASE("Player Rules - compiled benchmark", "[PlayerRuleTests][.][benchmark]")
+{
+	MockPlayer player;
+	player.m_Name = "Special Gamer";
+
+	const auto rules = MakeBenchmarkRules();
+	const CompiledRules compiled(rules);
+
+	BENCHMARK("ModerationRule::Match")
+	{
+		return MatchSequentially(rules, player, "you are stinky"sv).size();
+	};
+
+	BENCHMARK("CompiledRules::FindMatches")
+	{
+		return MatchCompiled(compiled, player, "you are stinky"sv).size();
+	};
+}
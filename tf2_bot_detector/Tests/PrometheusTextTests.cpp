@@ -0,0 +1,34 @@
+#include "Util/PrometheusText.h"
+
+#include <catch2/catch.hpp>
+
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_prometheus_text_grouping", "[tf2bd]")
+{
+	PrometheusTextWriter writer;
+	writer.Add("b_total", PrometheusTextWriter::MetricType::Counter, "B things", 1, { { "type", "x" } });
+	writer.Add("a_bytes", PrometheusTextWriter::MetricType::Gauge, "A size", 1.5);
+	writer.Add("b_total", PrometheusTextWriter::MetricType::Counter, "Ignored", 12345678901, { { "type", "y" } });
+
+	REQUIRE(writer.GetText() ==
+		"# HELP a_bytes A size\n"
+		"# TYPE a_bytes gauge\n"
+		"a_bytes 1.5\n"
+		"# HELP b_total B things\n"
+		"# TYPE b_total counter\n"
+		"b_total{type=\"x\"} 1\n"
+		"b_total{type=\"y\"} 12345678901\n");
+}
+
+TEST_CASE("tf2bd_prometheus_text_labels", "[tf2bd]")
+{
+	PrometheusTextWriter writer;
+	writer.SetCommonLabels({ { "session", "C:\\tf" } });
+	writer.Add("lines_total", PrometheusTextWriter::MetricType::Counter, "Lines\nparsed", 3, { { "name", "say \"hi\"" } });
+
+	REQUIRE(writer.GetText() ==
+		"# HELP lines_total Lines\\nparsed\n"
+		"# TYPE lines_total counter\n"
+		"lines_total{session=\"C:\\\\tf\",name=\"say \\\"hi\\\"\"} 3\n");
+}
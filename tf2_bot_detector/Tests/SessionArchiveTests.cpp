@@ -0,0 +1,58 @@
+#include "SessionArchive.h"
+
+#include <catch2/catch.hpp>
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_session_archive_roundtrip", "[tf2bd]")
+{
+	const auto path = std::filesystem::temp_directory_path() / "tf2bd_session_archive_test.tfbdsession";
+	const auto startTime = time_point_t(std::chrono::duration_cast<duration_t>(1602633600s));
+
+	{
+		SessionArchiveWriter writer(path, startTime);
+		REQUIRE(writer.IsOpen());
+		writer.Write(SessionArchiveRecordType::ConsoleOutput, 0us, "C:\\tf\\console.log", "10/14/2020 - 00:00:00: hello\n");
+		writer.Write(SessionArchiveRecordType::RCONResponse, 1500us, "status", std::string("a\0b", 3));
+		writer.Write(SessionArchiveRecordType::HTTPResponse, 2s, "https://example.com/a", "");
+		writer.Flush();
+	}
+
+	{
+		SessionArchiveReader reader(path);
+		REQUIRE(reader.GetStartTime() == startTime);
+
+		SessionArchiveRecord record;
+		REQUIRE(reader.ReadNext(record));
+		REQUIRE(record.m_Type == SessionArchiveRecordType::ConsoleOutput);
+		REQUIRE(record.m_Offset == 0us);
+		REQUIRE(record.m_Key == "C:\\tf\\console.log");
+		REQUIRE(record.m_Data == "10/14/2020 - 00:00:00: hello\n");
+
+		REQUIRE(reader.ReadNext(record));
+		REQUIRE(record.m_Type == SessionArchiveRecordType::RCONResponse);
+		REQUIRE(record.m_Offset == 1500us);
+		REQUIRE(record.m_Key == "status");
+		REQUIRE(record.m_Data == std::string("a\0b", 3));
+
+		REQUIRE(reader.ReadNext(record));
+		REQUIRE(record.m_Type == SessionArchiveRecordType::HTTPResponse);
+		REQUIRE(record.m_Offset == 2s);
+		REQUIRE(record.m_Data.empty());
+
+		REQUIRE(!reader.ReadNext(record));
+	}
+
+	// Cut off partway through the last record, like after a crash
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+	{
+		SessionArchiveReader reader(path);
+		SessionArchiveRecord record;
+		REQUIRE(reader.ReadNext(record));
+		REQUIRE(reader.ReadNext(record));
+		REQUIRE(!reader.ReadNext(record));
+	}
+
+	std::filesystem::remove(path);
+}
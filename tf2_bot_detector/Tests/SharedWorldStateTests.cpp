@@ -0,0 +1,87 @@
+#include "SharedWorldStateLayout.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+using namespace tf2_bot_detector;
+
+static std::unique_ptr<SharedWorldState::Region> CreateRegion()
+{
+	auto region = std::make_unique<SharedWorldState::Region>();
+	region->m_Magic = SharedWorldState::MAGIC;
+	region->m_LayoutVersion = SharedWorldState::LAYOUT_VERSION;
+	region->m_Size = sizeof(SharedWorldState::Region);
+	return region;
+}
+
+TEST_CASE("tf2bd_shared_world_state_roundtrip", "[tf2bd]")
+{
+	auto region = CreateRegion();
+	auto written = std::make_unique<SharedWorldState::Data>();
+	auto read = std::make_unique<SharedWorldState::Data>();
+
+	written->m_WorldVersion = 7;
+	written->m_PlayerCount = 1;
+	written->m_Players[0].m_SteamID = 76561198003911389;
+	written->m_Players[0].m_Marks = 1;
+	SharedWorldState::Write(*region, *written);
+
+	REQUIRE(region->m_Sequence == 2);
+	REQUIRE(SharedWorldState::TryRead(*region, *read));
+	REQUIRE(read->m_WorldVersion == 7);
+	REQUIRE(read->m_PlayerCount == 1);
+	REQUIRE(read->m_Players[0].m_SteamID == 76561198003911389);
+	REQUIRE(read->m_Players[0].m_Marks == 1);
+
+	// Mid-write
+	region->m_Sequence = 3;
+	REQUIRE(!SharedWorldState::TryRead(*region, *read));
+
+	// Someone else's layout
+	region->m_Sequence = 4;
+	region->m_LayoutVersion = SharedWorldState::LAYOUT_VERSION + 1;
+	REQUIRE(!SharedWorldState::TryRead(*region, *read));
+}
+
+TEST_CASE("tf2bd_shared_world_state_no_torn_reads", "[tf2bd]")
+{
+	auto region = CreateRegion();
+	constexpr uint64_t WRITE_COUNT = 20'000;
+
+	std::thread writer([&]
+		{
+			auto data = std::make_unique<SharedWorldState::Data>();
+			for (uint64_t i = 1; i <= WRITE_COUNT; i++)
+			{
+				data->m_WorldVersion = i;
+				data->m_PlayerCount = SharedWorldState::MAX_PLAYERS;
+				for (auto& player : data->m_Players)
+					player.m_SteamID = i;
+
+				SharedWorldState::Write(*region, *data);
+			}
+		});
+
+	auto data = std::make_unique<SharedWorldState::Data>();
+	uint64_t lastVersion = 0;
+	while (lastVersion < WRITE_COUNT)
+	{
+		if (!SharedWorldState::TryRead(*region, *data) || data->m_PlayerCount == 0)
+			continue;
+
+		// Every player comes from the same write
+		bool torn = false;
+		for (const auto& player : data->m_Players)
+			torn |= player.m_SteamID != data->m_WorldVersion;
+
+		REQUIRE(!torn);
+
+		REQUIRE(data->m_WorldVersion >= lastVersion);
+		lastVersion = data->m_WorldVersion;
+	}
+
+	writer.join();
+}
@@ -0,0 +1,28 @@
+#include "Util/SimHash.h"
+
+#include <catch2/catch.hpp>
+
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_simhash", "[tf2bd]")
+{
+	const auto Distance = [](const std::string_view& lhs, const std::string_view& rhs)
+	{
+		return GetSimHashDistance(ComputeSimHash(lhs), ComputeSimHash(rhs));
+	};
+
+	constexpr std::string_view SPAM = "Join our discord at bots . tf for free hacks and skins!";
+
+	REQUIRE(ComputeSimHash("") == 0);
+	REQUIRE(ComputeSimHash("...") == 0);
+	REQUIRE(ComputeSimHash("ab") != ComputeSimHash("ba"));
+
+	// Case, whitespace and punctuation don't count
+	REQUIRE(Distance(SPAM, "JOIN OUR DISCORD AT BOTS.TF FOR FREE HACKS AND SKINS!!!") == 0);
+
+	REQUIRE(Distance(SPAM, "Join our discord at bots . tf for free hacks and skins! 4821") <= 12);
+	REQUIRE(Distance(SPAM, "Join our discorrd at bots . tf for free hacks & skins!") <= 12);
+
+	REQUIRE(Distance(SPAM, "does anyone know how to rocket jump well") >= 20);
+	REQUIRE(Distance(SPAM, "Visit cathook dot tf for the best free cheat") >= 20);
+}
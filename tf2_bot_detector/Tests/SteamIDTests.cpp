@@ -0,0 +1,131 @@
+#include "SteamID.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include <random>
+#include <regex>
+#include <string>
+
+using namespace std::string_view_literals;
+using namespace tf2_bot_detector;
+
+static_assert(ParseSteamID("[U:1:1118537734]").m_ID64 == 76561197960265728 + 1118537734);
+static_assert(ParseSteamID("76561197960287930").m_ID64 == 76561197960287930);
+static_assert(ParseSteamID("[X:1:1]").m_Error == SteamIDParseError::UnknownAccountType);
+static_assert(ParseSteamID("[U:1:]").m_Error == SteamIDParseError::UnknownFormat);
+
+// The std::regex based parser this replaced, where nullopt means it threw
+static std::optional<uint64_t> ParseSteamIDReference(const std::string_view& str)
+{
+	const auto FromChars = [](const std::string_view& s, auto& value)
+	{
+		return std::from_chars(s.data(), s.data() + s.size(), value).ec == std::errc{};
+	};
+
+	static const std::regex s_SteamID3Regex(R"regex(\[([a-zA-Z]):(\d):(\d+)(?::(\d+))?\])regex", std::regex::optimize);
+	if (std::match_results<std::string_view::const_iterator> result;
+		std::regex_match(str.begin(), str.end(), result, s_SteamID3Regex))
+	{
+		const auto Sub = [&](int i) { return std::string_view(&*result[i].first, result[i].length()); };
+
+		SteamAccountType type;
+		switch (*result[1].first)
+		{
+		case 'U': type = SteamAccountType::Individual; break;
+		case 'M': type = SteamAccountType::Multiseat; break;
+		case 'G': type = SteamAccountType::GameServer; break;
+		case 'A': type = SteamAccountType::AnonGameServer; break;
+		case 'P': type = SteamAccountType::Pending; break;
+		case 'C': type = SteamAccountType::ContentServer; break;
+		case 'g': type = SteamAccountType::Clan; break;
+		case 'a': type = SteamAccountType::AnonUser; break;
+		case 'T':
+		case 'L':
+		case 'c':
+			type = SteamAccountType::Chat; break;
+		case 'I':
+			return 0;
+		default:
+			return std::nullopt;
+		}
+
+		uint32_t universe, id, instance = uint32_t(SteamAccountInstance::Desktop);
+		if (!FromChars(Sub(2), universe) || !FromChars(Sub(3), id))
+			return std::nullopt;
+		if (result[4].matched && !FromChars(Sub(4), instance))
+			return std::nullopt;
+
+		return SteamID(id, type, SteamAccountUniverse(universe), SteamAccountInstance(instance)).ID64;
+	}
+
+	if (std::all_of(str.begin(), str.end(), [](char c) { return std::isdigit(uint8_t(c)) || std::isspace(uint8_t(c)); }))
+	{
+		uint64_t id64;
+		if (!FromChars(str, id64))
+			return std::nullopt;
+
+		return id64;
+	}
+
+	return std::nullopt;
+}
+
+static std::optional<uint64_t> ParseSteamIDNew(const std::string_view& str)
+{
+	try
+	{
+		return SteamID(str).ID64;
+	}
+	catch (const std::invalid_argument&)
+	{
+		return std::nullopt;
+	}
+}
+
+TEST_CASE("tf2bd_steamid_parse", "[tf2bd]")
+{
+	constexpr std::string_view KNOWN[] =
+	{
+		"[U:1:1118537734]", "[U:1:0]", "[U:1:4294967295]", "[U:1:4294967296]", "[U:1:00012]",
+		"[U:1:123:1]", "[U:1:123:4]", "[U:1:123:1048577]", "[U:1:123:99999999999]", "[U:1:123:]",
+		"[G:1:123]", "[A:2:123]", "[g:1:123]", "[c:1:123]", "[T:1:123]", "[I:0:0]", "[I:9:99999999999]",
+		"[X:1:123]", "[U:12:123]", "[U:1:12a]", "[U:1:123", "U:1:123]", "[U1:123]", "[:1:123]",
+		"76561198003911389", "18446744073709551615", "18446744073709551616", "0",
+		"76561198003911389 ", " 76561198003911389", "7656 1198", "\t\n", "", "765611980039113890000",
+		"7656119800391138a", "[]", "[", "]",
+	};
+
+	for (const auto& str : KNOWN)
+	{
+		INFO(str);
+		REQUIRE(ParseSteamIDNew(str) == ParseSteamIDReference(str));
+	}
+
+	// Random strings that are mostly SteamID-shaped
+	std::mt19937 random(1234);
+	constexpr std::string_view ALPHABET = "[[]]::::UUIIgc0123456789 \t";
+	std::uniform_int_distribution<size_t> lengthDist(0, 24);
+	std::uniform_int_distribution<size_t> charDist(0, ALPHABET.size() - 1);
+
+	for (size_t i = 0; i < 200000; i++)
+	{
+		std::string str;
+
+		// Start with a valid prefix some of the time, otherwise we'd rarely get past the brackets
+		if (i % 2)
+			str = "[U:1:";
+
+		const size_t length = lengthDist(random);
+		for (size_t c = 0; c < length; c++)
+			str += ALPHABET[charDist(random)];
+
+		if (i % 3 == 0)
+			str += ']';
+
+		INFO(str);
+		REQUIRE(ParseSteamIDNew(str) == ParseSteamIDReference(str));
+	}
+}
@@ -0,0 +1,25 @@
+#include "Util/TextFolding.h"
+
+#include <catch2/catch.hpp>
+
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_text_folding", "[tf2bd]")
+{
+	REQUIRE(FoldText("") == "");
+	REQUIRE(FoldText("MYG)T[Bot] Hello_123!") == "myg)t[bot] hello_123!");
+
+	// Cyrillic and Greek lookalikes
+	REQUIRE(FoldText("\xD0\xA0\xD0\xB0z\xD0\xB5r \xCE\x9F\xD1\x81") == "pazer oc");
+
+	// Fullwidth, math bold (U+1D401 = bold B) and circled letters
+	REQUIRE(FoldText("\xEF\xBC\xA2\xEF\xBD\x8F\xEF\xBD\x94") == "bot");
+	REQUIRE(FoldText("\xF0\x9D\x90\x81ot \xE2\x93\x91\xE2\x93\x9E\xE2\x93\xA3") == "bot bot");
+
+	// Invisible characters and combining marks are dropped, odd spaces are plain spaces
+	REQUIRE(FoldText("b\xE2\x80\x8Bo\xCC\x81t\xC2\xA0" "bot") == "bot bot");
+
+	// Everything else, including invalid UTF-8, is left alone
+	REQUIRE(FoldText("\xE6\x97\xA5\xE6\x9C\xAC") == "\xE6\x97\xA5\xE6\x9C\xAC");
+	REQUIRE(FoldText("a\xFF\xC3") == "a\xFF\xC3");
+}
@@ -0,0 +1,48 @@
+#include "Util/TextUtils.h"
+
+#include <catch2/catch.hpp>
+
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_textutils_small_string_conversions", "[tf2bd]")
+{
+	SECTION("ASCII")
+	{
+		const std::string ascii = "+exec tf_bot_detector/temp_cfg_0.cfg; say \"hello there, this is long enough for the fast path\"";
+		const auto wide = ToWCSmall(ascii);
+		REQUIRE(wide.view() == ToWC(ascii));
+		REQUIRE(wide.c_str()[wide.size()] == 0);
+		REQUIRE(wide.IsInline());
+		REQUIRE(ToMBSmall(wide).view() == ascii);
+	}
+
+	SECTION("Non-ASCII")
+	{
+		const std::string text = "Player \xD0\x92\xD0\xBE\x74 says gg \xF0\x9F\x98\xA1 then leaves the server, 0123456789abcdef \xC3\xA9";
+		const auto wide = ToWCSmall(text);
+		REQUIRE(wide.view() == ToWC(text));
+		REQUIRE(ToMBSmall(wide).view() == text);
+	}
+
+	SECTION("Malformed")
+	{
+		REQUIRE(ToWCSmall("a\xFF" "b").view() == L"a\uFFFDb");
+		REQUIRE(ToWCSmall("\xE2\x82").view() == L"\uFFFD\uFFFD");
+	}
+
+	SECTION("Heap fallback")
+	{
+		const std::string longText(1000, 'x');
+		SmallString<wchar_t, 16> wide;
+		AppendWC(wide, "prefix ");
+		AppendWC(wide, longText);
+		REQUIRE(!wide.IsInline());
+		REQUIRE(wide.size() == 1007);
+		REQUIRE(wide.view().substr(0, 7) == L"prefix ");
+		REQUIRE(wide.c_str()[wide.size()] == 0);
+
+		auto moved = std::move(wide);
+		REQUIRE(moved.size() == 1007);
+		REQUIRE(wide.empty());
+	}
+}
@@ -0,0 +1,52 @@
+#include "Util/TimeSeries.h"
+
+#include <catch2/catch.hpp>
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+TEST_CASE("tf2bd_time_series", "[tf2bd]")
+{
+	using Series = TimeSeries<4, 2>;
+	Series series({ 0s, 10s });
+
+	REQUIRE(series.IsEmpty());
+
+	const time_point_t start{};
+	for (int i = 0; i < 12; i++)
+		series.Add(start + std::chrono::seconds(i * 3), float(i));
+
+	REQUIRE(!series.IsEmpty());
+	REQUIRE(series.GetLatest().m_Max == 11);
+
+	// Only the last 4 samples are kept at full resolution
+	const auto& raw = series.GetBuckets(0);
+	REQUIRE(raw.size() == 4);
+	REQUIRE(raw.front().m_Min == 8);
+	REQUIRE(raw.back().m_Max == 11);
+
+	// 0-9s: 0, 1, 2, 3. 10-19s: 4, 5, 6. 20-29s: 7, 8, 9. 30-39s: 10, 11
+	const auto& coarse = series.GetBuckets(1);
+	REQUIRE(coarse.size() == 4);
+	REQUIRE(coarse[0].m_Begin == start);
+	REQUIRE(coarse[0].m_Min == 0);
+	REQUIRE(coarse[0].m_Max == 3);
+	REQUIRE(coarse[0].m_Count == 4);
+	REQUIRE(coarse[1].m_Begin == start + 10s);
+	REQUIRE(coarse[1].GetAverage() == 5);
+	REQUIRE(coarse[3].m_Min == 10);
+	REQUIRE(coarse[3].m_Max == 11);
+
+	const time_point_t now = start + 33s;
+	REQUIRE(series.FindTier(now, 9s) == 0);
+	REQUIRE(series.FindTier(now, 30s) == 1);
+	REQUIRE(series.FindTier(now, 10min) == 1);
+
+	// Out of order samples are folded into the newest bucket
+	series.Add(start + 1s, 100);
+	REQUIRE(series.GetBuckets(1).back().m_Max == 100);
+	REQUIRE(series.GetBuckets(1).front().m_Max == 3);
+
+	series.Clear();
+	REQUIRE(series.IsEmpty());
+}
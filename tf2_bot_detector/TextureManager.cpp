@@ -1,5 +1,8 @@
 #include "TextureManager.h"
 #include "Bitmap.h"
+#include "Clock.h"
+#include "Util/MemoryTracker.h"
+#include "Util/StartupTimeline.h"
 
 #if IMGUI_USE_GLBINDING
 #define GLBINDING_AVAILABLE 1
@@ -15,10 +18,17 @@ using namespace gl21;
 #include <gl/GL.h>
 #endif
 #include <mh/concurrency/thread_sentinel.hpp>
+#include <mh/coroutine/future.hpp>
 #include <mh/memory/unique_object.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <mutex>
 #include <set>
+#include <vector>
 
 using namespace tf2_bot_detector;
 
@@ -56,12 +66,66 @@ namespace
 
 		uint16_t GetWidth() const override { return m_Width; }
 		uint16_t GetHeight() const override { return m_Height; }
+		TextureUVs GetUVs() const override { return {}; }
 
 	private:
 		TextureHandle m_Handle{};
 		TextureSettings m_Settings{};
 		uint16_t m_Width{};
 		uint16_t m_Height{};
+		TrackedMemory m_TrackedMemory;
+	};
+
+	// One GL texture split up into a grid of same sized cells, each holding one small image
+	class AtlasPage final
+	{
+	public:
+		static constexpr uint16_t CELLS_PER_SIDE = 16;
+		static constexpr size_t CELL_COUNT = size_t(CELLS_PER_SIDE) * CELLS_PER_SIDE;
+
+		// Left transparent around every image, so linear filtering doesn't bleed in the neighbours
+		static constexpr uint16_t CELL_PADDING = 1;
+
+		AtlasPage(uint16_t maxEntrySize);
+
+		GLuint GetHandle() const { return m_Handle; }
+		uint16_t GetMaxEntrySize() const { return m_MaxEntrySize; }
+		bool IsFull() const { return m_FreeCells.empty(); }
+
+		size_t Allocate(const Bitmap& bitmap);
+		void Free(size_t cell);
+		TextureUVs GetUVs(size_t cell, uint16_t width, uint16_t height) const;
+
+	private:
+		uint16_t GetSideLength() const { return m_CellSize * CELLS_PER_SIDE; }
+
+		uint16_t m_MaxEntrySize{};
+		uint16_t m_CellSize{};
+		TextureHandle m_Handle{};
+		std::vector<size_t> m_FreeCells;
+		TrackedMemory m_TrackedMemory;
+	};
+
+	class AtlasTexture final : public ITexture
+	{
+	public:
+		AtlasTexture(std::shared_ptr<AtlasPage> page, const Bitmap& bitmap);
+		~AtlasTexture();
+
+		handle_type GetHandle() const override { return m_Page->GetHandle(); }
+		const TextureSettings& GetSettings() const override { return m_Settings; }
+
+		uint16_t GetWidth() const override { return m_Width; }
+		uint16_t GetHeight() const override { return m_Height; }
+		TextureUVs GetUVs() const override { return m_UVs; }
+
+	private:
+		std::shared_ptr<AtlasPage> m_Page;
+		size_t m_Cell{};
+		TextureSettings m_Settings{};
+		uint16_t m_Width{};
+		uint16_t m_Height{};
+		TextureUVs m_UVs{};
 	};
 
 	class TextureManager final : public ITextureManager
@@ -71,7 +135,9 @@ namespace
 
 		void EndFrame() override;
 		std::shared_ptr<ITexture> CreateTexture(const Bitmap& bitmap, const TextureSettings& settings) override;
-		size_t GetActiveTextureCount() const override { return m_Textures.size(); }
+		mh::task<std::shared_ptr<ITexture>> CreateTextureAsync(const Bitmap& bitmap, const TextureSettings& settings) override;
+		std::shared_ptr<ITexture> CreateAtlasTexture(const Bitmap& bitmap) override;
+		size_t GetActiveTextureCount() const override { return m_Textures.size() + m_AtlasPages.size(); }
 
 #ifdef IMGUI_USE_GLBINDING
 		bool HasExtension(GLextension ext) const { return GetExtensions().contains(ext); }
@@ -88,12 +154,30 @@ namespace
 
 		uint64_t m_FrameCount{};
 		std::vector<std::shared_ptr<Texture>> m_Textures;
+
+		// Always at least one upload per frame, no matter how long it takes
+		static constexpr duration_t UPLOAD_TIME_BUDGET = std::chrono::milliseconds(2);
+		void ProcessPendingUploads();
+
+		struct PendingUpload
+		{
+			Bitmap m_Bitmap;
+			TextureSettings m_Settings;
+			mh::promise<std::shared_ptr<ITexture>> m_Promise;
+		};
+		std::mutex m_PendingUploadsMutex;
+		std::deque<PendingUpload> m_PendingUploads;
+
+		// Kept alive by everything packed into them, dropped once they're empty
+		std::vector<std::shared_ptr<AtlasPage>> m_AtlasPages;
+		std::vector<std::shared_ptr<AtlasTexture>> m_AtlasTextures;
 		mh::thread_sentinel m_Sentinel;
 	};
 }
 
 std::shared_ptr<ITextureManager> tf2_bot_detector::ITextureManager::Create()
 {
+	TF2BD_STARTUP_PHASE("ITextureManager::Create");
 	return std::make_unique<TextureManager>();
 }
 
@@ -111,6 +195,62 @@ void TextureManager::EndFrame()
 		{
 			return t.use_count() == 1;
 		});
+
+	// Textures free their cells here on the main thread, then the pages they leave empty go too
+	std::erase_if(m_AtlasTextures, [](const std::shared_ptr<AtlasTexture>& t)
+		{
+			return t.use_count() == 1;
+		});
+	std::erase_if(m_AtlasPages, [](const std::shared_ptr<AtlasPage>& page)
+		{
+			return page.use_count() == 1;
+		});
+
+	ProcessPendingUploads();
+}
+
+void TextureManager::ProcessPendingUploads()
+{
+	const auto startTime = tfbd_clock_t::now();
+
+	do
+	{
+		PendingUpload upload;
+		{
+			std::lock_guard lock(m_PendingUploadsMutex);
+			if (m_PendingUploads.empty())
+				break;
+
+			upload = std::move(m_PendingUploads.front());
+			m_PendingUploads.pop_front();
+		}
+
+		try
+		{
+			upload.m_Promise.set_value(CreateTexture(upload.m_Bitmap, upload.m_Settings));
+		}
+		catch (...)
+		{
+			upload.m_Promise.set_exception(std::current_exception());
+		}
+
+	} while ((tfbd_clock_t::now() - startTime) < UPLOAD_TIME_BUDGET);
+}
+
+mh::task<std::shared_ptr<ITexture>> TextureManager::CreateTextureAsync(const Bitmap& bitmap, const TextureSettings& settings)
+{
+	PendingUpload upload{ {}, settings };
+	if (!bitmap.empty())
+	{
+		upload.m_Bitmap = Bitmap(bitmap.GetWidth(), bitmap.GetHeight(), bitmap.GetChannelCount());
+		std::memcpy(upload.m_Bitmap.GetData(), bitmap.GetData(), bitmap.GetDataSize());
+	}
+
+	auto task = upload.m_Promise.get_task();
+
+	std::lock_guard lock(m_PendingUploadsMutex);
+	m_PendingUploads.push_back(std::move(upload));
+	return task;
 }
 
 std::shared_ptr<ITexture> TextureManager::CreateTexture(const Bitmap& bitmap, const TextureSettings& settings)
@@ -119,10 +259,111 @@ std::shared_ptr<ITexture> TextureManager::CreateTexture(const Bitmap& bitmap, co
 	return m_Textures.emplace_back(std::make_shared<Texture>(*this, bitmap, settings));
 }
 
+std::shared_ptr<ITexture> TextureManager::CreateAtlasTexture(const Bitmap& bitmap)
+{
+	m_Sentinel.check();
+
+	if (bitmap.GetWidth() > MAX_ATLAS_ENTRY_SIZE || bitmap.GetHeight() > MAX_ATLAS_ENTRY_SIZE)
+		return CreateTexture(bitmap, {});
+
+	// Round up a little, so similar sized images end up sharing pages
+	constexpr uint16_t SIZE_GRANULARITY = 8;
+	const auto largestSide = std::max(bitmap.GetWidth(), bitmap.GetHeight());
+	const auto entrySize = uint16_t((largestSide + SIZE_GRANULARITY - 1) / SIZE_GRANULARITY * SIZE_GRANULARITY);
+
+	auto page = std::find_if(m_AtlasPages.begin(), m_AtlasPages.end(), [&](const std::shared_ptr<AtlasPage>& p)
+		{
+			return p->GetMaxEntrySize() == entrySize && !p->IsFull();
+		});
+
+	std::shared_ptr<AtlasPage> atlasPage = (page != m_AtlasPages.end()) ? *page :
+		m_AtlasPages.emplace_back(std::make_shared<AtlasPage>(entrySize));
+
+	return m_AtlasTextures.emplace_back(std::make_shared<AtlasTexture>(std::move(atlasPage), bitmap));
+}
+
+AtlasPage::AtlasPage(uint16_t maxEntrySize) :
+	m_MaxEntrySize(maxEntrySize),
+	m_CellSize(uint16_t(maxEntrySize + CELL_PADDING * 2)),
+	m_TrackedMemory(MemoryCategory::Textures, size_t(GetSideLength()) * GetSideLength() * 4)
+{
+	// Handed out lowest first
+	m_FreeCells.reserve(CELL_COUNT);
+	for (size_t i = CELL_COUNT; i > 0; i--)
+		m_FreeCells.push_back(i - 1);
+
+	glGenTextures(1, &m_Handle.reset_and_get_ref());
+	assert(m_Handle);
+
+	glBindTexture(GL_TEXTURE_2D, m_Handle);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, GetSideLength(), GetSideLength(), 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+}
+
+size_t AtlasPage::Allocate(const Bitmap& bitmap)
+{
+	assert(!IsFull());
+	assert(bitmap.GetWidth() <= m_MaxEntrySize && bitmap.GetHeight() <= m_MaxEntrySize);
+
+	const size_t cell = m_FreeCells.back();
+	m_FreeCells.pop_back();
+
+	// The whole cell is uploaded, padding and all, so nothing from a previous image is left behind.
+	// Everything is expanded to RGBA since the page can't swizzle per image.
+	std::vector<uint8_t> pixels(size_t(m_CellSize) * m_CellSize * 4);
+	const auto* src = static_cast<const uint8_t*>(bitmap.GetData());
+	const auto channels = bitmap.GetChannelCount();
+	for (uint32_t y = 0; y < bitmap.GetHeight(); y++)
+	{
+		Bitmap::ConvertPixels(src + size_t(y) * bitmap.GetWidth() * channels, channels,
+			pixels.data() + (size_t(y + CELL_PADDING) * m_CellSize + CELL_PADDING) * 4, 4, bitmap.GetWidth());
+	}
+
+	const auto cellX = GLint(cell % CELLS_PER_SIDE) * m_CellSize;
+	const auto cellY = GLint(cell / CELLS_PER_SIDE) * m_CellSize;
+	glBindTexture(GL_TEXTURE_2D, m_Handle);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, cellX, cellY, m_CellSize, m_CellSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	return cell;
+}
+
+void AtlasPage::Free(size_t cell)
+{
+	assert(cell < CELL_COUNT);
+	assert(std::find(m_FreeCells.begin(), m_FreeCells.end(), cell) == m_FreeCells.end());
+	m_FreeCells.push_back(cell);
+}
+
+TextureUVs AtlasPage::GetUVs(size_t cell, uint16_t width, uint16_t height) const
+{
+	const float side = GetSideLength();
+	const float x = float((cell % CELLS_PER_SIDE) * m_CellSize + CELL_PADDING);
+	const float y = float((cell / CELLS_PER_SIDE) * m_CellSize + CELL_PADDING);
+
+	return { x / side, y / side, (x + width) / side, (y + height) / side };
+}
+
+AtlasTexture::AtlasTexture(std::shared_ptr<AtlasPage> page, const Bitmap& bitmap) :
+	m_Page(std::move(page)),
+	m_Cell(m_Page->Allocate(bitmap)),
+	m_Width(uint16_t(bitmap.GetWidth())),
+	m_Height(uint16_t(bitmap.GetHeight())),
+	m_UVs(m_Page->GetUVs(m_Cell, m_Width, m_Height))
+{
+}
+
+AtlasTexture::~AtlasTexture()
+{
+	m_Page->Free(m_Cell);
+}
+
 Texture::Texture(const TextureManager& manager, const Bitmap& bitmap, const TextureSettings& settings) :
 	m_Settings(settings),
 	m_Width(bitmap.GetWidth()),
-	m_Height(bitmap.GetHeight())
+	m_Height(bitmap.GetHeight()),
+	// Roughly what the driver keeps around for it
+	m_TrackedMemory(MemoryCategory::Textures, size_t(bitmap.GetWidth()) * bitmap.GetHeight() * bitmap.GetChannelCount())
 {
 	GLenum internalFormat{};
 	GLenum sourceFormat{};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <mh/coroutine/task.hpp>
+
+#include <cstdint>
 #include <memory>
 
 namespace tf2_bot_detector
@@ -11,6 +14,15 @@ namespace tf2_bot_detector
 		bool m_EnableMips = false;
 	};
 
+	// Normalized coordinates of a texture's pixels inside its GetHandle()
+	struct TextureUVs
+	{
+		float m_U0 = 0;
+		float m_V0 = 0;
+		float m_U1 = 1;
+		float m_V1 = 1;
+	};
+
 	class ITexture
 	{
 	public:
@@ -23,6 +35,9 @@ namespace tf2_bot_detector
 
 		virtual uint16_t GetWidth() const = 0;
 		virtual uint16_t GetHeight() const = 0;
+
+		// Textures from an atlas share their handle with others, only standalone textures cover all of it
+		virtual TextureUVs GetUVs() const = 0;
 	};
 
 	class ITextureManager
@@ -37,6 +52,17 @@ namespace tf2_bot_detector
 		virtual std::shared_ptr<ITexture> CreateTexture(const Bitmap& bitmap,
 			const TextureSettings& settings = {}) = 0;
 
+		// Safe to call from any thread. The pixels are copied, then uploaded at the end of a frame
+		// (where the task completes), a few per frame so a burst of new images doesn't hitch the UI.
+		virtual mh::task<std::shared_ptr<ITexture>> CreateTextureAsync(const Bitmap& bitmap,
+			const TextureSettings& settings = {}) = 0;
+
+		// Packs small images (icons, small avatars) into a few shared textures, so drawing a bunch
+		// of them doesn't need a texture switch for each one. Bigger images get their own texture.
+		static constexpr uint16_t MAX_ATLAS_ENTRY_SIZE = 64;
+		virtual std::shared_ptr<ITexture> CreateAtlasTexture(const Bitmap& bitmap) = 0;
+
+		// GL textures, an atlas page counts once no matter how many textures are packed into it
 		virtual size_t GetActiveTextureCount() const = 0;
 	};
 }
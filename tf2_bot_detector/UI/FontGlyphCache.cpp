@@ -0,0 +1,134 @@
+#include "FontGlyphCache.h"
+#include "Platform/Platform.h"
+#include "Filesystem.h"
+#include "Log.h"
+
+#include <limits>
+
+using namespace tf2_bot_detector;
+
+// ImGui's default glyph ranges, always baked into the base fonts
+static constexpr unsigned int BASE_CODEPOINT_MAX = 0xFF;
+
+static unsigned int DecodeUTF8(std::string_view& text)
+{
+	const auto lead = uint8_t(text.front());
+	text.remove_prefix(1);
+
+	size_t length;
+	unsigned int codepoint;
+	if (lead < 0x80)
+		return lead;
+	else if ((lead & 0xE0) == 0xC0)
+		length = 1, codepoint = lead & 0x1F;
+	else if ((lead & 0xF0) == 0xE0)
+		length = 2, codepoint = lead & 0x0F;
+	else if ((lead & 0xF8) == 0xF0)
+		length = 3, codepoint = lead & 0x07;
+	else
+		return 0; // Stray continuation byte or garbage
+
+	for (size_t i = 0; i < length; i++)
+	{
+		if (text.empty() || (uint8_t(text.front()) & 0xC0) != 0x80)
+			return 0;
+
+		codepoint = (codepoint << 6) | (uint8_t(text.front()) & 0x3F);
+		text.remove_prefix(1);
+	}
+
+	return codepoint;
+}
+
+void FontGlyphCache::QueueText(const std::string_view& utf8)
+{
+	std::string_view remaining = utf8;
+	while (!remaining.empty())
+	{
+		// Fast path for the usual all-ASCII name
+		if (uint8_t(remaining.front()) < 0x80)
+		{
+			remaining.remove_prefix(1);
+			continue;
+		}
+
+		const unsigned int codepoint = DecodeUTF8(remaining);
+		if (codepoint <= BASE_CODEPOINT_MAX || codepoint > std::numeric_limits<ImWchar>::max())
+			continue; // Already there, or ImGui was built without IMGUI_USE_WCHAR32 and can't show it
+
+		if (m_Codepoints.insert(ImWchar(codepoint)).second)
+		{
+			m_HasPending = true;
+			m_RangesDirty = true;
+		}
+	}
+}
+
+void FontGlyphCache::UpdateGlyphRanges()
+{
+	if (!m_RangesDirty)
+		return;
+
+	m_GlyphRanges.clear();
+	for (ImWchar codepoint : m_Codepoints)
+	{
+		// Coalesce runs of consecutive codepoints into one range
+		if (!m_GlyphRanges.empty() && m_GlyphRanges.back() == codepoint - 1)
+			m_GlyphRanges.back() = codepoint;
+		else
+		{
+			m_GlyphRanges.push_back(codepoint);
+			m_GlyphRanges.push_back(codepoint);
+		}
+	}
+
+	m_GlyphRanges.push_back(0);
+	m_RangesDirty = false;
+}
+
+void FontGlyphCache::LoadFallbackFonts()
+{
+	if (m_FallbackFontsLoaded)
+		return;
+
+	m_FallbackFontsLoaded = true;
+
+	for (const auto& path : GetFallbackFontPaths())
+	{
+		try
+		{
+			if (auto data = IFilesystem::Get().ReadFile(path); !data.empty())
+				m_FallbackFontData.push_back(std::move(data));
+		}
+		catch (...)
+		{
+			LogException("Failed to load fallback font {}", path);
+		}
+	}
+
+	if (m_FallbackFontData.empty())
+		LogWarning("No fallback fonts found, names outside of Latin-1 will show up as '?'");
+}
+
+void FontGlyphCache::MergeFallbackFonts(ImFontAtlas& atlas, float sizePixels, const ImFontConfig& baseConfig)
+{
+	if (m_Codepoints.empty())
+		return;
+
+	LoadFallbackFonts();
+	UpdateGlyphRanges();
+
+	ImFontConfig config = baseConfig;
+	config.MergeMode = true;
+	config.FontDataOwnedByAtlas = false;
+	config.OversampleH = config.OversampleV = 1;
+	config.PixelSnapH = true;
+
+	// Glyphs that an earlier font already provided are skipped, so the order of the fallback
+	// fonts decides which one wins
+	for (std::string& data : m_FallbackFontData)
+	{
+		atlas.AddFontFromMemoryTTF(data.data(), int(data.size()), sizePixels, &config,
+			m_GlyphRanges.Data);
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	// Our fonts only cover Latin-1, and loading full CJK/Cyrillic/etc ranges up front would take a
+	// long time and a huge atlas. Instead, text we're about to draw is fed through here, and any
+	// codepoints we haven't seen yet are pulled in from the system's fallback fonts the next time
+	// the atlas is rebuilt.
+	class FontGlyphCache final
+	{
+	public:
+		// Cheap enough to call on every string that's about to be drawn
+		void QueueText(const std::string_view& utf8);
+		bool HasPending() const { return m_HasPending; }
+
+		// Merges the fallback fonts into the most recently added font of atlas. Glyph ranges and
+		// font data stay owned by us, so this can be repeated for every font in the atlas.
+		void MergeFallbackFonts(ImFontAtlas& atlas, float sizePixels, const ImFontConfig& baseConfig);
+
+		// Call once the rebuilt atlas has everything queued so far. Codepoints that none of the
+		// fallback fonts had are still remembered, so they don't trigger another rebuild.
+		void OnAtlasRebuilt() { m_HasPending = false; }
+
+	private:
+		void UpdateGlyphRanges();
+		void LoadFallbackFonts();
+
+		// Everything we've ever asked the atlas for, beyond what the base fonts already cover
+		std::set<ImWchar> m_Codepoints;
+		bool m_HasPending = false;
+		bool m_RangesDirty = false;
+
+		// Must outlive the atlas build, ImGui only keeps a pointer to it
+		ImVector<ImWchar> m_GlyphRanges;
+
+		bool m_FallbackFontsLoaded = false;
+		std::vector<std::string> m_FallbackFontData;
+	};
+}
@@ -7,14 +7,20 @@
 #include "Networking/SteamAPI.h"
 #include "Networking/LogsTFAPI.h"
 #include "TextureManager.h"
+#include "Util/Profiler.h"
 
 #include <imgui_desktop/ScopeGuards.h>
 #include <imgui_desktop/StorageHelper.h>
 #include <mh/math/interpolation.hpp>
 #include <mh/text/fmtstr.hpp>
+#include <mh/text/format.hpp>
 #include <mh/text/formatters/error_code.hpp>
 
+#include <optional>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 using namespace std::chrono_literals;
 using namespace std::string_view_literals;
@@ -22,6 +28,8 @@ using namespace tf2_bot_detector;
 
 void MainWindow::OnDrawScoreboard()
 {
+	TF2BD_PROFILE_SCOPE("MainWindow::OnDrawScoreboard");
+
 	const auto& style = ImGui::GetStyle();
 	const auto currentFontScale = ImGui::GetCurrentFontScale();
 
@@ -123,8 +131,42 @@ void MainWindow::OnDrawScoreboard()
 				ImGui::Separator();
 			}
 
+			struct DrawnRow
+			{
+				IPlayer* m_Player;
+				ScoreboardRow* m_Row;
+			};
+			std::vector<DrawnRow> rows;
+
+			const auto curTime = FrameClock::Now();
+			m_ScoreboardFrame++;
 			for (IPlayer& player : m_MainState->GeneratePlayerPrintData())
-				OnDrawScoreboardRow(player);
+			{
+				auto& row = m_ScoreboardRows[player.GetSteamID()];
+				row.m_LastDrawnFrame = m_ScoreboardFrame;
+
+				if (row.m_StatusUpdateTime != player.GetLastStatusUpdateTime() ||
+					(curTime - row.m_RefreshTime) >= SCOREBOARD_ROW_REFRESH_INTERVAL)
+				{
+					UpdateScoreboardRow(player, row);
+					m_GlyphCache.QueueText(row.m_Name);
+					row.m_StatusUpdateTime = player.GetLastStatusUpdateTime();
+					row.m_RefreshTime = curTime;
+				}
+
+				rows.push_back({ &player, &row });
+			}
+
+			std::erase_if(m_ScoreboardRows, [&](const auto& pair) { return pair.second.m_LastDrawnFrame != m_ScoreboardFrame; });
+
+			// Rows are all one line tall, so only the visible ones need to be drawn
+			ImGuiListClipper clipper;
+			clipper.Begin(int(rows.size()));
+			while (clipper.Step())
+			{
+				for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+					OnDrawScoreboardRow(*rows[i].m_Player, *rows[i].m_Row);
+			}
 
 			ImGui::EndGroup();
 
@@ -155,58 +197,106 @@ static ImVec4 BlendColors(const std::array<float, 4>& dstColor, const std::array
 	return ImVec4(result);
 }
 
-void MainWindow::OnDrawScoreboardRow(IPlayer& player)
+void MainWindow::UpdateScoreboardRow(const IPlayer& player, ScoreboardRow& row) const
+{
+	const auto& colors = m_Settings.m_Theme.m_Colors;
+	const auto& playerName = player.GetNameSafe();
+	const auto& summary = player.GetPlayerSummary();
+
+	row.m_UserID = player.GetUserID() ? mh::format("{}", *player.GetUserID()) : "?";
+
+	if (!playerName.empty())
+		row.m_Name = playerName;
+	else if (summary && !summary->m_Nickname.empty())
+		row.m_Name = summary->m_Nickname;
+	else
+		row.m_Name = "<Unknown>";
+
+	// If their steamcommunity name doesn't match their ingame name
+	if (summary && !playerName.empty() && summary->m_Nickname != playerName)
+		row.m_SteamNickname = summary->m_Nickname;
+	else
+		row.m_SteamNickname.clear();
+
+	row.m_HasName = !playerName.empty();
+	if (row.m_HasName)
+	{
+		const auto connectedTime = player.GetConnectedTime();
+		row.m_Kills = mh::format("{}", player.GetScores().m_Kills);
+		row.m_Deaths = mh::format("{}", player.GetScores().m_Deaths);
+		row.m_ConnectedTime = mh::format("{}:{:02}",
+			std::chrono::duration_cast<std::chrono::minutes>(connectedTime).count(),
+			std::chrono::duration_cast<std::chrono::seconds>(connectedTime).count() % 60);
+		row.m_Ping = mh::format("{}", player.GetPing());
+	}
+
+	row.m_SteamID = player.GetSteamID().str();
+	row.m_IsSteamIDValid = player.GetSteamID().Type != SteamAccountType::Invalid;
+
+	if (player.GetConnectionState() != PlayerStatusState::Active || playerName.empty())
+		row.m_TextColor = colors.m_ScoreboardConnectingFG;
+	else if (player.GetSteamID() == m_Settings.GetLocalSteamID())
+		row.m_TextColor = colors.m_ScoreboardYouFG;
+	else
+		row.m_TextColor.reset();
+
+	row.m_TeamShareResult = GetModLogic().GetTeamShareResult(player);
+	row.m_Attributes = GetModLogic().GetPlayerAttributes(player);
+
+	row.m_BGColor = [&]() -> std::array<float, 4>
+	{
+		switch (row.m_TeamShareResult)
+		{
+		case TeamShareResult::SameTeams:      return colors.m_ScoreboardFriendlyTeamBG;
+		case TeamShareResult::OppositeTeams:  return colors.m_ScoreboardEnemyTeamBG;
+		case TeamShareResult::Neither:        break;
+		}
+
+		switch (player.GetTeam())
+		{
+		case TFTeam::Red:   return { 1.0f, 0.5f, 0.5f, 0.5f };
+		case TFTeam::Blue:  return { 0.5f, 0.5f, 1.0f, 0.5f };
+		default: return { 0.5f, 0.5f, 0.5f, 0 };
+		}
+	}();
+
+	if (row.m_Attributes.Has(PlayerAttribute::Cheater))
+		row.m_MarkBGColor = &colors.m_ScoreboardCheaterBG;
+	else if (row.m_Attributes.Has(PlayerAttribute::Suspicious))
+		row.m_MarkBGColor = &colors.m_ScoreboardSuspiciousBG;
+	else if (row.m_Attributes.Has(PlayerAttribute::Exploiter))
+		row.m_MarkBGColor = &colors.m_ScoreboardExploiterBG;
+	else if (row.m_Attributes.Has(PlayerAttribute::Racist))
+		row.m_MarkBGColor = &colors.m_ScoreboardRacistBG;
+	else
+		row.m_MarkBGColor = nullptr;
+
+	const auto& bans = player.GetPlayerBans();
+	row.m_IsVACBanned = bans && bans->m_VACBanCount > 0;
+	row.m_IsGameBanned = bans && bans->m_GameBanCount > 0;
+	row.m_IsFriend = player.IsFriend();
+}
+
+void MainWindow::OnDrawScoreboardRow(IPlayer& player, ScoreboardRow& row)
 {
 	if (!m_Settings.m_LazyLoadAPIData)
-		TryGetAvatarTexture(player);
+		TryGetAvatarTexture(player, AvatarPriority::Scoreboard);
 
-	const auto& playerName = player.GetNameSafe();
 	ImGuiDesktop::ScopeGuards::ID idScope((int)player.GetSteamID().Lower32);
 	ImGuiDesktop::ScopeGuards::ID idScope2((int)player.GetSteamID().Upper32);
 
 	ImGuiDesktop::ScopeGuards::StyleColor textColor;
-	if (player.GetConnectionState() != PlayerStatusState::Active || player.GetNameSafe().empty())
-		textColor = { ImGuiCol_Text, m_Settings.m_Theme.m_Colors.m_ScoreboardConnectingFG };
-	else if (player.GetSteamID() == m_Settings.GetLocalSteamID())
-		textColor = { ImGuiCol_Text, m_Settings.m_Theme.m_Colors.m_ScoreboardYouFG };
-
-	mh::fmtstr<32> buf;
-	if (!player.GetUserID().has_value())
-		buf = "?";
-	else
-		buf.fmt("{}", player.GetUserID().value());
+	if (row.m_TextColor)
+		textColor = { ImGuiCol_Text, *row.m_TextColor };
 
 	bool shouldDrawPlayerTooltip = false;
 
 	// Selectable
-	const auto teamShareResult = GetModLogic().GetTeamShareResult(player);
-	const auto playerAttribs = GetModLogic().GetPlayerAttributes(player);
 	{
-		ImVec4 bgColor = [&]() -> ImVec4
-		{
-			switch (teamShareResult)
-			{
-			case TeamShareResult::SameTeams:      return m_Settings.m_Theme.m_Colors.m_ScoreboardFriendlyTeamBG;
-			case TeamShareResult::OppositeTeams:  return m_Settings.m_Theme.m_Colors.m_ScoreboardEnemyTeamBG;
-			case TeamShareResult::Neither:        break;
-			}
-
-			switch (player.GetTeam())
-			{
-			case TFTeam::Red:   return ImVec4(1.0f, 0.5f, 0.5f, 0.5f);
-			case TFTeam::Blue:  return ImVec4(0.5f, 0.5f, 1.0f, 0.5f);
-			default: return ImVec4(0.5f, 0.5f, 0.5f, 0);
-			}
-		}();
-
-		if (playerAttribs.Has(PlayerAttribute::Cheater))
-			bgColor = BlendColors(bgColor.to_array(), m_Settings.m_Theme.m_Colors.m_ScoreboardCheaterBG, TimeSine());
-		else if (playerAttribs.Has(PlayerAttribute::Suspicious))
-			bgColor = BlendColors(bgColor.to_array(), m_Settings.m_Theme.m_Colors.m_ScoreboardSuspiciousBG, TimeSine());
-		else if (playerAttribs.Has(PlayerAttribute::Exploiter))
-			bgColor = BlendColors(bgColor.to_array(), m_Settings.m_Theme.m_Colors.m_ScoreboardExploiterBG, TimeSine());
-		else if (playerAttribs.Has(PlayerAttribute::Racist))
-			bgColor = BlendColors(bgColor.to_array(), m_Settings.m_Theme.m_Colors.m_ScoreboardRacistBG, TimeSine());
+		// The pulse is the only thing that changes every frame
+		ImVec4 bgColor = row.m_BGColor;
+		if (row.m_MarkBGColor)
+			bgColor = BlendColors(row.m_BGColor, *row.m_MarkBGColor, TimeSine());
 
 		ImGuiDesktop::ScopeGuards::StyleColor styleColorScope(ImGuiCol_Header, bgColor);
 
@@ -215,7 +305,7 @@ void MainWindow::OnDrawScoreboardRow(IPlayer& player)
 
 		bgColor.w = std::min(bgColor.w + 0.5f, 1.0f);
 		ImGuiDesktop::ScopeGuards::StyleColor styleColorScopeActive(ImGuiCol_HeaderActive, bgColor);
-		ImGui::Selectable(buf.c_str(), true, ImGuiSelectableFlags_SpanAllColumns);
+		ImGui::Selectable(row.m_UserID.c_str(), true, ImGuiSelectableFlags_SpanAllColumns);
 
 		shouldDrawPlayerTooltip = ImGui::IsItemHovered();
 
@@ -230,83 +320,37 @@ void MainWindow::OnDrawScoreboardRow(IPlayer& player)
 
 		const auto columnEndX = ImGui::GetCursorPosX() - ImGui::GetStyle().ItemSpacing.x + ImGui::GetColumnWidth();
 
-		if (!playerName.empty())
-			ImGui::TextFmt(playerName);
-		else if (const auto& summary = player.GetPlayerSummary(); summary && !summary->m_Nickname.empty())
-			ImGui::TextFmt(summary->m_Nickname);
-		else
-			ImGui::TextFmt("<Unknown>");
+		ImGui::TextFmt(row.m_Name);
 
-		// If their steamcommunity name doesn't match their ingame name
-		if (auto summary = player.GetPlayerSummary();
-			summary && !playerName.empty() && summary->m_Nickname != playerName)
+		if (!row.m_SteamNickname.empty())
 		{
 			ImGui::SameLine();
-			ImGui::TextFmt({ 1, 0, 0, 1 }, "({})", summary->m_Nickname);
+			ImGui::TextFmt({ 1, 0, 0, 1 }, "({})", row.m_SteamNickname);
 		}
 
 		// Move cursor pos up a few pixels if we have icons to draw
 		struct IconDrawData
 		{
 			ImTextureID m_Texture;
+			TextureUVs m_UVs;
 			ImVec4 m_Color{ 1, 1, 1, 1 };
 			std::string_view m_Tooltip;
 		};
-		std::vector<IconDrawData> icons;
+		IconDrawData icons[3];
+		size_t iconCount = 0;
 
-		// Check their steam bans
-		if (auto bans = player.GetPlayerBans())
+		const auto AddIcon = [&](bool shouldDraw, const ITexture* icon, const ImVec4& color, const std::string_view& tooltip)
 		{
-			// If they are VAC banned
-			std::invoke([&]
-				{
-					if constexpr (!DEBUG_ALWAYS_DRAW_ICONS)
-					{
-						if (bans->m_VACBanCount <= 0)
-							return;
-					}
-
-					auto icon = m_BaseTextures->GetVACShield_16();
-					if (!icon)
-						return;
-
-					icons.push_back({ (ImTextureID)(intptr_t)icon->GetHandle(), { 1, 1, 1, 1 }, "VAC Banned" });
-				});
-
-			// If they are game banned
-			std::invoke([&]
-				{
-					if constexpr (!DEBUG_ALWAYS_DRAW_ICONS)
-					{
-						if (bans->m_GameBanCount <= 0)
-							return;
-					}
-
-					auto icon = m_BaseTextures->GetGameBanIcon_16();
-					if (!icon)
-						return;
-
-					icons.push_back({ (ImTextureID)(intptr_t)icon->GetHandle(), { 1, 1, 1, 1 }, "Game Banned" });
-				});
-		}
-
-		// If they are friends with us on Steam
-		std::invoke([&]
-			{
-				if constexpr (!DEBUG_ALWAYS_DRAW_ICONS)
-				{
-					if (!player.IsFriend())
-						return;
-				}
-
-				auto icon = m_BaseTextures->GetHeart_16();
-				if (!icon)
-					return;
+			if ((shouldDraw || DEBUG_ALWAYS_DRAW_ICONS) && icon)
+				icons[iconCount++] = { (ImTextureID)(intptr_t)icon->GetHandle(), icon->GetUVs(), color, tooltip };
+		};
 
-				icons.push_back({ (ImTextureID)(intptr_t)icon->GetHandle(), { 1, 0, 0, 1 }, "Steam Friends" });
-			});
+		const float iconSize = 16 * ImGui::GetCurrentFontScale();
+		AddIcon(row.m_IsVACBanned, m_BaseTextures->GetVACShield(iconSize), { 1, 1, 1, 1 }, "VAC Banned");
+		AddIcon(row.m_IsGameBanned, m_BaseTextures->GetGameBanIcon(iconSize), { 1, 1, 1, 1 }, "Game Banned");
+		AddIcon(row.m_IsFriend, m_BaseTextures->GetHeart(iconSize), { 1, 0, 0, 1 }, "Steam Friends");
 
-		if (!icons.empty())
+		if (iconCount > 0)
 		{
 			// We have at least one icon to draw
 			ImGui::SameLine();
@@ -314,14 +358,13 @@ void MainWindow::OnDrawScoreboardRow(IPlayer& player)
 			// Move it up very slightly so it looks centered in these tiny rows
 			ImGui::SetCursorPosY(ImGui::GetCursorPosY() - 2);
 
-			const float iconSize = 16 * ImGui::GetCurrentFontScale();
-
 			const auto spacing = ImGui::GetStyle().ItemSpacing.x;
-			ImGui::SetCursorPosX(columnEndX - (iconSize + spacing) * icons.size());
+			ImGui::SetCursorPosX(columnEndX - (iconSize + spacing) * iconCount);
 
-			for (size_t i = 0; i < icons.size(); i++)
+			for (size_t i = 0; i < iconCount; i++)
 			{
-				ImGui::Image(icons[i].m_Texture, { iconSize, iconSize }, { 0, 0 }, { 1, 1 }, icons[i].m_Color);
+				const TextureUVs& uvs = icons[i].m_UVs;
+				ImGui::Image(icons[i].m_Texture, { iconSize, iconSize }, { uvs.m_U0, uvs.m_V0 }, { uvs.m_U1, uvs.m_V1 }, icons[i].m_Color);
 
 				ImGuiDesktop::ScopeGuards::TextColor color({ 1, 1, 1, 1 });
 				if (ImGui::SetHoverTooltip(icons[i].m_Tooltip))
@@ -334,65 +377,25 @@ void MainWindow::OnDrawScoreboardRow(IPlayer& player)
 		ImGui::NextColumn();
 	}
 
-	// Kills column
-	{
-		if (playerName.empty())
-			ImGui::TextRightAligned("?");
-		else
-			ImGui::TextRightAlignedF("%u", player.GetScores().m_Kills);
-
-		ImGui::NextColumn();
-	}
-
-	// Deaths column
-	{
-		if (playerName.empty())
-			ImGui::TextRightAligned("?");
-		else
-			ImGui::TextRightAlignedF("%u", player.GetScores().m_Deaths);
-
-		ImGui::NextColumn();
-	}
-
-	// Connected time column
-	{
-		if (playerName.empty())
-		{
-			ImGui::TextRightAligned("?");
-		}
-		else
-		{
-			ImGui::TextRightAlignedF("%u:%02u",
-				std::chrono::duration_cast<std::chrono::minutes>(player.GetConnectedTime()).count(),
-				std::chrono::duration_cast<std::chrono::seconds>(player.GetConnectedTime()).count() % 60);
-		}
-
-		ImGui::NextColumn();
-	}
-
-	// Ping column
+	// Kills, deaths, connected time and ping columns
+	for (const std::string* text : { &row.m_Kills, &row.m_Deaths, &row.m_ConnectedTime, &row.m_Ping })
 	{
-		if (playerName.empty())
-			ImGui::TextRightAligned("?");
-		else
-			ImGui::TextRightAlignedF("%u", player.GetPing());
-
+		ImGui::TextRightAligned(row.m_HasName ? std::string_view(*text) : "?"sv);
 		ImGui::NextColumn();
 	}
 
 	// Steam ID column
 	{
-		const auto str = player.GetSteamID().str();
-		if (player.GetSteamID().Type != SteamAccountType::Invalid)
-			ImGui::TextFmt(ImGui::GetStyle().Colors[ImGuiCol_Text], str);
+		if (row.m_IsSteamIDValid)
+			ImGui::TextFmt(ImGui::GetStyle().Colors[ImGuiCol_Text], row.m_SteamID);
 		else
-			ImGui::TextFmt(str);
+			ImGui::TextFmt(row.m_SteamID);
 
 		ImGui::NextColumn();
 	}
 
 	if (shouldDrawPlayerTooltip)
-		DrawPlayerTooltip(player, teamShareResult, playerAttribs);
+		DrawPlayerTooltip(player, row.m_TeamShareResult, row.m_Attributes);
 }
 
 void MainWindow::OnDrawScoreboardContextMenu(IPlayer& player)
@@ -515,196 +518,256 @@ static const ImVec4 COLOR_GREEN = { 0, 1, 0, 1 };
 static const ImVec4 COLOR_UNAVAILABLE = { 1, 1, 1, 0.5 };
 static const ImVec4 COLOR_PRIVATE = COLOR_YELLOW;
 
-static void PrintPersonaState(SteamAPI::PersonaState state)
+namespace
 {
-	using SteamAPI::PersonaState;
-	switch (state)
+	// The text part of a player's tooltip. Working it out touches a lot of player data (some of it
+	// behind TempDB/API lookups), so it is built once and redrawn as-is until that data changes.
+	class PlayerTooltipModel final
 	{
-	case PersonaState::Offline:
-		return ImGui::TextFmt({ 0.4f, 0.4f, 0.4f, 1 }, "Offline");
-	case PersonaState::Online:
-		return ImGui::TextFmt(COLOR_GREEN, "Online");
-	case PersonaState::Busy:
-		return ImGui::TextFmt({ 1, 135 / 255.0f, 135 / 255.0f, 1 }, "Busy");
-	case PersonaState::Away:
-		return ImGui::TextFmt({ 92 / 255.0f, 154 / 255.0f, 245 / 255.0f, 0.5f }, "Away");
-	case PersonaState::Snooze:
-		return ImGui::TextFmt({ 92 / 255.0f, 154 / 255.0f, 245 / 255.0f, 0.35f }, "Snooze");
-	case PersonaState::LookingToTrade:
-		return ImGui::TextFmt({ 0, 1, 1, 1 }, "Looking to Trade");
-	case PersonaState::LookingToPlay:
-		return ImGui::TextFmt({ 0, 1, 0.5f, 1 }, "Looking to Play");
-	}
+	public:
+		static constexpr duration_t PENDING_REFRESH_INTERVAL = 250ms; // Something was still loading
+		static constexpr duration_t REFRESH_INTERVAL = 5s;            // Refreshed API data, active time, etc
 
-	ImGui::TextFmt(COLOR_RED, "Unknown ({})", int(state));
-}
+		bool IsStale(const IPlayer& player, TeamShareResult teamShareResult, const PlayerMarks& marks, time_point_t now) const
+		{
+			const auto age = now - m_BuildTime;
+			if (age >= REFRESH_INTERVAL || (m_HasPending && age >= PENDING_REFRESH_INTERVAL))
+				return true;
+
+			return m_TeamShareResult != teamShareResult ||
+				m_LocalKills != player.GetScores().m_LocalKills ||
+				m_LocalDeaths != player.GetScores().m_LocalDeaths ||
+				m_Name != player.GetNameUnsafe() ||
+				m_Marks != marks;
+		}
 
-namespace ImGui
-{
-	struct Span
-	{
-		using fmtstr_type = mh::fmtstr<256>;
-		using string_type = std::string;
+		void Reset(const IPlayer& player, TeamShareResult teamShareResult, const PlayerMarks& marks, time_point_t now)
+		{
+			m_Spans.clear();
+			m_NextJoin = SpanType::Line;
+			m_HasPending = false;
+
+			m_BuildTime = now;
+			m_TeamShareResult = teamShareResult;
+			m_LocalKills = player.GetScores().m_LocalKills;
+			m_LocalDeaths = player.GetScores().m_LocalDeaths;
+			m_Name = player.GetNameUnsafe();
+			m_Marks = marks;
+		}
 
-		template<typename... TArgs>
-		Span(const ImVec4& color, const std::string_view& fmtStr, const TArgs&... args) :
-			m_Color(color), m_Value(fmtstr_type(fmtStr, args...))
+		void Draw() const
 		{
+			for (const Span& span : m_Spans)
+			{
+				switch (span.m_Type)
+				{
+				case SpanType::Line:
+					break;
+				case SpanType::SameLine:
+					ImGui::SameLine();
+					break;
+				case SpanType::SameLineNoPad:
+					ImGui::SameLineNoPad();
+					break;
+				case SpanType::NewLine:
+					ImGui::NewLine();
+					continue;
+				}
+
+				if (span.m_IsPacifier)
+					ImGui::PacifierText();
+				else if (span.m_Color)
+					ImGui::TextFmt(*span.m_Color, span.m_Text);
+				else
+					ImGui::TextFmt(span.m_Text);
+			}
 		}
 
+		// Same names as the ImGui functions they stand in for
 		template<typename... TArgs>
-		Span(const std::string_view& fmtStr, const TArgs&... args) :
-			m_Value(fmtstr_type(fmtStr, args...))
+		void TextFmt(const std::string_view& fmtStr, const TArgs&... args)
 		{
+			AddSpan(std::nullopt, fmtStr, args...);
 		}
-
-		Span(const std::string_view& text)
+		template<typename... TArgs>
+		void TextFmt(const ImVec4& color, const std::string_view& fmtStr, const TArgs&... args)
 		{
-			if (text.size() <= fmtstr_type::max_size())
-				m_Value.emplace<fmtstr_type>(text);
-			else
-				m_Value.emplace<string_type>(text);
+			AddSpan(color, fmtStr, args...);
 		}
-		Span(const char* text) : Span(std::string_view(text)) {}
-
-		std::string_view GetView() const
+		void PacifierText()
 		{
-			if (auto str = std::get_if<fmtstr_type>(&m_Value))
-				return *str;
-			else if (auto str = std::get_if<string_type>(&m_Value))
-				return *str;
-
-			LogError(MH_SOURCE_LOCATION_CURRENT(), "Unexpected variant index {}", m_Value.index());
-			return __FUNCTION__ ": UNEXPECTED VARIANT INDEX";
+			AddSpan(std::nullopt, {}).m_IsPacifier = true;
+			m_HasPending = true;
 		}
+		void SameLine() { m_NextJoin = SpanType::SameLine; }
+		void SameLineNoPad() { m_NextJoin = SpanType::SameLineNoPad; }
+		void NewLine() { m_Spans.push_back({ SpanType::NewLine }); }
 
-		std::optional<ImVec4> m_Color;
-		std::variant<fmtstr_type, string_type> m_Value;
-	};
-
-	template<typename TIter>
-	void TextSpan(TIter begin, TIter end)
-	{
-		if (begin == end)
-			return;
-
-		if (begin->m_Color.has_value())
-			ImGui::TextFmt(*begin->m_Color, begin->GetView());
-		else
-			ImGui::TextFmt(begin->GetView());
+	private:
+		enum class SpanType
+		{
+			Line,
+			SameLine,
+			SameLineNoPad,
+			NewLine,
+		};
 
-		++begin;
+		struct Span
+		{
+			SpanType m_Type = SpanType::Line;
+			std::optional<ImVec4> m_Color;
+			std::string m_Text;
+			bool m_IsPacifier = false;
+		};
 
-		for (auto it = begin; it != end; ++it)
+		template<typename... TArgs>
+		Span& AddSpan(const std::optional<ImVec4>& color, const std::string_view& fmtStr, const TArgs&... args)
 		{
-			ImGui::SameLineNoPad();
+			Span& span = m_Spans.emplace_back();
+			span.m_Type = std::exchange(m_NextJoin, SpanType::Line);
+			span.m_Color = color;
 
-			if (it->m_Color.has_value())
-				ImGui::TextFmt(*it->m_Color, it->GetView());
+			if constexpr (sizeof...(TArgs) > 0)
+				span.m_Text = mh::format(fmtStr, args...);
 			else
-				ImGui::TextFmt(it->GetView());
+				span.m_Text = fmtStr;
+
+			return span;
 		}
+
+		std::vector<Span> m_Spans;
+		SpanType m_NextJoin = SpanType::Line;
+		bool m_HasPending = false;
+
+		time_point_t m_BuildTime{};
+		TeamShareResult m_TeamShareResult{};
+		int m_LocalKills = 0;
+		int m_LocalDeaths = 0;
+		std::string m_Name;
+		PlayerMarks m_Marks;
+	};
+}
+
+static void PrintPersonaState(PlayerTooltipModel& tooltip, SteamAPI::PersonaState state)
+{
+	using SteamAPI::PersonaState;
+	switch (state)
+	{
+	case PersonaState::Offline:
+		return tooltip.TextFmt({ 0.4f, 0.4f, 0.4f, 1 }, "Offline");
+	case PersonaState::Online:
+		return tooltip.TextFmt(COLOR_GREEN, "Online");
+	case PersonaState::Busy:
+		return tooltip.TextFmt({ 1, 135 / 255.0f, 135 / 255.0f, 1 }, "Busy");
+	case PersonaState::Away:
+		return tooltip.TextFmt({ 92 / 255.0f, 154 / 255.0f, 245 / 255.0f, 0.5f }, "Away");
+	case PersonaState::Snooze:
+		return tooltip.TextFmt({ 92 / 255.0f, 154 / 255.0f, 245 / 255.0f, 0.35f }, "Snooze");
+	case PersonaState::LookingToTrade:
+		return tooltip.TextFmt({ 0, 1, 1, 1 }, "Looking to Trade");
+	case PersonaState::LookingToPlay:
+		return tooltip.TextFmt({ 0, 1, 0.5f, 1 }, "Looking to Play");
 	}
 
-	void TextSpan(const std::initializer_list<Span>& spans) { return TextSpan(spans.begin(), spans.end()); }
+	tooltip.TextFmt(COLOR_RED, "Unknown ({})", int(state));
 }
 
-static void EnterAPIKeyText()
+static void EnterAPIKeyText(PlayerTooltipModel& tooltip)
 {
-	ImGui::TextFmt(COLOR_UNAVAILABLE, "Enter Steam API key in Settings");
+	tooltip.TextFmt(COLOR_UNAVAILABLE, "Enter Steam API key in Settings");
 }
 
-static void PrintPlayerSummary(const IPlayer& player)
+static void PrintPlayerSummary(PlayerTooltipModel& tooltip, const IPlayer& player)
 {
 	player.GetPlayerSummary()
 		.or_else([&](std::error_condition err)
 			{
-				ImGui::TextFmt("Player Summary : ");
-				ImGui::SameLineNoPad();
+				tooltip.TextFmt("Player Summary : ");
+				tooltip.SameLineNoPad();
 
 				if (err == std::errc::operation_in_progress)
-					ImGui::PacifierText();
+					tooltip.PacifierText();
 				else if (err == SteamAPI::ErrorCode::EmptyAPIKey)
-					EnterAPIKeyText();
+					EnterAPIKeyText(tooltip);
 				else
-					ImGui::TextFmt(COLOR_RED, "{}", err);
+					tooltip.TextFmt(COLOR_RED, "{}", err);
 			})
 		.map([&](const SteamAPI::PlayerSummary& summary)
 			{
 				using namespace SteamAPI;
-				ImGui::TextFmt("    Steam Name : \"{}\"", summary.m_Nickname);
+				tooltip.TextFmt("    Steam Name : \"{}\"", summary.m_Nickname.view());
 
-				ImGui::TextFmt("     Real Name : ");
-				ImGui::SameLineNoPad();
+				tooltip.TextFmt("     Real Name : ");
+				tooltip.SameLineNoPad();
 				if (summary.m_RealName.empty())
-					ImGui::TextFmt(COLOR_UNAVAILABLE, "Not set");
+					tooltip.TextFmt(COLOR_UNAVAILABLE, "Not set");
 				else
-					ImGui::TextFmt("\"{}\"", summary.m_RealName);
+					tooltip.TextFmt("\"{}\"", summary.m_RealName);
 
-				ImGui::TextFmt("    Vanity URL : ");
-				ImGui::SameLineNoPad();
+				tooltip.TextFmt("    Vanity URL : ");
+				tooltip.SameLineNoPad();
 				if (auto vanity = summary.GetVanityURL(); !vanity.empty())
-					ImGui::TextFmt("\"{}\"", vanity);
+					tooltip.TextFmt("\"{}\"", vanity);
 				else
-					ImGui::TextFmt(COLOR_UNAVAILABLE, "Not set");
+					tooltip.TextFmt(COLOR_UNAVAILABLE, "Not set");
 
-				ImGui::TextFmt("   Account Age : ");
-				ImGui::SameLineNoPad();
+				tooltip.TextFmt("   Account Age : ");
+				tooltip.SameLineNoPad();
 				if (auto age = summary.GetAccountAge())
 				{
-					ImGui::TextFmt("{}", HumanDuration(*age));
+					tooltip.TextFmt("{}", HumanDuration(*age));
 				}
 				else
 				{
-					ImGui::TextFmt(COLOR_PRIVATE, "Private");
+					tooltip.TextFmt(COLOR_PRIVATE, "Private");
 
 					if (auto estimated = player.GetEstimatedAccountAge())
 					{
-						ImGui::SameLine();
-						ImGui::TextFmt("(estimated {})", HumanDuration(*estimated));
+						tooltip.SameLine();
+						tooltip.TextFmt("(estimated {})", HumanDuration(*estimated));
 					}
 #ifdef _DEBUG
 					else
 					{
-						ImGui::SameLine();
-						ImGui::TextFmt("(estimated ???)");
+						tooltip.SameLine();
+						tooltip.TextFmt("(estimated ???)");
 					}
 #endif
 				}
 
-				ImGui::TextFmt("        Status : ");
-				ImGui::SameLineNoPad();
-				PrintPersonaState(summary.m_Status);
+				tooltip.TextFmt("        Status : ");
+				tooltip.SameLineNoPad();
+				PrintPersonaState(tooltip, summary.m_Status);
 
-				ImGui::TextFmt(" Profile State : ");
-				ImGui::SameLineNoPad();
+				tooltip.TextFmt(" Profile State : ");
+				tooltip.SameLineNoPad();
 				switch (summary.m_Visibility)
 				{
 				case CommunityVisibilityState::Public:
-					ImGui::TextFmt(COLOR_GREEN, "Public");
+					tooltip.TextFmt(COLOR_GREEN, "Public");
 					break;
 				case CommunityVisibilityState::FriendsOnly:
-					ImGui::TextFmt(COLOR_PRIVATE, "Friends Only");
+					tooltip.TextFmt(COLOR_PRIVATE, "Friends Only");
 					break;
 				case CommunityVisibilityState::Private:
-					ImGui::TextFmt(COLOR_PRIVATE, "Private");
+					tooltip.TextFmt(COLOR_PRIVATE, "Private");
 					break;
 				default:
-					ImGui::TextFmt(COLOR_RED, "Unknown ({})", int(summary.m_Visibility));
+					tooltip.TextFmt(COLOR_RED, "Unknown ({})", int(summary.m_Visibility));
 					break;
 				}
 
 				if (!summary.m_ProfileConfigured)
 				{
-					ImGui::SameLineNoPad();
-					ImGui::TextFmt(", ");
-					ImGui::SameLineNoPad();
-					ImGui::TextFmt(COLOR_RED, "Not Configured");
+					tooltip.SameLineNoPad();
+					tooltip.TextFmt(", ");
+					tooltip.SameLineNoPad();
+					tooltip.TextFmt(COLOR_RED, "Not Configured");
 				}
 
 #if 0 // decreed as useless information by overlord czechball
-				ImGui::TextFmt("Comment Permissions: ");
-				ImGui::SameLineNoPad();
+				tooltip.TextFmt("Comment Permissions: ");
+				tooltip.SameLineNoPad();
 				if (summary->m_CommentPermissions)
 					ImGui::TextColoredUnformatted({ 0, 1, 0, 1 }, "You can comment");
 				else
@@ -713,42 +776,46 @@ static void PrintPlayerSummary(const IPlayer& player)
 			});
 }
 
-static void PrintPlayerBans(const IPlayer& player)
+static void PrintPlayerBans(PlayerTooltipModel& tooltip, const IPlayer& player)
 {
 	player.GetPlayerBans()
 		.or_else([&](std::error_condition err)
 			{
-				ImGui::TextFmt("   Player Bans : ");
-				ImGui::SameLineNoPad();
+				tooltip.TextFmt("   Player Bans : ");
+				tooltip.SameLineNoPad();
 
 				if (err == std::errc::operation_in_progress)
-					ImGui::PacifierText();
+					tooltip.PacifierText();
 				else if (err == SteamAPI::ErrorCode::EmptyAPIKey)
-					EnterAPIKeyText();
+					EnterAPIKeyText(tooltip);
 				else
-					ImGui::TextFmt(COLOR_RED, "{}", err);
+					tooltip.TextFmt(COLOR_RED, "{}", err);
 			})
 		.map([&](const SteamAPI::PlayerBans& bans)
 			{
 				using namespace SteamAPI;
 				if (bans.m_CommunityBanned)
-					ImGui::TextSpan({ "SteamCommunity : ", { COLOR_RED, "Banned" } });
+				{
+					tooltip.TextFmt("SteamCommunity : ");
+					tooltip.SameLineNoPad();
+					tooltip.TextFmt(COLOR_RED, "Banned");
+				}
 
 				if (bans.m_EconomyBan != PlayerEconomyBan::None)
 				{
-					ImGui::TextFmt("  Trade Status :");
+					tooltip.TextFmt("  Trade Status :");
 					switch (bans.m_EconomyBan)
 					{
 					case PlayerEconomyBan::Probation:
-						ImGui::TextFmt(COLOR_YELLOW, "Banned (Probation)");
+						tooltip.TextFmt(COLOR_YELLOW, "Banned (Probation)");
 						break;
 					case PlayerEconomyBan::Banned:
-						ImGui::TextFmt(COLOR_RED, "Banned");
+						tooltip.TextFmt(COLOR_RED, "Banned");
 						break;
 
 					default:
 					case PlayerEconomyBan::Unknown:
-						ImGui::TextFmt(COLOR_RED, "Unknown");
+						tooltip.TextFmt(COLOR_RED, "Unknown");
 						break;
 					}
 				}
@@ -756,99 +823,136 @@ static void PrintPlayerBans(const IPlayer& player)
 				{
 					const ImVec4 banColor = (bans.m_TimeSinceLastBan >= (24h * 365 * 7)) ? COLOR_YELLOW : COLOR_RED;
 					if (bans.m_VACBanCount > 0)
-						ImGui::TextFmt(banColor, "      VAC Bans : {}", bans.m_VACBanCount);
+						tooltip.TextFmt(banColor, "      VAC Bans : {}", bans.m_VACBanCount);
 					if (bans.m_GameBanCount > 0)
-						ImGui::TextFmt(banColor, "     Game Bans : {}", bans.m_GameBanCount);
+						tooltip.TextFmt(banColor, "     Game Bans : {}", bans.m_GameBanCount);
 					if (bans.m_VACBanCount || bans.m_GameBanCount)
-						ImGui::TextFmt(banColor, "      Last Ban : {} ago", HumanDuration(bans.m_TimeSinceLastBan));
+						tooltip.TextFmt(banColor, "      Last Ban : {} ago", HumanDuration(bans.m_TimeSinceLastBan));
 				}
 			});
 }
 
-static void PrintPlayerPlaytime(const IPlayer& player)
+static void PrintPlayerPlaytime(PlayerTooltipModel& tooltip, const IPlayer& player)
 {
-	ImGui::TextFmt("  TF2 Playtime : ");
-	ImGui::SameLineNoPad();
+	tooltip.TextFmt("  TF2 Playtime : ");
+	tooltip.SameLineNoPad();
 	player.GetTF2Playtime()
 		.or_else([&](std::error_condition err)
 			{
 				if (err == std::errc::operation_in_progress)
 				{
-					ImGui::PacifierText();
+					tooltip.PacifierText();
 				}
 				else if (err == SteamAPI::ErrorCode::InfoPrivate || err == SteamAPI::ErrorCode::GameNotOwned)
 				{
 					// The reason for the GameNotOwned check is that the API hides free games if you haven't played
 					// them. So even if you can see other owned games, if you make your playtime private...
 					// suddenly you don't own TF2 anymore, and it disappears from the owned games list.
-					ImGui::TextFmt(COLOR_PRIVATE, "Private");
+					tooltip.TextFmt(COLOR_PRIVATE, "Private");
 				}
 				else if (err == SteamAPI::ErrorCode::EmptyAPIKey)
 				{
-					EnterAPIKeyText();
+					EnterAPIKeyText(tooltip);
 				}
 				else
 				{
-					ImGui::TextFmt(COLOR_RED, "{}", err);
+					tooltip.TextFmt(COLOR_RED, "{}", err);
 				}
 			})
 		.map([&](duration_t playtime)
 			{
 				const auto hours = std::chrono::duration_cast<std::chrono::hours>(playtime);
-				ImGui::TextFmt("{} hours", hours.count());
+				tooltip.TextFmt("{} hours", hours.count());
 			});
 }
 
-static void PrintPlayerLogsCount(const IPlayer& player)
+static void PrintPlayerLogsCount(PlayerTooltipModel& tooltip, const IPlayer& player)
 {
-	ImGui::TextFmt("       Logs.TF : ");
-	ImGui::SameLineNoPad();
+	tooltip.TextFmt("       Logs.TF : ");
+	tooltip.SameLineNoPad();
 
 	player.GetLogsInfo()
 		.or_else([&](std::error_condition err)
 			{
 				if (err == std::errc::operation_in_progress)
 				{
-					ImGui::PacifierText();
+					tooltip.PacifierText();
 				}
 				else
 				{
-					ImGui::TextFmt(COLOR_RED, "{}", err);
+					tooltip.TextFmt(COLOR_RED, "{}", err);
 				}
 			})
 		.map([&](const LogsTFAPI::PlayerLogsInfo& info)
 			{
-				ImGui::TextFmt("{} logs", info.m_LogsCount);
+				tooltip.TextFmt("{} logs", info.m_LogsCount);
 			});
 }
 
-static void PrintPlayerInventoryInfo(const IPlayer& player)
+static void PrintPlayerInventoryInfo(PlayerTooltipModel& tooltip, const IPlayer& player)
 {
-	ImGui::TextFmt("Inventory Size : ");
-	ImGui::SameLineNoPad();
+	tooltip.TextFmt("Inventory Size : ");
+	tooltip.SameLineNoPad();
 
 	player.GetInventoryInfo()
 		.or_else([&](std::error_condition err)
 			{
 				if (err == std::errc::operation_in_progress)
 				{
-					ImGui::PacifierText();
+					tooltip.PacifierText();
 				}
 				else if (err == SteamAPI::ErrorCode::InfoPrivate)
 				{
-					ImGui::TextFmt(COLOR_PRIVATE, "Private");
+					tooltip.TextFmt(COLOR_PRIVATE, "Private");
 				}
 				else
 				{
-					ImGui::TextFmt(COLOR_RED, "{}", err);
+					tooltip.TextFmt(COLOR_RED, "{}", err);
 				}
 			})
 		.map([&](const SteamAPI::PlayerInventoryInfo& info)
 			{
-				ImGui::TextFmt("{} items ({} slots)", info.m_Items, info.m_Slots);
+				tooltip.TextFmt("{} items ({} slots)", info.m_Items, info.m_Slots);
 			});
 }
 
+static void BuildPlayerTooltip(PlayerTooltipModel& tooltip, const IPlayer& player, TeamShareResult teamShareResult,
+	const PlayerMarks& playerAttribs)
+{
+	tooltip.TextFmt("  In-game Name : ");
+	tooltip.SameLineNoPad();
+	if (auto name = player.GetNameUnsafe(); !name.empty())
+		tooltip.TextFmt("\"{}\"", name);
+	else
+		tooltip.TextFmt(COLOR_UNAVAILABLE, "Unknown");
+
+	PrintPlayerSummary(tooltip, player);
+	PrintPlayerBans(tooltip, player);
+	PrintPlayerPlaytime(tooltip, player);
+	PrintPlayerLogsCount(tooltip, player);
+	PrintPlayerInventoryInfo(tooltip, player);
+
+	tooltip.NewLine();
+
+#ifdef _DEBUG
+	tooltip.TextFmt("   Active time : {}", HumanDuration(player.GetActiveTime()));
+#endif
+
+	if (teamShareResult != TeamShareResult::SameTeams)
+	{
+		auto kills = player.GetScores().m_LocalKills;
+		auto deaths = player.GetScores().m_LocalDeaths;
+		//ImGui::Text("Your Thirst: %1.0f%%", kills == 0 ? float(deaths) * 100 : float(deaths) / kills * 100);
+		tooltip.TextFmt("  Their Thirst : {}%", int(deaths == 0 ? float(kills) * 100 : float(kills) / deaths * 100));
+	}
+
+	if (playerAttribs)
+	{
+		tooltip.NewLine();
+		tooltip.TextFmt("Player {} marked in playerlist(s):{}", player, playerAttribs);
+	}
+}
+
 void MainWindow::DrawPlayerTooltipBody(IPlayer& player, TeamShareResult teamShareResult,
 	const PlayerMarks& playerAttribs)
 {
@@ -857,15 +961,16 @@ void MainWindow::DrawPlayerTooltipBody(IPlayer& player, TeamShareResult teamShar
 	/////////////////////
 	// Draw the avatar //
 	/////////////////////
-	TryGetAvatarTexture(player)
+	TryGetAvatarTexture(player, AvatarPriority::Tooltip)
 		.or_else([&](std::error_condition ec)
 			{
 				if (ec != SteamAPI::ErrorCode::EmptyAPIKey)
-					ImGui::Dummy({ 184, 184 });
+					ImGui::Dummy({ AVATAR_DISPLAY_SIZE, AVATAR_DISPLAY_SIZE });
 			})
 		.map([&](const std::shared_ptr<ITexture>& tex)
 			{
-				ImGui::Image((ImTextureID)(intptr_t)tex->GetHandle(), { 184, 184 });
+				const TextureUVs uvs = tex->GetUVs();
+				ImGui::Image((ImTextureID)(intptr_t)tex->GetHandle(), { AVATAR_DISPLAY_SIZE, AVATAR_DISPLAY_SIZE }, { uvs.m_U0, uvs.m_V0 }, { uvs.m_U1, uvs.m_V1 });
 			});
 
 	////////////////////////////////
@@ -883,102 +988,34 @@ void MainWindow::DrawPlayerTooltipBody(IPlayer& player, TeamShareResult teamShar
 	///////////////////
 	// Draw the text //
 	///////////////////
-	ImGui::TextFmt("  In-game Name : ");
-	ImGui::SameLineNoPad();
-	if (auto name = player.GetNameUnsafe(); !name.empty())
-		ImGui::TextFmt("\"{}\"", name);
-	else
-		ImGui::TextFmt(COLOR_UNAVAILABLE, "Unknown");
-
-	PrintPlayerSummary(player);
-	PrintPlayerBans(player);
-	PrintPlayerPlaytime(player);
-	PrintPlayerLogsCount(player);
-	PrintPlayerInventoryInfo(player);
-
-	ImGui::NewLine();
-
-#ifdef _DEBUG
-	ImGui::TextFmt("   Active time : {}", HumanDuration(player.GetActiveTime()));
-#endif
-
-	if (teamShareResult != TeamShareResult::SameTeams)
+	auto& tooltip = player.GetOrCreateData<PlayerTooltipModel>();
+	if (const auto now = FrameClock::Now(); tooltip.IsStale(player, teamShareResult, playerAttribs, now))
 	{
-		auto kills = player.GetScores().m_LocalKills;
-		auto deaths = player.GetScores().m_LocalDeaths;
-		//ImGui::Text("Your Thirst: %1.0f%%", kills == 0 ? float(deaths) * 100 : float(deaths) / kills * 100);
-		ImGui::TextFmt("  Their Thirst : {}%", int(deaths == 0 ? float(kills) * 100 : float(kills) / deaths * 100));
+		tooltip.Reset(player, teamShareResult, playerAttribs, now);
+		BuildPlayerTooltip(tooltip, player, teamShareResult, playerAttribs);
 	}
 
-	if (playerAttribs)
-	{
-		ImGui::NewLine();
-		ImGui::TextFmt("Player {} marked in playerlist(s):{}", player, playerAttribs);
-	}
+	tooltip.Draw();
 }
 
 void MainWindow::OnDrawTeamStats()
 {
+	TF2BD_PROFILE_SCOPE("MainWindow::OnDrawTeamStats");
+
 	if (!m_Settings.m_UIState.m_MainWindow.m_TeamStatsEnabled)
 		return;
 
-	struct TeamStats
-	{
-		uint8_t m_PlayerCount = 0;
-		uint32_t m_Kills = 0;
-		uint32_t m_Deaths = 0;
-		duration_t m_AccountAgeSum{};
-	};
-
-	TeamStats statsArray[2]{};
-
 	IWorldState& world = GetWorld();
+	const auto localTeam = world.FindLobbyMemberTeam(m_Settings.GetLocalSteamID());
+	if (!localTeam)
+		return;
 
-	for (const IPlayer& player : GetWorld().GetPlayers())
+	// Friendly team first
+	const LobbyTeamStats statsArray[2] =
 	{
-		TeamStats* stats = nullptr;
-		switch (world.GetTeamShareResult(player))
-		{
-		case TeamShareResult::SameTeams:
-			stats = &statsArray[0];
-			break;
-		case TeamShareResult::OppositeTeams:
-			stats = &statsArray[1];
-			break;
-		default:
-			LogError("Unknown TeamShareResult");
-			[[fallthrough]];
-		case TeamShareResult::Neither:
-			break;
-		}
-
-		if (!stats)
-			continue;
-
-		stats->m_PlayerCount++;
-
-		bool foundAccountAge = false;
-		if (auto summary = player.GetPlayerSummary())
-		{
-			if (auto age = summary->GetAccountAge())
-			{
-				stats->m_AccountAgeSum += *age;
-				foundAccountAge = true;
-			}
-		}
-
-		if (!foundAccountAge)
-		{
-			if (auto age = player.GetEstimatedAccountAge())
-			{
-				stats->m_AccountAgeSum += *age;
-				foundAccountAge = true;
-			}
-		}
-
-		stats->m_Kills += player.GetScores().m_Kills;
-		stats->m_Deaths += player.GetScores().m_Deaths;
-	}
+		world.GetLobbyTeamStats(*localTeam),
+		world.GetLobbyTeamStats(OppositeTeam(*localTeam)),
+	};
 
 	const auto& themeCols = m_Settings.m_Theme.m_Colors;
 	auto friendlyBG = mh::lerp(themeCols.m_ScoreboardFriendlyTeamBG[3],
@@ -1004,15 +1041,4 @@ void MainWindow::OnDrawTeamStats()
 		ImGui::ProgressBar(killsFraction, { -FLT_MIN, 0 },
 			mh::fmtstr<128>("Team Kills: {} | {}", statsArray[0].m_Kills, statsArray[1].m_Kills).c_str());
 	}
-
-#if 0
-	if (const auto totalTime = statsArray[0].m_AccountAgeSum + statsArray[1].m_AccountAgeSum; totalTime.count() > 0)
-	{
-		const float timeFraction = float(statsArray[0].m_AccountAgeSum.count() / double(totalTime.count()));
-
-		ImGui::ProgressBar(timeFraction, { -FLT_MIN, 0 },
-			mh::fmtstr<128>("Team Account Age: {} | {}",
-				HumanDuration(statsArray[0].m_AccountAgeSum), HumanDuration(statsArray[1].m_AccountAgeSum)).c_str());
-	}
-#endif
 }
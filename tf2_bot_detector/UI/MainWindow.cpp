@@ -3,11 +3,16 @@
 #include "ConsoleLog/ConsoleLines.h"
 #include "Networking/GithubAPI.h"
 #include "Networking/SteamAPI.h"
+#include "Networking/SteamAPIKeyPool.h"
 #include "ConsoleLog/NetworkStatus.h"
 #include "Platform/Platform.h"
 #include "ImGui_TF2BotDetector.h"
 #include "Actions/ActionGenerators.h"
+#include "DB/TempDB.h"
+#include "Application.h"
 #include "BaseTextures.h"
+#include "Bitmap.h"
+#include "EventLog.h"
 #include "Filesystem.h"
 #include "GenericErrors.h"
 #include "Log.h"
@@ -16,10 +21,15 @@
 #include "TextureManager.h"
 #include "UpdateManager.h"
 #include "Util/PathUtils.h"
+#include "Util/MemoryTracker.h"
+#include "Util/Profiler.h"
+#include "Util/TaskScheduler.h"
 #include "Version.h"
 #include "GlobalDispatcher.h"
 #include "Networking/HTTPClient.h"
+#include "Networking/HTTPHelpers.h"
 #include "SettingsWindow.h"
+#include "UIBenchmark.h"
 
 #include <imgui_desktop/Application.h>
 #include <imgui_desktop/ScopeGuards.h>
@@ -37,6 +47,7 @@
 
 #include <cassert>
 #include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <string>
 
@@ -54,7 +65,7 @@ namespace tf2_bot_detector
 	}
 }
 
-MainWindow::MainWindow(ImGuiDesktop::Application& app) :
+MainWindow::MainWindow(ImGuiDesktop::Application& app, const UIBenchmarkOptions* benchmark) :
 	ImGuiDesktop::Window(app, 800, 600, mh::fmtstr<128>("TF2 Bot Detector v{}", VERSION).c_str()),
 	m_WorldState(IWorldState::Create(m_Settings)),
 	m_ActionManager(IRCONActionManager::Create(m_Settings, GetWorld())),
@@ -62,7 +73,15 @@ MainWindow::MainWindow(ImGuiDesktop::Application& app) :
 	m_UpdateManager(IUpdateManager::Create(m_Settings))
 {
 	SetIsPrimaryAppWindow(true);
-	ShowWindow();
+	if (benchmark)
+	{
+		m_Benchmark = std::make_unique<UIBenchmark>(*benchmark);
+		m_Benchmark->ApplySettings(m_Settings);
+	}
+	else
+	{
+		ShowWindow();
+	}
 
 	ILogManager::GetInstance().CleanupLogFiles();
 
@@ -73,9 +92,16 @@ MainWindow::MainWindow(ImGuiDesktop::Application& app) :
 
 	m_OpenTime = clock_t::now();
 
-	GetActionManager().AddPeriodicActionGenerator<StatusUpdateActionGenerator>();
-	GetActionManager().AddPeriodicActionGenerator<ConfigActionGenerator>();
-	GetActionManager().AddPeriodicActionGenerator<LobbyDebugActionGenerator>();
+	GetActionManager().AddPeriodicActionGenerator<StatusUpdateActionGenerator>(GetWorld());
+	GetActionManager().AddPeriodicActionGenerator<ConfigActionGenerator>(
+		[this] { return m_MainState ? m_MainState->m_Parser.GetConLogFileName() : "console.log"s; });
+	GetActionManager().AddPeriodicActionGenerator<LobbyDebugActionGenerator>(GetWorld());
+
+	m_DeferredInit.Add("Update check", DeferredInitQueue::Thread::Main, [this] { m_IsUpdateManagerStarted = true; });
+	m_DeferredInit.Add("Delete old cached avatars", DeferredInitQueue::Thread::Background, [] { SteamAPI::DeleteOldCachedAvatars(); });
+
+	// Ends once the main UI is up, including any time spent waiting on the user
+	m_SetupFlowStartupPhase = StartupTimeline::BeginPhase("SetupFlow");
 
 	//app.AddManagedWindow(std::make_unique<SettingsWindow>(app, m_Settings));
 }
@@ -88,34 +114,85 @@ void MainWindow::SetupFonts()
 {
 	// Add ProggyClean.ttf 24px (200%) and ProggyTiny 10px
 
+	ImFontAtlas& atlas = *ImGui::GetIO().Fonts;
 	ImFontConfig config{};
 	config.OversampleV = config.OversampleH = 1; // Bitmap fonts look bad with oversampling
 
 	if (!m_ProggyTiny10Font)
 	{
-		m_ProggyTiny10Font = ImGui::GetIO().Fonts->AddFontFromFileTTF(
+		m_ProggyTiny10Font = atlas.AddFontFromFileTTF(
 			IFilesystem::Get().ResolvePath("fonts/ProggyTiny.ttf", PathUsage::Read).string().c_str(),
 			10, &config);
+		m_GlyphCache.MergeFallbackFonts(atlas, 10, config);
 	}
 
 	if (!m_ProggyTiny20Font)
 	{
-		m_ProggyTiny20Font = ImGui::GetIO().Fonts->AddFontFromFileTTF(
+		m_ProggyTiny20Font = atlas.AddFontFromFileTTF(
 			IFilesystem::Get().ResolvePath("fonts/ProggyTiny.ttf", PathUsage::Read).string().c_str(),
 			20, &config);
+		m_GlyphCache.MergeFallbackFonts(atlas, 20, config);
 	}
 
 	if (!m_ProggyClean26Font)
 	{
 		config.GlyphOffset.y = 1;
-		m_ProggyClean26Font = ImGui::GetIO().Fonts->AddFontFromFileTTF(
+		m_ProggyClean26Font = atlas.AddFontFromFileTTF(
 			IFilesystem::Get().ResolvePath("fonts/ProggyClean.ttf", PathUsage::Read).string().c_str(),
 			26, &config);
+		m_GlyphCache.MergeFallbackFonts(atlas, 26, config);
+	}
+}
+
+void MainWindow::RebuildFontAtlas()
+{
+	TF2BD_PROFILE_SCOPE("MainWindow::RebuildFontAtlas");
+	TF2BD_STARTUP_PHASE("MainWindow::RebuildFontAtlas");
+
+	ImGuiIO& io = ImGui::GetIO();
+	ImFontAtlas& atlas = *io.Fonts;
+	if (atlas.Locked)
+		return; // Mid-frame, try again next update
+
+	m_LastFontAtlasRebuild = clock_t::now();
+	m_GlyphCache.OnAtlasRebuilt();
+
+	// Every font has to be added again in the same order, since merged glyphs can only go into
+	// the most recently added font
+	atlas.Clear();
+	io.FontDefault = nullptr;
+	m_ProggyTiny10Font = m_ProggyTiny20Font = m_ProggyClean26Font = nullptr;
+
+	{
+		ImFontConfig config{};
+		atlas.AddFontDefault(&config); // Fonts[0], see GetFontPointer()
+		m_GlyphCache.MergeFallbackFonts(atlas, 13, config);
+	}
+	SetupFonts();
+
+	if (!atlas.Build())
+	{
+		LogError("Failed to rebuild the font atlas with fallback glyphs");
+		return;
 	}
+
+	unsigned char* pixels;
+	int width, height;
+	atlas.GetTexDataAsRGBA32(&pixels, &width, &height);
+
+	Bitmap bitmap(uint32_t(width), uint32_t(height), 4);
+	std::memcpy(bitmap.GetData(), pixels, bitmap.GetDataSize());
+	m_FontTexture = m_TextureManager->CreateTexture(bitmap);
+	atlas.SetTexID((ImTextureID)(intptr_t)m_FontTexture->GetHandle());
+	atlas.ClearTexData(); // On the GPU now
+
+	io.FontDefault = GetFontPointer(m_Settings.m_Theme.m_Font);
+	RequestRedraw();
 }
 
 void MainWindow::OnImGuiInit()
 {
+	TF2BD_STARTUP_PHASE("MainWindow::OnImGuiInit");
 	Super::OnImGuiInit();
 
 	ImGui::GetIO().FontGlobalScale = m_Settings.m_Theme.m_GlobalScale;
@@ -126,8 +203,10 @@ void MainWindow::OnImGuiInit()
 
 void MainWindow::OnOpenGLInit()
 {
+	TF2BD_STARTUP_PHASE("MainWindow::OnOpenGLInit");
 	Super::OnOpenGLInit();
 
+	TF2BD_STARTUP_PHASE("IBaseTextures::Create");
 	m_BaseTextures = IBaseTextures::Create(*m_TextureManager);
 }
 
@@ -152,7 +231,7 @@ ImFont* MainWindow::GetFontPointer(Font f) const
 void MainWindow::OnDrawColorPicker(const char* name, std::array<float, 4>& color)
 {
 	if (ImGui::ColorEdit4(name, color.data(), ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_AlphaPreview))
-		m_Settings.SaveFile();
+		m_Settings.SaveFileDeferred();
 }
 
 void MainWindow::OnDrawColorPickers(const char* id, const std::initializer_list<ColorPicker>& pickers)
@@ -169,6 +248,8 @@ void MainWindow::OnDrawColorPickers(const char* id, const std::initializer_list<
 
 void MainWindow::OnDrawChat()
 {
+	TF2BD_PROFILE_SCOPE("MainWindow::OnDrawChat");
+
 	OnDrawColorPickers("ChatColorPickers",
 		{
 			{ "You", m_Settings.m_Theme.m_Colors.m_ChatLogYouFG },
@@ -176,6 +257,19 @@ void MainWindow::OnDrawChat()
 			{ "Friendlies", m_Settings.m_Theme.m_Colors.m_ChatLogFriendlyTeamFG },
 		});
 
+	if (m_MainState)
+	{
+		ImGui::SetNextItemWidth(-FLT_MIN);
+		if (ImGui::InputTextWithHint("##ChatSearch", "Search chat history for a name or message", &m_MainState->m_ChatSearchQuery))
+			m_MainState->m_ChatSearchHistorySize = SIZE_MAX;
+
+		if (!m_MainState->m_ChatSearchQuery.empty())
+		{
+			OnDrawChatSearchResults();
+			return;
+		}
+	}
+
 	ImGui::AutoScrollBox("##fileContents", { 0, 0 }, [&]()
 		{
 			if (!m_MainState)
@@ -183,33 +277,193 @@ void MainWindow::OnDrawChat()
 
 			ImGui::PushTextWrapPos();
 
+			auto& lines = m_MainState->m_PrintingLines;
+
+			// Wrapped lines change height with the width of the box
+			if (const float wrapWidth = ImGui::GetContentRegionAvail().x; wrapWidth != m_MainState->m_PrintingLinesWrapWidth)
+			{
+				m_MainState->m_PrintingLinesWrapWidth = wrapWidth;
+				for (size_t i = 0; i < lines.size(); i++)
+					lines[i].m_Height = 0;
+			}
+
+			// Lines have different heights, so ImGuiListClipper doesn't work here. Instead, only Print() lines
+			// that are (or might be) visible, and skip over the rest using their height from the last time
+			// they were printed.
+			const float visibleMinY = ImGui::GetScrollY();
+			const float visibleMaxY = visibleMinY + ImGui::GetWindowHeight();
+			const float itemSpacingY = ImGui::GetStyle().ItemSpacing.y;
+			float skippedHeight = 0;
+
+			const auto SkipLines = [&]
+			{
+				if (skippedHeight > 0)
+				{
+					ImGui::Dummy({ 0, skippedHeight - itemSpacingY });
+					skippedHeight = 0;
+				}
+			};
+
 			const IConsoleLine::PrintArgs args{ m_Settings, *m_WorldState, *this };
-			for (auto it = m_MainState->m_PrintingLines.rbegin(); it != m_MainState->m_PrintingLines.rend(); ++it)
+			for (size_t i = 0; i < lines.size(); i++)
 			{
-				assert(*it);
-				(*it)->Print(args);
+				auto& line = lines[i];
+				assert(line.m_Line);
+
+				const float lineMinY = ImGui::GetCursorPosY() + skippedHeight;
+				if (line.m_Height > 0 && ((lineMinY + line.m_Height) < visibleMinY || lineMinY > visibleMaxY))
+				{
+					skippedHeight += line.m_Height;
+					continue;
+				}
+
+				SkipLines();
+				line.m_Line->Print(args);
+				line.m_Height = ImGui::GetCursorPosY() - lineMinY;
 			}
 
+			SkipLines();
+
 			ImGui::PopTextWrapPos();
 		});
 }
 
+void MainWindow::PostSetupFlowState::UpdateChatSearch()
+{
+	// New messages might match too
+	if (m_ChatSearchHistorySize == m_ChatHistory.size())
+		return;
+
+	const auto startTime = clock_t::now();
+	m_ChatSearchResults = m_ChatHistory.Search(m_ChatSearchQuery, MAX_CHAT_SEARCH_RESULTS);
+	m_ChatSearchTimeMS = to_seconds<float>(clock_t::now() - startTime) * 1000;
+	m_ChatSearchHistorySize = m_ChatHistory.size();
+}
+
+void MainWindow::OnDrawChatSearchResults()
+{
+	auto& state = m_MainState.value();
+	state.UpdateChatSearch();
+
+	const auto& results = state.m_ChatSearchResults;
+	ImGui::TextFmt({ 1, 1, 1, 0.5f }, "{}{} of {} messages in {:.1f} ms",
+		results.size(), results.size() >= MAX_CHAT_SEARCH_RESULTS ? "+" : "", state.m_ChatHistory.size(),
+		state.m_ChatSearchTimeMS);
+
+	if (ImGui::BeginChild("##ChatSearchResults", { 0, 0 }, true, ImGuiWindowFlags_HorizontalScrollbar))
+	{
+		// Not wrapped, so every row is the same height
+		ImGuiListClipper clipper;
+		clipper.Begin(int(results.size()));
+		while (clipper.Step())
+		{
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+			{
+				const auto entry = state.m_ChatHistory.GetEntry(results[i]);
+				const std::tm timestamp = ToTM(entry.m_Timestamp);
+
+				ImGuiDesktop::ScopeGuards::ID id(&results[i]);
+				ImGui::BeginGroup();
+				ImGui::TextColored({ 0.25f, 1.0f, 0.25f, 0.25f }, "[%02i:%02i:%02i]",
+					timestamp.tm_hour, timestamp.tm_min, timestamp.tm_sec);
+				ImGui::SameLine();
+				ImGui::TextFmt("{}{}{}: {}", entry.m_IsDead ? "*DEAD* " : "", entry.m_IsTeam ? "(TEAM) " : "",
+					entry.m_Name.view(), entry.m_Text);
+				ImGui::EndGroup();
+
+				if (auto popup = ImGui::BeginPopupContextItemScope("ChatSearchResultContextMenu"))
+				{
+					if (ImGui::MenuItem("Copy"))
+						ImGui::SetClipboardText(mh::format("{}: {}", entry.m_Name.view(), entry.m_Text).c_str());
+				}
+				else if (ImGui::IsItemHovered())
+				{
+					if (auto player = GetWorld().FindPlayer(entry.m_SteamID))
+						DrawPlayerTooltip(*player);
+				}
+			}
+		}
+	}
+	ImGui::EndChild();
+}
+
+void MainWindow::UpdateAppLogLines()
+{
+	const ILogManager& logManager = ILogManager::GetInstance();
+	bool changed = false;
+
+	// Cleared, or pushed out of the log manager's ring
+	const uint64_t firstVisible = logManager.GetFirstVisibleMsgSequence();
+	while (!m_AppLogLines.empty() && m_AppLogLines.front().m_Message->m_Sequence < firstVisible)
+	{
+		m_AppLogLines.pop_front();
+		changed = true;
+	}
+
+	for (auto& msg : logManager.GetVisibleMsgsSince(m_AppLogNextSequence))
+	{
+		const std::tm timestamp = ToTM(msg->m_Timestamp);
+		m_AppLogNextSequence = msg->m_Sequence + 1;
+		m_AppLogLines.push_back(AppLogLine
+			{
+				.m_Message = std::move(msg),
+				.m_Timestamp = mh::format("[{:02}:{:02}:{:02}]", timestamp.tm_hour, timestamp.tm_min, timestamp.tm_sec),
+			});
+		changed = true;
+	}
+
+	if (changed)
+		QueueUpdate();
+}
+
 void MainWindow::OnDrawAppLog()
 {
+	TF2BD_PROFILE_SCOPE("MainWindow::OnDrawAppLog");
+
+	UpdateAppLogLines();
+
 	ImGui::AutoScrollBox("AppLog", { 0, 0 }, [&]()
 		{
 			ImGui::PushTextWrapPos();
 
-			const void* lastLogMsg = nullptr;
-			for (const LogMessage& msg : ILogManager::GetInstance().GetVisibleMsgs())
+			if (const float wrapWidth = ImGui::GetContentRegionAvail().x; wrapWidth != m_AppLogWrapWidth)
+			{
+				m_AppLogWrapWidth = wrapWidth;
+				for (auto& line : m_AppLogLines)
+					line.m_Height = 0;
+			}
+
+			// Same as the chat log, only draw what's (or might be) on screen and skip the rest
+			const float visibleMinY = ImGui::GetScrollY();
+			const float visibleMaxY = visibleMinY + ImGui::GetWindowHeight();
+			const float itemSpacingY = ImGui::GetStyle().ItemSpacing.y;
+			float skippedHeight = 0;
+
+			const auto SkipLines = [&]
 			{
-				const std::tm timestamp = ToTM(msg.m_Timestamp);
+				if (skippedHeight > 0)
+				{
+					ImGui::Dummy({ 0, skippedHeight - itemSpacingY });
+					skippedHeight = 0;
+				}
+			};
 
+			for (auto& line : m_AppLogLines)
+			{
+				const float lineMinY = ImGui::GetCursorPosY() + skippedHeight;
+				if (line.m_Height > 0 && ((lineMinY + line.m_Height) < visibleMinY || lineMinY > visibleMaxY))
+				{
+					skippedHeight += line.m_Height;
+					continue;
+				}
+
+				SkipLines();
+
+				const LogMessage& msg = *line.m_Message;
 				ImGuiDesktop::ScopeGuards::ID id(&msg);
 
 				ImGui::BeginGroup();
-				ImGui::TextColored({ 0.25f, 1.0f, 0.25f, 0.25f }, "[%02i:%02i:%02i]",
-					timestamp.tm_hour, timestamp.tm_min, timestamp.tm_sec);
+				ImGui::TextFmt({ 0.25f, 1.0f, 0.25f, 0.25f }, line.m_Timestamp);
 
 				ImGui::SameLine();
 				ImGui::TextFmt({ msg.m_Color.r, msg.m_Color.g, msg.m_Color.b, msg.m_Color.a }, msg.m_Text);
@@ -221,14 +475,10 @@ void MainWindow::OnDrawAppLog()
 						ImGui::SetClipboardText(msg.m_Text.c_str());
 				}
 
-				lastLogMsg = &msg;
+				line.m_Height = ImGui::GetCursorPosY() - lineMinY;
 			}
 
-			if (m_LastLogMessage != lastLogMsg)
-			{
-				m_LastLogMessage = lastLogMsg;
-				QueueUpdate();
-			}
+			SkipLines();
 
 			ImGui::PopTextWrapPos();
 		});
@@ -260,6 +510,257 @@ void MainWindow::OpenUpdateCheckPopup()
 	m_UpdateCheckPopupOpen = true;
 }
 
+void MainWindow::OnDrawProfilerWindow()
+{
+	if (!m_Settings.m_Unsaved.m_DebugShowProfiler)
+		return;
+
+	ImGui::SetNextWindowSize({ 500, 250 }, ImGuiCond_FirstUseEver);
+	if (ImGui::Begin("Profiler", &m_Settings.m_Unsaved.m_DebugShowProfiler))
+	{
+		auto& profiler = Profiler::GetInstance();
+
+		if (!profiler.IsRecordingTrace())
+		{
+			if (ImGui::Button("Record Trace"))
+				profiler.StartTrace();
+
+			ImGui::SameLine();
+			ImGui::SetHoverTooltip("Records every timed section until stopped, then exports it as a Chrome trace to the logs folder.");
+		}
+		else if (ImGui::Button(mh::fmtstr<64>("Stop and Export ({} events)", profiler.GetTraceEventCount()).c_str()))
+		{
+			profiler.StopTrace(IFilesystem::Get().GetLogsDir() /
+				mh::format("profiler_trace_{}.json", std::chrono::duration_cast<std::chrono::seconds>(
+					clock_t::now().time_since_epoch()).count()));
+		}
+
+		// The imgui version we're on doesn't have tables yet
+		ImGui::Columns(6, "ProfilerSections");
+		for (const char* header : { "Section", "Calls/s", "Total ms/s", "p50 ms", "p99 ms", "Max ms" })
+		{
+			ImGui::TextFmt(header);
+			ImGui::NextColumn();
+		}
+		ImGui::Separator();
+
+		profiler.ForEachSection([](const std::string_view& name, const Profiler::SectionStats& stats)
+			{
+				const auto ToMS = [](Profiler::clock_t::duration duration) { return to_seconds<float>(duration) * 1000; };
+
+				ImGui::TextFmt(name); ImGui::NextColumn();
+				ImGui::TextFmt("{}", stats.m_Count); ImGui::NextColumn();
+				ImGui::TextFmt("{:1.2f}", ToMS(stats.m_Total)); ImGui::NextColumn();
+				ImGui::TextFmt("{:1.3f}", ToMS(stats.GetPercentile(0.5f))); ImGui::NextColumn();
+				ImGui::TextFmt("{:1.3f}", ToMS(stats.GetPercentile(0.99f))); ImGui::NextColumn();
+				ImGui::TextFmt("{:1.3f}", ToMS(stats.m_Max)); ImGui::NextColumn();
+			});
+
+		ImGui::Columns();
+
+		if (auto client = m_Settings.GetHTTPClient(); client && ImGui::CollapsingHeader("HTTP"))
+		{
+			ImGui::Columns(7, "ProfilerHTTPHosts");
+			for (const char* header : { "Host", "Requests", "Req/min", "Failed", "Retries", "MB", "p50/p95/p99 ms" })
+			{
+				ImGui::TextFmt(header);
+				ImGui::NextColumn();
+			}
+			ImGui::Separator();
+
+			for (const auto& host : client->GetHostStats())
+			{
+				ImGui::TextFmt(host.m_Host); ImGui::NextColumn();
+				ImGui::TextFmt("{}", host.m_Requests); ImGui::NextColumn();
+				ImGui::TextFmt("{}", host.m_RequestsLastMinute); ImGui::NextColumn();
+				ImGui::TextFmt("{}", host.m_Failed); ImGui::NextColumn();
+				ImGui::TextFmt("{}", host.m_Retries); ImGui::NextColumn();
+				ImGui::TextFmt("{:1.2f}", host.m_BytesReceived / 1024.0f / 1024); ImGui::NextColumn();
+				ImGui::TextFmt("{}/{}/{}", host.m_LatencyP50.count(), host.m_LatencyP95.count(), host.m_LatencyP99.count()); ImGui::NextColumn();
+			}
+
+			ImGui::Columns();
+		}
+
+		if (ImGui::CollapsingHeader("RCON"))
+		{
+			const auto stats = GetActionManager().GetStats();
+
+			ImGui::TextFmt("In flight: {}, queued: {} (max {})", stats.m_InFlight, stats.m_Queued, stats.m_MaxQueued);
+			ImGui::TextFmt("Timed out: {}, broken promises: {}, other errors: {}, reconnects: {}",
+				stats.m_TimedOut, stats.m_BrokenPromises, stats.m_Errors, stats.m_Reconnects);
+			ImGui::SetHoverTooltip("Reconnects are commands that went through again after one failed.");
+
+			ImGui::Columns(6, "ProfilerRCONCommands");
+			for (const char* header : { "Type", "Commands", "Failed", "Over Target", "p50/p95/p99 ms", "Max ms" })
+			{
+				ImGui::TextFmt(header);
+				ImGui::NextColumn();
+			}
+			ImGui::Separator();
+
+			for (const auto& type : stats.m_CommandTypes)
+			{
+				ImGui::TextFmt("{:v}", mh::enum_fmt(type.m_Type)); ImGui::NextColumn();
+				ImGui::TextFmt("{}", type.m_Commands); ImGui::NextColumn();
+				ImGui::TextFmt("{}", type.m_Failed); ImGui::NextColumn();
+				ImGui::TextFmt("{}", type.m_OverLatencyTarget); ImGui::NextColumn();
+				ImGui::SetHoverTooltip("Answered more than {}ms after being sent", IRCONActionManager::LATENCY_TARGET.count());
+				ImGui::TextFmt("{}/{}/{}", type.m_LatencyP50.count(), type.m_LatencyP95.count(), type.m_LatencyP99.count()); ImGui::NextColumn();
+				ImGui::TextFmt("{}", type.m_LatencyMax.count()); ImGui::NextColumn();
+			}
+
+			ImGui::Columns();
+		}
+
+		if (ImGui::CollapsingHeader("Temp DB"))
+		{
+			const auto stats = TF2BDApplication::GetApplication().GetTempDB().GetStats();
+
+			ImGui::TextFmt("DB: {:1.2f} MB, WAL: {:1.2f} MB", stats.m_DBFileSize / 1024.0f / 1024, stats.m_WALFileSize / 1024.0f / 1024);
+			ImGui::TextFmt("Cache hits: {}/{} ({:1.1f}%)", stats.m_CacheHits, stats.m_CacheLookups,
+				stats.m_CacheLookups ? stats.m_CacheHits / float(stats.m_CacheLookups) * 100 : 0.0f);
+			ImGui::SetHoverTooltip("Lookups that found an entry that hadn't expired yet, and didn't need to go out to the network.");
+			ImGui::TextFmt("Unwritten store hits: {}", stats.m_PendingHits);
+			ImGui::TextFmt("Commits: {}, p99 {} us", stats.m_Commits, stats.m_CommitLatencyP99.count());
+			ImGui::TextFmt("Remote cache: {}/{} hits, {} writes, {} failed", stats.m_RemoteCache.m_Hits,
+				stats.m_RemoteCache.m_Lookups, stats.m_RemoteCache.m_Puts, stats.m_RemoteCache.m_Failures);
+
+			ImGui::Columns(5, "ProfilerTempDBTables");
+			for (const char* header : { "Table", "Reads", "Writes", "Rows Read", "p50/p99 us" })
+			{
+				ImGui::TextFmt(header);
+				ImGui::NextColumn();
+			}
+			ImGui::Separator();
+
+			for (const auto& table : stats.m_Tables)
+			{
+				ImGui::TextFmt(table.m_Table); ImGui::NextColumn();
+				ImGui::TextFmt("{}", table.m_Reads); ImGui::NextColumn();
+				ImGui::TextFmt("{}", table.m_Writes); ImGui::NextColumn();
+				ImGui::TextFmt("{}", table.m_RowsRead); ImGui::NextColumn();
+				ImGui::TextFmt("{}/{}", table.m_LatencyP50.count(), table.m_LatencyP99.count()); ImGui::NextColumn();
+			}
+
+			ImGui::Columns();
+		}
+	}
+	ImGui::End();
+}
+
+void MainWindow::OnDrawMemoryWindow()
+{
+	MemoryTracker::SetEnabled(m_Settings.m_Unsaved.m_DebugTrackMemory);
+	if (!m_Settings.m_Unsaved.m_DebugTrackMemory)
+		return;
+
+	ImGui::SetNextWindowSize({ 500, 200 }, ImGuiCond_FirstUseEver);
+	if (ImGui::Begin("Memory", &m_Settings.m_Unsaved.m_DebugTrackMemory))
+	{
+		ImGui::TextFmt("RAM Usage: {:1.1f} MB", Platform::Processes::GetCurrentRAMUsage() / 1024.0f / 1024);
+		ImGui::SameLine();
+		ImGui::TextFmt({ 1, 1, 1, 0.6f }, "(console lines are always counted, everything else only since this window was opened)");
+
+		const auto ToMB = [](auto bytes) { return bytes / 1024.0f / 1024; };
+
+		if (const auto heap = MemoryTracker::GetHeapStats())
+		{
+			ImGui::TextFmt("mimalloc: {:1.1f} MB committed (peak {:1.1f} MB), {:1.1f} MB resident (peak {:1.1f} MB), {} page faults",
+				ToMB(heap->m_CommittedBytes), ToMB(heap->m_PeakCommittedBytes),
+				ToMB(heap->m_RSSBytes), ToMB(heap->m_PeakRSSBytes), heap->m_PageFaults);
+		}
+		else
+		{
+			ImGui::TextFmt({ 1, 1, 1, 0.6f }, "Default heap (no allocator stats without TF2BD_USE_MIMALLOC)");
+		}
+
+		ImGui::Columns(5, "MemoryCategories");
+		for (const char* header : { "Category", "Live", "Live MB", "Total", "Total MB" })
+		{
+			ImGui::TextFmt(header);
+			ImGui::NextColumn();
+		}
+		ImGui::Separator();
+
+		for (size_t i = 0; i < size_t(MemoryCategory::COUNT); i++)
+		{
+			const auto category = MemoryCategory(i);
+			const MemoryUsage usage = MemoryTracker::GetUsage(category);
+
+			ImGui::TextFmt("{:v}", mh::enum_fmt(category)); ImGui::NextColumn();
+			ImGui::TextFmt("{}", usage.m_LiveCount); ImGui::NextColumn();
+			ImGui::TextFmt("{:1.2f}", ToMB(usage.m_LiveBytes)); ImGui::NextColumn();
+			ImGui::TextFmt("{}", usage.m_TotalCount); ImGui::NextColumn();
+			ImGui::TextFmt("{:1.2f}", ToMB(usage.m_TotalBytes)); ImGui::NextColumn();
+		}
+
+		ImGui::Columns();
+	}
+	ImGui::End();
+}
+
+void MainWindow::OnDrawDecisionTraceWindow()
+{
+	if (!m_Settings.m_Unsaved.m_DebugShowDecisionTrace || !m_MainState)
+		return;
+
+	ImGui::SetNextWindowSize({ 700, 250 }, ImGuiCond_FirstUseEver);
+	if (ImGui::Begin("Moderation Decisions", &m_Settings.m_Unsaved.m_DebugShowDecisionTrace))
+	{
+		const auto& modLogic = GetModLogic();
+		if (ImGui::Button("Export"))
+		{
+			modLogic.ExportDecisionTrace(IFilesystem::Get().GetLogsDir() /
+				mh::format("moderation_decisions_{}.json", std::chrono::duration_cast<std::chrono::seconds>(
+					clock_t::now().time_since_epoch()).count()));
+		}
+		ImGui::SameLine();
+		ImGui::SetHoverTooltip("Writes every decision below to the logs folder as json.");
+
+		ImGui::Columns(8, "DecisionTrace");
+		for (const char* header : { "Type", "Player", "Rule/Marked In", "Parse ms", "Detect->Queue ms", "Queue->Sent ms", "Sent->Ack ms", "Total ms" })
+		{
+			ImGui::TextFmt(header);
+			ImGui::NextColumn();
+		}
+		ImGui::Separator();
+
+		const auto ToMS = [](duration_t duration) { return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(); };
+		const auto DurationColumn = [&](const std::optional<time_point_t>& begin, const std::optional<time_point_t>& end)
+		{
+			if (begin && end)
+				ImGui::TextFmt("{}", ToMS(*end - *begin));
+			else
+				ImGui::TextFmt({ 1, 1, 1, 0.5f }, "-");
+
+			ImGui::NextColumn();
+		};
+
+		// Newest first
+		const auto& decisions = modLogic.GetDecisionTrace();
+		for (size_t i = decisions.size(); i-- > 0; )
+		{
+			const auto& decision = decisions[i];
+
+			ImGui::TextFmt("{:v}", mh::enum_fmt(decision.m_Type)); ImGui::NextColumn();
+			ImGui::TextFmt("{} {}", decision.m_PlayerName, decision.m_SteamID); ImGui::NextColumn();
+			ImGui::TextFmt(decision.m_Rule.empty() ? decision.m_MarkedIn : decision.m_Rule); ImGui::NextColumn();
+			DurationColumn(decision.m_DetectedGameTime, decision.m_DetectedTime);
+			DurationColumn(decision.m_DetectedTime, decision.m_QueuedTime);
+			DurationColumn(decision.m_QueuedTime, decision.m_SentTime);
+			DurationColumn(decision.m_SentTime, decision.m_AckTime);
+			DurationColumn(decision.m_DetectedTime, decision.m_AckTime);
+
+			if (decision.m_AckTime && !decision.m_AckSucceeded)
+				ImGui::SetHoverTooltip("The game never responded to this command");
+		}
+
+		ImGui::Columns();
+	}
+	ImGui::End();
+}
+
 void MainWindow::OnDrawAboutPopup()
 {
 	static constexpr char POPUP_NAME[] = "About##Popup";
@@ -454,11 +955,50 @@ void MainWindow::OnDrawServerStats()
 			}, (int)m_ServerPingSamples.size(), 0, nullptr, 0);
 	}
 
-	//OnDrawNetGraph();
+	OnDrawNetGraph();
+}
+
+void MainWindow::OnDrawNetGraph()
+{
+	if (!m_MainState)
+		return;
+
+	const auto& history = m_MainState->m_NetworkStatusHistory;
+	const auto now = GetCurrentTimestampCompensated();
+	constexpr duration_t GRAPH_WINDOW = 5min;
+
+	const auto PlotMetric = [&](NetworkMetric metric, const char* label)
+	{
+		const auto& series = history.GetSeries(metric);
+		if (series.IsEmpty())
+			return;
+
+		const auto& buckets = series.GetBuckets(series.FindTier(now, GRAPH_WINDOW));
+		size_t first = 0;
+		while (first < (buckets.size() - 1) && buckets[first].m_Begin < (now - GRAPH_WINDOW))
+			first++;
+
+		ImGui::PlotLines(mh::fmtstr<64>("{}: {:.1f}", label, series.GetLatest().m_Max).c_str(),
+			[&](int idx)
+			{
+				return buckets[first + idx].m_Max;
+			}, int(buckets.size() - first), 0, nullptr, 0);
+	};
+
+	PlotMetric(NetworkMetric::Latency, "Latency");
+	PlotMetric(NetworkMetric::Loss, "Loss");
+	PlotMetric(NetworkMetric::ChokeIn, "Choke (in)");
+	PlotMetric(NetworkMetric::FlowIn, "Flow (in)");
+
+	const auto& hfLines = m_MainState->m_Parser.GetHighFrequencyLines();
+	const auto& splitPackets = hfLines.GetSplitPackets(SocketType::Client);
+	ImGui::TextFmt("Split packets: {} ({} KB)", splitPackets.GetCount(), splitPackets.GetBytes() / 1024);
 }
 
 void MainWindow::OnDraw()
 {
+	TF2BD_PROFILE_SCOPE("MainWindow::OnDraw");
+
 	ImGui::GetIO().FontDefault = GetFontPointer(m_Settings.m_Theme.m_Font);
 	ImGui::GetIO().FontGlobalScale = m_Settings.m_Theme.m_GlobalScale;
 
@@ -467,7 +1007,11 @@ void MainWindow::OnDraw()
 
 	OnDrawUpdateCheckPopup();
 	OnDrawAboutPopup();
+	OnDrawProfilerWindow();
+	OnDrawMemoryWindow();
+	OnDrawDecisionTraceWindow();
 
+	if (!m_Benchmark)
 	{
 		ISetupFlowPage::DrawState ds;
 		ds.m_ActionManager = &GetActionManager();
@@ -497,7 +1041,7 @@ void MainWindow::OnDraw()
 				{
 					ImGuiDesktop::ScopeGuards::TextColor text({ 1, 0.5f, 0, 1 }, !value);
 					if (ImGui::Checkbox(name, &value))
-						settings.SaveFile();
+						settings.SaveFileDeferred();
 				}
 
 				const char* orangeReason = "";
@@ -514,6 +1058,15 @@ void MainWindow::OnDraw()
 
 			ImGui::Checkbox("Show Commands", &m_Settings.m_Unsaved.m_DebugShowCommands); ImGui::SameLine();
 			ImGui::SetHoverTooltip("Prints out all game commands to the log.");
+
+			ImGui::Checkbox("Show Profiler", &m_Settings.m_Unsaved.m_DebugShowProfiler); ImGui::SameLine();
+			ImGui::SetHoverTooltip("Shows how long each part of the update loop took over the last second.");
+
+			ImGui::Checkbox("Track Memory", &m_Settings.m_Unsaved.m_DebugTrackMemory); ImGui::SameLine();
+			ImGui::SetHoverTooltip("Counts what console lines, players, textures, HTTP responses, config files and log messages are holding on to.");
+
+			ImGui::Checkbox("Show Decisions", &m_Settings.m_Unsaved.m_DebugShowDecisionTrace); ImGui::SameLine();
+			ImGui::SetHoverTooltip("Shows the recent marks, warnings and votekicks, and how long each step before them took.");
 		});
 
 #ifdef _DEBUG
@@ -558,11 +1111,52 @@ void MainWindow::OnDraw()
 
 			QueuedText(reqs.m_InProgress, "running");
 			QueuedText(reqs.m_Throttled, "throttled");
+			QueuedText(reqs.m_RateLimited, "rate limited");
+			QueuedText(reqs.m_Cancelled, "cancelled");
+
+			ImGui::TextFmt("Rate limit wait: {}ms avg | {}ms max",
+				reqs.m_AverageRateLimitWait.count(), reqs.m_MaxRateLimitWait.count());
+
+			ImGui::TextFmt("Negative cache: {} hits of {} lookups ({:1.1f}%)",
+				reqs.m_NegativeCacheHits, reqs.m_NegativeCacheLookups,
+				reqs.m_NegativeCacheLookups ? reqs.m_NegativeCacheHits / float(reqs.m_NegativeCacheLookups) * 100 : 0.0f);
+
+			ImGui::TextFmt("Transferred: {:1.2f} MB ({:1.2f} MB decompressed, {} compressed responses)",
+				reqs.m_BytesTransferred / 1024.0f / 1024, reqs.m_BytesReceived / 1024.0f / 1024, reqs.m_CompressedResponses);
+
+			for (size_t i = 0; i < size_t(HTTPRequestTag::COUNT); i++)
+			{
+				const auto tag = HTTPRequestTag(i);
+				const IHTTPClient::TagStats stats = client->GetTagStats(tag);
+				if (stats.m_Requests == 0)
+					continue;
+
+				ImGui::TextFmt("  {:v}: {} requests | {} failed | {:1.2f} MB | {} rate limited ({}ms)",
+					mh::enum_fmt(tag), stats.m_Requests, stats.m_Failed,
+					(stats.m_BytesTransferred + stats.m_BytesSent) / 1024.0f / 1024,
+					stats.m_RateLimitWaits, stats.m_RateLimitWaitTotal.count());
+			}
+
+			for (const auto& key : SteamAPI::KeyPool::Get().GetStats())
+			{
+				ImGui::TextFmt("Steam API key {}...: {} running | {} today | {} rate limited | {}s cooldown",
+					key.m_KeyPrefix, key.m_InFlight, key.m_RequestsToday, key.m_RateLimitedCount,
+					std::chrono::duration_cast<std::chrono::seconds>(key.m_CooldownRemaining).count());
+			}
 		}
 		else
 		{
 			ImGui::TextFmt("HTTP Requests: HTTPClient Unavailable");
 		}
+
+		for (size_t i = 0; i < size_t(TaskLane::COUNT); i++)
+		{
+			const TaskLane lane = TaskLane(i);
+			const TaskLaneStats stats = TaskScheduler::Get().GetStats(lane);
+			ImGui::TextFmt("{:v} lane: {} threads | {} queued | {} done | {:1.0f}% busy",
+				mh::enum_fmt(lane), stats.m_ThreadCount, stats.m_QueueDepth, stats.m_CompletedCount,
+				stats.m_Utilization * 100);
+		}
 	}
 #endif
 
@@ -582,6 +1176,16 @@ void MainWindow::OnDraw()
 		}
 
 		ImGui::Value("Parsed line count", parsedLineCount);
+
+		if (const auto& parser = m_MainState->m_Parser; parser.GetBacklogBytes() > 0)
+		{
+			const auto backlogKB = parser.GetBacklogBytes() / 1024;
+			const auto lag = to_seconds<float>(parser.GetLag());
+			if (parser.IsOverloaded())
+				ImGui::TextFmt({ 1, 0.5f, 0, 1 }, "Console log backlog: {} KB, {:.1f}s behind (only parsing status, lobby and chat)", backlogKB, lag);
+			else
+				ImGui::TextFmt("Console log backlog: {} KB, {:.1f}s behind", backlogKB, lag);
+		}
 	}
 
 	//OnDrawServerStats();
@@ -614,23 +1218,43 @@ void MainWindow::OnDrawAllPanesDisabled()
 	if (ImGui::Button("Show Chat"))
 	{
 		mainWindowState.m_ChatEnabled = true;
-		m_Settings.SaveFile();
+		m_Settings.SaveFileDeferred();
 	}
 	if (ImGui::Button("Show Scoreboard"))
 	{
 		mainWindowState.m_ScoreboardEnabled = true;
-		m_Settings.SaveFile();
+		m_Settings.SaveFileDeferred();
 	}
 	if (ImGui::Button("Show App Log"))
 	{
 		mainWindowState.m_AppLogEnabled = true;
-		m_Settings.SaveFile();
+		m_Settings.SaveFileDeferred();
 	}
 }
 
 void MainWindow::OnEndFrame()
 {
+	UpdateAvatarQueue();
+
+	// Before the texture manager's EndFrame, so anything evicted is freed right away
+	if (ImGui::GetFrameCount() % 60 == 0)
+		EvictAvatarTextures(size_t(m_Settings.m_AvatarTextureBudgetMB) * 1024 * 1024);
+
 	m_TextureManager->EndFrame();
+
+	m_DeferredInit.OnFramePresented();
+	if (m_MainState)
+		m_MainState->m_DeferredInit.OnFramePresented();
+
+	if (m_Settings.m_RenderOnDemand)
+	{
+		const ImGuiIO& io = ImGui::GetIO();
+		if (io.MouseDelta.x != 0 || io.MouseDelta.y != 0 || io.MouseWheel != 0 || ImGui::IsAnyMouseDown() ||
+			!io.InputQueueCharacters.empty() || ImGui::IsAnyItemActive())
+		{
+			RequestRedraw();
+		}
+	}
 }
 
 void MainWindow::OnDrawMenuBar()
@@ -670,13 +1294,13 @@ void MainWindow::OnDrawMenuBar()
 	if (!isInSetupFlow && ImGui::BeginMenu("View"))
 	{
 		if (ImGui::MenuItem("Show Chat Log", nullptr, &m_Settings.m_UIState.m_MainWindow.m_ChatEnabled))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 		if (ImGui::MenuItem("Show App Log", nullptr, &m_Settings.m_UIState.m_MainWindow.m_AppLogEnabled))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 		if (ImGui::MenuItem("Show Team Stats", nullptr, &m_Settings.m_UIState.m_MainWindow.m_TeamStatsEnabled))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 		if (ImGui::MenuItem("Show Scoreboard", nullptr, &m_Settings.m_UIState.m_MainWindow.m_ScoreboardEnabled))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 
 		ImGui::EndMenu();
 	}
@@ -734,6 +1358,17 @@ void MainWindow::OnDrawMenuBar()
 		static const mh::fmtstr<128> VERSION_STRING_LABEL("Version: {}", VERSION);
 		ImGui::MenuItem(VERSION_STRING_LABEL.c_str(), nullptr, false, false);
 
+		// Usually found by the background check after the setup flow is done, so it's not in anyone's way
+		if (auto update = m_UpdateManager->GetAvailableUpdate(); update && update->m_BuildInfo.m_Version > VERSION)
+		{
+			const auto& url = update->m_BuildInfo.m_GitHubURL;
+			if (ImGui::MenuItem(mh::fmtstr<128>("Update available: v{}", update->m_BuildInfo.m_Version).c_str(),
+				nullptr, false, !url.empty()))
+			{
+				Shell::OpenURL(url);
+			}
+		}
+
 		ImGui::Separator();
 
 		if (ImGui::MenuItem("About TF2 Bot Detector"))
@@ -746,7 +1381,9 @@ void MainWindow::OnDrawMenuBar()
 void MainWindow::PostSetupFlowState::OnUpdateDiscord()
 {
 #ifdef TF2BD_ENABLE_DISCORD_INTEGRATION
-	const auto curTime = clock_t::now();
+	if (!m_IsDiscordStarted)
+		return;
+
 	if (!m_DRPManager && m_Parent->m_Settings.m_Discord.m_EnableRichPresence)
 	{
 		m_DRPManager = IDRPManager::Create(m_Parent->m_Settings, m_Parent->GetWorld());
@@ -763,33 +1400,116 @@ void MainWindow::PostSetupFlowState::OnUpdateDiscord()
 
 void MainWindow::OnUpdate()
 {
+	TF2BD_PROFILE_SCOPE("MainWindow::OnUpdate");
+
+	FrameClock::BeginFrame();
+	m_Settings.UpdateDeferredSave();
+
+	if (m_GlyphCache.HasPending() && m_TextureManager &&
+		(FrameClock::Now() - m_LastFontAtlasRebuild) >= GLYPH_REBUILD_INTERVAL)
+	{
+		RebuildFontAtlas();
+	}
+
 	if (m_Paused)
 		return;
 
 	GetDispatcher().run_for(10ms);
+	TaskScheduler::Get().RunMainThreadTasks(MAIN_THREAD_TASK_BUDGET);
+
+	// Before the console log gets parsed (and mirrored) below
+	ILogManager::GetInstance().SetConsoleLogCompressed(m_Settings.m_Logging.m_CompressConsoleLogs);
+	SetDebugLogEnabled(m_Settings.m_Logging.m_DebugMessages);
+	IEventLog::SetEnabled(m_Settings.m_Logging.m_EventLog);
+	TaskScheduler::Get().SetThreadPolicy({ m_Settings.m_LowPriorityBackgroundThreads, m_Settings.m_BackgroundThreadAffinity });
+
+	// Our frames can wait, TF2's can't
+	if (const bool lowerPriority = m_Settings.m_LowerUIPriorityWhileTF2Focused && Processes::IsTF2Foreground();
+		lowerPriority != m_UIPriorityLowered)
+	{
+		Platform::SetCurrentThreadPriority(lowerPriority ? ThreadPriority::BelowNormal : ThreadPriority::Normal);
+		m_UIPriorityLowered = lowerPriority;
+	}
 
 	GetWorld().Update();
-	m_UpdateManager->Update();
+	m_DeferredInit.Update();
+	if (m_MainState)
+		m_MainState->m_DeferredInit.Update();
+
+	if (m_IsUpdateManagerStarted)
+		m_UpdateManager->Update();
+
+	// Temp db maintenance waits until we're not in a match
+	{
+		const IWorldState& world = GetWorld();
+		const bool idle = world.GetApproxLobbyMemberCount() == 0 &&
+			(world.GetCurrentTime() - world.GetLastStatusUpdateTime()) > 60s;
+
+		auto& tempDB = TF2BDApplication::GetApplication().GetTempDB();
+		tempDB.SetMaintenanceOptions(idle, uint64_t(m_Settings.m_TempDBMaxSizeMB) * 1024 * 1024);
+		tempDB.SetSnapshotPath(m_Settings.m_TempDBSnapshotPath);
+		tempDB.SetRemoteCache(m_Settings.m_TempDBRemoteCacheURL, m_Settings.GetHTTPClient());
+
+		if (idle && !m_WasIdle)
+			ReclaimIdleMemory();
+
+		m_WasIdle = idle;
+	}
 
 	if (m_Settings.m_Unsaved.m_RCONClient)
 		m_Settings.m_Unsaved.m_RCONClient->set_logging(m_Settings.m_Logging.m_RCONPackets);
-
-	if (m_SetupFlow.OnUpdate(m_Settings))
+	ISetupFlowPage::UpdateState setupUpdateState(m_Settings);
+	setupUpdateState.m_UpdateManager = m_UpdateManager.get();
+	if (!m_Benchmark && m_SetupFlow.OnUpdate(setupUpdateState))
 	{
 		m_MainState.reset();
 	}
 	else
 	{
 		if (!m_MainState)
-			m_MainState.emplace(*this);
+		{
+			StartupTimeline::EndPhase(std::exchange(m_SetupFlowStartupPhase, StartupTimeline::INVALID_PHASE));
+			{
+				TF2BD_STARTUP_PHASE("PostSetupFlowState");
+				m_MainState.emplace(*this);
+			}
+			StartupTimeline::MarkComplete();
+
+			// Its deferred init waits for a frame with it on screen
+			RequestRedraw();
+		}
+
+		// console.log is the fallback whenever rcon can't keep us up to date on its own
+		m_MainState->m_Parser.SetFileInputEnabled(!m_Benchmark &&
+			(!m_Settings.m_RCONOnlyConsoleInput || !GetActionManager().IsResponding()));
+
+		if (m_Benchmark && !ShouldClose() && !m_Benchmark->Update(GetWorld(), m_MainState->m_Parser, GetModLogic()))
+		{
+			m_Benchmark->LogResults();
+			SetShouldClose(true);
+		}
 
 		m_MainState->m_Parser.Update();
 		GetModLogic().Update();
+		m_MainState->m_SessionSnapshot.Update();
+		m_MainState->m_SharedWorldStateExporter.Update();
 
 		m_MainState->OnUpdateDiscord();
 	}
 
 	GetActionManager().Update();
+
+	{
+		const MetricsExporter::Session session
+		{
+			.m_Parser = m_MainState ? &m_MainState->m_Parser : nullptr,
+			.m_ActionManager = m_ActionManager.get(),
+			.m_ModLogic = m_MainState ? m_MainState->m_ModeratorLogic.get() : nullptr,
+		};
+		m_MetricsExporter.Update({ &session, 1 });
+	}
+
+	UpdateRedrawTriggers();
 }
 
 void MainWindow::OnConsoleLogChunkParsed(IWorldState& world, bool consoleLinesUpdated)
@@ -797,12 +1517,75 @@ void MainWindow::OnConsoleLogChunkParsed(IWorldState& world, bool consoleLinesUp
 	assert(&world == &GetWorld());
 
 	if (consoleLinesUpdated)
+	{
 		UpdateServerPing(GetCurrentTimestampCompensated());
+		RequestRedraw();
+	}
 }
 
 bool MainWindow::IsSleepingEnabled() const
 {
-	return m_Settings.m_SleepWhenUnfocused && !HasFocus();
+	if (m_Benchmark)
+		return false;
+
+	if (m_Settings.m_SleepWhenUnfocused && !HasFocus())
+		return true;
+
+	if (m_Settings.m_RenderOnDemand)
+		return tfbd_clock_t::now() >= m_RedrawUntil;
+
+	return false;
+}
+
+void MainWindow::RequestRedraw(duration_t linger)
+{
+	m_RedrawUntil = std::max(m_RedrawUntil, tfbd_clock_t::now() + linger);
+}
+
+void MainWindow::UpdateRedrawTriggers()
+{
+	TF2BD_PROFILE_SCOPE("MainWindow::UpdateRedrawTriggers");
+
+	if (!m_Settings.m_RenderOnDemand)
+		return;
+
+	const auto now = tfbd_clock_t::now();
+	if ((now - m_LastRedrawTick) >= REDRAW_TICK_INTERVAL)
+	{
+		// Just long enough for a frame or two
+		RequestRedraw(std::chrono::milliseconds(50));
+		m_LastRedrawTick = now;
+	}
+
+	// Main thread work that didn't fit in this frame's budget
+	if (TaskScheduler::Get().GetQueueDepth(TaskLane::Main) > 0)
+		RequestRedraw(std::chrono::milliseconds(50));
+
+	// Finished http requests
+	if (auto client = m_Settings.GetHTTPClient())
+	{
+		const IHTTPClient::RequestCounts reqs = client->GetRequestCounts();
+		const std::array<uint32_t, 4> counts{ reqs.m_Total, reqs.m_Failed, reqs.m_InProgress, reqs.m_Throttled };
+		if (counts != m_LastHTTPRequestCounts)
+		{
+			m_LastHTTPRequestCounts = counts;
+			RequestRedraw();
+		}
+	}
+
+	// Finished temp db reads/writes
+	{
+		const auto stats = TF2BDApplication::GetApplication().GetTempDB().GetStats();
+		uint64_t activity = uint64_t(stats.m_Commits) + stats.m_PendingHits;
+		for (const auto& table : stats.m_Tables)
+			activity += table.m_Reads;
+
+		if (activity != m_LastTempDBActivity)
+		{
+			m_LastTempDBActivity = activity;
+			RequestRedraw();
+		}
+	}
 }
 
 bool MainWindow::IsTimeEven() const
@@ -822,14 +1605,17 @@ void MainWindow::OnConsoleLineParsed(IWorldState& world, IConsoleLine& parsed)
 {
 	m_ParsedLineCount++;
 
-	if (parsed.ShouldPrint() && m_MainState)
-	{
-		while (m_MainState->m_PrintingLines.size() > m_MainState->MAX_PRINTING_LINES)
-			m_MainState->m_PrintingLines.pop_back();
+	// Nobody can read the chat log that fast anyway
+	const bool overloaded = m_MainState && m_MainState->m_Parser.IsOverloaded();
 
-		m_MainState->m_PrintingLines.push_front(parsed.shared_from_this());
+	if (parsed.ShouldPrint() && m_MainState && !overloaded)
+	{
+		parsed.ReleaseTextBuffer();
+		m_MainState->m_PrintingLines.push_back({ parsed.shared_from_this() });
 	}
 
+	IEventLog::Record(EventLogRecordType::ConsoleLine, parsed.GetType());
+
 	switch (parsed.GetType())
 	{
 	case ConsoleLineType::LobbyChanged:
@@ -842,6 +1628,34 @@ void MainWindow::OnConsoleLineParsed(IWorldState& world, IConsoleLine& parsed)
 
 		break;
 	}
+	case ConsoleLineType::KillNotification:
+	{
+		if (m_MainState)
+			m_MainState->m_PlayerPrintOrderDirty = true;
+
+		break;
+	}
+	case ConsoleLineType::Chat:
+	{
+		auto& chatLine = static_cast<const ChatConsoleLine&>(parsed);
+		if (m_MainState)
+			m_MainState->m_ChatHistory.Add(chatLine);
+
+		if (IEventLog::IsEnabled())
+		{
+			IEventLog::Record(EventLogRecordType::ChatMessage,
+				world.FindSteamIDForName(chatLine.GetPlayerName()).value_or(SteamID{}),
+				chatLine.GetPlayerName(), chatLine.GetMessage());
+		}
+
+		if (parsed.ShouldPrint() && !overloaded)
+		{
+			m_GlyphCache.QueueText(chatLine.GetPlayerName());
+			m_GlyphCache.QueueText(chatLine.GetMessage());
+		}
+
+		break;
+	}
 	case ConsoleLineType::EdictUsage:
 	{
 		auto& usageLine = static_cast<const EdictUsageLine&>(parsed);
@@ -862,77 +1676,152 @@ void MainWindow::OnConsoleLineUnparsed(IWorldState& world, const std::string_vie
 	m_ParsedLineCount++;
 }
 
-mh::generator<IPlayer&> MainWindow::PostSetupFlowState::GeneratePlayerPrintData()
+void MainWindow::OnPlayerStatusUpdate(IWorldState& world, const IPlayer& player)
+{
+	if (IEventLog::IsEnabled())
+		IEventLog::Record(EventLogRecordType::PlayerStatus, player.GetSteamID(), player.GetNameUnsafe());
+
+	if (m_MainState)
+		m_MainState->m_PlayerPrintMembersDirty = true;
+}
+
+void MainWindow::OnPlayerDroppedFromServer(IWorldState& world, IPlayer& player, const std::string_view& reason)
+{
+	IEventLog::Record(EventLogRecordType::PlayerDropped, player.GetSteamID(), reason);
+
+	if (m_MainState)
+		m_MainState->m_PlayerPrintMembersDirty = true;
+}
+
+void MainWindow::OnLobbyChanged(IWorldState& world)
+{
+	IEventLog::Record(EventLogRecordType::LobbyChanged);
+
+	if (m_MainState)
+		m_MainState->m_PlayerPrintMembersDirty = true;
+}
+
+void MainWindow::OnFriendsChanged(IWorldState& world, std::span<const SteamID> added, std::span<const SteamID> removed)
 {
-	IPlayer* printData[33]{};
-	auto begin = std::begin(printData);
-	auto end = std::end(printData);
-	assert(begin <= end);
-	auto& world = m_Parent->m_WorldState;
-	assert(static_cast<size_t>(end - begin) >= world->GetApproxLobbyMemberCount());
+	// Just the rows that show someone whose friendship changed are rebuilt on the next frame
+	for (const auto& ids : { added, removed })
+	{
+		for (const SteamID& id : ids)
+		{
+			if (auto found = m_ScoreboardRows.find(id); found != m_ScoreboardRows.end())
+				found->second.m_RefreshTime = {};
+		}
+	}
+}
+
+static bool IsBeforeInPrintOrder(const IPlayer& lhs, const IPlayer& rhs)
+{
+	// Intentionally reversed, we want descending kill order
+	if (auto killsResult = rhs.GetScores().m_Kills <=> lhs.GetScores().m_Kills; !std::is_eq(killsResult))
+		return std::is_lt(killsResult);
 
-	std::fill(begin, end, nullptr);
+	if (auto deathsResult = lhs.GetScores().m_Deaths <=> rhs.GetScores().m_Deaths; !std::is_eq(deathsResult))
+		return std::is_lt(deathsResult);
 
+	// Sort by ascending userid
 	{
-		auto* current = begin;
-		for (IPlayer& member : world->GetLobbyMembers())
+		auto luid = lhs.GetUserID();
+		auto ruid = rhs.GetUserID();
+		if (luid && ruid)
 		{
-			*current = &member;
-			current++;
+			if (auto result = *luid <=> *ruid; !std::is_eq(result))
+				return std::is_lt(result);
 		}
+	}
+
+	return false;
+}
+
+void MainWindow::PostSetupFlowState::UpdatePlayerPrintMembers()
+{
+	constexpr size_t MAX_PRINTED_PLAYERS = 33;
+
+	auto& world = *m_Parent->m_WorldState;
+	m_PlayerPrintMembersDirty = false;
+	m_PlayerPrintStatusUpdateTime = world.GetLastStatusUpdateTime();
+
+	std::vector<SteamID> members;
+	members.reserve(MAX_PRINTED_PLAYERS);
+	for (const IPlayer& member : world.GetLobbyMemberRange())
+		members.push_back(member.GetSteamID());
+
+	assert(members.size() <= MAX_PRINTED_PLAYERS);
 
-		if (current == begin)
+	if (members.empty())
+	{
+		// We seem to have either an empty lobby or we're playing on a community server.
+		// Just find the most recent status updates.
+		const ActivePlayerTable& players = world.GetActivePlayers();
+		const auto minStatusUpdateTime = world.GetLastStatusUpdateTime() - 15s;
+		for (size_t i = 0; i < players.size(); i++)
 		{
-			// We seem to have either an empty lobby or we're playing on a community server.
-			// Just find the most recent status updates.
-			for (IPlayer& playerData : world->GetPlayers())
+			if (players.m_LastStatusUpdateTimes[i] >= minStatusUpdateTime)
 			{
-				if (playerData.GetLastStatusUpdateTime() >= (world->GetLastStatusUpdateTime() - 15s))
-				{
-					*current = &playerData;
-					current++;
+				members.push_back(players.m_SteamIDs[i]);
 
-					if (current >= end)
-						break; // This might happen, but we're not in a lobby so everything has to be approximate
-				}
+				if (members.size() >= MAX_PRINTED_PLAYERS)
+					break; // This might happen, but we're not in a lobby so everything has to be approximate
 			}
 		}
+	}
 
-		end = current;
+	// Whoever is still around keeps their place from last time, so the resort has very little to do
+	const auto isMember = [&](const SteamID& id) { return std::find(members.begin(), members.end(), id) != members.end(); };
+	std::erase_if(m_PlayerPrintOrder, [&](const SteamID& id) { return !isMember(id); });
+
+	for (const SteamID& id : members)
+	{
+		if (std::find(m_PlayerPrintOrder.begin(), m_PlayerPrintOrder.end(), id) == m_PlayerPrintOrder.end())
+			m_PlayerPrintOrder.push_back(id);
 	}
 
-	std::sort(begin, end, [](const IPlayer* lhs, const IPlayer* rhs) -> bool
+	m_PlayerPrintOrderDirty = true;
+}
+
+mh::generator<IPlayer&> MainWindow::PostSetupFlowState::GeneratePlayerPrintData()
+{
+	auto& world = *m_Parent->m_WorldState;
+	if (m_PlayerPrintMembersDirty || m_PlayerPrintStatusUpdateTime != world.GetLastStatusUpdateTime())
+		UpdatePlayerPrintMembers();
+
+	// Players are looked up by id every time, since the world is free to archive/clear them
+	m_PlayerPrintData.clear();
+	for (const SteamID& id : m_PlayerPrintOrder)
+	{
+		if (IPlayer* player = world.FindPlayer(id))
+			m_PlayerPrintData.push_back(player);
+		else
+			m_PlayerPrintOrderDirty = true;
+	}
+
+	if (m_PlayerPrintOrderDirty)
+	{
+		// Insertion sort, scores only change a kill or death at a time so we're almost always already sorted
+		for (size_t i = 1; i < m_PlayerPrintData.size(); i++)
 		{
-			assert(lhs);
-			assert(rhs);
-			//if (!lhs && !rhs)
-			//	return false;
-			//if (auto result = !!rhs <=> !!lhs; !std::is_eq(result))
-			//	return result < 0;
+			IPlayer* player = m_PlayerPrintData[i];
 
-			// Intentionally reversed, we want descending kill order
-			if (auto killsResult = rhs->GetScores().m_Kills <=> lhs->GetScores().m_Kills; !std::is_eq(killsResult))
-				return std::is_lt(killsResult);
+			size_t j = i;
+			for (; j > 0 && IsBeforeInPrintOrder(*player, *m_PlayerPrintData[j - 1]); j--)
+				m_PlayerPrintData[j] = m_PlayerPrintData[j - 1];
 
-			if (auto deathsResult = lhs->GetScores().m_Deaths <=> rhs->GetScores().m_Deaths; !std::is_eq(deathsResult))
-				return std::is_lt(deathsResult);
+			m_PlayerPrintData[j] = player;
+		}
 
-			// Sort by ascending userid
-			{
-				auto luid = lhs->GetUserID();
-				auto ruid = rhs->GetUserID();
-				if (luid && ruid)
-				{
-					if (auto result = *luid <=> *ruid; !std::is_eq(result))
-						return std::is_lt(result);
-				}
-			}
+		m_PlayerPrintOrder.clear();
+		for (const IPlayer* player : m_PlayerPrintData)
+			m_PlayerPrintOrder.push_back(player->GetSteamID());
 
-			return false;
-		});
+		m_PlayerPrintOrderDirty = false;
+	}
 
-	for (auto it = begin; it != end; ++it)
-		co_yield **it;
+	for (IPlayer* player : m_PlayerPrintData)
+		co_yield *player;
 }
 
 void MainWindow::UpdateServerPing(time_point_t timestamp)
@@ -943,7 +1832,7 @@ void MainWindow::UpdateServerPing(time_point_t timestamp)
 	float totalPing = 0;
 	uint16_t samples = 0;
 
-	for (IPlayer& player : GetWorld().GetPlayers())
+	for (IPlayer& player : GetWorld().GetPlayerRange())
 	{
 		if (player.GetLastStatusUpdateTime() < (timestamp - 20s))
 			continue;
@@ -987,16 +1876,51 @@ time_point_t MainWindow::GetCurrentTimestampCompensated() const
 	return GetWorld().GetCurrentTime();
 }
 
-mh::expected<std::shared_ptr<ITexture>, std::error_condition> MainWindow::TryGetAvatarTexture(IPlayer& player)
+mh::expected<std::shared_ptr<ITexture>, std::error_condition> MainWindow::TryGetAvatarTexture(IPlayer& player,
+	AvatarPriority priority)
 {
-	using StateTask_t = mh::task<mh::expected<std::shared_ptr<ITexture>, std::error_condition>>;
+	const int curFrame = ImGui::GetFrameCount();
+
+	auto& avatarTexture = m_AvatarTextures[player.GetSteamID()];
 
-	struct PlayerAvatarData
+	// Only this frame's requests count, a tooltip that was closed doesn't keep it at the front
+	if (avatarTexture.m_LastUsedFrame == curFrame)
+		avatarTexture.m_Priority = std::max(avatarTexture.m_Priority, priority);
+	else
+		avatarTexture.m_Priority = priority;
+
+	avatarTexture.m_LastUsedFrame = curFrame;
+
+	auto& avatarData = avatarTexture.m_State;
+	if (avatarData.empty())
 	{
-		StateTask_t m_State;
+		if (!avatarTexture.m_QueuedPlayer)
+		{
+			const auto& summary = player.GetPlayerSummary();
+			if (!summary)
+				return summary.error();
+
+			avatarTexture.m_QueuedPlayer = player.shared_from_this();
+			m_QueuedAvatars.push_back(player.GetSteamID());
+		}
+
+		return std::errc::operation_in_progress;
+	}
 
+	if (auto data = avatarData.try_get())
+		return *data;
+	else
+		return std::errc::operation_in_progress;
+}
+
+void MainWindow::UpdateAvatarQueue()
+{
+	using StateTask_t = decltype(AvatarTexture::m_State);
+
+	struct AvatarLoader
+	{
 		static StateTask_t LoadAvatarAsync(mh::task<Bitmap> avatarBitmapTask,
-			mh::dispatcher updateDispatcher, std::shared_ptr<ITextureManager> textureManager)
+			std::shared_ptr<ITextureManager> textureManager)
 		{
 			const Bitmap* avatarBitmap = nullptr;
 
@@ -1010,12 +1934,20 @@ mh::expected<std::shared_ptr<ITexture>, std::error_condition> MainWindow::TryGet
 				co_return ErrorCode::UnknownError;
 			}
 
-			// Switch to main thread
-			co_await updateDispatcher.co_dispatch();
-
 			try
 			{
-				co_return textureManager->CreateTexture(*avatarBitmap);
+				// Anything bigger is only sampled back down by the GPU every time it's drawn
+				std::optional<Bitmap> resized;
+				if (avatarBitmap->GetWidth() > AVATAR_DISPLAY_SIZE || avatarBitmap->GetHeight() > AVATAR_DISPLAY_SIZE)
+				{
+					const float scale = float(AVATAR_DISPLAY_SIZE) / std::max(avatarBitmap->GetWidth(), avatarBitmap->GetHeight());
+					avatarBitmap = &resized.emplace(avatarBitmap->Resize(
+						std::max(uint32_t(avatarBitmap->GetWidth() * scale + 0.5f), 1u),
+						std::max(uint32_t(avatarBitmap->GetHeight() * scale + 0.5f), 1u)));
+				}
+
+				// Finishes on the main thread, once the texture manager gets around to uploading it
+				co_return co_await textureManager->CreateTextureAsync(*avatarBitmap);
 			}
 			catch (...)
 			{
@@ -1025,37 +1957,156 @@ mh::expected<std::shared_ptr<ITexture>, std::error_condition> MainWindow::TryGet
 		}
 	};
 
-	auto& avatarData = player.GetOrCreateData<PlayerAvatarData>().m_State;
+	std::erase_if(m_LoadingAvatars, [&](const SteamID& id)
+		{
+			auto found = m_AvatarTextures.find(id);
+			return found == m_AvatarTextures.end() || found->second.m_State.is_ready();
+		});
 
-	if (avatarData.empty())
+	if (m_QueuedAvatars.empty())
+		return;
+
+	TF2BD_PROFILE_SCOPE("MainWindow::UpdateAvatarQueue");
+
+	// Whatever was asked for this frame keeps what it was asked for as. Anyone else is only still
+	// wanted if they're in the lobby or on the scoreboard.
+	const int curFrame = ImGui::GetFrameCount();
+	std::erase_if(m_QueuedAvatars, [&](const SteamID& id)
+		{
+			AvatarTexture& avatar = m_AvatarTextures.at(id);
+			if (avatar.m_LastUsedFrame >= curFrame)
+				return false;
+
+			if (avatar.m_QueuedPlayer->GetLobbyMember())
+				avatar.m_Priority = AvatarPriority::Lobby;
+			else if (m_ScoreboardRows.contains(id))
+				avatar.m_Priority = AvatarPriority::Other;
+			else
+			{
+				// They left before it went out, it's requested again if they come back
+				m_AvatarTextures.erase(id);
+				return true;
+			}
+
+			return false;
+		});
+
+	// Queued in the order they were asked for, which is kept within each priority
+	std::stable_sort(m_QueuedAvatars.begin(), m_QueuedAvatars.end(), [&](const SteamID& lhs, const SteamID& rhs)
+		{
+			return m_AvatarTextures.at(lhs).m_Priority > m_AvatarTextures.at(rhs).m_Priority;
+		});
+
+	size_t started = 0;
+	for (; started < m_QueuedAvatars.size() && m_LoadingAvatars.size() < MAX_AVATAR_LOADS; started++)
 	{
-		auto playerPtr = player.shared_from_this();
-		const auto& summary = playerPtr->GetPlayerSummary();
-		if (summary)
+		const SteamID& id = m_QueuedAvatars[started];
+		AvatarTexture& avatar = m_AvatarTextures.at(id);
+		const auto player = std::exchange(avatar.m_QueuedPlayer, nullptr);
+
+		const auto& summary = player->GetPlayerSummary();
+		if (!summary)
 		{
-			avatarData = PlayerAvatarData::LoadAvatarAsync(
-				summary->GetAvatarBitmap(m_Settings.GetHTTPClient()),
-				GetDispatcher(), m_TextureManager);
+			// It was there when this was queued. Asking again reports whatever happened to it.
+			m_AvatarTextures.erase(id);
+			continue;
 		}
-		else
+
+		avatar.m_State = AvatarLoader::LoadAvatarAsync(
+			summary->GetAvatarBitmap(m_Settings.GetHTTPClient()),
+			m_TextureManager);
+		m_LoadingAvatars.push_back(id);
+	}
+
+	m_QueuedAvatars.erase(m_QueuedAvatars.begin(), m_QueuedAvatars.begin() + started);
+}
+
+size_t MainWindow::EvictAvatarTextures(size_t budgetBytes)
+{
+	TF2BD_PROFILE_SCOPE("MainWindow::EvictAvatarTextures");
+
+	using iterator = decltype(m_AvatarTextures)::iterator;
+	std::vector<iterator> loaded;
+	size_t totalBytes = 0;
+
+	for (auto it = m_AvatarTextures.begin(); it != m_AvatarTextures.end(); ++it)
+	{
+		// Only finished loads take up any texture memory, failed ones are kept so we don't retry every frame
+		if (auto data = it->second.m_State.try_get(); data && data->has_value())
 		{
-			return summary.error();
+			const ITexture& texture = *data->value();
+			totalBytes += size_t(texture.GetWidth()) * texture.GetHeight() * 4;
+			loaded.push_back(it);
 		}
 	}
 
-	if (auto data = avatarData.try_get())
-		return *data;
-	else
-		return std::errc::operation_in_progress;
+	if (totalBytes <= budgetBytes)
+		return 0;
+
+	std::sort(loaded.begin(), loaded.end(), [](const iterator& lhs, const iterator& rhs)
+		{
+			return lhs->second.m_LastUsedFrame < rhs->second.m_LastUsedFrame;
+		});
+
+	const auto curFrame = ImGui::GetFrameCount();
+	size_t evicted = 0;
+	for (const iterator& it : loaded)
+	{
+		// Never throw away something that's on screen right now, even if we're still over
+		if (totalBytes <= budgetBytes || it->second.m_LastUsedFrame >= curFrame)
+			break;
+
+		const ITexture& texture = *it->second.m_State.try_get()->value();
+		totalBytes -= size_t(texture.GetWidth()) * texture.GetHeight() * 4;
+		m_AvatarTextures.erase(it);
+		evicted++;
+	}
+
+	return evicted;
+}
+
+void MainWindow::ReclaimIdleMemory()
+{
+	TF2BD_PROFILE_SCOPE("MainWindow::ReclaimIdleMemory");
+
+	const size_t ramBefore = Processes::GetCurrentRAMUsage();
+	const size_t players = GetWorld().ReleaseIdleMemory();
+	const size_t avatars = EvictAvatarTextures(0);
+	m_AvatarTextures.rehash(0);
+	Processes::TrimMemory();
+	const size_t ramAfter = Processes::GetCurrentRAMUsage();
+
+	Log("Out of a match, released {} player(s) and {} avatar texture(s). RAM usage {:1.1f} MB -> {:1.1f} MB",
+		players, avatars, ramBefore / 1024.0f / 1024, ramAfter / 1024.0f / 1024);
 }
 
 MainWindow::PostSetupFlowState::PostSetupFlowState(MainWindow& window) :
 	m_Parent(&window),
 	m_ModeratorLogic(IModeratorLogic::Create(window.GetWorld(), window.m_Settings, window.GetActionManager())),
+	m_SessionSnapshot(window.GetWorld(), *m_ModeratorLogic, window.m_Settings),
+	m_SharedWorldStateExporter(window.GetWorld(), *m_ModeratorLogic, window.m_Settings),
+	m_NetworkStatusHistory(window.GetWorld()),
 	m_SponsorsList(window.m_Settings),
 	m_Parser(window.GetWorld(), window.m_Settings, window.m_Settings.GetTFDir() / "console.log")
 {
+	m_DeferredInit.Add("SponsorsList", DeferredInitQueue::Thread::Main, [this] { m_SponsorsList.LoadFile(); });
+	m_DeferredInit.Add("Prewarm HTTP connections", DeferredInitQueue::Thread::Main, [&settings = window.m_Settings]
+		{
+			const auto client = settings.GetHTTPClient();
+			if (!client)
+				return;
+
+			// Everything a server join ends up asking for
+			std::vector<URL> hosts{ "https://logs.tf", "https://steamcdn-a.akamaihd.net", "https://raw.githubusercontent.com" };
+			if (settings.GetSteamAPIMode() == SteamAPIMode::Direct)
+				hosts.push_back("https://api.steampowered.com");
+			else if (settings.GetSteamAPIMode() == SteamAPIMode::Proxy)
+				hosts.push_back("https://tf2bd-util.pazer.us");
+
+			client->PrewarmHosts(std::move(hosts));
+		});
 #ifdef TF2BD_ENABLE_DISCORD_INTEGRATION
-	m_DRPManager = IDRPManager::Create(window.m_Settings, window.GetWorld());
+	// OnUpdateDiscord() creates the IDRPManager
+	m_DeferredInit.Add("Discord rich presence", DeferredInitQueue::Thread::Main, [this] { m_IsDiscordStarted = true; });
 #endif
 }
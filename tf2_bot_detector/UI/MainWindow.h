@@ -4,25 +4,38 @@
 #include "Actions/RCONActionManager.h"
 #include "Clock.h"
 #include "CompensatedTS.h"
+#include "ConsoleLog/ChatHistory.h"
 #include "ConsoleLog/ConsoleLineListener.h"
 #include "ConsoleLog/ConsoleLogParser.h"
+#include "ConsoleLog/NetworkStatusHistory.h"
 #include "Config/PlayerListJSON.h"
 #include "Config/Settings.h"
 #include "Config/SponsorsList.h"
 #include "DiscordRichPresence.h"
 #include "Networking/GithubAPI.h"
+#include "MetricsExporter.h"
 #include "ModeratorLogic.h"
+#include "SessionSnapshot.h"
 #include "SetupFlow/SetupFlow.h"
+#include "SharedWorldStateExporter.h"
+#include "Util/DeferredInit.h"
+#include "Util/RingBuffer.h"
+#include "Util/StartupTimeline.h"
 #include "WorldEventListener.h"
 #include "WorldState.h"
 #include "LobbyMember.h"
 #include "PlayerStatus.h"
 #include "TFConstants.h"
+#include "FontGlyphCache.h"
 
 #include <imgui_desktop/Window.h>
+#include <mh/coroutine/task.hpp>
 #include <mh/error/expected.hpp>
 
+#include <array>
+#include <deque>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 struct ImFont;
@@ -37,13 +50,16 @@ namespace tf2_bot_detector
 	class ITextureManager;
 	class IUpdateManager;
 	class SettingsWindow;
+	class UIBenchmark;
+	struct UIBenchmarkOptions;
 
 	class MainWindow final : public ImGuiDesktop::Window, IConsoleLineListener, BaseWorldEventListener
 	{
 		using Super = ImGuiDesktop::Window;
 
 	public:
-		explicit MainWindow(ImGuiDesktop::Application& app);
+		// With benchmark, the window is never shown and draws a synthetic server, see UIBenchmark
+		explicit MainWindow(ImGuiDesktop::Application& app, const UIBenchmarkOptions* benchmark = nullptr);
 		~MainWindow();
 
 		ImFont* GetFontPointer(Font f) const;
@@ -62,10 +78,47 @@ namespace tf2_bot_detector
 		void OnDrawTeamStats();
 		void OnDrawAllPanesDisabled();
 		void OnDrawScoreboardContextMenu(IPlayer& player);
-		void OnDrawScoreboardRow(IPlayer& player);
+
+		// Everything a scoreboard row shows, looked up and formatted again only when the player's
+		// status changes (or every SCOREBOARD_ROW_REFRESH_INTERVAL, for marks and api data)
+		struct ScoreboardRow
+		{
+			uint64_t m_LastDrawnFrame = 0;
+			time_point_t m_StatusUpdateTime{};
+			time_point_t m_RefreshTime{};
+
+			std::string m_UserID;
+			std::string m_Name;
+			std::string m_SteamNickname;  // Only if it doesn't match their in-game name
+			bool m_HasName = false;       // Otherwise scores, time and ping are unknown
+			std::string m_Kills;
+			std::string m_Deaths;
+			std::string m_ConnectedTime;
+			std::string m_Ping;
+			std::string m_SteamID;
+			bool m_IsSteamIDValid = false;
+
+			std::optional<std::array<float, 4>> m_TextColor;
+			std::array<float, 4> m_BGColor{};
+			const std::array<float, 4>* m_MarkBGColor = nullptr; // Pulsed over m_BGColor
+			bool m_IsVACBanned = false;
+			bool m_IsGameBanned = false;
+			bool m_IsFriend = false;
+
+			TeamShareResult m_TeamShareResult{};
+			PlayerMarks m_Attributes;
+		};
+		static constexpr duration_t SCOREBOARD_ROW_REFRESH_INTERVAL = std::chrono::milliseconds(250);
+		std::unordered_map<SteamID, ScoreboardRow> m_ScoreboardRows;
+		uint64_t m_ScoreboardFrame = 0;
+		void UpdateScoreboardRow(const IPlayer& player, ScoreboardRow& row) const;
+		void OnDrawScoreboardRow(IPlayer& player, ScoreboardRow& row);
 		void OnDrawColorPicker(const char* name_id, std::array<float, 4>& color);
 		void OnDrawChat();
+		void OnDrawChatSearchResults();
+		static constexpr size_t MAX_CHAT_SEARCH_RESULTS = 5000;
 		void OnDrawServerStats();
+		void OnDrawNetGraph();
 		void DrawPlayerTooltipBody(IPlayer& player, TeamShareResult teamShareResult, const PlayerMarks& playerAttribs);
 
 		struct ColorPicker
@@ -76,7 +129,16 @@ namespace tf2_bot_detector
 		void OnDrawColorPickers(const char* id, const std::initializer_list<ColorPicker>& pickers);
 
 		void OnDrawAppLog();
-		const void* m_LastLogMessage = nullptr;
+		void UpdateAppLogLines();
+		struct AppLogLine
+		{
+			std::shared_ptr<const LogMessage> m_Message;
+			std::string m_Timestamp;  // "[hh:mm:ss]", only formatted once
+			float m_Height = 0;       // Height when last drawn at m_AppLogWrapWidth, 0 if not yet known
+		};
+		std::deque<AppLogLine> m_AppLogLines;  // Oldest to newest, the same as ILogManager::GetVisibleMsgs()
+		uint64_t m_AppLogNextSequence = 0;
+		float m_AppLogWrapWidth = 0;
 
 		void OpenSettingsPopup();
 
@@ -85,6 +147,9 @@ namespace tf2_bot_detector
 		void OpenUpdateCheckPopup();
 
 		void OnDrawAboutPopup();
+		void OnDrawProfilerWindow();
+		void OnDrawMemoryWindow();
+		void OnDrawDecisionTraceWindow();
 		bool m_AboutPopupOpen = false;
 		void OpenAboutPopup() { m_AboutPopupOpen = true; }
 
@@ -95,6 +160,17 @@ namespace tf2_bot_detector
 
 		bool IsSleepingEnabled() const override;
 
+		// Render on demand: stay awake a little while after anything changes, so hover
+		// highlights and the like have a chance to settle
+		static constexpr duration_t REDRAW_LINGER_TIME = std::chrono::milliseconds(500);
+		static constexpr duration_t REDRAW_TICK_INTERVAL = std::chrono::seconds(1); // Connected times, cooldowns, etc
+		void RequestRedraw(duration_t linger = REDRAW_LINGER_TIME);
+		void UpdateRedrawTriggers();
+		time_point_t m_RedrawUntil{};
+		time_point_t m_LastRedrawTick{};
+		std::array<uint32_t, 4> m_LastHTTPRequestCounts{};
+		uint64_t m_LastTempDBActivity = 0;
+
 		bool IsTimeEven() const;
 		float TimeSine(float interval = 1.0f, float min = 0, float max = 1) const;
 
@@ -103,6 +179,18 @@ namespace tf2_bot_detector
 		ImFont* m_ProggyTiny20Font{};
 		ImFont* m_ProggyClean26Font{};
 
+		// How long each frame spends resuming coroutines waiting on the main lane. The rest are
+		// picked up next frame, so a burst of finished lookups doesn't end up in one long frame.
+		static constexpr std::chrono::steady_clock::duration MAIN_THREAD_TASK_BUDGET = std::chrono::milliseconds(2);
+
+		// Player names and chat queue their glyphs into m_GlyphCache while drawing, and the atlas
+		// is rebuilt with them between frames (no more often than GLYPH_REBUILD_INTERVAL).
+		static constexpr duration_t GLYPH_REBUILD_INTERVAL = std::chrono::seconds(1);
+		void RebuildFontAtlas();
+		FontGlyphCache m_GlyphCache;
+		time_point_t m_LastFontAtlasRebuild{};
+		std::shared_ptr<ITexture> m_FontTexture;
+
 		// IConsoleLineListener
 		void OnConsoleLineParsed(IWorldState& world, IConsoleLine& line) override;
 		void OnConsoleLineUnparsed(IWorldState& world, const std::string_view& text) override;
@@ -112,14 +200,59 @@ namespace tf2_bot_detector
 		// IWorldEventListener
 		//void OnChatMsg(WorldState& world, const IPlayer& player, const std::string_view& msg) override;
 		//void OnUpdate(WorldState& world, bool consoleLinesUpdated) override;
+		void OnPlayerStatusUpdate(IWorldState& world, const IPlayer& player) override;
+		void OnPlayerDroppedFromServer(IWorldState& world, IPlayer& player, const std::string_view& reason) override;
+		void OnLobbyChanged(IWorldState& world) override;
+		void OnFriendsChanged(IWorldState& world, std::span<const SteamID> added, std::span<const SteamID> removed) override;
 
 		bool m_Paused = false;
+		bool m_UIPriorityLowered = false;  // Settings::m_LowerUIPriorityWhileTF2Focused, and TF2 has focus
+
+		// Once we've been out of a match for a bit, everything that was only kept for it is let go
+		// and the heap and working set are trimmed. Once per match, not on startup.
+		bool m_WasIdle = true;
+		void ReclaimIdleMemory();
+
+		std::unique_ptr<UIBenchmark> m_Benchmark;
 
 		// Gets the current timestamp, but time progresses in real time even without new messages
 		time_point_t GetCurrentTimestampCompensated() const;
 
-		mh::expected<std::shared_ptr<ITexture>, std::error_condition> TryGetAvatarTexture(IPlayer& player);
+		// Who gets their avatar loaded first, when more are asked for than MAX_AVATAR_LOADS
+		enum class AvatarPriority
+		{
+			Other,      // On the server, but scrolled out of view
+			Lobby,      // In our lobby, but not on screen
+			Scoreboard, // A row that's being drawn
+			Tooltip,    // Someone is hovering over them
+		};
+
+		mh::expected<std::shared_ptr<ITexture>, std::error_condition> TryGetAvatarTexture(IPlayer& player,
+			AvatarPriority priority);
+		static constexpr uint32_t AVATAR_DISPLAY_SIZE = 184; // In the player tooltip, textures are never bigger
 		std::shared_ptr<ITextureManager> m_TextureManager;
+
+		// Avatars are the one kind of texture that keeps piling up, so they're kept under
+		// m_AvatarTextureBudgetMB. Evicted ones are quietly reloaded from the on-disk avatar cache.
+		struct AvatarTexture
+		{
+			mh::task<mh::expected<std::shared_ptr<ITexture>, std::error_condition>> m_State;
+			int m_LastUsedFrame = 0;
+
+			// Set while the load is waiting in m_QueuedAvatars
+			std::shared_ptr<IPlayer> m_QueuedPlayer;
+			AvatarPriority m_Priority{};
+		};
+		std::unordered_map<SteamID, AvatarTexture> m_AvatarTextures;
+		size_t EvictAvatarTextures(size_t budgetBytes); // Returns how many were evicted
+
+		// Avatar loads have their own limit, so a full server of them doesn't hold up API requests.
+		// Queued ones are ranked again every frame, and dropped if the player left before their
+		// turn came up.
+		static constexpr size_t MAX_AVATAR_LOADS = 4;
+		std::vector<SteamID> m_QueuedAvatars;
+		std::vector<SteamID> m_LoadingAvatars;
+		void UpdateAvatarQueue();
 		std::unique_ptr<IBaseTextures> m_BaseTextures;
 
 		struct PingSample
@@ -153,6 +286,7 @@ namespace tf2_bot_detector
 		std::vector<EdictUsageSample> m_EdictUsageSamples;
 
 		time_point_t m_OpenTime;
+		uint32_t m_SetupFlowStartupPhase = StartupTimeline::INVALID_PHASE;
 
 		void UpdateServerPing(time_point_t timestamp);
 		std::vector<PingSample> m_ServerPingSamples;
@@ -162,11 +296,16 @@ namespace tf2_bot_detector
 		std::unique_ptr<SettingsWindow> m_SettingsWindow;
 
 		std::unique_ptr<IUpdateManager> m_UpdateManager;
+		bool m_IsUpdateManagerStarted = false;
+
+		// Anything not needed to draw the first frame
+		DeferredInitQueue m_DeferredInit;
 
 		SetupFlow m_SetupFlow;
 
 		std::shared_ptr<IWorldState> m_WorldState;
 		std::unique_ptr<IRCONActionManager> m_ActionManager;
+		MetricsExporter m_MetricsExporter{ m_Settings };
 
 		IWorldState& GetWorld() { return *m_WorldState; }
 		const IWorldState& GetWorld() const { return *m_WorldState; }
@@ -179,17 +318,45 @@ namespace tf2_bot_detector
 
 			MainWindow* m_Parent = nullptr;
 			std::unique_ptr<IModeratorLogic> m_ModeratorLogic;
+			SessionSnapshotManager m_SessionSnapshot;
+			SharedWorldStateExporter m_SharedWorldStateExporter;
+			NetworkStatusHistory m_NetworkStatusHistory;
 			SponsorsList m_SponsorsList;
 
 			ConsoleLogParser m_Parser;
-			std::list<std::shared_ptr<const IConsoleLine>> m_PrintingLines;  // newest to oldest order
+			struct PrintingLine
+			{
+				std::shared_ptr<const IConsoleLine> m_Line;
+				float m_Height = 0; // Height of the last Print() at m_PrintingLinesWrapWidth, 0 if not yet known
+			};
 			static constexpr size_t MAX_PRINTING_LINES = 512;
+			RingBuffer<PrintingLine, MAX_PRINTING_LINES> m_PrintingLines;  // oldest to newest order
+			float m_PrintingLinesWrapWidth = 0;
+
+			ChatHistory m_ChatHistory;
+			std::string m_ChatSearchQuery;
+			std::vector<uint32_t> m_ChatSearchResults;   // Indices into m_ChatHistory, newest first
+			size_t m_ChatSearchHistorySize = SIZE_MAX;   // m_ChatHistory.size() when m_ChatSearchResults were found
+			float m_ChatSearchTimeMS = 0;
+			void UpdateChatSearch();
 			mh::generator<IPlayer&> GeneratePlayerPrintData();
 
+			// Kept in scoreboard order between frames, and only rebuilt/resorted when marked dirty
+			std::vector<SteamID> m_PlayerPrintOrder;
+			std::vector<IPlayer*> m_PlayerPrintData;
+			time_point_t m_PlayerPrintStatusUpdateTime{};
+			bool m_PlayerPrintMembersDirty = true; // Someone joined/left the lobby/server
+			bool m_PlayerPrintOrderDirty = true;   // Someone's scores changed
+			void UpdatePlayerPrintMembers();
+
 			void OnUpdateDiscord();
 #ifdef TF2BD_ENABLE_DISCORD_INTEGRATION
 			std::unique_ptr<IDRPManager> m_DRPManager;
+			bool m_IsDiscordStarted = false;
 #endif
+
+			// Sponsors and Discord only start once the scoreboard is on screen
+			DeferredInitQueue m_DeferredInit;
 		};
 		std::optional<PostSetupFlowState> m_MainState;
 
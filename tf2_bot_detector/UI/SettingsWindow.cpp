@@ -1,15 +1,40 @@
 #include "SettingsWindow.h"
 #include "ImGui_TF2BotDetector.h"
 #include "Config/Settings.h"
+#include "DB/TempDB.h"
+#include "Application.h"
+#include "Filesystem.h"
 #include "SetupFlow/AddonManagerPage.h"
 #include "UI/MainWindow.h"
 #include "Util/PathUtils.h"
 
 #include <mh/algorithm/algorithm.hpp>
 #include <mh/error/ensure.hpp>
+#include <misc/cpp/imgui_stdlib.h>
 
 using namespace tf2_bot_detector;
 
+// For settings that are expensive to apply, like ones the temp db reopens something for. The text
+// is only written back to value when the field loses focus (or enter is pressed), not on every
+// keystroke. Returns true when it was.
+static bool InputTextWithHintOnDeactivate(const char* label, const char* hint,
+	std::optional<std::string>& editBuffer, std::string& value)
+{
+	if (!editBuffer)
+		editBuffer = value;
+
+	ImGui::InputTextWithHint(label, hint, &*editBuffer);
+
+	const bool apply = ImGui::IsItemDeactivated() && *editBuffer != value;
+	if (apply)
+		value = *editBuffer;
+
+	if (!ImGui::IsItemActive())
+		editBuffer.reset();
+
+	return apply;
+}
+
 SettingsWindow::SettingsWindow(ImGuiDesktop::Application& app, Settings& settings, MainWindow& mainWindow) :
 	ImGuiDesktop::Window(app, 800, 600, "Settings"),
 	m_Settings(settings),
@@ -32,7 +57,7 @@ void SettingsWindow::OnDraw()
 	ImGui::NewLine();
 
 	if (AutoLaunchTF2Checkbox(m_Settings.m_AutoLaunchTF2))
-		m_Settings.SaveFile();
+		m_Settings.SaveFileDeferred();
 }
 
 void SettingsWindow::OnDrawASOSettings()
@@ -41,15 +66,15 @@ void SettingsWindow::OnDrawASOSettings()
 	{
 		// Steam dir
 		if (InputTextSteamDirOverride("Steam directory", m_Settings.m_SteamDirOverride, true))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 
 		// TF game dir override
 		if (InputTextTFDirOverride("tf directory", m_Settings.m_TFDirOverride, FindTFDir(m_Settings.GetSteamDir()), true))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 
 		// Local steamid
 		if (InputTextSteamIDOverride("My Steam ID", m_Settings.m_LocalSteamIDOverride, true))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 
 		ImGui::TreePop();
 	}
@@ -60,7 +85,7 @@ void SettingsWindow::OnDrawCompatibilitySettings()
 	if (ImGui::TreeNode("Compatibility"))
 	{
 		if (ImGui::Checkbox("Config Compatibility Mode", &m_Settings.m_ConfigCompatibilityMode))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 		ImGui::SetHoverTooltip("Improves compatibility with some configs (such as mastercomfig). Resolves some strange issues with \"Issued too many commands to server\" disconnections, at the expense of delayed scoreboard updates when joining a server.");
 
 		ImGui::NewLine();
@@ -74,10 +99,27 @@ void SettingsWindow::OnDrawLoggingSettings()
 	{
 #ifdef TF2BD_ENABLE_DISCORD_INTEGRATION
 		if (ImGui::Checkbox("Discord Rich Presence", &m_Settings.m_Logging.m_DiscordRichPresence))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 #endif
 		if (ImGui::Checkbox("RCON Packets", &m_Settings.m_Logging.m_RCONPackets))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
+		if (ImGui::Checkbox("Compress Console Logs", &m_Settings.m_Logging.m_CompressConsoleLogs))
+			m_Settings.SaveFileDeferred();
+		ImGui::SetHoverTooltip("Saves the copies of TF2's console output in logs/console as .log.gz files, which take up a fraction of the space.");
+		if (ImGui::Checkbox("Debug Messages", &m_Settings.m_Logging.m_DebugMessages))
+			m_Settings.SaveFileDeferred();
+		ImGui::SetHoverTooltip("Writes extra diagnostic messages to the log file. Useful when reporting a bug, but turning it off saves a little CPU time.");
+		if (ImGui::Checkbox("Event Log", &m_Settings.m_Logging.m_EventLog))
+			m_Settings.SaveFileDeferred();
+		ImGui::SetHoverTooltip("Records chat, player connections, moderation decisions, web requests and rcon commands to a compact file in logs/events. Export it with --export-event-log.");
+
+		if (std::string metricsPath = m_Settings.m_MetricsFilePath.string();
+			ImGui::InputTextWithHint("Metrics file", "Not written", &metricsPath))
+		{
+			m_Settings.m_MetricsFilePath = metricsPath;
+			m_Settings.SaveFileDeferred();
+		}
+		ImGui::SetHoverTooltip("Writes console lines parsed, web request, cache and rcon stats, frame times and memory usage to this file every 15 seconds, in the Prometheus text format. Point node_exporter's textfile collector at its folder to graph them.");
 
 		ImGui::NewLine();
 		ImGui::TreePop();
@@ -91,14 +133,14 @@ void SettingsWindow::OnDrawModerationSettings()
 		// Auto temp mute
 		{
 			if (ImGui::Checkbox("Auto temp mute", &m_Settings.m_AutoTempMute))
-				m_Settings.SaveFile();
+				m_Settings.SaveFileDeferred();
 			ImGui::SetHoverTooltip("Automatically, temporarily mute ingame chat messages if we think someone else in the server is running the tool.");
 		}
 
 		// Auto votekick delay
 		{
 			if (ImGui::SliderFloat("Auto votekick delay", &m_Settings.m_AutoVotekickDelay, 0, 30, "%1.1f seconds"))
-				m_Settings.SaveFile();
+				m_Settings.SaveFileDeferred();
 			ImGui::SetHoverTooltip("Delay between a player being registered as fully connected and us expecting them to be ready to vote on an issue.\n\n"
 				"This is needed because players can't vote until they have joined a team and picked a class. If we call a vote before enough people are ready, it might fail.");
 		}
@@ -106,7 +148,7 @@ void SettingsWindow::OnDrawModerationSettings()
 		// Send warnings for connecting cheaters
 		{
 			if (ImGui::Checkbox("Chat message warnings for connecting cheaters", &m_Settings.m_AutoChatWarningsConnecting))
-				m_Settings.SaveFile();
+				m_Settings.SaveFileDeferred();
 
 			ImGui::SetHoverTooltip("Automatically sends a chat message if a cheater has joined the lobby,"
 				" but is not yet in the game. Only has an effect if \"Enable Chat Warnings\""
@@ -159,10 +201,123 @@ void SettingsWindow::OnDrawPerformanceSettings()
 		// Sleep when unfocused
 		{
 			if (ImGui::Checkbox("Sleep when unfocused", &m_Settings.m_SleepWhenUnfocused))
-				m_Settings.SaveFile();
+				m_Settings.SaveFileDeferred();
 			ImGui::SetHoverTooltip("Slows program refresh rate when not focused to reduce CPU/GPU usage.");
 		}
 
+		// Render on demand
+		{
+			if (ImGui::Checkbox("Only redraw when something changes", &m_Settings.m_RenderOnDemand))
+				m_Settings.SaveFileDeferred();
+			ImGui::SetHoverTooltip("Sleeps between frames unless there is new console output, a web/database request finished, a timer on screen ticked over, or you're moving the mouse/typing. Cuts idle CPU/GPU usage, even while focused.");
+		}
+
+		// Background console log parsing
+		{
+			if (ImGui::Checkbox("Parse console log in the background", &m_Settings.m_BackgroundConsoleLogParsing))
+				m_Settings.SaveFileDeferred();
+			ImGui::SetHoverTooltip("Reads and parses console.log on a separate thread, so large bursts of console output (status, cvarlist) don't cause the UI to stutter.");
+		}
+
+		// RCON only console input
+		{
+			if (ImGui::Checkbox("Only use rcon while it's responding", &m_Settings.m_RCONOnlyConsoleInput))
+				m_Settings.SaveFileDeferred();
+			ImGui::SetHoverTooltip("Turns off console.log while rcon is answering, so TF2 isn't writing every console line to disk for us to read back. Players and lobby members still come in from status and tf_lobby_debug, but chat messages, kills and votes are only ever in console.log, so they're missed (along with chat and kill based rules). console.log comes back on if rcon stops responding.");
+		}
+
+		// Thread scheduling
+		{
+			if (ImGui::Checkbox("Low priority background threads", &m_Settings.m_LowPriorityBackgroundThreads))
+				m_Settings.SaveFileDeferred();
+			ImGui::SetHoverTooltip("Runs console parsing, rule evaluation and web/database requests below normal priority, and lets Windows move them to efficiency cores or lower their clock speed (EcoQoS). TF2 gets the CPU first whenever both want it.");
+
+			if (ImGui::Checkbox("Lower UI priority while TF2 is focused", &m_Settings.m_LowerUIPriorityWhileTF2Focused))
+				m_Settings.SaveFileDeferred();
+			ImGui::SetHoverTooltip("Runs this window's thread below normal priority while you're playing, so drawing it never takes a core away from TF2.");
+
+			if (ImGui::InputScalar("Background thread cores", ImGuiDataType_U64, &m_Settings.m_BackgroundThreadAffinity,
+				nullptr, nullptr, "%llX", ImGuiInputTextFlags_CharsHexadecimal))
+			{
+				m_Settings.SaveFileDeferred();
+			}
+			ImGui::SetHoverTooltip("Hex bitmask of the logical cores background threads may run on, bit 0 being the first core. Leave out the cores TF2 runs best on. 0 allows all of them.");
+		}
+
+		// Player archive size
+		{
+			if (int archiveSize = int(m_Settings.m_PlayerArchiveSize);
+				ImGui::SliderInt("Player archive size", &archiveSize, 0, 4096))
+			{
+				m_Settings.m_PlayerArchiveSize = uint32_t(std::max(archiveSize, 0));
+				m_Settings.SaveFileDeferred();
+			}
+			ImGui::SetHoverTooltip("How many players that have left the server are kept in memory, in case they come back. Older ones are forgotten, but their cached API data is reloaded from disk if they return.");
+		}
+
+		// Temp db size cap
+		{
+			if (int maxSizeMB = int(m_Settings.m_TempDBMaxSizeMB);
+				ImGui::SliderInt("Max cache size (MB)", &maxSizeMB, 16, 2048))
+			{
+				m_Settings.m_TempDBMaxSizeMB = uint32_t(std::max(maxSizeMB, 16));
+				m_Settings.SaveFileDeferred();
+			}
+			ImGui::SetHoverTooltip("How big the on-disk cache of Steam and logs.tf data is allowed to get. Expired entries are cleaned up regardless, and the oldest ones are dropped once it grows past this. Only happens while you aren't in a match.");
+		}
+
+		// Avatar texture budget
+		{
+			if (int budgetMB = int(m_Settings.m_AvatarTextureBudgetMB);
+				ImGui::SliderInt("Avatar texture memory (MB)", &budgetMB, 1, 256))
+			{
+				m_Settings.m_AvatarTextureBudgetMB = uint32_t(std::max(budgetMB, 1));
+				m_Settings.SaveFileDeferred();
+			}
+			ImGui::SetHoverTooltip("How much video memory player avatars can use. Once it's full, the avatars that haven't been shown for the longest are unloaded, and reloaded from disk if they're needed again.");
+		}
+
+		// Cache snapshots, for starting other installs off with this one's cache
+		{
+			if (std::string snapshotPath = m_Settings.m_TempDBSnapshotPath.string();
+				InputTextWithHintOnDeactivate("Cache snapshot", "Exported from another install", m_SnapshotPathEdit, snapshotPath))
+			{
+				m_Settings.m_TempDBSnapshotPath = snapshotPath;
+				m_Settings.SaveFileDeferred();
+			}
+			ImGui::SetHoverTooltip("A cache snapshot exported by another install. Anything that isn't cached here is looked up in it before asking Steam or logs.tf, and it's never written to.");
+
+			if (InputTextWithHintOnDeactivate("Shared remote cache", "https://cache.example.com/tf2bd",
+				m_RemoteCacheURLEdit, m_Settings.m_TempDBRemoteCacheURL))
+				m_Settings.SaveFileDeferred();
+			ImGui::SetHoverTooltip("A key-value service shared by several installs. Account ages, logs.tf counts and inventory sizes that one install has looked up are read from here by the others, instead of each of them asking Steam or logs.tf.");
+
+			if (m_SnapshotExportTask.valid() && m_SnapshotExportTask.is_ready())
+			{
+				try
+				{
+					m_SnapshotExportTask.get();
+				}
+				catch (...)
+				{
+					LogException("Failed to export cache snapshot");
+				}
+
+				m_SnapshotExportTask = {};
+			}
+
+			if (m_SnapshotExportTask.valid())
+			{
+				ImGui::TextFmt("Exporting cache snapshot...");
+			}
+			else if (ImGui::Button("Export cache snapshot"))
+			{
+				m_SnapshotExportTask = TF2BDApplication::GetApplication().GetTempDB().ExportSnapshotAsync(
+					IFilesystem::Get().ResolvePath("temp/db", PathUsage::WriteLocal) / "tf2bd_cache_snapshot.sqlite");
+			}
+			ImGui::SetHoverTooltip("Writes a compacted copy of the cache to the temp/db folder, to point other installs at.");
+		}
+
 		ImGui::NewLine();
 		ImGui::TreePop();
 	}
@@ -173,11 +328,15 @@ void SettingsWindow::OnDrawServiceIntegrationSettings()
 	if (ImGui::TreeNode("Service Integrations"))
 	{
 		if (ImGui::Checkbox("Discord integrations", &m_Settings.m_Discord.m_EnableRichPresence))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
+
+		if (ImGui::Checkbox("Share player list with overlays", &m_Settings.m_ExportSharedWorldState))
+			m_Settings.SaveFileDeferred();
+		ImGui::SetHoverTooltip("Publishes the players on the server, their teams, scores, pings and marks in shared memory, so stream overlays and other tools can read them without going through our log files.");
 
 #ifdef _DEBUG
 		if (ImGui::Checkbox("Lazy Load API Data", &m_Settings.m_LazyLoadAPIData))
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 		ImGui::SetHoverTooltip("If enabled, waits until data is actually needed by the UI before requesting it, saving system resources. Otherwise, instantly loads all data from integration APIs as soon as a player joins the server.");
 #endif
 
@@ -185,7 +344,7 @@ void SettingsWindow::OnDrawServiceIntegrationSettings()
 			ImGui::Checkbox("Allow internet connectivity", &allowInternet))
 		{
 			m_Settings.m_AllowInternetUsage = allowInternet;
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 		}
 
 		ImGui::EnabledSwitch(m_Settings.m_AllowInternetUsage.value_or(false), [&](bool enabled)
@@ -211,7 +370,7 @@ void SettingsWindow::OnDrawServiceIntegrationSettings()
 						if (ImGui::Selectable(GetSteamAPIModeString(mode), m_Settings.GetSteamAPIMode() == mode))
 						{
 							m_Settings.m_SteamAPIMode = mode;
-							m_Settings.SaveFile();
+							m_Settings.SaveFileDeferred();
 						}
 					};
 
@@ -234,7 +393,28 @@ void SettingsWindow::OnDrawServiceIntegrationSettings()
 						InputTextSteamAPIKey("Steam API Key", key, true))
 					{
 						m_Settings.SetSteamAPIKey(key);
-						m_Settings.SaveFile();
+						m_Settings.SaveFileDeferred();
+					}
+
+					if (ImGui::TreeNode("Additional Steam API Keys"))
+					{
+						ImGui::TextFmt("Requests are spread over every key, and switch to another key if one gets rate limited.");
+
+						// One extra empty entry at the end for adding a key, clearing an entry removes it
+						auto keys = m_Settings.GetAdditionalSteamAPIKeys();
+						keys.emplace_back();
+						for (size_t i = 0; i < keys.size(); i++)
+						{
+							ImGui::PushID(int(i));
+							if (InputTextSteamAPIKey("", keys[i], true))
+							{
+								m_Settings.SetAdditionalSteamAPIKeys(keys);
+								m_Settings.SaveFileDeferred();
+							}
+							ImGui::PopID();
+						}
+
+						ImGui::TreePop();
 					}
 				}
 
@@ -243,7 +423,7 @@ void SettingsWindow::OnDrawServiceIntegrationSettings()
 					Combo("Automatic update checking", mode))
 				{
 					m_Settings.m_ReleaseChannel = mode;
-					m_Settings.SaveFile();
+					m_Settings.SaveFileDeferred();
 				}
 			}, "Requires \"Allow internet connectivity\"");
 
@@ -260,14 +440,14 @@ void SettingsWindow::OnDrawUISettings()
 		if (ImGui::Button("Reset"))
 		{
 			m_Settings.m_Theme.m_GlobalScale = fontGlobalScale = 1;
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 		}
 		ImGui::SameLineNoPad();
 		if (ImGui::SliderFloat("Global UI Scale", &fontGlobalScale, 0.5f, 2.0f,
 			"%1.2f", ImGuiSliderFlags_AlwaysClamp))
 		{
 			m_Settings.m_Theme.m_GlobalScale = fontGlobalScale;
-			m_Settings.SaveFile();
+			m_Settings.SaveFileDeferred();
 		}
 
 		const auto GetFontComboString = [](Font f)
@@ -297,7 +477,7 @@ void SettingsWindow::OnDrawUISettings()
 					//static bool s_HasPushedFont
 					ImGui::GetIO().FontDefault = fontPtr;
 					m_Settings.m_Theme.m_Font = f;
-					m_Settings.SaveFile();
+					m_Settings.SaveFileDeferred();
 				}
 			};
 
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <imgui_desktop/Window.h>
+#include <mh/coroutine/task.hpp>
+
+#include <optional>
+#include <string>
 
 namespace tf2_bot_detector
 {
@@ -28,5 +32,9 @@ namespace tf2_bot_detector
 		MainWindow& m_MainWindow;
 
 		bool m_ModsChanged = false;
+
+		mh::task<> m_SnapshotExportTask;
+		std::optional<std::string> m_SnapshotPathEdit;
+		std::optional<std::string> m_RemoteCacheURLEdit;
 	};
 }
@@ -0,0 +1,153 @@
+#include "UIBenchmark.h"
+#include "Clock.h"
+#include "Config/Settings.h"
+#include "ConsoleLog/ConsoleLogParser.h"
+#include "Util/Profiler.h"
+#include "IPlayer.h"
+#include "Log.h"
+#include "ModeratorLogic.h"
+#include "WorldState.h"
+
+#include <mh/text/format.hpp>
+#include <mh/text/string_insertion.hpp>
+
+#include <algorithm>
+#include <ctime>
+
+using namespace tf2_bot_detector;
+
+namespace
+{
+	// Same accounts every run, so the avatar and api caches see the same players
+	constexpr uint32_t FIRST_ACCOUNT_ID = 100000000;
+
+	std::string GetTimestamp()
+	{
+		const std::tm t = ToTM(tfbd_clock_t::now());
+		return mh::format("\n{:02}/{:02}/{} - {:02}:{:02}:{:02}: ",
+			t.tm_mon + 1, t.tm_mday, t.tm_year + 1900, t.tm_hour, t.tm_min, t.tm_sec);
+	}
+
+	std::string GetPlayerName(uint32_t index)
+	{
+		return mh::format("Player / {}", index);
+	}
+}
+
+UIBenchmark::UIBenchmark(const UIBenchmarkOptions& options) :
+	m_Options(options)
+{
+}
+
+void UIBenchmark::ApplySettings(Settings& settings)
+{
+	// Every frame drawn, on the thread that's timing them
+	settings.m_RenderOnDemand = false;
+	settings.m_SleepWhenUnfocused = false;
+	settings.m_BackgroundConsoleLogParsing = false;
+
+	// Nothing to send them to, and they'd keep the moderation logic busy with things the UI never sees
+	settings.m_AutoChatWarnings = false;
+	settings.m_AutoVotekick = false;
+	settings.m_AutoMark = false;
+
+	auto& mainWindow = settings.m_UIState.m_MainWindow;
+	mainWindow.m_ChatEnabled = true;
+	mainWindow.m_ScoreboardEnabled = true;
+	mainWindow.m_AppLogEnabled = true;
+	mainWindow.m_TeamStatsEnabled = true;
+
+	m_ChatWrappers = settings.m_Unsaved.m_ChatMsgWrappers = ChatWrappers(ChatFmtStrLengths{});
+}
+
+std::string UIBenchmark::GenerateFrameOutput() const
+{
+	const auto timestamp = GetTimestamp();
+	const auto& chat = m_ChatWrappers.value().m_Types[size_t(ChatCategory::All)];
+	const uint32_t players = std::max<uint32_t>(m_Options.m_Players, 2);
+
+	std::string output;
+
+	if ((m_Frame % STATUS_INTERVAL_FRAMES) == 0)
+	{
+		const uint32_t seconds = m_Frame / STATUS_INTERVAL_FRAMES;
+
+		output << timestamp << "hostname: Valve Matchmaking Server (Virginia iad-1/srcds138 #42)";
+		output << timestamp << mh::format("players : {} humans, 0 bots ({} max)", players, players);
+		output << timestamp << "# userid name                uniqueid            connected ping loss state";
+		for (uint32_t i = 0; i < players; i++)
+		{
+			output << timestamp << mh::format("#    {:3} \"{}\"  [U:1:{}]  {:02}:{:02}  {:3}    0 active",
+				300 + i, GetPlayerName(i), FIRST_ACCOUNT_ID + i, (seconds / 60 + i) % 60, seconds % 60, 40 + (i % 80));
+		}
+
+		output << timestamp << mh::format("CTFLobbyShared: ID:00025efa1c94b5f5  {} member(s), 0 pending", players);
+		for (uint32_t i = 0; i < players; i++)
+		{
+			output << timestamp << mh::format("  Member[{}] [U:1:{}]  team = {}  type = MATCH_PLAYER",
+				i, FIRST_ACCOUNT_ID + i, (i % 2) ? "TF_GC_TEAM_INVADERS" : "TF_GC_TEAM_DEFENDERS");
+		}
+	}
+
+	// A busy server, but not a spammed one
+	output << timestamp << chat.m_Full.m_Start.m_Narrow
+		<< chat.m_Name.m_Start.m_Narrow << GetPlayerName(m_Frame % players) << chat.m_Name.m_End.m_Narrow
+		<< " :  "
+		<< chat.m_Message.m_Start.m_Narrow << "gg ez " << m_Frame << chat.m_Message.m_End.m_Narrow
+		<< chat.m_Full.m_End.m_Narrow;
+
+	output << timestamp << GetPlayerName((m_Frame * 7) % players) << " killed "
+		<< GetPlayerName((m_Frame * 7 + 1) % players) << " with scattergun. (crit)";
+
+	output << '\n';
+	return output;
+}
+
+void UIBenchmark::MarkPlayers(IWorldState& world, IModeratorLogic& modLogic)
+{
+	size_t index = 0;
+	for (const IPlayer& player : std::as_const(world).GetPlayers())
+	{
+		// Transient, so nothing ends up in the playerlist
+		if ((index % 4) == 0)
+			modLogic.SetPlayerAttribute(player, PlayerAttribute::Cheater, AttributePersistence::Transient);
+		else if ((index % 7) == 0)
+			modLogic.SetPlayerAttribute(player, PlayerAttribute::Suspicious, AttributePersistence::Transient);
+
+		index++;
+	}
+
+	m_PlayersMarked = index > 0;
+}
+
+bool UIBenchmark::Update(IWorldState& world, ConsoleLogParser& parser, IModeratorLogic& modLogic)
+{
+	if (m_Frame >= WARMUP_FRAMES + m_Options.m_Frames)
+		return false;
+
+	if (m_Frame == WARMUP_FRAMES)
+		Profiler::GetInstance().ResetTotals();
+
+	parser.ParseText(GenerateFrameOutput());
+	if (!m_PlayersMarked)
+		MarkPlayers(world, modLogic);
+
+	m_Frame++;
+	return true;
+}
+
+void UIBenchmark::LogResults() const
+{
+	Log("UI benchmark: {} players, {} frames", m_Options.m_Players, m_Options.m_Frames);
+
+	Profiler::GetInstance().ForEachSectionTotal([&](const std::string_view& name, const Profiler::SectionStats& stats)
+		{
+			if (!name.starts_with("MainWindow::OnDraw") || stats.m_Count == 0)
+				return;
+
+			using ms = std::chrono::duration<double, std::milli>;
+			Log("  {}: {:.3f}ms/frame, p50 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms", name,
+				ms(stats.m_Total).count() / m_Options.m_Frames, ms(stats.GetPercentile(0.5f)).count(),
+				ms(stats.GetPercentile(0.99f)).count(), ms(stats.m_Max).count());
+		});
+}
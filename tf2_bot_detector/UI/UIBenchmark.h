@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Config/ChatWrappers.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace tf2_bot_detector
+{
+	class ConsoleLogParser;
+	class IModeratorLogic;
+	class IWorldState;
+	class Settings;
+
+	struct UIBenchmarkOptions
+	{
+		uint32_t m_Players = 24;
+		uint32_t m_Frames = 1000;
+	};
+
+	// --benchmark-ui <players> <frames>: draws the main window against a synthetic server instead of
+	// a game. The window is never shown and the setup flow is skipped, so nothing waits on the user
+	// or touches console.log. Each frame gets a few lines of chat and kills, with status and the lobby
+	// every STATUS_INTERVAL_FRAMES, and every few players are marked. Once m_Frames frames are drawn,
+	// the CPU time per frame of each part of the main window is logged.
+	class UIBenchmark final
+	{
+	public:
+		explicit UIBenchmark(const UIBenchmarkOptions& options);
+
+		// In memory only, none of these are ever saved
+		void ApplySettings(Settings& settings);
+
+		// Feeds the parser the next frame's console output. Returns false once every frame has been drawn.
+		bool Update(IWorldState& world, ConsoleLogParser& parser, IModeratorLogic& modLogic);
+
+		void LogResults() const;
+
+	private:
+		static constexpr uint32_t WARMUP_FRAMES = 60; // Font atlas builds and the like, not counted
+		static constexpr uint32_t STATUS_INTERVAL_FRAMES = 60;
+
+		std::string GenerateFrameOutput() const;
+		void MarkPlayers(IWorldState& world, IModeratorLogic& modLogic);
+
+		UIBenchmarkOptions m_Options;
+		std::optional<ChatWrappers> m_ChatWrappers;
+		uint32_t m_Frame = 0;
+		bool m_PlayersMarked = false;
+	};
+}
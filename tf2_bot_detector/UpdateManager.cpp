@@ -1,25 +1,31 @@
 #include "UpdateManager.h"
 #include "Config/Settings.h"
 #include "Networking/GithubAPI.h"
+#include "Networking/HTTPCache.h"
 #include "Networking/HTTPClient.h"
 #include "Networking/HTTPHelpers.h"
 #include "Platform/Platform.h"
+#include "Util/BinaryPatch.h"
 #include "Util/JSONUtils.h"
 #include "Log.h"
 #include "ReleaseChannel.h"
 #include "Filesystem.h"
 
+#include <cryptopp/sha.h>
 #include <libzippp/libzippp.h>
 #include <mh/algorithm/multi_compare.hpp>
 #include <mh/future.hpp>
 #include <mh/error/exception_details.hpp>
 #include <mh/raii/scope_exit.hpp>
 #include <mh/text/fmtstr.hpp>
+#include <mh/text/string_insertion.hpp>
 #include <mh/types/disable_copy_move.hpp>
 #include <mh/utility.hpp>
 #include <mh/variant.hpp>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
+#include <cctype>
 #include <compare>
 #include <fstream>
 #include <variant>
@@ -47,6 +53,22 @@ namespace tf2_bot_detector
 		mh::find_enum_value(j, d);
 	}
 
+	void to_json(nlohmann::json& j, const BuildInfo::BuildVariant::Delta& d)
+	{
+		j =
+		{
+			{ "from_version", d.m_FromVersion },
+			{ "download_url", d.m_DownloadURL },
+			{ "sha256", d.m_SHA256 },
+		};
+	}
+	void from_json(const nlohmann::json& j, BuildInfo::BuildVariant::Delta& d)
+	{
+		d.m_FromVersion = j.at("from_version");
+		d.m_DownloadURL = j.at("download_url");
+		d.m_SHA256 = j.at("sha256");
+	}
+
 	void to_json(nlohmann::json& j, const BuildInfo::BuildVariant& d)
 	{
 		j =
@@ -55,12 +77,19 @@ namespace tf2_bot_detector
 			{ "arch", d.m_Arch },
 			{ "download_url", d.m_DownloadURL },
 		};
+
+		if (!d.m_SHA256.empty())
+			j["sha256"] = d.m_SHA256;
+		if (!d.m_Deltas.empty())
+			j["deltas"] = d.m_Deltas;
 	}
 	void from_json(const nlohmann::json& j, BuildInfo::BuildVariant& d)
 	{
 		d.m_OS = j.at("os");
 		d.m_Arch = j.at("arch");
 		d.m_DownloadURL = j.at("download_url");
+		try_get_to_defaulted(j, d.m_SHA256, "sha256");
+		try_get_to_defaulted(j, d.m_Deltas, "deltas");
 	}
 
 	void to_json(nlohmann::json& j, const BuildInfo& d)
@@ -244,10 +273,26 @@ namespace
 		} m_State;
 
 		bool CanReplaceUpdateCheckState() const;
+		void SetUpdateCheckResult(BuildInfo&& buildInfo);
+
+		// The last release info we got for our release channel, for startup before the real check
+		// gets back to us. Its ETag/Last-Modified are in HTTPCache, so the check is usually a 304.
+		static std::filesystem::path GetCachedBuildInfoPath();
+		static std::optional<BuildInfo> LoadCachedBuildInfo(ReleaseChannel releaseChannel);
+		static void SaveCachedBuildInfo(ReleaseChannel releaseChannel, const BuildInfo& buildInfo);
+		static BuildInfo CheckForUpdate(const HTTPClient& client, ReleaseChannel releaseChannel);
+
+		// Replaces what's in the update check variant once it finishes, so the cached
+		// result stays visible (and the setup flow isn't held up) in the meantime
+		std::future<BuildInfo> m_BackgroundCheck;
+		ReleaseChannel m_CheckedReleaseChannel = ReleaseChannel::None; // What the update check variant is for
 
 		const std::filesystem::path DOWNLOAD_DIR_ROOT =
 			IFilesystem::Get().GetTempDir() / "Portable Updates";
 
+		// Partial downloads are only worth keeping for a little while, there's probably a newer build by then
+		static constexpr duration_t PARTIAL_DOWNLOAD_LIFETIME = std::chrono::hours(24 * 7);
+
 		void CleanupOldUpdates() const;
 
 		static std::future<std::optional<DownloadedBuild>> DownloadBuild(const HTTPClient& client,
@@ -257,6 +302,7 @@ namespace
 		static std::future<std::optional<UpdateToolResult>> RunUpdateTool(std::filesystem::path path, std::string args);
 
 		bool m_IsUpdateQueued = true;
+		bool m_HasCleanedUpOldUpdates = false;
 		bool m_IsInstalled;
 	};
 
@@ -264,11 +310,113 @@ namespace
 		m_Settings(settings),
 		m_IsInstalled(Platform::IsInstalled())
 	{
-		CleanupOldUpdates();
-
 		assert(m_IsUpdateQueued);
 		m_State.SetUpdateStatus(MH_SOURCE_LOCATION_CURRENT(),
 			UpdateStatus::CheckQueued, "Initializing update check...");
+
+		if (m_Settings.GetHTTPClient())
+		{
+			m_CheckedReleaseChannel = m_Settings.m_ReleaseChannel.value_or(ReleaseChannel::None);
+			if (auto cached = LoadCachedBuildInfo(m_CheckedReleaseChannel))
+				SetUpdateCheckResult(std::move(*cached));
+		}
+	}
+
+	std::filesystem::path UpdateManager::GetCachedBuildInfoPath()
+	{
+		return IFilesystem::Get().GetLocalAppDataDir() / "latest_version.json";
+	}
+
+	std::optional<BuildInfo> UpdateManager::LoadCachedBuildInfo(ReleaseChannel releaseChannel) try
+	{
+		if (releaseChannel == ReleaseChannel::None)
+			return std::nullopt;
+
+		const auto path = GetCachedBuildInfoPath();
+		if (!std::filesystem::exists(path))
+			return std::nullopt;
+
+		const auto json = nlohmann::json::parse(IFilesystem::Get().ReadFile(path));
+		if (json.at("release_channel").get<ReleaseChannel>() != releaseChannel)
+			return std::nullopt; // Switched channels since, the next check replaces it
+
+		return json.at("build_info").get<BuildInfo>();
+	}
+	catch (...)
+	{
+		// Just means we wait for the real check
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to load {}", GetCachedBuildInfoPath());
+		return std::nullopt;
+	}
+
+	void UpdateManager::SaveCachedBuildInfo(ReleaseChannel releaseChannel, const BuildInfo& buildInfo)
+	{
+		const nlohmann::json json =
+		{
+			{ "release_channel", releaseChannel },
+			{ "build_info", buildInfo },
+		};
+
+		IFilesystem::Get().WriteFile(GetCachedBuildInfoPath(), json.dump(1, '\t') << '\n', PathUsage::WriteLocal);
+	}
+
+	BuildInfo UpdateManager::CheckForUpdate(const HTTPClient& client, ReleaseChannel releaseChannel)
+	{
+		const std::string url = mh::format(
+			"https://tf2bd-util.pazer.us/AppInstaller/LatestVersion.json?type={:v}",
+			mh::enum_fmt(releaseChannel));
+
+		// Only conditional if we still have what the validators were for
+		auto cached = LoadCachedBuildInfo(releaseChannel);
+		const auto validators = cached ? HTTPCache::FindValidators(url) : std::nullopt;
+
+		DebugLog("HTTP GET {}", url);
+		auto task = client.GetStringConditionalAsync(url, HTTPRequestTag::UpdateCheck,
+			validators.value_or(HTTPCacheValidators{}));
+		task.wait();
+		auto response = task.get();
+
+		if (response.m_NotModified && cached)
+		{
+			DebugLog(MH_SOURCE_LOCATION_CURRENT(), "{} not modified since the last update check", url);
+			return std::move(*cached);
+		}
+
+		auto buildInfo = nlohmann::json::parse(response.m_Body).get<BuildInfo>();
+
+		try
+		{
+			SaveCachedBuildInfo(releaseChannel, buildInfo);
+			HTTPCache::SetValidators(url, std::move(response.m_Validators));
+		}
+		catch (...)
+		{
+			// Still a perfectly good result, the next startup just won't have it early
+			LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to save {}", GetCachedBuildInfoPath());
+			HTTPCache::RemoveValidators(url);
+		}
+
+		return buildInfo;
+	}
+
+	void UpdateManager::SetUpdateCheckResult(BuildInfo&& buildInfo)
+	{
+		AvailableUpdate update(*this, std::move(buildInfo));
+
+		if (update.m_BuildInfo.m_Version <= VERSION)
+		{
+			m_State.SetUpdateCheck(MH_SOURCE_LOCATION_CURRENT(), UpdateStatus::UpToDate,
+				mh::format("Up to date (v{} {:v})", VERSION, mh::enum_fmt(
+					m_Settings.m_ReleaseChannel.value_or(ReleaseChannel::Public))),
+				std::move(update));
+		}
+		else
+		{
+			m_State.SetUpdateCheck(MH_SOURCE_LOCATION_CURRENT(), UpdateStatus::UpdateAvailable,
+				mh::format("Update available (v{} {:v})", update.m_BuildInfo.m_Version, mh::enum_fmt(
+					m_Settings.m_ReleaseChannel.value_or(ReleaseChannel::Public))),
+				std::move(update));
+		}
 	}
 
 	template<typename TFutureResult, typename TVariant>
@@ -305,6 +453,10 @@ namespace
 
 	void UpdateManager::Update()
 	{
+		// Not in the constructor, so it waits until we start updating (after the first frame)
+		if (!std::exchange(m_HasCleanedUpOldUpdates, true))
+			CleanupOldUpdates();
+
 		if (m_IsUpdateQueued && CanReplaceUpdateCheckState())
 		{
 			if (auto client = m_Settings.GetHTTPClient())
@@ -313,21 +465,23 @@ namespace
 				if (releaseChannel != ReleaseChannel::None)
 				{
 					auto sharedClient = client->shared_from_this();
+					auto check = std::async([sharedClient, releaseChannel]() -> BuildInfo
+						{
+							return CheckForUpdate(*sharedClient, releaseChannel);
+						});
 
-					m_State.SetUpdateCheck(MH_SOURCE_LOCATION_CURRENT(), UpdateStatus::Checking, "Checking for updates...",
-						std::async([sharedClient, releaseChannel]() -> BuildInfo
-							{
-								const mh::fmtstr<256> url(
-									"https://tf2bd-util.pazer.us/AppInstaller/LatestVersion.json?type={:v}",
-									mh::enum_fmt(releaseChannel));
-
-								DebugLog("HTTP GET {}", url);
-								auto response = sharedClient->GetString(url.view());
-
-								auto json = nlohmann::json::parse(response);
-
-								return json.get<BuildInfo>();
-							}));
+					if (GetAvailableUpdate() && m_CheckedReleaseChannel == releaseChannel)
+					{
+						// Keep showing the cached result, this only replaces it if something changed
+						DebugLog(MH_SOURCE_LOCATION_CURRENT(), "Checking for updates in the background...");
+						m_BackgroundCheck = std::move(check);
+					}
+					else
+					{
+						m_CheckedReleaseChannel = releaseChannel;
+						m_State.SetUpdateCheck(MH_SOURCE_LOCATION_CURRENT(), UpdateStatus::Checking,
+							"Checking for updates...", std::move(check));
+					}
 				}
 				else
 				{
@@ -352,24 +506,7 @@ namespace
 				if (client)
 				{
 					if (mh::is_future_ready(*future))
-					{
-						AvailableUpdate update(*this, future->get());
-
-						if (update.m_BuildInfo.m_Version <= VERSION)
-						{
-							m_State.SetUpdateCheck(MH_SOURCE_LOCATION_CURRENT(), UpdateStatus::UpToDate,
-								mh::format("Up to date (v{} {:v})", VERSION, mh::enum_fmt(
-									m_Settings.m_ReleaseChannel.value_or(ReleaseChannel::Public))),
-								std::move(update));
-						}
-						else
-						{
-							m_State.SetUpdateCheck(MH_SOURCE_LOCATION_CURRENT(), UpdateStatus::UpdateAvailable,
-								mh::format("Update available (v{} {:v})", update.m_BuildInfo.m_Version, mh::enum_fmt(
-									m_Settings.m_ReleaseChannel.value_or(ReleaseChannel::Public))),
-								std::move(update));
-						}
-					}
+						SetUpdateCheckResult(future->get());
 				}
 				else
 				{
@@ -384,6 +521,32 @@ namespace
 			}
 		}
 
+		// Not in the middle of installing whatever the cached result pointed us at
+		if (m_BackgroundCheck.valid() && mh::is_future_ready(m_BackgroundCheck) &&
+			std::holds_alternative<std::monostate>(m_State.GetVariant()))
+		{
+			try
+			{
+				auto buildInfo = m_BackgroundCheck.get();
+
+				const auto shown = GetAvailableUpdate();
+				if (buildInfo.m_Version > VERSION && (!shown || buildInfo.m_Version > shown->m_BuildInfo.m_Version))
+				{
+					// The setup flow is long gone by now, so this (and the help menu) is all the user sees of it
+					Log("A new version of TF2 Bot Detector is available: v{} (currently running v{})",
+						buildInfo.m_Version, VERSION);
+				}
+
+				SetUpdateCheckResult(std::move(buildInfo));
+			}
+			catch (const std::exception& e)
+			{
+				// We still have the cached result, no need to report the whole check as failed
+				LogWarning(MH_SOURCE_LOCATION_CURRENT(), "Background update check failed:\n\t- {}\n\t- {}",
+					typeid(e).name(), e.what());
+			}
+		}
+
 		if (auto downloadedBuild = std::get_if<DownloadedBuild>(&m_State.GetVariant()))
 		{
 			[&]
@@ -484,6 +647,9 @@ namespace
 	/// </summary>
 	bool UpdateManager::CanReplaceUpdateCheckState() const
 	{
+		if (m_BackgroundCheck.valid() && !mh::is_future_ready(m_BackgroundCheck))
+			return false; // would block in std::future's destructor
+
 		const auto* future = std::get_if<std::future<BuildInfo>>(&m_State.GetUpdateCheckVariant());
 		if (!future)
 			return true; // some other value in the variant
@@ -547,35 +713,161 @@ namespace
 		}
 	}
 
-	static void DownloadAndExtractZip(const HTTPClient& client, const URL& url,
-		const std::filesystem::path& extractDir)
+	static std::string ComputeSHA256(const std::string_view& data)
 	{
-		Log(MH_SOURCE_LOCATION_CURRENT(), "{} -> {}", url, extractDir);
+		CryptoPP::SHA256 hash;
+		hash.Update(reinterpret_cast<const CryptoPP::byte*>(data.data()), data.size());
 
-		DebugLog(MH_SOURCE_LOCATION_CURRENT(), "Downloading {}...", url);
-		const auto data = client.GetString(url);
+		CryptoPP::byte digest[CryptoPP::SHA256::DIGESTSIZE];
+		hash.Final(digest);
 
-		// Need to save to a file due to a libzippp bug in ZipArchive::fromBuffer
-		const auto tempZipPath = mh::copy(extractDir).replace_extension(".zip");
-		Log(MH_SOURCE_LOCATION_CURRENT(), "Saving zip to {}...", tempZipPath);
+		std::string hex;
+		hex.reserve(sizeof(digest) * 2);
+		for (CryptoPP::byte b : digest)
+			hex += mh::fmtstr<8>("{:02x}", b).view();
 
+		return hex;
+	}
+
+	// An empty expected hash is not checked
+	template<typename TWhat>
+	static void VerifySHA256(const std::string_view& data, const std::string_view& expected, const TWhat& what)
+	{
+		if (expected.empty())
+			return;
+
+		const auto actual = ComputeSHA256(data);
+		if (!std::equal(actual.begin(), actual.end(), expected.begin(), expected.end(),
+			[](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); }))
+		{
+			throw std::runtime_error(mh::format("{}: SHA-256 mismatch for {}, expected {}, got {}",
+				MH_SOURCE_LOCATION_CURRENT(), what, expected, actual));
+		}
+	}
+
+	// Archives that are still downloading, kept across restarts (unlike DOWNLOAD_DIR_ROOT) so they can be resumed
+	static std::filesystem::path GetPartialDownloadDir()
+	{
+		return IFilesystem::Get().GetTempDir() / "Portable Update Downloads";
+	}
+
+	// Streamed to disk (and resumed, if an earlier attempt got partway), rather than held in memory.
+	// Named after the expected hash, so a different build never picks up where this one left off.
+	// Anything that fails the hash check is deleted, so the next attempt starts over.
+	static std::filesystem::path DownloadArchive(const HTTPClient& client, const URL& url,
+		const std::string_view& expectedSHA256)
+	{
+		const std::string name = expectedSHA256.empty() ?
+			mh::format("{:016x}", std::hash<std::string>{}(url.ToString())) : std::string(expectedSHA256);
+		const auto path = GetPartialDownloadDir() / (name + ".zip");
+
+		DebugLog(MH_SOURCE_LOCATION_CURRENT(), "Downloading {} to {}...", url, path);
+		auto task = client.DownloadFileAsync(url, HTTPRequestTag::UpdateDownload, path);
+		task.wait();
+		task.get();
+
+		try
+		{
+			VerifySHA256(IFilesystem::Get().MapFile(path), expectedSHA256, url);
+		}
+		catch (...)
+		{
+			std::error_code ec;
+			std::filesystem::remove(path, ec);
+			throw;
+		}
+
+		return path;
+	}
+
+	static void DownloadAndExtractZip(const HTTPClient& client, const URL& url,
+		const std::filesystem::path& extractDir, const std::string_view& expectedSHA256 = {})
+	{
+		Log(MH_SOURCE_LOCATION_CURRENT(), "{} -> {}", url, extractDir);
+
+		const auto zipPath = DownloadArchive(client, url, expectedSHA256);
 		mh::scope_exit scopeExit([&]
 			{
-				Log(MH_SOURCE_LOCATION_CURRENT(), "Deleting {}...", tempZipPath);
-				std::filesystem::remove(tempZipPath);
+				Log(MH_SOURCE_LOCATION_CURRENT(), "Deleting {}...", zipPath);
+				std::error_code ec;
+				std::filesystem::remove(zipPath, ec);
 			});
 
-		SaveFile(tempZipPath, data.data(), data.data() + data.size());
-
 		{
 			using namespace libzippp;
-			Log(MH_SOURCE_LOCATION_CURRENT(), "Extracting {} to {}...", tempZipPath, extractDir);
-			ZipArchive archive(tempZipPath.string());
+			Log(MH_SOURCE_LOCATION_CURRENT(), "Extracting {} to {}...", zipPath, extractDir);
+			ZipArchive archive(zipPath.string());
 			archive.open();
 			ExtractArchive(archive, extractDir);
 		}
 	}
 
+	// Rebuilds the new version in outputDir from the files in installDir and a delta archive. Its
+	// delta_manifest.json lists every file of the new version:
+	//   { "path", "sha256" } to reuse the installed file as is
+	//   { "path", "sha256", "source_sha256", "patch" } to apply the binary patch in that archive entry
+	//   { "path", "sha256", "file" } to take that archive entry as the whole file
+	// Every output file is checked against its sha256, so anything unexpected in installDir throws.
+	static void DownloadAndApplyDelta(const HTTPClient& client, const BuildInfo::BuildVariant::Delta& delta,
+		const std::filesystem::path& installDir, const std::filesystem::path& outputDir)
+	{
+		Log(MH_SOURCE_LOCATION_CURRENT(), "{} (delta from v{}) -> {}", delta.m_DownloadURL, delta.m_FromVersion, outputDir);
+
+		const auto zipPath = DownloadArchive(client, delta.m_DownloadURL, delta.m_SHA256);
+		mh::scope_exit scopeExit([&]
+			{
+				std::error_code ec;
+				std::filesystem::remove(zipPath, ec);
+			});
+
+		libzippp::ZipArchive archive(zipPath.string());
+		archive.open();
+
+		const auto ReadEntry = [&](const std::string& name)
+		{
+			const auto entry = archive.getEntry(name);
+			if (entry.isNull())
+				throw std::runtime_error(mh::format("{}: {} is missing from the delta archive", MH_SOURCE_LOCATION_CURRENT(), name));
+
+			return entry.readAsText();
+		};
+
+		const auto manifest = nlohmann::json::parse(ReadEntry("delta_manifest.json"));
+		for (const auto& file : manifest.at("files"))
+		{
+			const std::filesystem::path path = file.at("path").get<std::string>();
+			if (path.empty() || path.is_absolute() || std::find(path.begin(), path.end(), "..") != path.end())
+				throw std::runtime_error(mh::format("{}: Invalid path {} in delta manifest", MH_SOURCE_LOCATION_CURRENT(), path));
+
+			const std::string expectedSHA256 = file.at("sha256");
+			if (expectedSHA256.empty())
+				throw std::runtime_error(mh::format("{}: No sha256 for {} in delta manifest", MH_SOURCE_LOCATION_CURRENT(), path));
+
+			std::string contents;
+			if (auto entry = file.find("file"); entry != file.end())
+			{
+				contents = ReadEntry(*entry);
+			}
+			else
+			{
+				const MappedFile installed = IFilesystem::Get().MapFile(installDir / path);
+
+				if (auto patch = file.find("patch"); patch != file.end())
+				{
+					VerifySHA256(installed, file.at("source_sha256").get<std::string>(), installDir / path);
+					contents = ApplyBinaryPatch(installed, ReadEntry(*patch));
+				}
+				else
+				{
+					contents = installed.GetData();
+				}
+			}
+
+			VerifySHA256(contents, expectedSHA256, path);
+			SaveFile(outputDir / path, contents.data(), contents.data() + contents.size());
+		}
+	}
+
 	void UpdateManager::CleanupOldUpdates() const
 	{
 		DebugLog(MH_SOURCE_LOCATION_CURRENT(), "Cleaning up old downloaded updates from {}...", DOWNLOAD_DIR_ROOT);
@@ -596,6 +888,16 @@ namespace
 		{
 			Log(MH_SOURCE_LOCATION_CURRENT(), "Deleted {} items from {}.", deletedCount, DOWNLOAD_DIR_ROOT);
 		}
+
+		const auto now = std::filesystem::file_time_type::clock::now();
+		for (const auto& entry : std::filesystem::directory_iterator(GetPartialDownloadDir(), ec))
+		{
+			if (const auto writeTime = entry.last_write_time(ec); !ec && (now - writeTime) > PARTIAL_DOWNLOAD_LIFETIME)
+			{
+				DebugLog(MH_SOURCE_LOCATION_CURRENT(), "Deleting old partial download {}", entry.path());
+				std::filesystem::remove(entry.path(), ec);
+			}
+		}
 	}
 
 	auto UpdateManager::DownloadBuild(const HTTPClient& client,
@@ -608,7 +910,25 @@ namespace
 		auto clientPtr = client.shared_from_this();
 		return std::async([clientPtr, tool, updater, downloadDir]() -> std::optional<DownloadedBuild>
 			{
-				DownloadAndExtractZip(*clientPtr, tool.m_DownloadURL, downloadDir);
+				if (auto delta = std::find_if(tool.m_Deltas.begin(), tool.m_Deltas.end(),
+					[](const BuildInfo::BuildVariant::Delta& d) { return d.m_FromVersion == VERSION; });
+					delta != tool.m_Deltas.end())
+				{
+					try
+					{
+						DownloadAndApplyDelta(*clientPtr, *delta, Platform::GetCurrentExeDir(), downloadDir);
+						return DownloadedBuild(updater, downloadDir);
+					}
+					catch (...)
+					{
+						LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to apply delta update, downloading the full build instead");
+
+						std::error_code ec;
+						std::filesystem::remove_all(downloadDir, ec);
+					}
+				}
+
+				DownloadAndExtractZip(*clientPtr, tool.m_DownloadURL, downloadDir, tool.m_SHA256);
 
 				return DownloadedBuild(updater, downloadDir);
 			});
@@ -624,7 +944,7 @@ namespace
 				const auto downloadDir = downloadDirRoot / mh::format("updater_{}",
 					std::chrono::high_resolution_clock::now().time_since_epoch().count());
 
-				DownloadAndExtractZip(*clientPtr, updater.m_DownloadURL, downloadDir);
+				DownloadAndExtractZip(*clientPtr, updater.m_DownloadURL, downloadDir, updater.m_SHA256);
 
 				// FIXME linux
 				return DownloadedUpdateTool(downloadDir / "tf2_bot_detector_updater.exe", args);
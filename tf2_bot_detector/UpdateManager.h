@@ -26,6 +26,17 @@ namespace tf2_bot_detector
 			Platform::OS m_OS{};
 			Platform::Arch m_Arch{};
 			std::string m_DownloadURL;
+			std::string m_SHA256; // Of the download, hex. Optional.
+
+			// Only the changes from one specific older version, much smaller than the full download.
+			// Rebuilt into the full directory before the updater sees it, so it doesn't need to know.
+			struct Delta
+			{
+				Version m_FromVersion{};
+				std::string m_DownloadURL;
+				std::string m_SHA256;
+			};
+			std::vector<Delta> m_Deltas;
 		};
 
 		std::vector<BuildVariant> m_Updater;
@@ -0,0 +1,130 @@
+#include "AhoCorasick.h"
+
+#include <cassert>
+#include <queue>
+#include <stdexcept>
+
+using namespace tf2_bot_detector;
+
+static constexpr uint8_t FoldCase(uint8_t c)
+{
+	return (c >= 'A' && c <= 'Z') ? uint8_t(c - 'A' + 'a') : c;
+}
+
+AhoCorasick::AhoCorasick(bool caseSensitive) :
+	m_CaseSensitive(caseSensitive)
+{
+}
+
+size_t AhoCorasick::AddPattern(const std::string_view& pattern)
+{
+	if (pattern.empty())
+		throw std::invalid_argument("Patterns must not be empty");
+
+	m_Transitions.clear();
+	m_Patterns.emplace_back(pattern);
+	return m_Patterns.size() - 1;
+}
+
+void AhoCorasick::Build()
+{
+	static constexpr uint32_t NO_STATE = uint32_t(-1);
+
+	// Assign byte classes
+	m_ByteClasses.fill(0);
+	m_ClassCount = 1;
+	for (const auto& pattern : m_Patterns)
+	{
+		for (char ch : pattern)
+		{
+			const uint8_t c = m_CaseSensitive ? uint8_t(ch) : FoldCase(uint8_t(ch));
+			if (m_ByteClasses[c] == 0)
+			{
+				if (m_ClassCount > 255)
+					throw std::length_error("Too many distinct pattern characters");
+
+				m_ByteClasses[c] = uint8_t(m_ClassCount++);
+			}
+		}
+	}
+
+	if (!m_CaseSensitive)
+	{
+		for (unsigned c = 'A'; c <= 'Z'; c++)
+			m_ByteClasses[c] = m_ByteClasses[FoldCase(uint8_t(c))];
+	}
+
+	// Build the trie
+	m_Transitions.assign(m_ClassCount, NO_STATE);
+	m_NodeOutputs.assign(1, NO_OUTPUT);
+	m_Outputs.clear();
+
+	for (size_t patternIndex = 0; patternIndex < m_Patterns.size(); patternIndex++)
+	{
+		uint32_t state = 0;
+		for (char ch : m_Patterns[patternIndex])
+		{
+			uint32_t& next = m_Transitions[state * m_ClassCount + m_ByteClasses[uint8_t(ch)]];
+			if (next == NO_STATE)
+			{
+				next = uint32_t(m_NodeOutputs.size());
+				m_NodeOutputs.push_back(NO_OUTPUT);
+				m_Transitions.resize(m_Transitions.size() + m_ClassCount, NO_STATE);
+			}
+
+			state = m_Transitions[state * m_ClassCount + m_ByteClasses[uint8_t(ch)]];
+		}
+
+		m_Outputs.push_back({ uint32_t(patternIndex), m_NodeOutputs[state] });
+		m_NodeOutputs[state] = uint32_t(m_Outputs.size() - 1);
+	}
+
+	// Breadth-first, fill in the failure transitions and append each state's suffix outputs to its own
+	std::vector<uint32_t> failure(m_NodeOutputs.size(), 0);
+	std::queue<uint32_t> queue;
+
+	for (uint32_t c = 0; c < m_ClassCount; c++)
+	{
+		uint32_t& next = m_Transitions[c];
+		if (next == NO_STATE)
+			next = 0;
+		else
+			queue.push(next);
+	}
+
+	while (!queue.empty())
+	{
+		const uint32_t state = queue.front();
+		queue.pop();
+
+		for (uint32_t c = 0; c < m_ClassCount; c++)
+		{
+			const uint32_t failureNext = m_Transitions[failure[state] * m_ClassCount + c];
+			uint32_t& next = m_Transitions[state * m_ClassCount + c];
+			if (next == NO_STATE)
+			{
+				next = failureNext;
+			}
+			else
+			{
+				failure[next] = failureNext;
+				queue.push(next);
+			}
+		}
+
+		// Parents are always processed before their children, so the failure state's list is already complete
+		const uint32_t suffixOutputs = m_NodeOutputs[failure[state]];
+		if (m_NodeOutputs[state] == NO_OUTPUT)
+		{
+			m_NodeOutputs[state] = suffixOutputs;
+		}
+		else
+		{
+			uint32_t last = m_NodeOutputs[state];
+			while (m_Outputs[last].m_Next != NO_OUTPUT)
+				last = m_Outputs[last].m_Next;
+
+			m_Outputs[last].m_Next = suffixOutputs;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	// Finds every occurrence of every one of a set of patterns in a single pass over the text.
+	class AhoCorasick final
+	{
+	public:
+		explicit AhoCorasick(bool caseSensitive = true);
+
+		// Patterns must be non-empty and added before Build(). Returns the index of the new pattern.
+		size_t AddPattern(const std::string_view& pattern);
+		void Build();
+
+		bool IsCaseSensitive() const { return m_CaseSensitive; }
+		size_t GetPatternCount() const { return m_Patterns.size(); }
+
+		// Calls func(patternIndex, matchBegin, matchEnd) for every occurrence of every pattern in text.
+		template<typename TFunc>
+		void ForEachMatch(const std::string_view& text, TFunc&& func) const
+		{
+			if (m_Transitions.empty())
+				return;
+
+			uint32_t state = 0;
+			for (size_t i = 0; i < text.size(); i++)
+			{
+				state = m_Transitions[state * m_ClassCount + m_ByteClasses[uint8_t(text[i])]];
+
+				for (uint32_t output = m_NodeOutputs[state]; output != NO_OUTPUT; output = m_Outputs[output].m_Next)
+				{
+					const uint32_t pattern = m_Outputs[output].m_Pattern;
+					func(size_t(pattern), i + 1 - m_Patterns[pattern].size(), i + 1);
+				}
+			}
+		}
+
+	private:
+		static constexpr uint32_t NO_OUTPUT = uint32_t(-1);
+
+		struct Output
+		{
+			uint32_t m_Pattern;
+			uint32_t m_Next;
+		};
+
+		bool m_CaseSensitive;
+		std::vector<std::string> m_Patterns;
+
+		// Only bytes that appear in a pattern get their own column in the transition table, everything else is class 0
+		std::array<uint8_t, 256> m_ByteClasses{};
+		uint32_t m_ClassCount = 1;
+
+		std::vector<uint32_t> m_Transitions; // [state * m_ClassCount + class] => next state
+		std::vector<uint32_t> m_NodeOutputs; // [state] => first entry in m_Outputs, including outputs of suffix states
+		std::vector<Output> m_Outputs;
+	};
+}
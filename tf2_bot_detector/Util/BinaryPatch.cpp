@@ -0,0 +1,101 @@
+#include "BinaryPatch.h"
+
+#include <mh/text/format.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace tf2_bot_detector;
+
+namespace
+{
+	class PatchReader final
+	{
+	public:
+		explicit PatchReader(const std::string_view& patch) : m_Patch(patch) {}
+
+		bool empty() const { return m_Pos >= m_Patch.size(); }
+
+		std::string_view ReadBytes(uint64_t count)
+		{
+			if (count > (m_Patch.size() - m_Pos))
+				throw std::runtime_error(mh::format("Binary patch truncated at offset {}", m_Pos));
+
+			const auto bytes = m_Patch.substr(m_Pos, size_t(count));
+			m_Pos += size_t(count);
+			return bytes;
+		}
+
+		uint8_t ReadUInt8() { return uint8_t(ReadBytes(1)[0]); }
+		uint64_t ReadUInt64()
+		{
+			const auto bytes = ReadBytes(8);
+
+			uint64_t value = 0;
+			for (size_t i = 0; i < 8; i++)
+				value |= uint64_t(uint8_t(bytes[i])) << (i * 8);
+
+			return value;
+		}
+
+	private:
+		std::string_view m_Patch;
+		size_t m_Pos = 0;
+	};
+}
+
+std::string tf2_bot_detector::ApplyBinaryPatch(const std::string_view& source, const std::string_view& patch)
+{
+	PatchReader reader(patch);
+
+	if (reader.ReadBytes(sizeof(BINARY_PATCH_MAGIC)) != std::string_view(BINARY_PATCH_MAGIC, sizeof(BINARY_PATCH_MAGIC)))
+		throw std::runtime_error("Not a binary patch");
+
+	const uint64_t targetSize = reader.ReadUInt64();
+
+	// Don't trust it with a giant allocation before we've seen the ops
+	std::string target;
+	target.reserve(size_t(std::min<uint64_t>(targetSize, source.size() + patch.size())));
+
+	while (!reader.empty())
+	{
+		const auto op = BinaryPatchOp(reader.ReadUInt8());
+
+		std::string_view bytes;
+		switch (op)
+		{
+		case BinaryPatchOp::Copy:
+		{
+			const uint64_t offset = reader.ReadUInt64();
+			const uint64_t length = reader.ReadUInt64();
+			if (offset > source.size() || length > (source.size() - offset))
+			{
+				throw std::runtime_error(mh::format("Binary patch copies [{}, {}) from a source of {} bytes",
+					offset, offset + length, source.size()));
+			}
+
+			bytes = source.substr(size_t(offset), size_t(length));
+			break;
+		}
+		case BinaryPatchOp::Insert:
+			bytes = reader.ReadBytes(reader.ReadUInt64());
+			break;
+
+		default:
+			throw std::runtime_error(mh::format("Unknown binary patch op {}", uint8_t(op)));
+		}
+
+		if (bytes.size() > (targetSize - target.size()))
+			throw std::runtime_error(mh::format("Binary patch overflows its target size of {} bytes", targetSize));
+
+		target.append(bytes);
+	}
+
+	if (target.size() != targetSize)
+	{
+		throw std::runtime_error(mh::format("Binary patch produced {} bytes instead of {}",
+			target.size(), targetSize));
+	}
+
+	return target;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	// Binary diffs for delta updates, produced by the release tooling. All integers are little endian:
+	//   8 byte magic, uint64 target size
+	// followed by ops until the end of the patch, each a uint8 BinaryPatchOp and
+	//   Copy:   uint64 source offset, uint64 length
+	//   Insert: uint64 length, then that many bytes
+	// Patches are shipped inside a zip, which takes care of compressing the inserted bytes.
+	enum class BinaryPatchOp : uint8_t
+	{
+		Copy,
+		Insert,
+	};
+
+	inline constexpr char BINARY_PATCH_MAGIC[8] = { 'T', 'F', 'B', 'D', 'P', 'A', 'T', '1' };
+
+	// Throws std::runtime_error if the patch is malformed, reaches outside of source, or doesn't
+	// produce exactly the target size.
+	std::string ApplyBinaryPatch(const std::string_view& source, const std::string_view& patch);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <system_error>
+
+namespace tf2_bot_detector
+{
+	// Thrown by work that noticed its CancellationToken was cancelled
+	class OperationCanceledError final : public std::system_error
+	{
+	public:
+		OperationCanceledError() : std::system_error(std::make_error_code(std::errc::operation_canceled)) {}
+	};
+
+	// Tells async work that nobody wants its result anymore. Only looked at where the work is about
+	// to do something expensive (like send a request), so anything already past that point still
+	// finishes. A default constructed token is never cancelled.
+	class CancellationToken final
+	{
+	public:
+		CancellationToken() = default;
+
+		bool IsCancelled() const { return m_Cancelled && m_Cancelled->load(std::memory_order_relaxed); }
+		void ThrowIfCancelled() const
+		{
+			if (IsCancelled())
+				throw OperationCanceledError();
+		}
+
+	private:
+		friend class CancellationSource;
+		explicit CancellationToken(std::shared_ptr<const std::atomic_bool> cancelled) : m_Cancelled(std::move(cancelled)) {}
+
+		std::shared_ptr<const std::atomic_bool> m_Cancelled;
+	};
+
+	class CancellationSource final
+	{
+	public:
+		CancellationToken GetToken() const { return CancellationToken(m_Cancelled); }
+
+		// Cancels every token handed out so far. Tokens handed out afterwards start out cancelled too,
+		// so replace the source if there's going to be more work that should go ahead.
+		void Cancel() { m_Cancelled->store(true, std::memory_order_relaxed); }
+		bool IsCancelled() const { return m_Cancelled->load(std::memory_order_relaxed); }
+
+	private:
+		std::shared_ptr<std::atomic_bool> m_Cancelled = std::make_shared<std::atomic_bool>(false);
+	};
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	// Splits console input into statements the same way the engine does: statements end at an
+	// unquoted ';' or a newline, "//" comments out the rest of the line, and a statement's command
+	// is its first whitespace separated (or quoted) token.
+	class ConsoleCommandTokenizer final
+	{
+	public:
+		constexpr explicit ConsoleCommandTokenizer(const std::string_view& text) : m_Text(text) {}
+
+		// The command of the next non-empty statement, skipping over its arguments. Points into the
+		// original text.
+		constexpr std::optional<std::string_view> NextCommand()
+		{
+			while (m_Pos < m_Text.size())
+			{
+				const char c = m_Text[m_Pos];
+				if (IsSpace(c) || IsStatementEnd(c))
+				{
+					m_Pos++;
+				}
+				else if (IsCommentStart())
+				{
+					SkipToLineEnd();
+				}
+				else
+				{
+					const auto command = ReadToken();
+					SkipToStatementEnd();
+					if (!command.empty())
+						return command;
+				}
+			}
+
+			return std::nullopt;
+		}
+
+	private:
+		static constexpr bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+		static constexpr bool IsStatementEnd(char c) { return c == ';' || c == '\n'; }
+
+		constexpr bool IsCommentStart() const
+		{
+			return m_Text.substr(m_Pos).starts_with("//");
+		}
+
+		constexpr std::string_view ReadToken()
+		{
+			if (m_Text[m_Pos] == '"')
+			{
+				const size_t begin = ++m_Pos;
+				while (m_Pos < m_Text.size() && m_Text[m_Pos] != '"' && m_Text[m_Pos] != '\n')
+					m_Pos++;
+
+				const auto token = m_Text.substr(begin, m_Pos - begin);
+				if (m_Pos < m_Text.size() && m_Text[m_Pos] == '"')
+					m_Pos++;
+
+				return token;
+			}
+
+			const size_t begin = m_Pos;
+			while (m_Pos < m_Text.size() && !IsSpace(m_Text[m_Pos]) && !IsStatementEnd(m_Text[m_Pos]) &&
+				m_Text[m_Pos] != '"' && !IsCommentStart())
+			{
+				m_Pos++;
+			}
+
+			return m_Text.substr(begin, m_Pos - begin);
+		}
+
+		constexpr void SkipToStatementEnd()
+		{
+			bool quoted = false;
+			for (; m_Pos < m_Text.size(); m_Pos++)
+			{
+				const char c = m_Text[m_Pos];
+				if (c == '\n')
+					return;
+				else if (c == '"')
+					quoted = !quoted;
+				else if (!quoted && c == ';')
+					return;
+				else if (!quoted && IsCommentStart())
+					break;
+			}
+		}
+
+		constexpr void SkipToLineEnd()
+		{
+			while (m_Pos < m_Text.size() && m_Text[m_Pos] != '\n')
+				m_Pos++;
+		}
+
+		std::string_view m_Text;
+		size_t m_Pos = 0;
+	};
+}
@@ -0,0 +1,48 @@
+#include "DeferredInit.h"
+#include "Util/StartupTimeline.h"
+#include "Util/TaskScheduler.h"
+#include "Log.h"
+
+using namespace tf2_bot_detector;
+
+void DeferredInitQueue::Add(std::string name, Thread thread, std::function<void()> func)
+{
+	m_Items.push_back({ std::move(name), thread, std::move(func), m_PresentedFrameCount });
+}
+
+void DeferredInitQueue::Update()
+{
+	std::erase_if(m_BackgroundTasks, [](const mh::task<>& task) { return task.is_ready(); });
+
+	while (!m_Items.empty() && m_Items.front().m_AddedFrameCount < m_PresentedFrameCount)
+	{
+		auto item = std::move(m_Items.front());
+		m_Items.pop_front();
+
+		if (item.m_Thread == Thread::Background)
+		{
+			m_BackgroundTasks.push_back(RunInBackground(std::move(item)));
+			continue;
+		}
+
+		Run(item);
+		break;
+	}
+}
+
+void DeferredInitQueue::Run(const Item& item) try
+{
+	TF2BD_STARTUP_PHASE(item.m_Name);
+	DebugLog("Running deferred init: {}", item.m_Name);
+	item.m_Func();
+}
+catch (...)
+{
+	LogException(MH_SOURCE_LOCATION_CURRENT(), "Deferred init {} failed", item.m_Name);
+}
+
+mh::task<> DeferredInitQueue::RunInBackground(Item item)
+{
+	co_await TaskScheduler::Get().co_schedule(TaskLane::IO, TaskPriority::Low);
+	Run(item);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <mh/coroutine/task.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	// Startup work that doesn't need to be done before the UI comes up. Whatever everything else
+	// waits on (world state, console log parsing, moderation, RCON) should just be created up front.
+	//
+	// Items only start once a frame has been presented after they were added, and Update() starts
+	// at most one main thread item per call so no single frame has to do all of them.
+	class DeferredInitQueue final
+	{
+	public:
+		enum class Thread
+		{
+			Main,       // For anything that touches state owned by the main thread
+			Background, // Has to be safe to run concurrently with everything else
+		};
+
+		// Destroying the queue drops any items that haven't started yet, so main thread items can
+		// capture whatever owns the queue. Background items may still be running after that, so
+		// they shouldn't.
+		void Add(std::string name, Thread thread, std::function<void()> func);
+
+		void OnFramePresented() { m_PresentedFrameCount++; }
+		void Update();
+
+	private:
+		struct Item
+		{
+			std::string m_Name;
+			Thread m_Thread;
+			std::function<void()> m_Func;
+			uint64_t m_AddedFrameCount;
+		};
+
+		static void Run(const Item& item);
+		static mh::task<> RunInBackground(Item item);
+
+		std::deque<Item> m_Items;
+		std::vector<mh::task<>> m_BackgroundTasks;
+		uint64_t m_PresentedFrameCount = 0;
+	};
+}
@@ -0,0 +1,69 @@
+#include "InternedString.h"
+
+#include <mutex>
+#include <unordered_set>
+
+using namespace tf2_bot_detector;
+
+namespace
+{
+	struct StringHash
+	{
+		using is_transparent = void;
+		size_t operator()(const std::string_view& str) const { return std::hash<std::string_view>{}(str); }
+	};
+
+	class StringInterner final
+	{
+	public:
+		static StringInterner& Get()
+		{
+			static StringInterner s_Interner;
+			return s_Interner;
+		}
+
+		const std::string* Intern(const std::string_view& text)
+		{
+			std::lock_guard lock(m_Mutex);
+			if (auto found = m_Strings.find(text); found != m_Strings.end())
+				return &*found;
+
+			return &*m_Strings.emplace(text).first;
+		}
+
+		const std::string* Find(const std::string_view& text) const
+		{
+			std::lock_guard lock(m_Mutex);
+			if (auto found = m_Strings.find(text); found != m_Strings.end())
+				return &*found;
+
+			return nullptr;
+		}
+
+	private:
+		mutable std::mutex m_Mutex;
+
+		// Node based, so the strings never move once they're in here
+		std::unordered_set<std::string, StringHash, std::equal_to<>> m_Strings;
+	};
+}
+
+const std::string InternedString::EMPTY;
+
+InternedString::InternedString(const std::string_view& text)
+{
+	// Everything empty shares the default constructed copy
+	if (!text.empty())
+		m_String = StringInterner::Get().Intern(text);
+}
+
+std::optional<InternedString> InternedString::Find(const std::string_view& text)
+{
+	if (text.empty())
+		return InternedString();
+
+	if (auto found = StringInterner::Get().Find(text))
+		return InternedString(found);
+
+	return std::nullopt;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <compare>
+#include <functional>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	// A handle to one copy of some text, shared by everything else in the process with the same
+	// text. Player names get copied around constantly (every status update, chat message and kill
+	// notification), but there are only ever a few dozen of them, so they're kept once here instead.
+	// Two InternedStrings are equal exactly when they point at the same copy, so comparing and
+	// hashing them never touches the text.
+	//
+	// Interned text lives for the rest of the session. Only use this for text there's a bounded
+	// amount of. Safe to create from any thread.
+	class InternedString final
+	{
+	public:
+		InternedString() = default;
+		explicit InternedString(const std::string_view& text);
+
+		// The already interned copy of text, if there is one. Doesn't intern anything, so nothing that
+		// was ever interned can equal text if this returns nullopt.
+		static std::optional<InternedString> Find(const std::string_view& text);
+
+		const std::string& str() const { return *m_String; }
+		std::string_view view() const { return *m_String; }
+		const char* c_str() const { return m_String->c_str(); }
+		bool empty() const { return m_String->empty(); }
+		size_t size() const { return m_String->size(); }
+
+		operator const std::string&() const { return *m_String; }
+		operator std::string_view() const { return *m_String; }
+
+		bool operator==(const InternedString& other) const { return m_String == other.m_String; }
+		bool operator==(const std::string_view& other) const { return view() == other; }
+
+		// Ordered by text, so sorting is stable across sessions
+		std::strong_ordering operator<=>(const InternedString& other) const { return view() <=> other.view(); }
+
+		const void* GetHandle() const { return m_String; }
+
+	private:
+		explicit InternedString(const std::string* str) : m_String(str) {}
+
+		static const std::string EMPTY;
+		const std::string* m_String = &EMPTY;
+	};
+
+	template<typename CharT, typename Traits>
+	std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const InternedString& str)
+	{
+		return os << str.view();
+	}
+}
+
+template<>
+struct std::hash<tf2_bot_detector::InternedString>
+{
+	size_t operator()(const tf2_bot_detector::InternedString& str) const noexcept
+	{
+		return std::hash<const void*>{}(str.GetHandle());
+	}
+};
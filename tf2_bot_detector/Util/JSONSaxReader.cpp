@@ -0,0 +1,136 @@
+#include "JSONSaxReader.h"
+
+#include <algorithm>
+
+using namespace tf2_bot_detector;
+
+bool JSONSaxReader::Parse(const std::string_view& json)
+{
+	m_Path.clear();
+	m_CurrentKey.clear();
+	m_HasParseError = false;
+	m_StoppedEarly = false;
+
+	// Returning false from a handler is the only way to stop the parser
+	return nlohmann::json::sax_parse(json.begin(), json.end(), this) || m_StoppedEarly;
+}
+
+bool JSONSaxReader::null()
+{
+	return OnScalar(GetValueKey(), nullptr) && !m_StoppedEarly;
+}
+
+bool JSONSaxReader::boolean(bool val)
+{
+	return OnScalar(GetValueKey(), val) && !m_StoppedEarly;
+}
+
+bool JSONSaxReader::number_integer(number_integer_t val)
+{
+	return OnScalar(GetValueKey(), int64_t(val)) && !m_StoppedEarly;
+}
+
+bool JSONSaxReader::number_unsigned(number_unsigned_t val)
+{
+	return OnScalar(GetValueKey(), uint64_t(val)) && !m_StoppedEarly;
+}
+
+bool JSONSaxReader::number_float(number_float_t val, const string_t&)
+{
+	return OnScalar(GetValueKey(), double(val)) && !m_StoppedEarly;
+}
+
+bool JSONSaxReader::string(string_t& val)
+{
+	return OnScalar(GetValueKey(), std::string_view(val)) && !m_StoppedEarly;
+}
+
+bool JSONSaxReader::binary(binary_t&)
+{
+	return true; // Never produced when parsing text
+}
+
+bool JSONSaxReader::start_object(std::size_t)
+{
+	return StartContainer(false);
+}
+
+bool JSONSaxReader::key(string_t& val)
+{
+	m_CurrentKey = val;
+	return true;
+}
+
+bool JSONSaxReader::end_object()
+{
+	return EndContainer();
+}
+
+bool JSONSaxReader::start_array(std::size_t)
+{
+	return StartContainer(true);
+}
+
+bool JSONSaxReader::end_array()
+{
+	return EndContainer();
+}
+
+bool JSONSaxReader::parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&)
+{
+	m_HasParseError = true;
+	return false;
+}
+
+bool JSONSaxReader::IsPath(std::initializer_list<std::string_view> keys) const
+{
+	// The root container has no key of its own
+	if (m_Path.size() != keys.size() + 1)
+		return false;
+
+	return std::equal(keys.begin(), keys.end(), m_Path.begin() + 1,
+		[](const std::string_view& key, const Container& container) { return key == container.m_Key; });
+}
+
+bool JSONSaxReader::TryGetBool(const scalar_type& value, bool& out)
+{
+	if (auto b = std::get_if<bool>(&value))
+	{
+		out = *b;
+		return true;
+	}
+
+	return false;
+}
+
+bool JSONSaxReader::TryGetString(const scalar_type& value, std::string& out)
+{
+	if (auto str = std::get_if<std::string_view>(&value))
+	{
+		out = *str;
+		return true;
+	}
+
+	return false;
+}
+
+std::string_view JSONSaxReader::GetValueKey() const
+{
+	if (m_Path.empty() || m_Path.back().m_IsArray)
+		return {};
+
+	return m_CurrentKey;
+}
+
+bool JSONSaxReader::StartContainer(bool isArray)
+{
+	m_Path.push_back({ std::string(GetValueKey()), isArray });
+	return OnStartContainer(m_Path.back().m_Key, isArray) && !m_StoppedEarly;
+}
+
+bool JSONSaxReader::EndContainer()
+{
+	const bool result = OnEndContainer(m_Path.back().m_Key, m_Path.back().m_IsArray);
+	m_Path.pop_back();
+	return result && !m_StoppedEarly;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	// Walks a JSON document with nlohmann's SAX interface instead of building a DOM, for
+	// responses where we only want a few fields out of a large payload. Derived classes are
+	// handed each scalar along with the key it was stored under, and can ask for the keys of
+	// the containers it is nested inside.
+	class JSONSaxReader : public nlohmann::json_sax<nlohmann::json>
+	{
+	public:
+		using scalar_type = std::variant<std::nullptr_t, bool, int64_t, uint64_t, double, std::string_view>;
+
+		// False if the document was malformed (see HasParseError()), or a derived class rejected it.
+		// True if a derived class stopped early, whatever was after that point.
+		bool Parse(const std::string_view& json);
+		bool HasParseError() const { return m_HasParseError; }
+
+		bool null() override;
+		bool boolean(bool val) override;
+		bool number_integer(number_integer_t val) override;
+		bool number_unsigned(number_unsigned_t val) override;
+		bool number_float(number_float_t val, const string_t& s) override;
+		bool string(string_t& val) override;
+		bool binary(binary_t& val) override;
+		bool start_object(std::size_t elements) override;
+		bool key(string_t& val) override;
+		bool end_object() override;
+		bool start_array(std::size_t elements) override;
+		bool end_array() override;
+		bool parse_error(std::size_t position, const std::string& last_token,
+			const nlohmann::detail::exception& ex) override;
+
+	protected:
+		// key is empty for array elements. The path already includes a container when it is
+		// started, and still includes it when it is ended.
+		virtual bool OnScalar(const std::string_view& key, const scalar_type& value) = 0;
+		virtual bool OnStartContainer(const std::string_view& key, bool isArray) { return true; }
+		virtual bool OnEndContainer(const std::string_view& key, bool isArray) { return true; }
+
+		// True if the containers below the root were opened under exactly these keys, with an
+		// empty key for array elements. IsPath({ "players", "" }) matches each object in
+		// { "players": [ {...}, {...} ] }.
+		bool IsPath(std::initializer_list<std::string_view> keys) const;
+
+		// The number of containers the current value is in, including the root. Cheaper than
+		// IsPath() for telling the elements of a container apart from everything nested in them.
+		size_t GetDepth() const { return m_Path.size(); }
+
+		// Once everything needed has been read, skips the rest of the document
+		void StopParsing() { m_StoppedEarly = true; }
+
+		template<typename T>
+		static bool TryGetNumber(const scalar_type& value, T& out)
+		{
+			if (auto u = std::get_if<uint64_t>(&value))
+				out = T(*u);
+			else if (auto i = std::get_if<int64_t>(&value))
+				out = T(*i);
+			else
+				return false;
+
+			return true;
+		}
+
+		static bool TryGetBool(const scalar_type& value, bool& out);
+		static bool TryGetString(const scalar_type& value, std::string& out);
+
+	private:
+		struct Container
+		{
+			std::string m_Key;
+			bool m_IsArray;
+		};
+
+		std::string_view GetValueKey() const;
+		bool StartContainer(bool isArray);
+		bool EndContainer();
+
+		std::vector<Container> m_Path;
+		std::string m_CurrentKey;
+		bool m_HasParseError = false;
+		bool m_StoppedEarly = false;
+	};
+}
@@ -0,0 +1,183 @@
+#include "JSONUtils.h"
+
+using namespace std::string_view_literals;
+using namespace tf2_bot_detector;
+
+namespace
+{
+	class RootScanner final
+	{
+	public:
+		explicit RootScanner(const std::string_view& json) : m_Text(json)
+		{
+			// Some editors like to save a BOM
+			if (m_Text.starts_with("\xEF\xBB\xBF"sv))
+				m_Pos = 3;
+		}
+
+		std::optional<std::string> Find(const std::string_view& name)
+		{
+			if (!Consume('{'))
+				return std::nullopt;
+
+			if (Consume('}'))
+				return std::nullopt;
+
+			while (true)
+			{
+				std::string_view key;
+				if (!ReadStringToken(key) || !Consume(':'))
+					return std::nullopt;
+
+				SkipWhitespace();
+				if (DecodeString(key) == name)
+				{
+					std::string_view value;
+					if (!ReadStringToken(value))
+						return std::nullopt;
+
+					return DecodeString(value);
+				}
+
+				if (!SkipValue())
+					return std::nullopt;
+
+				if (!Consume(','))
+					return std::nullopt; // '}', or malformed. Either way it isn't in here.
+			}
+		}
+
+	private:
+		void SkipWhitespace()
+		{
+			while (m_Pos < m_Text.size())
+			{
+				const char c = m_Text[m_Pos];
+				if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+					break;
+
+				m_Pos++;
+			}
+		}
+
+		bool Consume(char c)
+		{
+			SkipWhitespace();
+			if (m_Pos >= m_Text.size() || m_Text[m_Pos] != c)
+				return false;
+
+			m_Pos++;
+			return true;
+		}
+
+		// The string including its quotes, still escaped
+		bool ReadStringToken(std::string_view& token)
+		{
+			SkipWhitespace();
+			const size_t start = m_Pos;
+			if (!SkipString())
+				return false;
+
+			token = m_Text.substr(start, m_Pos - start);
+			return true;
+		}
+
+		bool SkipString()
+		{
+			if (m_Pos >= m_Text.size() || m_Text[m_Pos] != '"')
+				return false;
+
+			for (m_Pos++; m_Pos < m_Text.size(); m_Pos++)
+			{
+				const char c = m_Text[m_Pos];
+				if (c == '\\')
+					m_Pos++;
+				else if (c == '"')
+				{
+					m_Pos++;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool SkipValue()
+		{
+			SkipWhitespace();
+			if (m_Pos >= m_Text.size())
+				return false;
+
+			const char first = m_Text[m_Pos];
+			if (first == '"')
+				return SkipString();
+
+			if (first == '{' || first == '[')
+			{
+				// Only the brackets and strings (which might have brackets in them) matter in here
+				size_t depth = 0;
+				while (m_Pos < m_Text.size())
+				{
+					const char c = m_Text[m_Pos];
+					if (c == '"')
+					{
+						if (!SkipString())
+							return false;
+
+						continue;
+					}
+
+					if (c == '{' || c == '[')
+						depth++;
+					else if ((c == '}' || c == ']') && --depth == 0)
+					{
+						m_Pos++;
+						return true;
+					}
+
+					m_Pos++;
+				}
+
+				return false;
+			}
+
+			// Numbers, true, false, null
+			const size_t start = m_Pos;
+			while (m_Pos < m_Text.size())
+			{
+				const char c = m_Text[m_Pos];
+				if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' || c == '\n' || c == '\r')
+					break;
+
+				m_Pos++;
+			}
+
+			return m_Pos > start;
+		}
+
+		static std::string DecodeString(const std::string_view& token)
+		{
+			const auto contents = token.substr(1, token.size() - 2);
+			if (contents.find('\\') == contents.npos)
+				return std::string(contents);
+
+			// Rare enough to not be worth decoding ourselves
+			try
+			{
+				return nlohmann::json::parse(token).get<std::string>();
+			}
+			catch (const nlohmann::json::exception&)
+			{
+				return {};
+			}
+		}
+
+		std::string_view m_Text;
+		size_t m_Pos = 0;
+	};
+}
+
+std::optional<std::string> tf2_bot_detector::try_find_root_string(const std::string_view& json, const std::string_view& name)
+{
+	return RootScanner(json).Find(name);
+}
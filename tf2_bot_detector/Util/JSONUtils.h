@@ -6,6 +6,7 @@
 #include <nlohmann/json.hpp>
 
 #include <optional>
+#include <string>
 #include <string_view>
 
 namespace std
@@ -216,6 +217,12 @@ namespace tf2_bot_detector
 		value.reset();
 		return false;
 	}
+
+	// Reads one string property of the root object straight from the text, skipping over everything
+	// else without parsing it, for when that's all that's needed to decide what to do with a file
+	// (like its $schema). nullopt if the property isn't there, isn't a string, or the text is too
+	// malformed to find it. Doesn't check the rest of the document is valid.
+	std::optional<std::string> try_find_root_string(const std::string_view& json, const std::string_view& name);
 }
 
 MH_ENUM_REFLECT_BEGIN(nlohmann::json::value_t)
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace tf2_bot_detector
+{
+	// Bounded lock-free queue for any number of producer threads and a single consumer thread.
+	// Each slot carries a sequence number saying whose turn it is, so producers only contend on
+	// one atomic increment and never wait on each other or on the consumer. TCapacity must be a
+	// power of two.
+	template<typename T, size_t TCapacity>
+	class MPSCQueue final
+	{
+		static_assert(TCapacity > 1 && (TCapacity & (TCapacity - 1)) == 0, "TCapacity must be a power of two");
+
+	public:
+		static constexpr size_t CAPACITY = TCapacity;
+
+		MPSCQueue()
+		{
+			for (size_t i = 0; i < CAPACITY; i++)
+				m_Slots[i].m_Sequence.store(i, std::memory_order_relaxed);
+		}
+		MPSCQueue(const MPSCQueue&) = delete;
+		MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+		// Safe to call from any thread. Returns false (leaving value alone) if the queue is full.
+		bool try_push(T& value)
+		{
+			size_t pos = m_PushPos.load(std::memory_order_relaxed);
+			Slot* slot;
+			while (true)
+			{
+				slot = &m_Slots[pos & (CAPACITY - 1)];
+				const size_t seq = slot->m_Sequence.load(std::memory_order_acquire);
+				const auto diff = ptrdiff_t(seq) - ptrdiff_t(pos);
+
+				if (diff == 0)
+				{
+					if (m_PushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					return false; // The consumer hasn't gotten to this slot since the last time around
+				}
+				else
+				{
+					pos = m_PushPos.load(std::memory_order_relaxed);
+				}
+			}
+
+			slot->m_Value = std::move(value);
+			slot->m_Sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Only ever call from the one consumer thread
+		std::optional<T> try_pop()
+		{
+			Slot& slot = m_Slots[m_PopPos & (CAPACITY - 1)];
+			if (slot.m_Sequence.load(std::memory_order_acquire) != m_PopPos + 1)
+				return std::nullopt; // Empty, or a producer is still writing it
+
+			std::optional<T> retVal(std::move(slot.m_Value));
+			slot.m_Value = T{};
+			slot.m_Sequence.store(m_PopPos + CAPACITY, std::memory_order_release);
+			m_PopPos++;
+			return retVal;
+		}
+
+	private:
+		struct Slot
+		{
+			std::atomic<size_t> m_Sequence;
+			T m_Value{};
+		};
+
+		std::array<Slot, CAPACITY> m_Slots;
+		alignas(64) std::atomic<size_t> m_PushPos = 0;
+		alignas(64) size_t m_PopPos = 0;
+	};
+}
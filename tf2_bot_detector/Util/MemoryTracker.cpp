@@ -0,0 +1,146 @@
+#include "MemoryTracker.h"
+#include "PoolAllocator.h"
+
+#include <array>
+#include <atomic>
+
+#ifdef TF2BD_USE_MIMALLOC
+#include <mimalloc.h>
+#endif
+
+using namespace tf2_bot_detector;
+
+namespace
+{
+	struct CategoryCounters
+	{
+		std::atomic<int64_t> m_LiveCount = 0;
+		std::atomic<int64_t> m_LiveBytes = 0;
+		std::atomic<uint64_t> m_TotalCount = 0;
+		std::atomic<uint64_t> m_TotalBytes = 0;
+	};
+
+	std::atomic_bool s_IsEnabled = false;
+	std::array<CategoryCounters, size_t(MemoryCategory::COUNT)> s_Counters;
+}
+
+bool MemoryTracker::IsEnabled()
+{
+	return s_IsEnabled.load(std::memory_order_relaxed);
+}
+
+void MemoryTracker::SetEnabled(bool enabled)
+{
+	s_IsEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+MemoryUsage MemoryTracker::GetUsage(MemoryCategory category)
+{
+	// Console lines all come from the pool allocator, which keeps its own (always on) counts
+	// under the lock it already takes
+	if (category == MemoryCategory::ConsoleLines)
+	{
+		const auto pool = detail::GetPoolUsage();
+		return MemoryUsage
+		{
+			.m_LiveCount = int64_t(pool.m_LiveBlocks),
+			.m_LiveBytes = int64_t(pool.m_LiveBytes),
+			.m_TotalCount = pool.m_TotalBlocks,
+			.m_TotalBytes = pool.m_TotalBytes,
+		};
+	}
+
+	const auto& counters = s_Counters[size_t(category)];
+	return MemoryUsage
+	{
+		.m_LiveCount = counters.m_LiveCount.load(std::memory_order_relaxed),
+		.m_LiveBytes = counters.m_LiveBytes.load(std::memory_order_relaxed),
+		.m_TotalCount = counters.m_TotalCount.load(std::memory_order_relaxed),
+		.m_TotalBytes = counters.m_TotalBytes.load(std::memory_order_relaxed),
+	};
+}
+
+auto MemoryTracker::GetHeapStats() -> std::optional<HeapStats>
+{
+#ifdef TF2BD_USE_MIMALLOC
+	size_t elapsedMS, userMS, systemMS;
+	HeapStats stats;
+	mi_process_info(&elapsedMS, &userMS, &systemMS, &stats.m_RSSBytes, &stats.m_PeakRSSBytes,
+		&stats.m_CommittedBytes, &stats.m_PeakCommittedBytes, &stats.m_PageFaults);
+	return stats;
+#else
+	return std::nullopt;
+#endif
+}
+
+void MemoryTracker::CollectHeap()
+{
+#ifdef TF2BD_USE_MIMALLOC
+	mi_collect(true);
+#endif
+}
+
+TrackedMemory::TrackedMemory(MemoryCategory category, size_t bytes) :
+	m_Category(category), m_Bytes(bytes)
+{
+	Track();
+}
+
+TrackedMemory& TrackedMemory::operator=(const TrackedMemory& other)
+{
+	if (this != &other)
+	{
+		Untrack();
+		m_Category = other.m_Category;
+		m_Bytes = other.m_Bytes;
+		Track();
+	}
+
+	return *this;
+}
+
+TrackedMemory::~TrackedMemory()
+{
+	Untrack();
+}
+
+void TrackedMemory::SetBytes(size_t bytes)
+{
+	if (!m_IsTracked)
+	{
+		m_Bytes = bytes;
+		Track();
+		return;
+	}
+
+	auto& counters = s_Counters[size_t(m_Category)];
+	counters.m_LiveBytes.fetch_add(int64_t(bytes) - int64_t(m_Bytes), std::memory_order_relaxed);
+	if (bytes > m_Bytes)
+		counters.m_TotalBytes.fetch_add(bytes - m_Bytes, std::memory_order_relaxed);
+
+	m_Bytes = bytes;
+}
+
+void TrackedMemory::Track()
+{
+	if (!MemoryTracker::IsEnabled())
+		return;
+
+	auto& counters = s_Counters[size_t(m_Category)];
+	counters.m_LiveCount.fetch_add(1, std::memory_order_relaxed);
+	counters.m_LiveBytes.fetch_add(int64_t(m_Bytes), std::memory_order_relaxed);
+	counters.m_TotalCount.fetch_add(1, std::memory_order_relaxed);
+	counters.m_TotalBytes.fetch_add(m_Bytes, std::memory_order_relaxed);
+	m_IsTracked = true;
+}
+
+void TrackedMemory::Untrack()
+{
+	if (!m_IsTracked)
+		return;
+
+	auto& counters = s_Counters[size_t(m_Category)];
+	counters.m_LiveCount.fetch_sub(1, std::memory_order_relaxed);
+	counters.m_LiveBytes.fetch_sub(int64_t(m_Bytes), std::memory_order_relaxed);
+	m_IsTracked = false;
+}
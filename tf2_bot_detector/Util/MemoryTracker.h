@@ -0,0 +1,90 @@
+#pragma once
+
+#include <mh/reflection/enum.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace tf2_bot_detector
+{
+	enum class MemoryCategory
+	{
+		ConsoleLines,
+		PlayerData,
+		Textures,
+		HTTPResponses,
+		ConfigJSON,
+		LogBuffers,
+
+		COUNT,
+	};
+
+	struct MemoryUsage
+	{
+		int64_t m_LiveCount = 0;
+		int64_t m_LiveBytes = 0;
+		uint64_t m_TotalCount = 0;  // Everything ever counted, including what has since been freed
+		uint64_t m_TotalBytes = 0;
+	};
+
+	// Opt-in accounting of the memory held by each subsystem, to track down where a long-running
+	// instance is growing. Off by default, where TrackedMemory costs a single relaxed load.
+	namespace MemoryTracker
+	{
+		bool IsEnabled();
+		void SetEnabled(bool enabled);
+
+		MemoryUsage GetUsage(MemoryCategory category);
+
+		// What the allocator itself reports. Only built with TF2BD_USE_MIMALLOC, the default heap
+		// has nothing cheap enough to ask every frame.
+		struct HeapStats
+		{
+			size_t m_CommittedBytes = 0;
+			size_t m_PeakCommittedBytes = 0;
+			size_t m_RSSBytes = 0;
+			size_t m_PeakRSSBytes = 0;
+			size_t m_PageFaults = 0;
+		};
+		std::optional<HeapStats> GetHeapStats();
+
+		// Returns the allocator's free memory to the OS. Does nothing with the default heap, see
+		// Processes::TrimMemory() for that.
+		void CollectHeap();
+	}
+
+	// Counts an object (and an estimate of the bytes it holds) against a category for as long as
+	// it is alive. Only what was actually counted is removed again, so flipping tracking on and off
+	// never leaves the totals negative.
+	class TrackedMemory final
+	{
+	public:
+		explicit TrackedMemory(MemoryCategory category, size_t bytes = 0);
+		TrackedMemory(const TrackedMemory& other) : TrackedMemory(other.m_Category, other.m_Bytes) {}
+		TrackedMemory& operator=(const TrackedMemory& other);
+		~TrackedMemory();
+
+		size_t GetBytes() const { return m_Bytes; }
+
+		// Also starts counting this object if tracking was enabled since it was created
+		void SetBytes(size_t bytes);
+
+	private:
+		void Track();
+		void Untrack();
+
+		MemoryCategory m_Category;
+		bool m_IsTracked = false;
+		size_t m_Bytes = 0;
+	};
+}
+
+MH_ENUM_REFLECT_BEGIN(tf2_bot_detector::MemoryCategory)
+	MH_ENUM_REFLECT_VALUE(ConsoleLines)
+	MH_ENUM_REFLECT_VALUE(PlayerData)
+	MH_ENUM_REFLECT_VALUE(Textures)
+	MH_ENUM_REFLECT_VALUE(HTTPResponses)
+	MH_ENUM_REFLECT_VALUE(ConfigJSON)
+	MH_ENUM_REFLECT_VALUE(LogBuffers)
+MH_ENUM_REFLECT_END()
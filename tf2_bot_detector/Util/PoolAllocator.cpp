@@ -0,0 +1,118 @@
+#include "PoolAllocator.h"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace tf2_bot_detector;
+using namespace tf2_bot_detector::detail;
+
+namespace
+{
+	class FixedSizePool final
+	{
+	public:
+		void* Allocate(size_t blockSize)
+		{
+			std::lock_guard lock(m_Mutex);
+
+			if (!m_FreeList)
+				AddChunk(blockSize);
+
+			FreeBlock* block = m_FreeList;
+			m_FreeList = block->m_Next;
+			m_LiveBlocks++;
+			m_TotalBlocks++;
+			return block;
+		}
+
+		void Deallocate(void* ptr) noexcept
+		{
+			std::lock_guard lock(m_Mutex);
+
+			auto block = static_cast<FreeBlock*>(ptr);
+			block->m_Next = m_FreeList;
+			m_FreeList = block;
+			m_LiveBlocks--;
+		}
+
+		void AddUsage(PoolUsage& usage, size_t blockSize)
+		{
+			std::lock_guard lock(m_Mutex);
+			usage.m_LiveBlocks += m_LiveBlocks;
+			usage.m_LiveBytes += m_LiveBlocks * blockSize;
+			usage.m_TotalBlocks += m_TotalBlocks;
+			usage.m_TotalBytes += m_TotalBlocks * blockSize;
+		}
+
+	private:
+		static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+		struct FreeBlock
+		{
+			FreeBlock* m_Next;
+		};
+
+		void AddChunk(size_t blockSize)
+		{
+			const size_t blockCount = CHUNK_SIZE / blockSize;
+			auto& chunk = m_Chunks.emplace_back(std::make_unique<std::byte[]>(blockCount * blockSize));
+
+			for (size_t i = blockCount; i-- > 0; )
+			{
+				auto block = reinterpret_cast<FreeBlock*>(chunk.get() + i * blockSize);
+				block->m_Next = m_FreeList;
+				m_FreeList = block;
+			}
+		}
+
+		std::mutex m_Mutex;
+		FreeBlock* m_FreeList = nullptr;
+		std::vector<std::unique_ptr<std::byte[]>> m_Chunks;
+		size_t m_LiveBlocks = 0;
+		uint64_t m_TotalBlocks = 0;
+	};
+
+	constexpr size_t SIZE_CLASS_COUNT = POOL_MAX_SIZE / POOL_ALIGNMENT;
+
+	constexpr size_t GetSizeClass(size_t size)
+	{
+		return (size + POOL_ALIGNMENT - 1) / POOL_ALIGNMENT - 1;
+	}
+
+	std::array<FixedSizePool, SIZE_CLASS_COUNT>& GetPools()
+	{
+		// Intentionally leaked: objects from the pools may be freed during static destruction
+		static auto* s_Pools = new std::array<FixedSizePool, SIZE_CLASS_COUNT>();
+		return *s_Pools;
+	}
+}
+
+void* detail::PoolAllocate(size_t size)
+{
+	if (size == 0 || size > POOL_MAX_SIZE)
+		return ::operator new(size);
+
+	const size_t sizeClass = GetSizeClass(size);
+	return GetPools()[sizeClass].Allocate((sizeClass + 1) * POOL_ALIGNMENT);
+}
+
+void detail::PoolDeallocate(void* ptr, size_t size) noexcept
+{
+	if (size == 0 || size > POOL_MAX_SIZE)
+		return ::operator delete(ptr);
+
+	GetPools()[GetSizeClass(size)].Deallocate(ptr);
+}
+
+PoolUsage detail::GetPoolUsage()
+{
+	PoolUsage usage;
+
+	auto& pools = GetPools();
+	for (size_t i = 0; i < pools.size(); i++)
+		pools[i].AddUsage(usage, (i + 1) * POOL_ALIGNMENT);
+
+	return usage;
+}
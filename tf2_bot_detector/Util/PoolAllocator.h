@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace tf2_bot_detector
+{
+	namespace detail
+	{
+		// Thread-safe. Sizes above POOL_MAX_SIZE (or over-aligned types) go straight to operator new.
+		inline constexpr size_t POOL_ALIGNMENT = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+		inline constexpr size_t POOL_MAX_SIZE = 512;
+
+		void* PoolAllocate(size_t size);
+		void PoolDeallocate(void* ptr, size_t size) noexcept;
+
+		// Blocks handed out by the pools, in size class bytes. Always kept, the pools are locked anyway.
+		struct PoolUsage
+		{
+			size_t m_LiveBlocks = 0;
+			size_t m_LiveBytes = 0;
+			uint64_t m_TotalBlocks = 0;
+			uint64_t m_TotalBytes = 0;
+		};
+		PoolUsage GetPoolUsage();
+	}
+
+	// Allocates from process-wide free lists, one per 16-byte size class. Freed blocks are
+	// reused by later allocations of the same size class instead of going back to the heap,
+	// which keeps the huge number of short-lived, similar-sized objects (console lines) from
+	// churning and fragmenting the heap.
+	template<typename T>
+	class PoolAllocator
+	{
+	public:
+		using value_type = T;
+
+		PoolAllocator() = default;
+		template<typename T2>
+		PoolAllocator(const PoolAllocator<T2>&) noexcept {}
+
+		T* allocate(size_t count)
+		{
+			if constexpr (alignof(T) > detail::POOL_ALIGNMENT)
+				return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+			else
+				return static_cast<T*>(detail::PoolAllocate(count * sizeof(T)));
+		}
+		void deallocate(T* ptr, size_t count) noexcept
+		{
+			if constexpr (alignof(T) > detail::POOL_ALIGNMENT)
+				::operator delete(ptr, count * sizeof(T), std::align_val_t(alignof(T)));
+			else
+				detail::PoolDeallocate(ptr, count * sizeof(T));
+		}
+
+		template<typename T2>
+		bool operator==(const PoolAllocator<T2>&) const noexcept { return true; }
+	};
+}
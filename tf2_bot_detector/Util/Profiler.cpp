@@ -0,0 +1,144 @@
+#include "Profiler.h"
+#include "Log.h"
+
+#include <nlohmann/json.hpp>
+
+#include <bit>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+using namespace std::chrono_literals;
+using namespace tf2_bot_detector;
+
+auto Profiler::SectionStats::GetPercentile(float percentile) const -> clock_t::duration
+{
+	const auto target = uint32_t(m_Count * percentile);
+	uint32_t seen = 0;
+	for (size_t i = 0; i < m_Histogram.size(); i++)
+	{
+		seen += m_Histogram[i];
+		if (seen > target)
+			return std::min<clock_t::duration>(std::chrono::microseconds(uint64_t(1) << (i + 1)), m_Max);
+	}
+
+	return m_Max;
+}
+
+Profiler::Section::Section(const std::string_view& name) :
+	m_Name(name)
+{
+	GetInstance().AddSection(*this);
+}
+
+bool Profiler::IsStale(const Section& section, clock_t::time_point now)
+{
+	// Nothing was recorded for a while
+	return (now - section.m_CurrentStart) > 2s;
+}
+
+Profiler& Profiler::GetInstance()
+{
+	static Profiler s_Instance;
+	return s_Instance;
+}
+
+void Profiler::AddSection(Section& section)
+{
+	std::lock_guard lock(m_Mutex);
+	m_Sections.push_back(&section);
+}
+
+void Profiler::AddSample(Section& section, clock_t::time_point start, clock_t::time_point end)
+{
+	const auto duration = end - start;
+	const auto micros = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+
+	std::lock_guard lock(m_Mutex);
+
+	if ((end - section.m_CurrentStart) >= 1s)
+	{
+		section.m_LastSecond = section.m_Current;
+		section.m_Current = {};
+		section.m_CurrentStart = end;
+	}
+
+	const size_t bucket = std::min<size_t>(micros ? std::bit_width(micros) - 1 : 0, HISTOGRAM_BUCKET_COUNT - 1);
+	for (SectionStats* stats : { &section.m_Current, &section.m_SinceReset })
+	{
+		stats->m_Count++;
+		stats->m_Total += duration;
+		stats->m_Max = std::max(stats->m_Max, duration);
+		stats->m_Histogram[bucket]++;
+	}
+
+	if (m_IsRecordingTrace.load(std::memory_order_relaxed) && m_TraceEvents.size() < MAX_TRACE_EVENTS)
+	{
+		m_TraceEvents.push_back(TraceEvent{ &section,
+			uint32_t(std::hash<std::thread::id>{}(std::this_thread::get_id())), start, duration });
+	}
+}
+
+void Profiler::ResetTotals()
+{
+	std::lock_guard lock(m_Mutex);
+	for (Section* section : m_Sections)
+		section->m_SinceReset = {};
+}
+
+void Profiler::StartTrace()
+{
+	std::lock_guard lock(m_Mutex);
+	m_TraceEvents.clear();
+	m_TraceStart = clock_t::now();
+	m_IsRecordingTrace = true;
+}
+
+size_t Profiler::GetTraceEventCount() const
+{
+	std::lock_guard lock(m_Mutex);
+	return m_TraceEvents.size();
+}
+
+void Profiler::StopTrace(const std::filesystem::path& exportPath) try
+{
+	std::vector<TraceEvent> events;
+	clock_t::time_point traceStart;
+	{
+		std::lock_guard lock(m_Mutex);
+		m_IsRecordingTrace = false;
+		events = std::move(m_TraceEvents);
+		m_TraceEvents.clear();
+		traceStart = m_TraceStart;
+	}
+
+	const auto ToMicroseconds = [](clock_t::duration duration)
+	{
+		return std::chrono::duration<double, std::micro>(duration).count();
+	};
+
+	nlohmann::json traceEvents = nlohmann::json::array();
+	for (const auto& event : events)
+	{
+		traceEvents.push_back(nlohmann::json{
+			{ "name", event.m_Section->GetName() },
+			{ "ph", "X" },
+			{ "ts", ToMicroseconds(event.m_Start - traceStart) },
+			{ "dur", ToMicroseconds(event.m_Duration) },
+			{ "pid", 1 },
+			{ "tid", event.m_ThreadID },
+		});
+	}
+
+	std::ofstream file(exportPath, std::ios::binary | std::ios::trunc);
+	file << nlohmann::json{ { "traceEvents", std::move(traceEvents) } };
+
+	if (file.good())
+		Log("Wrote {} profiler trace events to {}", events.size(), exportPath);
+	else
+		LogError("Failed to write profiler trace to {}", exportPath);
+}
+catch (...)
+{
+	LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to export profiler trace");
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#ifndef TF2BD_ENABLE_PROFILER
+#define TF2BD_ENABLE_PROFILER 1
+#endif
+
+namespace tf2_bot_detector
+{
+	// Lightweight scoped timers for the per-frame subsystems. Each named section keeps a histogram
+	// of the last full second, and the whole thing can be recorded to a Chrome trace
+	// (chrome://tracing, or https://ui.perfetto.dev).
+	class Profiler final
+	{
+	public:
+		using clock_t = std::chrono::steady_clock;
+
+		static constexpr size_t HISTOGRAM_BUCKET_COUNT = 20; // Bucket n holds durations in [2^n, 2^(n+1)) microseconds
+		static constexpr size_t MAX_TRACE_EVENTS = 1'000'000;
+
+		struct SectionStats
+		{
+			uint32_t m_Count = 0;
+			clock_t::duration m_Total{};
+			clock_t::duration m_Max{};
+			std::array<uint32_t, HISTOGRAM_BUCKET_COUNT> m_Histogram{};
+
+			// Upper bound of the histogram bucket containing the given percentile (0-1)
+			clock_t::duration GetPercentile(float percentile) const;
+		};
+
+		class Section final
+		{
+		public:
+			explicit Section(const std::string_view& name);
+
+			const std::string_view& GetName() const { return m_Name; }
+
+		private:
+			friend class Profiler;
+
+			std::string_view m_Name;
+			SectionStats m_Current;
+			SectionStats m_LastSecond;
+			SectionStats m_SinceReset;
+			clock_t::time_point m_CurrentStart{};
+		};
+
+		class ScopedTimer final
+		{
+		public:
+			ScopedTimer(Section& section) : m_Section(section), m_Start(clock_t::now()) {}
+			~ScopedTimer() { GetInstance().AddSample(m_Section, m_Start, clock_t::now()); }
+
+			ScopedTimer(const ScopedTimer&) = delete;
+			ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+		private:
+			Section& m_Section;
+			clock_t::time_point m_Start;
+		};
+
+		static Profiler& GetInstance();
+
+		// Calls func(name, stats) with the stats for the last full second of each section
+		template<typename TFunc> void ForEachSection(TFunc&& func) const
+		{
+			std::lock_guard lock(m_Mutex);
+			const auto now = clock_t::now();
+			for (const Section* section : m_Sections)
+				func(section->GetName(), IsStale(*section, now) ? SectionStats{} : section->m_LastSecond);
+		}
+
+		// Calls func(name, stats) with everything since the last ResetTotals(), or since startup. For
+		// benchmarks, where the last second isn't enough to go on.
+		template<typename TFunc> void ForEachSectionTotal(TFunc&& func) const
+		{
+			std::lock_guard lock(m_Mutex);
+			for (const Section* section : m_Sections)
+				func(section->GetName(), section->m_SinceReset);
+		}
+		void ResetTotals();
+
+		bool IsRecordingTrace() const { return m_IsRecordingTrace.load(std::memory_order_relaxed); }
+		void StartTrace();
+		size_t GetTraceEventCount() const;
+
+		// Stops recording and writes everything recorded so far as Chrome trace event JSON
+		void StopTrace(const std::filesystem::path& exportPath);
+
+	private:
+		Profiler() = default;
+
+		void AddSection(Section& section);
+		static bool IsStale(const Section& section, clock_t::time_point now);
+		void AddSample(Section& section, clock_t::time_point start, clock_t::time_point end);
+
+		struct TraceEvent
+		{
+			const Section* m_Section;
+			uint32_t m_ThreadID;
+			clock_t::time_point m_Start;
+			clock_t::duration m_Duration;
+		};
+
+		mutable std::mutex m_Mutex;
+		std::vector<Section*> m_Sections;
+
+		std::atomic_bool m_IsRecordingTrace = false;
+		clock_t::time_point m_TraceStart{};
+		std::vector<TraceEvent> m_TraceEvents;
+	};
+}
+
+#if TF2BD_ENABLE_PROFILER
+#define TF2BD_PROFILE_CONCAT_IMPL(a, b) a ## b
+#define TF2BD_PROFILE_CONCAT(a, b) TF2BD_PROFILE_CONCAT_IMPL(a, b)
+
+// Times the rest of the enclosing scope under the given (string literal) section name
+#define TF2BD_PROFILE_SCOPE(name) \
+	static ::tf2_bot_detector::Profiler::Section TF2BD_PROFILE_CONCAT(s_ProfilerSection_, __LINE__)(name); \
+	const ::tf2_bot_detector::Profiler::ScopedTimer TF2BD_PROFILE_CONCAT(profilerTimer_, __LINE__)(TF2BD_PROFILE_CONCAT(s_ProfilerSection_, __LINE__))
+#else
+#define TF2BD_PROFILE_SCOPE(name)
+#endif
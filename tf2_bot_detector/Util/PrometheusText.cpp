@@ -0,0 +1,81 @@
+#include "PrometheusText.h"
+
+#include <mh/text/format.hpp>
+
+#include <cmath>
+
+using namespace tf2_bot_detector;
+
+static void AppendEscaped(std::string& out, const std::string_view& text, bool escapeQuotes)
+{
+	for (char c : text)
+	{
+		if (c == '\\')
+			out += "\\\\";
+		else if (c == '\n')
+			out += "\\n";
+		else if (c == '"' && escapeQuotes)
+			out += "\\\"";
+		else
+			out += c;
+	}
+}
+
+static void AppendLabel(std::string& out, bool& first, const std::string_view& name, const std::string_view& value)
+{
+	out += first ? '{' : ',';
+	first = false;
+
+	out += name;
+	out += "=\"";
+	AppendEscaped(out, value, true);
+	out += '"';
+}
+
+void PrometheusTextWriter::Add(const std::string_view& name, MetricType type, const std::string_view& help,
+	double value, Labels labels)
+{
+	auto found = m_Metrics.find(name);
+	if (found == m_Metrics.end())
+		found = m_Metrics.emplace(std::string(name), Metric{ .m_Type = type, .m_Help = std::string(help) }).first;
+
+	std::string& out = found->second.m_Samples;
+	out += name;
+
+	bool first = true;
+	for (const auto& [labelName, labelValue] : m_CommonLabels)
+		AppendLabel(out, first, labelName, labelValue);
+	for (const auto& [labelName, labelValue] : labels)
+		AppendLabel(out, first, labelName, labelValue);
+
+	if (!first)
+		out += '}';
+
+	// Counts are by far the most common, print them without any exponent or decimals
+	if (std::isnan(value))
+		out += " NaN\n";
+	else if (std::isinf(value))
+		out += value > 0 ? " +Inf\n" : " -Inf\n";
+	else if (value == std::trunc(value) && std::abs(value) < 1e15)
+		out += mh::format(" {}\n", int64_t(value));
+	else
+		out += mh::format(" {}\n", value);
+}
+
+std::string PrometheusTextWriter::GetText() const
+{
+	std::string text;
+	for (const auto& [name, metric] : m_Metrics)
+	{
+		text += "# HELP ";
+		text += name;
+		text += ' ';
+		AppendEscaped(text, metric.m_Help, false);
+		text += "\n# TYPE ";
+		text += name;
+		text += metric.m_Type == MetricType::Counter ? " counter\n" : " gauge\n";
+		text += metric.m_Samples;
+	}
+
+	return text;
+}
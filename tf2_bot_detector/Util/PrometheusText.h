@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	// Builds a file in the Prometheus text exposition format, the one node_exporter's textfile
+	// collector reads. Samples can be added in any order, they're grouped under one HELP/TYPE
+	// header per metric name when the text is built.
+	class PrometheusTextWriter final
+	{
+	public:
+		enum class MetricType
+		{
+			Counter,
+			Gauge,
+		};
+
+		using Labels = std::initializer_list<std::pair<std::string_view, std::string_view>>;
+
+		// Added in front of the labels of every sample after this, e.g. which session it came from
+		void SetCommonLabels(std::vector<std::pair<std::string, std::string>> labels) { m_CommonLabels = std::move(labels); }
+
+		// The type and help text of the first sample with a given name are the ones that are used
+		void Add(const std::string_view& name, MetricType type, const std::string_view& help, double value,
+			Labels labels = {});
+
+		std::string GetText() const;
+
+	private:
+		struct Metric
+		{
+			MetricType m_Type;
+			std::string m_Help;
+			std::string m_Samples;
+		};
+
+		std::vector<std::pair<std::string, std::string>> m_CommonLabels;
+		std::map<std::string, Metric, std::less<>> m_Metrics;
+	};
+}
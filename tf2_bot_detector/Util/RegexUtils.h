@@ -1,5 +1,7 @@
 #pragma once
 
+#include "StaticRegex.h"
+
 #include <mh/text/charconv_helper.hpp>
 #include <mh/text/format.hpp>
 
@@ -18,20 +20,42 @@ namespace tf2_bot_detector
 		return std::string_view(&*match.first, match.length());
 	}
 
+	inline constexpr std::string_view to_string_view(const static_regex::sub_match& match)
+	{
+		return match.view();
+	}
+
 	template<typename TIter, typename T>
 	inline auto from_chars(const std::sub_match<TIter>& match, T& out)
 	{
 		return mh::from_chars(to_string_view(match), out);
 	}
 
-	template<typename TIter, typename T, typename... TArgs>
-	inline void from_chars_throw(const std::sub_match<TIter>& match, T& out, TArgs&&... args)
+	template<typename T>
+	inline auto from_chars(const static_regex::sub_match& match, T& out)
+	{
+		return mh::from_chars(to_string_view(match), out);
+	}
+
+	template<typename T, typename... TArgs>
+	inline void from_chars_throw(const std::string_view& sv, T& out, TArgs&&... args)
 	{
-		const auto sv = to_string_view(match);
 		auto result = mh::from_chars(sv, out, std::forward<TArgs>(args)...);
 		if (!result)
 		{
 			throw std::runtime_error(mh::format("Failed to parse {} as {}", std::quoted(sv), typeid(T).name()));
 		}
 	}
+
+	template<typename TIter, typename T, typename... TArgs>
+	inline void from_chars_throw(const std::sub_match<TIter>& match, T& out, TArgs&&... args)
+	{
+		from_chars_throw(to_string_view(match), out, std::forward<TArgs>(args)...);
+	}
+
+	template<typename T, typename... TArgs>
+	inline void from_chars_throw(const static_regex::sub_match& match, T& out, TArgs&&... args)
+	{
+		from_chars_throw(to_string_view(match), out, std::forward<TArgs>(args)...);
+	}
 }
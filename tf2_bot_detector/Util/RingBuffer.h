@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+namespace tf2_bot_detector
+{
+	// Fixed-capacity FIFO stored contiguously. Once full, push_back() overwrites the oldest element.
+	// Indices run from the oldest element (0) to the newest (size() - 1).
+	template<typename T, size_t TCapacity>
+	class RingBuffer final
+	{
+		static_assert(TCapacity > 0);
+
+	public:
+		static constexpr size_t CAPACITY = TCapacity;
+
+		constexpr size_t size() const { return m_Size; }
+		constexpr bool empty() const { return m_Size == 0; }
+		constexpr bool full() const { return m_Size == CAPACITY; }
+
+		T& operator[](size_t index) { return m_Elements[GetElementIndex(index)]; }
+		const T& operator[](size_t index) const { return m_Elements[GetElementIndex(index)]; }
+
+		T& front() { return (*this)[0]; }
+		const T& front() const { return (*this)[0]; }
+		T& back() { return (*this)[m_Size - 1]; }
+		const T& back() const { return (*this)[m_Size - 1]; }
+
+		T& push_back(T value)
+		{
+			T* element;
+			if (full())
+			{
+				element = &m_Elements[m_Begin];
+				m_Begin = (m_Begin + 1) % CAPACITY;
+			}
+			else
+			{
+				element = &m_Elements[(m_Begin + m_Size) % CAPACITY];
+				m_Size++;
+			}
+
+			*element = std::move(value);
+			return *element;
+		}
+
+		void clear()
+		{
+			for (size_t i = 0; i < m_Size; i++)
+				(*this)[i] = T{};
+
+			m_Begin = m_Size = 0;
+		}
+
+	private:
+		constexpr size_t GetElementIndex(size_t index) const
+		{
+			assert(index < m_Size);
+			return (m_Begin + index) % CAPACITY;
+		}
+
+		std::array<T, CAPACITY> m_Elements{};
+		size_t m_Begin = 0;
+		size_t m_Size = 0;
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace tf2_bot_detector
+{
+	// Bounded, lock-free queue for handing values from exactly one producer thread to exactly one consumer thread.
+	template<typename T, size_t TCapacity>
+	class SPSCQueue final
+	{
+		static_assert(TCapacity > 0 && (TCapacity & (TCapacity - 1)) == 0, "Capacity must be a power of 2");
+
+	public:
+		static constexpr size_t CAPACITY = TCapacity;
+
+		// Producer only. Returns false (leaving value untouched) if the queue is full.
+		bool try_push(T&& value)
+		{
+			const size_t tail = m_Tail.load(std::memory_order_relaxed);
+			if (tail - m_Head.load(std::memory_order_acquire) >= CAPACITY)
+				return false;
+
+			m_Elements[tail & (CAPACITY - 1)] = std::move(value);
+			m_Tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only. Returns false if the queue is empty.
+		bool try_pop(T& value)
+		{
+			const size_t head = m_Head.load(std::memory_order_relaxed);
+			if (head == m_Tail.load(std::memory_order_acquire))
+				return false;
+
+			T& element = m_Elements[head & (CAPACITY - 1)];
+			value = std::move(element);
+			element = T{};
+			m_Head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		// Keep the producer's and consumer's indices on separate cache lines
+		static constexpr size_t CACHE_LINE_SIZE = 64;
+
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_Head = 0;
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_Tail = 0;
+		alignas(CACHE_LINE_SIZE) std::array<T, CAPACITY> m_Elements{};
+	};
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	// Text that is either a view into a shared, refcounted buffer (kept alive for as long as
+	// the view is) or an owned copy. Lets parsed lines reference the chunk they came from
+	// without a heap allocation per string.
+	class SharedStringView final
+	{
+	public:
+		SharedStringView() = default;
+		SharedStringView(std::string text) : m_Owned(std::move(text)) {}
+		SharedStringView(const char* text) : m_Owned(text) {}
+		SharedStringView(std::shared_ptr<const std::string> buffer, const std::string_view& view) :
+			m_Buffer(std::move(buffer)), m_View(view)
+		{
+		}
+
+		// Creates a view into buffer if there is one, otherwise an owned copy of view.
+		static SharedStringView Create(const std::shared_ptr<const std::string>* buffer, const std::string_view& view)
+		{
+			if (buffer && *buffer)
+				return SharedStringView(*buffer, view);
+
+			return SharedStringView(std::string(view));
+		}
+
+		std::string_view view() const { return m_Buffer ? m_View : std::string_view(m_Owned); }
+		operator std::string_view() const { return view(); }
+
+		bool IsShared() const { return !!m_Buffer; }
+
+		// Copies the text into owned storage and stops keeping the shared buffer alive.
+		void Materialize()
+		{
+			if (!m_Buffer)
+				return;
+
+			m_Owned.assign(m_View);
+			m_View = {};
+			m_Buffer.reset();
+		}
+
+	private:
+		std::shared_ptr<const std::string> m_Buffer;
+		std::string_view m_View;
+		std::string m_Owned;
+	};
+}
@@ -0,0 +1,57 @@
+#include "SimHash.h"
+
+#include <array>
+
+using namespace tf2_bot_detector;
+
+// splitmix64's finalizer, spreads a trigram over all 64 bits
+static constexpr uint64_t MixBits(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+uint64_t tf2_bot_detector::ComputeSimHash(const std::string_view& text)
+{
+	std::array<int32_t, 64> weights{};
+	const auto AddFeature = [&](uint64_t feature)
+	{
+		const uint64_t hash = MixBits(feature);
+		for (size_t bit = 0; bit < weights.size(); bit++)
+			weights[bit] += ((hash >> bit) & 1) ? 1 : -1;
+	};
+
+	// The last three characters we kept, rolled along one byte at a time
+	uint32_t window = 0;
+	size_t charCount = 0;
+	for (char ch : text)
+	{
+		uint8_t c = uint8_t(ch);
+		if (c >= 'A' && c <= 'Z')
+			c = uint8_t(c - 'A' + 'a');
+		else if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80))
+			continue;
+
+		window = ((window << 8) | c) & 0xFFFFFF;
+		if (++charCount >= 3)
+			AddFeature(window);
+	}
+
+	if (charCount == 0)
+		return 0;
+	else if (charCount < 3)
+		AddFeature(window | (uint64_t(charCount) << 32)); // Too short for a single trigram
+
+	uint64_t result = 0;
+	for (size_t bit = 0; bit < weights.size(); bit++)
+	{
+		if (weights[bit] > 0)
+			result |= uint64_t(1) << bit;
+	}
+
+	return result;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	// 64-bit SimHash over the character trigrams of some text. Messages that only differ by a few
+	// characters get fingerprints that only differ by a few bits, while unrelated messages differ
+	// in about half of them. Case, whitespace and punctuation are ignored.
+	uint64_t ComputeSimHash(const std::string_view& text);
+
+	constexpr unsigned GetSimHashDistance(uint64_t lhs, uint64_t rhs)
+	{
+		return unsigned(std::popcount(lhs ^ rhs));
+	}
+}
@@ -0,0 +1,220 @@
+#include "StartupTimeline.h"
+#include "Platform/Platform.h"
+#include "Log.h"
+
+#include <mh/text/format.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace tf2_bot_detector;
+
+namespace
+{
+	using steady_clock_t = std::chrono::steady_clock;
+
+	struct Phase
+	{
+		std::array<char, StartupTimeline::MAX_NAME_LENGTH + 1> m_Name{};
+		uint32_t m_ThreadID = 0;
+		steady_clock_t::time_point m_Begin{};
+		steady_clock_t::time_point m_End{};
+
+		// m_Name, m_ThreadID and m_Begin are only read once m_Begun is set, m_End once m_Ended is
+		std::atomic_bool m_Begun = false;
+		std::atomic_bool m_Ended = false;
+	};
+
+	// When our DLL was initialized, after everything it links against without delay loading
+	const steady_clock_t::time_point s_StartTime = steady_clock_t::now();
+
+	std::array<Phase, StartupTimeline::MAX_PHASES> s_Phases;
+	std::atomic<uint32_t> s_PhaseCount = 0;
+	std::atomic_bool s_IsComplete = false;
+
+	std::mutex s_TraceExportPathMutex;
+	std::filesystem::path s_TraceExportPath;
+
+	struct PhaseSnapshot
+	{
+		std::string_view m_Name;
+		uint32_t m_ThreadID;
+		uint32_t m_ThreadIndex; // In order of first appearance, so the main thread is usually 0
+		steady_clock_t::time_point m_Begin;
+		steady_clock_t::time_point m_End;
+		bool m_StillRunning;
+		size_t m_Depth = 0;
+	};
+}
+
+static double ToMilliseconds(steady_clock_t::duration duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+uint32_t StartupTimeline::BeginPhase(const std::string_view& name)
+{
+	if (s_IsComplete.load(std::memory_order_relaxed))
+		return INVALID_PHASE;
+
+	const uint32_t index = s_PhaseCount.fetch_add(1, std::memory_order_relaxed);
+	if (index >= MAX_PHASES)
+		return INVALID_PHASE;
+
+	auto& phase = s_Phases[index];
+	name.copy(phase.m_Name.data(), MAX_NAME_LENGTH);
+	phase.m_ThreadID = uint32_t(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+	phase.m_Begin = steady_clock_t::now();
+	phase.m_Begun.store(true, std::memory_order_release);
+
+	return index;
+}
+
+void StartupTimeline::EndPhase(uint32_t phase)
+{
+	if (phase >= MAX_PHASES)
+		return;
+
+	s_Phases[phase].m_End = steady_clock_t::now();
+	s_Phases[phase].m_Ended.store(true, std::memory_order_release);
+}
+
+bool StartupTimeline::IsComplete()
+{
+	return s_IsComplete.load(std::memory_order_relaxed);
+}
+
+void StartupTimeline::SetTraceExportPath(std::filesystem::path path)
+{
+	std::lock_guard lock(s_TraceExportPathMutex);
+	s_TraceExportPath = std::move(path);
+}
+
+static void ExportChromeTrace(const std::vector<PhaseSnapshot>& phases, const std::filesystem::path& path) try
+{
+	nlohmann::json traceEvents = nlohmann::json::array();
+	for (const auto& phase : phases)
+	{
+		auto& event = traceEvents.emplace_back(nlohmann::json{
+			{ "name", phase.m_Name },
+			{ "ph", "X" },
+			{ "ts", ToMilliseconds(phase.m_Begin - s_StartTime) * 1000 },
+			{ "dur", ToMilliseconds(phase.m_End - phase.m_Begin) * 1000 },
+			{ "pid", 1 },
+			{ "tid", phase.m_ThreadID },
+		});
+
+		if (phase.m_StillRunning)
+			event["args"]["still_running"] = true;
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file << nlohmann::json{ { "traceEvents", std::move(traceEvents) } };
+
+	if (file.good())
+		Log("Wrote startup trace to {}", path);
+	else
+		LogError("Failed to write startup trace to {}", path);
+}
+catch (...)
+{
+	LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to export startup trace");
+}
+
+void StartupTimeline::MarkComplete() try
+{
+	if (s_IsComplete.exchange(true))
+		return;
+
+	const auto completeTime = steady_clock_t::now();
+	const uint32_t phaseCount = s_PhaseCount.load();
+
+	std::vector<PhaseSnapshot> phases;
+	std::vector<uint32_t> threadIDs;
+	for (size_t i = 0; i < std::min<size_t>(phaseCount, MAX_PHASES); i++)
+	{
+		const auto& phase = s_Phases[i];
+		if (!phase.m_Begun.load(std::memory_order_acquire))
+			continue; // Raced with us
+
+		auto& snapshot = phases.emplace_back();
+		snapshot.m_Name = phase.m_Name.data();
+		snapshot.m_ThreadID = phase.m_ThreadID;
+		snapshot.m_Begin = phase.m_Begin;
+		snapshot.m_StillRunning = !phase.m_Ended.load(std::memory_order_acquire);
+		snapshot.m_End = snapshot.m_StillRunning ? completeTime : phase.m_End;
+	}
+
+	std::stable_sort(phases.begin(), phases.end(),
+		[](const PhaseSnapshot& a, const PhaseSnapshot& b) { return a.m_Begin < b.m_Begin; });
+
+	for (size_t i = 0; i < phases.size(); i++)
+	{
+		auto& phase = phases[i];
+
+		if (auto found = std::find(threadIDs.begin(), threadIDs.end(), phase.m_ThreadID); found != threadIDs.end())
+			phase.m_ThreadIndex = uint32_t(found - threadIDs.begin());
+		else
+		{
+			phase.m_ThreadIndex = uint32_t(threadIDs.size());
+			threadIDs.push_back(phase.m_ThreadID);
+		}
+
+		// Nested inside everything on the same thread that was still going when it started
+		for (size_t j = 0; j < i; j++)
+		{
+			if (phases[j].m_ThreadID == phase.m_ThreadID && phases[j].m_End >= phase.m_End)
+				phase.m_Depth++;
+		}
+	}
+
+	// Everything between the process being created and us being initialized, mostly the loader
+	// mapping and initializing DLLs. What's delay loaded doesn't show up here.
+	steady_clock_t::duration preInitTime{};
+	try
+	{
+		preInitTime = std::max(Processes::GetCurrentProcessUptime() - (steady_clock_t::now() - s_StartTime),
+			steady_clock_t::duration::zero());
+	}
+	catch (...)
+	{
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to get process uptime");
+	}
+
+	std::string msg = mh::format("Startup took {:.3f} seconds, plus {:.1f} ms loading the process before that. Start (ms), duration (ms), phase:",
+		ToMilliseconds(completeTime - s_StartTime) / 1000, ToMilliseconds(preInitTime));
+	for (const auto& phase : phases)
+	{
+		msg += mh::format("\n\t{:9.1f} {:9.1f}{} {:{}}{} (thread {})",
+			ToMilliseconds(phase.m_Begin - s_StartTime), ToMilliseconds(phase.m_End - phase.m_Begin),
+			phase.m_StillRunning ? "+" : " ", "", phase.m_Depth * 2, phase.m_Name, phase.m_ThreadIndex);
+	}
+
+	if (phaseCount > MAX_PHASES)
+		msg += mh::format("\n\t...and {} more that didn't fit", phaseCount - MAX_PHASES);
+	if (std::any_of(phases.begin(), phases.end(), [](const PhaseSnapshot& p) { return p.m_StillRunning; }))
+		msg += "\n\t(+ still running)";
+
+	Log(std::move(msg));
+
+	std::filesystem::path exportPath;
+	{
+		std::lock_guard lock(s_TraceExportPathMutex);
+		exportPath = s_TraceExportPath;
+	}
+
+	if (!exportPath.empty())
+		ExportChromeTrace(phases, exportPath);
+}
+catch (...)
+{
+	LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to summarize startup timeline");
+}
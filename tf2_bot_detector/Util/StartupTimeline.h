@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	// Begin/end times of each phase of startup, so slow cold starts show up in the log. Always on:
+	// recording a phase is a couple of atomics and a copy of its name into a fixed size table, and
+	// everything after MarkComplete() is ignored.
+	class StartupTimeline final
+	{
+	public:
+		static constexpr uint32_t INVALID_PHASE = uint32_t(-1);
+		static constexpr size_t MAX_PHASES = 256;
+		static constexpr size_t MAX_NAME_LENGTH = 63;
+
+		// Returns INVALID_PHASE if startup is already over or the table is full
+		static uint32_t BeginPhase(const std::string_view& name);
+		static void EndPhase(uint32_t phase);
+
+		static bool IsComplete();
+
+		// Ends the timeline and logs how long each phase took. Phases that haven't ended yet are
+		// listed as still running.
+		static void MarkComplete();
+
+		// If set, MarkComplete() also writes the timeline out as a Chrome trace (chrome://tracing,
+		// or https://ui.perfetto.dev)
+		static void SetTraceExportPath(std::filesystem::path path);
+
+		class ScopedPhase final
+		{
+		public:
+			explicit ScopedPhase(const std::string_view& name) : m_Phase(BeginPhase(name)) {}
+			~ScopedPhase() { EndPhase(m_Phase); }
+
+			ScopedPhase(const ScopedPhase&) = delete;
+			ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+		private:
+			uint32_t m_Phase;
+		};
+	};
+}
+
+#define TF2BD_STARTUP_PHASE_CONCAT_IMPL(a, b) a ## b
+#define TF2BD_STARTUP_PHASE_CONCAT(a, b) TF2BD_STARTUP_PHASE_CONCAT_IMPL(a, b)
+
+// Records the rest of the enclosing scope as a startup phase with the given name
+#define TF2BD_STARTUP_PHASE(name) \
+	const ::tf2_bot_detector::StartupTimeline::ScopedPhase TF2BD_STARTUP_PHASE_CONCAT(startupPhase_, __LINE__)(name)
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+// A tiny compile-time-specialized regex matcher. Patterns are built from constexpr combinators instead of
+// being parsed from a string at runtime, so each pattern becomes its own fully inlined matching function
+// with no allocations. Backtracking follows the same priority rules as ECMAScript std::regex (greedy and
+// lazy repetition, optional groups, alternation), so translated patterns produce identical captures.
+//
+//   // (\d+) ms : (.{1,32})
+//   static constexpr auto s_Regex = static_regex::regex(seq(
+//       static_regex::cap<1>(plus(digit)), lit(" ms : "), static_regex::cap<2>(repeat(dot, 1, 32))));
+//
+//   if (auto result = s_Regex.match(text))
+//       from_chars_throw(result[1], ping);
+namespace tf2_bot_detector::static_regex
+{
+	struct sub_match
+	{
+		std::string_view m_View;
+		bool matched = false;
+
+		constexpr size_t length() const { return m_View.size(); }
+		constexpr std::string_view view() const { return m_View; }
+		std::string str() const { return std::string(m_View); }
+	};
+
+	template<size_t TCaptureCount>
+	class match_results
+	{
+	public:
+		static constexpr size_t CAPTURE_COUNT = TCaptureCount;
+
+		constexpr explicit operator bool() const { return m_Captures[0].matched; }
+		constexpr const sub_match& operator[](size_t index) const { return m_Captures[index]; }
+		constexpr sub_match& operator[](size_t index) { return m_Captures[index]; }
+
+	private:
+		std::array<sub_match, TCaptureCount + 1> m_Captures{};
+	};
+
+	namespace detail
+	{
+		template<size_t TCaptureCount>
+		struct context
+		{
+			std::string_view m_Text;
+			match_results<TCaptureCount> m_Results;
+		};
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	// Character classes
+	////////////////////////////////////////////////////////////////////////////////
+
+	// .
+	struct dot_t
+	{
+		constexpr bool operator()(char c) const { return c != '\n' && c != '\r'; }
+	};
+	// (?:.|[\r\n])
+	struct any_char_t
+	{
+		constexpr bool operator()(char) const { return true; }
+	};
+	// \d
+	struct digit_t
+	{
+		constexpr bool operator()(char c) const { return c >= '0' && c <= '9'; }
+	};
+	// \s
+	struct space_t
+	{
+		constexpr bool operator()(char c) const
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+		}
+	};
+	// \S
+	struct non_space_t
+	{
+		constexpr bool operator()(char c) const { return !space_t{}(c); }
+	};
+	// \w
+	struct word_t
+	{
+		constexpr bool operator()(char c) const
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || digit_t{}(c) || c == '_';
+		}
+	};
+	// [0-9a-f]
+	struct hex_lower_t
+	{
+		constexpr bool operator()(char c) const { return digit_t{}(c) || (c >= 'a' && c <= 'f'); }
+	};
+	// [...], listing every member character
+	struct chars_t
+	{
+		std::string_view m_Chars;
+		constexpr bool operator()(char c) const { return m_Chars.find(c) != m_Chars.npos; }
+	};
+	// [^...]
+	struct not_chars_t
+	{
+		std::string_view m_Chars;
+		constexpr bool operator()(char c) const { return m_Chars.find(c) == m_Chars.npos; }
+	};
+	// A union of two character classes
+	template<typename TLeft, typename TRight>
+	struct either_t
+	{
+		TLeft m_Left;
+		TRight m_Right;
+		constexpr bool operator()(char c) const { return m_Left(c) || m_Right(c); }
+	};
+
+	inline constexpr dot_t dot{};
+	inline constexpr any_char_t any_char{};
+	inline constexpr digit_t digit{};
+	inline constexpr space_t space{};
+	inline constexpr non_space_t non_space{};
+	inline constexpr word_t word{};
+	inline constexpr hex_lower_t hex_lower{};
+	constexpr chars_t chars(std::string_view members) { return chars_t{ members }; }
+	constexpr not_chars_t not_chars(std::string_view members) { return not_chars_t{ members }; }
+	template<typename TLeft, typename TRight>
+	constexpr either_t<TLeft, TRight> either(TLeft left, TRight right) { return { left, right }; }
+
+	////////////////////////////////////////////////////////////////////////////////
+	// Pattern nodes. match() calls cont(newPos) for each way the node can match at pos,
+	// in priority order, and stops at the first continuation that succeeds.
+	////////////////////////////////////////////////////////////////////////////////
+
+	struct lit_t
+	{
+		static constexpr size_t CAPTURE_COUNT = 0;
+		std::string_view m_Text;
+
+		template<typename TCtx, typename TCont>
+		constexpr bool match(TCtx& ctx, size_t pos, TCont&& cont) const
+		{
+			if (ctx.m_Text.substr(pos).starts_with(m_Text))
+				return cont(pos + m_Text.size());
+
+			return false;
+		}
+	};
+
+	template<typename TClass>
+	struct repeat_t
+	{
+		static constexpr size_t CAPTURE_COUNT = 0;
+		TClass m_Class;
+		size_t m_Min;
+		size_t m_Max;
+		bool m_Greedy;
+
+		template<typename TCtx, typename TCont>
+		constexpr bool match(TCtx& ctx, size_t pos, TCont&& cont) const
+		{
+			const size_t maxCount = std::min(m_Max, ctx.m_Text.size() - pos);
+			size_t count = 0;
+			while (count < maxCount && m_Class(ctx.m_Text[pos + count]))
+				count++;
+
+			if (count < m_Min)
+				return false;
+
+			if (m_Greedy)
+			{
+				for (size_t i = count; ; i--)
+				{
+					if (cont(pos + i))
+						return true;
+					if (i == m_Min)
+						return false;
+				}
+			}
+			else
+			{
+				for (size_t i = m_Min; i <= count; i++)
+				{
+					if (cont(pos + i))
+						return true;
+				}
+
+				return false;
+			}
+		}
+	};
+
+	template<typename... TNodes>
+	struct seq_t
+	{
+		static constexpr size_t CAPTURE_COUNT = std::max({ size_t(0), TNodes::CAPTURE_COUNT... });
+		std::tuple<TNodes...> m_Nodes;
+
+		template<typename TCtx, typename TCont>
+		constexpr bool match(TCtx& ctx, size_t pos, TCont&& cont) const
+		{
+			return match_from<0>(ctx, pos, cont);
+		}
+
+	private:
+		template<size_t I, typename TCtx, typename TCont>
+		constexpr bool match_from(TCtx& ctx, size_t pos, TCont& cont) const
+		{
+			if constexpr (I == sizeof...(TNodes))
+			{
+				return cont(pos);
+			}
+			else
+			{
+				return std::get<I>(m_Nodes).match(ctx, pos, [&](size_t next)
+					{
+						return this->template match_from<I + 1>(ctx, next, cont);
+					});
+			}
+		}
+	};
+
+	template<typename TLeft, typename TRight>
+	struct alt_t
+	{
+		static constexpr size_t CAPTURE_COUNT = std::max(TLeft::CAPTURE_COUNT, TRight::CAPTURE_COUNT);
+		TLeft m_Left;
+		TRight m_Right;
+
+		template<typename TCtx, typename TCont>
+		constexpr bool match(TCtx& ctx, size_t pos, TCont&& cont) const
+		{
+			return m_Left.match(ctx, pos, cont) || m_Right.match(ctx, pos, cont);
+		}
+	};
+
+	template<typename TNode>
+	struct opt_t
+	{
+		static constexpr size_t CAPTURE_COUNT = TNode::CAPTURE_COUNT;
+		TNode m_Node;
+
+		template<typename TCtx, typename TCont>
+		constexpr bool match(TCtx& ctx, size_t pos, TCont&& cont) const
+		{
+			return m_Node.match(ctx, pos, cont) || cont(pos);
+		}
+	};
+
+	template<size_t TIndex, typename TNode>
+	struct cap_t
+	{
+		static_assert(TIndex > 0, "Capture 0 is reserved for the whole match");
+		static constexpr size_t CAPTURE_COUNT = std::max(TIndex, TNode::CAPTURE_COUNT);
+		TNode m_Node;
+
+		template<typename TCtx, typename TCont>
+		constexpr bool match(TCtx& ctx, size_t pos, TCont&& cont) const
+		{
+			return m_Node.match(ctx, pos, [&](size_t end)
+				{
+					const sub_match prev = ctx.m_Results[TIndex];
+					ctx.m_Results[TIndex] = sub_match{ ctx.m_Text.substr(pos, end - pos), true };
+					if (cont(end))
+						return true;
+
+					ctx.m_Results[TIndex] = prev;
+					return false;
+				});
+		}
+	};
+
+	template<typename TPattern>
+	class regex_t
+	{
+	public:
+		static constexpr size_t CAPTURE_COUNT = TPattern::CAPTURE_COUNT;
+
+		constexpr regex_t(TPattern pattern) : m_Pattern(pattern) {}
+
+		// Equivalent to std::regex_match: the entire text must match.
+		constexpr match_results<CAPTURE_COUNT> match(const std::string_view& text) const
+		{
+			detail::context<CAPTURE_COUNT> ctx{ text, {} };
+			if (m_Pattern.match(ctx, 0, [&](size_t end) { return end == text.size(); }))
+				ctx.m_Results[0] = sub_match{ text, true };
+
+			return ctx.m_Results;
+		}
+
+	private:
+		TPattern m_Pattern;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	// Builders
+	////////////////////////////////////////////////////////////////////////////////
+
+	constexpr lit_t lit(std::string_view text) { return lit_t{ text }; }
+
+	template<typename... TNodes>
+	constexpr seq_t<TNodes...> seq(TNodes... nodes) { return { std::tuple<TNodes...>(nodes...) }; }
+
+	template<typename TLeft, typename TRight>
+	constexpr alt_t<TLeft, TRight> alt(TLeft left, TRight right) { return { left, right }; }
+
+	template<typename TNode>
+	constexpr opt_t<TNode> opt(TNode node) { return { node }; }
+
+	template<size_t TIndex, typename TNode>
+	constexpr cap_t<TIndex, TNode> cap(TNode node) { return { node }; }
+
+	// X{min,max}
+	template<typename TClass>
+	constexpr repeat_t<TClass> repeat(TClass cl, size_t min, size_t max = size_t(-1)) { return { cl, min, max, true }; }
+	// X*
+	template<typename TClass>
+	constexpr repeat_t<TClass> star(TClass cl) { return { cl, 0, size_t(-1), true }; }
+	// X+
+	template<typename TClass>
+	constexpr repeat_t<TClass> plus(TClass cl) { return { cl, 1, size_t(-1), true }; }
+	// X*?
+	template<typename TClass>
+	constexpr repeat_t<TClass> lazy_star(TClass cl) { return { cl, 0, size_t(-1), false }; }
+	// A single character of the given class
+	template<typename TClass>
+	constexpr repeat_t<TClass> one(TClass cl) { return { cl, 1, 1, true }; }
+
+	template<typename TPattern>
+	constexpr regex_t<TPattern> regex(TPattern pattern) { return { pattern }; }
+}
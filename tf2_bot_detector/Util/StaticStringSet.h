@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	// A fixed set of strings with a collision-free hash table built at compile time, so lookups
+	// are one hash and one comparison, with no allocations or static initialization.
+	template<size_t N>
+	class StaticStringSet final
+	{
+	public:
+		consteval StaticStringSet(const std::string_view(&values)[N])
+		{
+			for (uint32_t seed = 0; seed < MAX_SEED_ATTEMPTS; seed++)
+			{
+				if (TryBuild(values, seed))
+					return;
+			}
+
+			throw std::logic_error("No collision-free seed found, duplicate values?");
+		}
+
+		constexpr bool contains(const std::string_view& value) const
+		{
+			const auto& slot = m_Table[Hash(value, m_Seed) & (TABLE_SIZE - 1)];
+			return slot.m_Occupied && slot.m_Value == value;
+		}
+
+		static constexpr size_t size() { return N; }
+
+	private:
+		static constexpr size_t TABLE_SIZE = std::bit_ceil(N * 2);
+		static constexpr uint32_t MAX_SEED_ATTEMPTS = 100'000;
+
+		// FNV-1a, with the seed mixed into the offset basis
+		static constexpr uint32_t Hash(const std::string_view& value, uint32_t seed)
+		{
+			uint32_t hash = 2166136261u ^ (seed * 16777619u);
+			for (char c : value)
+			{
+				hash ^= uint8_t(c);
+				hash *= 16777619u;
+			}
+
+			return hash;
+		}
+
+		constexpr bool TryBuild(const std::string_view(&values)[N], uint32_t seed)
+		{
+			m_Table = {};
+			m_Seed = seed;
+
+			for (const std::string_view& value : values)
+			{
+				auto& slot = m_Table[Hash(value, seed) & (TABLE_SIZE - 1)];
+				if (slot.m_Occupied)
+					return false;
+
+				slot = { value, true };
+			}
+
+			return true;
+		}
+
+		struct Slot
+		{
+			std::string_view m_Value;
+			bool m_Occupied = false;
+		};
+
+		std::array<Slot, TABLE_SIZE> m_Table{};
+		uint32_t m_Seed = 0;
+	};
+}
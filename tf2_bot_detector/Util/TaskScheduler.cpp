@@ -0,0 +1,326 @@
+#include "TaskScheduler.h"
+#include "Platform/Platform.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace tf2_bot_detector;
+
+using steady_clock = std::chrono::steady_clock;
+using Handle = std::coroutine_handle<>;
+
+struct TaskScheduler::Worker
+{
+	std::mutex m_Mutex;
+	std::deque<Handle> m_Local;  // Scheduled by this worker, newest at the back
+	std::thread m_Thread;
+
+	uint32_t m_AppliedPolicyVersion = 0;  // Only touched by the worker itself
+};
+
+struct TaskScheduler::Lane
+{
+	TaskLane m_ID{};
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_WorkAvailable;
+	std::array<std::deque<Handle>, size_t(TaskPriority::COUNT)> m_Queues;  // Guarded by m_Mutex
+	bool m_Stopping = false;                                               // Guarded by m_Mutex
+	TaskThreadPolicy m_Policy;                                             // Guarded by m_Mutex
+	std::atomic<uint32_t> m_PolicyVersion = 0;                             // Written under m_Mutex
+
+	std::vector<std::unique_ptr<Worker>> m_Workers;
+	std::atomic<size_t> m_LocalCount = 0;  // Sum of every worker's m_Local
+
+	std::atomic<size_t> m_QueueDepth = 0;
+	std::atomic<uint64_t> m_CompletedCount = 0;
+	std::atomic<int64_t> m_BusyNanoseconds = 0;
+
+	mutable std::mutex m_StatsMutex;
+	mutable steady_clock::time_point m_LastStatsTime = steady_clock::now();
+	mutable int64_t m_LastStatsBusyNanoseconds = 0;
+
+	bool HasSharedWork() const
+	{
+		return std::any_of(m_Queues.begin(), m_Queues.end(), [](const auto& queue) { return !queue.empty(); });
+	}
+
+	// Highest priority first, oldest first within a priority
+	Handle TryPopShared()
+	{
+		std::lock_guard lock(m_Mutex);
+		for (auto& queue : m_Queues)
+		{
+			if (!queue.empty())
+			{
+				const Handle handle = queue.front();
+				queue.pop_front();
+				return handle;
+			}
+		}
+
+		return {};
+	}
+
+	Handle TryPopLocal(Worker& worker)
+	{
+		std::lock_guard lock(worker.m_Mutex);
+		if (worker.m_Local.empty())
+			return {};
+
+		const Handle handle = worker.m_Local.back();
+		worker.m_Local.pop_back();
+		m_LocalCount--;
+		return handle;
+	}
+
+	Handle TrySteal(Worker& thief)
+	{
+		if (m_LocalCount == 0)
+			return {};
+
+		for (auto& victim : m_Workers)
+		{
+			if (victim.get() == &thief)
+				continue;
+
+			std::lock_guard lock(victim->m_Mutex);
+			if (!victim->m_Local.empty())
+			{
+				const Handle handle = victim->m_Local.front();
+				victim->m_Local.pop_front();
+				m_LocalCount--;
+				return handle;
+			}
+		}
+
+		return {};
+	}
+
+	void ApplyPolicy(Worker& worker)
+	{
+		TaskThreadPolicy policy;
+		{
+			std::lock_guard lock(m_Mutex);
+			policy = m_Policy;
+			worker.m_AppliedPolicyVersion = m_PolicyVersion;
+		}
+
+		Platform::SetCurrentThreadPriority(policy.m_LowPriority ? ThreadPriority::BelowNormal : ThreadPriority::Normal,
+			policy.m_LowPriority);
+		Platform::SetCurrentThreadAffinity(policy.m_AffinityMask);
+	}
+
+	void Run(Handle handle)
+	{
+		m_QueueDepth--;
+
+		const auto startTime = steady_clock::now();
+		handle.resume();
+		m_BusyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - startTime).count();
+
+		m_CompletedCount++;
+	}
+};
+
+static thread_local const void* t_CurrentLane = nullptr;
+static thread_local void* t_CurrentWorker = nullptr;
+
+static size_t GetDefaultThreadCount(TaskLane lane)
+{
+	const size_t hardwareThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	switch (lane)
+	{
+	case TaskLane::CPU:
+		// Leave the rest of the machine to the main thread and TF2
+		return std::clamp<size_t>(hardwareThreads / 2, 1, 4);
+	case TaskLane::IO:
+		// Mostly waiting, so a few more than the cpu lane is fine
+		return std::clamp<size_t>(hardwareThreads, 2, 4);
+	case TaskLane::DB:
+		return 1;
+	case TaskLane::Main:
+	case TaskLane::COUNT:
+		break;
+	}
+
+	return 0;
+}
+
+TaskScheduler& TaskScheduler::Get()
+{
+	static TaskScheduler s_Scheduler;
+	return s_Scheduler;
+}
+
+TaskScheduler::TaskScheduler()
+{
+	for (size_t i = 0; i < m_Lanes.size(); i++)
+	{
+		auto& lane = m_Lanes[i];
+		lane = std::make_unique<Lane>();
+		lane->m_ID = TaskLane(i);
+
+		const size_t threadCount = GetDefaultThreadCount(lane->m_ID);
+		for (size_t t = 0; t < threadCount; t++)
+			lane->m_Workers.push_back(std::make_unique<Worker>());
+
+		// Only start them once the worker list is complete, they steal from each other
+		for (auto& worker : lane->m_Workers)
+			worker->m_Thread = std::thread(&TaskScheduler::WorkerThreadFunc, std::ref(*lane), std::ref(*worker));
+
+		DebugLog("TaskScheduler: {} thread(s) for the {:v} lane", threadCount, mh::enum_fmt(lane->m_ID));
+	}
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	for (auto& lane : m_Lanes)
+	{
+		{
+			std::lock_guard lock(lane->m_Mutex);
+			lane->m_Stopping = true;
+		}
+
+		lane->m_WorkAvailable.notify_all();
+		for (auto& worker : lane->m_Workers)
+			worker->m_Thread.join();
+	}
+}
+
+void TaskScheduler::Post(TaskLane laneID, TaskPriority priority, Handle handle)
+{
+	auto& lane = *m_Lanes.at(size_t(laneID));
+	lane.m_QueueDepth++;
+
+	// Keep follow-up work on the same thread while it's hot in the cache; idle workers will steal it
+	if (priority == TaskPriority::Normal && t_CurrentLane == &lane && lane.m_Workers.size() > 1)
+	{
+		auto& worker = *static_cast<Worker*>(t_CurrentWorker);
+		{
+			std::lock_guard lock(worker.m_Mutex);
+			worker.m_Local.push_back(handle);
+			lane.m_LocalCount++;
+		}
+
+		// Any worker about to sleep has either seen the new count or is already waiting
+		{
+			std::lock_guard lock(lane.m_Mutex);
+		}
+		lane.m_WorkAvailable.notify_one();
+		return;
+	}
+
+	{
+		std::lock_guard lock(lane.m_Mutex);
+		lane.m_Queues[size_t(priority)].push_back(handle);
+	}
+	lane.m_WorkAvailable.notify_one();
+}
+
+void TaskScheduler::WorkerThreadFunc(Lane& lane, Worker& worker)
+{
+	t_CurrentLane = &lane;
+	t_CurrentWorker = &worker;
+
+	while (true)
+	{
+		if (worker.m_AppliedPolicyVersion != lane.m_PolicyVersion)
+			lane.ApplyPolicy(worker);
+
+		Handle handle = lane.TryPopLocal(worker);
+		if (!handle)
+			handle = lane.TryPopShared();
+		if (!handle)
+			handle = lane.TrySteal(worker);
+
+		if (handle)
+		{
+			lane.Run(handle);
+			continue;
+		}
+
+		std::unique_lock lock(lane.m_Mutex);
+		lane.m_WorkAvailable.wait(lock, [&] { return lane.m_Stopping || lane.HasSharedWork() || lane.m_LocalCount > 0 ||
+			worker.m_AppliedPolicyVersion != lane.m_PolicyVersion; });
+		if (lane.m_Stopping)
+			return;
+	}
+}
+
+void TaskScheduler::RunMainThreadTasks(steady_clock::duration budget)
+{
+	auto& lane = *m_Lanes[size_t(TaskLane::Main)];
+	const auto startTime = steady_clock::now();
+
+	// Always run at least one, so a slow task can't starve the rest forever
+	do
+	{
+		const Handle handle = lane.TryPopShared();
+		if (!handle)
+			break;
+
+		lane.Run(handle);
+
+	} while ((steady_clock::now() - startTime) < budget);
+}
+
+void TaskScheduler::SetThreadPolicy(const TaskThreadPolicy& policy)
+{
+	for (auto& lane : m_Lanes)
+	{
+		if (lane->m_Workers.empty())
+			continue;
+
+		{
+			std::lock_guard lock(lane->m_Mutex);
+			if (lane->m_Policy == policy)
+				continue;
+
+			lane->m_Policy = policy;
+			lane->m_PolicyVersion++;
+		}
+
+		lane->m_WorkAvailable.notify_all();
+	}
+}
+
+size_t TaskScheduler::GetThreadCount(TaskLane lane) const
+{
+	return m_Lanes.at(size_t(lane))->m_Workers.size();
+}
+
+size_t TaskScheduler::GetQueueDepth(TaskLane lane) const
+{
+	return m_Lanes.at(size_t(lane))->m_QueueDepth;
+}
+
+TaskLaneStats TaskScheduler::GetStats(TaskLane laneID) const
+{
+	const auto& lane = *m_Lanes.at(size_t(laneID));
+
+	TaskLaneStats stats;
+	stats.m_ThreadCount = lane.m_Workers.size();
+	stats.m_QueueDepth = lane.m_QueueDepth;
+	stats.m_CompletedCount = lane.m_CompletedCount;
+
+	std::lock_guard lock(lane.m_StatsMutex);
+	const auto now = steady_clock::now();
+	const int64_t busy = lane.m_BusyNanoseconds;
+	const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - lane.m_LastStatsTime).count();
+
+	// The main lane doesn't have threads of its own, report it as if it had one
+	const size_t threads = std::max<size_t>(stats.m_ThreadCount, 1);
+	if (elapsed > 0)
+		stats.m_Utilization = std::clamp(float(busy - lane.m_LastStatsBusyNanoseconds) / float(elapsed * threads), 0.0f, 1.0f);
+
+	lane.m_LastStatsTime = now;
+	lane.m_LastStatsBusyNanoseconds = busy;
+	return stats;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <mh/reflection/enum.hpp>
+
+#include <array>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace tf2_bot_detector
+{
+	enum class TaskLane : uint8_t
+	{
+		CPU,   // Parsing, rule evaluation, decoding. Kept small so we don't fight TF2 for cores.
+		IO,    // Anything that mostly blocks on files or the network
+		DB,    // The temp db. A single thread, so everything on it runs in order.
+		Main,  // Runs from TaskScheduler::RunMainThreadTasks(), once per frame
+
+		COUNT,
+	};
+
+	enum class TaskPriority : uint8_t
+	{
+		High,    // Something on screen is waiting for it
+		Normal,
+		Low,     // Only once nothing else is queued on the lane
+
+		COUNT,
+	};
+
+	struct TaskLaneStats
+	{
+		size_t m_ThreadCount = 0;
+		size_t m_QueueDepth = 0;       // Scheduled, but not started yet
+		uint64_t m_CompletedCount = 0; // Since startup
+		float m_Utilization = 0;       // 0-1, average busy time per thread since the last GetStats() for this lane
+	};
+
+	// How the worker threads of every lane but Main compete with TF2 for the CPU
+	struct TaskThreadPolicy
+	{
+		bool m_LowPriority = false;   // Below normal priority, and EcoQoS where the OS has it
+		uint64_t m_AffinityMask = 0;  // Logical cores they may run on, 0 for any of them
+
+		bool operator==(const TaskThreadPolicy&) const = default;
+	};
+
+	// One set of threads for all of our background work, split into lanes. co_await co_schedule()
+	// to move a coroutine onto a lane. Lanes with more than one thread steal work from each other's
+	// threads, and anything a lane's thread schedules onto its own lane stays on that thread unless
+	// someone else is idle.
+	class TaskScheduler final
+	{
+	public:
+		static TaskScheduler& Get();
+		~TaskScheduler();
+
+		auto co_schedule(TaskLane lane, TaskPriority priority = TaskPriority::Normal)
+		{
+			struct Awaitable
+			{
+				TaskScheduler* m_Scheduler;
+				TaskLane m_Lane;
+				TaskPriority m_Priority;
+
+				bool await_ready() const noexcept { return false; }
+				void await_suspend(std::coroutine_handle<> handle) const { m_Scheduler->Post(m_Lane, m_Priority, handle); }
+				void await_resume() const noexcept {}
+			};
+
+			return Awaitable{ this, lane, priority };
+		}
+
+		size_t GetThreadCount(TaskLane lane) const;
+		size_t GetQueueDepth(TaskLane lane) const;
+		TaskLaneStats GetStats(TaskLane lane) const;
+
+		// Each worker applies it to itself before its next task, idle ones are woken up for it.
+		// Cheap to call every frame, nothing happens unless it changed.
+		void SetThreadPolicy(const TaskThreadPolicy& policy);
+
+		// Runs main lane tasks, highest priority first, until the budget is used up. Whatever is
+		// left waits for the next call. Only call from the main thread.
+		void RunMainThreadTasks(std::chrono::steady_clock::duration budget);
+
+	private:
+		TaskScheduler();
+
+		struct Lane;
+		struct Worker;
+		void Post(TaskLane lane, TaskPriority priority, std::coroutine_handle<> handle);
+		static void WorkerThreadFunc(Lane& lane, Worker& worker);
+
+		std::array<std::unique_ptr<Lane>, size_t(TaskLane::COUNT)> m_Lanes;
+	};
+}
+
+MH_ENUM_REFLECT_BEGIN(tf2_bot_detector::TaskLane)
+	MH_ENUM_REFLECT_VALUE(CPU)
+	MH_ENUM_REFLECT_VALUE(IO)
+	MH_ENUM_REFLECT_VALUE(DB)
+	MH_ENUM_REFLECT_VALUE(Main)
+MH_ENUM_REFLECT_END()
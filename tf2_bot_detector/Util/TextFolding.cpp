@@ -0,0 +1,190 @@
+#include "TextFolding.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+using namespace tf2_bot_detector;
+
+namespace
+{
+	struct Fold
+	{
+		char32_t m_CodePoint;
+		char m_ASCII;
+	};
+
+	// Single lookalikes, sorted by code point
+	constexpr Fold SINGLE_FOLDS[] =
+	{
+		{ U'\u00A0', ' ' },
+		{ U'\u0262', 'g' }, { U'\u026A', 'i' }, { U'\u0274', 'n' }, { U'\u0280', 'r' }, { U'\u028F', 'y' },
+		{ U'\u0299', 'b' }, { U'\u029C', 'h' }, { U'\u029F', 'l' },
+
+		// Greek
+		{ U'\u0391', 'a' }, { U'\u0392', 'b' }, { U'\u0395', 'e' }, { U'\u0396', 'z' }, { U'\u0397', 'h' },
+		{ U'\u0399', 'i' }, { U'\u039A', 'k' }, { U'\u039C', 'm' }, { U'\u039D', 'n' }, { U'\u039F', 'o' },
+		{ U'\u03A1', 'p' }, { U'\u03A4', 't' }, { U'\u03A5', 'y' }, { U'\u03A7', 'x' }, { U'\u03B1', 'a' },
+		{ U'\u03B9', 'i' }, { U'\u03BA', 'k' }, { U'\u03BD', 'v' }, { U'\u03BF', 'o' }, { U'\u03C1', 'p' },
+
+		// Cyrillic
+		{ U'\u0405', 's' }, { U'\u0406', 'i' }, { U'\u0408', 'j' }, { U'\u0410', 'a' }, { U'\u0412', 'b' },
+		{ U'\u0415', 'e' }, { U'\u041A', 'k' }, { U'\u041C', 'm' }, { U'\u041D', 'h' }, { U'\u041E', 'o' },
+		{ U'\u0420', 'p' }, { U'\u0421', 'c' }, { U'\u0422', 't' }, { U'\u0423', 'y' }, { U'\u0425', 'x' },
+		{ U'\u0430', 'a' }, { U'\u0435', 'e' }, { U'\u043A', 'k' }, { U'\u043E', 'o' }, { U'\u0440', 'p' },
+		{ U'\u0441', 'c' }, { U'\u0443', 'y' }, { U'\u0445', 'x' }, { U'\u0455', 's' }, { U'\u0456', 'i' },
+		{ U'\u0458', 'j' }, { U'\u04AE', 'y' }, { U'\u04AF', 'y' }, { U'\u04CF', 'l' }, { U'\u0501', 'd' },
+		{ U'\u051B', 'q' }, { U'\u051D', 'w' },
+
+		// Small caps
+		{ U'\u1D00', 'a' }, { U'\u1D04', 'c' }, { U'\u1D05', 'd' }, { U'\u1D07', 'e' }, { U'\u1D0A', 'j' },
+		{ U'\u1D0B', 'k' }, { U'\u1D0D', 'm' }, { U'\u1D0F', 'o' }, { U'\u1D18', 'p' }, { U'\u1D1B', 't' },
+		{ U'\u1D1C', 'u' }, { U'\u1D20', 'v' }, { U'\u1D21', 'w' }, { U'\u1D22', 'z' },
+
+		{ U'\u202F', ' ' }, { U'\u205F', ' ' },
+
+		// Letterlike symbols
+		{ U'\u2102', 'c' }, { U'\u210A', 'g' }, { U'\u210B', 'h' }, { U'\u210C', 'h' }, { U'\u210D', 'h' },
+		{ U'\u210E', 'h' }, { U'\u2110', 'i' }, { U'\u2111', 'i' }, { U'\u2112', 'l' }, { U'\u2113', 'l' },
+		{ U'\u2115', 'n' }, { U'\u2119', 'p' }, { U'\u211A', 'q' }, { U'\u211B', 'r' }, { U'\u211C', 'r' },
+		{ U'\u211D', 'r' }, { U'\u2124', 'z' }, { U'\u212C', 'b' }, { U'\u212D', 'c' }, { U'\u212F', 'e' },
+		{ U'\u2130', 'e' }, { U'\u2131', 'f' }, { U'\u2133', 'm' }, { U'\u2134', 'o' }, { U'\u2139', 'i' },
+
+		{ U'\u3000', ' ' },
+		{ U'\uA731', 's' },
+	};
+
+	static_assert(std::is_sorted(std::begin(SINGLE_FOLDS), std::end(SINGLE_FOLDS),
+		[](const Fold& lhs, const Fold& rhs) { return lhs.m_CodePoint < rhs.m_CodePoint; }));
+
+	constexpr char FoldASCII(char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+	}
+
+	constexpr bool IsDropped(char32_t cp)
+	{
+		return cp == U'\u00AD' ||                   // soft hyphen
+			(cp >= U'\u0300' && cp <= U'\u036F') || // combining diacritical marks
+			cp == U'\u034F' || cp == U'\u180E' ||
+			(cp >= U'\u200B' && cp <= U'\u200F') || // zero width spaces/joiners, direction marks
+			(cp >= U'\u202A' && cp <= U'\u202E') || // direction embedding/override
+			(cp >= U'\u2060' && cp <= U'\u2064') ||
+			cp == U'\uFE0F' || cp == U'\uFEFF' ||
+			(cp >= U'\U000E0000' && cp <= U'\U000E007F'); // tags
+	}
+
+	// 0 if cp isn't folded to ASCII
+	constexpr char FoldCodePoint(char32_t cp)
+	{
+		// Fullwidth ASCII
+		if (cp >= U'\uFF01' && cp <= U'\uFF5E')
+			return FoldASCII(char(cp - U'\uFF01' + '!'));
+
+		// Mathematical alphanumeric symbols, 13 alphabets of A-Z a-z, then 5 sets of 0-9
+		if (cp >= U'\U0001D400' && cp <= U'\U0001D6A3')
+		{
+			const unsigned letter = unsigned(cp - U'\U0001D400') % 52;
+			return char(letter < 26 ? ('a' + letter) : ('a' + letter - 26));
+		}
+		if (cp >= U'\U0001D7CE' && cp <= U'\U0001D7FF')
+			return char('0' + unsigned(cp - U'\U0001D7CE') % 10);
+
+		// Circled letters
+		if (cp >= U'\u24B6' && cp <= U'\u24CF')
+			return char('a' + (cp - U'\u24B6'));
+		if (cp >= U'\u24D0' && cp <= U'\u24E9')
+			return char('a' + (cp - U'\u24D0'));
+
+		// Assorted width spaces
+		if (cp >= U'\u2000' && cp <= U'\u200A')
+			return ' ';
+
+		const auto found = std::lower_bound(std::begin(SINGLE_FOLDS), std::end(SINGLE_FOLDS), cp,
+			[](const Fold& fold, char32_t value) { return fold.m_CodePoint < value; });
+
+		if (found != std::end(SINGLE_FOLDS) && found->m_CodePoint == cp)
+			return found->m_ASCII;
+
+		return 0;
+	}
+
+	// Returns the length of the sequence at text[i], or 0 if it isn't valid UTF-8
+	size_t DecodeUTF8(const std::string_view& text, size_t i, char32_t& cp)
+	{
+		const auto lead = uint8_t(text[i]);
+		size_t length;
+		if (lead >= 0xF0 && lead <= 0xF4)
+		{
+			length = 4;
+			cp = lead & 0x07;
+		}
+		else if (lead >= 0xE0)
+		{
+			length = 3;
+			cp = lead & 0x0F;
+		}
+		else if (lead >= 0xC2 && lead <= 0xDF)
+		{
+			length = 2;
+			cp = lead & 0x1F;
+		}
+		else
+		{
+			return 0;
+		}
+
+		if (length > text.size() - i)
+			return 0;
+
+		for (size_t j = 1; j < length; j++)
+		{
+			const auto cont = uint8_t(text[i + j]);
+			if ((cont & 0xC0) != 0x80)
+				return 0;
+
+			cp = (cp << 6) | (cont & 0x3F);
+		}
+
+		// Overlong or out of range
+		if ((length == 3 && cp < 0x800) || (length == 4 && (cp < 0x10000 || cp > 0x10FFFF)))
+			return 0;
+
+		return length;
+	}
+}
+
+std::string tf2_bot_detector::FoldText(const std::string_view& text)
+{
+	std::string retVal;
+	retVal.reserve(text.size());
+
+	for (size_t i = 0; i < text.size(); )
+	{
+		if (uint8_t(text[i]) < 0x80)
+		{
+			retVal.push_back(FoldASCII(text[i]));
+			i++;
+			continue;
+		}
+
+		char32_t cp;
+		const size_t length = DecodeUTF8(text, i, cp);
+		if (length == 0)
+		{
+			// Not something we can fold, keep the byte as-is
+			retVal.push_back(text[i]);
+			i++;
+			continue;
+		}
+
+		if (const char folded = FoldCodePoint(cp))
+			retVal.push_back(folded);
+		else if (!IsDropped(cp))
+			retVal.append(text.substr(i, length));
+
+		i += length;
+	}
+
+	return retVal;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace tf2_bot_detector
+{
+	// Lowercases text and folds the lookalikes names most often use to dodge rules into the ASCII
+	// letters they're standing in for: fullwidth forms, Cyrillic and Greek homoglyphs, small caps,
+	// and the bold/italic/script "fonts" from the math and letterlike blocks. Invisible characters
+	// and combining marks are dropped, and the odd space characters become ' '. This is the subset
+	// of NFKC and the Unicode confusables table that shows up in practice, everything else is kept
+	// as-is. Two strings that fold to the same thing can be compared with plain ==/find().
+	std::string FoldText(const std::string_view& text);
+}
@@ -9,10 +9,96 @@
 #include <mh/text/string_insertion.hpp>
 
 #include <codecvt>
+#include <cstdint>
 #include <fstream>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TF2BD_TEXTUTILS_SSE2 1
+#include <emmintrin.h>
+#else
+#define TF2BD_TEXTUTILS_SSE2 0
+#endif
+
 using namespace std::string_literals;
 
+namespace
+{
+	constexpr char32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+	constexpr bool IsValidCodePoint(char32_t cp)
+	{
+		return cp <= 0x10FFFF && (cp < 0xD800 || cp > 0xDFFF);
+	}
+
+	// Advances i past one code point. Anything malformed decodes to U+FFFD, one byte at a time.
+	char32_t DecodeUTF8(const std::string_view& input, size_t& i)
+	{
+		const auto lead = uint8_t(input[i++]);
+		if (lead < 0x80)
+			return lead;
+
+		size_t length;
+		char32_t cp;
+		char32_t minCP;
+		if ((lead & 0xE0) == 0xC0)
+		{
+			length = 1;
+			cp = lead & 0x1F;
+			minCP = 0x80;
+		}
+		else if ((lead & 0xF0) == 0xE0)
+		{
+			length = 2;
+			cp = lead & 0x0F;
+			minCP = 0x800;
+		}
+		else if ((lead & 0xF8) == 0xF0)
+		{
+			length = 3;
+			cp = lead & 0x07;
+			minCP = 0x10000;
+		}
+		else
+		{
+			return REPLACEMENT_CHARACTER;
+		}
+
+		if ((input.size() - i) < length)
+			return REPLACEMENT_CHARACTER;
+
+		for (size_t n = 0; n < length; n++)
+		{
+			const auto c = uint8_t(input[i + n]);
+			if ((c & 0xC0) != 0x80)
+				return REPLACEMENT_CHARACTER;
+
+			cp = (cp << 6) | (c & 0x3F);
+		}
+
+		i += length;
+		return (cp >= minCP && IsValidCodePoint(cp)) ? cp : REPLACEMENT_CHARACTER;
+	}
+
+	// Advances i past one code point. Unpaired surrogates decode to U+FFFD.
+	char32_t DecodeWC(const std::wstring_view& input, size_t& i)
+	{
+		const auto unit = char32_t(input[i++]);
+		if constexpr (sizeof(wchar_t) == 2)
+		{
+			if (unit >= 0xD800 && unit <= 0xDBFF && i < input.size())
+			{
+				if (const auto low = char32_t(input[i]); low >= 0xDC00 && low <= 0xDFFF)
+				{
+					i++;
+					return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+				}
+			}
+		}
+
+		return IsValidCodePoint(unit) ? unit : REPLACEMENT_CHARACTER;
+	}
+}
+
 std::u16string tf2_bot_detector::ToU16(const std::u8string_view& input)
 {
 	const char* dataTest = reinterpret_cast<const char*>(input.data());
@@ -79,6 +165,99 @@ std::wstring tf2_bot_detector::ToWC(const std::string_view& input)
 	return mh::change_encoding<wchar_t>(input);
 }
 
+size_t tf2_bot_detector::detail::TextUtils_h::ToWC(const std::string_view& input, wchar_t* output)
+{
+	size_t written = 0;
+	for (size_t i = 0; i < input.size(); )
+	{
+#if TF2BD_TEXTUTILS_SSE2
+		if constexpr (sizeof(wchar_t) == 2)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			for (; (i + 16) <= input.size(); i += 16, written += 16)
+			{
+				const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + i));
+				if (_mm_movemask_epi8(chars))
+					break; // Not all ASCII
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(output + written), _mm_unpacklo_epi8(chars, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(output + written + 8), _mm_unpackhi_epi8(chars, zero));
+			}
+
+			if (i >= input.size())
+				break;
+		}
+#endif
+
+		const char32_t cp = DecodeUTF8(input, i);
+		if (sizeof(wchar_t) == 2 && cp >= 0x10000)
+		{
+			output[written++] = wchar_t(0xD800 + ((cp - 0x10000) >> 10));
+			output[written++] = wchar_t(0xDC00 + ((cp - 0x10000) & 0x3FF));
+		}
+		else
+		{
+			output[written++] = wchar_t(cp);
+		}
+	}
+
+	return written;
+}
+
+size_t tf2_bot_detector::detail::TextUtils_h::ToMB(const std::wstring_view& input, char* output)
+{
+	size_t written = 0;
+	for (size_t i = 0; i < input.size(); )
+	{
+#if TF2BD_TEXTUTILS_SSE2
+		if constexpr (sizeof(wchar_t) == 2)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i nonASCIIBits = _mm_set1_epi16(short(0xFF80));
+			for (; (i + 16) <= input.size(); i += 16, written += 16)
+			{
+				const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + i));
+				const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + i + 8));
+				const __m128i nonASCII = _mm_and_si128(_mm_or_si128(lo, hi), nonASCIIBits);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(nonASCII, zero)) != 0xFFFF)
+					break; // Not all ASCII
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(output + written), _mm_packus_epi16(lo, hi));
+			}
+
+			if (i >= input.size())
+				break;
+		}
+#endif
+
+		const char32_t cp = DecodeWC(input, i);
+		if (cp < 0x80)
+		{
+			output[written++] = char(cp);
+		}
+		else if (cp < 0x800)
+		{
+			output[written++] = char(0xC0 | (cp >> 6));
+			output[written++] = char(0x80 | (cp & 0x3F));
+		}
+		else if (cp < 0x10000)
+		{
+			output[written++] = char(0xE0 | (cp >> 12));
+			output[written++] = char(0x80 | ((cp >> 6) & 0x3F));
+			output[written++] = char(0x80 | (cp & 0x3F));
+		}
+		else
+		{
+			output[written++] = char(0xF0 | (cp >> 18));
+			output[written++] = char(0x80 | ((cp >> 12) & 0x3F));
+			output[written++] = char(0x80 | ((cp >> 6) & 0x3F));
+			output[written++] = char(0x80 | (cp & 0x3F));
+		}
+	}
+
+	return written;
+}
+
 std::u16string tf2_bot_detector::ReadWideFile(const std::filesystem::path& filename)
 {
 	//DebugLog("ReadWideFile("s << filename << ')');
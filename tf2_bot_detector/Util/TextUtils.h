@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <filesystem>
+#include <memory>
 #include <string>
 #include <string_view>
 
@@ -18,6 +21,105 @@ namespace tf2_bot_detector
 	std::string ToMB(const std::wstring_view& input);
 	std::wstring ToWC(const std::string_view& input);
 
+	// Text kept in an inline buffer until it outgrows TInlineSize, for conversions that only live long
+	// enough to be handed to an API. Always null terminated.
+	template<typename TChar, size_t TInlineSize = 256>
+	class SmallString final
+	{
+	public:
+		SmallString() { m_Inline[0] = 0; }
+		SmallString(SmallString&& other) noexcept :
+			m_Size(other.m_Size), m_Capacity(other.m_Capacity), m_Heap(std::move(other.m_Heap))
+		{
+			if (!m_Heap)
+				std::copy_n(other.m_Inline, m_Size + 1, m_Inline);
+
+			other.m_Size = 0;
+			other.m_Capacity = TInlineSize;
+			other.m_Inline[0] = 0;
+		}
+		SmallString(const SmallString&) = delete;
+		SmallString& operator=(const SmallString&) = delete;
+		SmallString& operator=(SmallString&&) = delete;
+
+		TChar* data() { return m_Heap ? m_Heap.get() : m_Inline; }
+		const TChar* data() const { return m_Heap ? m_Heap.get() : m_Inline; }
+		const TChar* c_str() const { return data(); }
+		size_t size() const { return m_Size; }
+		bool empty() const { return m_Size == 0; }
+		bool IsInline() const { return !m_Heap; }
+
+		std::basic_string_view<TChar> view() const { return { data(), m_Size }; }
+		operator std::basic_string_view<TChar>() const { return view(); }
+
+		// Anything past the old size is left uninitialized, except for the terminator
+		void resize(size_t size)
+		{
+			if (size > m_Capacity)
+			{
+				const size_t capacity = std::max(size, m_Capacity * 2);
+				auto heap = std::make_unique_for_overwrite<TChar[]>(capacity + 1);
+				std::copy_n(data(), m_Size, heap.get());
+				m_Heap = std::move(heap);
+				m_Capacity = capacity;
+			}
+
+			m_Size = size;
+			data()[m_Size] = 0;
+		}
+
+		void append(const std::basic_string_view<TChar>& text)
+		{
+			const size_t oldSize = m_Size;
+			resize(oldSize + text.size());
+			std::copy(text.begin(), text.end(), data() + oldSize);
+		}
+
+	private:
+		size_t m_Size = 0;
+		size_t m_Capacity = TInlineSize;
+		std::unique_ptr<TChar[]> m_Heap;
+		TChar m_Inline[TInlineSize + 1];
+	};
+
+	namespace detail::TextUtils_h
+	{
+		// output needs room for input.size() characters. Returns how many were written.
+		size_t ToWC(const std::string_view& input, wchar_t* output);
+		// output needs room for input.size() * MAX_MB_PER_WC characters. Returns how many were written.
+		inline constexpr size_t MAX_MB_PER_WC = sizeof(wchar_t) == 2 ? 3 : 4;
+		size_t ToMB(const std::wstring_view& input, char* output);
+	}
+
+	// ToWC() and ToMB() without a temporary string. Pure ASCII, which nearly all commands and paths
+	// are, is copied 16 characters at a time without decoding anything.
+	template<size_t TInlineSize>
+	inline void AppendWC(SmallString<wchar_t, TInlineSize>& output, const std::string_view& input)
+	{
+		const size_t oldSize = output.size();
+		output.resize(oldSize + input.size());
+		output.resize(oldSize + detail::TextUtils_h::ToWC(input, output.data() + oldSize));
+	}
+	template<size_t TInlineSize>
+	inline void AppendMB(SmallString<char, TInlineSize>& output, const std::wstring_view& input)
+	{
+		const size_t oldSize = output.size();
+		output.resize(oldSize + input.size() * detail::TextUtils_h::MAX_MB_PER_WC);
+		output.resize(oldSize + detail::TextUtils_h::ToMB(input, output.data() + oldSize));
+	}
+	inline SmallString<wchar_t> ToWCSmall(const std::string_view& input)
+	{
+		SmallString<wchar_t> retVal;
+		AppendWC(retVal, input);
+		return retVal;
+	}
+	inline SmallString<char> ToMBSmall(const std::wstring_view& input)
+	{
+		SmallString<char> retVal;
+		AppendMB(retVal, input);
+		return retVal;
+	}
+
 	std::u16string ReadWideFile(const std::filesystem::path& filename);
 	void WriteWideFile(const std::filesystem::path& filename, const std::u16string_view& text);
 
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Clock.h"
+#include "Util/RingBuffer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace tf2_bot_detector
+{
+	struct TimeSeriesBucket
+	{
+		time_point_t m_Begin{};
+		float m_Min{};
+		float m_Max{};
+		float m_Sum{};
+		uint32_t m_Count{};
+
+		float GetAverage() const { return m_Count ? (m_Sum / m_Count) : 0; }
+	};
+
+	// Fixed memory history of a single value. Each tier is a ring buffer of min/max/average buckets
+	// of the given width, so the coarse tiers cover hours while the fine ones only cover the last few
+	// minutes. A width of zero keeps every sample as its own bucket.
+	template<size_t TCapacity, size_t TTierCount>
+	class TimeSeries final
+	{
+	public:
+		static constexpr size_t CAPACITY = TCapacity;
+		static constexpr size_t TIER_COUNT = TTierCount;
+		using Buckets = RingBuffer<TimeSeriesBucket, CAPACITY>;
+
+		constexpr explicit TimeSeries(const std::array<duration_t, TIER_COUNT>& tierWidths)
+		{
+			for (size_t i = 0; i < TIER_COUNT; i++)
+				m_Tiers[i].m_Width = tierWidths[i];
+		}
+
+		void Add(time_point_t timestamp, float value)
+		{
+			for (auto& tier : m_Tiers)
+			{
+				const time_point_t begin = (tier.m_Width > duration_t::zero()) ?
+					(timestamp - (timestamp.time_since_epoch() % tier.m_Width)) : timestamp;
+
+				// Anything out of order goes into the newest bucket rather than rewriting history
+				if (!tier.m_Buckets.empty() && tier.m_Width > duration_t::zero() &&
+					begin <= tier.m_Buckets.back().m_Begin)
+				{
+					auto& bucket = tier.m_Buckets.back();
+					bucket.m_Min = std::min(bucket.m_Min, value);
+					bucket.m_Max = std::max(bucket.m_Max, value);
+					bucket.m_Sum += value;
+					bucket.m_Count++;
+				}
+				else
+				{
+					tier.m_Buckets.push_back({ begin, value, value, value, 1 });
+				}
+			}
+		}
+
+		void Clear()
+		{
+			for (auto& tier : m_Tiers)
+				tier.m_Buckets.clear();
+		}
+
+		bool IsEmpty() const { return m_Tiers[0].m_Buckets.empty(); }
+		const TimeSeriesBucket& GetLatest() const { return m_Tiers[0].m_Buckets.back(); }
+
+		const Buckets& GetBuckets(size_t tier) const { return m_Tiers.at(tier).m_Buckets; }
+		duration_t GetTierWidth(size_t tier) const { return m_Tiers.at(tier).m_Width; }
+
+		// The finest tier that still has everything since (now - window)
+		size_t FindTier(time_point_t now, duration_t window) const
+		{
+			for (size_t i = 0; i < TIER_COUNT; i++)
+			{
+				const auto& buckets = m_Tiers[i].m_Buckets;
+				if (!buckets.full() || buckets.front().m_Begin <= (now - window))
+					return i;
+			}
+
+			return TIER_COUNT - 1;
+		}
+
+	private:
+		struct Tier
+		{
+			duration_t m_Width{};
+			Buckets m_Buckets;
+		};
+		std::array<Tier, TIER_COUNT> m_Tiers{};
+	};
+}
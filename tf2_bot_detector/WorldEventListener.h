@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Clock.h"
+#include "SteamID.h"
 
+#include <span>
 #include <string_view>
 
 namespace tf2_bot_detector
@@ -16,11 +18,19 @@ namespace tf2_bot_detector
 		virtual ~IWorldEventListener() = default;
 
 		virtual void OnTimestampUpdate(IWorldState& world) = 0;
+		// A player's name, connection state or user ID changed, or they're still connecting. Ping and
+		// connected time are kept up to date without one.
 		virtual void OnPlayerStatusUpdate(IWorldState& world, const IPlayer& player) = 0;
 		virtual void OnChatMsg(IWorldState& world, IPlayer& player, const std::string_view& msg) = 0;
 		virtual void OnLocalPlayerInitialized(IWorldState& world, bool initialized) = 0;
 		virtual void OnLocalPlayerSpawned(IWorldState& world, TFClassType classType) = 0;
 		virtual void OnPlayerDroppedFromServer(IWorldState& world, IPlayer& player, const std::string_view& reason) = 0;
+
+		// Someone joined or left the lobby, or switched teams
+		virtual void OnLobbyChanged(IWorldState& world) = 0;
+
+		// Only the differences since the last time our friends list was downloaded
+		virtual void OnFriendsChanged(IWorldState& world, std::span<const SteamID> added, std::span<const SteamID> removed) = 0;
 	};
 
 	class BaseWorldEventListener : public IWorldEventListener
@@ -32,6 +42,8 @@ namespace tf2_bot_detector
 		void OnLocalPlayerInitialized(IWorldState& world, bool initialized) override {}
 		void OnLocalPlayerSpawned(IWorldState& world, TFClassType classType) override {}
 		void OnPlayerDroppedFromServer(IWorldState& world, IPlayer& player, const std::string_view& reason) override {}
+		void OnLobbyChanged(IWorldState& world) override {}
+		void OnFriendsChanged(IWorldState& world, std::span<const SteamID> added, std::span<const SteamID> removed) override {}
 	};
 
 	class AutoWorldEventListener : public BaseWorldEventListener
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Clock.h"
+#include "IPlayer.h"
+#include "LobbyMember.h"
+#include "PlayerStatus.h"
+#include "SteamID.h"
+#include "TFConstants.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace tf2_bot_detector
+{
+	// A copy of the players, lobby members and scores in WorldState, taken on the main thread after
+	// every chunk of console output. Never modified once it's published, so background work can hang
+	// on to one and read it from any thread without locking anything. Anything a worker needs that
+	// isn't in here (API data, IPlayer) still has to be read on the main thread.
+	struct WorldSnapshot
+	{
+		uint64_t m_Version = 0;   // Goes up by one every time a new snapshot is published
+		time_point_t m_Time{};    // IWorldState::GetCurrentTime() when this was taken
+
+		struct Player
+		{
+			PlayerStatus m_Status;
+			PlayerScores m_Scores;
+			TFTeam m_Team{};
+			uint8_t m_ClientIndex{};
+			std::optional<LobbyMemberTeam> m_LobbyTeam;
+			time_point_t m_LastStatusUpdateTime{};
+		};
+
+		std::vector<LobbyMember> m_CurrentLobbyMembers;
+		std::vector<LobbyMember> m_PendingLobbyMembers;
+		std::vector<Player> m_Players;  // Sorted by SteamID, archived players aren't included
+		bool m_IsLocalPlayerInitialized = false;
+
+		const Player* FindPlayer(const SteamID& id) const
+		{
+			auto found = std::lower_bound(m_Players.begin(), m_Players.end(), id,
+				[](const Player& player, const SteamID& id) { return player.m_Status.m_SteamID < id; });
+
+			if (found != m_Players.end() && found->m_Status.m_SteamID == id)
+				return &*found;
+
+			return nullptr;
+		}
+	};
+}
@@ -17,18 +17,36 @@
 #include "Log.h"
 #include "WorldEventListener.h"
 #include "Config/AccountAges.h"
-#include "GlobalDispatcher.h"
 #include "Application.h"
 #include "DB/TempDB.h"
+#include "Util/CancellationToken.h"
+#include "Util/MemoryTracker.h"
+#include "Util/Profiler.h"
+#include "Util/TaskScheduler.h"
+#include "SessionSnapshot.h"
+#include "WorldSnapshot.h"
 
 #include <mh/algorithm/algorithm.hpp>
 #include <mh/concurrency/dispatcher.hpp>
 #include <mh/concurrency/main_thread.hpp>
-#include <mh/concurrency/thread_pool.hpp>
 #include <mh/concurrency/thread_sentinel.hpp>
 #include <mh/future.hpp>
 #include <mh/coroutine/future.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #undef GetCurrentTime
 #undef max
 #undef min
@@ -42,6 +60,51 @@ namespace
 {
 	class Player;
 
+	enum class PlayerFetchStage : uint8_t
+	{
+		Idle,     // Never asked for
+		Queued,   // Waiting on the PlayerFetchCoordinator
+		InFlight,
+		Done,     // Got a value, or an error that isn't going to change (InfoPrivate)
+		Failed,   // Got an error that might go away, asked for again after m_RetryTime
+	};
+
+	// Where one of a player's Player::GetOrFetchDataAsync() values is at
+	struct PlayerFetchState
+	{
+		PlayerFetchStage m_Stage = PlayerFetchStage::Idle;
+		uint8_t m_FailureCount = 0;
+		time_point_t m_RetryTime{};
+	};
+
+	// Starts the lookups behind Player::GetOrFetchDataAsync() a few at a time, the most important
+	// ones first. A hovered tooltip then doesn't wait behind every lookup lazy loading being off
+	// started for the rest of the server.
+	class PlayerFetchCoordinator final
+	{
+	public:
+		static constexpr size_t MAX_IN_FLIGHT = 4;
+
+		// Raises the priority if state is already queued. start is handed a token to hold on to
+		// until the lookup is done.
+		void Queue(PlayerFetchState& state, BatchPriority priority, std::function<void(std::shared_ptr<void>)> start);
+		void Update();
+
+	private:
+		struct QueuedFetch
+		{
+			BatchPriority m_Priority;
+			uint64_t m_Order;
+			std::function<void(std::shared_ptr<void>)> m_Start;
+		};
+
+		std::unordered_map<PlayerFetchState*, QueuedFetch> m_Queued;
+		uint64_t m_NextOrder = 0;
+
+		// Every lookup that's still running holds a copy
+		std::shared_ptr<void> m_InFlightToken = std::make_shared<int>();
+	};
+
 	class WorldState final : public IWorldState, BaseConsoleLineListener
 	{
 	public:
@@ -59,13 +122,16 @@ namespace
 
 		void AddWorldEventListener(IWorldEventListener* listener) override;
 		void RemoveWorldEventListener(IWorldEventListener* listener) override;
-		void AddConsoleLineListener(IConsoleLineListener* listener) override;
+		void AddConsoleLineListener(IConsoleLineListener* listener, ConsoleLineTypeMask lineTypes) override;
 		void RemoveConsoleLineListener(IConsoleLineListener* listener) override;
 
 		void AddConsoleOutputChunk(const std::string_view& chunk) override;
+		void AddCommandResponse(const std::string_view& response, std::span<const IConsoleLine::TryParseFunc> parsers) override;
 		mh::task<> AddConsoleOutputLine(std::string line) override;
+		bool IsDuplicateCommandResponseLine(const IConsoleLine& line, size_t textHash) override;
 
-		std::optional<SteamID> FindSteamIDForName(const std::string_view& playerName) const override;
+		using IWorldState::FindSteamIDForName;
+		std::optional<SteamID> FindSteamIDForName(const InternedString& playerName) const override;
 		std::optional<LobbyMemberTeam> FindLobbyMemberTeam(const SteamID& id) const override;
 		std::optional<UserID_t> FindUserID(const SteamID& id) const override;
 
@@ -75,6 +141,9 @@ namespace
 		static TeamShareResult GetTeamShareResult(
 			const std::optional<LobbyMemberTeam>& team0, const std::optional<LobbyMemberTeam>& team1);
 
+		const LobbyTeamStats& GetLobbyTeamStats(LobbyMemberTeam team) const override;
+		const ActivePlayerTable& GetActivePlayers() const override;
+
 		using IWorldState::FindPlayer;
 		const IPlayer* FindPlayer(const SteamID& id) const override;
 
@@ -87,19 +156,43 @@ namespace
 
 		// Have we joined a team and picked a class?
 		bool IsLocalPlayerInitialized() const override { return m_IsLocalPlayerInitialized; }
-		bool IsVoteInProgress() const override { return m_IsVoteInProgress; }
+		const VoteState& GetVoteState() const override { return m_VoteState; }
+		void RecordVoteCall(const SteamID& target) override;
 
-		void QueuePlayerSummaryUpdate(const SteamID& id);
-		void QueuePlayerBansUpdate(const SteamID& id);
+		void QueuePlayerSummaryUpdate(const SteamID& id, BatchPriority priority = BatchPriority::New);
+		void QueuePlayerBansUpdate(const SteamID& id, BatchPriority priority = BatchPriority::New);
+		void QueueLogsInfoUpdate(const SteamID& id, BatchPriority priority = BatchPriority::New);
+		void QueuePlayerFetch(PlayerFetchState& state, BatchPriority priority, std::function<void(std::shared_ptr<void>)> start)
+		{
+			m_PlayerFetches.Queue(state, priority, std::move(start));
+		}
+		// A prefetched player showed up, so whatever is still queued for them is needed now
+		void PromotePrefetchedPlayer(const SteamID& id);
+		// The player left, so nothing they were waiting on is worth a request anymore. Whatever gets
+		// dropped is looked up again if they come back.
+		void CancelPlayerFetches(Player& player);
 
 		const Settings& GetSettings() const { return m_Settings; }
-		const std::vector<LobbyMember>& GetCurrentLobbyMembers() const { return m_CurrentLobbyMembers; }
-		const std::vector<LobbyMember>& GetPendingLobbyMembers() const { return m_PendingLobbyMembers; }
+		const LobbyMember* FindLobbyMember(const SteamID& id) const;
 		const std::unordered_set<SteamID>& GetFriends() const { return m_Friends; }
 
+		// Called by Player::SetStatus. oldName is null if the player was not in the index yet.
+		void UpdatePlayerNameIndex(Player& player, const InternedString* oldName, const InternedString& newName);
+		void RemoveFromPlayerNameIndex(const Player& player, const InternedString& name);
+
+		// Also called by Player::SetStatus, to move it back up to where its new timestamp belongs
+		void LinkRecentPlayer(Player& player);
+		void UnlinkRecentPlayer(Player& player);
+
 		IAccountAges& GetAccountAges() { return *m_AccountAges; }
 		const IAccountAges& GetAccountAges() const override { return *m_AccountAges; }
 
+		void SaveSnapshot(SessionSnapshot& snapshot) const override;
+		void RestoreSnapshot(const SessionSnapshot& snapshot) override;
+		size_t ReleaseIdleMemory() override;
+
+		std::shared_ptr<const WorldSnapshot> GetWorldSnapshot() const override { return m_WorldSnapshot.load(); }
+
 	protected:
 		virtual IConsoleLineListener& GetConsoleLineListenerBroadcaster() { return m_ConsoleLineListenerBroadcaster; }
 
@@ -112,18 +205,34 @@ namespace
 		void OnConfigExecLineParsed(const ConfigExecLine& execLine);
 
 		void UpdateFriends();
-		mh::task<std::unordered_set<SteamID>> m_FriendsFuture;
+		mh::task<SteamAPI::FriendListUpdate> m_FriendsFuture;
 		std::unordered_set<SteamID> m_Friends;
+		SteamAPI::FriendListVersion m_FriendsVersion;
+		SteamID m_FriendsSteamID;  // Whose friends list m_Friends is
 		time_point_t m_LastFriendsUpdate{};
+		void ApplyFriends(std::unordered_set<SteamID> friends);
 
 		Player& FindOrCreatePlayer(const SteamID& id);
+		void ClearPlayers();
+
+		// Players created since the last call. Their cached API data is looked up together on the
+		// temp db's thread, a few queries for a whole status update instead of several per player.
+		std::vector<SteamID> m_NewPlayers;
+		void LoadNewPlayersFromCache();
+		void ArchiveInactivePlayers();
+		void TrimPlayerArchive();
+
+		// For BatchedAction leftovers, which would otherwise be retried
+		template<typename T>
+		void DropDepartedPlayers(std::unordered_set<SteamID>& collection, mh::expected<T> Player::* var);
+		void UpdateLobbyMemberIndex();
 
 		struct PlayerSummaryUpdateAction final :
 			BatchedAction<WorldState*, SteamID, std::vector<SteamAPI::PlayerSummary>>
 		{
 			using BatchedAction::BatchedAction;
 		protected:
-			response_future_type SendRequest(WorldState*& state, queue_collection_type& collection) override;
+			response_future_type SendRequest(WorldState*& state, const queue_collection_type& collection) override;
 			void OnDataReady(WorldState*& state, const response_type& response,
 				queue_collection_type& collection) override;
 		} m_PlayerSummaryUpdates;
@@ -133,26 +242,148 @@ namespace
 		{
 			using BatchedAction::BatchedAction;
 		protected:
-			response_future_type SendRequest(state_type& state, queue_collection_type& collection) override;
+			response_future_type SendRequest(state_type& state, const queue_collection_type& collection) override;
 			void OnDataReady(state_type& state, const response_type& response,
 				queue_collection_type& collection) override;
 		} m_PlayerBansUpdates;
 
+		// logs.tf takes a request per player, so these batches are kept small. Results come back a
+		// few players at a time, instead of after the rate limiter has worked through a hundred.
+		struct LogsInfoUpdateAction final :
+			BatchedAction<WorldState*, SteamID, std::vector<LogsTFAPI::PlayerLogsInfo>, 8>
+		{
+			using BatchedAction::BatchedAction;
+		protected:
+			response_future_type SendRequest(state_type& state, const queue_collection_type& collection) override;
+			void OnDataReady(state_type& state, const response_type& response,
+				queue_collection_type& collection) override;
+		} m_LogsInfoUpdates;
+
+		PlayerFetchCoordinator m_PlayerFetches;
+
 		std::vector<LobbyMember> m_CurrentLobbyMembers;
 		std::vector<LobbyMember> m_PendingLobbyMembers;
 		std::unordered_map<SteamID, std::shared_ptr<Player>> m_CurrentPlayerData;
+
+		// Everything in m_CurrentPlayerData, most recent GetLastStatusUpdateTime() first. Status
+		// updates almost always have the newest timestamp, so keeping it sorted is a move to the front.
+		Player* m_RecentPlayersHead = nullptr;
+		Player* m_RecentPlayersTail = nullptr;
+
+		// Players who have stopped showing up in status updates, most recently archived first. They are kept
+		// (and still returned by FindPlayer) in case they come back, up to Settings::m_PlayerArchiveSize.
+		using ArchivedPlayerList_t = std::list<std::shared_ptr<Player>>;
+		ArchivedPlayerList_t m_ArchivedPlayers;
+		std::unordered_map<SteamID, ArchivedPlayerList_t::iterator> m_ArchivedPlayerData;
+		time_point_t m_LastArchiveUpdateTime{};
+
+		// Status name => every player whose latest status had that name. Almost always just one.
+		std::unordered_map<InternedString, std::vector<const Player*>> m_PlayersByName;
+
+		struct LobbyMemberIndexEntry
+		{
+			// Only what a change of would mean the lobby changed, not where the member is
+			bool operator==(const LobbyMemberIndexEntry& other) const
+			{
+				return m_Team == other.m_Team && m_Type == other.m_Type && m_Pending == other.m_Pending;
+			}
+
+			LobbyMemberTeam m_Team;
+			LobbyMemberType m_Type;
+			bool m_Pending;
+			const LobbyMember* m_Member;  // In m_CurrentLobbyMembers or m_PendingLobbyMembers
+		};
+
+		// Rebuilt from m_CurrentLobbyMembers and m_PendingLobbyMembers whenever either changes.
+		// Current members take priority over pending ones with the same SteamID, and m_LobbyMembers
+		// is every valid member once, current ones first.
+		std::unordered_map<SteamID, LobbyMemberIndexEntry> m_LobbyMemberIndex;
+		std::vector<const LobbyMember*> m_LobbyMembers;
+
+		// Changes whenever m_LobbyMemberIndex or m_LocalSteamID does. Players keep the
+		// TeamShareResult they were last given along with the generation it was worked out in.
+		uint32_t m_LobbyGeneration = 1;
+
+		// Settings::GetLocalSteamID() reads the registry, so it's only checked once per Update()
+		void UpdateLocalSteamID();
+		SteamID m_LocalSteamID;
+
+		// Rebuilt from m_CurrentPlayerData and m_LobbyMemberIndex on the next GetActivePlayers() or
+		// GetLobbyTeamStats() once dirty. m_LobbyTeamStats is indexed by LobbyMemberTeam.
+		void UpdateActivePlayers() const;
+		mutable ActivePlayerTable m_ActivePlayers;
+		mutable std::array<LobbyTeamStats, 2> m_LobbyTeamStats{};
+		mutable bool m_ActivePlayersDirty = true;
 		bool m_IsLocalPlayerInitialized = false;
-		bool m_IsVoteInProgress = false;
+		VoteState m_VoteState;
+		void OnVoteUserMessage(UserMessageType type, time_point_t timestamp);
+
+		// Copied from the above on the main thread, read from anywhere
+		void PublishWorldSnapshot();
+		std::atomic<std::shared_ptr<const WorldSnapshot>> m_WorldSnapshot = std::make_shared<const WorldSnapshot>();
 
 		std::shared_ptr<IAccountAges> m_AccountAges = IAccountAges::Create();
 
 		time_point_t m_LastStatusUpdateTime{};
 
 		std::unordered_set<IConsoleLineListener*> m_ConsoleLineListeners;
+		std::array<std::vector<IConsoleLineListener*>, size_t(ConsoleLineType::COUNT)> m_ConsoleLineListenersByType;
+		void BroadcastConsoleLineParsed(IConsoleLine& line);
 		std::unordered_set<IWorldEventListener*> m_EventListeners;
 
-		mh::thread_pool m_ConsoleLineParsingPool{ 1 };
-		std::vector<mh::shared_future<std::shared_ptr<IConsoleLine>>> m_ConsoleLineParsingTasks;
+		// Console output from RCON is parsed in parallel, then broadcast in the order it was received.
+		// Lines are tried against responseParsers before everything else.
+		mh::task<> ParseConsoleOutputLines(std::vector<std::string> lines,
+			std::span<const IConsoleLine::TryParseFunc> responseParsers = {}, std::optional<size_t> lobbyDebugHash = std::nullopt);
+
+		struct ParsedConsoleOutput
+		{
+			std::vector<std::string> m_Lines;
+			std::vector<std::shared_ptr<IConsoleLine>> m_Parsed;
+			std::vector<std::optional<size_t>> m_ResponseLineHashes; // Set for lines recognised by a response parser
+			std::optional<size_t> m_LobbyDebugHash;                  // Set if this is a tf_lobby_debug response
+		};
+		uint64_t m_NextConsoleOutputSequence = 0;       // Sequence number of the next chunk added (main thread only)
+		uint64_t m_NextConsoleOutputToBroadcast = 0;    // Sequence number we are waiting on before we can broadcast
+		std::map<uint64_t, ParsedConsoleOutput> m_ParsedConsoleOutput;  // Finished chunks, waiting for their turn
+
+		// Command responses show up twice, once over RCON and again in console.log. Whichever copy
+		// of a line arrives first is broadcast, the other one is dropped. Main thread only.
+		class CommandResponseLineTracker
+		{
+		public:
+			enum class Source
+			{
+				Response,
+				ConsoleLog,
+			};
+
+			// True if the line already arrived from the other source
+			bool IsDuplicate(Source source, size_t textHash);
+
+		private:
+			// Copies that never arrive (con_logfile turned off, output dropped) are forgotten after this long
+			static constexpr duration_t EXPIRY = std::chrono::seconds(5);
+
+			void RemoveExpired(time_point_t now);
+
+			std::array<std::unordered_map<size_t, std::deque<time_point_t>>, 2> m_Pending; // Expiry times by text hash, oldest first
+			size_t m_CallCount = 0;
+		} m_CommandResponseLines;
+		ConsoleLineTypeMask m_CommandResponseLineTypes; // Types the response parsers have recognised so far
+
+		// Once everyone has loaded in, tf_lobby_debug says the same thing poll after poll. The last reply
+		// that was applied is remembered, so an identical one can skip straight past parsing and the lobby
+		// rebuild. Forgotten whenever the players or the lobby are cleared, and every LOBBY_DEBUG_REFRESH
+		// regardless in case something else changed them behind our back. Main thread only.
+		struct LobbyDebugResponse
+		{
+			size_t m_Hash;
+			time_point_t m_AppliedTime;
+			std::vector<size_t> m_LineHashes;  // Lines the response parsers recognised, for the console.log copies
+		};
+		std::optional<LobbyDebugResponse> m_LastLobbyDebugResponse;
+		static constexpr duration_t LOBBY_DEBUG_REFRESH = std::chrono::seconds(30);
 
 		struct ConsoleLineListenerBroadcaster final : IConsoleLineListener
 		{
@@ -160,8 +391,8 @@ namespace
 
 			void OnConsoleLineParsed(IWorldState& world, IConsoleLine& line) override
 			{
-				for (IConsoleLineListener* l : m_World.m_ConsoleLineListeners)
-					l->OnConsoleLineParsed(world, line);
+				assert(&world == &m_World);
+				m_World.BroadcastConsoleLineParsed(line);
 			}
 			void OnConsoleLineUnparsed(IWorldState& world, const std::string_view& text) override
 			{
@@ -170,6 +401,11 @@ namespace
 			}
 			void OnConsoleLogChunkParsed(IWorldState& world, bool consoleLinesParsed) override
 			{
+				if (consoleLinesParsed)
+					m_World.PublishWorldSnapshot();
+
+				m_World.LoadNewPlayersFromCache();
+
 				for (IConsoleLineListener* l : m_World.m_ConsoleLineListeners)
 					l->OnConsoleLogChunkParsed(world, consoleLinesParsed);
 			}
@@ -217,18 +453,69 @@ namespace
 		TFTeam m_Team{};
 
 		uint8_t m_ClientIndex{};
+
+		// Cached by WorldState::GetTeamShareResult(), for as long as the lobby generation is the same
+		mutable uint32_t m_TeamShareGeneration = 0;
+		mutable TeamShareResult m_TeamShareResult = TeamShareResult::Neither;
+
 		mutable mh::expected<SteamAPI::PlayerSummary> m_PlayerSummary = ErrorCode::LazyValueUninitialized;
 		mutable mh::expected<SteamAPI::PlayerBans> m_PlayerSteamBans = ErrorCode::LazyValueUninitialized;
+		mutable mh::expected<LogsTFAPI::PlayerLogsInfo> m_LogsInfo = ErrorCode::LazyValueUninitialized;
+
+		// Whether m_PlayerSummary was there the last time listeners were told about a status update
+		bool m_StatusBroadcastHadSummary = false;
 
 		void SetStatus(PlayerStatus status, time_point_t timestamp);
 		const PlayerStatus& GetStatus() const { return m_Status; }
 
 		void SetPing(uint16_t ping, time_point_t timestamp);
 
+		SessionSnapshot::Player SaveSnapshot() const;
+		void RestoreSnapshot(const SessionSnapshot::Player& snapshot);
+
+		// Starts the lookups we want ready by the time a pending lobby member connects, behind
+		// everything requested for players who are already here
+		void PrefetchAPIData() const;
+
+		// Cancels every lookup started so far, anything after this goes ahead as usual
+		void CancelFetches() const { std::exchange(m_FetchCancellation, {}).Cancel(); }
+		CancellationToken GetFetchCancellationToken() const { return m_FetchCancellation.GetToken(); }
+
+		// Fill in whatever hasn't been looked up yet from WorldState::LoadNewPlayersFromCache().
+		// Expired summaries and bans are kept, and refreshed the first time they're asked for.
+		// Other expired entries are left for the getters, which look them up asynchronously.
+		void ApplyCachedData(const DB::PlayerSummaryCacheInfo& info) { ApplyCachedValue(m_PlayerSummary, info, &m_SummaryCacheLookup); }
+		void ApplyCachedData(const DB::PlayerBansCacheInfo& info) { ApplyCachedValue(m_PlayerSteamBans, info, &m_BansCacheLookup); }
+		void ApplyCachedData(const DB::LogsTFCacheInfo& info) { ApplyCachedValue(m_LogsInfo, info); }
+		void ApplyCachedData(const DB::AccountInventorySizeInfo& info) { ApplyCachedValue(m_InventoryInfo, info); }
+
+		// Remote cache hits, which show up a while after the local ones. They also replace a lookup
+		// that's already in progress, whatever that finds overwrites them anyway.
+		void ApplyRemoteCachedData(const DB::LogsTFCacheInfo& info) { ApplyRemoteCachedValue(m_LogsInfo, info); }
+		void ApplyRemoteCachedData(const DB::AccountInventorySizeInfo& info) { ApplyRemoteCachedValue(m_InventoryInfo, info); }
+
+		// Whatever the bulk load didn't find isn't in the temp db, so the getters go straight to the API
+		void MarkMissingFromCache()
+		{
+			if (m_SummaryCacheLookup == CacheLookup::NotLoaded)
+				m_SummaryCacheLookup = CacheLookup::Missing;
+			if (m_BansCacheLookup == CacheLookup::NotLoaded)
+				m_BansCacheLookup = CacheLookup::Missing;
+		}
+
+		// Set while this player is waiting on LoadNewPlayersFromCache(), which runs any prefetch
+		// that was asked for in the meantime
+		bool m_CacheLoadPending = false;
+		mutable bool m_PrefetchAfterCacheLoad = false;
+
+		// WorldState's list of current players by recency
+		Player* m_RecentPrev = nullptr;
+		Player* m_RecentNext = nullptr;
+		bool m_IsRecentLinked = false;
+
 	protected:
-		std::map<std::type_index, std::any> m_UserData;
-		const std::any* FindDataStorage(const std::type_index& type) const override;
-		std::any& GetOrCreateDataStorage(const std::type_index& type) override;
+		PlayerDataStorage m_UserData;
+		const PlayerDataStorage& GetDataStorage() const override { return m_UserData; }
 
 		std::shared_ptr<Player> shared_from_this() { return std::static_pointer_cast<Player>(IPlayer::shared_from_this()); }
 		std::shared_ptr<const Player> shared_from_this() const { return std::static_pointer_cast<const Player>(IPlayer::shared_from_this()); }
@@ -236,9 +523,53 @@ namespace
 	private:
 		mh::thread_sentinel m_Sentinel;
 
+		const mh::expected<SteamAPI::PlayerSummary>& FetchPlayerSummary(BatchPriority priority) const;
+		const mh::expected<SteamAPI::PlayerBans>& FetchPlayerBans(BatchPriority priority) const;
+		const mh::expected<LogsTFAPI::PlayerLogsInfo>& FetchLogsInfo(BatchPriority priority) const;
+		mh::expected<duration_t> FetchTF2Playtime(BatchPriority priority) const;
+		const mh::expected<SteamAPI::PlayerInventoryInfo>& FetchInventoryInfo(BatchPriority priority) const;
+
+		// What LoadNewPlayersFromCache() found in the temp db, so the synchronous getters never
+		// have to look again on the main thread
+		enum class CacheLookup : uint8_t
+		{
+			NotLoaded,
+			Found,
+			Expired, // Kept, but a refresh is queued the first time it's asked for
+			Missing,
+		};
+
+		template<typename T, typename TCacheInfo>
+		static void ApplyCachedValue(mh::expected<T>& var, const TCacheInfo& info, CacheLookup* lookup = nullptr)
+		{
+			if (var != ErrorCode::LazyValueUninitialized)
+				return;
+
+			const bool expired = DB::ITempDB::IsExpired(info);
+			if (!expired || lookup)
+				var = static_cast<const T&>(info);
+			if (lookup)
+				*lookup = expired ? CacheLookup::Expired : CacheLookup::Found;
+		}
+
+		template<typename T, typename TCacheInfo>
+		static void ApplyRemoteCachedValue(mh::expected<T>& var, const TCacheInfo& info)
+		{
+			if (var == ErrorCode::LazyValueUninitialized || (!var && var.error() == std::errc::operation_in_progress))
+				var = static_cast<const T&>(info);
+		}
+
+		mutable CacheLookup m_SummaryCacheLookup = CacheLookup::NotLoaded;
+		mutable CacheLookup m_BansCacheLookup = CacheLookup::NotLoaded;
+
+		// Queues updateFunc on the world's PlayerFetchCoordinator the first time the value is asked
+		// for, and again once a failed lookup's retry time has passed. silentErrors are expected
+		// failures, which are kept instead of retried. If failureCacheType is set they are also
+		// remembered in the temp db, and answer the lookup without a request until they expire.
 		template<typename T, typename TFunc>
-		const mh::expected<T>& GetOrFetchDataAsync(mh::expected<T>& variable, TFunc&& updateFunc,
-			std::initializer_list<std::error_condition> silentErrors = {}, MH_SOURCE_LOCATION_AUTO(location)) const;
+		const mh::expected<T>& GetOrFetchDataAsync(mh::expected<T>& variable, PlayerFetchState& state,
+			BatchPriority priority, TFunc&& updateFunc, std::initializer_list<std::error_condition> silentErrors = {},
+			std::optional<DB::FailedLookupType> failureCacheType = std::nullopt, MH_SOURCE_LOCATION_AUTO(location)) const;
 
 		WorldState* m_World = nullptr;
 		PlayerStatus m_Status{};
@@ -249,8 +580,14 @@ namespace
 		time_point_t m_LastPingUpdateTime{};
 
 		mutable mh::expected<duration_t> m_TF2Playtime = ErrorCode::LazyValueUninitialized;
-		mutable mh::expected<LogsTFAPI::PlayerLogsInfo> m_LogsInfo = ErrorCode::LazyValueUninitialized;
 		mutable mh::expected<SteamAPI::PlayerInventoryInfo> m_InventoryInfo = ErrorCode::LazyValueUninitialized;
+		mutable PlayerFetchState m_TF2PlaytimeFetch;
+		mutable PlayerFetchState m_InventoryInfoFetch;
+		mutable CancellationSource m_FetchCancellation;
+
+		bool m_IsNameIndexed = false;
+
+		TrackedMemory m_TrackedMemory{ MemoryCategory::PlayerData, sizeof(Player) };
 	};
 }
 
@@ -263,9 +600,30 @@ WorldState::WorldState(const Settings& settings) :
 	m_Settings(settings),
 	m_PlayerSummaryUpdates(this),
 	m_PlayerBansUpdates(this),
+	m_LogsInfoUpdates(this),
 	m_ConsoleLineListenerBroadcaster(*this)
 {
-	AddConsoleLineListener(this);
+	AddConsoleLineListener(this,
+		{
+			ConsoleLineType::LobbyHeader,
+			ConsoleLineType::LobbyStatusFailed,
+			ConsoleLineType::LobbyChanged,
+			ConsoleLineType::HostNewGame,
+			ConsoleLineType::Connecting,
+			ConsoleLineType::ClientReachedServerSpawn,
+			ConsoleLineType::Chat,
+			ConsoleLineType::ServerDroppedPlayer,
+			ConsoleLineType::ConfigExec,
+			ConsoleLineType::VoiceReceive,
+			ConsoleLineType::LobbyMember,
+			ConsoleLineType::Ping,
+			ConsoleLineType::PlayerStatus,
+			ConsoleLineType::PlayerStatusShort,
+			ConsoleLineType::KillNotification,
+			ConsoleLineType::SVC_UserMessage,
+		});
+
+	UpdateLocalSteamID();
 }
 
 WorldState::~WorldState()
@@ -275,32 +633,220 @@ WorldState::~WorldState()
 
 void WorldState::Update()
 {
+	TF2BD_PROFILE_SCOPE("WorldState::Update");
+
+	UpdateLocalSteamID();
+	LoadNewPlayersFromCache();
+
 	m_PlayerSummaryUpdates.Update();
 	m_PlayerBansUpdates.Update();
+	m_LogsInfoUpdates.Update();
+	m_PlayerFetches.Update();
 
 	UpdateFriends();
+	ArchiveInactivePlayers();
+
+	// In case we missed the end of it
+	if (m_VoteState.m_InProgress && GetCurrentTime() > (m_VoteState.m_StartTime + VoteState::VOTE_DURATION + 15s))
+		m_VoteState.m_InProgress = false;
+}
+
+void WorldState::RecordVoteCall(const SteamID& target)
+{
+	m_VoteState.m_LastCallTime = GetCurrentTime();
+	m_VoteState.m_LastCallTarget = target;
+	m_VoteState.m_AwaitingCallResponse = true;
+}
+
+void WorldState::OnVoteUserMessage(UserMessageType type, time_point_t timestamp)
+{
+	auto& vote = m_VoteState;
+
+	// Console timestamps only have whole seconds
+	const bool answersOurCall = vote.m_AwaitingCallResponse &&
+		timestamp >= (vote.m_LastCallTime - 1s) && timestamp <= (vote.m_LastCallTime + VoteState::CALL_RESPONSE_TIMEOUT);
+
+	switch (type)
+	{
+	case UserMessageType::VoteStart:
+		vote.m_InProgress = true;
+		vote.m_StartTime = timestamp;
+		vote.m_CalledByUs = answersOurCall;
+		vote.m_Target = answersOurCall ? vote.m_LastCallTarget : SteamID{};
+		if (answersOurCall)
+		{
+			vote.m_AwaitingCallResponse = false;
+			vote.m_LastOwnVoteStartTime = timestamp;
+			vote.m_CallFailures = 0;
+		}
+		break;
+
+	case UserMessageType::CallVoteFailed:
+		// Could be someone else's, but only we get told about ours
+		if (answersOurCall)
+		{
+			vote.m_AwaitingCallResponse = false;
+			vote.m_LastCallFailedTime = timestamp;
+			if (vote.m_CallFailures < std::numeric_limits<decltype(vote.m_CallFailures)>::max())
+				vote.m_CallFailures++;
+
+			Log("The server turned down our votekick against {} ({} in a row)", vote.m_LastCallTarget, vote.m_CallFailures);
+		}
+		break;
+
+	case UserMessageType::VoteFailed:
+		if (vote.m_InProgress && vote.m_CalledByUs)
+		{
+			std::erase_if(vote.m_FailedKicks, [&](const VoteState::FailedKick& kick)
+				{
+					return kick.m_Target == vote.m_Target || timestamp >= (kick.m_Time + VoteState::FAILED_KICK_COOLDOWN);
+				});
+			vote.m_FailedKicks.push_back({ vote.m_Target, timestamp });
+		}
+
+		vote.m_InProgress = false;
+		break;
+
+	case UserMessageType::VotePass:
+		vote.m_InProgress = false;
+		break;
+
+	default:
+		break;
+	}
+}
+
+time_point_t VoteState::GetNextCallTime(const SteamID& target) const
+{
+	time_point_t next{};
+	const auto NoSoonerThan = [&](time_point_t time) { next = std::max(next, time); };
+
+	if (m_InProgress)
+		NoSoonerThan(m_StartTime + VOTE_DURATION);
+	if (m_AwaitingCallResponse)
+		NoSoonerThan(m_LastCallTime + CALL_RESPONSE_TIMEOUT);
+
+	NoSoonerThan(m_LastOwnVoteStartTime + CREATION_COOLDOWN);
+
+	if (m_CallFailures > 0)
+		NoSoonerThan(m_LastCallFailedTime + std::min<duration_t>(5s * (1 << std::min<int>(m_CallFailures - 1, 5)), CREATION_COOLDOWN));
+
+	for (const FailedKick& kick : m_FailedKicks)
+	{
+		if (kick.m_Target == target)
+			NoSoonerThan(kick.m_Time + FAILED_KICK_COOLDOWN);
+	}
+
+	return next;
+}
+
+void WorldState::UpdateLocalSteamID()
+{
+	if (const auto id = GetSettings().GetLocalSteamID(); id != m_LocalSteamID)
+	{
+		m_LocalSteamID = id;
+		m_LobbyGeneration++;
+	}
+}
+
+void WorldState::ArchiveInactivePlayers()
+{
+	// Well past the windows the scoreboard and ModeratorLogic use to decide who is still on the server
+	constexpr duration_t ARCHIVE_DELAY = 60s;
+
+	const auto now = GetCurrentTime();
+	if ((now - m_LastArchiveUpdateTime) < 5s)
+		return;
+
+	m_LastArchiveUpdateTime = now;
+
+	bool anyArchived = false;
+	for (auto it = m_CurrentPlayerData.begin(); it != m_CurrentPlayerData.end(); )
+	{
+		const Player& player = *it->second;
+		if (m_LobbyMemberIndex.contains(it->first) || (now - player.GetLastStatusUpdateTime()) < ARCHIVE_DELAY)
+		{
+			++it;
+			continue;
+		}
+
+		UnlinkRecentPlayer(*it->second);
+		CancelPlayerFetches(*it->second);
+		m_ArchivedPlayers.push_front(std::move(it->second));
+		m_ArchivedPlayerData.insert_or_assign(it->first, m_ArchivedPlayers.begin());
+		it = m_CurrentPlayerData.erase(it);
+		m_ActivePlayersDirty = true;
+		anyArchived = true;
+	}
+
+	if (anyArchived)
+		PublishWorldSnapshot();
+
+	TrimPlayerArchive();
+}
+
+size_t WorldState::ReleaseIdleMemory()
+{
+	// Whoever is left over from the last server goes into the archive first
+	m_LastArchiveUpdateTime = {};
+	ArchiveInactivePlayers();
+
+	const size_t released = m_ArchivedPlayers.size();
+	for (const auto& player : m_ArchivedPlayers)
+		RemoveFromPlayerNameIndex(*player, player->GetStatus().m_Name);
+
+	m_ArchivedPlayers.clear();
+	m_ArchivedPlayerData = {};
+
+	// The buckets stay at their peak size otherwise
+	m_CurrentPlayerData.rehash(0);
+	m_PlayersByName.rehash(0);
+
+	return released;
+}
+
+void WorldState::TrimPlayerArchive()
+{
+	while (m_ArchivedPlayers.size() > GetSettings().m_PlayerArchiveSize)
+	{
+		const Player& player = *m_ArchivedPlayers.back();
+		RemoveFromPlayerNameIndex(player, player.GetStatus().m_Name);
+		m_ArchivedPlayerData.erase(player.GetSteamID());
+		m_ArchivedPlayers.pop_back();
+	}
 }
 
 void WorldState::UpdateFriends()
 {
 	if (auto client = GetSettings().GetHTTPClient();
-		client && GetSettings().IsSteamAPIAvailable() && (tfbd_clock_t::now() - 5min) > m_LastFriendsUpdate)
+		client && GetSettings().IsSteamAPIAvailable() && (FrameClock::Now() - 5min) > m_LastFriendsUpdate)
 	{
-		m_LastFriendsUpdate = tfbd_clock_t::now();
-		m_FriendsFuture = SteamAPI::GetFriendList(GetSettings(), GetSettings().GetLocalSteamID(), *client);
+		m_LastFriendsUpdate = FrameClock::Now();
+
+		// Someone else's friends list can't be "not modified"
+		if (const auto localSteamID = GetSettings().GetLocalSteamID(); localSteamID != m_FriendsSteamID)
+		{
+			m_FriendsSteamID = localSteamID;
+			m_FriendsVersion = {};
+		}
+
+		m_FriendsFuture = SteamAPI::GetFriendList(GetSettings(), m_FriendsSteamID, *client, m_FriendsVersion);
 	}
 
 	if (m_FriendsFuture.is_ready())
 	{
-		const auto GenericException = [this](const mh::source_location& loc)
+		const auto friendsFuture = std::exchange(m_FriendsFuture, {});
+		const auto GenericException = [](const mh::source_location& loc)
 		{
 			LogException(loc, "Failed to update our friends list");
-			m_FriendsFuture = {};
 		};
 
 		try
 		{
-			m_Friends = m_FriendsFuture.get();
+			auto update = friendsFuture.get();
+			m_FriendsVersion = std::move(update.m_Version);
+			if (update.m_Friends)
+				ApplyFriends(std::move(*update.m_Friends));
 		}
 		catch (const http_error& e)
 		{
@@ -331,142 +877,495 @@ void WorldState::UpdateFriends()
 	}
 }
 
-void WorldState::AddConsoleLineListener(IConsoleLineListener* listener)
+void WorldState::ApplyFriends(std::unordered_set<SteamID> friends)
+{
+	std::vector<SteamID> added, removed;
+	for (const SteamID& id : friends)
+	{
+		if (!m_Friends.contains(id))
+			added.push_back(id);
+	}
+	for (const SteamID& id : m_Friends)
+	{
+		if (!friends.contains(id))
+			removed.push_back(id);
+	}
+
+	if (added.empty() && removed.empty())
+		return;
+
+	for (const SteamID& id : removed)
+		m_Friends.erase(id);
+	m_Friends.insert(added.begin(), added.end());
+
+	DebugLog("Friends list changed: {} added, {} removed", added.size(), removed.size());
+	InvokeEventListener(&IWorldEventListener::OnFriendsChanged, *this, std::span<const SteamID>(added), std::span<const SteamID>(removed));
+}
+
+void WorldState::AddConsoleLineListener(IConsoleLineListener* listener, ConsoleLineTypeMask lineTypes)
 {
+	RemoveConsoleLineListener(listener);
 	m_ConsoleLineListeners.insert(listener);
+
+	for (size_t i = 0; i < m_ConsoleLineListenersByType.size(); i++)
+	{
+		if (lineTypes.Contains(ConsoleLineType(i)))
+			m_ConsoleLineListenersByType[i].push_back(listener);
+	}
 }
 
 void WorldState::RemoveConsoleLineListener(IConsoleLineListener* listener)
 {
-	m_ConsoleLineListeners.erase(listener);
+	if (!m_ConsoleLineListeners.erase(listener))
+		return;
+
+	for (auto& listeners : m_ConsoleLineListenersByType)
+		std::erase(listeners, listener);
+}
+
+void WorldState::BroadcastConsoleLineParsed(IConsoleLine& line)
+{
+	for (IConsoleLineListener* listener : m_ConsoleLineListenersByType[size_t(line.GetType())])
+		listener->OnConsoleLineParsed(*this, line);
 }
 
 void WorldState::AddConsoleOutputChunk(const std::string_view& chunk)
 {
+	std::vector<std::string> lines;
+
 	size_t last = 0;
 	for (auto i = chunk.find('\n', 0); i != chunk.npos; i = chunk.find('\n', last))
 	{
-		auto line = chunk.substr(last, i - last);
-		AddConsoleOutputLine(std::string(line));
+		lines.emplace_back(chunk.substr(last, i - last));
 		last = i + 1;
 	}
+
+	if (!lines.empty())
+		ParseConsoleOutputLines(std::move(lines));
 }
 
-mh::task<> WorldState::AddConsoleOutputLine(std::string line)
+void WorldState::AddCommandResponse(const std::string_view& response, std::span<const IConsoleLine::TryParseFunc> parsers)
 {
-	auto worldState = shared_from_this();
-
-	// Switch to thread "pool" thread (there is only 1 thread in this particular pool)
-	co_await m_ConsoleLineParsingPool.co_add_task();
+	std::vector<std::string> lines;
 
-	auto parsed = IConsoleLine::ParseConsoleLine(line, GetCurrentTime(), *this);
-
-	// switch to main thread
-	co_await GetDispatcher().co_dispatch();
-
-	if (parsed)
+	size_t last = 0;
+	for (auto i = response.find('\n', 0); i != response.npos; i = response.find('\n', last))
 	{
-		for (auto listener : m_ConsoleLineListeners)
-			listener->OnConsoleLineParsed(*worldState, *parsed);
+		lines.emplace_back(response.substr(last, i - last));
+		last = i + 1;
 	}
-	else
+
+	if (lines.empty())
+		return;
+
+	std::optional<size_t> lobbyDebugHash;
+	if (std::find(parsers.begin(), parsers.end(), &LobbyHeaderLine::TryParse) != parsers.end())
 	{
-		for (auto listener : m_ConsoleLineListeners)
-			listener->OnConsoleLineUnparsed(*worldState, std::move(line));
+		lobbyDebugHash = IConsoleLine::HashText(response);
+
+		if (m_LastLobbyDebugResponse && m_LastLobbyDebugResponse->m_Hash == *lobbyDebugHash &&
+			(tfbd_clock_t::now() - m_LastLobbyDebugResponse->m_AppliedTime) < LOBBY_DEBUG_REFRESH)
+		{
+			// Nothing changed, but console.log is still going to show us the same lines again
+			for (size_t lineHash : m_LastLobbyDebugResponse->m_LineHashes)
+				m_CommandResponseLines.IsDuplicate(CommandResponseLineTracker::Source::Response, lineHash);
+
+			return;
+		}
 	}
-}
 
-void WorldState::UpdateTimestamp(const ConsoleLogParser& parser)
-{
-	m_CurrentTimestamp = parser.GetCurrentTimestamp();
+	ParseConsoleOutputLines(std::move(lines), parsers, lobbyDebugHash);
 }
 
-void WorldState::AddWorldEventListener(IWorldEventListener* listener)
+bool WorldState::IsDuplicateCommandResponseLine(const IConsoleLine& line, size_t textHash)
 {
-	m_EventListeners.insert(listener);
-}
+	if (!m_CommandResponseLineTypes.Contains(line.GetType()))
+		return false;
 
-void WorldState::RemoveWorldEventListener(IWorldEventListener* listener)
-{
-	m_EventListeners.erase(listener);
+	return m_CommandResponseLines.IsDuplicate(CommandResponseLineTracker::Source::ConsoleLog, textHash);
 }
 
-std::optional<SteamID> WorldState::FindSteamIDForName(const std::string_view& playerName) const
+bool WorldState::CommandResponseLineTracker::IsDuplicate(Source source, size_t textHash)
 {
-	std::optional<SteamID> retVal;
-	time_point_t lastUpdated{};
+	const auto now = tfbd_clock_t::now();
+	if ((++m_CallCount % 256) == 0)
+		RemoveExpired(now);
 
-	for (const auto& data : m_CurrentPlayerData)
+	auto& other = m_Pending[size_t(source) ^ 1];
+	if (auto found = other.find(textHash); found != other.end())
 	{
-		if (data.second->GetStatus().m_Name == playerName && data.second->GetLastStatusUpdateTime() > lastUpdated)
-		{
-			retVal = data.second->GetSteamID();
-			lastUpdated = data.second->GetLastStatusUpdateTime();
-		}
-	}
+		auto& expiryTimes = found->second;
+		while (!expiryTimes.empty() && expiryTimes.front() <= now)
+			expiryTimes.pop_front();
 
-	return retVal;
-}
+		const bool isDuplicate = !expiryTimes.empty();
+		if (isDuplicate)
+			expiryTimes.pop_front();
 
-std::optional<LobbyMemberTeam> WorldState::FindLobbyMemberTeam(const SteamID& id) const
-{
-	for (const auto& member : m_CurrentLobbyMembers)
-	{
-		if (member.m_SteamID == id)
-			return member.m_Team;
-	}
+		if (expiryTimes.empty())
+			other.erase(found);
 
-	for (const auto& member : m_PendingLobbyMembers)
-	{
-		if (member.m_SteamID == id)
-			return member.m_Team;
+		if (isDuplicate)
+			return true;
 	}
 
-	return std::nullopt;
+	m_Pending[size_t(source)][textHash].push_back(now + EXPIRY);
+	return false;
 }
 
-std::optional<UserID_t> WorldState::FindUserID(const SteamID& id) const
+void WorldState::CommandResponseLineTracker::RemoveExpired(time_point_t now)
 {
-	for (const auto& player : m_CurrentPlayerData)
+	for (auto& pending : m_Pending)
 	{
-		if (player.second->GetSteamID() == id)
-			return player.second->GetUserID();
+		// Expiry times are in order, so only the newest one matters
+		std::erase_if(pending, [&](const auto& entry) { return entry.second.back() <= now; });
 	}
-
-	return std::nullopt;
 }
 
-TeamShareResult WorldState::GetTeamShareResult(const SteamID& id) const
+mh::task<> WorldState::AddConsoleOutputLine(std::string line)
 {
-	return GetTeamShareResult(id, GetSettings().GetLocalSteamID());
+	std::vector<std::string> lines;
+	lines.push_back(std::move(line));
+	return ParseConsoleOutputLines(std::move(lines));
 }
 
-auto WorldState::GetTeamShareResult(const std::optional<LobbyMemberTeam>& team0,
-	const SteamID& id1) const -> TeamShareResult
+mh::task<> WorldState::ParseConsoleOutputLines(std::vector<std::string> lines,
+	std::span<const IConsoleLine::TryParseFunc> responseParsers, std::optional<size_t> lobbyDebugHash)
 {
-	return GetTeamShareResult(team0, FindLobbyMemberTeam(id1));
-}
+	auto worldState = shared_from_this();
 
-auto WorldState::GetTeamShareResult(const std::optional<LobbyMemberTeam>& team0,
-	const std::optional<LobbyMemberTeam>& team1) -> TeamShareResult
-{
-	if (!team0)
-		return TeamShareResult::Neither;
-	if (!team1)
-		return TeamShareResult::Neither;
+	const uint64_t sequence = m_NextConsoleOutputSequence++;
+	const time_point_t timestamp = GetCurrentTime();
+	std::vector<std::shared_ptr<IConsoleLine>> parsed(lines.size());
+	std::vector<std::optional<size_t>> responseLineHashes(responseParsers.empty() ? 0 : lines.size());
 
-	if (*team0 == *team1)
-		return TeamShareResult::SameTeams;
-	else if (*team0 == OppositeTeam(*team1))
-		return TeamShareResult::OppositeTeams;
-	else
-		throw std::runtime_error("Unexpected team value(s)");
-}
+	// Split the lines into contiguous batches, one per CPU lane thread
+	{
+		const auto ParseBatch = [](WorldState& world, const std::vector<std::string>& lines,
+			std::span<const IConsoleLine::TryParseFunc> responseParsers, std::vector<std::shared_ptr<IConsoleLine>>& parsed,
+			std::vector<std::optional<size_t>>& responseLineHashes, size_t begin, size_t end, time_point_t timestamp) -> mh::task<>
+		{
+			co_await TaskScheduler::Get().co_schedule(TaskLane::CPU);
 
-const IPlayer* WorldState::FindPlayer(const SteamID& id) const
-{
-	if (auto found = m_CurrentPlayerData.find(id); found != m_CurrentPlayerData.end())
+			for (size_t i = begin; i < end; i++)
+			{
+				// A line that doesn't parse is skipped, it mustn't hold up the rest of the chunk.
+				// Otherwise this chunk's sequence never arrives and nothing after it is ever broadcast.
+				try
+				{
+					const ConsoleLineTryParseArgs args{ lines[i], timestamp, world };
+					for (IConsoleLine::TryParseFunc parser : responseParsers)
+					{
+						parsed[i] = parser(args);
+						if (parsed[i])
+						{
+							responseLineHashes[i] = IConsoleLine::HashText(lines[i]);
+							break;
+						}
+					}
+
+					if (!parsed[i])
+						parsed[i] = IConsoleLine::ParseConsoleLine(lines[i], timestamp, world);
+				}
+				catch (...)
+				{
+					LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to parse console line {}", std::quoted(lines[i]));
+					parsed[i] = nullptr;
+					if (!responseLineHashes.empty())
+						responseLineHashes[i].reset();
+				}
+			}
+		};
+
+		const size_t batchCount = std::min(lines.size(), TaskScheduler::Get().GetThreadCount(TaskLane::CPU));
+		const size_t batchSize = (lines.size() + batchCount - 1) / batchCount;
+
+		std::vector<mh::task<>> batches;
+		for (size_t begin = 0; begin < lines.size(); begin += batchSize)
+		{
+			batches.push_back(ParseBatch(*this, lines, responseParsers, parsed, responseLineHashes,
+				begin, std::min(begin + batchSize, lines.size()), timestamp));
+		}
+
+		for (auto& batch : batches)
+			co_await batch;
+	}
+
+	// switch to main thread
+	co_await TaskScheduler::Get().co_schedule(TaskLane::Main);
+
+	// Earlier chunks might still be parsing, don't let this one overtake them
+	m_ParsedConsoleOutput.emplace(sequence, ParsedConsoleOutput{ std::move(lines), std::move(parsed), std::move(responseLineHashes), lobbyDebugHash });
+
+	const uint64_t firstBroadcast = m_NextConsoleOutputToBroadcast;
+	for (auto it = m_ParsedConsoleOutput.begin();
+		it != m_ParsedConsoleOutput.end() && it->first == m_NextConsoleOutputToBroadcast;
+		it = m_ParsedConsoleOutput.erase(it), m_NextConsoleOutputToBroadcast++)
+	{
+		auto& output = it->second;
+		for (size_t i = 0; i < output.m_Lines.size(); i++)
+		{
+			if (output.m_Parsed[i])
+			{
+				if (!output.m_ResponseLineHashes.empty() && output.m_ResponseLineHashes[i])
+				{
+					m_CommandResponseLineTypes.Add(output.m_Parsed[i]->GetType());
+					if (m_CommandResponseLines.IsDuplicate(CommandResponseLineTracker::Source::Response, *output.m_ResponseLineHashes[i]))
+						continue; // console.log got there first
+				}
+
+				BroadcastConsoleLineParsed(*output.m_Parsed[i]);
+			}
+			else
+			{
+				for (auto listener : m_ConsoleLineListeners)
+					listener->OnConsoleLineUnparsed(*worldState, output.m_Lines[i]);
+			}
+		}
+
+		if (output.m_LobbyDebugHash)
+		{
+			LobbyDebugResponse applied{ *output.m_LobbyDebugHash, tfbd_clock_t::now() };
+			for (const auto& lineHash : output.m_ResponseLineHashes)
+			{
+				if (lineHash)
+					applied.m_LineHashes.push_back(*lineHash);
+			}
+
+			m_LastLobbyDebugResponse = std::move(applied);
+		}
+	}
+
+	if (m_NextConsoleOutputToBroadcast != firstBroadcast)
+		PublishWorldSnapshot();
+}
+
+void WorldState::UpdateTimestamp(const ConsoleLogParser& parser)
+{
+	m_CurrentTimestamp = parser.GetCurrentTimestamp();
+}
+
+void WorldState::AddWorldEventListener(IWorldEventListener* listener)
+{
+	m_EventListeners.insert(listener);
+}
+
+void WorldState::RemoveWorldEventListener(IWorldEventListener* listener)
+{
+	m_EventListeners.erase(listener);
+}
+
+std::optional<SteamID> WorldState::FindSteamIDForName(const InternedString& playerName) const
+{
+	const auto found = m_PlayersByName.find(playerName);
+	if (found == m_PlayersByName.end())
+		return std::nullopt;
+
+	std::optional<SteamID> retVal;
+	time_point_t lastUpdated{};
+
+	for (const Player* player : found->second)
+	{
+		if (player->GetLastStatusUpdateTime() > lastUpdated)
+		{
+			retVal = player->GetSteamID();
+			lastUpdated = player->GetLastStatusUpdateTime();
+		}
+	}
+
+	return retVal;
+}
+
+void WorldState::UpdatePlayerNameIndex(Player& player, const InternedString* oldName, const InternedString& newName)
+{
+	if (oldName)
+		RemoveFromPlayerNameIndex(player, *oldName);
+
+	if (auto found = m_PlayersByName.find(newName); found != m_PlayersByName.end())
+		found->second.push_back(&player);
+	else
+		m_PlayersByName.emplace(newName, std::vector<const Player*>{ &player });
+}
+
+void WorldState::RemoveFromPlayerNameIndex(const Player& player, const InternedString& name)
+{
+	if (auto found = m_PlayersByName.find(name); found != m_PlayersByName.end())
+	{
+		std::erase(found->second, &player);
+		if (found->second.empty())
+			m_PlayersByName.erase(found);
+	}
+}
+
+std::optional<LobbyMemberTeam> WorldState::FindLobbyMemberTeam(const SteamID& id) const
+{
+	if (auto found = m_LobbyMemberIndex.find(id); found != m_LobbyMemberIndex.end())
+		return found->second.m_Team;
+
+	return std::nullopt;
+}
+
+const LobbyMember* WorldState::FindLobbyMember(const SteamID& id) const
+{
+	if (auto found = m_LobbyMemberIndex.find(id); found != m_LobbyMemberIndex.end())
+		return found->second.m_Member;
+
+	return nullptr;
+}
+
+void WorldState::UpdateLobbyMemberIndex()
+{
+	auto previousIndex = std::exchange(m_LobbyMemberIndex, {});
+	m_LobbyMembers.clear();
+
+	const auto AddMembers = [&](const std::vector<LobbyMember>& members)
+	{
+		for (const auto& member : members)
+		{
+			if (!member.IsValid())
+				continue;
+
+			const LobbyMemberIndexEntry entry{ member.m_Team, member.m_Type, member.m_Pending, &member };
+			if (m_LobbyMemberIndex.try_emplace(member.m_SteamID, entry).second)
+				m_LobbyMembers.push_back(&member);
+		}
+	};
+
+	AddMembers(m_CurrentLobbyMembers);
+	AddMembers(m_PendingLobbyMembers);
+
+	// Every lobby member line gets here, even though they're almost always the same as last time
+	if (m_LobbyMemberIndex != previousIndex)
+	{
+		m_LobbyGeneration++;
+		m_ActivePlayersDirty = true;
+		InvokeEventListener(&IWorldEventListener::OnLobbyChanged, *this);
+	}
+}
+
+const LobbyTeamStats& WorldState::GetLobbyTeamStats(LobbyMemberTeam team) const
+{
+	if (m_ActivePlayersDirty)
+		UpdateActivePlayers();
+
+	return m_LobbyTeamStats.at(size_t(team));
+}
+
+const ActivePlayerTable& WorldState::GetActivePlayers() const
+{
+	if (m_ActivePlayersDirty)
+		UpdateActivePlayers();
+
+	return m_ActivePlayers;
+}
+
+void WorldState::UpdateActivePlayers() const
+{
+	m_ActivePlayersDirty = false;
+
+	auto& table = m_ActivePlayers;
+	table.m_Players.clear();
+	table.m_SteamIDs.clear();
+	table.m_LobbyTeams.clear();
+	table.m_Teams.clear();
+	table.m_UserIDs.clear();
+	table.m_States.clear();
+	table.m_Kills.clear();
+	table.m_Deaths.clear();
+	table.m_Pings.clear();
+	table.m_LastStatusUpdateTimes.clear();
+	table.m_LobbyMembers.clear();
+
+	for (const auto& [id, player] : m_CurrentPlayerData)
+	{
+		const auto member = m_LobbyMemberIndex.find(id);
+
+		table.m_Players.push_back(player.get());
+		table.m_SteamIDs.push_back(id);
+		table.m_LobbyTeams.push_back(member != m_LobbyMemberIndex.end() ? std::optional(member->second.m_Team) : std::nullopt);
+		table.m_Teams.push_back(player->GetTeam());
+		table.m_UserIDs.push_back(player->GetStatus().m_UserID);
+		table.m_States.push_back(player->GetConnectionState());
+		table.m_Kills.push_back(player->GetScores().m_Kills);
+		table.m_Deaths.push_back(player->GetScores().m_Deaths);
+		table.m_Pings.push_back(player->GetPing());
+		table.m_LastStatusUpdateTimes.push_back(player->GetLastStatusUpdateTime());
+	}
+
+	for (const LobbyMember* member : m_LobbyMembers)
+	{
+		if (auto found = m_CurrentPlayerData.find(member->m_SteamID); found != m_CurrentPlayerData.end())
+			table.m_LobbyMembers.push_back(found->second.get());
+	}
+
+	m_LobbyTeamStats = {};
+	for (size_t i = 0; i < table.size(); i++)
+	{
+		if (!table.m_LobbyTeams[i])
+			continue;
+
+		LobbyTeamStats& stats = m_LobbyTeamStats.at(size_t(*table.m_LobbyTeams[i]));
+		stats.m_PlayerCount++;
+		if (table.m_States[i] == PlayerStatusState::Active)
+			stats.m_ConnectedCount++;
+
+		stats.m_Kills += table.m_Kills[i];
+		stats.m_Deaths += table.m_Deaths[i];
+	}
+}
+
+std::optional<UserID_t> WorldState::FindUserID(const SteamID& id) const
+{
+	if (auto found = m_CurrentPlayerData.find(id); found != m_CurrentPlayerData.end())
+		return found->second->GetUserID();
+
+	return std::nullopt;
+}
+
+TeamShareResult WorldState::GetTeamShareResult(const SteamID& id) const
+{
+	const auto found = m_CurrentPlayerData.find(id);
+	if (found == m_CurrentPlayerData.end())
+		return GetTeamShareResult(id, m_LocalSteamID);
+
+	const Player& player = *found->second;
+	if (player.m_TeamShareGeneration != m_LobbyGeneration)
+	{
+		player.m_TeamShareResult = GetTeamShareResult(id, m_LocalSteamID);
+		player.m_TeamShareGeneration = m_LobbyGeneration;
+	}
+
+	return player.m_TeamShareResult;
+}
+
+auto WorldState::GetTeamShareResult(const std::optional<LobbyMemberTeam>& team0,
+	const SteamID& id1) const -> TeamShareResult
+{
+	return GetTeamShareResult(team0, FindLobbyMemberTeam(id1));
+}
+
+auto WorldState::GetTeamShareResult(const std::optional<LobbyMemberTeam>& team0,
+	const std::optional<LobbyMemberTeam>& team1) -> TeamShareResult
+{
+	if (!team0)
+		return TeamShareResult::Neither;
+	if (!team1)
+		return TeamShareResult::Neither;
+
+	if (*team0 == *team1)
+		return TeamShareResult::SameTeams;
+	else if (*team0 == OppositeTeam(*team1))
+		return TeamShareResult::OppositeTeams;
+	else
+		throw std::runtime_error("Unexpected team value(s)");
+}
+
+const IPlayer* WorldState::FindPlayer(const SteamID& id) const
+{
+	if (auto found = m_CurrentPlayerData.find(id); found != m_CurrentPlayerData.end())
 		return found->second.get();
+	if (auto found = m_ArchivedPlayerData.find(id); found != m_ArchivedPlayerData.end())
+		return found->second->get();
 
 	return nullptr;
 }
@@ -495,27 +1394,9 @@ mh::generator<const IPlayer&> WorldState::GetLobbyMembers() const
 		}
 	};
 
-	for (const auto& member : m_CurrentLobbyMembers)
-	{
-		if (!member.IsValid())
-			continue;
-
-		if (auto found = GetPlayer(member))
-			co_yield *found;
-	}
-	for (const auto& member : m_PendingLobbyMembers)
+	for (const LobbyMember* member : m_LobbyMembers)
 	{
-		if (!member.IsValid())
-			continue;
-
-		if (std::any_of(m_CurrentLobbyMembers.begin(), m_CurrentLobbyMembers.end(),
-			[&](const LobbyMember& member2) { return member.m_SteamID == member2.m_SteamID; }))
-		{
-			// Don't return two different instances with the same steamid.
-			continue;
-		}
-
-		if (auto found = GetPlayer(member))
+		if (auto found = GetPlayer(*member))
 			co_yield *found;
 	}
 }
@@ -526,45 +1407,146 @@ mh::generator<const IPlayer&> WorldState::GetPlayers() const
 		co_yield *pair.second;
 }
 
-void WorldState::QueuePlayerSummaryUpdate(const SteamID& id)
+void WorldState::QueuePlayerSummaryUpdate(const SteamID& id, BatchPriority priority)
 {
-	return m_PlayerSummaryUpdates.Queue(id);
+	return m_PlayerSummaryUpdates.Queue(id, priority);
 }
 
-void WorldState::QueuePlayerBansUpdate(const SteamID& id)
+void WorldState::QueuePlayerBansUpdate(const SteamID& id, BatchPriority priority)
 {
-	return m_PlayerBansUpdates.Queue(id);
+	return m_PlayerBansUpdates.Queue(id, priority);
 }
 
-template<typename TMap>
-static auto GetRecentPlayersImpl(TMap&& map, size_t recentPlayerCount)
+void WorldState::QueueLogsInfoUpdate(const SteamID& id, BatchPriority priority)
 {
-	using value_type = std::conditional_t<std::is_const_v<std::remove_reference_t<TMap>>, const IPlayer*, IPlayer*>;
-	std::vector<value_type> retVal;
+	return m_LogsInfoUpdates.Queue(id, priority);
+}
 
-	for (auto& [sid, player] : map)
-		retVal.push_back(player.get());
+void PlayerFetchCoordinator::Queue(PlayerFetchState& state, BatchPriority priority,
+	std::function<void(std::shared_ptr<void>)> start)
+{
+	auto [it, inserted] = m_Queued.try_emplace(&state, QueuedFetch{ priority, m_NextOrder });
+	if (inserted)
+	{
+		it->second.m_Start = std::move(start);
+		m_NextOrder++;
+	}
+	else
+	{
+		it->second.m_Priority = std::max(it->second.m_Priority, priority);
+	}
+}
+
+void PlayerFetchCoordinator::Update()
+{
+	// The coordinator's own reference doesn't count
+	while (!m_Queued.empty() && size_t(m_InFlightToken.use_count() - 1) < MAX_IN_FLIGHT)
+	{
+		auto next = std::min_element(m_Queued.begin(), m_Queued.end(), [](const auto& lhs, const auto& rhs)
+			{
+				if (lhs.second.m_Priority != rhs.second.m_Priority)
+					return lhs.second.m_Priority > rhs.second.m_Priority;
+
+				return lhs.second.m_Order < rhs.second.m_Order;
+			});
+
+		auto start = std::move(next->second.m_Start);
+		m_Queued.erase(next);
+		if (start)
+			start(m_InFlightToken);
+	}
+}
+
+void WorldState::PromotePrefetchedPlayer(const SteamID& id)
+{
+	m_PlayerSummaryUpdates.Promote(id, BatchPriority::Prefetch, BatchPriority::New);
+	m_PlayerBansUpdates.Promote(id, BatchPriority::Prefetch, BatchPriority::New);
+	m_LogsInfoUpdates.Promote(id, BatchPriority::Prefetch, BatchPriority::New);
+}
+
+template<typename T>
+static void ResetInProgressValue(mh::expected<T>& var)
+{
+	if (!var && var.error() == std::errc::operation_in_progress)
+		var = ErrorCode::LazyValueUninitialized;
+}
+
+void WorldState::CancelPlayerFetches(Player& player)
+{
+	player.CancelFetches();
+
+	const SteamID id = player.GetSteamID();
+	if (m_PlayerSummaryUpdates.Remove(id))
+		ResetInProgressValue(player.m_PlayerSummary);
+	if (m_PlayerBansUpdates.Remove(id))
+		ResetInProgressValue(player.m_PlayerSteamBans);
+	if (m_LogsInfoUpdates.Remove(id))
+		ResetInProgressValue(player.m_LogsInfo);
+}
 
-	std::sort(retVal.begin(), retVal.end(),
-		[](const IPlayer* a, const IPlayer* b)
+template<typename T>
+void WorldState::DropDepartedPlayers(std::unordered_set<SteamID>& collection, mh::expected<T> Player::* var)
+{
+	std::erase_if(collection, [&](const SteamID& id)
 		{
-			return b->GetLastStatusUpdateTime() < a->GetLastStatusUpdateTime();
+			if (m_CurrentPlayerData.contains(id))
+				return false;
+
+			if (auto archived = m_ArchivedPlayerData.find(id); archived != m_ArchivedPlayerData.end())
+				ResetInProgressValue((*archived->second).get()->*var);
+
+			return true;
 		});
+}
 
-	if (retVal.size() > recentPlayerCount)
-		retVal.resize(recentPlayerCount);
+template<typename TPlayer>
+static std::vector<TPlayer*> GetRecentPlayersImpl(Player* head, size_t playerCount, size_t recentPlayerCount)
+{
+	std::vector<TPlayer*> retVal;
+	retVal.reserve(std::min(playerCount, recentPlayerCount));
+
+	for (Player* player = head; player && retVal.size() < recentPlayerCount; player = player->m_RecentNext)
+		retVal.push_back(player);
 
 	return retVal;
 }
 
 std::vector<const IPlayer*> WorldState::GetRecentPlayers(size_t recentPlayerCount) const
 {
-	return GetRecentPlayersImpl(m_CurrentPlayerData, recentPlayerCount);
+	return GetRecentPlayersImpl<const IPlayer>(m_RecentPlayersHead, m_CurrentPlayerData.size(), recentPlayerCount);
 }
 
 std::vector<IPlayer*> WorldState::GetRecentPlayers(size_t recentPlayerCount)
 {
-	return GetRecentPlayersImpl(m_CurrentPlayerData, recentPlayerCount);
+	return GetRecentPlayersImpl<IPlayer>(m_RecentPlayersHead, m_CurrentPlayerData.size(), recentPlayerCount);
+}
+
+void WorldState::LinkRecentPlayer(Player& player)
+{
+	assert(!player.m_IsRecentLinked);
+
+	// In front of the first player that isn't more recent
+	Player* next = m_RecentPlayersHead;
+	while (next && next->GetLastStatusUpdateTime() > player.GetLastStatusUpdateTime())
+		next = next->m_RecentNext;
+
+	Player* prev = next ? next->m_RecentPrev : m_RecentPlayersTail;
+	player.m_RecentPrev = prev;
+	player.m_RecentNext = next;
+	(prev ? prev->m_RecentNext : m_RecentPlayersHead) = &player;
+	(next ? next->m_RecentPrev : m_RecentPlayersTail) = &player;
+	player.m_IsRecentLinked = true;
+}
+
+void WorldState::UnlinkRecentPlayer(Player& player)
+{
+	if (!player.m_IsRecentLinked)
+		return;
+
+	(player.m_RecentPrev ? player.m_RecentPrev->m_RecentNext : m_RecentPlayersHead) = player.m_RecentNext;
+	(player.m_RecentNext ? player.m_RecentNext->m_RecentPrev : m_RecentPlayersTail) = player.m_RecentPrev;
+	player.m_RecentPrev = player.m_RecentNext = nullptr;
+	player.m_IsRecentLinked = false;
 }
 
 void WorldState::OnConfigExecLineParsed(const ConfigExecLine& execLine)
@@ -620,7 +1602,8 @@ void WorldState::OnConsoleLineParsed(IWorldState& world, IConsoleLine& parsed)
 	{
 		m_CurrentLobbyMembers.clear();
 		m_PendingLobbyMembers.clear();
-		m_CurrentPlayerData.clear();
+		UpdateLobbyMemberIndex();
+		ClearPlayers();
 	};
 
 	switch (parsed.GetType())
@@ -630,16 +1613,13 @@ void WorldState::OnConsoleLineParsed(IWorldState& world, IConsoleLine& parsed)
 		auto& headerLine = static_cast<const LobbyHeaderLine&>(parsed);
 		m_CurrentLobbyMembers.resize(headerLine.GetMemberCount());
 		m_PendingLobbyMembers.resize(headerLine.GetPendingCount());
+		UpdateLobbyMemberIndex();
 		break;
 	}
 	case ConsoleLineType::LobbyStatusFailed:
 	{
 		if (!m_CurrentLobbyMembers.empty() || !m_PendingLobbyMembers.empty())
-		{
-			m_CurrentLobbyMembers.clear();
-			m_PendingLobbyMembers.clear();
-			m_CurrentPlayerData.clear();
-		}
+			ClearLobbyState();
 		break;
 	}
 	case ConsoleLineType::LobbyChanged:
@@ -652,6 +1632,9 @@ void WorldState::OnConsoleLineParsed(IWorldState& world, IConsoleLine& parsed)
 			ClearLobbyState();
 		}
 
+		// Even if the members are the same, the next reply has to be applied again
+		m_LastLobbyDebugResponse.reset();
+
 		if (changeType == LobbyChangeType::Created || changeType == LobbyChangeType::Updated)
 		{
 			// We can't trust the existing client indices
@@ -670,7 +1653,8 @@ void WorldState::OnConsoleLineParsed(IWorldState& world, IConsoleLine& parsed)
 			InvokeEventListener(&IWorldEventListener::OnLocalPlayerInitialized, *this, m_IsLocalPlayerInitialized);
 		}
 
-		m_IsVoteInProgress = false;
+		// New map or new server, either way a new vote controller that hasn't heard of us
+		m_VoteState = {};
 		break;
 	}
 	case ConsoleLineType::Chat:
@@ -686,13 +1670,13 @@ void WorldState::OnConsoleLineParsed(IWorldState& world, IConsoleLine& parsed)
 			else
 			{
 				LogWarning("Dropped chat message with unknown IPlayer from {} ({})",
-					std::quoted(chatLine.GetPlayerName()), std::quoted(chatLine.GetMessage()));
+					std::quoted(chatLine.GetPlayerName().view()), std::quoted(chatLine.GetMessage()));
 			}
 		}
 		else
 		{
 			LogWarning("Dropped chat message with unknown SteamID from {}: {}",
-				std::quoted(chatLine.GetPlayerName()), std::quoted(chatLine.GetMessage()));
+				std::quoted(chatLine.GetPlayerName().view()), std::quoted(chatLine.GetMessage()));
 		}
 
 		break;
@@ -754,10 +1738,18 @@ void WorldState::OnConsoleLineParsed(IWorldState& world, IConsoleLine& parsed)
 		const auto& member = memberLine.GetLobbyMember();
 		auto& vec = member.m_Pending ? m_PendingLobbyMembers : m_CurrentLobbyMembers;
 		if (member.m_Index < vec.size())
+		{
 			vec[member.m_Index] = member;
+			UpdateLobbyMemberIndex();
+		}
 
 		const TFTeam tfTeam = member.m_Team == LobbyMemberTeam::Defenders ? TFTeam::Red : TFTeam::Blue;
-		FindOrCreatePlayer(member.m_SteamID).m_Team = tfTeam;
+		auto& playerData = FindOrCreatePlayer(member.m_SteamID);
+		playerData.m_Team = tfTeam;
+		m_ActivePlayersDirty = true;
+
+		if (member.m_Pending)
+			playerData.PrefetchAPIData();
 
 		break;
 	}
@@ -768,6 +1760,7 @@ void WorldState::OnConsoleLineParsed(IWorldState& world, IConsoleLine& parsed)
 		{
 			auto& playerData = FindOrCreatePlayer(*found);
 			playerData.SetPing(pingLine.GetPing(), pingLine.GetTimestamp());
+			m_ActivePlayersDirty = true;
 		}
 
 		break;
@@ -785,10 +1778,29 @@ void WorldState::OnConsoleLineParsed(IWorldState& world, IConsoleLine& parsed)
 			newStatus.m_ConnectionTime = playerData.GetStatus().m_ConnectionTime;
 		}
 
+		// Most of a status poll is the same players with a new ping. Listeners only hear about the
+		// parts they react to, or about players still connecting, whose rule matches, teams and
+		// lookups are still settling. A summary that showed up since the last time counts too, since
+		// the rules look at the personaname and avatar.
+		const PlayerStatus& oldStatus = playerData.GetStatus();
+		const bool notifyListeners =
+			oldStatus.m_Name != newStatus.m_Name ||
+			oldStatus.m_State != newStatus.m_State ||
+			oldStatus.m_UserID != newStatus.m_UserID ||
+			newStatus.m_State != PlayerStatusState::Active ||
+			bool(playerData.m_PlayerSummary) != playerData.m_StatusBroadcastHadSummary;
+
 		assert(playerData.GetStatus().m_SteamID == newStatus.m_SteamID);
 		playerData.SetStatus(newStatus, statusLine.GetTimestamp());
+		PromotePrefetchedPlayer(newStatus.m_SteamID);
 		m_LastStatusUpdateTime = std::max(m_LastStatusUpdateTime, playerData.GetLastStatusUpdateTime());
-		InvokeEventListener(&IWorldEventListener::OnPlayerStatusUpdate, *this, playerData);
+		m_ActivePlayersDirty = true;
+
+		if (notifyListeners)
+		{
+			InvokeEventListener(&IWorldEventListener::OnPlayerStatusUpdate, *this, playerData);
+			playerData.m_StatusBroadcastHadSummary = bool(playerData.m_PlayerSummary); // Listeners might have just loaded it
+		}
 
 		break;
 	}
@@ -826,24 +1838,16 @@ void WorldState::OnConsoleLineParsed(IWorldState& world, IConsoleLine& parsed)
 				victim.m_Scores.m_LocalDeaths++;
 		}
 
+		m_ActivePlayersDirty = true;
 		break;
 	}
 	case ConsoleLineType::SVC_UserMessage:
 	{
 		auto& userMsg = static_cast<const SVCUserMessageLine&>(parsed);
-		switch (userMsg.GetUserMessageType())
-		{
-		case UserMessageType::VoteStart:
-			m_IsVoteInProgress = true;
-			break;
-		case UserMessageType::VoteFailed:
-		case UserMessageType::VotePass:
-			m_IsVoteInProgress = false;
-			break;
-		default:
+		if (!GetUserMessageTypeInfo(userMsg.GetUserMessageType()).m_IsVote)
 			break;
-		}
 
+		OnVoteUserMessage(userMsg.GetUserMessageType(), userMsg.GetTimestamp());
 		break;
 	}
 
@@ -894,23 +1898,228 @@ Player& WorldState::FindOrCreatePlayer(const SteamID& id)
 	{
 		data = found->second.get();
 	}
+	else if (auto archived = m_ArchivedPlayerData.find(id); archived != m_ArchivedPlayerData.end())
+	{
+		// Welcome back
+		data = m_CurrentPlayerData.emplace(id, std::move(*archived->second)).first->second.get();
+		m_ArchivedPlayers.erase(archived->second);
+		m_ArchivedPlayerData.erase(archived);
+		LinkRecentPlayer(*data);
+		m_ActivePlayersDirty = true;
+	}
 	else
 	{
 		data = m_CurrentPlayerData.emplace(id, std::make_shared<Player>(*this, id)).first->second.get();
+		data->m_CacheLoadPending = true;
+		LinkRecentPlayer(*data);
+		m_NewPlayers.push_back(id);
+		m_ActivePlayersDirty = true;
+	}
+
+	assert(data->GetSteamID() == id);
+	return *data;
+}
+
+template<typename TCacheInfo>
+static mh::task<std::vector<TCacheInfo>> LoadCachedPlayerDataAsync(std::vector<SteamID> ids)
+{
+	try
+	{
+		co_return co_await TF2BDApplication::GetApplication().GetTempDB().TryGetManyAsync<TCacheInfo>(std::move(ids));
+	}
+	catch (...)
+	{
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to look up cached data for new players");
+		co_return {};
+	}
+}
+
+// Started once the local results are in, so a slow remote cache never holds those up
+template<typename TCacheInfo>
+static mh::task<> MergeRemoteCachedPlayerDataAsync(std::shared_ptr<WorldState> world, std::vector<SteamID> ids,
+	std::vector<TCacheInfo> localInfos)
+{
+	std::vector<TCacheInfo> infos;
+	try
+	{
+		infos = co_await TF2BDApplication::GetApplication().GetTempDB().TryGetManyRemoteAsync<TCacheInfo>(
+			std::move(ids), std::move(localInfos));
+	}
+	catch (...)
+	{
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to look up new players in the remote cache");
+		co_return;
+	}
+
+	if (infos.empty())
+		co_return;
+
+	co_await TaskScheduler::Get().co_schedule(TaskLane::Main);
+
+	for (const TCacheInfo& info : infos)
+	{
+		if (auto found = static_cast<Player*>(world->FindPlayer(info.GetSteamID())))
+			found->ApplyRemoteCachedData(info);
+	}
+}
 
-		if (!GetSettings().m_LazyLoadAPIData)
+template<typename TCacheInfo>
+static void ApplyCachedPlayerData(const std::vector<TCacheInfo>& infos, WorldState& world)
+{
+	for (const TCacheInfo& info : infos)
+	{
+		if (auto found = static_cast<Player*>(world.FindPlayer(info.GetSteamID())))
+			found->ApplyCachedData(info);
+	}
+}
+
+void WorldState::LoadNewPlayersFromCache()
+{
+	if (m_NewPlayers.empty())
+		return;
+
+	[](std::shared_ptr<WorldState> world, std::vector<SteamID> newPlayers) -> mh::task<>
+	{
+		const auto summaries = co_await LoadCachedPlayerDataAsync<DB::PlayerSummaryCacheInfo>(newPlayers);
+		const auto bans = co_await LoadCachedPlayerDataAsync<DB::PlayerBansCacheInfo>(newPlayers);
+		auto logs = co_await LoadCachedPlayerDataAsync<DB::LogsTFCacheInfo>(newPlayers);
+		auto inventories = co_await LoadCachedPlayerDataAsync<DB::AccountInventorySizeInfo>(newPlayers);
+
+		// switch to main thread, ahead of everything that isn't on the scoreboard
+		co_await TaskScheduler::Get().co_schedule(TaskLane::Main, TaskPriority::High);
+
+		TF2BD_PROFILE_SCOPE("WorldState::LoadNewPlayersFromCache");
+
+		// They may have been archived in the meantime
+		ApplyCachedPlayerData(summaries, *world);
+		ApplyCachedPlayerData(bans, *world);
+		ApplyCachedPlayerData(logs, *world);
+		ApplyCachedPlayerData(inventories, *world);
+
+		for (const SteamID& id : newPlayers)
 		{
-			data->GetPlayerSummary();
-			data->GetPlayerBans();
-			data->GetTF2Playtime();
-			data->GetLogsInfo();
-			data->GetInventoryInfo();
+			auto found = static_cast<Player*>(world->FindPlayer(id));
+			if (!found)
+				continue;
+
+			Player& player = *found;
+			player.m_CacheLoadPending = false;
+			player.MarkMissingFromCache();
+
+			if (!world->GetSettings().m_LazyLoadAPIData)
+			{
+				player.GetPlayerSummary();
+				player.GetPlayerBans();
+				player.GetLogsInfo();
+
+				// Nobody is looking at these until a tooltip is opened
+				player.FetchTF2Playtime(BatchPriority::Prefetch);
+				player.FetchInventoryInfo(BatchPriority::Prefetch);
+			}
+			else if (player.m_PrefetchAfterCacheLoad)
+			{
+				player.PrefetchAPIData();
+			}
 		}
+
+		MergeRemoteCachedPlayerDataAsync(world, newPlayers, std::move(logs));
+		MergeRemoteCachedPlayerDataAsync(world, newPlayers, std::move(inventories));
+
+	}(shared_from_this(), std::exchange(m_NewPlayers, {}));
+}
+
+void WorldState::SaveSnapshot(SessionSnapshot& snapshot) const
+{
+	snapshot.m_CurrentLobbyMembers = m_CurrentLobbyMembers;
+	snapshot.m_PendingLobbyMembers = m_PendingLobbyMembers;
+	snapshot.m_IsLocalPlayerInitialized = m_IsLocalPlayerInitialized;
+
+	snapshot.m_Players.reserve(m_CurrentPlayerData.size());
+	for (const auto& [id, player] : m_CurrentPlayerData)
+		snapshot.m_Players.push_back(player->SaveSnapshot());
+}
+
+void WorldState::PublishWorldSnapshot()
+{
+	TF2BD_PROFILE_SCOPE("WorldState::PublishWorldSnapshot");
+
+	auto snapshot = std::make_shared<WorldSnapshot>();
+	snapshot->m_Version = m_WorldSnapshot.load(std::memory_order_relaxed)->m_Version + 1;
+	snapshot->m_Time = GetCurrentTime();
+	snapshot->m_CurrentLobbyMembers = m_CurrentLobbyMembers;
+	snapshot->m_PendingLobbyMembers = m_PendingLobbyMembers;
+	snapshot->m_IsLocalPlayerInitialized = m_IsLocalPlayerInitialized;
+
+	snapshot->m_Players.reserve(m_CurrentPlayerData.size());
+	for (const auto& [id, player] : m_CurrentPlayerData)
+	{
+		auto& copy = snapshot->m_Players.emplace_back();
+		copy.m_Status = player->GetStatus();
+		copy.m_Scores = player->m_Scores;
+		copy.m_Team = player->m_Team;
+		copy.m_ClientIndex = player->m_ClientIndex;
+		copy.m_LastStatusUpdateTime = player->GetLastStatusUpdateTime();
+
+		if (auto found = m_LobbyMemberIndex.find(id); found != m_LobbyMemberIndex.end())
+			copy.m_LobbyTeam = found->second.m_Team;
 	}
 
+	std::sort(snapshot->m_Players.begin(), snapshot->m_Players.end(),
+		[](const WorldSnapshot::Player& a, const WorldSnapshot::Player& b) { return a.m_Status.m_SteamID < b.m_Status.m_SteamID; });
 
-	assert(data->GetSteamID() == id);
-	return *data;
+	m_WorldSnapshot.store(std::move(snapshot), std::memory_order_release);
+}
+
+void WorldState::RestoreSnapshot(const SessionSnapshot& snapshot)
+{
+	if (m_CurrentLobbyMembers.empty() && m_PendingLobbyMembers.empty())
+	{
+		m_CurrentLobbyMembers = snapshot.m_CurrentLobbyMembers;
+		m_PendingLobbyMembers = snapshot.m_PendingLobbyMembers;
+		UpdateLobbyMemberIndex();
+		m_LastLobbyDebugResponse.reset();
+	}
+
+	// Restored players go through LoadNewPlayersFromCache() like everyone else, so their Steam API
+	// data comes back from the temp db instead of being requested again
+	for (const auto& saved : snapshot.m_Players)
+	{
+		Player& player = FindOrCreatePlayer(saved.m_Status.m_SteamID);
+		if (player.GetLastStatusUpdateTime() >= saved.m_LastStatusUpdateTime)
+			continue;
+
+		player.RestoreSnapshot(saved);
+		m_LastStatusUpdateTime = std::max(m_LastStatusUpdateTime, player.GetLastStatusUpdateTime());
+		m_ActivePlayersDirty = true;
+		InvokeEventListener(&IWorldEventListener::OnPlayerStatusUpdate, *this, player);
+	}
+
+	if (snapshot.m_IsLocalPlayerInitialized && !m_IsLocalPlayerInitialized)
+	{
+		m_IsLocalPlayerInitialized = true;
+		InvokeEventListener(&IWorldEventListener::OnLocalPlayerInitialized, *this, m_IsLocalPlayerInitialized);
+	}
+
+	PublishWorldSnapshot();
+}
+
+void WorldState::ClearPlayers()
+{
+	m_ActivePlayersDirty = true;
+	m_LastLobbyDebugResponse.reset();
+
+	// Some of them might be kept alive by someone else
+	while (m_RecentPlayersHead)
+		UnlinkRecentPlayer(*m_RecentPlayersHead);
+
+	// The archived ones already were
+	for (const auto& [id, player] : m_CurrentPlayerData)
+		CancelPlayerFetches(*player);
+
+	m_CurrentPlayerData.clear();
+	m_ArchivedPlayers.clear();
+	m_ArchivedPlayerData.clear();
+	m_PlayersByName.clear();
 }
 
 auto WorldState::GetTeamShareResult(const SteamID& id0, const SteamID& id1) const -> TeamShareResult
@@ -932,19 +2141,7 @@ const WorldState& Player::GetWorld() const
 
 const LobbyMember* Player::GetLobbyMember() const
 {
-	const auto steamID = GetSteamID();
-	for (const auto& member : m_World->GetCurrentLobbyMembers())
-	{
-		if (member.m_SteamID == steamID)
-			return &member;
-	}
-	for (const auto& member : m_World->GetPendingLobbyMembers())
-	{
-		if (member.m_SteamID == steamID)
-			return &member;
-	}
-
-	return nullptr;
+	return m_World->FindLobbyMember(GetSteamID());
 }
 
 std::optional<UserID_t> Player::GetUserID() const
@@ -963,12 +2160,68 @@ duration_t Player::GetConnectedTime() const
 	return result;
 }
 
+// Fills in a value from the temp db right away if we've seen this player before. Expired values
+// are still shown while a refresh is queued behind the players we have nothing for yet.
+template<typename TCacheInfo, typename T>
+static bool TryGetCachedAPIData(const SteamID& id, mh::expected<T>& value, bool& expired)
+{
+	if (id.Type != SteamAccountType::Individual)
+		return false;
+
+	TCacheInfo cacheInfo{};
+	cacheInfo.GetSteamID() = id;
+
+	try
+	{
+		if (!TF2BDApplication::GetApplication().GetTempDB().TryGet(cacheInfo))
+			return false;
+	}
+	catch (...)
+	{
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to look up cached API data for {}", id);
+		return false;
+	}
+
+	value = static_cast<const T&>(cacheInfo);
+	expired = DB::ITempDB::IsExpired(cacheInfo);
+	return true;
+}
+
 const mh::expected<SteamAPI::PlayerSummary>& Player::GetPlayerSummary() const
 {
+	return FetchPlayerSummary(BatchPriority::New);
+}
+
+const mh::expected<SteamAPI::PlayerSummary>& Player::FetchPlayerSummary(BatchPriority priority) const
+{
+	if (m_SummaryCacheLookup == CacheLookup::Expired)
+	{
+		// The bulk load kept what it had, until this comes in
+		m_SummaryCacheLookup = CacheLookup::Found;
+		m_World->QueuePlayerSummaryUpdate(GetSteamID(), std::min(priority, BatchPriority::Refresh));
+	}
+
 	if (!m_PlayerSummary && m_PlayerSummary.error() == ErrorCode::LazyValueUninitialized)
 	{
-		m_PlayerSummary = std::errc::operation_in_progress;
-		m_World->QueuePlayerSummaryUpdate(GetSteamID());
+		if (m_CacheLoadPending)
+		{
+			// Don't go to the db for this player alone, LoadNewPlayersFromCache is already on it
+			static const mh::expected<SteamAPI::PlayerSummary> s_Loading = std::errc::operation_in_progress;
+			return s_Loading;
+		}
+
+		// Only players the bulk load never got to are looked up here
+		if (bool expired = false; m_SummaryCacheLookup == CacheLookup::NotLoaded &&
+			TryGetCachedAPIData<DB::PlayerSummaryCacheInfo>(GetSteamID(), m_PlayerSummary, expired))
+		{
+			if (expired)
+				m_World->QueuePlayerSummaryUpdate(GetSteamID(), std::min(priority, BatchPriority::Refresh));
+		}
+		else
+		{
+			m_PlayerSummary = std::errc::operation_in_progress;
+			m_World->QueuePlayerSummaryUpdate(GetSteamID(), priority);
+		}
 	}
 
 	return m_PlayerSummary;
@@ -976,61 +2229,244 @@ const mh::expected<SteamAPI::PlayerSummary>& Player::GetPlayerSummary() const
 
 const mh::expected<SteamAPI::PlayerBans>& Player::GetPlayerBans() const
 {
+	return FetchPlayerBans(BatchPriority::New);
+}
+
+const mh::expected<SteamAPI::PlayerBans>& Player::FetchPlayerBans(BatchPriority priority) const
+{
+	if (m_BansCacheLookup == CacheLookup::Expired)
+	{
+		// The bulk load kept what it had, until this comes in
+		m_BansCacheLookup = CacheLookup::Found;
+		m_World->QueuePlayerBansUpdate(GetSteamID(), std::min(priority, BatchPriority::Refresh));
+	}
+
 	if (!m_PlayerSteamBans && m_PlayerSteamBans.error() == ErrorCode::LazyValueUninitialized)
 	{
-		m_PlayerSteamBans = std::errc::operation_in_progress;
-		m_World->QueuePlayerBansUpdate(GetSteamID());
+		if (m_CacheLoadPending)
+		{
+			static const mh::expected<SteamAPI::PlayerBans> s_Loading = std::errc::operation_in_progress;
+			return s_Loading;
+		}
+
+		// Only players the bulk load never got to are looked up here
+		if (bool expired = false; m_BansCacheLookup == CacheLookup::NotLoaded &&
+			TryGetCachedAPIData<DB::PlayerBansCacheInfo>(GetSteamID(), m_PlayerSteamBans, expired))
+		{
+			if (expired)
+				m_World->QueuePlayerBansUpdate(GetSteamID(), std::min(priority, BatchPriority::Refresh));
+		}
+		else
+		{
+			m_PlayerSteamBans = std::errc::operation_in_progress;
+			m_World->QueuePlayerBansUpdate(GetSteamID(), priority);
+		}
 	}
 
 	return m_PlayerSteamBans;
 }
 
+void Player::PrefetchAPIData() const
+{
+	if (m_CacheLoadPending)
+	{
+		m_PrefetchAfterCacheLoad = true;
+		return;
+	}
+
+	// The account age estimate comes from the summary's creation time
+	FetchPlayerSummary(BatchPriority::Prefetch);
+	FetchPlayerBans(BatchPriority::Prefetch);
+	FetchLogsInfo(BatchPriority::Prefetch);
+}
+
+static mh::task<std::optional<std::error_condition>> TryGetCachedFailureAsync(DB::FailedLookupType type, SteamID id,
+	std::shared_ptr<const IHTTPClient> client)
+{
+	if (id.Type != SteamAccountType::Individual)
+		co_return std::nullopt;
+
+	DB::FailedLookupCacheInfo cacheInfo{};
+	cacheInfo.m_SteamID = id;
+	cacheInfo.m_LookupType = type;
+
+	bool found = false;
+	try
+	{
+		found = co_await TF2BDApplication::GetApplication().GetTempDB().TryGetAsync(cacheInfo) && !DB::ITempDB::IsExpired(cacheInfo);
+	}
+	catch (...)
+	{
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to look up cached lookup failure for {}", id);
+	}
+
+	client->RecordNegativeCacheLookup(found);
+	if (!found)
+		co_return std::nullopt;
+
+	co_return std::error_condition(cacheInfo.m_ErrorCode);
+}
+
+static void StoreCachedFailure(DB::FailedLookupType type, const SteamID& id, const std::error_condition& error)
+{
+	// Only Steam API error codes are stored
+	if (id.Type != SteamAccountType::Individual || error.category() != std::error_condition(SteamAPI::ErrorCode::Success).category())
+		return;
+
+	DB::FailedLookupCacheInfo cacheInfo{};
+	cacheInfo.m_SteamID = id;
+	cacheInfo.m_LookupType = type;
+	cacheInfo.m_ErrorCode = SteamAPI::ErrorCode(error.value());
+	cacheInfo.m_LastCacheUpdateTime = tfbd_clock_t::now();
+
+	try
+	{
+		TF2BDApplication::GetApplication().GetTempDB().Store(cacheInfo);
+	}
+	catch (...)
+	{
+		LogException(MH_SOURCE_LOCATION_CURRENT(), "Failed to store lookup failure for {}", id);
+	}
+}
+
+// Failed lookups are asked for again after FETCH_RETRY_DELAY, doubling each time it fails again
+static constexpr duration_t FETCH_RETRY_DELAY = 5s;
+static constexpr duration_t FETCH_MAX_RETRY_DELAY = 5min;
+
+static void OnFetchFailed(PlayerFetchState& state)
+{
+	state.m_Stage = PlayerFetchStage::Failed;
+	state.m_RetryTime = FrameClock::Now() + std::min(FETCH_RETRY_DELAY * (1 << std::min<int>(state.m_FailureCount, 6)), FETCH_MAX_RETRY_DELAY);
+	if (state.m_FailureCount < std::numeric_limits<decltype(state.m_FailureCount)>::max())
+		state.m_FailureCount++;
+}
+
 template<typename T, typename TFunc>
-const mh::expected<T>& Player::GetOrFetchDataAsync(mh::expected<T>& var, TFunc&& updateFunc,
-	std::initializer_list<std::error_condition> silentErrors, const mh::source_location& location) const
+const mh::expected<T>& Player::GetOrFetchDataAsync(mh::expected<T>& var, PlayerFetchState& state,
+	BatchPriority priority, TFunc&& updateFunc, std::initializer_list<std::error_condition> silentErrors,
+	std::optional<DB::FailedLookupType> failureCacheType, const mh::source_location& location) const
 {
 	m_Sentinel.check(location);
 
-	if (var == ErrorCode::LazyValueUninitialized ||
-		var == ErrorCode::InternetConnectivityDisabled)
+	switch (state.m_Stage)
 	{
-		auto client = m_World->GetSettings().GetHTTPClient();
-
-		if (!client)
+	case PlayerFetchStage::Idle:
+		// Filled in from the temp db by LoadNewPlayersFromCache()
+		if (var != ErrorCode::LazyValueUninitialized)
 		{
-			var = ErrorCode::InternetConnectivityDisabled;
+			state.m_Stage = PlayerFetchStage::Done;
+			return var;
 		}
-		else
+		break;
+
+	case PlayerFetchStage::Failed:
+		if (FrameClock::Now() < state.m_RetryTime)
+			return var;
+		break;
+
+	case PlayerFetchStage::Queued:
+		// Only raises the priority, the lookup that's already queued is kept
+		m_World->QueuePlayerFetch(state, priority, {});
+		return var;
+
+	case PlayerFetchStage::InFlight:
+	case PlayerFetchStage::Done:
+		return var;
+	}
+
+	state.m_Stage = PlayerFetchStage::Queued;
+	if (var == ErrorCode::LazyValueUninitialized)
+		var = std::errc::operation_in_progress;
+
+	m_World->QueuePlayerFetch(state, priority,
+		[sharedThis = shared_from_this(), &var, &state, silentErrors = std::vector<std::error_condition>(silentErrors),
+		failureCacheType, updateFunc = std::forward<TFunc>(updateFunc), cancel = m_FetchCancellation.GetToken(),
+		location](std::shared_ptr<void> inFlight)
 		{
-			var = std::errc::operation_in_progress;
+			if (cancel.IsCancelled())
+			{
+				// They left while this was queued
+				state.m_Stage = PlayerFetchStage::Idle;
+				ResetInProgressValue(var);
+				return;
+			}
+
+			auto client = sharedThis->GetWorld().GetSettings().GetHTTPClient();
+			if (!client)
+			{
+				// Not worth backing off from, it comes back as soon as it's turned back on
+				var = ErrorCode::InternetConnectivityDisabled;
+				state.m_Stage = PlayerFetchStage::Failed;
+				state.m_RetryTime = FrameClock::Now() + FETCH_RETRY_DELAY;
+				return;
+			}
 
-			auto sharedThis = shared_from_this();
+			state.m_Stage = PlayerFetchStage::InFlight;
 
 			[](std::shared_ptr<const Player> sharedThis, std::shared_ptr<const IHTTPClient> client,
-				mh::expected<T>& var, std::vector<std::error_condition> silentErrors, TFunc updateFunc,
-				mh::source_location location) -> mh::task<>
+				mh::expected<T>& var, PlayerFetchState& state, std::vector<std::error_condition> silentErrors,
+				std::optional<DB::FailedLookupType> failureCacheType, std::decay_t<TFunc> updateFunc,
+				CancellationToken cancel, mh::source_location location, std::shared_ptr<void> inFlight) -> mh::task<>
 			{
 				try
 				{
+					bool cancelled = false;
+
+					std::optional<std::error_condition> cachedError;
+					if (failureCacheType)
+						cachedError = co_await TryGetCachedFailureAsync(*failureCacheType, sharedThis->GetSteamID(), client);
+
 					mh::expected<T> result;
-					try
+					if (cachedError)
 					{
-						result = co_await updateFunc(sharedThis, client);
+						result = *cachedError;
 					}
-					catch (const std::system_error& e)
+					else
 					{
-						result = e.code().default_error_condition();
-
-						if (!mh::contains(silentErrors, result.error()))
-							DebugLogException(location, e);
+						try
+						{
+							result = co_await updateFunc(sharedThis, client, cancel);
+						}
+						catch (const OperationCanceledError&)
+						{
+							cancelled = true;
+						}
+						catch (const std::system_error& e)
+						{
+							result = e.code().default_error_condition();
+
+							if (!mh::contains(silentErrors, result.error()))
+								DebugLogException(location, e);
+						}
+						catch (...)
+						{
+							LogException(location);
+							result = ErrorCode::UnknownError;
+						}
+
+						if (failureCacheType && !result && mh::contains(silentErrors, result.error()))
+							StoreCachedFailure(*failureCacheType, sharedThis->GetSteamID(), result.error());
 					}
-					catch (...)
+
+					// switch to main thread, ahead of everything that isn't on the scoreboard
+					co_await TaskScheduler::Get().co_schedule(TaskLane::Main, TaskPriority::High);
+
+					if (cancelled)
 					{
-						LogException(location);
-						result = ErrorCode::UnknownError;
+						state.m_Stage = PlayerFetchStage::Idle;
+						ResetInProgressValue(var);
+						co_return;
 					}
 
-					co_await GetDispatcher().co_dispatch();  // switch to main thread
+					if (result || mh::contains(silentErrors, result.error()))
+					{
+						state.m_Stage = PlayerFetchStage::Done;
+						state.m_FailureCount = 0;
+					}
+					else
+					{
+						OnFetchFailed(state);
+					}
 
 					var = std::move(result);
 				}
@@ -1039,36 +2475,51 @@ const mh::expected<T>& Player::GetOrFetchDataAsync(mh::expected<T>& var, TFunc&&
 					LogException(location);
 				}
 
-			}(sharedThis, client, var, silentErrors, std::move(updateFunc), location);
-		}
-	}
+			}(sharedThis, std::move(client), var, state, silentErrors, failureCacheType, updateFunc, cancel, location, std::move(inFlight));
+		});
 
 	return var;
 }
 
 const mh::expected<LogsTFAPI::PlayerLogsInfo>& Player::GetLogsInfo() const
 {
-	return GetOrFetchDataAsync(m_LogsInfo,
-		[&](std::shared_ptr<const Player> pThis, auto client) -> mh::task<LogsTFAPI::PlayerLogsInfo>
-		{
-			DB::ITempDB& cacheDB = TF2BDApplication::GetApplication().GetTempDB();
+	return FetchLogsInfo(BatchPriority::New);
+}
 
-			DB::LogsTFCacheInfo cacheInfo{};
-			cacheInfo.m_ID = pThis->GetSteamID();
+const mh::expected<LogsTFAPI::PlayerLogsInfo>& Player::FetchLogsInfo(BatchPriority priority) const
+{
+	if (!m_LogsInfo && m_LogsInfo.error() == ErrorCode::LazyValueUninitialized)
+	{
+		if (m_CacheLoadPending)
+		{
+			static const mh::expected<LogsTFAPI::PlayerLogsInfo> s_Loading = std::errc::operation_in_progress;
+			return s_Loading;
+		}
 
-			co_await cacheDB.GetOrUpdateAsync(cacheInfo, [client](DB::LogsTFCacheInfo& info) -> mh::task<>
-				{
-					info = co_await LogsTFAPI::GetPlayerLogsInfoAsync(client, info.m_ID);
-				});
+		if (bool expired = false; TryGetCachedAPIData<DB::LogsTFCacheInfo>(GetSteamID(), m_LogsInfo, expired))
+		{
+			if (expired)
+				m_World->QueueLogsInfoUpdate(GetSteamID(), std::min(priority, BatchPriority::Refresh));
+		}
+		else
+		{
+			m_LogsInfo = std::errc::operation_in_progress;
+			m_World->QueueLogsInfoUpdate(GetSteamID(), priority);
+		}
+	}
 
-			co_return cacheInfo;
-		});
+	return m_LogsInfo;
 }
 
 const mh::expected<SteamAPI::PlayerInventoryInfo>& Player::GetInventoryInfo() const
 {
-	return GetOrFetchDataAsync(m_InventoryInfo,
-		[&](std::shared_ptr<const Player> pThis, auto client) -> mh::task<mh::expected<SteamAPI::PlayerInventoryInfo>>
+	return FetchInventoryInfo(BatchPriority::New);
+}
+
+const mh::expected<SteamAPI::PlayerInventoryInfo>& Player::FetchInventoryInfo(BatchPriority priority) const
+{
+	return GetOrFetchDataAsync(m_InventoryInfo, m_InventoryInfoFetch, priority,
+		[](std::shared_ptr<const Player> pThis, auto client, CancellationToken cancel) -> mh::task<mh::expected<SteamAPI::PlayerInventoryInfo>>
 		{
 			DB::ITempDB& cacheDB = TF2BDApplication::GetApplication().GetTempDB();
 
@@ -1080,28 +2531,34 @@ const mh::expected<SteamAPI::PlayerInventoryInfo>& Player::GetInventoryInfo() co
 			if (!settings.IsSteamAPIAvailable())
 				co_return SteamAPI::ErrorCode::SteamAPIDisabled;
 
-			co_await cacheDB.GetOrUpdateAsync(cacheInfo, [&settings, client](DB::AccountInventorySizeInfo& info) -> mh::task<>
+			co_await cacheDB.GetOrUpdateAsync(cacheInfo, [&settings, client, cancel](DB::AccountInventorySizeInfo& info) -> mh::task<>
 				{
-					info = co_await SteamAPI::GetTF2InventoryInfoAsync(settings, info.GetSteamID(), *client);
+					info = co_await SteamAPI::GetTF2InventoryInfoAsync(settings, info.GetSteamID(), *client, cancel);
 				});
 
 			co_return cacheInfo;
-		});
+		}, { SteamAPI::ErrorCode::InfoPrivate }, DB::FailedLookupType::InventoryInfo);
 }
 
 mh::expected<duration_t> Player::GetTF2Playtime() const
+{
+	return FetchTF2Playtime(BatchPriority::New);
+}
+
+mh::expected<duration_t> Player::FetchTF2Playtime(BatchPriority priority) const
 {
 	using ErrorCode = SteamAPI::ErrorCode;
 
-	return GetOrFetchDataAsync(m_TF2Playtime,
-		[&](std::shared_ptr<const Player> pThis, std::shared_ptr<const IHTTPClient> client) -> mh::task<mh::expected<duration_t>>
+	return GetOrFetchDataAsync(m_TF2Playtime, m_TF2PlaytimeFetch, priority,
+		[](std::shared_ptr<const Player> pThis, std::shared_ptr<const IHTTPClient> client,
+			CancellationToken cancel) -> mh::task<mh::expected<duration_t>>
 		{
 			const auto& settings = pThis->GetWorld().GetSettings();
 			if (!settings.IsSteamAPIAvailable())
 				co_return ErrorCode::SteamAPIDisabled;
 
-			co_return co_await SteamAPI::GetTF2PlaytimeAsync(settings, GetSteamID(), *client);
-		}, { ErrorCode::InfoPrivate, ErrorCode::GameNotOwned });
+			co_return co_await SteamAPI::GetTF2PlaytimeAsync(settings, pThis->GetSteamID(), *client, std::move(cancel));
+		}, { ErrorCode::InfoPrivate, ErrorCode::GameNotOwned }, DB::FailedLookupType::TF2Playtime);
 }
 
 bool Player::IsFriend() const
@@ -1133,8 +2590,20 @@ void Player::SetStatus(PlayerStatus status, time_point_t timestamp)
 	if (m_Status.m_State != PlayerStatusState::Active && status.m_State == PlayerStatusState::Active)
 		m_LastStatusActiveBegin = timestamp;
 
+	if (!m_IsNameIndexed || m_Status.m_Name != status.m_Name)
+	{
+		m_World->UpdatePlayerNameIndex(*this, m_IsNameIndexed ? &m_Status.m_Name : nullptr, status.m_Name);
+		m_IsNameIndexed = true;
+	}
+
 	m_Status = std::move(status);
 	m_LastStatusUpdateTime = m_LastPingUpdateTime = timestamp;
+
+	if (m_IsRecentLinked)
+	{
+		m_World->UnlinkRecentPlayer(*this);
+		m_World->LinkRecentPlayer(*this);
+	}
 }
 void Player::SetPing(uint16_t ping, time_point_t timestamp)
 {
@@ -1142,35 +2611,30 @@ void Player::SetPing(uint16_t ping, time_point_t timestamp)
 	m_LastPingUpdateTime = timestamp;
 }
 
-const std::any* Player::FindDataStorage(const std::type_index& type) const
+SessionSnapshot::Player Player::SaveSnapshot() const
 {
-	if (auto found = m_UserData.find(type); found != m_UserData.end())
-		return &found->second;
-
-	return nullptr;
+	SessionSnapshot::Player snapshot;
+	snapshot.m_Status = m_Status;
+	snapshot.m_Status.m_Address.clear();
+	snapshot.m_Scores = m_Scores;
+	snapshot.m_Team = m_Team;
+	snapshot.m_ClientIndex = m_ClientIndex;
+	snapshot.m_LastStatusUpdateTime = m_LastStatusUpdateTime;
+	snapshot.m_LastStatusActiveBegin = m_LastStatusActiveBegin;
+	return snapshot;
 }
 
-std::any& Player::GetOrCreateDataStorage(const std::type_index& type)
+void Player::RestoreSnapshot(const SessionSnapshot::Player& snapshot)
 {
-	return m_UserData[type];
-}
-
-template<typename T>
-static std::vector<SteamID> Take100(const T& collection)
-{
-	std::vector<SteamID> retVal;
-	for (SteamID id : collection)
-	{
-		if (retVal.size() >= 100)
-			break;
-
-		retVal.push_back(id);
-	}
-	return retVal;
+	SetStatus(snapshot.m_Status, snapshot.m_LastStatusUpdateTime);
+	m_LastStatusActiveBegin = snapshot.m_LastStatusActiveBegin;
+	m_Scores = snapshot.m_Scores;
+	m_Team = snapshot.m_Team;
+	m_ClientIndex = snapshot.m_ClientIndex;
 }
 
 auto WorldState::PlayerSummaryUpdateAction::SendRequest(
-	WorldState*& state, queue_collection_type& collection) -> response_future_type
+	WorldState*& state, const queue_collection_type& collection) -> response_future_type
 {
 	auto client = state->GetSettings().GetHTTPClient();
 	if (!client)
@@ -1180,13 +2644,13 @@ auto WorldState::PlayerSummaryUpdateAction::SendRequest(
 	{
 		for (auto& entry : collection)
 		{
-			if (auto found = state->FindPlayer(entry))
-				static_cast<Player*>(found)->m_PlayerSummary = SteamAPI::ErrorCode::SteamAPIDisabled;
+			if (auto found = static_cast<Player*>(state->FindPlayer(entry)); found && !found->m_PlayerSummary)
+				found->m_PlayerSummary = SteamAPI::ErrorCode::SteamAPIDisabled;
 		}
 		return {};
 	}
 
-	std::vector<SteamID> steamIDs = Take100(collection);
+	std::vector<SteamID> steamIDs(collection.begin(), collection.end());
 
 	return SteamAPI::GetPlayerSummariesAsync(
 		state->GetSettings(), std::move(steamIDs), *client);
@@ -1196,20 +2660,31 @@ void WorldState::PlayerSummaryUpdateAction::OnDataReady(WorldState*& state,
 	const response_type& response, queue_collection_type& collection)
 {
 	DebugLog("[SteamAPI] Received {} player summaries", response.size());
+	DB::ITempDB& cacheDB = TF2BDApplication::GetApplication().GetTempDB();
 	for (const SteamAPI::PlayerSummary& entry : response)
 	{
 		auto& player = state->FindOrCreatePlayer(entry.m_SteamID);
 		player.m_PlayerSummary = entry;
 
+		if (entry.m_SteamID.Type == SteamAccountType::Individual)
+		{
+			DB::PlayerSummaryCacheInfo cacheInfo{};
+			static_cast<SteamAPI::PlayerSummary&>(cacheInfo) = entry;
+			cacheInfo.m_LastCacheUpdateTime = tfbd_clock_t::now();
+			cacheDB.Store(cacheInfo);
+		}
+
 		collection.erase(entry.m_SteamID);
 
 		if (entry.m_CreationTime.has_value())
 			state->m_AccountAges->OnDataReady(entry.m_SteamID, entry.m_CreationTime.value());
 	}
+
+	state->DropDepartedPlayers(collection, &Player::m_PlayerSummary);
 }
 
 auto WorldState::PlayerBansUpdateAction::SendRequest(state_type& state,
-	queue_collection_type& collection) -> response_future_type
+	const queue_collection_type& collection) -> response_future_type
 {
 	auto client = state->GetSettings().GetHTTPClient();
 	if (!client)
@@ -1219,13 +2694,13 @@ auto WorldState::PlayerBansUpdateAction::SendRequest(state_type& state,
 	{
 		for (auto& entry : collection)
 		{
-			if (auto found = state->FindPlayer(entry))
-				static_cast<Player*>(found)->m_PlayerSteamBans = SteamAPI::ErrorCode::SteamAPIDisabled;
+			if (auto found = static_cast<Player*>(state->FindPlayer(entry)); found && !found->m_PlayerSteamBans)
+				found->m_PlayerSteamBans = SteamAPI::ErrorCode::SteamAPIDisabled;
 		}
 		return {};
 	}
 
-	std::vector<SteamID> steamIDs = Take100(collection);
+	std::vector<SteamID> steamIDs(collection.begin(), collection.end());
 	return SteamAPI::GetPlayerBansAsync(
 		state->GetSettings(), std::move(steamIDs), *client);
 }
@@ -1234,9 +2709,65 @@ void WorldState::PlayerBansUpdateAction::OnDataReady(state_type& state,
 	const response_type& response, queue_collection_type& collection)
 {
 	DebugLog("[SteamAPI] Received {} player bans", response.size());
+	DB::ITempDB& cacheDB = TF2BDApplication::GetApplication().GetTempDB();
 	for (const SteamAPI::PlayerBans& bans : response)
 	{
 		state->FindOrCreatePlayer(bans.m_SteamID).m_PlayerSteamBans = bans;
 		collection.erase(bans.m_SteamID);
+
+		if (bans.m_SteamID.Type == SteamAccountType::Individual)
+		{
+			DB::PlayerBansCacheInfo cacheInfo{};
+			static_cast<SteamAPI::PlayerBans&>(cacheInfo) = bans;
+			cacheInfo.m_LastCacheUpdateTime = tfbd_clock_t::now();
+			cacheDB.Store(cacheInfo);
+		}
+	}
+
+	state->DropDepartedPlayers(collection, &Player::m_PlayerSteamBans);
+}
+
+auto WorldState::LogsInfoUpdateAction::SendRequest(state_type& state,
+	const queue_collection_type& collection) -> response_future_type
+{
+	auto client = state->GetSettings().GetHTTPClient();
+	if (!client)
+		return {};
+
+	std::vector<SteamID> steamIDs(collection.begin(), collection.end());
+
+	// One request per player, so each of them can still be dropped if that player leaves
+	std::vector<CancellationToken> cancel;
+	cancel.reserve(steamIDs.size());
+	for (const SteamID& id : steamIDs)
+	{
+		if (auto found = state->m_CurrentPlayerData.find(id); found != state->m_CurrentPlayerData.end())
+			cancel.push_back(found->second->GetFetchCancellationToken());
+		else
+			cancel.emplace_back();
 	}
+
+	return LogsTFAPI::GetPlayerLogsInfoAsync(std::move(client), std::move(steamIDs), std::move(cancel));
+}
+
+void WorldState::LogsInfoUpdateAction::OnDataReady(state_type& state,
+	const response_type& response, queue_collection_type& collection)
+{
+	DebugLog("[LogsTF] Received {} player logs counts", response.size());
+	DB::ITempDB& cacheDB = TF2BDApplication::GetApplication().GetTempDB();
+	for (const LogsTFAPI::PlayerLogsInfo& info : response)
+	{
+		state->FindOrCreatePlayer(info.m_ID).m_LogsInfo = info;
+		collection.erase(info.m_ID);
+
+		if (info.m_ID.Type == SteamAccountType::Individual)
+		{
+			DB::LogsTFCacheInfo cacheInfo{};
+			static_cast<LogsTFAPI::PlayerLogsInfo&>(cacheInfo) = info;
+			cacheInfo.m_LastCacheUpdateTime = tfbd_clock_t::now();
+			cacheDB.Store(cacheInfo);
+		}
+	}
+
+	state->DropDepartedPlayers(collection, &Player::m_LogsInfo);
 }
@@ -1,13 +1,19 @@
 #pragma once
 
 #include "Clock.h"
+#include "ConsoleLog/IConsoleLine.h"
+#include "PlayerStatus.h"
 #include "SteamID.h"
 #include "TFConstants.h"
+#include "Util/InternedString.h"
 
 #include <mh/coroutine/task.hpp>
 #include <mh/coroutine/generator.hpp>
 
+#include <cstddef>
 #include <optional>
+#include <span>
+#include <vector>
 
 #undef GetCurrentTime
 
@@ -21,8 +27,10 @@ namespace tf2_bot_detector
 	class IPlayer;
 	class IWorldEventListener;
 	enum class LobbyMemberTeam : uint8_t;
+	struct SessionSnapshot;
 	class Settings;
 	enum class TFClassType;
+	struct WorldSnapshot;
 
 	enum class TeamShareResult
 	{
@@ -31,6 +39,117 @@ namespace tf2_bot_detector
 		Neither,
 	};
 
+	// Totals over the current players who are lobby members on one team
+	struct LobbyTeamStats
+	{
+		uint8_t m_PlayerCount = 0;
+		uint8_t m_ConnectedCount = 0; // Active in their latest status update
+		uint32_t m_Kills = 0;
+		uint32_t m_Deaths = 0;
+	};
+
+	// The current players, one array per field, for the loops that go over all of them but only look
+	// at a few fields each. Row i of every array is the same player.
+	struct ActivePlayerTable
+	{
+		size_t size() const { return m_Players.size(); }
+		bool empty() const { return m_Players.empty(); }
+
+		std::vector<const IPlayer*> m_Players;
+		std::vector<SteamID> m_SteamIDs;
+		std::vector<std::optional<LobbyMemberTeam>> m_LobbyTeams;
+		std::vector<TFTeam> m_Teams;
+		std::vector<UserID_t> m_UserIDs;  // 0 if we haven't seen them in a status update
+		std::vector<PlayerStatusState> m_States;
+		std::vector<uint16_t> m_Kills;
+		std::vector<uint16_t> m_Deaths;
+		std::vector<uint16_t> m_Pings;
+		std::vector<time_point_t> m_LastStatusUpdateTimes;
+
+		// Not a column, the subset of m_Players who are lobby members. Current members come before
+		// pending ones, and nobody is in here twice.
+		std::vector<const IPlayer*> m_LobbyMembers;
+	};
+
+	// What the server's vote system is up to, going by the vote user messages and the votes we
+	// called. The user messages don't say who called a vote or who it's against, so that's only
+	// known for the ones we called.
+	struct VoteState
+	{
+		// The defaults of sv_vote_timer_duration, sv_vote_creation_timer and sv_vote_failure_timer
+		static constexpr duration_t VOTE_DURATION = std::chrono::seconds(15);
+		static constexpr duration_t CREATION_COOLDOWN = std::chrono::seconds(150);
+		static constexpr duration_t FAILED_KICK_COOLDOWN = std::chrono::seconds(300);
+
+		// How long the server has to start our vote or turn it down before we stop waiting on it
+		static constexpr duration_t CALL_RESPONSE_TIMEOUT = std::chrono::seconds(5);
+
+		// The earliest the server should accept a callvote from us to kick target
+		time_point_t GetNextCallTime(const SteamID& target) const;
+
+		// The vote in progress, or the last one
+		bool m_InProgress = false;
+		bool m_CalledByUs = false;
+		SteamID m_Target;  // Only known if m_CalledByUs
+		time_point_t m_StartTime{};
+
+		time_point_t m_LastCallTime{};
+		SteamID m_LastCallTarget;
+		bool m_AwaitingCallResponse = false;
+
+		// Each player can only start a vote every CREATION_COOLDOWN
+		time_point_t m_LastOwnVoteStartTime{};
+
+		// The server turned down our callvote without starting a vote. It doesn't tell us why, so
+		// we back off a little more each time.
+		time_point_t m_LastCallFailedTime{};
+		uint8_t m_CallFailures = 0;  // In a row
+
+		// Failed kick votes can't be called again on the same player for FAILED_KICK_COOLDOWN
+		struct FailedKick
+		{
+			SteamID m_Target;
+			time_point_t m_Time{};
+		};
+		std::vector<FailedKick> m_FailedKicks;
+	};
+
+	// Goes over a list of players without the coroutine frame a generator needs. Only valid for as
+	// long as the list is, which for IWorldState's is until the players or the lobby change.
+	template<typename TPlayer>
+	class PlayerRange final
+	{
+	public:
+		class iterator final
+		{
+		public:
+			using value_type = TPlayer;
+			using difference_type = std::ptrdiff_t;
+
+			iterator() = default;
+			explicit iterator(const IPlayer* const* it) : m_It(it) {}
+
+			TPlayer& operator*() const { return const_cast<TPlayer&>(**m_It); }
+			TPlayer* operator->() const { return &**this; }
+			iterator& operator++() { ++m_It; return *this; }
+			iterator operator++(int) { auto retVal = *this; ++m_It; return retVal; }
+			bool operator==(const iterator&) const = default;
+
+		private:
+			const IPlayer* const* m_It = nullptr;
+		};
+
+		PlayerRange(std::span<const IPlayer* const> players) : m_Players(players) {}
+
+		iterator begin() const { return iterator(m_Players.data()); }
+		iterator end() const { return iterator(m_Players.data() + m_Players.size()); }
+		size_t size() const { return m_Players.size(); }
+		bool empty() const { return m_Players.empty(); }
+
+	private:
+		std::span<const IPlayer* const> m_Players;
+	};
+
 	class IWorldState;
 
 	class IWorldStateConLog
@@ -44,6 +163,10 @@ namespace tf2_bot_detector
 		virtual IConsoleLineListener& GetConsoleLineListenerBroadcaster() = 0;
 
 		virtual void UpdateTimestamp(const ConsoleLogParser& parser) = 0;
+
+		// True if this line of console.log was already broadcast from a command response, in which
+		// case it shouldn't be broadcast again. textHash is IConsoleLine::HashText().
+		virtual bool IsDuplicateCommandResponseLine(const IConsoleLine& line, size_t textHash) = 0;
 	};
 
 	class IWorldState : public IWorldStateConLog, public std::enable_shared_from_this<IWorldState>
@@ -60,13 +183,26 @@ namespace tf2_bot_detector
 
 		virtual void AddWorldEventListener(IWorldEventListener* listener) = 0;
 		virtual void RemoveWorldEventListener(IWorldEventListener* listener) = 0;
-		virtual void AddConsoleLineListener(IConsoleLineListener* listener) = 0;
+		// lineTypes only filters OnConsoleLineParsed(), the other callbacks are always invoked
+		virtual void AddConsoleLineListener(IConsoleLineListener* listener,
+			ConsoleLineTypeMask lineTypes = ConsoleLineTypeMask::All()) = 0;
 		virtual void RemoveConsoleLineListener(IConsoleLineListener* listener) = 0;
 
 		virtual void AddConsoleOutputChunk(const std::string_view& chunk) = 0;
+		// The output of a command we sent. Every line is tried against parsers first. The lines they
+		// recognise also show up in console.log, so whichever copy arrives second is dropped.
+		virtual void AddCommandResponse(const std::string_view& response, std::span<const IConsoleLine::TryParseFunc> parsers) = 0;
 		virtual mh::task<> AddConsoleOutputLine(std::string line) = 0;
 
-		virtual std::optional<SteamID> FindSteamIDForName(const std::string_view& playerName) const = 0;
+		virtual std::optional<SteamID> FindSteamIDForName(const InternedString& playerName) const = 0;
+		std::optional<SteamID> FindSteamIDForName(const std::string_view& playerName) const
+		{
+			// Nobody can have a name that was never interned
+			if (auto name = InternedString::Find(playerName))
+				return FindSteamIDForName(*name);
+
+			return std::nullopt;
+		}
 		virtual std::optional<LobbyMemberTeam> FindLobbyMemberTeam(const SteamID& id) const = 0;
 		virtual std::optional<UserID_t> FindUserID(const SteamID& id) const = 0;
 
@@ -76,6 +212,12 @@ namespace tf2_bot_detector
 		static TeamShareResult GetTeamShareResult(
 			const std::optional<LobbyMemberTeam>& team0, const std::optional<LobbyMemberTeam>& team1);
 
+		// Only recalculated after the lobby, scores or player statuses change, cheap enough for every frame
+		virtual const LobbyTeamStats& GetLobbyTeamStats(LobbyMemberTeam team) const = 0;
+		// Rebuilt on the first call after a player joins or leaves, or their lobby team, status, scores
+		// or ping change. Don't hold onto it past anything that could do one of those.
+		virtual const ActivePlayerTable& GetActivePlayers() const = 0;
+
 		virtual const IPlayer* FindPlayer(const SteamID& id) const = 0;
 		IPlayer* FindPlayer(const SteamID& id) { return const_cast<IPlayer*>(std::as_const(*this).FindPlayer(id)); }
 
@@ -85,11 +227,33 @@ namespace tf2_bot_detector
 		virtual mh::generator<const IPlayer&> GetPlayers() const = 0;
 		mh::generator<IPlayer&> GetPlayers();
 
+		// The same players as GetPlayers() and GetLobbyMembers(), straight out of GetActivePlayers().
+		// Don't change the players or the lobby while going over them.
+		PlayerRange<const IPlayer> GetPlayerRange() const { return PlayerRange<const IPlayer>(GetActivePlayers().m_Players); }
+		PlayerRange<IPlayer> GetPlayerRange() { return PlayerRange<IPlayer>(GetActivePlayers().m_Players); }
+		PlayerRange<const IPlayer> GetLobbyMemberRange() const { return PlayerRange<const IPlayer>(GetActivePlayers().m_LobbyMembers); }
+		PlayerRange<IPlayer> GetLobbyMemberRange() { return PlayerRange<IPlayer>(GetActivePlayers().m_LobbyMembers); }
+
 		// Have we joined a team and picked a class?
 		virtual bool IsLocalPlayerInitialized() const = 0;
-		virtual bool IsVoteInProgress() const = 0;
+		bool IsVoteInProgress() const { return GetVoteState().m_InProgress; }
+		virtual const VoteState& GetVoteState() const = 0;
+
+		// Called when we queue a callvote to kick someone, so the server's answer can be matched up with it
+		virtual void RecordVoteCall(const SteamID& target) = 0;
 
 		virtual const IAccountAges& GetAccountAges() const = 0;
+
+		// The latest published WorldSnapshot. Unlike everything else here, safe to call from any thread.
+		virtual std::shared_ptr<const WorldSnapshot> GetWorldSnapshot() const = 0;
+
+		// Restoring only fills in players and lobby members we haven't heard anything newer about
+		virtual void SaveSnapshot(SessionSnapshot& snapshot) const = 0;
+		virtual void RestoreSnapshot(const SessionSnapshot& snapshot) = 0;
+
+		// For once we've left the server: forgets the archived players (anyone who comes back is
+		// reloaded from the temp db) and shrinks the player tables. Returns how many players were dropped.
+		virtual size_t ReleaseIdleMemory() = 0;
 	};
 
 	inline mh::generator<IPlayer&> IWorldState::GetLobbyMembers()